@@ -7,6 +7,9 @@
 #include "common/errcode.h"
 #include "common/hattrie/murmurhash3.h"
 #include "libknot/common.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /* UCW array sorting defines. */
 static int universal_cmp(uint32_t k1, uint32_t k2, hhash_t *tbl);
@@ -20,23 +23,118 @@ static int universal_cmp(uint32_t k1, uint32_t k2, hhash_t *tbl);
 #define HOP_NEXT(x) __builtin_ctz((x))
 #define HOP_LEN (sizeof(hhbitvec_t) * 8)
 #define HOP_BIT(d) ((hhbitvec_t)1 << (d))
-#define HHVAL_LEN sizeof(value_t)
-#define HHKEY_LEN (HHVAL_LEN + sizeof(uint16_t))
 #define HHSCAN_THRESHOLD (HOP_LEN / 2)
 
-/* Data is composed of {value, keylen, key}.
- * Value is fixed size (pointer), so is keylen.
- * Key is variable-sized string. */
-#define KEY_VAL(p) (p)
-#define KEY_LEN(p) ((p) + HHVAL_LEN)
-#define KEY_STR(p) ((char*)(p) + HHKEY_LEN)
+/* Keys longer than HHKEY_INLINE are stored out of the table as
+ * {keylen, key}, where keylen is fixed size and key is variable-sized. */
+#define HHKEY_EXT 0xff
+#define EXT_LEN(p) (p)
+#define EXT_STR(p) ((char*)(p) + sizeof(uint16_t))
 
-/*! \brief Helper function to read key length. */
-static inline uint16_t key_readlen(const void *k)
+/*! \brief Key fingerprints, stored after the table items.
+ *
+ * Fingerprint 0 marks an empty item. The first HOP_LEN fingerprints are
+ * mirrored past the end, so a neighbourhood is always contiguous.
+ */
+static inline uint8_t *hhash_tags(const hhash_t *tbl)
 {
-	uint16_t ret;
-	memcpy(&ret, KEY_LEN(k), sizeof(ret));
-	return ret;
+	return (uint8_t *)(tbl->item + tbl->size);
+}
+
+/*! \brief Fingerprint from hash bits not used for the bucket index. */
+static inline uint8_t key_tag(uint32_t hash)
+{
+	uint8_t tag = hash >> 24;
+	return tag != 0 ? tag : 1;
+}
+
+static inline void tag_set(hhash_t *tbl, uint32_t id, uint8_t tag)
+{
+	uint8_t *tags = hhash_tags(tbl);
+	tags[id] = tag;
+	if (id < HOP_LEN) {
+		tags[tbl->size + id] = tag;
+	}
+}
+
+static inline bool hhelem_used(const hhash_t *tbl, uint32_t id)
+{
+	return hhash_tags(tbl)[id] != 0;
+}
+
+/*! \brief Bitmap of items in <id, id + HOP_LEN) with matching fingerprint. */
+static inline hhbitvec_t tag_match(const hhash_t *tbl, uint32_t id, uint8_t tag)
+{
+	const uint8_t *tags = hhash_tags(tbl) + id;
+#if defined(__SSE2__)
+	/* HOP_LEN is 32, compare two 16B vectors. */
+	__m128i needle = _mm_set1_epi8(tag);
+	__m128i lo = _mm_loadu_si128((const __m128i *)tags);
+	__m128i hi = _mm_loadu_si128((const __m128i *)(tags + 16));
+	hhbitvec_t match_lo = _mm_movemask_epi8(_mm_cmpeq_epi8(lo, needle));
+	hhbitvec_t match_hi = _mm_movemask_epi8(_mm_cmpeq_epi8(hi, needle));
+	return match_lo | (match_hi << 16);
+#else
+	hhbitvec_t match = 0;
+	for (unsigned i = 0; i < HOP_LEN; ++i) {
+		match |= (hhbitvec_t)(tags[i] == tag) << i;
+	}
+	return match;
+#endif
+}
+
+/*! \brief Return pointer to external key. */
+static inline char *hhelem_ext(const hhelem_t *elm)
+{
+	char *ext = NULL;
+	memcpy(&ext, elm->key, sizeof(ext));
+	return ext;
+}
+
+/*! \brief Return item key and its length. */
+static inline const char *hhelem_key(const hhelem_t *elm, uint16_t *len)
+{
+	if (elm->len == HHKEY_EXT) {
+		const char *ext = hhelem_ext(elm);
+		memcpy(len, EXT_LEN(ext), sizeof(uint16_t));
+		return EXT_STR(ext);
+	}
+
+	*len = elm->len;
+	return elm->key;
+}
+
+/*! \brief Store key in the item (inline if short enough). */
+static int hhelem_set(hhash_t *tbl, hhelem_t *elm, const char *key, uint16_t len)
+{
+	if (len <= HHKEY_INLINE) {
+		elm->len = len;
+		memcpy(elm->key, key, len);
+	} else {
+		char *ext = tbl->mm.alloc(tbl->mm.ctx, sizeof(uint16_t) + len);
+		if (ext == NULL) {
+			return KNOT_ENOMEM;
+		}
+		memcpy(EXT_LEN(ext), &len, sizeof(uint16_t));
+		memcpy(EXT_STR(ext), key,  len);
+		elm->len = HHKEY_EXT;
+		memcpy(elm->key, &ext, sizeof(ext));
+	}
+
+	elm->val = NULL;
+	return KNOT_EOK;
+}
+
+/*! \brief Move item data (not the hop bitvector) to an empty item. */
+static void hhelem_move(hhash_t *tbl, uint32_t dst, uint32_t src)
+{
+	hhelem_t *to = &tbl->item[dst];
+	hhelem_t *from = &tbl->item[src];
+	to->len = from->len;
+	memcpy(to->key, from->key, HHKEY_INLINE);
+	to->val = from->val;
+	tag_set(tbl, dst, hhash_tags(tbl)[src]);
+	tag_set(tbl, src, 0);
 }
 
 /*! \brief Reduce distance to first free element. */
@@ -51,11 +149,11 @@ static int reduce_dist(hhash_t *t, int idx, int *empty)
 		 * in the vicinity of the target index.
 		 */
 		unsigned cur = (t->size + *empty - dist) % t->size; /* bucket to be vacated */
-		unsigned off = HOP_NEXT(t->item[cur].hop);     /* offset of first valid bucket */
-		if (t->item[cur].hop != 0 && off < dist) {     /* only offsets in <s, f> are interesting */
+		hhbitvec_t hop = t->item[cur].hop;
+		unsigned off = hop ? HOP_NEXT(hop) : HOP_LEN;  /* offset of first valid bucket */
+		if (off < dist) {                              /* only offsets in <s, f> are interesting */
 			unsigned hit = (cur + off) % t->size;  /* this item will be displaced to [f] */
-			t->item[*empty].d = t->item[hit].d;    /* displace data */
-			t->item[hit].d = NULL;
+			hhelem_move(t, *empty, hit);           /* displace data */
 			t->item[cur].hop &= ~HOP_BIT(off); /* displace bitvector index */
 			t->item[cur].hop |=  HOP_BIT(dist);
 			*empty = hit;
@@ -87,32 +185,54 @@ static int key_cmp(const char *k1, uint16_t k1_len, const char *k2, uint16_t k2_
 	return 1;
 }
 
+/*! \brief Compare item key with given key. */
+static int hhelem_cmp(const hhelem_t *elm, const char *key, uint16_t len)
+{
+	uint16_t elm_len = 0;
+	const char *elm_key = hhelem_key(elm, &elm_len);
+	return key_cmp(elm_key, elm_len, key, len);
+}
+
 /*! \brief Universal comparator. */
 static int universal_cmp(uint32_t i1, uint32_t i2, hhash_t *tbl)
 {
 	/* Get item data from indirect positions. */
-	void *k1 = tbl->item[i1].d;
-	void *k2 = tbl->item[i2].d;
-
-	/* Read key lengths. */
-	return key_cmp(KEY_STR(k1), key_readlen(k1), KEY_STR(k2), key_readlen(k2));
+	uint16_t len = 0;
+	const char *key = hhelem_key(&tbl->item[i2], &len);
+	return hhelem_cmp(&tbl->item[i1], key, len);
 }
 
 /*! \brief Check for equality. */
-static bool hhelem_isequal(hhelem_t *elm, const char *key, uint16_t len)
+static bool hhelem_isequal(const hhelem_t *elm, const char *key, uint16_t len)
 {
-	uint16_t klen;
-	memcpy(&klen, KEY_LEN(elm->d), sizeof(klen));
-	if (klen != len) {
+	if (len <= HHKEY_INLINE) {
+		return elm->len == len && memcmp(elm->key, key, len) == 0;
+	}
+
+	if (elm->len != HHKEY_EXT) {
+		return false;
+	}
+	uint16_t ext_len = 0;
+	const char *ext = hhelem_ext(elm);
+	memcpy(&ext_len, EXT_LEN(ext), sizeof(uint16_t));
+	if (ext_len != len) {
 		return false;
 	}
 
-	return memcmp(KEY_STR(elm->d), key, len) == 0;
+	return memcmp(EXT_STR(ext), key, len) == 0;
 }
 
 /*! \brief Binary search index for key. */
-#define CMP_I2K(t, k) (t)->item[t->index[k]].d
-#define CMP_LE(t,i,x...) (key_cmp(KEY_STR(CMP_I2K(t, i)), key_readlen(CMP_I2K(t, i)), x) <= 0)
+#define CMP_LE(t,i,x...) (hhelem_cmp(&(t)->item[(t)->index[i]], x) <= 0)
+
+/*! \brief Drop order index, it is invalidated by table changes. */
+static void hhash_drop_index(hhash_t *tbl)
+{
+	if (tbl->index && tbl->mm.free) {
+		tbl->mm.free(tbl->index);
+	}
+	tbl->index = NULL;
+}
 
 /*! \brief Find matching index + offset. */
 static int hhelem_free(hhash_t* tbl, uint32_t id, unsigned dist, value_t *val)
@@ -122,22 +242,22 @@ static int hhelem_free(hhash_t* tbl, uint32_t id, unsigned dist, value_t *val)
 	elm->hop &= ~HOP_BIT(dist);
 
 	/* Copy value for future reference. */
-	elm = &tbl->item[(id + dist) % tbl->size];
+	id = (id + dist) % tbl->size;
+	elm = &tbl->item[id];
 	if (val != NULL) {
-		memcpy(val, KEY_VAL(elm->d), sizeof(value_t));
+		*val = elm->val;
 	}
 
 	/* Erase data from target element. */
-	if (tbl->mm.free) {
-		tbl->mm.free(elm->d);
-		elm->d = NULL;
+	if (elm->len == HHKEY_EXT && tbl->mm.free) {
+		tbl->mm.free(hhelem_ext(elm));
 	}
+	elm->len = 0;
+	elm->val = NULL;
+	tag_set(tbl, id, 0);
 
 	/* Invalidate index. */
-	if (tbl->mm.free) {
-		tbl->mm.free(tbl->index);
-		tbl->index = NULL;
-	}
+	hhash_drop_index(tbl);
 
 	/* Update table weight. */
 	--tbl->weight;
@@ -150,36 +270,35 @@ static int find_free(hhash_t *t, unsigned idx)
 	/* Distance is measured as a shortest path forward.
 	 * Table is treated as circular, so we need to scan
 	 * first <elm..end> and <start..elm - 1> */
-	hhelem_t *np = t->item + t->size;
-	hhelem_t *elm = NULL;
+	const uint8_t *tags = hhash_tags(t);
 
 	/* From <elm, end> */
-	for (elm = t->item + idx; elm != np; ++elm) {
-		if (elm->d == NULL) {
-			return elm - (t->item + idx);
-		}
+	const uint8_t *elm = memchr(tags + idx, 0, t->size - idx);
+	if (elm != NULL) {
+		return elm - (tags + idx);
 	}
 	/* From <start, elm) */
-	np = t->item + idx;
-	for (elm = t->item; elm != np; ++elm) {
-		if (elm->d == NULL) {
-			return (elm - t->item) + (t->size - idx);
-		}
+	elm = memchr(tags, 0, idx);
+	if (elm != NULL) {
+		return (elm - tags) + (t->size - idx);
 	}
 
 	return KNOT_ESPACE; /* Table is full. */
 }
 
 /*! \brief Find match in the bucket vicinity <0, HOP_LEN> */
-static unsigned find_match(hhash_t *tbl, uint32_t idx, const char* key, uint16_t len)
+static unsigned find_match(hhash_t *tbl, uint32_t idx, uint8_t tag,
+                           const char* key, uint16_t len)
 {
-	unsigned empty = 0;
-	unsigned dist = 0;
+	/* Only items with matching fingerprint are compared. */
 	hhbitvec_t match = tbl->item[idx].hop;
+	if (match != 0) {
+		match &= tag_match(tbl, idx, tag);
+	}
 	while (match != 0) {
-		dist = HOP_NEXT(match);
-		empty = (idx + dist) % tbl->size;
-		if (hhelem_isequal(tbl->item + empty, key, len)) {
+		unsigned dist = HOP_NEXT(match);
+		unsigned found = (idx + dist) % tbl->size;
+		if (hhelem_isequal(tbl->item + found, key, len)) {
 			return dist;
 		} else {
 			match &= ~HOP_BIT(dist); /* clear potential match */
@@ -194,14 +313,22 @@ static void hhash_free_buckets(hhash_t *tbl)
 {
 	assert(tbl != NULL);
 	if (tbl->mm.free) {
-		/* Free buckets. */
+		/* Free out of table keys. */
 		for (unsigned i = 0; i < tbl->size; ++i) {
-			tbl->mm.free(tbl->item[i].d);
+			if (hhelem_used(tbl, i) && tbl->item[i].len == HHKEY_EXT) {
+				tbl->mm.free(hhelem_ext(&tbl->item[i]));
+			}
 		}
-
-		/* Free order index. */
-		tbl->mm.free(tbl->index);
 	}
+
+	/* Free order index. */
+	hhash_drop_index(tbl);
+}
+
+/*! \brief Table size including the fingerprints. */
+static size_t hhash_total_len(uint32_t size)
+{
+	return sizeof(hhash_t) + size * (sizeof(hhelem_t) + 1) + HOP_LEN;
 }
 
 hhash_t *hhash_create(uint32_t size)
@@ -217,7 +344,7 @@ hhash_t *hhash_create_mm(uint32_t size, const mm_ctx_t *mm)
 		return NULL;
 	}
 
-	const size_t total_len = sizeof(hhash_t) + size * sizeof(hhelem_t);
+	const size_t total_len = hhash_total_len(size);
 	hhash_t *tbl = mm->alloc(mm->ctx, total_len);
 	if (tbl) {
 		memset(tbl, 0, total_len);
@@ -236,8 +363,7 @@ void hhash_clear(hhash_t *tbl)
 
 	/* Clear buckets. */
 	hhash_free_buckets(tbl);
-	memset(tbl->item, 0, tbl->size * sizeof(hhelem_t));
-	tbl->index = NULL;
+	memset(tbl->item, 0, hhash_total_len(tbl->size) - sizeof(hhash_t));
 
 	/* Reset weight. */
 	tbl->weight = 0;
@@ -267,7 +393,7 @@ value_t *hhash_find(hhash_t* tbl, const char* key, uint16_t len)
 		if (k > -1) {
 			hhelem_t *found = tbl->item + tbl->index[k];
 			if (hhelem_isequal(found, key, len)) {
-				return (value_t *)KEY_VAL(found->d);
+				return &found->val;
 			}
 		}
 		return NULL; /* Not found. */
@@ -283,12 +409,14 @@ value_t *hhash_map(hhash_t* tbl, const char* key, uint16_t len, uint16_t mode)
 	}
 
 	/* Find an exact match in <id, id + HOP_LEN). */
-	uint32_t id = hash(key, len) % tbl->size;
-	int dist = find_match(tbl, id, key, len);
+	uint32_t hk = hash(key, len);
+	uint32_t id = hk % tbl->size;
+	uint8_t tag = key_tag(hk);
+	int dist = find_match(tbl, id, tag, key, len);
 	if (dist <= HOP_LEN) {
 		/* Found exact match, return value. */
 		hhelem_t *match = &tbl->item[(id + dist) % tbl->size];
-		return (value_t *)KEY_VAL(match->d);
+		return &match->val;
 	}
 
 	/* We didn't find an exact match, continue only if inserting. */
@@ -312,32 +440,21 @@ value_t *hhash_map(hhash_t* tbl, const char* key, uint16_t len, uint16_t mode)
 		}
 	}
 
-	/* Insert to given position. */
-	char *new_key = tbl->mm.alloc(tbl->mm.ctx, HHKEY_LEN + len);
-	if (new_key != NULL) {
-		memset(KEY_VAL(new_key), 0,    sizeof(value_t));
-		memcpy(KEY_LEN(new_key), &len, sizeof(uint16_t));
-		memcpy(KEY_STR(new_key), key,  len);
-	} else {
+	/* found free elm 'k' which is in <id, id + HOP_LEN) */
+	assert(!hhelem_used(tbl, empty));
+	hhelem_t *elm = &tbl->item[empty];
+	if (hhelem_set(tbl, elm, key, len) != KNOT_EOK) {
 		return NULL;
 	}
-
-	/* found free elm 'k' which is in <id, id + HOP_LEN) */
-	assert(tbl->item[empty].d == NULL);
 	tbl->item[id].hop |= HOP_BIT(dist);
-	tbl->item[empty].d = new_key;
+	tag_set(tbl, empty, tag);
 
 	++tbl->weight;
 
 	/* Free old index. */
-	if (tbl->index) {
-		if (tbl->mm.free) {
-			free(tbl->index);
-		}
-		tbl->index = NULL;
-	}
+	hhash_drop_index(tbl);
 
-	return (value_t *)KEY_VAL(new_key);
+	return &elm->val;
 }
 
 int hhash_insert(hhash_t* tbl, const char* key, uint16_t len, value_t val)
@@ -356,8 +473,9 @@ int hhash_del(hhash_t* tbl, const char* key, uint16_t len)
 		return KNOT_EINVAL;
 	}
 
-	uint32_t idx = hash(key, len) % tbl->size;
-	unsigned dist = find_match(tbl, idx, key, len);
+	uint32_t hk = hash(key, len);
+	uint32_t idx = hk % tbl->size;
+	unsigned dist = find_match(tbl, idx, key_tag(hk), key, len);
 	if (dist > HOP_LEN) {
 		return KNOT_ENOENT;
 	}
@@ -368,7 +486,7 @@ int hhash_del(hhash_t* tbl, const char* key, uint16_t len)
 value_t *hhash_indexval(hhash_t* tbl, unsigned i)
 {
 	if (tbl != NULL && tbl->index != NULL) {
-		return (value_t *)KEY_VAL(tbl->item[ tbl->index[i] ].d);
+		return &tbl->item[ tbl->index[i] ].val;
 	}
 
 	return 0;
@@ -381,13 +499,7 @@ void hhash_build_index(hhash_t* tbl)
 	}
 
 	/* Free old index. */
-	if (tbl->index) {
-		if (tbl->mm.free) {
-			tbl->mm.free(tbl->index);
-		}
-		tbl->index = NULL;
-	}
-
+	hhash_drop_index(tbl);
 
 	/* Rebuild index. */
 	uint32_t total = tbl->weight;
@@ -399,7 +511,7 @@ void hhash_build_index(hhash_t* tbl)
 	uint32_t i = 0, indexed = 0;
 	while (indexed < total) {
 		/* Non-empty item, store index. */
-		if (tbl->item[i].d != NULL) {
+		if (hhelem_used(tbl, i)) {
 			tbl->index[indexed] = i;
 			++indexed;
 		}
@@ -419,7 +531,7 @@ int hhash_find_leq(hhash_t* tbl, const char* key, uint16_t len, value_t** dst)
 	int k = BIN_SEARCH_FIRST_GE_CMP(tbl, tbl->weight, CMP_LE, key, len) - 1;
 	if (k > -1) {
 		hhelem_t *found = tbl->item + tbl->index[k];
-		*dst = (value_t *)KEY_VAL(found->d);
+		*dst = &found->val;
 		/* Compare if found equal or predecessor. */
 		if (hhelem_isequal(found, key, len)) {
 			return 0; /* Exact match. */
@@ -437,11 +549,11 @@ enum {
 	HH_SORTED  = 0x01 /* sorted iteration */
 };
 
-static void* hhash_sorted_iter_item(hhash_iter_t *i)
+static hhelem_t *hhash_sorted_iter_item(hhash_iter_t *i)
 {
 	hhash_t *tbl = i->tbl;
 	uint32_t pos = tbl->index[i->i];
-	return tbl->item[pos].d;
+	return &tbl->item[pos];
 }
 
 static inline bool hhash_sorted_iter_finished(hhash_iter_t* i)
@@ -463,9 +575,7 @@ static const char* hhash_sorted_iter_key(hhash_iter_t* i, uint16_t* len)
 		return NULL;
 	}
 
-	void *key = hhash_sorted_iter_item(i);
-	*len = key_readlen(key);
-	return KEY_STR(key);
+	return hhelem_key(hhash_sorted_iter_item(i), len);
 }
 
 static value_t *hhash_sorted_iter_val(hhash_iter_t* i)
@@ -474,13 +584,13 @@ static value_t *hhash_sorted_iter_val(hhash_iter_t* i)
 		return NULL;
 	}
 
-	return (value_t *)KEY_VAL(hhash_sorted_iter_item(i));
+	return &hhash_sorted_iter_item(i)->val;
 }
 
 static uint32_t hhash_unsorted_seek_valid(hhash_t *tbl, uint32_t idx)
 {
 	while (idx < tbl->size) {
-		if (tbl->item[idx].d != NULL) {
+		if (hhelem_used(tbl, idx)) {
 			break;
 		}
 		++idx;
@@ -514,9 +624,7 @@ static const char* hhash_unsorted_iter_key(hhash_iter_t* i, uint16_t* len)
 		return NULL;
 	}
 
-	void *key = i->tbl->item[i->i].d;
-	*len = key_readlen(key);
-	return KEY_STR(key);
+	return hhelem_key(&i->tbl->item[i->i], len);
 }
 
 static value_t *hhash_unsorted_iter_val(hhash_iter_t* i)
@@ -525,7 +633,7 @@ static value_t *hhash_unsorted_iter_val(hhash_iter_t* i)
 		return NULL;
 	}
 
-	return (value_t *)KEY_VAL(i->tbl->item[i->i].d);
+	return &i->tbl->item[i->i].val;
 }
 
 void hhash_iter_begin(hhash_t* tbl, hhash_iter_t* i, bool sorted)
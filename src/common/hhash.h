@@ -47,10 +47,15 @@ enum {
 	HHASH_CONSUME    = 1 << 4  /* Consume first byte of the split items. */
 };
 
+/*! \brief Keys up to this length are stored inline in the table. */
+#define HHKEY_INLINE 11
+
 /*! \brief Element descriptor, contains data and bitmap of adjacent items. */
 typedef struct hhelem {
 	hhbitvec_t hop; /* Hop bitvector. */
-	char *d; /* { value_t val, uint16_t keylen, char[] key } */
+	uint8_t len;    /* Inline key length or 0xff for external key. */
+	char key[HHKEY_INLINE]; /* Key or pointer to { uint16_t keylen, char[] key } */
+	value_t val;
 } hhelem_t;
 
 typedef struct hhash {
@@ -66,7 +71,7 @@ typedef struct hhash {
 	/* Table data storage. */
 	mm_ctx_t mm;      /*!< Memory manager. */
 	uint32_t *index;  /*!< Order index (optional). */
-	hhelem_t item[];  /*!< Table items. */
+	hhelem_t item[];  /*!< Table items, followed by 1B key fingerprints. */
 } hhash_t;
 
 /*!
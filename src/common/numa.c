@@ -0,0 +1,243 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common/numa.h"
+#include "common/errcode.h"
+
+/*! \brief Largest CPU number accepted from the CPU list. */
+#define NUMA_CPU_MAX 4096
+
+/*! \brief Parse unsigned number, advance the string. */
+static int parse_num(const char **str, unsigned *out)
+{
+	if (!isdigit((unsigned char)**str)) {
+		return KNOT_EMALF;
+	}
+
+	char *end = NULL;
+	unsigned long val = strtoul(*str, &end, 10);
+	if (val > NUMA_CPU_MAX) {
+		return KNOT_EMALF;
+	}
+
+	*out = val;
+	*str = end;
+	return KNOT_EOK;
+}
+
+int numa_cpulist_parse(const char *str, unsigned *cpus, size_t max)
+{
+	if (str == NULL) {
+		return KNOT_EMALF;
+	}
+
+	int count = 0;
+	while (*str != '\0' && *str != '\n') {
+		unsigned lo = 0, hi = 0;
+		if (parse_num(&str, &lo) != KNOT_EOK) {
+			return KNOT_EMALF;
+		}
+		hi = lo;
+		if (*str == '-') {
+			++str;
+			if (parse_num(&str, &hi) != KNOT_EOK || hi < lo) {
+				return KNOT_EMALF;
+			}
+		}
+
+		for (unsigned cpu = lo; cpu <= hi; ++cpu) {
+			if (cpus != NULL && (size_t)count < max) {
+				cpus[count] = cpu;
+			}
+			++count;
+		}
+
+		if (*str == ',') {
+			++str;
+		} else if (*str != '\0' && *str != '\n') {
+			return KNOT_EMALF;
+		}
+	}
+
+	return count;
+}
+
+/*! \brief Read CPU list of the node, returns number of CPUs or error. */
+static int node_load(numa_node_t *node, const char *sysfs, unsigned id)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/node%u/cpulist", sysfs, id);
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		return 0;
+	}
+
+	char line[1024] = { '\0' };
+	char *ret = fgets(line, sizeof(line), fp);
+	fclose(fp);
+	int count = ret ? numa_cpulist_parse(line, NULL, 0) : 0;
+	if (count <= 0) {
+		return 0;
+	}
+
+	node->cpus = malloc(count * sizeof(unsigned));
+	if (node->cpus == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	numa_cpulist_parse(line, node->cpus, count);
+	node->id = id;
+	node->ncpus = count;
+	return count;
+}
+
+static int node_cmp(const void *a, const void *b)
+{
+	const numa_node_t *x = a, *y = b;
+	return (x->id > y->id) - (x->id < y->id);
+}
+
+/*! \brief Single node with all online CPUs. */
+static int topo_fallback(numa_topo_t *topo)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1) {
+		cpus = 1;
+	}
+
+	topo->nodes = calloc(1, sizeof(numa_node_t));
+	if (topo->nodes == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	numa_node_t *node = topo->nodes;
+	node->cpus = malloc(cpus * sizeof(unsigned));
+	if (node->cpus == NULL) {
+		free(topo->nodes);
+		topo->nodes = NULL;
+		return KNOT_ENOMEM;
+	}
+
+	for (long i = 0; i < cpus; ++i) {
+		node->cpus[i] = i;
+	}
+	node->ncpus = cpus;
+	topo->count = 1;
+	return KNOT_EOK;
+}
+
+int numa_topo_load(numa_topo_t *topo, const char *sysfs)
+{
+	if (topo == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(topo, 0, sizeof(numa_topo_t));
+	if (sysfs == NULL) {
+		sysfs = NUMA_SYSFS;
+	}
+
+	/* Nodes may be sparse, scan the directory. */
+	DIR *dir = opendir(sysfs);
+	if (dir == NULL) {
+		return topo_fallback(topo);
+	}
+
+	int ret = KNOT_EOK;
+	unsigned size = 0;
+	struct dirent *ent = NULL;
+	while ((ent = readdir(dir)) != NULL) {
+		unsigned id = 0;
+		const char *num = ent->d_name + 4;
+		if (strncmp(ent->d_name, "node", 4) != 0 ||
+		    parse_num(&num, &id) != KNOT_EOK || *num != '\0') {
+			continue;
+		}
+
+		if (topo->count == size) {
+			size = size ? 2 * size : 4;
+			numa_node_t *nodes = realloc(topo->nodes,
+			                             size * sizeof(numa_node_t));
+			if (nodes == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			topo->nodes = nodes;
+		}
+
+		numa_node_t *node = &topo->nodes[topo->count];
+		memset(node, 0, sizeof(numa_node_t));
+		int count = node_load(node, sysfs, id);
+		if (count < 0) {
+			ret = count;
+			break;
+		}
+		if (count > 0) {
+			topo->count += 1;
+		}
+	}
+	closedir(dir);
+
+	if (ret != KNOT_EOK) {
+		numa_topo_free(topo);
+		return ret;
+	}
+
+	if (topo->count == 0) {
+		numa_topo_free(topo);
+		return topo_fallback(topo);
+	}
+
+	qsort(topo->nodes, topo->count, sizeof(numa_node_t), node_cmp);
+	return KNOT_EOK;
+}
+
+void numa_topo_free(numa_topo_t *topo)
+{
+	if (topo == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < topo->count; ++i) {
+		free(topo->nodes[i].cpus);
+	}
+	free(topo->nodes);
+	memset(topo, 0, sizeof(numa_topo_t));
+}
+
+const numa_node_t *numa_topo_node(const numa_topo_t *topo, int id)
+{
+	if (topo == NULL || id < 0) {
+		return NULL;
+	}
+
+	for (unsigned i = 0; i < topo->count; ++i) {
+		if (topo->nodes[i].id == (unsigned)id) {
+			return &topo->nodes[i];
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file numa.h
+ *
+ * \brief NUMA topology discovery.
+ *
+ * Nodes and their CPUs are read from sysfs on Linux. Systems without
+ * NUMA information are described as a single node with all online CPUs.
+ *
+ * \addtogroup common_lib
+ * @{
+ */
+
+#ifndef _KNOTD_COMMON_NUMA_H_
+#define _KNOTD_COMMON_NUMA_H_
+
+#include <stddef.h>
+
+/*! \brief Default location of node descriptions. */
+#define NUMA_SYSFS "/sys/devices/system/node"
+
+/*! \brief NUMA node. */
+typedef struct numa_node {
+	unsigned id;    /*!< Node number. */
+	unsigned ncpus; /*!< Number of CPUs. */
+	unsigned *cpus; /*!< CPU numbers, ascending. */
+} numa_node_t;
+
+/*! \brief System topology, nodes are ordered by number. */
+typedef struct numa_topo {
+	unsigned count;     /*!< Number of nodes with CPUs. */
+	numa_node_t *nodes; /*!< Nodes. */
+} numa_topo_t;
+
+/*!
+ * \brief Parse CPU list in the kernel format (e.g. "0-3,8,10-11").
+ *
+ * \param str CPU list.
+ * \param cpus Output array (may be NULL to count only).
+ * \param max Output array size.
+ *
+ * \return Number of CPUs in the list or KNOT_EMALF.
+ */
+int numa_cpulist_parse(const char *str, unsigned *cpus, size_t max);
+
+/*!
+ * \brief Discover nodes and their CPUs.
+ *
+ * Nodes without CPUs (memory only) are skipped. If no node is found,
+ * a single node 0 with all online CPUs is made up.
+ *
+ * \param topo Topology to fill.
+ * \param sysfs Directory with node descriptions (NULL for NUMA_SYSFS).
+ *
+ * \retval KNOT_EOK
+ * \retval KNOT_ENOMEM
+ */
+int numa_topo_load(numa_topo_t *topo, const char *sysfs);
+
+/*! \brief Free the topology. */
+void numa_topo_free(numa_topo_t *topo);
+
+/*! \brief Find node by its number, NULL if there is no such node. */
+const numa_node_t *numa_topo_node(const numa_topo_t *topo, int id);
+
+#endif /* _KNOTD_COMMON_NUMA_H_ */
+
+/*! @} */
@@ -0,0 +1,615 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "common/qp-trie/trie.h"
+#include "common/errcode.h"
+#include "libknot/common.h"
+
+/*! \brief Key stored in a leaf. */
+typedef struct {
+	uint32_t len;
+	uint8_t chars[];
+} tkey_t;
+
+/*!
+ * \brief Trie node, leaf or branch.
+ *
+ * Leaf key pointer is aligned, so the lowest bit of the first word tells
+ * them apart. Branch flags contain (from the lowest bit) the branch flag,
+ * 17-bit twig bitmap (key end followed by 16 nibble values) and the nibble
+ * index into the key. Twigs are stored in the bitmap order.
+ */
+typedef union node {
+	struct {
+		uintptr_t flags;
+		union node *twigs;
+	} branch;
+	struct {
+		tkey_t *key;
+		trie_val_t val;
+	} leaf;
+} node_t;
+
+#define BRANCH_FLAG ((uintptr_t)1)
+#define BMP_END     ((uintptr_t)1 << 1)
+#define BMP_MASK    ((uintptr_t)0x1ffff << 1)
+#define INDEX_SHIFT 18
+#define KEY_MAXLEN  ((UINTPTR_MAX >> INDEX_SHIFT) / 2)
+
+struct trie {
+	node_t root;   /*!< Root node, valid only if weight > 0. */
+	size_t weight; /*!< Number of leaves. */
+	mm_ctx_t mm;   /*!< Memory context. */
+};
+
+struct trie_it {
+	node_t **stack; /*!< Path from the root to the current leaf. */
+	uint32_t len;   /*!< Path length, 0 if finished. */
+	uint32_t alen;  /*!< Allocated path length. */
+};
+
+static inline bool isbranch(const node_t *t)
+{
+	return t->branch.flags & BRANCH_FLAG;
+}
+
+static inline uint32_t branch_index(const node_t *t)
+{
+	return t->branch.flags >> INDEX_SHIFT;
+}
+
+static inline unsigned branch_weight(const node_t *t)
+{
+	return __builtin_popcountl(t->branch.flags & BMP_MASK);
+}
+
+static inline bool has_twig(const node_t *t, uintptr_t bit)
+{
+	return t->branch.flags & bit;
+}
+
+/*! \brief Position of the twig in the twig array. */
+static inline unsigned twig_off(const node_t *t, uintptr_t bit)
+{
+	return __builtin_popcountl(t->branch.flags & BMP_MASK & (bit - 1));
+}
+
+static inline node_t *twig(node_t *t, unsigned off)
+{
+	return &t->branch.twigs[off];
+}
+
+/*! \brief Bitmap bit for the key nibble at given index. */
+static inline uintptr_t key_bit(const uint8_t *key, uint32_t len, uint32_t index)
+{
+	uint32_t i = index / 2;
+	if (i >= len) {
+		return BMP_END;
+	}
+
+	uint8_t nibble = (index % 2) ? key[i] & 0x0f : key[i] >> 4;
+	return BMP_END << (1 + nibble);
+}
+
+/*! \brief Find nibble index of the first difference, false if equal. */
+static bool key_diff(const tkey_t *k, const uint8_t *key, uint32_t len,
+                     uint32_t *index)
+{
+	uint32_t min = MIN(k->len, len);
+	for (uint32_t i = 0; i < min; ++i) {
+		uint8_t x = k->chars[i] ^ key[i];
+		if (x != 0) {
+			*index = 2 * i + ((x & 0xf0) ? 0 : 1);
+			return true;
+		}
+	}
+
+	if (k->len == len) {
+		return false;
+	}
+
+	*index = 2 * min;
+	return true;
+}
+
+static tkey_t *key_create(trie_t *tbl, const uint8_t *key, uint32_t len)
+{
+	tkey_t *k = mm_alloc(&tbl->mm, sizeof(tkey_t) + len);
+	if (k == NULL) {
+		return NULL;
+	}
+
+	assert(((uintptr_t)k & BRANCH_FLAG) == 0);
+	k->len = len;
+	memcpy(k->chars, key, len);
+	return k;
+}
+
+/*! \brief Descend to any leaf sharing the longest prefix with the key. */
+static node_t *find_closest(trie_t *tbl, const uint8_t *key, uint32_t len)
+{
+	node_t *t = &tbl->root;
+	while (isbranch(t)) {
+		uintptr_t bit = key_bit(key, len, branch_index(t));
+		t = twig(t, has_twig(t, bit) ? twig_off(t, bit) : 0);
+	}
+
+	return t;
+}
+
+/*! \brief Free the subtree. */
+static void clear_node(trie_t *tbl, node_t *t)
+{
+	if (!isbranch(t)) {
+		mm_free(&tbl->mm, t->leaf.key);
+		return;
+	}
+
+	unsigned count = branch_weight(t);
+	for (unsigned i = 0; i < count; ++i) {
+		clear_node(tbl, twig(t, i));
+	}
+	mm_free(&tbl->mm, t->branch.twigs);
+}
+
+trie_t *trie_create(const mm_ctx_t *mm)
+{
+	mm_ctx_t mm_default;
+	if (mm == NULL) {
+		mm_ctx_init(&mm_default);
+		mm = &mm_default;
+	}
+
+	trie_t *tbl = mm_alloc((mm_ctx_t *)mm, sizeof(trie_t));
+	if (tbl == NULL) {
+		return NULL;
+	}
+
+	memset(tbl, 0, sizeof(trie_t));
+	tbl->mm = *mm;
+	return tbl;
+}
+
+void trie_free(trie_t *tbl)
+{
+	if (tbl == NULL) {
+		return;
+	}
+
+	trie_clear(tbl);
+	mm_ctx_t mm = tbl->mm;
+	mm_free(&mm, tbl);
+}
+
+void trie_clear(trie_t *tbl)
+{
+	if (tbl == NULL || tbl->weight == 0) {
+		return;
+	}
+
+	clear_node(tbl, &tbl->root);
+	memset(&tbl->root, 0, sizeof(node_t));
+	tbl->weight = 0;
+}
+
+size_t trie_weight(const trie_t *tbl)
+{
+	if (tbl == NULL) {
+		return 0;
+	}
+
+	return tbl->weight;
+}
+
+trie_val_t *trie_get_try(trie_t *tbl, const uint8_t *key, uint32_t len)
+{
+	if (tbl == NULL || tbl->weight == 0) {
+		return NULL;
+	}
+
+	node_t *t = &tbl->root;
+	while (isbranch(t)) {
+		uintptr_t bit = key_bit(key, len, branch_index(t));
+		if (!has_twig(t, bit)) {
+			return NULL;
+		}
+		t = twig(t, twig_off(t, bit));
+	}
+
+	const tkey_t *k = t->leaf.key;
+	if (k->len != len || memcmp(k->chars, key, len) != 0) {
+		return NULL;
+	}
+
+	return &t->leaf.val;
+}
+
+trie_val_t *trie_get_ins(trie_t *tbl, const uint8_t *key, uint32_t len)
+{
+	if (tbl == NULL) {
+		return NULL;
+	}
+#if UINT32_MAX > KEY_MAXLEN
+	/* Only reachable where pointers are too narrow for 32-bit lengths. */
+	if (len > KEY_MAXLEN) {
+		return NULL;
+	}
+#endif
+
+	if (tbl->weight == 0) {
+		tkey_t *k = key_create(tbl, key, len);
+		if (k == NULL) {
+			return NULL;
+		}
+		tbl->root.leaf.key = k;
+		tbl->root.leaf.val = NULL;
+		tbl->weight = 1;
+		return &tbl->root.leaf.val;
+	}
+
+	/* Find where the key diverges from the trie. */
+	node_t *t = find_closest(tbl, key, len);
+	const tkey_t *closest = t->leaf.key;
+	uint32_t index = 0;
+	if (!key_diff(closest, key, len, &index)) {
+		return &t->leaf.val;
+	}
+
+	uintptr_t new_bit = key_bit(key, len, index);
+	uintptr_t old_bit = key_bit(closest->chars, closest->len, index);
+
+	/* Descend to the node branching at or after the index. */
+	t = &tbl->root;
+	while (isbranch(t) && branch_index(t) < index) {
+		uintptr_t bit = key_bit(key, len, branch_index(t));
+		assert(has_twig(t, bit));
+		t = twig(t, twig_off(t, bit));
+	}
+
+	tkey_t *k = key_create(tbl, key, len);
+	if (k == NULL) {
+		return NULL;
+	}
+
+	if (isbranch(t) && branch_index(t) == index) {
+		/* Add twig to the existing branch. */
+		unsigned count = branch_weight(t);
+		unsigned off = twig_off(t, new_bit);
+		node_t *twigs = mm_alloc(&tbl->mm, (count + 1) * sizeof(node_t));
+		if (twigs == NULL) {
+			mm_free(&tbl->mm, k);
+			return NULL;
+		}
+		memcpy(twigs, t->branch.twigs, off * sizeof(node_t));
+		memcpy(twigs + off + 1, t->branch.twigs + off,
+		       (count - off) * sizeof(node_t));
+		mm_free(&tbl->mm, t->branch.twigs);
+		t->branch.flags |= new_bit;
+		t->branch.twigs = twigs;
+		t = twigs + off;
+	} else {
+		/* Split the node with a new branch. */
+		node_t *twigs = mm_alloc(&tbl->mm, 2 * sizeof(node_t));
+		if (twigs == NULL) {
+			mm_free(&tbl->mm, k);
+			return NULL;
+		}
+		unsigned off = (new_bit < old_bit) ? 0 : 1;
+		twigs[1 - off] = *t;
+		t->branch.flags = BRANCH_FLAG | new_bit | old_bit |
+		                  ((uintptr_t)index << INDEX_SHIFT);
+		t->branch.twigs = twigs;
+		t = twigs + off;
+	}
+
+	t->leaf.key = k;
+	t->leaf.val = NULL;
+	++tbl->weight;
+	return &t->leaf.val;
+}
+
+int trie_get_leq(trie_t *tbl, const uint8_t *key, uint32_t len,
+                 trie_val_t **val)
+{
+	*val = NULL;
+	if (tbl == NULL || tbl->weight == 0) {
+		return 1;
+	}
+
+	node_t *t = find_closest(tbl, key, len);
+	const tkey_t *closest = t->leaf.key;
+	uint32_t index = 0;
+	if (!key_diff(closest, key, len, &index)) {
+		*val = &t->leaf.val;
+		return 0;
+	}
+
+	uintptr_t new_bit = key_bit(key, len, index);
+	uintptr_t old_bit = key_bit(closest->chars, closest->len, index);
+
+	/* Descend along the key, remember the nearest lesser subtree. */
+	node_t *lesser = NULL;
+	t = &tbl->root;
+	while (isbranch(t) && branch_index(t) < index) {
+		unsigned off = twig_off(t, key_bit(key, len, branch_index(t)));
+		if (off > 0) {
+			lesser = twig(t, off - 1);
+		}
+		t = twig(t, off);
+	}
+
+	if (isbranch(t) && branch_index(t) == index) {
+		unsigned off = twig_off(t, new_bit);
+		if (off > 0) {
+			lesser = twig(t, off - 1);
+		}
+	} else if (new_bit > old_bit) {
+		lesser = t;
+	}
+
+	if (lesser == NULL) {
+		return 1;
+	}
+
+	/* Greatest leaf in the subtree. */
+	while (isbranch(lesser)) {
+		lesser = twig(lesser, branch_weight(lesser) - 1);
+	}
+
+	*val = &lesser->leaf.val;
+	return -1;
+}
+
+/*! \brief Key ending at the branch, it is always the first twig. */
+static inline node_t *branch_end(node_t *t)
+{
+	return has_twig(t, BMP_END) ? twig(t, 0) : NULL;
+}
+
+trie_val_t *trie_get_prefix(trie_t *tbl, const uint8_t *key, uint32_t len)
+{
+	if (tbl == NULL || tbl->weight == 0) {
+		return NULL;
+	}
+
+	/* Keys ending on the path are prefixes of each other, find the
+	 * longest one and the first nibble where it differs from the key. */
+	node_t *longest = NULL;
+	node_t *t = &tbl->root;
+	while (isbranch(t)) {
+		node_t *end = branch_end(t);
+		if (end != NULL) {
+			longest = end;
+		}
+		uintptr_t bit = key_bit(key, len, branch_index(t));
+		if (!has_twig(t, bit)) {
+			break;
+		}
+		t = twig(t, twig_off(t, bit));
+	}
+	if (!isbranch(t)) {
+		longest = t;
+	}
+	if (longest == NULL) {
+		return NULL;
+	}
+
+	uint32_t index = 2 * len;
+	(void)key_diff(longest->leaf.key, key, len, &index);
+
+	/* Shorter keys on the path up to the difference are prefixes too. */
+	node_t *found = NULL;
+	t = &tbl->root;
+	while (isbranch(t) && branch_index(t) <= index) {
+		node_t *end = branch_end(t);
+		if (end != NULL) {
+			found = end;
+		}
+		uintptr_t bit = key_bit(key, len, branch_index(t));
+		if (!has_twig(t, bit)) {
+			break;
+		}
+		t = twig(t, twig_off(t, bit));
+	}
+	if (!isbranch(t) && 2 * t->leaf.key->len <= index &&
+	    t->leaf.key->len <= len) {
+		found = t;
+	}
+
+	return found ? &found->leaf.val : NULL;
+}
+
+int trie_del(trie_t *tbl, const uint8_t *key, uint32_t len, trie_val_t *val)
+{
+	if (tbl == NULL || tbl->weight == 0) {
+		return KNOT_ENOENT;
+	}
+
+	node_t *parent = NULL;
+	node_t *t = &tbl->root;
+	uintptr_t bit = 0;
+	while (isbranch(t)) {
+		bit = key_bit(key, len, branch_index(t));
+		if (!has_twig(t, bit)) {
+			return KNOT_ENOENT;
+		}
+		parent = t;
+		t = twig(t, twig_off(t, bit));
+	}
+
+	tkey_t *k = t->leaf.key;
+	if (k->len != len || memcmp(k->chars, key, len) != 0) {
+		return KNOT_ENOENT;
+	}
+
+	if (val != NULL) {
+		*val = t->leaf.val;
+	}
+	mm_free(&tbl->mm, k);
+	--tbl->weight;
+
+	if (parent == NULL) {
+		memset(&tbl->root, 0, sizeof(node_t));
+		return KNOT_EOK;
+	}
+
+	node_t *twigs = parent->branch.twigs;
+	unsigned count = branch_weight(parent);
+	unsigned off = t - twigs;
+
+	/* Branch with a single twig is replaced by the twig. */
+	if (count == 2) {
+		*parent = twigs[1 - off];
+		mm_free(&tbl->mm, twigs);
+		return KNOT_EOK;
+	}
+
+	node_t *shrunk = mm_alloc(&tbl->mm, (count - 1) * sizeof(node_t));
+	if (shrunk != NULL) {
+		memcpy(shrunk, twigs, off * sizeof(node_t));
+		memcpy(shrunk + off, twigs + off + 1,
+		       (count - off - 1) * sizeof(node_t));
+		mm_free(&tbl->mm, twigs);
+		parent->branch.twigs = shrunk;
+	} else {
+		/* Keep the larger array. */
+		memmove(twigs + off, twigs + off + 1,
+		        (count - off - 1) * sizeof(node_t));
+	}
+	parent->branch.flags &= ~bit;
+
+	return KNOT_EOK;
+}
+
+static int apply_node(node_t *t, trie_cb_t f, void *data)
+{
+	if (!isbranch(t)) {
+		return f(&t->leaf.val, data);
+	}
+
+	unsigned count = branch_weight(t);
+	for (unsigned i = 0; i < count; ++i) {
+		int ret = apply_node(twig(t, i), f, data);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int trie_apply(trie_t *tbl, trie_cb_t f, void *data)
+{
+	if (tbl == NULL || f == NULL || tbl->weight == 0) {
+		return 0;
+	}
+
+	return apply_node(&tbl->root, f, data);
+}
+
+static void it_push(trie_it_t *it, node_t *t)
+{
+	if (it->len == it->alen) {
+		it->alen *= 2;
+		it->stack = xrealloc(it->stack, it->alen * sizeof(node_t *));
+	}
+	it->stack[it->len++] = t;
+}
+
+/*! \brief Descend from the top of the stack to the leftmost leaf. */
+static void it_descend(trie_it_t *it)
+{
+	node_t *t = it->stack[it->len - 1];
+	while (isbranch(t)) {
+		t = twig(t, 0);
+		it_push(it, t);
+	}
+}
+
+trie_it_t *trie_it_begin(const trie_t *tbl)
+{
+	if (tbl == NULL) {
+		return NULL;
+	}
+
+	trie_it_t *it = xmalloc(sizeof(trie_it_t));
+	it->len = 0;
+	it->alen = 64;
+	it->stack = xmalloc(it->alen * sizeof(node_t *));
+
+	if (tbl->weight > 0) {
+		it_push(it, (node_t *)&tbl->root);
+		it_descend(it);
+	}
+
+	return it;
+}
+
+void trie_it_next(trie_it_t *it)
+{
+	assert(it && it->len > 0);
+
+	/* Move to the next sibling of the deepest node that has one. */
+	while (it->len > 1) {
+		node_t *t = it->stack[it->len - 1];
+		node_t *parent = it->stack[it->len - 2];
+		unsigned off = t - parent->branch.twigs;
+		if (off + 1 < branch_weight(parent)) {
+			it->stack[it->len - 1] = t + 1;
+			it_descend(it);
+			return;
+		}
+		--it->len;
+	}
+
+	it->len = 0;
+}
+
+bool trie_it_finished(trie_it_t *it)
+{
+	return it == NULL || it->len == 0;
+}
+
+void trie_it_free(trie_it_t *it)
+{
+	if (it == NULL) {
+		return;
+	}
+
+	free(it->stack);
+	free(it);
+}
+
+const uint8_t *trie_it_key(trie_it_t *it, uint32_t *len)
+{
+	assert(it && it->len > 0);
+
+	const tkey_t *k = it->stack[it->len - 1]->leaf.key;
+	if (len != NULL) {
+		*len = k->len;
+	}
+	return k->chars;
+}
+
+trie_val_t *trie_it_val(trie_it_t *it)
+{
+	assert(it && it->len > 0);
+
+	return &it->stack[it->len - 1]->leaf.val;
+}
@@ -0,0 +1,154 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file trie.h
+ *
+ * \brief QP-trie (quadbit popcount trie) keyed by binary strings.
+ *
+ * Branch nodes index the key by 4-bit nibbles and keep only the present
+ * children in a dense array addressed by popcount of the child bitmap.
+ * Both leaves and branches take two machine words, keys are stored once
+ * per leaf. Keys are ordered lexicographically as unsigned bytes with
+ * a prefix ordered before its extensions, so ordered lookup and sorted
+ * iteration need no extra index.
+ *
+ * \addtogroup common_lib
+ * @{
+ */
+
+#ifndef _KNOTD_COMMON_QP_TRIE_H_
+#define _KNOTD_COMMON_QP_TRIE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "common/mempattern.h"
+
+/*! \brief Value stored in the trie. */
+typedef void *trie_val_t;
+
+/*! \brief Opaque trie. */
+typedef struct trie trie_t;
+
+/*! \brief Opaque iterator. */
+typedef struct trie_it trie_it_t;
+
+/*! \brief Callback for trie_apply(), non-zero return value stops the walk. */
+typedef int (*trie_cb_t)(trie_val_t *val, void *data);
+
+/*!
+ * \brief Create an empty trie.
+ *
+ * \param mm Memory context (or NULL for malloc()).
+ */
+trie_t *trie_create(const mm_ctx_t *mm);
+
+/*! \brief Free the trie and all its keys, values are left untouched. */
+void trie_free(trie_t *tbl);
+
+/*! \brief Remove all entries. */
+void trie_clear(trie_t *tbl);
+
+/*! \brief Number of entries in the trie. */
+size_t trie_weight(const trie_t *tbl);
+
+/*!
+ * \brief Find value by key.
+ *
+ * \return Pointer to the value or NULL if not found.
+ */
+trie_val_t *trie_get_try(trie_t *tbl, const uint8_t *key, uint32_t len);
+
+/*!
+ * \brief Find value by key, insert it (with NULL value) if not found.
+ *
+ * \note The returned pointer is valid only until the next modification.
+ *
+ * \return Pointer to the value or NULL on allocation failure.
+ */
+trie_val_t *trie_get_ins(trie_t *tbl, const uint8_t *key, uint32_t len);
+
+/*!
+ * \brief Find the greatest key lesser or equal to the given one.
+ *
+ * \param tbl Trie.
+ * \param key Searched key.
+ * \param len Key length.
+ * \param val Output value of the found key (NULL if there is none).
+ *
+ * \retval 0 exact match.
+ * \retval -1 found lesser key.
+ * \retval 1 all keys in the trie are greater (or the trie is empty).
+ */
+int trie_get_leq(trie_t *tbl, const uint8_t *key, uint32_t len,
+                 trie_val_t **val);
+
+/*!
+ * \brief Find the longest key which is a prefix of the given key.
+ *
+ * \note Walks the trie twice at most, regardless of the number of
+ *       prefixes present.
+ *
+ * \return Pointer to the value or NULL if no key is a prefix of the key.
+ */
+trie_val_t *trie_get_prefix(trie_t *tbl, const uint8_t *key, uint32_t len);
+
+/*!
+ * \brief Remove key from the trie.
+ *
+ * \param tbl Trie.
+ * \param key Key to remove.
+ * \param len Key length.
+ * \param val Output for the removed value (may be NULL).
+ *
+ * \retval KNOT_EOK if removed.
+ * \retval KNOT_ENOENT if not found.
+ */
+int trie_del(trie_t *tbl, const uint8_t *key, uint32_t len, trie_val_t *val);
+
+/*!
+ * \brief Apply function to all values in key order.
+ *
+ * \return First non-zero callback return value or 0.
+ */
+int trie_apply(trie_t *tbl, trie_cb_t f, void *data);
+
+/*!
+ * \brief Create iterator over the trie, in key order.
+ *
+ * \note The trie must not be modified while the iterator is in use.
+ */
+trie_it_t *trie_it_begin(const trie_t *tbl);
+
+/*! \brief Advance the iterator to the next key. */
+void trie_it_next(trie_it_t *it);
+
+/*! \brief Check if the iterator has passed the last key. */
+bool trie_it_finished(trie_it_t *it);
+
+/*! \brief Free the iterator. */
+void trie_it_free(trie_it_t *it);
+
+/*! \brief Key at the iterator position. */
+const uint8_t *trie_it_key(trie_it_t *it, uint32_t *len);
+
+/*! \brief Value at the iterator position. */
+trie_val_t *trie_it_val(trie_it_t *it);
+
+#endif /* _KNOTD_COMMON_QP_TRIE_H_ */
+
+/*! @} */
@@ -0,0 +1,276 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#ifdef HAVE_IO_URING
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "common/uring.h"
+#include "common/errcode.h"
+
+/* Ring indices shared with the kernel. */
+#define load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* Alignment of provided buffers. */
+#define URING_BUF_ALIGN 64
+
+static int sys_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_uring_enter(int fd, unsigned submit, unsigned wait,
+                           unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static int sys_uring_register(int fd, unsigned op, void *arg, unsigned nargs)
+{
+	return syscall(__NR_io_uring_register, fd, op, arg, nargs);
+}
+
+int uring_init(uring_t *ring, unsigned entries, unsigned flags)
+{
+	if (ring == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(ring, 0, sizeof(uring_t));
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	p.flags = flags;
+	ring->fd = sys_uring_setup(entries, &p);
+	if (ring->fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	/* Older kernels map SQ and CQ rings separately, not supported. */
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+		close(ring->fd);
+		return KNOT_ENOTSUP;
+	}
+
+	size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->map_len = sq_len > cq_len ? sq_len : cq_len;
+	ring->map = mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE,
+	                 MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->map == MAP_FAILED) {
+		close(ring->fd);
+		return KNOT_ENOMEM;
+	}
+
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ|PROT_WRITE,
+	                  MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		munmap(ring->map, ring->map_len);
+		close(ring->fd);
+		return KNOT_ENOMEM;
+	}
+
+	uint8_t *map = ring->map;
+	ring->sq_head = (unsigned *)(map + p.sq_off.head);
+	ring->sq_tail = (unsigned *)(map + p.sq_off.tail);
+	ring->sq_array = (unsigned *)(map + p.sq_off.array);
+	ring->sq_mask = *(unsigned *)(map + p.sq_off.ring_mask);
+	ring->sq_entries = p.sq_entries;
+	ring->cq_head = (unsigned *)(map + p.cq_off.head);
+	ring->cq_tail = (unsigned *)(map + p.cq_off.tail);
+	ring->cq_mask = *(unsigned *)(map + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(map + p.cq_off.cqes);
+
+	/* Submission entries are consumed in order, identity mapping. */
+	for (unsigned i = 0; i < p.sq_entries; ++i) {
+		ring->sq_array[i] = i;
+	}
+
+	return KNOT_EOK;
+}
+
+int uring_probe(void)
+{
+	/* Single issuer rings came in 6.0, after multishot accept and
+	 * recvmsg and provided buffer rings. */
+	uring_t ring;
+	unsigned flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+	int ret = uring_init(&ring, 1, flags);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	uring_bufs_t bufs;
+	ret = uring_bufs_init(&ring, &bufs, 0, 1, 1);
+	uring_bufs_deinit(&ring, &bufs);
+	uring_deinit(&ring);
+	return ret;
+}
+
+void uring_deinit(uring_t *ring)
+{
+	if (ring == NULL || ring->map == NULL) {
+		return;
+	}
+
+	munmap(ring->sqes, ring->sqes_len);
+	munmap(ring->map, ring->map_len);
+	close(ring->fd);
+	memset(ring, 0, sizeof(uring_t));
+}
+
+struct io_uring_sqe *uring_sqe(uring_t *ring)
+{
+	unsigned tail = *ring->sq_tail + ring->sq_queued;
+	if (tail - load_acquire(ring->sq_head) >= ring->sq_entries) {
+		return NULL;
+	}
+
+	struct io_uring_sqe *sqe = &ring->sqes[tail & ring->sq_mask];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	ring->sq_queued += 1;
+	return sqe;
+}
+
+int uring_enter(uring_t *ring, unsigned wait)
+{
+	/* Publish queued entries. */
+	unsigned submit = ring->sq_queued;
+	if (submit > 0) {
+		store_release(ring->sq_tail, *ring->sq_tail + submit);
+		ring->sq_queued = 0;
+	}
+
+	/* Nothing to submit or wait for. */
+	if (submit == 0 && wait == 0) {
+		return 0;
+	}
+
+	unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+	return sys_uring_enter(ring->fd, submit, wait, flags);
+}
+
+struct io_uring_cqe *uring_cqe(uring_t *ring)
+{
+	unsigned head = *ring->cq_head;
+	if (head == load_acquire(ring->cq_tail)) {
+		return NULL;
+	}
+
+	return &ring->cqes[head & ring->cq_mask];
+}
+
+void uring_cqe_seen(uring_t *ring)
+{
+	store_release(ring->cq_head, *ring->cq_head + 1);
+}
+
+int uring_bufs_init(uring_t *ring, uring_bufs_t *bufs, uint16_t group,
+                    unsigned count, size_t buf_len)
+{
+	if (bufs == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(bufs, 0, sizeof(uring_bufs_t));
+	if (ring == NULL || count == 0 || (count & (count - 1)) != 0 ||
+	    count > 32768) {
+		return KNOT_EINVAL;
+	}
+
+	/* Keep buffers aligned for the headers placed at their start. */
+	buf_len = (buf_len + URING_BUF_ALIGN - 1) & ~(size_t)(URING_BUF_ALIGN - 1);
+	size_t ring_len = count * sizeof(struct io_uring_buf);
+	bufs->ring = mmap(NULL, ring_len, PROT_READ|PROT_WRITE,
+	                  MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (bufs->ring == MAP_FAILED) {
+		bufs->ring = NULL;
+		return KNOT_ENOMEM;
+	}
+
+	bufs->mem = malloc(count * buf_len);
+	if (bufs->mem == NULL) {
+		munmap(bufs->ring, ring_len);
+		bufs->ring = NULL;
+		return KNOT_ENOMEM;
+	}
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uintptr_t)bufs->ring;
+	reg.ring_entries = count;
+	reg.bgid = group;
+	if (sys_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		free(bufs->mem);
+		munmap(bufs->ring, ring_len);
+		bufs->ring = NULL;
+		return KNOT_ENOTSUP;
+	}
+
+	bufs->buf_len = buf_len;
+	bufs->count = count;
+	bufs->group = group;
+
+	/* Hand all buffers to the kernel. */
+	for (unsigned i = 0; i < count; ++i) {
+		uring_bufs_put(bufs, i);
+	}
+	uring_bufs_commit(bufs);
+
+	return KNOT_EOK;
+}
+
+void uring_bufs_deinit(uring_t *ring, uring_bufs_t *bufs)
+{
+	if (bufs == NULL || bufs->ring == NULL) {
+		return;
+	}
+
+	if (ring != NULL && ring->map != NULL) {
+		struct io_uring_buf_reg reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.bgid = bufs->group;
+		sys_uring_register(ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+	}
+
+	munmap(bufs->ring, bufs->count * sizeof(struct io_uring_buf));
+	free(bufs->mem);
+	memset(bufs, 0, sizeof(uring_bufs_t));
+}
+
+void uring_bufs_put(uring_bufs_t *bufs, uint16_t id)
+{
+	struct io_uring_buf *buf = &bufs->ring->bufs[bufs->tail & (bufs->count - 1)];
+	buf->addr = (uintptr_t)uring_buf(bufs, id);
+	buf->len = bufs->buf_len;
+	buf->bid = id;
+	bufs->tail += 1;
+}
+
+void uring_bufs_commit(uring_bufs_t *bufs)
+{
+	store_release(&bufs->ring->tail, bufs->tail);
+}
+
+#endif /* HAVE_IO_URING */
@@ -0,0 +1,155 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file uring.h
+ *
+ * \brief Minimal Linux io_uring interface over raw system calls.
+ *
+ * Covers what the network workers need: a submission and completion
+ * ring pair and a ring of provided receive buffers. The caller fills
+ * submission entries directly using <linux/io_uring.h> definitions.
+ *
+ * \addtogroup common_lib
+ * @{
+ */
+
+#ifndef _KNOTD_COMMON_URING_H_
+#define _KNOTD_COMMON_URING_H_
+
+#ifdef HAVE_IO_URING
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+/*! \brief Submission and completion ring. */
+typedef struct uring {
+	int fd;                      /*!< Ring file descriptor. */
+	void *map;                   /*!< Shared SQ and CQ ring mapping. */
+	size_t map_len;              /*!< Length of the ring mapping. */
+	struct io_uring_sqe *sqes;   /*!< Submission entries. */
+	size_t sqes_len;             /*!< Length of the entries mapping. */
+	unsigned *sq_head;           /*!< Submission ring head (kernel). */
+	unsigned *sq_tail;           /*!< Submission ring tail (user). */
+	unsigned *sq_array;          /*!< Submission index array. */
+	unsigned sq_mask;            /*!< Submission ring mask. */
+	unsigned sq_entries;         /*!< Submission ring size. */
+	unsigned sq_queued;          /*!< Entries queued, not yet submitted. */
+	unsigned *cq_head;           /*!< Completion ring head (user). */
+	unsigned *cq_tail;           /*!< Completion ring tail (kernel). */
+	unsigned cq_mask;            /*!< Completion ring mask. */
+	struct io_uring_cqe *cqes;   /*!< Completion entries. */
+} uring_t;
+
+/*! \brief Ring of provided buffers, the kernel picks one per receive. */
+typedef struct uring_bufs {
+	struct io_uring_buf_ring *ring; /*!< Shared buffer ring. */
+	uint8_t *mem;                   /*!< Buffer memory. */
+	size_t buf_len;                 /*!< Size of each buffer. */
+	unsigned count;                 /*!< Number of buffers (power of 2). */
+	uint16_t group;                 /*!< Buffer group ID. */
+	uint16_t tail;                  /*!< Local ring tail. */
+} uring_bufs_t;
+
+/*!
+ * \brief Create the ring.
+ *
+ * \param ring Ring to initialize.
+ * \param entries Number of submission entries (power of 2).
+ * \param flags IORING_SETUP_* flags.
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_ENOTSUP if the kernel lacks the requested features.
+ * \retval KNOT_ENOMEM if the ring can't be mapped.
+ */
+int uring_init(uring_t *ring, unsigned entries, unsigned flags);
+
+/*!
+ * \brief Check that the kernel supports what the network workers use.
+ *
+ * Single-issuer rings, multishot accept and receive and provided buffer
+ * rings, i.e. Linux 6.0 or newer.
+ *
+ * \retval KNOT_EOK if supported.
+ * \retval KNOT_ENOTSUP if not.
+ */
+int uring_probe(void);
+
+/*! \brief Close the ring, pending requests are cancelled by the kernel. */
+void uring_deinit(uring_t *ring);
+
+/*!
+ * \brief Get a cleared submission entry.
+ *
+ * \return Entry or NULL if the submission ring is full.
+ */
+struct io_uring_sqe *uring_sqe(uring_t *ring);
+
+/*!
+ * \brief Submit queued entries and wait for completions.
+ *
+ * \param ring Ring.
+ * \param wait Minimum number of completions to wait for.
+ *
+ * Returns immediately without a system call if there is nothing to
+ * submit and no completion to wait for.
+ *
+ * \return Number of submitted entries or -1 with errno set.
+ */
+int uring_enter(uring_t *ring, unsigned wait);
+
+/*! \brief Next completion entry or NULL if there is none. */
+struct io_uring_cqe *uring_cqe(uring_t *ring);
+
+/*! \brief Release the completion entry returned by uring_cqe(). */
+void uring_cqe_seen(uring_t *ring);
+
+/*!
+ * \brief Register a group of provided buffers.
+ *
+ * \param ring Ring.
+ * \param bufs Buffer ring to initialize.
+ * \param group Buffer group ID used in submissions.
+ * \param count Number of buffers (power of 2, at most 32768).
+ * \param buf_len Size of each buffer (rounded up for alignment).
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_ENOTSUP if the kernel lacks provided buffer rings.
+ * \retval KNOT_ENOMEM
+ */
+int uring_bufs_init(uring_t *ring, uring_bufs_t *bufs, uint16_t group,
+                    unsigned count, size_t buf_len);
+
+/*! \brief Unregister and free the buffers. */
+void uring_bufs_deinit(uring_t *ring, uring_bufs_t *bufs);
+
+/*! \brief Buffer memory by buffer ID. */
+static inline uint8_t *uring_buf(uring_bufs_t *bufs, uint16_t id)
+{
+	return bufs->mem + (size_t)id * bufs->buf_len;
+}
+
+/*! \brief Give the buffer back to the kernel, visible after commit. */
+void uring_bufs_put(uring_bufs_t *bufs, uint16_t id);
+
+/*! \brief Publish buffers returned by uring_bufs_put(). */
+void uring_bufs_commit(uring_bufs_t *bufs);
+
+#endif /* HAVE_IO_URING */
+
+#endif /* _KNOTD_COMMON_URING_H_ */
+
+/*! @} */
@@ -74,6 +74,7 @@ static void conf_init_iface(void *scanner, char* ifname)
 	}
 	memset(this_iface, 0, sizeof(conf_iface_t));
 	this_iface->name = ifname;
+	this_iface->numa_node = -1;
 }
 
 static void conf_set_iface(void *scanner, struct sockaddr_storage *ss, int family, char* addr, int port)
@@ -470,7 +471,9 @@ static void ident_auto(int tok, conf_t *conf, bool val)
 
 %token <tok> ZONES FILENAME
 %token <tok> DISABLE_ANY
+%token <tok> LAZY_LOAD
 %token <tok> SEMANTIC_CHECKS
+%token <tok> VERIFY_SIGNATURES
 %token <tok> NOTIFY_RETRIES
 %token <tok> NOTIFY_TIMEOUT
 %token <tok> DBSYNC_TIMEOUT
@@ -488,6 +491,9 @@ static void ident_auto(int tok, conf_t *conf, bool val)
 %token <tok> RATE_LIMIT_SIZE
 %token <tok> RATE_LIMIT_SLIP
 %token <tok> TRANSFERS
+%token <tok> STATS_FILE
+%token <tok> STATS_INTERVAL
+%token <tok> STATS_LATENCY
 %token <TOK> STORAGE
 %token <tok> DNSSEC_ENABLE
 %token <tok> DNSSEC_KEYDIR
@@ -496,7 +502,7 @@ static void ident_auto(int tok, conf_t *conf, bool val)
 %token <tok> SERIAL_POLICY_VAL
 %token <tok> QUERY_MODULE
 
-%token <tok> INTERFACES ADDRESS PORT
+%token <tok> INTERFACES ADDRESS PORT NUMA_NODE
 %token <tok> IPA
 %token <tok> IPA6
 %token <tok> VIA
@@ -546,6 +552,9 @@ interface:
  | interface ADDRESS IPA6 '@' NUM ';' {
      conf_set_iface(scanner, &this_iface->addr, AF_INET6, $3.t, $5.i);
    }
+ | interface NUMA_NODE NUM ';' {
+     SET_NUM(this_iface->numa_node, $3.i, 0, 1023, "numa-node");
+   }
  ;
 
 interfaces:
@@ -635,6 +644,11 @@ system:
  | system TRANSFERS NUM ';' {
 	SET_INT(new_config->xfers, $3.i, "transfers");
  }
+ | system STATS_FILE TEXT ';' { new_config->stats_file = $3.t; }
+ | system STATS_INTERVAL INTERVAL ';' {
+	SET_INT(new_config->stats_interval, $3.i, "stats-interval");
+ }
+ | system STATS_LATENCY BOOL ';' { new_config->stats_latency = $3.i; }
  ;
 
 keys:
@@ -879,9 +893,11 @@ zone:
  | zone FILENAME TEXT ';' { this_zone->file = $3.t; }
  | zone BUILD_DIFFS BOOL ';' { this_zone->build_diffs = $3.i; }
  | zone SEMANTIC_CHECKS BOOL ';' { this_zone->enable_checks = $3.i; }
+ | zone VERIFY_SIGNATURES BOOL ';' { this_zone->verify_rrsig = $3.i; }
  | zone STORAGE TEXT ';' { this_zone->storage = $3.t; }
  | zone DNSSEC_KEYDIR TEXT ';' { this_zone->dnssec_keydir = $3.t; }
  | zone DISABLE_ANY BOOL ';' { this_zone->disable_any = $3.i; }
+ | zone LAZY_LOAD BOOL ';' { this_zone->lazy_load = $3.i; }
  | zone DBSYNC_TIMEOUT NUM ';' {
 	SET_INT(this_zone->dbsync_timeout, $3.i, "zonefile-sync");
  }
@@ -917,8 +933,10 @@ zones:
    ZONES '{'
  | zones zone '}'
  | zones DISABLE_ANY BOOL ';' { new_config->disable_any = $3.i; }
+ | zones LAZY_LOAD BOOL ';' { new_config->lazy_load = $3.i; }
  | zones BUILD_DIFFS BOOL ';' { new_config->build_diffs = $3.i; }
  | zones SEMANTIC_CHECKS BOOL ';' { new_config->zone_checks = $3.i; }
+ | zones VERIFY_SIGNATURES BOOL ';' { new_config->verify_rrsig = $3.i; }
  | zones IXFR_FSLIMIT SIZE ';' {
 	SET_SIZE(new_config->ixfr_fslimit, $3.l, "ixfr-fslimit");
  }
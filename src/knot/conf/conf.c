@@ -244,6 +244,14 @@ static int conf_process(conf_t *conf)
 	if (conf->xfers <= 0)
 		conf->xfers = CONFIG_XFERS;
 
+	/* Statistics dump. */
+	if (conf->stats_file) {
+		conf->stats_file = conf_abs_path(conf->rundir, conf->stats_file);
+	}
+	if (conf->stats_interval < 1) {
+		conf->stats_interval = CONFIG_STATS_INTERVAL;
+	}
+
 	/* Zones global configuration. */
 	if (conf->storage == NULL) {
 		conf->storage = strdup(STORAGE_DIR);
@@ -281,11 +289,21 @@ static int conf_process(conf_t *conf)
 			zone->enable_checks = conf->zone_checks;
 		}
 
+		// Default policy for signature verification in semantic checks
+		if (zone->verify_rrsig < 0) {
+			zone->verify_rrsig = conf->verify_rrsig;
+		}
+
 		// Default policy for disabling ANY type queries for AA
 		if (zone->disable_any < 0) {
 			zone->disable_any = conf->disable_any;
 		}
 
+		// Default policy for lazy loading
+		if (zone->lazy_load < 0) {
+			zone->lazy_load = conf->lazy_load;
+		}
+
 		// Default policy for NOTIFY retries
 		if (zone->notify_retries <= 0) {
 			zone->notify_retries = conf->notify_retries;
@@ -431,7 +449,7 @@ static int conf_process(conf_t *conf)
 		/* Load query modules. */
 		struct query_module *module = NULL;
 		WALK_LIST(module, zone->query_modules) {
-			ret = module->load(zone->query_plan, module);
+			ret = query_module_load(zone->query_plan, module);
 			if (ret != KNOT_EOK) {
 				break;
 			}
@@ -473,6 +491,7 @@ void __attribute__ ((constructor)) conf_init()
 	memset(iface, 0, sizeof(conf_iface_t));
 	sockaddr_set(&iface->addr, AF_INET, "127.0.0.1", CONFIG_DEFAULT_PORT);
 	iface->name = strdup("localhost");
+	iface->numa_node = -1;
 	add_tail(&s_config->ifaces, &iface->n);
 
 	/* Create default storage. */
@@ -616,6 +635,7 @@ conf_t *conf_new(char* path)
 
 	/* Defaults. */
 	c->zone_checks = 0;
+	c->verify_rrsig = 0;
 	c->notify_retries = CONFIG_NOTIFY_RETRIES;
 	c->notify_timeout = CONFIG_NOTIFY_TIMEOUT;
 	c->dbsync_timeout = CONFIG_DBSYNC_TIMEOUT;
@@ -772,6 +792,10 @@ void conf_truncate(conf_t *conf, int unload_hooks)
 		free(conf->pidfile);
 		conf->pidfile = NULL;
 	}
+	if (conf->stats_file) {
+		free(conf->stats_file);
+		conf->stats_file = NULL;
+	}
 	if (conf->nsid) {
 		free(conf->nsid);
 		conf->nsid = NULL;
@@ -942,10 +966,12 @@ void conf_init_zone(conf_zone_t *zone)
 
 	// Default policy applies.
 	zone->enable_checks = -1;
+	zone->verify_rrsig = -1;
 	zone->notify_timeout = -1;
 	zone->notify_retries = 0;
 	zone->dbsync_timeout = -1;
 	zone->disable_any = -1;
+	zone->lazy_load = -1;
 	zone->build_diffs = -1;
 	zone->sig_lifetime = -1;
 	zone->dnssec_enable = -1;
@@ -56,6 +56,7 @@
 #define CONFIG_RRL_SLIP 1 /*!< Default slip value. */
 #define CONFIG_RRL_SIZE 393241 /*!< Htable default size. */
 #define CONFIG_XFERS 10
+#define CONFIG_STATS_INTERVAL 60 /*!< [secs] between statistics dumps. */
 #define CONFIG_SERIAL_DEFAULT CONF_SERIAL_INCREMENT /*!< Default serial policy: increment. */
 
 /*!
@@ -72,6 +73,7 @@ typedef struct conf_iface_t {
 	unsigned prefix;              /*!< IP subnet prefix (only applic for remotes). */
 	struct sockaddr_storage addr; /*!< Interface address. */
 	struct sockaddr_storage via;  /*!< Used for remotes to specify qry endpoint.*/
+	int numa_node;                /*!< Preferred NUMA node (-1 for any). */
 } conf_iface_t;
 
 /*!
@@ -124,7 +126,9 @@ typedef struct conf_zone_t {
 	int sig_lifetime;          /*!< Validity period of DNSSEC signatures. */
 	int dbsync_timeout;        /*!< Interval between syncing to zonefile.*/
 	int enable_checks;         /*!< Semantic checks for parser.*/
+	int verify_rrsig;          /*!< Verify RRSIGs in semantic checks. */
 	int disable_any;           /*!< Disable ANY type queries for AA.*/
+	int lazy_load;             /*!< Load zone on first use. */
 	int notify_retries;        /*!< NOTIFY query retries. */
 	int notify_timeout;        /*!< Timeout for NOTIFY response (s). */
 	int build_diffs;           /*!< Calculate differences from changes. */
@@ -224,6 +228,9 @@ typedef struct conf_t {
 	size_t rrl_size; /*!< Rate limit htable size. */
 	int    rrl_slip;  /*!< Rate limit SLIP. */
 	int    xfers;     /*!< Number of parallel transfers. */
+	char  *stats_file;     /*!< Statistics dump file. */
+	int    stats_interval; /*!< Statistics dump interval [secs]. */
+	bool   stats_latency;  /*!< Collect query latency histograms. */
 
 	/*
 	 * Log
@@ -255,7 +262,9 @@ typedef struct conf_t {
 	 */
 	hattrie_t *zones;    /*!< List of zones. */
 	int zone_checks;     /*!< Semantic checks for parser.*/
+	int verify_rrsig;    /*!< Verify RRSIGs in semantic checks. */
 	int disable_any;     /*!< Disable ANY type queries for AA.*/
+	int lazy_load;       /*!< Load zones on first use. */
 	int notify_retries;  /*!< NOTIFY query retries. */
 	int notify_timeout;  /*!< Timeout for NOTIFY response in seconds. */
 	int dbsync_timeout;  /*!< Default interval between syncing to zonefile.*/
@@ -72,6 +72,7 @@ static int cmd_refresh(int argc, char *argv[], unsigned flags);
 static int cmd_flush(int argc, char *argv[], unsigned flags);
 static int cmd_status(int argc, char *argv[], unsigned flags);
 static int cmd_zonestatus(int argc, char *argv[], unsigned flags);
+static int cmd_stats(int argc, char *argv[], unsigned flags);
 static int cmd_checkconf(int argc, char *argv[], unsigned flags);
 static int cmd_checkzone(int argc, char *argv[], unsigned flags);
 static int cmd_memstats(int argc, char *argv[], unsigned flags);
@@ -85,6 +86,7 @@ knot_cmd_t knot_cmd_tbl[] = {
 	{&cmd_flush,      0, "flush",      "",       "\t\tFlush journal and update zone files."},
 	{&cmd_status,     0, "status",     "",       "\tCheck if server is running."},
 	{&cmd_zonestatus, 0, "zonestatus", "",       "\tShow status of configured zones."},
+	{&cmd_stats,      0, "stats",      "",       "\t\tShow query statistics."},
 	{&cmd_checkconf,  1, "checkconf",  "",       "\tCheck current server configuration."},
 	{&cmd_checkzone,  1, "checkzone",  "[zone]", "Check zone (all if not specified)."},
 	{&cmd_memstats,   1, "memstats",   "[zone]", "Estimate memory use for zone (all if not specified)."},
@@ -637,6 +639,15 @@ static int cmd_zonestatus(int argc, char *argv[], unsigned flags)
 	return cmd_remote("zonestatus", KNOT_RRTYPE_TXT, 0, NULL);
 }
 
+static int cmd_stats(int argc, char *argv[], unsigned flags)
+{
+	UNUSED(argc);
+	UNUSED(argv);
+	UNUSED(flags);
+
+	return cmd_remote("stats", KNOT_RRTYPE_TXT, 0, NULL);
+}
+
 static int cmd_signzone(int argc, char *argv[], unsigned flags)
 {
 	return cmd_remote("signzone", KNOT_RRTYPE_NS, argc, argv);
@@ -65,6 +65,7 @@ static int remote_c_reload(server_t *s, remote_cmdargs_t* a);
 static int remote_c_refresh(server_t *s, remote_cmdargs_t* a);
 static int remote_c_status(server_t *s, remote_cmdargs_t* a);
 static int remote_c_zonestatus(server_t *s, remote_cmdargs_t* a);
+static int remote_c_stats(server_t *s, remote_cmdargs_t* a);
 static int remote_c_flush(server_t *s, remote_cmdargs_t* a);
 static int remote_c_signzone(server_t *s, remote_cmdargs_t* a);
 
@@ -75,6 +76,7 @@ struct remote_cmd_t remote_cmd_tbl[] = {
 	{ "refresh",   &remote_c_refresh },
 	{ "status",    &remote_c_status },
 	{ "zonestatus",&remote_c_zonestatus },
+	{ "stats",     &remote_c_stats },
 	{ "flush",     &remote_c_flush },
 	{ "signzone",  &remote_c_signzone },
 	{ NULL,        NULL }
@@ -247,7 +249,9 @@ static int remote_c_zonestatus(server_t *s, remote_cmdargs_t* a)
 
 		/* Evalute zone type. */
 		const char *state = NULL;
-		if (serial == 0)  {
+		if (zone->flags & ZONE_LAZY) {
+			state = "lazy";
+		} else if (serial == 0)  {
 			state = "bootstrap";
 		} else if (zone_master(zone) != NULL) {
 			state = "xfer";
@@ -316,6 +320,28 @@ static int remote_c_zonestatus(server_t *s, remote_cmdargs_t* a)
 	return ret;
 }
 
+/*!
+ * \brief Remote command 'stats' handler.
+ *
+ * QNAME: stats
+ * DATA: NONE
+ */
+static int remote_c_stats(server_t *s, remote_cmdargs_t* a)
+{
+	dbg_server("remote: %s\n", __func__);
+
+	/* Output of many zones may not fit, see 'stats-file' for full dump. */
+	const bool truncate = true;
+	int ret = server_stats(s, a->resp, sizeof(a->resp), truncate);
+	if (ret < 0) {
+		a->rlen = 0;
+		return ret;
+	}
+
+	a->rlen = ret;
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Remote command 'refresh' handler.
  *
@@ -16,12 +16,14 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "common/debug.h"
 #include "knot/dnssec/nsec-chain.h"
 #include "knot/dnssec/zone-sign.h"
 #include "libknot/dnssec/rrset-sign.h"
 #include "knot/dnssec/zone-nsec.h"
+#include "libknot/rdata/nsec.h"
 
 /* - NSEC chain construction ------------------------------------------------ */
 
@@ -29,17 +31,17 @@
  * \brief Create NSEC RR set.
  *
  * \param from       Node that should contain the new RRSet
- * \param to         Node that should be pointed to from 'from'
+ * \param next       Owner of the node that should be pointed to from 'from'
  * \param ttl        Record TTL (SOA's minimum TTL).
  *
  * \return NSEC RR set, NULL on error.
  */
 static knot_rrset_t *create_nsec_rrset(const zone_node_t *from,
-                                       const zone_node_t *to,
+                                       const knot_dname_t *next,
                                        uint32_t ttl)
 {
 	assert(from);
-	assert(to);
+	assert(next);
 	knot_rrset_t *rrset = knot_rrset_new(from->owner, KNOT_RRTYPE_NSEC,
 					     KNOT_CLASS_IN, NULL);
 	if (!rrset) {
@@ -56,13 +58,12 @@ static knot_rrset_t *create_nsec_rrset(const zone_node_t *from,
 	}
 
 	// Create RDATA
-	assert(to->owner);
-	size_t next_owner_size = knot_dname_size(to->owner);
+	size_t next_owner_size = knot_dname_size(next);
 	size_t rdata_size = next_owner_size + bitmap_size(&rr_types);
 	uint8_t rdata[rdata_size];
 
 	// Fill RDATA
-	memcpy(rdata, to->owner, next_owner_size);
+	memcpy(rdata, next, next_owner_size);
 	bitmap_write(&rr_types, rdata + next_owner_size);
 
 	int ret = knot_rrset_add_rdata(rrset, rdata, rdata_size, ttl, NULL);
@@ -74,6 +75,51 @@ static knot_rrset_t *create_nsec_rrset(const zone_node_t *from,
 	return rrset;
 }
 
+/*!
+ * \brief Put NSEC pointing to the given name into the node, if it differs.
+ *
+ * \param node       Node that should contain the new NSEC.
+ * \param next       Owner the new NSEC should point to.
+ * \param ttl        Record TTL.
+ * \param changeset  Changeset for the NSEC changes.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+static int replace_nsec(zone_node_t *node, const knot_dname_t *next,
+                        uint32_t ttl, knot_changeset_t *changeset)
+{
+	// create new NSEC
+	knot_rrset_t *new_nsec = create_nsec_rrset(node, next, ttl);
+	if (!new_nsec) {
+		dbg_dnssec_detail("Failed to create new NSEC.\n");
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t old_nsec = node_rrset(node, KNOT_RRTYPE_NSEC);
+	if (!knot_rrset_empty(&old_nsec)) {
+		if (knot_rrset_equal(new_nsec, &old_nsec,
+		                     KNOT_RRSET_COMPARE_WHOLE)) {
+			// current NSEC is valid, do nothing
+			dbg_dnssec_detail("NSECs equal.\n");
+			knot_rrset_free(&new_nsec, NULL);
+			return KNOT_EOK;
+		}
+
+		dbg_dnssec_detail("NSECs not equal, replacing.\n");
+		// Mark the node so that we do not sign this NSEC
+		node->flags |= NODE_FLAGS_REMOVED_NSEC;
+		int ret = knot_nsec_changeset_remove(node, changeset);
+		if (ret != KNOT_EOK) {
+			knot_rrset_free(&new_nsec, NULL);
+			return ret;
+		}
+	}
+
+	dbg_dnssec_detail("Adding new NSEC to changeset.\n");
+	// Add new NSEC to the changeset (no matter if old was removed)
+	return knot_changeset_add_rrset(changeset, new_nsec, KNOT_CHANGESET_ADD);
+}
+
 /*!
  * \brief Connect two nodes by adding a NSEC RR into the first node.
  *
@@ -113,37 +159,7 @@ static int connect_nsec_nodes(zone_node_t *a, zone_node_t *b,
 		return NSEC_NODE_SKIP;
 	}
 
-	// create new NSEC
-	knot_rrset_t *new_nsec = create_nsec_rrset(a, b, data->ttl);
-	if (!new_nsec) {
-		dbg_dnssec_detail("Failed to create new NSEC.\n");
-		return KNOT_ENOMEM;
-	}
-
-	knot_rrset_t old_nsec = node_rrset(a, KNOT_RRTYPE_NSEC);
-	if (!knot_rrset_empty(&old_nsec)) {
-		if (knot_rrset_equal(new_nsec, &old_nsec,
-		                     KNOT_RRSET_COMPARE_WHOLE)) {
-			// current NSEC is valid, do nothing
-			dbg_dnssec_detail("NSECs equal.\n");
-			knot_rrset_free(&new_nsec, NULL);
-			return KNOT_EOK;
-		}
-
-		dbg_dnssec_detail("NSECs not equal, replacing.\n");
-		// Mark the node so that we do not sign this NSEC
-		a->flags |= NODE_FLAGS_REMOVED_NSEC;
-		ret = knot_nsec_changeset_remove(a, data->changeset);
-		if (ret != KNOT_EOK) {
-			knot_rrset_free(&new_nsec, NULL);
-			return ret;
-		}
-	}
-
-	dbg_dnssec_detail("Adding new NSEC to changeset.\n");
-	// Add new NSEC to the changeset (no matter if old was removed)
-	return knot_changeset_add_rrset(data->changeset, new_nsec,
-	                                KNOT_CHANGESET_ADD);
+	return replace_nsec(a, b->owner, data->ttl, data->changeset);
 }
 
 /* - API - iterations ------------------------------------------------------- */
@@ -159,26 +175,26 @@ int knot_nsec_chain_iterate_create(knot_zone_tree_t *nodes,
 	assert(callback);
 
 	bool sorted = true;
-	hattrie_iter_t *it = hattrie_iter_begin(nodes, sorted);
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(nodes, sorted);
 
 	if (!it) {
 		return KNOT_ENOMEM;
 	}
 
-	if (hattrie_iter_finished(it)) {
-		hattrie_iter_free(it);
+	if (knot_zone_tree_it_finished(it)) {
+		knot_zone_tree_it_free(it);
 		return KNOT_EINVAL;
 	}
 
-	zone_node_t *first = (zone_node_t *)*hattrie_iter_val(it);
+	zone_node_t *first = knot_zone_tree_it_val(it);
 	zone_node_t *previous = first;
 	zone_node_t *current = first;
 
-	hattrie_iter_next(it);
+	knot_zone_tree_it_next(it);
 
 	int result = KNOT_EOK;
-	while (!hattrie_iter_finished(it)) {
-		current = (zone_node_t *)*hattrie_iter_val(it);
+	while (!knot_zone_tree_it_finished(it)) {
+		current = knot_zone_tree_it_val(it);
 
 		result = callback(previous, current, data);
 		if (result == NSEC_NODE_SKIP) {
@@ -187,18 +203,494 @@ int knot_nsec_chain_iterate_create(knot_zone_tree_t *nodes,
 		} else if (result == KNOT_EOK) {
 			previous = current;
 		} else {
-			hattrie_iter_free(it);
+			knot_zone_tree_it_free(it);
 			return result;
 		}
-		hattrie_iter_next(it);
+		knot_zone_tree_it_next(it);
 	}
 
-	hattrie_iter_free(it);
+	knot_zone_tree_it_free(it);
 
 	return result == NSEC_NODE_SKIP ? callback(previous, first, data) :
 	                 callback(current, first, data);
 }
 
+/* - API - incremental chain fix ------------------------------------------- */
+
+/*! \brief Cache state of the walk through the current chain. */
+enum {
+	FIX_UNKNOWN = 0,
+	FIX_BUSY,
+	FIX_DONE
+};
+
+/*! \brief No element index. */
+#define FIX_NONE SIZE_MAX
+
+static int change_cmp(const void *a, const void *b)
+{
+	const nsec_chain_change_t *x = a, *y = b;
+	return knot_dname_cmp(x->owner, y->owner);
+}
+
+/*!
+ * \brief Find index of the affected element, FIX_NONE if not affected.
+ */
+static size_t fix_find(const nsec_chain_fix_t *fix, const knot_dname_t *owner)
+{
+	nsec_chain_change_t key = { .owner = (knot_dname_t *)owner };
+	nsec_chain_change_t *found = bsearch(&key, fix->changes, fix->count,
+	                                     sizeof(nsec_chain_change_t),
+	                                     change_cmp);
+	return found ? (size_t)(found - fix->changes) : FIX_NONE;
+}
+
+/*!
+ * \brief Index of the first affected element following the name.
+ */
+static size_t fix_position(const nsec_chain_fix_t *fix, const knot_dname_t *name)
+{
+	size_t lo = 0, hi = fix->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (knot_dname_cmp(fix->changes[mid].owner, name) <= 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static const knot_dname_t *fix_owner(const nsec_chain_fix_t *fix, size_t i)
+{
+	return i == FIX_NONE ? NULL : fix->changes[i].owner;
+}
+
+/*!
+ * \brief Keep name returned by the callback until the fix is freed.
+ */
+static int fix_keep(nsec_chain_fix_t *fix, knot_dname_t *name)
+{
+	if (fix->names_count == fix->names_size) {
+		size_t size = fix->names_size ? 2 * fix->names_size : 16;
+		knot_dname_t **names = realloc(fix->names,
+		                               size * sizeof(knot_dname_t *));
+		if (names == NULL) {
+			knot_dname_free(&name, NULL);
+			return KNOT_ENOMEM;
+		}
+		fix->names = names;
+		fix->names_size = size;
+	}
+
+	fix->names[fix->names_count++] = name;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Nearest element of the current chain before the name.
+ */
+static int fix_prev(nsec_chain_fix_t *fix, const knot_dname_t *name,
+                    const knot_dname_t **prev)
+{
+	knot_dname_t *out = NULL;
+	int ret = fix->ops.prev(name, &out, fix->ops.data);
+	if (ret == KNOT_EOK) {
+		ret = fix_keep(fix, out);
+	}
+
+	*prev = ret == KNOT_EOK ? out : NULL;
+	return ret;
+}
+
+/*!
+ * \brief Successor of the current chain element.
+ */
+static int fix_next(nsec_chain_fix_t *fix, const knot_dname_t *owner,
+                    const knot_dname_t **next)
+{
+	knot_dname_t *out = NULL;
+	int ret = fix->ops.next(owner, &out, fix->ops.data);
+	if (ret == KNOT_EOK) {
+		ret = fix_keep(fix, out);
+	}
+
+	*next = ret == KNOT_EOK ? out : NULL;
+	return ret;
+}
+
+/*!
+ * \brief Find nearest unaffected element of the current chain around the
+ *        affected element.
+ *
+ * The walk follows the current chain through affected elements, results are
+ * cached in the visited elements. NULL is returned if all elements of the
+ * current chain are affected.
+ */
+static int fix_walk(nsec_chain_fix_t *fix, size_t i, bool forward,
+                    const knot_dname_t **out)
+{
+	size_t visited = 0;
+	size_t cur = i;
+	const knot_dname_t *result = NULL;
+	int ret = KNOT_EOK;
+
+	while (true) {
+		nsec_chain_change_t *change = &fix->changes[cur];
+		uint8_t *state = forward ? &change->next_state : &change->prev_state;
+		if (*state == FIX_DONE) {
+			result = forward ? change->alive_next : change->alive_prev;
+			break;
+		}
+		if (*state == FIX_BUSY) {
+			// Went around the whole chain
+			break;
+		}
+
+		*state = FIX_BUSY;
+		fix->path[visited++] = cur;
+
+		const knot_dname_t *name = NULL;
+		if (!forward) {
+			ret = fix_prev(fix, change->owner, &name);
+		} else if (change->in_old) {
+			ret = fix_next(fix, change->owner, &name);
+		} else {
+			// Successor of the nearest element before the name
+			ret = fix_prev(fix, change->owner, &name);
+			if (ret == KNOT_EOK) {
+				ret = fix_next(fix, name, &name);
+			}
+		}
+		if (ret != KNOT_EOK) {
+			break;
+		}
+
+		cur = fix_find(fix, name);
+		if (cur == FIX_NONE) {
+			result = name;
+			break;
+		}
+	}
+
+	for (size_t v = 0; v < visited; ++v) {
+		nsec_chain_change_t *change = &fix->changes[fix->path[v]];
+		if (forward) {
+			change->next_state = FIX_DONE;
+			change->alive_next = result;
+		} else {
+			change->prev_state = FIX_DONE;
+			change->alive_prev = result;
+		}
+	}
+
+	*out = result;
+	return ret;
+}
+
+/*!
+ * \brief Check if the candidate 'a' follows 'from' closer than 'b' does.
+ *
+ * The chain is cyclic, name equal to 'from' is the farthest one.
+ */
+static bool closer_after(const knot_dname_t *from, const knot_dname_t *a,
+                         const knot_dname_t *b)
+{
+	if (a == NULL || b == NULL) {
+		return b == NULL;
+	}
+
+	bool a_wraps = knot_dname_cmp(a, from) <= 0;
+	bool b_wraps = knot_dname_cmp(b, from) <= 0;
+	if (a_wraps != b_wraps) {
+		return b_wraps;
+	}
+
+	return knot_dname_cmp(a, b) < 0;
+}
+
+/*!
+ * \brief Check if the candidate 'a' precedes 'from' closer than 'b' does.
+ */
+static bool closer_before(const knot_dname_t *from, const knot_dname_t *a,
+                          const knot_dname_t *b)
+{
+	if (a == NULL || b == NULL) {
+		return b == NULL;
+	}
+
+	bool a_wraps = knot_dname_cmp(a, from) >= 0;
+	bool b_wraps = knot_dname_cmp(b, from) >= 0;
+	if (a_wraps != b_wraps) {
+		return b_wraps;
+	}
+
+	return knot_dname_cmp(a, b) > 0;
+}
+
+/*!
+ * \brief Add unchanged element whose successor may change.
+ *
+ * Duplicates are merged by fix_merge_extra().
+ */
+static int fix_add_extra(nsec_chain_fix_t *fix, const knot_dname_t *owner)
+{
+	if (fix->extra_count == fix->extra_size) {
+		size_t size = fix->extra_size ? 2 * fix->extra_size : 8;
+		nsec_chain_change_t *extra = realloc(fix->extra,
+		                                     size * sizeof(nsec_chain_change_t));
+		if (extra == NULL) {
+			return KNOT_ENOMEM;
+		}
+		fix->extra = extra;
+		fix->extra_size = size;
+	}
+
+	nsec_chain_change_t *change = &fix->extra[fix->extra_count++];
+	memset(change, 0, sizeof(nsec_chain_change_t));
+	change->owner = (knot_dname_t *)owner;
+	change->in_old = true;
+	change->in_new = true;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Sort unchanged elements added by fix_add_extra(), merge duplicates.
+ */
+static void fix_merge_extra(nsec_chain_fix_t *fix)
+{
+	if (fix->extra_count < 2) {
+		return;
+	}
+
+	qsort(fix->extra, fix->extra_count, sizeof(nsec_chain_change_t),
+	      change_cmp);
+
+	size_t count = 1;
+	for (size_t i = 1; i < fix->extra_count; ++i) {
+		if (!knot_dname_is_equal(fix->extra[count - 1].owner,
+		                         fix->extra[i].owner)) {
+			fix->extra[count++] = fix->extra[i];
+		}
+	}
+	fix->extra_count = count;
+}
+
+/*!
+ * \brief Sort affected elements, merge duplicates and build the indices of
+ *        nearest elements of the updated chain.
+ */
+static int fix_prepare(nsec_chain_fix_t *fix)
+{
+	qsort(fix->changes, fix->count, sizeof(nsec_chain_change_t), change_cmp);
+
+	size_t count = 0;
+	for (size_t i = 0; i < fix->count; ++i) {
+		nsec_chain_change_t *change = &fix->changes[i];
+		if (count > 0 &&
+		    knot_dname_is_equal(fix->changes[count - 1].owner, change->owner)) {
+			knot_dname_free(&change->owner, NULL);
+			continue;
+		}
+		fix->changes[count++] = *change;
+	}
+	fix->count = count;
+
+	fix->next_new = malloc((count + 1) * sizeof(size_t));
+	fix->prev_new = malloc((count + 1) * sizeof(size_t));
+	fix->path = malloc(count * sizeof(size_t));
+	if (fix->next_new == NULL || fix->prev_new == NULL || fix->path == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	// next_new[k]: first updated element at or after position k
+	size_t first = FIX_NONE;
+	for (size_t i = count; i > 0; --i) {
+		if (fix->changes[i - 1].in_new) {
+			first = i - 1;
+		}
+	}
+	fix->next_new[count] = first;
+	for (size_t i = count; i > 0; --i) {
+		fix->next_new[i - 1] = fix->changes[i - 1].in_new ? i - 1 :
+		                       fix->next_new[i];
+	}
+
+	// prev_new[k]: last updated element before position k
+	size_t last = FIX_NONE;
+	for (size_t i = 0; i < count; ++i) {
+		if (fix->changes[i].in_new) {
+			last = i;
+		}
+	}
+	fix->prev_new[0] = last;
+	for (size_t i = 1; i <= count; ++i) {
+		fix->prev_new[i] = fix->changes[i - 1].in_new ? i - 1 :
+		                   fix->prev_new[i - 1];
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Successor of the unchanged element in the updated chain.
+ */
+static int fix_extra_next(nsec_chain_fix_t *fix, nsec_chain_change_t *extra,
+                          bool *changed)
+{
+	const knot_dname_t *old_next = NULL;
+	int ret = fix_next(fix, extra->owner, &old_next);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	const knot_dname_t *alive = old_next;
+	size_t found = fix_find(fix, old_next);
+	if (found != FIX_NONE) {
+		ret = fix_walk(fix, found, true, &alive);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	size_t pos = fix_position(fix, extra->owner);
+	const knot_dname_t *updated = fix_owner(fix, fix->next_new[pos]);
+	extra->next = closer_after(extra->owner, alive, updated) ? alive : updated;
+	*changed = !knot_dname_is_equal(extra->next, old_next);
+
+	return KNOT_EOK;
+}
+
+void knot_nsec_chain_fix_init(nsec_chain_fix_t *fix, const nsec_chain_ops_t *ops)
+{
+	assert(fix);
+	assert(ops);
+
+	memset(fix, 0, sizeof(nsec_chain_fix_t));
+	fix->ops = *ops;
+}
+
+int knot_nsec_chain_fix_add(nsec_chain_fix_t *fix, knot_dname_t *owner,
+                            zone_node_t *node, bool in_old, bool in_new)
+{
+	if (fix == NULL || owner == NULL) {
+		knot_dname_free(&owner, NULL);
+		return KNOT_EINVAL;
+	}
+
+	if (fix->count == fix->size) {
+		size_t size = fix->size ? 2 * fix->size : 16;
+		nsec_chain_change_t *changes = realloc(fix->changes,
+		                                       size * sizeof(nsec_chain_change_t));
+		if (changes == NULL) {
+			knot_dname_free(&owner, NULL);
+			return KNOT_ENOMEM;
+		}
+		fix->changes = changes;
+		fix->size = size;
+	}
+
+	nsec_chain_change_t *change = &fix->changes[fix->count++];
+	memset(change, 0, sizeof(nsec_chain_change_t));
+	change->owner = owner;
+	change->node = node;
+	change->in_old = in_old;
+	change->in_new = in_new;
+
+	return KNOT_EOK;
+}
+
+int knot_nsec_chain_fix(nsec_chain_fix_t *fix)
+{
+	if (fix == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (fix->count == 0) {
+		return KNOT_EOK;
+	}
+
+	int ret = fix_prepare(fix);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	for (size_t i = 0; i < fix->count; ++i) {
+		nsec_chain_change_t *change = &fix->changes[i];
+
+		// Successor of the updated chain element
+		if (change->in_new) {
+			const knot_dname_t *alive = NULL;
+			ret = fix_walk(fix, i, true, &alive);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			const knot_dname_t *updated = fix_owner(fix, fix->next_new[i + 1]);
+			change->next = closer_after(change->owner, alive, updated) ?
+			               alive : updated;
+		}
+
+		// Predecessor of the added or removed element changes its successor
+		if (change->in_old == change->in_new) {
+			continue;
+		}
+
+		const knot_dname_t *alive = NULL;
+		ret = fix_walk(fix, i, false, &alive);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		const knot_dname_t *updated = fix_owner(fix, fix->prev_new[i]);
+		if (closer_before(change->owner, alive, updated) && alive != NULL) {
+			ret = fix_add_extra(fix, alive);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	// Keep sorted unchanged elements whose successor changes
+	fix_merge_extra(fix);
+	size_t count = 0;
+	for (size_t i = 0; i < fix->extra_count; ++i) {
+		bool changed = false;
+		ret = fix_extra_next(fix, &fix->extra[i], &changed);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		if (changed) {
+			fix->extra[count++] = fix->extra[i];
+		}
+	}
+	fix->extra_count = count;
+
+	return KNOT_EOK;
+}
+
+void knot_nsec_chain_fix_free(nsec_chain_fix_t *fix)
+{
+	if (fix == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < fix->count; ++i) {
+		knot_dname_free(&fix->changes[i].owner, NULL);
+	}
+	for (size_t i = 0; i < fix->names_count; ++i) {
+		knot_dname_free(&fix->names[i], NULL);
+	}
+
+	free(fix->changes);
+	free(fix->extra);
+	free(fix->names);
+	free(fix->next_new);
+	free(fix->prev_new);
+	free(fix->path);
+	memset(fix, 0, sizeof(nsec_chain_fix_t));
+}
+
 /* - API - utility functions ------------------------------------------------ */
 
 /*!
@@ -299,3 +791,174 @@ int knot_nsec_create_chain(const knot_zone_contents_t *zone, uint32_t ttl,
 	return knot_nsec_chain_iterate_create(zone->nodes,
 	                                      connect_nsec_nodes, &data);
 }
+
+/* - API - Chain fix -------------------------------------------------------- */
+
+/*!
+ * \brief Get NSEC chain element before the name, see nsec_chain_ops_t.
+ */
+static int nsec_prev(const knot_dname_t *name, knot_dname_t **prev, void *data)
+{
+	const knot_zone_contents_t *zone = data;
+
+	zone_node_t *found = NULL, *node = NULL;
+	int ret = knot_zone_tree_get_less_or_equal(zone->nodes, name,
+	                                           &found, &node);
+	if (ret < 0 || node == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	// Skip nodes without NSEC (non-authoritative, empty non-terminals)
+	const zone_node_t *start = node;
+	while (!node_rrtype_exists(node, KNOT_RRTYPE_NSEC)) {
+		node = node->prev;
+		if (node == NULL || node == start) {
+			return KNOT_ENOENT;
+		}
+	}
+
+	*prev = knot_dname_copy(node->owner, NULL);
+	return *prev ? KNOT_EOK : KNOT_ENOMEM;
+}
+
+/*!
+ * \brief Get successor of the NSEC chain element, see nsec_chain_ops_t.
+ */
+static int nsec_next(const knot_dname_t *owner, knot_dname_t **next, void *data)
+{
+	const knot_zone_contents_t *zone = data;
+
+	zone_node_t *node = NULL;
+	knot_zone_tree_get(zone->nodes, owner, &node);
+	const knot_rdataset_t *nsec = node ? node_rdataset(node, KNOT_RRTYPE_NSEC) :
+	                                     NULL;
+	if (nsec == NULL || nsec->rr_count == 0) {
+		return KNOT_ENOENT;
+	}
+
+	knot_dname_t *name = knot_dname_copy(knot_nsec_next(nsec), NULL);
+	if (name == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_dname_to_lower(name);
+
+	// The chain must be consistent
+	zone_node_t *target = NULL;
+	knot_zone_tree_get(zone->nodes, name, &target);
+	if (target == NULL || !node_rrtype_exists(target, KNOT_RRTYPE_NSEC)) {
+		knot_dname_free(&name, NULL);
+		return KNOT_ENOENT;
+	}
+
+	*next = name;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Check if the node should be covered by NSEC chain.
+ */
+static bool nsec_covers(const zone_node_t *node)
+{
+	if (node->rrset_count == 0 || node->flags & NODE_FLAGS_NONAUTH) {
+		return false;
+	}
+
+	return !(node_rrtype_exists(node, KNOT_RRTYPE_NSEC) &&
+	         knot_nsec_empty_nsec_and_rrsigs_in_node(node));
+}
+
+/*!
+ * \brief Add owners of the changed records as affected chain elements.
+ */
+static int nsec_add_changes(nsec_chain_fix_t *fix,
+                            const knot_zone_contents_t *zone,
+                            const list_t *rrs)
+{
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, *rrs) {
+		const knot_rrset_t *rrset = rr_node->rr;
+		zone_node_t *node = NULL;
+		knot_zone_tree_get(zone->nodes, rrset->owner, &node);
+
+		knot_dname_t *owner = knot_dname_copy(rrset->owner, NULL);
+		if (owner == NULL) {
+			return KNOT_ENOMEM;
+		}
+		knot_dname_to_lower(owner);
+
+		bool in_old = node && node_rrtype_exists(node, KNOT_RRTYPE_NSEC);
+		bool in_new = node && nsec_covers(node);
+		int ret = knot_nsec_chain_fix_add(fix, owner, node, in_old, in_new);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Put differences between the current and fixed chain into changeset.
+ */
+static int nsec_write_fix(const nsec_chain_fix_t *fix, const knot_zone_contents_t *zone,
+                          uint32_t ttl, knot_changeset_t *changeset)
+{
+	for (size_t i = 0; i < fix->count; ++i) {
+		const nsec_chain_change_t *change = &fix->changes[i];
+		int ret = KNOT_EOK;
+		if (change->in_new) {
+			ret = replace_nsec(change->node, change->next, ttl, changeset);
+		} else if (change->in_old) {
+			change->node->flags |= NODE_FLAGS_REMOVED_NSEC;
+			ret = knot_nsec_changeset_remove(change->node, changeset);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	for (size_t i = 0; i < fix->extra_count; ++i) {
+		const nsec_chain_change_t *extra = &fix->extra[i];
+		zone_node_t *node = NULL;
+		knot_zone_tree_get(zone->nodes, extra->owner, &node);
+		if (node == NULL) {
+			return KNOT_ENOENT;
+		}
+		int ret = replace_nsec(node, extra->next, ttl, changeset);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Fix NSEC chain after a change, add differences into a changeset.
+ */
+int knot_nsec_fix_chain(const knot_zone_contents_t *zone,
+                        const knot_changeset_t *in_ch, uint32_t ttl,
+                        knot_changeset_t *changeset)
+{
+	assert(zone);
+	assert(in_ch);
+	assert(changeset);
+
+	nsec_chain_ops_t ops = { nsec_prev, nsec_next, (void *)zone };
+	nsec_chain_fix_t fix;
+	knot_nsec_chain_fix_init(&fix, &ops);
+
+	int ret = nsec_add_changes(&fix, zone, &in_ch->remove);
+	if (ret == KNOT_EOK) {
+		ret = nsec_add_changes(&fix, zone, &in_ch->add);
+	}
+	if (ret == KNOT_EOK) {
+		ret = knot_nsec_chain_fix(&fix);
+	}
+	if (ret == KNOT_EOK) {
+		ret = nsec_write_fix(&fix, zone, ttl, changeset);
+	}
+
+	knot_nsec_chain_fix_free(&fix);
+	return ret;
+}
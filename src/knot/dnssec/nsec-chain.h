@@ -56,6 +56,53 @@ enum {
 typedef int (*chain_iterate_create_cb)(zone_node_t *, zone_node_t *,
                                        nsec_chain_iterate_data_t *);
 
+/*!
+ * \brief Chain element affected by a change, used for incremental chain fix.
+ */
+typedef struct {
+	knot_dname_t *owner;  // Owner of the NSEC(3) record
+	zone_node_t *node;    // Node the record covers, NULL if none
+	bool in_old;          // Element of the current chain
+	bool in_new;          // Element of the updated chain
+	const knot_dname_t *next; // Successor in the updated chain
+	const knot_dname_t *alive_prev; // Cached predecessor in the current chain
+	const knot_dname_t *alive_next; // Cached successor in the current chain
+	uint8_t prev_state;   // Cache state of the predecessor
+	uint8_t next_state;   // Cache state of the successor
+} nsec_chain_change_t;
+
+/*!
+ * \brief Access to the current chain for incremental chain fix.
+ *
+ * Both callbacks return a newly allocated name, the chain is cyclic.
+ */
+typedef struct {
+	/*! \brief Get nearest element of the current chain before the name. */
+	int (*prev)(const knot_dname_t *name, knot_dname_t **prev, void *data);
+	/*! \brief Get successor of the current chain element. */
+	int (*next)(const knot_dname_t *owner, knot_dname_t **next, void *data);
+	void *data;
+} nsec_chain_ops_t;
+
+/*!
+ * \brief Incremental chain fix context.
+ */
+typedef struct {
+	nsec_chain_ops_t ops;         // Current chain access
+	nsec_chain_change_t *changes; // Affected elements, sorted
+	size_t count;                 // Number of affected elements
+	size_t size;                  // Allocated size
+	nsec_chain_change_t *extra;   // Unchanged elements with new successor
+	size_t extra_count;           // Number of such elements
+	size_t extra_size;            // Allocated size
+	knot_dname_t **names;         // Names from the callbacks to be freed
+	size_t names_count;
+	size_t names_size;
+	size_t *next_new;             // Index of the nearest updated element after
+	size_t *prev_new;             // Index of the nearest updated element before
+	size_t *path;                 // Elements visited during chain walk
+} nsec_chain_fix_t;
+
 /*!
  * \brief Add all RR types from a node into the bitmap.
  */
@@ -87,6 +134,42 @@ int knot_nsec_chain_iterate_create(knot_zone_tree_t *nodes,
                                    chain_iterate_create_cb callback,
                                    nsec_chain_iterate_data_t *data);
 
+/*!
+ * \brief Initialize incremental chain fix.
+ */
+void knot_nsec_chain_fix_init(nsec_chain_fix_t *fix, const nsec_chain_ops_t *ops);
+
+/*!
+ * \brief Add element affected by the change.
+ *
+ * \param fix     Chain fix context.
+ * \param owner   Owner of the NSEC(3) record, the context takes ownership.
+ * \param node    Covered node.
+ * \param in_old  Owner is an element of the current chain.
+ * \param in_new  Owner is an element of the updated chain.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_nsec_chain_fix_add(nsec_chain_fix_t *fix, knot_dname_t *owner,
+                            zone_node_t *node, bool in_old, bool in_new);
+
+/*!
+ * \brief Compute successors of the affected elements in the updated chain.
+ *
+ * Fills the successor of each element of the updated chain in 'changes'
+ * and adds unchanged elements of the current chain, whose successor changes,
+ * into 'extra'. Only elements around the changes are visited.
+ *
+ * \return Error code, KNOT_EOK if successful, KNOT_ENOENT if the current
+ *         chain is inconsistent.
+ */
+int knot_nsec_chain_fix(nsec_chain_fix_t *fix);
+
+/*!
+ * \brief Free incremental chain fix context.
+ */
+void knot_nsec_chain_fix_free(nsec_chain_fix_t *fix);
+
 /*!
  * \brief Add entry for removed NSEC(3) and its RRSIG to the changeset.
  *
@@ -121,4 +204,22 @@ bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n);
 int knot_nsec_create_chain(const knot_zone_contents_t *zone, uint32_t ttl,
                            knot_changeset_t *changeset);
 
+/*!
+ * \brief Fix NSEC chain after a change, add differences into a changeset.
+ *
+ * Only nodes changed by the input changeset and their neighbours in the
+ * chain are visited.
+ *
+ * \param zone       Updated zone.
+ * \param in_ch      Changes applied to the zone.
+ * \param ttl        TTL for created NSEC records.
+ * \param changeset  Changeset the differences will be put into.
+ *
+ * \return Error code, KNOT_EOK if successful, KNOT_ENOENT if the current
+ *         chain can't be fixed.
+ */
+int knot_nsec_fix_chain(const knot_zone_contents_t *zone,
+                        const knot_changeset_t *in_ch, uint32_t ttl,
+                        knot_changeset_t *changeset);
+
 #endif // _KNOT_DNSSEC_NSEC_CHAIN_FIX_H_
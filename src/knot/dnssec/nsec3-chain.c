@@ -15,6 +15,8 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "common/base32hex.h"
 #include "knot/dnssec/nsec3-chain.h"
@@ -25,9 +27,17 @@
 #include "knot/dnssec/nsec-chain.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/dnssec/zone-nsec.h"
+#include "knot/server/dthreads.h"
 #include "libknot/dnssec/bitmap.h"
+#include "libknot/dnssec/crypto.h"
 #include "libknot/rdata/nsec3.h"
 
+/*! \brief Minimal number of nodes to hash NSEC3 owners in parallel. */
+#define NSEC3_PARALLEL_MIN 4096
+
+/*! \brief Number of nodes claimed by a hashing thread at once. */
+#define NSEC3_HASH_CHUNK 256
+
 /* - Forward declarations --------------------------------------------------- */
 
 static int create_nsec3_rrset(knot_rrset_t *rrset,
@@ -136,10 +146,10 @@ static int copy_signatures(const knot_zone_tree_t *from, knot_zone_tree_t *to)
 	assert(to);
 
 	bool sorted = false;
-	hattrie_iter_t *it = hattrie_iter_begin(from, sorted);
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(from, sorted);
 
-	for (/* NOP */; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
-		zone_node_t *node_from = (zone_node_t *)*hattrie_iter_val(it);
+	for (/* NOP */; !knot_zone_tree_it_finished(it); knot_zone_tree_it_next(it)) {
+		zone_node_t *node_from = knot_zone_tree_it_val(it);
 		zone_node_t *node_to = NULL;
 
 		knot_zone_tree_get(to, node_from->owner, &node_to);
@@ -153,12 +163,12 @@ static int copy_signatures(const knot_zone_tree_t *from, knot_zone_tree_t *to)
 
 		int ret = shallow_copy_signature(node_from, node_to);
 		if (ret != KNOT_EOK) {
-			hattrie_iter_free(it);
+			knot_zone_tree_it_free(it);
 			return ret;
 		}
 	}
 
-	hattrie_iter_free(it);
+	knot_zone_tree_it_free(it);
 	return KNOT_EOK;
 }
 
@@ -171,9 +181,9 @@ static void free_nsec3_tree(knot_zone_tree_t *nodes)
 	assert(nodes);
 
 	bool sorted = false;
-	hattrie_iter_t *it = hattrie_iter_begin(nodes, sorted);
-	for (/* NOP */; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
-		zone_node_t *node = (zone_node_t *)*hattrie_iter_val(it);
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(nodes, sorted);
+	for (/* NOP */; !knot_zone_tree_it_finished(it); knot_zone_tree_it_next(it)) {
+		zone_node_t *node = knot_zone_tree_it_val(it);
 		// newly allocated NSEC3 nodes
 		knot_rdataset_t *nsec3 = node_rdataset(node, KNOT_RRTYPE_NSEC3);
 		knot_rdataset_t *rrsig = node_rdataset(node, KNOT_RRTYPE_RRSIG);
@@ -182,7 +192,7 @@ static void free_nsec3_tree(knot_zone_tree_t *nodes)
 		node_free(&node);
 	}
 
-	hattrie_iter_free(it);
+	knot_zone_tree_it_free(it);
 	knot_zone_tree_free(&nodes);
 }
 
@@ -274,21 +284,17 @@ static int create_nsec3_rrset(knot_rrset_t *rrset,
  */
 static zone_node_t *create_nsec3_node(knot_dname_t *owner,
                                       const knot_nsec3_params_t *nsec3_params,
-                                      zone_node_t *apex_node,
                                       const bitmap_t *rr_types,
                                       uint32_t ttl)
 {
 	assert(owner);
 	assert(nsec3_params);
-	assert(apex_node);
 	assert(rr_types);
 
 	zone_node_t *new_node = node_new(owner);
 	if (!new_node) {
 		return NULL;
 	}
-	
-	node_set_parent(new_node, apex_node);
 
 	knot_rrset_t nsec3_rrset;
 	int ret = create_nsec3_rrset(&nsec3_rrset, owner, nsec3_params,
@@ -308,6 +314,21 @@ static zone_node_t *create_nsec3_node(knot_dname_t *owner,
 	return new_node;
 }
 
+/*!
+ * \brief Fill bitmap of types covered by NSEC3 for given regular node.
+ */
+static void nsec3_node_bitmap(bitmap_t *rr_types, const zone_node_t *node,
+                              const zone_node_t *apex)
+{
+	bitmap_add_node_rrsets(rr_types, node);
+	if (node->rrset_count > 0 && node_should_be_signed_nsec3(node)) {
+		bitmap_add_type(rr_types, KNOT_RRTYPE_RRSIG);
+	}
+	if (node == apex) {
+		bitmap_add_type(rr_types, KNOT_RRTYPE_DNSKEY);
+	}
+}
+
 /*!
  * \brief Create new NSEC3 node for given regular node.
  *
@@ -334,16 +355,10 @@ static zone_node_t *create_nsec3_node_for_node(zone_node_t *node,
 	}
 
 	bitmap_t rr_types = { 0 };
-	bitmap_add_node_rrsets(&rr_types, node);
-	if (node->rrset_count > 0 && node_should_be_signed_nsec3(node)) {
-		bitmap_add_type(&rr_types, KNOT_RRTYPE_RRSIG);
-	}
-	if (node == apex) {
-		bitmap_add_type(&rr_types, KNOT_RRTYPE_DNSKEY);
-	}
+	nsec3_node_bitmap(&rr_types, node, apex);
 
 	zone_node_t *nsec3_node;
-	nsec3_node = create_nsec3_node(nsec3_owner, params, apex, &rr_types, ttl);
+	nsec3_node = create_nsec3_node(nsec3_owner, params, &rr_types, ttl);
 
 	return nsec3_node;
 }
@@ -403,9 +418,105 @@ static int connect_nsec3_nodes(zone_node_t *a, zone_node_t *b,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Context for hashing of NSEC3 owners shared by the hashing threads.
+ */
+typedef struct {
+	const knot_zone_contents_t *zone;
+	uint32_t ttl;
+	zone_node_t **nodes;  /*!< Nodes to be covered by NSEC3. */
+	zone_node_t **nsec3;  /*!< Created NSEC3 nodes, same index as nodes. */
+	size_t count;
+	size_t next;          /*!< First node of the next unclaimed chunk. */
+} nsec3_hash_ctx_t;
+
+/*!
+ * \brief Create NSEC3 nodes for a range of collected nodes.
+ */
+static void nsec3_hash_range(nsec3_hash_ctx_t *ctx, size_t from, size_t to)
+{
+	for (size_t i = from; i < to; ++i) {
+		ctx->nsec3[i] = create_nsec3_node_for_node(ctx->nodes[i],
+		                                           ctx->zone->apex,
+		                                           &ctx->zone->nsec3_params,
+		                                           ctx->ttl);
+	}
+}
+
+static int nsec3_hash_thread(dthread_t *thread)
+{
+	nsec3_hash_ctx_t *ctx = thread->data;
+
+	for (;;) {
+		size_t from = __sync_fetch_and_add(&ctx->next, NSEC3_HASH_CHUNK);
+		if (from >= ctx->count) {
+			break;
+		}
+		nsec3_hash_range(ctx, from, MIN(from + NSEC3_HASH_CHUNK, ctx->count));
+	}
+
+	return KNOT_EOK;
+}
+
+static int nsec3_hash_destruct(dthread_t *thread)
+{
+	knot_crypto_cleanup_thread();
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Create NSEC3 nodes for all collected nodes.
+ *
+ * Large zones are hashed by a pool of threads, each one claiming chunks of
+ * nodes and writing into its own result slots.
+ */
+static void nsec3_hash_nodes(nsec3_hash_ctx_t *ctx)
+{
+	if (ctx->count >= NSEC3_PARALLEL_MIN) {
+		size_t chunks = (ctx->count + NSEC3_HASH_CHUNK - 1) / NSEC3_HASH_CHUNK;
+		size_t thread_count = MIN(chunks, dt_optimal_size());
+		dt_unit_t *unit = dt_create(thread_count, &nsec3_hash_thread,
+		                            &nsec3_hash_destruct, ctx);
+		if (unit != NULL) {
+			dt_start(unit);
+			dt_join(unit);
+			dt_delete(&unit);
+			return;
+		}
+	}
+
+	/* Small zone or no threads available. */
+	nsec3_hash_range(ctx, 0, ctx->count);
+}
+
+/*!
+ * \brief Compare NSEC3 owners, all of them have a single hash label
+ *        of equal length under the zone apex.
+ */
+static int nsec3_owner_cmp(const void *a, const void *b)
+{
+	const knot_dname_t *x = (*(const zone_node_t **)a)->owner;
+	const knot_dname_t *y = (*(const zone_node_t **)b)->owner;
+	assert(x[0] == y[0]);
+	return memcmp(x + 1, y + 1, x[0]);
+}
+
+/*!
+ * \brief Free NSEC3 node not inserted into a tree.
+ */
+static void free_nsec3_node(zone_node_t *node)
+{
+	knot_rdataset_clear(node_rdataset(node, KNOT_RRTYPE_NSEC3), NULL);
+	knot_rdataset_clear(node_rdataset(node, KNOT_RRTYPE_RRSIG), NULL);
+	node_free(&node);
+}
+
 /*!
  * \brief Create NSEC3 node for each regular node in the zone.
  *
+ * Nodes are collected and NSECs removed first, then the owners are hashed
+ * (in parallel for large zones) and the NSEC3 nodes are inserted in order.
+ *
  * \param zone         Zone.
  * \param ttl          TTL for the created NSEC records.
  * \param nsec3_nodes  Tree whereto new NSEC3 nodes will be added.
@@ -421,16 +532,29 @@ static int create_nsec3_nodes(const knot_zone_contents_t *zone, uint32_t ttl,
 	assert(nsec3_nodes);
 	assert(chgset);
 
-	const knot_nsec3_params_t *params = &zone->nsec3_params;
+	size_t weight = knot_zone_tree_weight(zone->nodes);
+	if (weight == 0) {
+		return KNOT_EOK;
+	}
 
-	assert(params);
+	nsec3_hash_ctx_t ctx = { 0 };
+	ctx.zone = zone;
+	ctx.ttl = ttl;
+	ctx.nodes = malloc(weight * sizeof(zone_node_t *));
+	ctx.nsec3 = calloc(weight, sizeof(zone_node_t *));
+	if (ctx.nodes == NULL || ctx.nsec3 == NULL) {
+		free(ctx.nodes);
+		free(ctx.nsec3);
+		return KNOT_ENOMEM;
+	}
 
 	int result = KNOT_EOK;
 
 	int sorted = false;
-	hattrie_iter_t *it = hattrie_iter_begin(zone->nodes, sorted);
-	while (!hattrie_iter_finished(it)) {
-		zone_node_t *node = (zone_node_t *)*hattrie_iter_val(it);
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(zone->nodes, sorted);
+	while (!knot_zone_tree_it_finished(it)) {
+		zone_node_t *node = knot_zone_tree_it_val(it);
+		knot_zone_tree_it_next(it);
 
 		/*!
 		 * Remove possible NSEC from the node. (Do not allow both NSEC
@@ -444,30 +568,48 @@ static int create_nsec3_nodes(const knot_zone_contents_t *zone, uint32_t ttl,
 			node->flags |= NODE_FLAGS_REMOVED_NSEC;
 		}
 		if (node->flags & NODE_FLAGS_NONAUTH || node->flags & NODE_FLAGS_EMPTY) {
-			hattrie_iter_next(it);
 			continue;
 		}
 
-		zone_node_t *nsec3_node;
-		nsec3_node = create_nsec3_node_for_node(node, zone->apex,
-		                                        params, ttl);
-		if (!nsec3_node) {
-			result = KNOT_ENOMEM;
-			break;
-		}
+		assert(ctx.count < weight);
+		ctx.nodes[ctx.count++] = node;
+	}
 
-		result = knot_zone_tree_insert(nsec3_nodes, nsec3_node);
-		if (result != KNOT_EOK) {
-			break;
+	knot_zone_tree_it_free(it);
+
+	if (result == KNOT_EOK) {
+		nsec3_hash_nodes(&ctx);
+		for (size_t i = 0; i < ctx.count; ++i) {
+			if (ctx.nsec3[i] == NULL) {
+				result = KNOT_ENOMEM;
+				break;
+			}
 		}
+	}
 
-		hattrie_iter_next(it);
+	/* Insert in canonical order, release what was not inserted. */
+	size_t inserted = 0;
+	if (result == KNOT_EOK) {
+		qsort(ctx.nsec3, ctx.count, sizeof(zone_node_t *), nsec3_owner_cmp);
+		for (; inserted < ctx.count; ++inserted) {
+			result = knot_zone_tree_insert(nsec3_nodes, ctx.nsec3[inserted]);
+			if (result != KNOT_EOK) {
+				break;
+			}
+			node_set_parent(ctx.nsec3[inserted], zone->apex);
+		}
+	}
+	for (size_t i = inserted; i < ctx.count; ++i) {
+		if (ctx.nsec3[i] != NULL) {
+			free_nsec3_node(ctx.nsec3[i]);
+		}
 	}
 
-	hattrie_iter_free(it);
+	free(ctx.nodes);
+	free(ctx.nsec3);
 
 	/* Rebuild index over nsec3 nodes. */
-	hattrie_build_index(nsec3_nodes);
+	knot_zone_tree_build_index(nsec3_nodes);
 
 	return result;
 }
@@ -630,3 +772,438 @@ int knot_nsec3_create_chain(const knot_zone_contents_t *zone, uint32_t ttl,
 
 	return result;
 }
+
+/* - NSEC3 chain fix -------------------------------------------------------- */
+
+/*!
+ * \brief Regular node affected by the change.
+ */
+typedef struct {
+	knot_dname_t *name;      // Node owner
+	zone_node_t *node;       // Node in the updated zone, NULL if removed
+	knot_dname_t *hashed;    // NSEC3 owner
+	bool in_old;             // Covered by the current chain
+	bool in_new;             // Covered by the updated chain
+} nsec3_affected_t;
+
+/*!
+ * \brief Affected nodes in canonical order.
+ */
+typedef struct {
+	nsec3_affected_t *nodes;
+	size_t count;
+	size_t size;
+} nsec3_affected_list_t;
+
+static int affected_cmp(const void *a, const void *b)
+{
+	const nsec3_affected_t *x = a, *y = b;
+	return knot_dname_cmp(x->name, y->name);
+}
+
+static int affected_add(nsec3_affected_list_t *list, const knot_dname_t *name)
+{
+	if (list->count == list->size) {
+		size_t size = list->size ? 2 * list->size : 16;
+		nsec3_affected_t *nodes = realloc(list->nodes,
+		                                  size * sizeof(nsec3_affected_t));
+		if (nodes == NULL) {
+			return KNOT_ENOMEM;
+		}
+		list->nodes = nodes;
+		list->size = size;
+	}
+
+	nsec3_affected_t *affected = &list->nodes[list->count];
+	memset(affected, 0, sizeof(nsec3_affected_t));
+	affected->name = knot_dname_copy(name, NULL);
+	if (affected->name == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_dname_to_lower(affected->name);
+	list->count += 1;
+
+	return KNOT_EOK;
+}
+
+static void affected_free(nsec3_affected_list_t *list)
+{
+	for (size_t i = 0; i < list->count; ++i) {
+		knot_dname_free(&list->nodes[i].name, NULL);
+		knot_dname_free(&list->nodes[i].hashed, NULL);
+	}
+	free(list->nodes);
+	memset(list, 0, sizeof(nsec3_affected_list_t));
+}
+
+/*!
+ * \brief Add owners of the changed records and their ancestors, whose
+ *        emptiness may have changed.
+ */
+static int affected_add_changes(nsec3_affected_list_t *list,
+                                const knot_zone_contents_t *zone,
+                                const list_t *rrs)
+{
+	const knot_dname_t *apex = zone->apex->owner;
+
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, *rrs) {
+		const knot_dname_t *name = rr_node->rr->owner;
+		while (*name != '\0') {
+			int ret = affected_add(list, name);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			if (knot_dname_is_equal(name, apex)) {
+				break;
+			}
+			name = knot_wire_next_label(name, NULL);
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Check if there is a node with other records than NSEC and RRSIG
+ *        under the given node.
+ *
+ * Descendants are visited backwards from the last one, usually the first
+ * visited node is not empty.
+ */
+static bool has_nonempty_descendant(const knot_zone_contents_t *zone,
+                                    const zone_node_t *node)
+{
+	zone_node_t *last = NULL;
+	knot_zone_tree_get_subtree_last(zone->nodes, node->owner, &last);
+
+	while (last != NULL && last != node &&
+	       knot_dname_is_sub(last->owner, node->owner)) {
+		if (!knot_nsec_empty_nsec_and_rrsigs_in_node(last)) {
+			return true;
+		}
+		last = last->prev;
+	}
+
+	return false;
+}
+
+/*!
+ * \brief Check if the node is covered by the updated chain.
+ *
+ * Emptiness follows nsec3_is_empty() used for full chain creation.
+ */
+static bool affected_covered(const knot_zone_contents_t *zone,
+                             const zone_node_t *node)
+{
+	if (node == NULL || node->flags & NODE_FLAGS_NONAUTH) {
+		return false;
+	}
+
+	if (!knot_nsec_empty_nsec_and_rrsigs_in_node(node)) {
+		return true;
+	}
+
+	return node->children > 0 && has_nonempty_descendant(zone, node);
+}
+
+/*!
+ * \brief Sort affected nodes, merge duplicates and resolve chain membership.
+ */
+static int affected_prepare(nsec3_affected_list_t *list,
+                            const knot_zone_contents_t *zone)
+{
+	if (list->count > 1) {
+		qsort(list->nodes, list->count, sizeof(nsec3_affected_t),
+		      affected_cmp);
+	}
+
+	size_t count = 0;
+	for (size_t i = 0; i < list->count; ++i) {
+		nsec3_affected_t *affected = &list->nodes[i];
+		if (count > 0 &&
+		    knot_dname_is_equal(list->nodes[count - 1].name, affected->name)) {
+			knot_dname_free(&affected->name, NULL);
+			continue;
+		}
+		list->nodes[count++] = *affected;
+	}
+	list->count = count;
+
+	for (size_t i = 0; i < list->count; ++i) {
+		nsec3_affected_t *affected = &list->nodes[i];
+		knot_zone_tree_get(zone->nodes, affected->name, &affected->node);
+		affected->in_new = affected_covered(zone, affected->node);
+
+		affected->hashed = knot_create_nsec3_owner(affected->name,
+		                                           zone->apex->owner,
+		                                           &zone->nsec3_params);
+		if (affected->hashed == NULL) {
+			return KNOT_ENOMEM;
+		}
+
+		zone_node_t *nsec3_node = NULL;
+		knot_zone_tree_get(zone->nsec3_nodes, affected->hashed, &nsec3_node);
+		affected->in_old = nsec3_node != NULL;
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Get NSEC3 chain element before the name, see nsec_chain_ops_t.
+ */
+static int nsec3_prev(const knot_dname_t *name, knot_dname_t **prev, void *data)
+{
+	const knot_zone_contents_t *zone = data;
+
+	zone_node_t *found = NULL, *node = NULL;
+	int ret = knot_zone_tree_get_less_or_equal(zone->nsec3_nodes, name,
+	                                           &found, &node);
+	if (ret < 0 || node == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	*prev = knot_dname_copy(node->owner, NULL);
+	return *prev ? KNOT_EOK : KNOT_ENOMEM;
+}
+
+/*!
+ * \brief Get successor of the NSEC3 chain element, see nsec_chain_ops_t.
+ */
+static int nsec3_next(const knot_dname_t *owner, knot_dname_t **next, void *data)
+{
+	const knot_zone_contents_t *zone = data;
+
+	zone_node_t *node = NULL;
+	knot_zone_tree_get(zone->nsec3_nodes, owner, &node);
+	if (node == NULL || !valid_nsec3_node(node)) {
+		return KNOT_ENOENT;
+	}
+
+	uint8_t *raw_hash = NULL;
+	uint8_t raw_length = 0;
+	const knot_rdataset_t *nsec3 = node_rdataset(node, KNOT_RRTYPE_NSEC3);
+	knot_nsec3_next_hashed(nsec3, 0, &raw_hash, &raw_length);
+	if (raw_hash == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	knot_dname_t *name = knot_nsec3_hash_to_dname(raw_hash, raw_length,
+	                                              zone->apex->owner);
+	if (name == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	// The chain must be consistent
+	zone_node_t *target = NULL;
+	knot_zone_tree_get(zone->nsec3_nodes, name, &target);
+	if (target == NULL) {
+		knot_dname_free(&name, NULL);
+		return KNOT_ENOENT;
+	}
+
+	*next = name;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Write raw hash from the NSEC3 owner into the 'next hash' field.
+ */
+static int nsec3_set_next(knot_rrset_t *rrset, const knot_dname_t *next)
+{
+	uint8_t *raw_hash = NULL;
+	uint8_t raw_length = 0;
+	knot_nsec3_next_hashed(&rrset->rrs, 0, &raw_hash, &raw_length);
+	if (raw_hash == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int32_t written = base32hex_decode(next + 1, *next, raw_hash, raw_length);
+	if (written != raw_length) {
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Replace the NSEC3 record, skip if equal to the current one.
+ */
+static int nsec3_replace(zone_node_t *old_node, knot_rrset_t *rrset,
+                         knot_changeset_t *changeset)
+{
+	if (old_node != NULL) {
+		knot_rrset_t old_rrset = node_rrset(old_node, KNOT_RRTYPE_NSEC3);
+		if (knot_rrset_equal(rrset, &old_rrset, KNOT_RRSET_COMPARE_WHOLE)) {
+			knot_rrset_free(&rrset, NULL);
+			return KNOT_EOK;
+		}
+
+		int ret = knot_nsec_changeset_remove(old_node, changeset);
+		if (ret != KNOT_EOK) {
+			knot_rrset_free(&rrset, NULL);
+			return ret;
+		}
+	}
+
+	return knot_changeset_add_rrset(changeset, rrset, KNOT_CHANGESET_ADD);
+}
+
+/*!
+ * \brief Create NSEC3 record for the regular node covered by updated chain.
+ */
+static knot_rrset_t *nsec3_for_change(const knot_zone_contents_t *zone,
+                                      const nsec_chain_change_t *change,
+                                      uint32_t ttl)
+{
+	knot_rrset_t *rrset = knot_rrset_new(change->owner, KNOT_RRTYPE_NSEC3,
+	                                     KNOT_CLASS_IN, NULL);
+	if (rrset == NULL) {
+		return NULL;
+	}
+
+	bitmap_t rr_types = { 0 };
+	nsec3_node_bitmap(&rr_types, change->node, zone->apex);
+
+	size_t rdata_size = nsec3_rdata_size(&zone->nsec3_params, &rr_types);
+	uint8_t rdata[rdata_size];
+	nsec3_fill_rdata(rdata, &zone->nsec3_params, &rr_types, NULL, ttl);
+
+	if (knot_rrset_add_rdata(rrset, rdata, rdata_size, ttl, NULL) != KNOT_EOK ||
+	    nsec3_set_next(rrset, change->next) != KNOT_EOK) {
+		knot_rrset_free(&rrset, NULL);
+		return NULL;
+	}
+
+	return rrset;
+}
+
+/*!
+ * \brief Put differences between the current and fixed chain into changeset.
+ */
+static int nsec3_write_fix(const nsec_chain_fix_t *fix,
+                           const knot_zone_contents_t *zone, uint32_t ttl,
+                           knot_changeset_t *changeset)
+{
+	for (size_t i = 0; i < fix->count; ++i) {
+		const nsec_chain_change_t *change = &fix->changes[i];
+		zone_node_t *old_node = NULL;
+		knot_zone_tree_get(zone->nsec3_nodes, change->owner, &old_node);
+
+		int ret = KNOT_EOK;
+		if (change->in_new) {
+			knot_rrset_t *rrset = nsec3_for_change(zone, change, ttl);
+			if (rrset == NULL) {
+				return KNOT_ENOMEM;
+			}
+			ret = nsec3_replace(old_node, rrset, changeset);
+		} else if (old_node != NULL) {
+			ret = knot_nsec_changeset_remove(old_node, changeset);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	for (size_t i = 0; i < fix->extra_count; ++i) {
+		const nsec_chain_change_t *extra = &fix->extra[i];
+		zone_node_t *old_node = NULL;
+		knot_zone_tree_get(zone->nsec3_nodes, extra->owner, &old_node);
+		if (old_node == NULL) {
+			return KNOT_ENOENT;
+		}
+
+		knot_rrset_t *rrset = node_create_rrset(old_node, KNOT_RRTYPE_NSEC3);
+		if (rrset == NULL) {
+			return KNOT_ENOMEM;
+		}
+		int ret = nsec3_set_next(rrset, extra->next);
+		if (ret != KNOT_EOK) {
+			knot_rrset_free(&rrset, NULL);
+			return ret;
+		}
+		ret = nsec3_replace(old_node, rrset, changeset);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Remove NSEC from the affected nodes, NSEC3 is used instead.
+ */
+static int nsec3_remove_nsecs(const nsec3_affected_list_t *list,
+                              knot_changeset_t *changeset)
+{
+	for (size_t i = 0; i < list->count; ++i) {
+		zone_node_t *node = list->nodes[i].node;
+		if (node == NULL || !node_rrtype_exists(node, KNOT_RRTYPE_NSEC)) {
+			continue;
+		}
+
+		int ret = knot_nsec_changeset_remove(node, changeset);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		node->flags |= NODE_FLAGS_REMOVED_NSEC;
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Fix NSEC3 chain after a change, add differences into a changeset.
+ */
+int knot_nsec3_fix_chain(const knot_zone_contents_t *zone,
+                         const knot_changeset_t *in_ch, uint32_t ttl,
+                         knot_changeset_t *changeset)
+{
+	assert(zone);
+	assert(in_ch);
+	assert(changeset);
+
+	if (knot_zone_tree_is_empty(zone->nsec3_nodes)) {
+		return KNOT_ENOENT;
+	}
+
+	nsec3_affected_list_t list = { 0 };
+	int ret = affected_add_changes(&list, zone, &in_ch->remove);
+	if (ret == KNOT_EOK) {
+		ret = affected_add_changes(&list, zone, &in_ch->add);
+	}
+	if (ret == KNOT_EOK) {
+		ret = affected_prepare(&list, zone);
+	}
+	if (ret != KNOT_EOK) {
+		affected_free(&list);
+		return ret;
+	}
+
+	nsec_chain_ops_t ops = { nsec3_prev, nsec3_next, (void *)zone };
+	nsec_chain_fix_t fix;
+	knot_nsec_chain_fix_init(&fix, &ops);
+
+	for (size_t i = 0; i < list.count && ret == KNOT_EOK; ++i) {
+		nsec3_affected_t *affected = &list.nodes[i];
+		ret = knot_nsec_chain_fix_add(&fix, affected->hashed,
+		                              affected->node, affected->in_old,
+		                              affected->in_new);
+		affected->hashed = NULL;
+	}
+	if (ret == KNOT_EOK) {
+		ret = knot_nsec_chain_fix(&fix);
+	}
+	if (ret == KNOT_EOK) {
+		ret = nsec3_remove_nsecs(&list, changeset);
+	}
+	if (ret == KNOT_EOK) {
+		ret = nsec3_write_fix(&fix, zone, ttl, changeset);
+	}
+
+	knot_nsec_chain_fix_free(&fix);
+	affected_free(&list);
+	return ret;
+}
@@ -42,4 +42,21 @@
 int knot_nsec3_create_chain(const knot_zone_contents_t *zone, uint32_t ttl,
                             knot_changeset_t *changeset);
 
+/*!
+ * \brief Fix NSEC3 chain after a change, add differences into a changeset.
+ *
+ * Only NSEC3 records of nodes changed by the input changeset, their ancestors
+ * and their predecessors in the chain are updated.
+ *
+ * \param zone       Updated zone.
+ * \param in_ch      Changes applied to the zone.
+ * \param ttl        TTL for new records.
+ * \param changeset  Changeset to store changes into.
+ *
+ * \return KNOT_E*, KNOT_ENOENT if the current chain can't be fixed.
+ */
+int knot_nsec3_fix_chain(const knot_zone_contents_t *zone,
+                         const knot_changeset_t *in_ch, uint32_t ttl,
+                         knot_changeset_t *changeset);
+
 #endif // _KNOT_DNSSEC_NSEC3_CHAIN_FIX_H_
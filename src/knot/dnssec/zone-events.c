@@ -65,7 +65,7 @@ static int init_dnssec_structs(const knot_zone_contents_t *zone,
 }
 
 static int zone_sign(knot_zone_contents_t *zone, conf_zone_t *zone_config,
-                     knot_changeset_t *out_ch, bool force,
+                     hattrie_t *trusted, knot_changeset_t *out_ch, bool force,
                      knot_update_serial_t soa_up, uint32_t *refresh_at,
                      uint32_t new_serial)
 {
@@ -104,7 +104,7 @@ static int zone_sign(knot_zone_contents_t *zone, conf_zone_t *zone_config,
 	                knot_changeset_is_empty(out_ch));
 
 	// add missing signatures
-	result = knot_zone_sign(zone, &zone_keys, &policy, out_ch,
+	result = knot_zone_sign(zone, &zone_keys, &policy, trusted, out_ch,
 	                        refresh_at);
 	if (result != KNOT_EOK) {
 		log_zone_error("%s Error while signing (%s).\n",
@@ -150,7 +150,7 @@ static int zone_sign(knot_zone_contents_t *zone, conf_zone_t *zone_config,
 }
 
 int knot_dnssec_zone_sign(knot_zone_contents_t *zone, conf_zone_t *zone_config,
-                          knot_changeset_t *out_ch,
+                          hattrie_t *trusted, knot_changeset_t *out_ch,
                           knot_update_serial_t soa_up, uint32_t *refresh_at,
                           uint32_t new_serial)
 {
@@ -158,7 +158,8 @@ int knot_dnssec_zone_sign(knot_zone_contents_t *zone, conf_zone_t *zone_config,
 		return KNOT_EINVAL;
 	}
 
-	return zone_sign(zone, zone_config, out_ch, false, soa_up, refresh_at, new_serial);
+	return zone_sign(zone, zone_config, trusted, out_ch, false, soa_up,
+	                 refresh_at, new_serial);
 }
 
 int knot_dnssec_zone_sign_force(knot_zone_contents_t *zone, conf_zone_t *zone_config,
@@ -169,8 +170,70 @@ int knot_dnssec_zone_sign_force(knot_zone_contents_t *zone, conf_zone_t *zone_co
 		return KNOT_EINVAL;
 	}
 
-	return zone_sign(zone, zone_config, out_ch, true, KNOT_SOA_SERIAL_UPDATE, refresh_at,
-	                 new_serial);
+	return zone_sign(zone, zone_config, NULL, out_ch, true,
+	                 KNOT_SOA_SERIAL_UPDATE, refresh_at, new_serial);
+}
+
+int knot_dnssec_zone_refresh(knot_zone_contents_t *zone, conf_zone_t *zone_config,
+                             knot_changeset_t *out_ch, uint32_t *refresh_at,
+                             uint32_t new_serial)
+{
+	if (zone == NULL || zone_config == NULL || out_ch == NULL ||
+	    refresh_at == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_zone_keys_t zone_keys = { '\0' };
+	knot_dnssec_policy_t policy = { '\0' };
+	int result = init_dnssec_structs(zone, zone_config, &zone_keys, &policy,
+	                                 KNOT_SOA_SERIAL_UPDATE, false);
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	// Key events change the set of signatures, sign completely
+	uint32_t key_event = knot_get_next_zone_key_event(&zone_keys);
+	if (key_event <= policy.now) {
+		knot_free_zone_keys(&zone_keys);
+		return zone_sign(zone, zone_config, NULL, out_ch, false,
+		                 KNOT_SOA_SERIAL_UPDATE, refresh_at, new_serial);
+	}
+
+	char *msgpref = sprintf_alloc("DNSSEC: Zone %s -", zone_config->name);
+	if (msgpref == NULL) {
+		knot_free_zone_keys(&zone_keys);
+		return KNOT_ENOMEM;
+	}
+
+	result = knot_zone_sign_refresh(zone, &zone_keys, &policy, out_ch,
+	                                refresh_at);
+	if (result != KNOT_EOK) {
+		log_zone_error("%s Error while refreshing signatures (%s).\n",
+		               msgpref, knot_strerror(result));
+		goto done;
+	}
+	*refresh_at = MIN(*refresh_at, key_event);
+
+	// SOA is signed with the serial update only
+	if (knot_changeset_is_empty(out_ch) &&
+	    !knot_zone_sign_soa_expired(zone, &zone_keys, &policy)) {
+		goto done;
+	}
+
+	knot_rrset_t soa = node_rrset(zone->apex, KNOT_RRTYPE_SOA);
+	knot_rrset_t rrsigs = node_rrset(zone->apex, KNOT_RRTYPE_RRSIG);
+	assert(!knot_rrset_empty(&soa));
+	result = knot_zone_sign_update_soa(&soa, &rrsigs, &zone_keys, &policy,
+	                                   new_serial, out_ch);
+	if (result != KNOT_EOK) {
+		log_zone_error("%s Cannot update SOA record (%s).\n",
+		               msgpref, knot_strerror(result));
+	}
+
+done:
+	knot_free_zone_keys(&zone_keys);
+	free(msgpref);
+	return result;
 }
 
 int knot_dnssec_sign_changeset(const knot_zone_contents_t *zone,
@@ -216,10 +279,10 @@ int knot_dnssec_sign_changeset(const knot_zone_contents_t *zone,
 		return ret;
 	}
 
-	// Create NSEC(3) chain
-	ret = knot_zone_create_nsec_chain(zone, out_ch, &zone_keys, &policy);
+	// Fix NSEC(3) chain around the changed nodes
+	ret = knot_zone_fix_nsec_chain(zone, in_ch, out_ch, &zone_keys, &policy);
 	if (ret != KNOT_EOK) {
-		log_zone_error("%s Failed to create NSEC(3) chain (%s)\n",
+		log_zone_error("%s Failed to fix NSEC(3) chain (%s)\n",
 		               msgpref, knot_strerror(ret));
 		knot_free_zone_keys(&zone_keys);
 		free(msgpref);
@@ -253,7 +316,9 @@ int knot_dnssec_sign_changeset(const knot_zone_contents_t *zone,
 	knot_free_zone_keys(&zone_keys);
 	free(msgpref);
 
-	*refresh_at = policy.refresh_before; // only new signatures are made
+	// only new signatures are made, the shortest lives sign_lifetime - jitter
+	*refresh_at = knot_dnssec_policy_refresh_time(&policy, policy.now +
+	              policy.sign_lifetime - policy.sign_jitter);
 
 	return KNOT_EOK;
 }
@@ -28,6 +28,7 @@
 #ifndef _KNOT_DNSSEC_ZONE_EVENTS_H_
 #define _KNOT_DNSSEC_ZONE_EVENTS_H_
 
+#include "common/hattrie/hat-trie.h"
 #include "knot/zone/zone.h"
 #include "knot/updates/changesets.h"
 #include "libknot/dnssec/policy.h"
@@ -37,6 +38,8 @@
  *
  * \param zone         Zone contents to be signed.
  * \param zone_config  Zone/DNSSEC configuration.
+ * \param trusted      RR sets with signatures reused from the previous zone
+ *                     version (may be NULL).
  * \param out_ch       New records will be added to this changeset.
  * \param soa_up       SOA serial update policy.
  * \param refresh_at   Signature refresh time of the oldest signature in zone.
@@ -45,7 +48,7 @@
  * \return Error code, KNOT_EOK if successful.
  */
 int knot_dnssec_zone_sign(knot_zone_contents_t *zone, conf_zone_t *zone_config,
-                          knot_changeset_t *out_ch,
+                          hattrie_t *trusted, knot_changeset_t *out_ch,
                           knot_update_serial_t soa_up, uint32_t *refresh_at,
                           uint32_t new_serial);
 
@@ -65,6 +68,24 @@ int knot_dnssec_zone_sign_force(knot_zone_contents_t *zone, conf_zone_t *zone_co
                                 knot_changeset_t *out_ch,
                                 uint32_t *refresh_at, uint32_t new_serial);
 
+/*!
+ * \brief DNSSEC refresh a slice of the oldest zone signatures, store new
+ *        records into changeset.
+ *
+ * The zone is signed completely if a key event is due.
+ *
+ * \param zone         Zone contents to be refreshed.
+ * \param zone_config  Zone/DNSSEC configuration.
+ * \param out_ch       New records will be added to this changeset.
+ * \param refresh_at   Time of the next refresh.
+ * \param new_serial   New SOA serial.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_dnssec_zone_refresh(knot_zone_contents_t *zone, conf_zone_t *zone_config,
+                             knot_changeset_t *out_ch,
+                             uint32_t *refresh_at, uint32_t new_serial);
+
 /*!
  * \brief Sign changeset created by DDNS or zone-diff.
  *
@@ -18,10 +18,15 @@
 #include <dirent.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "common/debug.h"
 #include "common/errcode.h"
 #include "common/mempattern.h"
+#include "common/hattrie/hat-trie.h"
 #include "libknot/common.h"
 #include "libknot/dname.h"
 #include "libknot/consts.h"
@@ -135,160 +140,558 @@ static bool was_removed(const knot_key_params_t *params)
 }
 
 /*!
- * \brief Load zone keys from a key directory.
+ * \brief Note the earliest change of key timing after given time.
+ */
+static void note_key_timing(const knot_key_params_t *params, uint32_t now,
+                            uint32_t *valid_until)
+{
+	assert(params);
+	assert(valid_until);
+
+	uint32_t timestamps[4] = {
+		params->time_publish,
+		params->time_activate,
+		params->time_inactive,
+		params->time_delete
+	};
+
+	for (int i = 0; i < 4; i++) {
+		uint32_t ts = timestamps[i];
+		if (ts != 0 && now <= ts && ts < *valid_until) {
+			*valid_until = ts;
+		}
+	}
+}
+
+/*!
+ * \brief Load key from a file and add it to zone keys if it can be used.
+ *
+ * \param path           Path to the private key file.
+ * \param zone_name      Domain name of the zone.
+ * \param nsec3_enabled  NSEC3 enabled for zone.
+ * \param msgpref        Log message prefix.
+ * \param keys           Zone keys to be extended.
+ * \param valid_until    Earliest key timing change, will be updated.
  *
- * \todo Maybe use dynamic list instead of fixed size array.
+ * \return Error code, KNOT_EOK if the key was added or skipped.
  */
-int knot_load_zone_keys(const char *keydir_name, const knot_dname_t *zone_name,
-                        bool nsec3_enabled, knot_zone_keys_t *keys)
+static int load_zone_key(const char *path, const knot_dname_t *zone_name,
+                         bool nsec3_enabled, const char *msgpref,
+                         knot_zone_keys_t *keys, uint32_t *valid_until)
 {
-	if (!keydir_name || !zone_name || !keys) {
-		return KNOT_EINVAL;
+	const char *filename = strrchr(path, '/');
+	filename = filename ? filename + 1 : path;
+
+	dbg_dnssec_detail("loading key '%s'\n", path);
+
+	knot_key_params_t params = { 0 };
+	int result = knot_load_key_params(path, &params);
+	if (result != KNOT_EOK) {
+		log_zone_warning("DNSSEC: Failed to load key %s: %s\n",
+		                  filename, knot_strerror(result));
+		knot_free_key_params(&params);
+		return KNOT_EOK;
 	}
 
-	DIR *keydir = opendir(keydir_name);
-	if (!keydir) {
-		return KNOT_DNSSEC_ENOKEYDIR;
+	if (!knot_dname_is_equal(zone_name, params.name)) {
+		dbg_dnssec_detail("skipping key, different zone name\n");
+		knot_free_key_params(&params);
+		return KNOT_EOK;
+	}
+
+	if (knot_get_key_type(&params) != KNOT_KEY_DNSSEC) {
+		dbg_dnssec_detail("skipping key, different purpose\n");
+		knot_free_key_params(&params);
+		return KNOT_EOK;
 	}
 
+	note_key_timing(&params, time(NULL), valid_until);
+
+	knot_zone_key_t key;
+	memset(&key, '\0', sizeof(key));
+	set_zone_key_flags(&params, &key);
+
+	dbg_dnssec_detail("next key event %" PRIu32 "\n", key.next_event);
+
+	if (!key.is_active && !key.is_public && !was_removed(&params)) {
+		log_zone_notice("%s Ignoring key %d (%s): "
+		                "%s, %s.\n", msgpref, params.keytag,
+		                filename,
+		                key.is_active ? "active" : "inactive",
+		                key.is_public ? "public" : "not-public");
+		knot_free_key_params(&params);
+		return KNOT_EOK;
+	}
+
+	if (!knot_dnssec_algorithm_is_zonesign(params.algorithm,
+	                                       nsec3_enabled)
+	) {
+		log_zone_notice("%s Ignoring key %d (%s): unknown "
+		                "algorithm or non-NSEC3 algorithm when"
+		                " NSEC3 is requested.\n", msgpref,
+		                params.keytag, filename);
+		knot_free_key_params(&params);
+		return KNOT_EOK;
+	}
+
+	if (knot_get_zone_key(keys, params.keytag) != NULL) {
+		log_zone_notice("%s Ignoring key %d (%s): duplicate "
+		                "keytag.\n", msgpref, params.keytag,
+		                filename);
+		knot_free_key_params(&params);
+		return KNOT_EOK;
+	}
+
+	result = knot_dnssec_key_from_params(&params, &key.dnssec_key);
+	if (result != KNOT_EOK) {
+		log_zone_error("%s Failed to process key %d (%s): %s\n",
+		               msgpref, params.keytag, filename,
+		               knot_strerror(result));
+		knot_free_key_params(&params);
+		return KNOT_EOK;
+	}
+
+	log_zone_info("%s - Key is valid, tag %d, file %s, %s, %s, %s\n",
+	              msgpref, params.keytag, filename,
+	              key.is_ksk ? "KSK" : "ZSK",
+	              key.is_active ? "active" : "inactive",
+	              key.is_public ? "public" : "not-public");
+
+	keys->keys[keys->count] = key;
+	keys->count += 1;
+
+	knot_free_key_params(&params);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Load zone keys from given private key files.
+ *
+ * \param files          Private key files.
+ * \param count          Number of files.
+ * \param zone_name      Domain name of the zone.
+ * \param nsec3_enabled  NSEC3 enabled for zone.
+ * \param keys           Structure with loaded keys.
+ * \param valid_until    Earliest key timing change.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+static int load_zone_keys(char * const *files, size_t count,
+                          const knot_dname_t *zone_name, bool nsec3_enabled,
+                          knot_zone_keys_t *keys, uint32_t *valid_until)
+{
 	char *zname = knot_dname_to_str(zone_name);
 	char *msgpref = sprintf_alloc("DNSSEC: Zone %s -", zname);
 	free(zname);
 	if (msgpref == NULL) {
-		closedir(keydir);
 		return KNOT_ENOMEM;
 	}
 
-	struct dirent entry_buf = { 0 };
-	struct dirent *entry = NULL;
-	while (keys->count < KNOT_MAX_ZONE_KEYS &&
-	       readdir_r(keydir, &entry_buf, &entry) == 0 &&
-	       entry != NULL) {
-
-		char *suffix = strrchr(entry->d_name, '.');
-		if (!suffix) {
-			continue;
+	*valid_until = UINT32_MAX;
+	for (size_t i = 0; i < count && keys->count < KNOT_MAX_ZONE_KEYS; i++) {
+		int result = load_zone_key(files[i], zone_name, nsec3_enabled,
+		                           msgpref, keys, valid_until);
+		if (result != KNOT_EOK) {
+			free(msgpref);
+			knot_free_zone_keys(keys);
+			return result;
 		}
+	}
 
-		if (strcmp(suffix, ".private") != 0) {
-			continue;
-		}
+	if (keys->count == 0) {
+		free(msgpref);
+		return KNOT_DNSSEC_ENOKEY;
+	} else if (keys->count == KNOT_MAX_ZONE_KEYS) {
+		log_zone_notice("%s - Reached maximum count of keys.\n",
+		                msgpref);
+	}
+	free(msgpref);
 
-		size_t path_len = strlen(keydir_name) + 1 + strlen(entry->d_name);
-		char *path = malloc((path_len + 1) * sizeof(char));
-		if (!path) {
-			ERR_ALLOC_FAILED;
-			closedir(keydir);
-			free(msgpref);
-			return KNOT_ENOMEM;
+	int result = init_sign_contexts(keys);
+	if (result != KNOT_EOK) {
+		knot_free_zone_keys(keys);
+		return result;
+	}
+
+	return KNOT_EOK;
+}
+
+/*- key cache ----------------------------------------------------------------*/
+
+/*!
+ * \brief Cached keys of a zone.
+ */
+typedef struct key_cache_zone {
+	char **files;              //!< Private key files of the zone.
+	time_t *mtimes;            //!< File modification times when loaded.
+	size_t count;
+	bool loaded;               //!< Keys are loaded.
+	bool busy;                 //!< Keys are borrowed by a signing event.
+	bool stale;                //!< Dropped from the cache while borrowed.
+	bool nsec3_enabled;        //!< NSEC3 enabled when loaded.
+	uint32_t valid_until;      //!< Earliest key timing change.
+	knot_zone_keys_t keys;
+} key_cache_zone_t;
+
+/*!
+ * \brief Index of key files in a key directory.
+ */
+typedef struct key_cache_dir {
+	char *path;
+	time_t mtime;              //!< Directory modification time when indexed.
+	bool racy;                 //!< Directory modified during indexing.
+	hattrie_t *zones;          //!< Zone name -> key_cache_zone_t.
+	struct key_cache_dir *next;
+} key_cache_dir_t;
+
+static pthread_mutex_t key_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static key_cache_dir_t *key_cache = NULL;
+
+static void key_cache_zone_drop(key_cache_zone_t *zone)
+{
+	if (zone->busy) {
+		zone->stale = true;
+		return;
+	}
+
+	if (zone->loaded) {
+		knot_free_zone_keys(&zone->keys);
+	}
+
+	for (size_t i = 0; i < zone->count; i++) {
+		free(zone->files[i]);
+	}
+	free(zone->files);
+	free(zone->mtimes);
+	free(zone);
+}
+
+static void key_cache_dir_clear(key_cache_dir_t *dir)
+{
+	if (dir->zones == NULL) {
+		return;
+	}
+
+	hattrie_iter_t *it = hattrie_iter_begin(dir->zones, false);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		key_cache_zone_drop(*hattrie_iter_val(it));
+	}
+	hattrie_iter_free(it);
+	hattrie_free(dir->zones);
+	dir->zones = NULL;
+}
+
+/*!
+ * \brief Get zone name of a key file, from the name if it has usual form.
+ */
+static knot_dname_t *key_file_zone(const char *path, const char *filename)
+{
+	// K<zone>.+<algorithm>+<keytag>.private
+	const char *plus = strchr(filename, '+');
+	if (filename[0] == 'K' && plus != NULL && plus - filename > 1) {
+		char *name = strndup(filename + 1, plus - filename - 1);
+		if (name == NULL) {
+			return NULL;
+		}
+		knot_dname_t *zone = knot_dname_from_str(name);
+		free(name);
+		if (zone != NULL) {
+			return zone;
 		}
+	}
+
+	knot_key_params_t params = { 0 };
+	if (knot_load_key_params(path, &params) != KNOT_EOK) {
+		knot_free_key_params(&params);
+		return NULL;
+	}
 
-		int written = snprintf(path, path_len + 1, "%s/%s",
-		                       keydir_name, entry->d_name);
-		UNUSED(written);
-		assert(written == path_len);
+	knot_dname_t *zone = params.name;
+	params.name = NULL;
+	knot_free_key_params(&params);
+	return zone;
+}
 
-		dbg_dnssec_detail("loading key '%s'\n", path);
+/*!
+ * \brief Add key file to the directory index.
+ */
+static int key_cache_dir_add(key_cache_dir_t *dir, const char *filename)
+{
+	char *path = sprintf_alloc("%s/%s", dir->path, filename);
+	if (path == NULL) {
+		return KNOT_ENOMEM;
+	}
 
-		knot_key_params_t params = { 0 };
-		int result = knot_load_key_params(path, &params);
+	knot_dname_t *zone_name = key_file_zone(path, filename);
+	if (zone_name == NULL) {
 		free(path);
+		return KNOT_EOK;
+	}
 
-		if (result != KNOT_EOK) {
-			log_zone_warning("DNSSEC: Failed to load key %s: %s\n",
-			                  entry->d_name, knot_strerror(result));
-			knot_free_key_params(&params);
-			continue;
-		}
+	knot_dname_to_lower(zone_name);
+	value_t *val = hattrie_get(dir->zones, (char *)zone_name,
+	                           knot_dname_size(zone_name));
+	knot_dname_free(&zone_name, NULL);
+	if (val == NULL) {
+		free(path);
+		return KNOT_ENOMEM;
+	}
 
-		if (!knot_dname_is_equal(zone_name, params.name)) {
-			dbg_dnssec_detail("skipping key, different zone name\n");
-			knot_free_key_params(&params);
-			continue;
+	key_cache_zone_t *zone = *val;
+	if (zone == NULL) {
+		zone = calloc(1, sizeof(key_cache_zone_t));
+		if (zone == NULL) {
+			free(path);
+			return KNOT_ENOMEM;
 		}
+		*val = zone;
+	}
 
-		if (knot_get_key_type(&params) != KNOT_KEY_DNSSEC) {
-			dbg_dnssec_detail("skipping key, different purpose\n");
-			knot_free_key_params(&params);
-			continue;
-		}
+	char **files = realloc(zone->files, (zone->count + 1) * sizeof(char *));
+	if (files == NULL) {
+		free(path);
+		return KNOT_ENOMEM;
+	}
+	zone->files = files;
+	zone->files[zone->count++] = path;
 
-		knot_zone_key_t key;
-		memset(&key, '\0', sizeof(key));
-		set_zone_key_flags(&params, &key);
+	return KNOT_EOK;
+}
 
-		dbg_dnssec_detail("next key event %" PRIu32 "\n", key.next_event);
+/*!
+ * \brief Index private key files of the directory by zone name.
+ */
+static int key_cache_dir_scan(key_cache_dir_t *dir, time_t mtime)
+{
+	key_cache_dir_clear(dir);
 
-		if (!key.is_active && !key.is_public && !was_removed(&params)) {
-			log_zone_notice("%s Ignoring key %d (%s): "
-			                "%s, %s.\n", msgpref, params.keytag,
-			                entry->d_name,
-			                key.is_active ? "active" : "inactive",
-			                key.is_public ? "public" : "not-public");
-			knot_free_key_params(&params);
+	DIR *keydir = opendir(dir->path);
+	if (!keydir) {
+		return KNOT_DNSSEC_ENOKEYDIR;
+	}
+
+	dir->zones = hattrie_create();
+	if (dir->zones == NULL) {
+		closedir(keydir);
+		return KNOT_ENOMEM;
+	}
+
+	time_t started = time(NULL);
+	int result = KNOT_EOK;
+	struct dirent entry_buf = { 0 };
+	struct dirent *entry = NULL;
+	while (readdir_r(keydir, &entry_buf, &entry) == 0 && entry != NULL) {
+		char *suffix = strrchr(entry->d_name, '.');
+		if (!suffix || strcmp(suffix, ".private") != 0) {
 			continue;
 		}
 
-		if (!knot_dnssec_algorithm_is_zonesign(params.algorithm,
-		                                       nsec3_enabled)
-		) {
-			log_zone_notice("%s Ignoring key %d (%s): unknown "
-			                "algorithm or non-NSEC3 algorithm when"
-			                " NSEC3 is requested.\n", msgpref,
-			                params.keytag, entry->d_name);
-			knot_free_key_params(&params);
-			continue;
+		result = key_cache_dir_add(dir, entry->d_name);
+		if (result != KNOT_EOK) {
+			break;
 		}
+	}
 
-		if (knot_get_zone_key(keys, params.keytag) != NULL) {
-			log_zone_notice("%s Ignoring key %d (%s): duplicate "
-			                "keytag.\n", msgpref, params.keytag,
-			                entry->d_name);
-			knot_free_key_params(&params);
-			continue;
+	closedir(keydir);
+
+	if (result != KNOT_EOK) {
+		key_cache_dir_clear(dir);
+		return result;
+	}
+
+	// changes within the same second are not visible in the mtime
+	dir->mtime = mtime;
+	dir->racy = mtime >= started;
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Get up-to-date index of the key directory.
+ */
+static int key_cache_dir_get(const char *keydir_name, key_cache_dir_t **dir_p)
+{
+	struct stat st;
+	if (stat(keydir_name, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		return KNOT_DNSSEC_ENOKEYDIR;
+	}
+
+	key_cache_dir_t *dir = key_cache;
+	while (dir != NULL && strcmp(dir->path, keydir_name) != 0) {
+		dir = dir->next;
+	}
+
+	if (dir == NULL) {
+		dir = calloc(1, sizeof(key_cache_dir_t));
+		if (dir == NULL) {
+			return KNOT_ENOMEM;
+		}
+		dir->path = strdup(keydir_name);
+		if (dir->path == NULL) {
+			free(dir);
+			return KNOT_ENOMEM;
 		}
+		dir->next = key_cache;
+		key_cache = dir;
+	}
 
-		result = knot_dnssec_key_from_params(&params, &key.dnssec_key);
+	if (dir->zones == NULL || dir->racy || dir->mtime != st.st_mtime) {
+		int result = key_cache_dir_scan(dir, st.st_mtime);
 		if (result != KNOT_EOK) {
-			log_zone_error("%s Failed to process key %d (%s): %s\n",
-			               msgpref, params.keytag, entry->d_name,
-			               knot_strerror(result));
-			knot_free_key_params(&params);
-			continue;
+			return result;
 		}
+	}
 
-		log_zone_info("%s - Key is valid, tag %d, file %s, %s, %s, %s\n",
-		              msgpref, params.keytag, entry->d_name,
-		              key.is_ksk ? "KSK" : "ZSK",
-		              key.is_active ? "active" : "inactive",
-		              key.is_public ? "public" : "not-public");
+	*dir_p = dir;
+	return KNOT_EOK;
+}
 
-		keys->keys[keys->count] = key;
-		keys->count += 1;
+/*!
+ * \brief Check if cached keys of a zone can be used.
+ */
+static bool key_cache_zone_valid(const key_cache_zone_t *zone,
+                                 bool nsec3_enabled)
+{
+	if (!zone->loaded || zone->nsec3_enabled != nsec3_enabled ||
+	    time(NULL) >= zone->valid_until) {
+		return false;
+	}
 
-		knot_free_key_params(&params);
+	for (size_t i = 0; i < zone->count; i++) {
+		struct stat st;
+		if (stat(zone->files[i], &st) != 0 ||
+		    st.st_mtime != zone->mtimes[i]) {
+			return false;
+		}
 	}
 
-	closedir(keydir);
+	return true;
+}
 
-	if (keys->count == 0) {
-		free(msgpref);
-		return KNOT_DNSSEC_ENOKEY;
-	} else if (keys->count == KNOT_MAX_ZONE_KEYS) {
-		log_zone_notice("%s - Reached maximum count of keys.\n",
-		                msgpref);
+/*!
+ * \brief Reload keys of a zone into the cache.
+ */
+static int key_cache_zone_load(key_cache_zone_t *zone,
+                               const knot_dname_t *zone_name,
+                               bool nsec3_enabled)
+{
+	if (zone->loaded) {
+		knot_free_zone_keys(&zone->keys);
+		zone->loaded = false;
 	}
-	free(msgpref);
 
-	int result = init_sign_contexts(keys);
+	if (zone->mtimes == NULL) {
+		zone->mtimes = calloc(zone->count, sizeof(time_t));
+		if (zone->mtimes == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	// note times before loading not to miss concurrent changes
+	uint32_t now = time(NULL);
+	for (size_t i = 0; i < zone->count; i++) {
+		struct stat st;
+		zone->mtimes[i] = stat(zone->files[i], &st) == 0 ? st.st_mtime : 0;
+	}
+
+	uint32_t valid_until = UINT32_MAX;
+	int result = load_zone_keys(zone->files, zone->count, zone_name,
+	                            nsec3_enabled, &zone->keys, &valid_until);
 	if (result != KNOT_EOK) {
-		knot_free_zone_keys(keys);
 		return result;
 	}
 
+	for (size_t i = 0; i < zone->count; i++) {
+		if (zone->mtimes[i] >= now) {
+			valid_until = 0;
+		}
+	}
+
+	zone->loaded = true;
+	zone->nsec3_enabled = nsec3_enabled;
+	zone->valid_until = valid_until;
+
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Load zone keys using the key cache.
+ */
+int knot_load_zone_keys(const char *keydir_name, const knot_dname_t *zone_name,
+                        bool nsec3_enabled, knot_zone_keys_t *keys)
+{
+	if (!keydir_name || !zone_name || !keys) {
+		return KNOT_EINVAL;
+	}
+
+	knot_dname_t *lookup = knot_dname_copy(zone_name, NULL);
+	if (lookup == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_dname_to_lower(lookup);
+
+	pthread_mutex_lock(&key_cache_lock);
+
+	key_cache_dir_t *dir = NULL;
+	int result = key_cache_dir_get(keydir_name, &dir);
+	if (result != KNOT_EOK) {
+		goto done;
+	}
+
+	value_t *val = hattrie_tryget(dir->zones, (char *)lookup,
+	                              knot_dname_size(lookup));
+	key_cache_zone_t *zone = val ? *val : NULL;
+	if (zone == NULL) {
+		result = KNOT_DNSSEC_ENOKEY;
+		goto done;
+	}
+
+	if (zone->busy) {
+		// keys are in use by another event, load a private copy
+		uint32_t valid_until = 0;
+		result = load_zone_keys(zone->files, zone->count, zone_name,
+		                        nsec3_enabled, keys, &valid_until);
+		goto done;
+	}
+
+	if (!key_cache_zone_valid(zone, nsec3_enabled)) {
+		result = key_cache_zone_load(zone, zone_name, nsec3_enabled);
+		if (result != KNOT_EOK) {
+			goto done;
+		}
+	}
+
+	// lend the keys including signing contexts
+	*keys = zone->keys;
+	keys->cached = zone;
+	zone->busy = true;
+
+done:
+	pthread_mutex_unlock(&key_cache_lock);
+	knot_dname_free(&lookup, NULL);
+
+	return result;
+}
+
+/*!
+ * \brief Drop all cached keys.
+ */
+void knot_zone_keys_cache_clear(void)
+{
+	pthread_mutex_lock(&key_cache_lock);
+
+	while (key_cache != NULL) {
+		key_cache_dir_t *dir = key_cache;
+		key_cache = dir->next;
+		key_cache_dir_clear(dir);
+		free(dir->path);
+		free(dir);
+	}
+
+	pthread_mutex_unlock(&key_cache_lock);
+}
+
 /*!
  * \brief Free structure with zone keys and associated DNSSEC contexts.
  */
@@ -298,6 +701,20 @@ void knot_free_zone_keys(knot_zone_keys_t *keys)
 		return;
 	}
 
+	// return borrowed keys to the cache
+	key_cache_zone_t *zone = keys->cached;
+	if (zone != NULL) {
+		pthread_mutex_lock(&key_cache_lock);
+		zone->busy = false;
+		keys->cached = NULL;
+		if (zone->stale) {
+			key_cache_zone_drop(zone);
+		}
+		pthread_mutex_unlock(&key_cache_lock);
+		memset(keys, '\0', sizeof(*keys));
+		return;
+	}
+
 	free_sign_contexts(keys);
 
 	for (int i = 0; i < keys->count; i++) {
@@ -54,11 +54,18 @@ typedef struct {
 typedef struct {
 	unsigned count;
 	knot_zone_key_t keys[KNOT_MAX_ZONE_KEYS];
+	void *cached;                        //!< Cache entry keys are borrowed from.
 } knot_zone_keys_t;
 
 /*!
  * \brief Load zone keys from a key directory.
  *
+ * Keys are kept in a process-wide cache together with their signing contexts
+ * and lent to the caller until knot_free_zone_keys(). The key directory is
+ * indexed by zone name and scanned again only when its modification time
+ * changes. Keys of the zone are reloaded when any of its key files changes,
+ * when the key timing changes or when the keys are lent already.
+ *
  * \param keydir_name    Name of the directory with DNSSEC keys.
  * \param zone_name      Domain name of the zone.
  * \param nsec3_enabled  NSEC3 enabled for zone (determines allowed algorithms).
@@ -83,10 +90,19 @@ const knot_zone_key_t *knot_get_zone_key(const knot_zone_keys_t *keys,
 /*!
  * \brief Free structure with zone keys and associated DNSSEC contexts.
  *
+ * Keys borrowed from the key cache are returned to it.
+ *
  * \param keys    Zone keys.
  */
 void knot_free_zone_keys(knot_zone_keys_t *keys);
 
+/*!
+ * \brief Drop all keys from the key cache.
+ *
+ * Keys borrowed at the time are freed when returned.
+ */
+void knot_zone_keys_cache_clear(void);
+
 /*!
  * \brief Get timestamp of next key event.
  *
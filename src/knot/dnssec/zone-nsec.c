@@ -284,3 +284,139 @@ int knot_zone_create_nsec_chain(const knot_zone_contents_t *zone,
 	// Sign newly created records right away
 	return knot_zone_sign_nsecs_in_changeset(zone_keys, policy, changeset);
 }
+
+/*!
+ * \brief Check if the changed record affects the whole chain.
+ */
+static bool rr_needs_full_chain(const knot_zone_contents_t *zone,
+                                const knot_rrset_t *rr)
+{
+	switch (rr->type) {
+	case KNOT_RRTYPE_SOA:
+	case KNOT_RRTYPE_DNSKEY:
+	case KNOT_RRTYPE_NSEC:
+	case KNOT_RRTYPE_NSEC3:
+	case KNOT_RRTYPE_NSEC3PARAM:
+		return true;
+	case KNOT_RRTYPE_NS:
+		break;
+	default:
+		return false;
+	}
+
+	// Delegation change flips authority of the whole subtree
+	if (knot_dname_is_equal(rr->owner, zone->apex->owner)) {
+		return false;
+	}
+
+	zone_node_t *node = NULL;
+	knot_zone_tree_get(zone->nodes, rr->owner, &node);
+	return node != NULL && node->children > 0;
+}
+
+/*!
+ * \brief Check if the changes can be covered by fixing the current chain.
+ */
+static bool changeset_needs_full_chain(const knot_zone_contents_t *zone,
+                                       const knot_changeset_t *changeset)
+{
+	if (changeset->soa_from && changeset->soa_to &&
+	    knot_soa_minimum(&changeset->soa_from->rrs) !=
+	    knot_soa_minimum(&changeset->soa_to->rrs)) {
+		return true;
+	}
+
+	const list_t *lists[] = { &changeset->remove, &changeset->add };
+	for (int i = 0; i < 2; ++i) {
+		knot_rr_ln_t *rr_node = NULL;
+		WALK_LIST(rr_node, *lists[i]) {
+			if (rr_needs_full_chain(zone, rr_node->rr)) {
+				return true;
+			}
+		}
+	}
+
+	if (knot_is_nsec3_enabled(zone)) {
+		return knot_zone_tree_is_empty(zone->nsec3_nodes);
+	}
+
+	return !knot_zone_tree_is_empty(zone->nsec3_nodes) ||
+	       !node_rrtype_exists(zone->apex, KNOT_RRTYPE_NSEC);
+}
+
+/*!
+ * \brief Free RR sets of a changeset, its list nodes stay in the pool.
+ */
+static void changeset_drop_rrsets(knot_changeset_t *changeset)
+{
+	list_t *lists[] = { &changeset->add, &changeset->remove };
+	for (int i = 0; i < 2; ++i) {
+		knot_rr_ln_t *rr_node = NULL;
+		WALK_LIST(rr_node, *lists[i]) {
+			knot_rrset_free(&rr_node->rr, NULL);
+		}
+		init_list(lists[i]);
+	}
+}
+
+/*!
+ * \brief Fix NSEC or NSEC3 chain in the zone after a change.
+ */
+int knot_zone_fix_nsec_chain(const knot_zone_contents_t *zone,
+                             const knot_changeset_t *in_ch,
+                             knot_changeset_t *out_ch,
+                             const knot_zone_keys_t *zone_keys,
+                             const knot_dnssec_policy_t *policy)
+{
+	if (!zone || !in_ch || !out_ch) {
+		return KNOT_EINVAL;
+	}
+
+	if (changeset_needs_full_chain(zone, in_ch)) {
+		return knot_zone_create_nsec_chain(zone, out_ch, zone_keys, policy);
+	}
+
+	uint32_t nsec_ttl = 0;
+	if (!get_zone_soa_min_ttl(zone, &nsec_ttl)) {
+		return KNOT_EINVAL;
+	}
+
+	// Fix the chain aside, it may fail after some changes were made
+	knot_changeset_t fix_ch = { .mem_ctx = out_ch->mem_ctx };
+	init_list(&fix_ch.add);
+	init_list(&fix_ch.remove);
+
+	int result;
+	if (knot_is_nsec3_enabled(zone)) {
+		result = knot_nsec3_fix_chain(zone, in_ch, nsec_ttl, &fix_ch);
+	} else {
+		result = knot_nsec_fix_chain(zone, in_ch, nsec_ttl, &fix_ch);
+	}
+
+	if (result != KNOT_EOK) {
+		changeset_drop_rrsets(&fix_ch);
+	}
+
+	if (result == KNOT_ENOENT) {
+		// Current chain can't be fixed, the partial fix was dropped
+		dbg_dnssec_verb("NSEC(3) chain can't be fixed, recreating\n");
+		return knot_zone_create_nsec_chain(zone, out_ch, zone_keys, policy);
+	}
+
+	if (result == KNOT_EOK) {
+		add_tail_list(&out_ch->add, &fix_ch.add);
+		add_tail_list(&out_ch->remove, &fix_ch.remove);
+	}
+
+	if (result == KNOT_EOK) {
+		// Mark removed NSEC3 nodes, so that they are not signed later
+		result = mark_removed_nsec3(out_ch, zone);
+	}
+
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	// Sign newly created records right away
+	return knot_zone_sign_nsecs_in_changeset(zone_keys, policy, out_ch);
+}
@@ -85,6 +85,28 @@ int knot_zone_create_nsec_chain(const knot_zone_contents_t *zone,
                                 const knot_zone_keys_t *zone_keys,
                                 const knot_dnssec_policy_t *policy);
 
+/*!
+ * \brief Fix NSEC or NSEC3 chain in the zone after a change.
+ *
+ * Only records around the changed nodes are updated and signed. The chain
+ * is created from scratch if the change affects the whole chain (SOA minimum
+ * TTL, keys, NSEC3 parameters, delegations with subtrees) or if the current
+ * chain can't be fixed.
+ *
+ * \param zone       Updated zone.
+ * \param in_ch      Changes applied to the zone.
+ * \param out_ch     Changeset into which the changes will be added.
+ * \param zone_keys  Zone keys used for NSEC(3) creation.
+ * \param policy     DNSSEC signing policy.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_zone_fix_nsec_chain(const knot_zone_contents_t *zone,
+                             const knot_changeset_t *in_ch,
+                             knot_changeset_t *out_ch,
+                             const knot_zone_keys_t *zone_keys,
+                             const knot_dnssec_policy_t *policy);
+
 #endif // _KNOT_DNSSEC_ZONE_NSEC_H_
 
 /*! @} */
@@ -17,6 +17,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <time.h>
 
@@ -31,10 +32,12 @@
 #include "libknot/dnssec/policy.h"
 #include "libknot/dnssec/rrset-sign.h"
 #include "libknot/dnssec/sign.h"
+#include "libknot/packet/wire.h"
 #include "libknot/rdata/rdname.h"
 #include "libknot/rdata/rrsig.h"
 #include "libknot/rdata/soa.h"
 #include "knot/dnssec/zone-keys.h"
+#include "knot/dnssec/zone-nsec.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/updates/changesets.h"
 #include "knot/zone/node.h"
@@ -53,8 +56,94 @@ static knot_rrset_t *create_empty_rrsigs_for(const knot_rrset_t *covered)
 			      covered->rclass, NULL);
 }
 
+/*!
+ * \brief Maximal size of a key in the set of trusted signatures.
+ */
+#define TRUSTED_KEY_MAXLEN (KNOT_DNAME_MAXLEN + sizeof(uint16_t))
+
+/*!
+ * \brief Write the key of an RR set in the set of trusted signatures.
+ *
+ * \return Size of the key.
+ */
+static size_t trusted_key(const knot_dname_t *owner, uint16_t type,
+                          uint8_t *key)
+{
+	size_t size = knot_dname_size(owner);
+	memcpy(key, owner, size);
+	knot_wire_write_u16(key + size, type);
+
+	return size + sizeof(uint16_t);
+}
+
+/*!
+ * \brief Check if the signatures of an RR set are trusted.
+ */
+static bool rrset_trusted(hattrie_t *trusted, const knot_rrset_t *rrset)
+{
+	if (trusted == NULL) {
+		return false;
+	}
+
+	uint8_t key[TRUSTED_KEY_MAXLEN];
+	size_t size = trusted_key(rrset->owner, rrset->type, key);
+	value_t *val = hattrie_tryget(trusted, (char *)key, size);
+
+	return val != NULL && *val != NULL;
+}
+
+/*!
+ * \brief Add an RR set into the set of trusted signatures.
+ */
+static int trust_rrset(hattrie_t *trusted, const zone_node_t *node,
+                       uint16_t type)
+{
+	if (trusted == NULL) {
+		return KNOT_EOK;
+	}
+
+	uint8_t key[TRUSTED_KEY_MAXLEN];
+	size_t size = trusted_key(node->owner, type, key);
+	value_t *val = hattrie_get(trusted, (char *)key, size);
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	*val = (value_t)node;
+	return KNOT_EOK;
+}
+
 /*- private API - signing of in-zone nodes -----------------------------------*/
 
+/*!
+ * \brief Check validity of a signature.
+ *
+ * Trusted signatures were copied with unchanged records from the previous
+ * zone version, where they were validated. Only their expiration and key
+ * algorithm are checked, the key tag is matched by the caller.
+ *
+ * \return KNOT_EOK if valid, KNOT_DNSSEC_EINVALID_SIGNATURE if not, or
+ *         other error code.
+ */
+static int check_signature(const knot_rrset_t *covered,
+                           const knot_rrset_t *rrsigs, size_t pos,
+                           const knot_dnssec_key_t *key,
+                           knot_dnssec_sign_context_t *ctx,
+                           const knot_dnssec_policy_t *policy, bool trusted)
+{
+	if (!trusted) {
+		return knot_is_valid_signature(covered, rrsigs, pos, key, ctx,
+		                               policy);
+	}
+
+	if (knot_rrsig_algorithm(&rrsigs->rrs, pos) != key->algorithm ||
+	    knot_rrsig_sig_expiration(&rrsigs->rrs, pos) <= policy->refresh_before) {
+		return KNOT_DNSSEC_EINVALID_SIGNATURE;
+	}
+
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Check if there is a valid signature for a given RR set and key.
  *
@@ -63,6 +152,7 @@ static knot_rrset_t *create_empty_rrsigs_for(const knot_rrset_t *covered)
  * \param key      Signing key.
  * \param ctx      Signing context.
  * \param policy   DNSSEC policy.
+ * \param trusted  The signatures are trusted.
  *
  * \return The signature exists and is valid.
  */
@@ -70,7 +160,8 @@ static bool valid_signature_exists(const knot_rrset_t *covered,
 				   const knot_rrset_t *rrsigs,
 				   const knot_dnssec_key_t *key,
 				   knot_dnssec_sign_context_t *ctx,
-				   const knot_dnssec_policy_t *policy)
+				   const knot_dnssec_policy_t *policy,
+				   bool trusted)
 {
 	assert(key);
 
@@ -86,8 +177,8 @@ static bool valid_signature_exists(const knot_rrset_t *covered,
 			continue;
 		}
 
-		return knot_is_valid_signature(covered, rrsigs, i, key, ctx,
-		                               policy) == KNOT_EOK;
+		return check_signature(covered, rrsigs, i, key, ctx, policy,
+		                       trusted) == KNOT_EOK;
 	}
 
 	return false;
@@ -149,7 +240,7 @@ static bool all_signatures_exist(const knot_rrset_t *covered,
 		}
 
 		if (!valid_signature_exists(covered, rrsigs, &key->dnssec_key,
-		                            key->context, policy)) {
+		                            key->context, policy, false)) {
 			return false;
 		}
 	}
@@ -203,6 +294,7 @@ static void note_earliest_expiration(const knot_rrset_t *rrsigs, size_t pos,
  * \param rrsigs      RR set with RRSIGs.
  * \param zone_keys   Zone keys.
  * \param policy      DNSSEC policy.
+ * \param trusted     The signatures are trusted.
  * \param changeset   Changeset to be updated.
  * \param expires_at  Earliest RRSIG expiration.
  *
@@ -212,6 +304,7 @@ static int remove_expired_rrsigs(const knot_rrset_t *covered,
                                  const knot_rrset_t *rrsigs,
                                  const knot_zone_keys_t *zone_keys,
                                  const knot_dnssec_policy_t *policy,
+                                 bool trusted,
                                  knot_changeset_t *changeset,
                                  uint32_t *expires_at)
 {
@@ -244,9 +337,9 @@ static int remove_expired_rrsigs(const knot_rrset_t *covered,
 		key = get_matching_zone_key(&synth_rrsig, i, zone_keys);
 
 		if (key && key->is_active && key->context) {
-			result = knot_is_valid_signature(covered, &synth_rrsig, i,
-			                                 &key->dnssec_key,
-			                                 key->context, policy);
+			result = check_signature(covered, &synth_rrsig, i,
+			                         &key->dnssec_key, key->context,
+			                         policy, trusted);
 			if (result == KNOT_EOK) {
 				// valid signature
 				note_earliest_expiration(&synth_rrsig, i, expires_at);
@@ -288,66 +381,200 @@ static int remove_expired_rrsigs(const knot_rrset_t *covered,
 }
 
 /*!
- * \brief Add missing RRSIGs into the changeset for adding.
+ * \brief Maximal number of RR sets signed in one batch.
+ */
+#define SIGN_BATCH_MAX 64
+
+/*!
+ * \brief RR sets waiting for their signatures.
+ */
+typedef struct sign_batch {
+	const knot_zone_keys_t *zone_keys;
+	const knot_dnssec_policy_t *policy;
+	knot_changeset_t *changeset;
+	const knot_rrset_t *rrsigs;  //!< Existing RRSIGs, NULL to sign all.
+	knot_rrset_t covered[SIGN_BATCH_MAX];
+	bool trusted[SIGN_BATCH_MAX];  //!< Existing RRSIGs are trusted.
+	size_t count;
+} sign_batch_t;
+
+/*!
+ * \brief Add missing RRSIGs of several RR sets into the changeset for adding.
  *
- * \param covered    RR set with covered records.
- * \param rrsigs     RR set with RRSIGs.
+ * The RR sets are signed in a batch for each key, so that the signing context
+ * and the buffers are shared. Signatures of the batch share randomly
+ * shortened life time.
+ *
+ * \param covered    RR sets with covered records.
+ * \param count      Number of RR sets, at most SIGN_BATCH_MAX.
+ * \param rrsigs     RR set with RRSIGs of the covered records (may be NULL).
+ * \param trusted    Trusted RRSIGs for each RR set (may be NULL).
  * \param zone_keys  Zone keys.
  * \param policy     DNSSEC policy.
  * \param changeset  Changeset to be updated.
  *
  * \return Error code, KNOT_EOK if successful.
  */
-static int add_missing_rrsigs(const knot_rrset_t *covered,
-                              const knot_rrset_t *rrsigs,
-                              const knot_zone_keys_t *zone_keys,
-                              const knot_dnssec_policy_t *policy,
-                              knot_changeset_t *changeset)
+static int add_missing_rrsigs_batch(const knot_rrset_t *covered, size_t count,
+                                    const knot_rrset_t *rrsigs,
+                                    const bool *trusted,
+                                    const knot_zone_keys_t *zone_keys,
+                                    const knot_dnssec_policy_t *policy,
+                                    knot_changeset_t *changeset)
 {
-	assert(!knot_rrset_empty(covered));
+	assert(covered);
+	assert(count <= SIGN_BATCH_MAX);
 	assert(zone_keys);
 	assert(changeset);
 
 	int result = KNOT_EOK;
-	knot_rrset_t *to_add = NULL;
+	knot_rrset_t *to_add[SIGN_BATCH_MAX] = { NULL };
+	knot_rrset_t *batch_rrsigs[SIGN_BATCH_MAX];
+	const knot_rrset_t *batch_covered[SIGN_BATCH_MAX];
 
-	for (int i = 0; i < zone_keys->count; i++) {
+	knot_dnssec_policy_t batch_policy = *policy;
+	batch_policy.sign_lifetime = knot_dnssec_policy_jitter_lifetime(policy);
+
+	for (int i = 0; result == KNOT_EOK && i < zone_keys->count; i++) {
 		const knot_zone_key_t *key = &zone_keys->keys[i];
-		if (!use_key(key, covered)) {
-			continue;
+
+		size_t batch_count = 0;
+		for (size_t j = 0; j < count; j++) {
+			assert(!knot_rrset_empty(&covered[j]));
+			if (!use_key(key, &covered[j])) {
+				continue;
+			}
+
+			if (valid_signature_exists(&covered[j], rrsigs,
+			                           &key->dnssec_key,
+			                           key->context, policy,
+			                           trusted && trusted[j])) {
+				continue;
+			}
+
+			if (to_add[j] == NULL) {
+				to_add[j] = create_empty_rrsigs_for(&covered[j]);
+				if (to_add[j] == NULL) {
+					result = KNOT_ENOMEM;
+					break;
+				}
+			}
+
+			batch_rrsigs[batch_count] = to_add[j];
+			batch_covered[batch_count] = &covered[j];
+			batch_count += 1;
+		}
+
+		if (result == KNOT_EOK && batch_count > 0) {
+			result = knot_sign_rrsets(batch_rrsigs, batch_covered,
+			                          batch_count, &key->dnssec_key,
+			                          key->context, &batch_policy);
 		}
+	}
 
-		if (valid_signature_exists(covered, rrsigs, &key->dnssec_key,
-		                           key->context, policy)) {
+	for (size_t j = 0; j < count; j++) {
+		if (to_add[j] == NULL) {
 			continue;
 		}
 
-		if (to_add == NULL) {
-			to_add = create_empty_rrsigs_for(covered);
-			if (to_add == NULL) {
-				return KNOT_ENOMEM;
+		if (result == KNOT_EOK) {
+			result = knot_changeset_add_rrset(changeset, to_add[j],
+			                                  KNOT_CHANGESET_ADD);
+			if (result == KNOT_EOK) {
+				continue;
 			}
 		}
 
-		result = knot_sign_rrset(to_add, covered, &key->dnssec_key,
-		                         key->context, policy);
-		if (result != KNOT_EOK) {
-			break;
-		}
+		knot_rrset_free(&to_add[j], NULL);
 	}
 
-	if (to_add != NULL && result == KNOT_EOK) {
-		result = knot_changeset_add_rrset(changeset, to_add,
-		                                  KNOT_CHANGESET_ADD);
-	}
+	return result;
+}
 
-	if (to_add != NULL && result != KNOT_EOK) {
-		knot_rrset_free(&to_add, NULL);
+/*!
+ * \brief Add missing RRSIGs into the changeset for adding.
+ *
+ * \param covered    RR set with covered records.
+ * \param rrsigs     RR set with RRSIGs.
+ * \param zone_keys  Zone keys.
+ * \param policy     DNSSEC policy.
+ * \param changeset  Changeset to be updated.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+static int add_missing_rrsigs(const knot_rrset_t *covered,
+                              const knot_rrset_t *rrsigs,
+                              const knot_zone_keys_t *zone_keys,
+                              const knot_dnssec_policy_t *policy,
+                              knot_changeset_t *changeset)
+{
+	return add_missing_rrsigs_batch(covered, 1, rrsigs, NULL, zone_keys,
+	                                policy, changeset);
+}
+
+/*!
+ * \brief Initialize batch of RR sets to be signed.
+ *
+ * \param batch      Batch to be initialized.
+ * \param rrsigs     RR set with RRSIGs of all the covered records, NULL if
+ *                   all the RR sets are to be signed anew.
+ * \param zone_keys  Zone keys.
+ * \param policy     DNSSEC policy.
+ * \param changeset  Changeset to be updated.
+ */
+static void sign_batch_init(sign_batch_t *batch, const knot_rrset_t *rrsigs,
+                            const knot_zone_keys_t *zone_keys,
+                            const knot_dnssec_policy_t *policy,
+                            knot_changeset_t *changeset)
+{
+	batch->zone_keys = zone_keys;
+	batch->policy = policy;
+	batch->changeset = changeset;
+	batch->rrsigs = rrsigs;
+	batch->count = 0;
+}
+
+/*!
+ * \brief Sign RR sets waiting in the batch.
+ */
+static int sign_batch_flush(sign_batch_t *batch)
+{
+	if (batch->count == 0) {
+		return KNOT_EOK;
 	}
 
+	int result = add_missing_rrsigs_batch(batch->covered, batch->count,
+	                                      batch->rrsigs, batch->trusted,
+	                                      batch->zone_keys, batch->policy,
+	                                      batch->changeset);
+	batch->count = 0;
+
 	return result;
 }
 
+/*!
+ * \brief Add RR set to the batch, sign the batch if full.
+ *
+ * \note The covered records must stay valid until the batch is signed.
+ */
+static int sign_batch_add(sign_batch_t *batch, const knot_rrset_t *covered,
+                          bool trusted)
+{
+	assert(!knot_rrset_empty(covered));
+
+	if (batch->count == SIGN_BATCH_MAX) {
+		int result = sign_batch_flush(batch);
+		if (result != KNOT_EOK) {
+			return result;
+		}
+	}
+
+	batch->covered[batch->count] = *covered;
+	batch->trusted[batch->count] = trusted;
+	batch->count += 1;
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Add all RRSIGs into the changeset for removal.
  *
@@ -388,51 +615,49 @@ static int remove_rrset_rrsigs(const knot_dname_t *owner, uint16_t type,
 /*!
  * \brief Drop all existing and create new RRSIGs for covered records.
  *
- * \param covered    RR set with covered records.
- * \param zone_keys  Zone keys.
- * \param policy     DNSSEC policy.
- * \param changeset  Changeset to be updated.
+ * \param covered  RR set with covered records.
+ * \param rrsigs   RR set with RRSIGs.
+ * \param batch    Batch for signing anew, to which the records are added.
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static int force_resign_rrset(const knot_rrset_t *covered,
                               const knot_rrset_t *rrsigs,
-                              const knot_zone_keys_t *zone_keys,
-                              const knot_dnssec_policy_t *policy,
-                              knot_changeset_t *changeset)
+                              sign_batch_t *batch)
 {
 	assert(!knot_rrset_empty(covered));
+	assert(batch->rrsigs == NULL);
 
 	if (!knot_rrset_empty(rrsigs)) {
 		int result = remove_rrset_rrsigs(covered->owner, covered->type,
-		                                 rrsigs, changeset);
+		                                 rrsigs, batch->changeset);
 		if (result != KNOT_EOK) {
 			return result;
 		}
 	}
 
-	return add_missing_rrsigs(covered, NULL, zone_keys, policy, changeset);
+	return sign_batch_add(batch, covered, false);
 }
 
 /*!
  * \brief Drop all expired and create new RRSIGs for covered records.
  *
  * \param covered     RR set with covered records.
- * \param zone_keys   Zone keys.
- * \param policy      DNSSEC policy.
- * \param changeset   Changeset to be updated.
+ * \param rrsigs      RR set with RRSIGs.
+ * \param trusted     The signatures are trusted.
  * \param expires_at  Current earliest expiration, will be updated.
+ * \param batch       Batch for signing, to which the records are added.
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static int resign_rrset(const knot_rrset_t *covered,
                         const knot_rrset_t *rrsigs,
-                        const knot_zone_keys_t *zone_keys,
-                        const knot_dnssec_policy_t *policy,
-                        knot_changeset_t *changeset,
-                        uint32_t *expires_at)
+                        bool trusted,
+                        uint32_t *expires_at,
+                        sign_batch_t *batch)
 {
 	assert(!knot_rrset_empty(covered));
+	assert(batch->rrsigs == rrsigs);
 
 	// TODO this function creates some signatures twice (for checking)
 	// maybe merge the two functions into one
@@ -441,14 +666,14 @@ static int resign_rrset(const knot_rrset_t *covered,
 	// TODO reuse digest for RSA then, RSA is the most used algo family,
 	// and we create all the signatures twice, that is not cool I think.
 
-	int result = remove_expired_rrsigs(covered, rrsigs, zone_keys,
-	                                   policy, changeset, expires_at);
+	int result = remove_expired_rrsigs(covered, rrsigs, batch->zone_keys,
+	                                   batch->policy, trusted,
+	                                   batch->changeset, expires_at);
 	if (result != KNOT_EOK) {
 		return result;
 	}
 
-	return add_missing_rrsigs(covered, rrsigs, zone_keys, policy,
-	                          changeset);
+	return sign_batch_add(batch, covered, trusted);
 }
 
 static int remove_standalone_rrsigs(const zone_node_t *node,
@@ -494,6 +719,7 @@ static int remove_standalone_rrsigs(const zone_node_t *node,
  * \param node        Node to be signed.
  * \param zone_keys   Zone keys.
  * \param policy      DNSSEC policy.
+ * \param trusted     Set of RR sets with trusted signatures (may be NULL).
  * \param changeset   Changeset to be updated.
  * \param expires_at  Current earliest expiration, will be updated.
  *
@@ -502,6 +728,7 @@ static int remove_standalone_rrsigs(const zone_node_t *node,
 static int sign_node_rrsets(const zone_node_t *node,
                             const knot_zone_keys_t *zone_keys,
                             const knot_dnssec_policy_t *policy,
+                            hattrie_t *trusted,
                             knot_changeset_t *changeset,
                             uint32_t *expires_at)
 {
@@ -511,6 +738,11 @@ static int sign_node_rrsets(const zone_node_t *node,
 	int result = KNOT_EOK;
 	knot_rrset_t rrsigs = node_rrset(node, KNOT_RRTYPE_RRSIG);
 
+	// RR sets of the node are signed together
+	sign_batch_t batch;
+	sign_batch_init(&batch, policy->forced_sign ? NULL : &rrsigs,
+	                zone_keys, policy, changeset);
+
 	for (int i = 0; i < node->rrset_count; i++) {
 		knot_rrset_t rrset = node_rrset_at(node, i);
 		if (rrset.type == KNOT_RRTYPE_RRSIG) {
@@ -527,11 +759,11 @@ static int sign_node_rrsets(const zone_node_t *node,
 		}
 
 		if (policy->forced_sign) {
-			result = force_resign_rrset(&rrset, &rrsigs, zone_keys, policy,
-			         changeset);
+			result = force_resign_rrset(&rrset, &rrsigs, &batch);
 		} else {
-			result = resign_rrset(&rrset, &rrsigs, zone_keys, policy,
-			                      changeset, expires_at);
+			result = resign_rrset(&rrset, &rrsigs,
+			                      rrset_trusted(trusted, &rrset),
+			                      expires_at, &batch);
 		}
 
 		if (result != KNOT_EOK) {
@@ -539,6 +771,11 @@ static int sign_node_rrsets(const zone_node_t *node,
 		}
 	}
 
+	result = sign_batch_flush(&batch);
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
 	return remove_standalone_rrsigs(node, &rrsigs, changeset);
 }
 
@@ -548,6 +785,7 @@ static int sign_node_rrsets(const zone_node_t *node,
 typedef struct node_sign_args {
 	const knot_zone_keys_t *zone_keys;
 	const knot_dnssec_policy_t *policy;
+	hattrie_t *trusted;
 	knot_changeset_t *changeset;
 	uint32_t expires_at;
 } node_sign_args_t;
@@ -574,7 +812,8 @@ static int sign_node(zone_node_t **node, void *data)
 	}
 
 	int result = sign_node_rrsets(*node, args->zone_keys, args->policy,
-	                              args->changeset, &args->expires_at);
+	                              args->trusted, args->changeset,
+	                              &args->expires_at);
 	(*node)->flags &= ~NODE_FLAGS_REMOVED_NSEC;
 
 	return result;
@@ -586,6 +825,7 @@ static int sign_node(zone_node_t **node, void *data)
  * \param tree        Zone tree to be signed.
  * \param zone_keys   Zone keys.
  * \param policy      DNSSEC policy.
+ * \param trusted     Set of RR sets with trusted signatures (may be NULL).
  * \param changeset   Changeset to be updated.
  * \param expires_at  Expiration time of the oldest signature in zone.
  *
@@ -594,6 +834,7 @@ static int sign_node(zone_node_t **node, void *data)
 static int zone_tree_sign(knot_zone_tree_t *tree,
                           const knot_zone_keys_t *zone_keys,
                           const knot_dnssec_policy_t *policy,
+                          hattrie_t *trusted,
                           knot_changeset_t *changeset,
                           uint32_t *expires_at)
 {
@@ -604,6 +845,7 @@ static int zone_tree_sign(knot_zone_tree_t *tree,
 	node_sign_args_t args = {
 		.zone_keys = zone_keys,
 		.policy = policy,
+		.trusted = trusted,
 		.changeset = changeset,
 		.expires_at = time(NULL) + policy->sign_lifetime
 	};
@@ -614,6 +856,211 @@ static int zone_tree_sign(knot_zone_tree_t *tree,
 	return result;
 }
 
+/*- private API - incremental signature refresh ------------------------------*/
+
+/*!
+ * \brief Least number of signatures refreshed in one slice.
+ */
+#define REFRESH_SLICE_MIN 100
+
+/*!
+ * \brief Struct to carry data for signature refresh callback functions.
+ */
+typedef struct node_refresh_args {
+	const knot_zone_keys_t *zone_keys;
+	const knot_dnssec_policy_t *policy;
+	knot_changeset_t *changeset;
+	uint32_t refresh_before;  //!< Refresh signatures expiring before this.
+	size_t refresh_ties;      //!< Number of refreshes expiring right then.
+	uint32_t expires_at;      //!< Earliest expiration of kept signatures.
+	uint32_t *due;            //!< Expirations of signatures due for refresh.
+	size_t due_count;
+	size_t due_size;
+	size_t total;             //!< Number of signatures in the zone.
+} node_refresh_args_t;
+
+static bool refresh_skip_node(const zone_node_t *node)
+{
+	return node->rrset_count == 0 || (node->flags & NODE_FLAGS_NONAUTH);
+}
+
+/*!
+ * \brief Collect expirations of signatures due for refresh (callback function).
+ *
+ * \param node  Node with signatures.
+ * \param data  Callback data, node_refresh_args_t.
+ */
+static int collect_due_rrsigs(zone_node_t **node, void *data)
+{
+	assert(node && *node);
+	assert(data);
+
+	node_refresh_args_t *args = (node_refresh_args_t *)data;
+	if (refresh_skip_node(*node)) {
+		return KNOT_EOK;
+	}
+
+	knot_rrset_t rrsigs = node_rrset(*node, KNOT_RRTYPE_RRSIG);
+	uint16_t rrsigs_rdata_count = rrsigs.rrs.rr_count;
+	for (uint16_t i = 0; i < rrsigs_rdata_count; i++) {
+		args->total += 1;
+		uint32_t expiration = knot_rrsig_sig_expiration(&rrsigs.rrs, i);
+		if (expiration > args->refresh_before) {
+			continue;
+		}
+
+		if (args->due_count == args->due_size) {
+			size_t size = args->due_size > 0 ? 2 * args->due_size : 64;
+			uint32_t *due = realloc(args->due, size * sizeof(uint32_t));
+			if (due == NULL) {
+				return KNOT_ENOMEM;
+			}
+			args->due = due;
+			args->due_size = size;
+		}
+		args->due[args->due_count++] = expiration;
+	}
+
+	return KNOT_EOK;
+}
+
+static int expiration_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/*!
+ * \brief Lower the refresh horizon to bound the number of refreshed signatures.
+ *
+ * One slice refreshes twice the rate needed to re-sign the zone once per
+ * signature life time, or more to catch up with the backlog within half of
+ * the safety margin. Signatures expiring within that half are refreshed
+ * regardless of the bound.
+ */
+static uint32_t refresh_slice_horizon(node_refresh_args_t *args)
+{
+	const knot_dnssec_policy_t *policy = args->policy;
+	args->refresh_ties = SIZE_MAX;
+	if (args->due_count <= REFRESH_SLICE_MIN) {
+		return args->refresh_before;
+	}
+
+	uint32_t tick = MAX(policy->resign_tick, 1);
+	uint32_t margin = 0;
+	if (args->refresh_before > policy->now) {
+		margin = args->refresh_before - policy->now;
+	}
+
+	uint64_t steady = 2 * (uint64_t)args->total * tick /
+	                  MAX(policy->sign_lifetime, 1);
+	uint64_t backlog = (uint64_t)args->due_count * tick / MAX(margin / 2, 1);
+	size_t limit = MAX(MAX(steady, backlog), REFRESH_SLICE_MIN);
+	if (args->due_count <= limit) {
+		return args->refresh_before;
+	}
+
+	qsort(args->due, args->due_count, sizeof(uint32_t), expiration_cmp);
+	uint32_t horizon = args->due[limit - 1];
+	uint32_t least = policy->now + margin / 2;
+	if (horizon <= least) {
+		return least;
+	}
+
+	// signatures expiring at the horizon may exceed the bound
+	size_t before = limit - 1;
+	while (before > 0 && args->due[before - 1] == horizon) {
+		before -= 1;
+	}
+	args->refresh_ties = limit - before;
+
+	return horizon;
+}
+
+/*!
+ * \brief Check if signatures of given type are due, note expiration otherwise.
+ */
+static bool rrsigs_due(const knot_rrset_t *rrsigs, uint16_t type,
+                       node_refresh_args_t *args)
+{
+	uint32_t earliest = UINT32_MAX;
+	uint16_t rrsigs_rdata_count = rrsigs->rrs.rr_count;
+	for (uint16_t i = 0; i < rrsigs_rdata_count; i++) {
+		if (knot_rrsig_type_covered(&rrsigs->rrs, i) == type) {
+			uint32_t expiration = knot_rrsig_sig_expiration(&rrsigs->rrs, i);
+			earliest = MIN(earliest, expiration);
+		}
+	}
+
+	if (earliest < args->refresh_before) {
+		return true;
+	}
+
+	if (earliest == args->refresh_before && args->refresh_ties > 0) {
+		args->refresh_ties -= 1;
+		return true;
+	}
+
+	args->expires_at = MIN(args->expires_at, earliest);
+	return false;
+}
+
+/*!
+ * \brief Re-sign RR sets with signatures due for refresh (callback function).
+ *
+ * SOA is only noted, it is signed with the serial update.
+ *
+ * \param node  Node to be refreshed.
+ * \param data  Callback data, node_refresh_args_t.
+ */
+static int refresh_node(zone_node_t **node, void *data)
+{
+	assert(node && *node);
+	assert(data);
+
+	node_refresh_args_t *args = (node_refresh_args_t *)data;
+	if (refresh_skip_node(*node)) {
+		return KNOT_EOK;
+	}
+
+	knot_rrset_t rrsigs = node_rrset(*node, KNOT_RRTYPE_RRSIG);
+	if (knot_rrset_empty(&rrsigs)) {
+		return KNOT_EOK;
+	}
+
+	sign_batch_t batch;
+	sign_batch_init(&batch, NULL, args->zone_keys, args->policy,
+	                args->changeset);
+
+	for (int i = 0; i < (*node)->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(*node, i);
+		if (rrset.type == KNOT_RRTYPE_RRSIG) {
+			continue;
+		}
+		if (rrset.type == KNOT_RRTYPE_SOA) {
+			rrsigs_due(&rrsigs, rrset.type, args);
+			continue;
+		}
+		bool should_sign = false;
+		int result = knot_zone_sign_rr_should_be_signed(*node, &rrset,
+		                                                &should_sign);
+		if (result != KNOT_EOK) {
+			return result;
+		}
+		if (!should_sign || !rrsigs_due(&rrsigs, rrset.type, args)) {
+			continue;
+		}
+
+		result = force_resign_rrset(&rrset, &rrsigs, &batch);
+		if (result != KNOT_EOK) {
+			return result;
+		}
+	}
+
+	return sign_batch_flush(&batch);
+}
+
 /*- private API - signing of NSEC(3) in changeset ----------------------------*/
 
 /*!
@@ -625,6 +1072,7 @@ typedef struct {
 	const knot_dnssec_policy_t *policy;
 	knot_changeset_t *changeset;
 	hattrie_t *signed_tree;
+	sign_batch_t *batch;  //!< RR sets waiting for new signatures.
 } changeset_signing_data_t;
 
 /*!
@@ -1189,9 +1637,7 @@ static int sign_changeset_wrap(knot_rrset_t *chg_rrset, void *data)
 
 		if (should_sign) {
 			return force_resign_rrset(&zone_rrset, &rrsigs,
-			                          args->zone_keys,
-			                          args->policy,
-			                          args->changeset);
+			                          args->batch);
 		} else {
 			/*
 			 * If RRSet in zone DOES have RRSIGs although we
@@ -1244,6 +1690,209 @@ static void knot_zone_clear_sorted_changes(hattrie_t *t)
 	}
 }
 
+/*- signature reuse ----------------------------------------------------------*/
+
+/*!
+ * \brief Check if two RR sets have identical records, including TTLs.
+ */
+static bool rdataset_identical(const knot_rdataset_t *a,
+                               const knot_rdataset_t *b)
+{
+	if (!knot_rdataset_eq(a, b)) {
+		return false;
+	}
+
+	for (uint16_t i = 0; i < a->rr_count; ++i) {
+		if (knot_rdata_ttl(knot_rdataset_at(a, i)) !=
+		    knot_rdata_ttl(knot_rdataset_at(b, i))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * \brief Copy NSEC from the old node to the new one, if it lacks one.
+ *
+ * The chain is then only fixed by the NSEC chain creation, which replaces
+ * the NSECs that have changed.
+ */
+static int reuse_node_nsec(const zone_node_t *old_node, zone_node_t *new_node)
+{
+	if (new_node->rrset_count == 0 ||
+	    new_node->flags & NODE_FLAGS_NONAUTH ||
+	    node_rrtype_exists(new_node, KNOT_RRTYPE_NSEC)) {
+		return KNOT_EOK;
+	}
+
+	knot_rrset_t nsec = node_rrset(old_node, KNOT_RRTYPE_NSEC);
+	if (knot_rrset_empty(&nsec)) {
+		return KNOT_EOK;
+	}
+
+	return node_add_rrset(new_node, &nsec, NULL);
+}
+
+/*!
+ * \brief Copy signatures of unchanged RR sets from the old node to the new one.
+ *
+ * RR sets already signed in the new node are left untouched.
+ */
+static int reuse_node_rrsigs(const zone_node_t *old_node, zone_node_t *new_node,
+                             bool with_nsec, hattrie_t *trusted, size_t *reused)
+{
+	const knot_rdataset_t *old_rrsigs = node_rdataset(old_node,
+	                                                  KNOT_RRTYPE_RRSIG);
+	if (old_rrsigs == NULL) {
+		return KNOT_EOK;
+	}
+
+	if (with_nsec) {
+		int result = reuse_node_nsec(old_node, new_node);
+		if (result != KNOT_EOK) {
+			return result;
+		}
+	}
+
+	for (int i = 0; i < new_node->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(new_node, i);
+		if (rrset.type == KNOT_RRTYPE_RRSIG ||
+		    node_rrtype_is_signed(new_node, rrset.type)) {
+			continue;
+		}
+
+		const knot_rdataset_t *old_rrs = node_rdataset(old_node, rrset.type);
+		if (old_rrs == NULL || !rdataset_identical(old_rrs, &rrset.rrs)) {
+			continue;
+		}
+
+		knot_rrset_t rrsigs;
+		knot_rrset_init(&rrsigs, new_node->owner, KNOT_RRTYPE_RRSIG,
+		                KNOT_CLASS_IN);
+		int result = knot_synth_rrsig(rrset.type, old_rrsigs,
+		                              &rrsigs.rrs, NULL);
+		if (result == KNOT_ENOENT) {
+			continue; // not signed in the old zone
+		} else if (result != KNOT_EOK) {
+			return result;
+		}
+
+		// may reallocate node data, rrset is not used afterwards
+		uint16_t type = rrset.type;
+		result = node_add_rrset(new_node, &rrsigs, NULL);
+		knot_rdataset_clear(&rrsigs.rrs, NULL);
+		if (result == KNOT_EOK) {
+			result = trust_rrset(trusted, new_node, type);
+		}
+		if (result != KNOT_EOK) {
+			return result;
+		}
+
+		*reused += 1;
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Copy signatures of unchanged RR sets between two zone trees.
+ *
+ * Both trees are walked in canonical order at once, so that the matching
+ * nodes are found without lookups.
+ */
+static int reuse_tree_rrsigs(const knot_zone_tree_t *old_tree,
+                             const knot_zone_tree_t *new_tree, bool with_nsec,
+                             hattrie_t *trusted, size_t *reused)
+{
+	if (old_tree == NULL || new_tree == NULL) {
+		return KNOT_EOK;
+	}
+
+	knot_zone_tree_it_t *old_it = knot_zone_tree_it_begin(old_tree, true);
+	knot_zone_tree_it_t *new_it = knot_zone_tree_it_begin(new_tree, true);
+	if (old_it == NULL || new_it == NULL) {
+		knot_zone_tree_it_free(old_it);
+		knot_zone_tree_it_free(new_it);
+		return KNOT_ENOMEM;
+	}
+
+	int result = KNOT_EOK;
+	while (result == KNOT_EOK && !knot_zone_tree_it_finished(old_it) &&
+	       !knot_zone_tree_it_finished(new_it)) {
+		const zone_node_t *old_node = knot_zone_tree_it_val(old_it);
+		zone_node_t *new_node = knot_zone_tree_it_val(new_it);
+
+		int cmp = knot_dname_cmp(old_node->owner, new_node->owner);
+		if (cmp <= 0) {
+			knot_zone_tree_it_next(old_it);
+		}
+		if (cmp >= 0) {
+			knot_zone_tree_it_next(new_it);
+		}
+		if (cmp == 0) {
+			result = reuse_node_rrsigs(old_node, new_node, with_nsec,
+			                           trusted, reused);
+		}
+	}
+
+	knot_zone_tree_it_free(old_it);
+	knot_zone_tree_it_free(new_it);
+
+	return result;
+}
+
+/*!
+ * \brief Copy the NSEC3 chain with signatures into a zone without one.
+ *
+ * Stale NSEC3 records are removed by the NSEC3 chain creation, which also
+ * keeps the signatures of the unchanged ones.
+ */
+static int reuse_nsec3_chain(const knot_zone_contents_t *old_zone,
+                             knot_zone_contents_t *new_zone,
+                             hattrie_t *trusted)
+{
+	const knot_rdataset_t *old_params = node_rdataset(old_zone->apex,
+	                                               KNOT_RRTYPE_NSEC3PARAM);
+	const knot_rdataset_t *new_params = node_rdataset(new_zone->apex,
+	                                               KNOT_RRTYPE_NSEC3PARAM);
+	if (old_params == NULL || new_params == NULL ||
+	    !knot_rdataset_eq(old_params, new_params) ||
+	    knot_zone_tree_is_empty(old_zone->nsec3_nodes) ||
+	    !knot_zone_tree_is_empty(new_zone->nsec3_nodes)) {
+		return KNOT_EOK;
+	}
+
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(old_zone->nsec3_nodes,
+	                                                  false);
+	if (it == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int result = KNOT_EOK;
+	for (/* NOP */; result == KNOT_EOK && !knot_zone_tree_it_finished(it);
+	     knot_zone_tree_it_next(it)) {
+		const zone_node_t *old_node = knot_zone_tree_it_val(it);
+		zone_node_t *new_node = NULL;
+		for (int i = 0; result == KNOT_EOK && i < old_node->rrset_count; i++) {
+			knot_rrset_t rrset = node_rrset_at(old_node, i);
+			result = knot_zone_contents_add_rr(new_zone, &rrset,
+			                                   &new_node, NULL);
+			if (result == KNOT_EOK && rrset.type != KNOT_RRTYPE_RRSIG &&
+			    node_rrtype_is_signed(old_node, rrset.type)) {
+				result = trust_rrset(trusted, new_node, rrset.type);
+			}
+		}
+	}
+
+	knot_zone_tree_it_free(it);
+
+	// inserted nodes invalidated the canonical order index
+	knot_zone_tree_build_index(new_zone->nsec3_nodes);
+
+	return result;
+}
+
 /*- public API ---------------------------------------------------------------*/
 
 /*!
@@ -1252,6 +1901,7 @@ static void knot_zone_clear_sorted_changes(hattrie_t *t)
 int knot_zone_sign(const knot_zone_contents_t *zone,
                    const knot_zone_keys_t *zone_keys,
                    const knot_dnssec_policy_t *policy,
+                   hattrie_t *trusted,
                    knot_changeset_t *changeset,
                    uint32_t *refresh_at)
 {
@@ -1268,15 +1918,15 @@ int knot_zone_sign(const knot_zone_contents_t *zone,
 	}
 
 	uint32_t normal_tree_expiration = UINT32_MAX;
-	result = zone_tree_sign(zone->nodes, zone_keys, policy, changeset,
-	                        &normal_tree_expiration);
+	result = zone_tree_sign(zone->nodes, zone_keys, policy, trusted,
+	                        changeset, &normal_tree_expiration);
 	if (result != KNOT_EOK) {
 		dbg_dnssec_detail("zone_tree_sign() on normal nodes failed\n");
 		return result;
 	}
 
 	uint32_t nsec3_tree_expiration = UINT32_MAX;
-	result = zone_tree_sign(zone->nsec3_nodes, zone_keys, policy,
+	result = zone_tree_sign(zone->nsec3_nodes, zone_keys, policy, trusted,
 	                        changeset, &nsec3_tree_expiration);
 	if (result != KNOT_EOK) {
 		dbg_dnssec_detail("zone_tree_sign() on nsec3 nodes failed\n");
@@ -1295,6 +1945,64 @@ int knot_zone_sign(const knot_zone_contents_t *zone,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Refresh a bounded slice of the oldest zone signatures.
+ */
+int knot_zone_sign_refresh(const knot_zone_contents_t *zone,
+                           const knot_zone_keys_t *zone_keys,
+                           const knot_dnssec_policy_t *policy,
+                           knot_changeset_t *changeset,
+                           uint32_t *refresh_at)
+{
+	if (!zone || !zone_keys || !policy || !changeset || !refresh_at) {
+		return KNOT_EINVAL;
+	}
+
+	node_refresh_args_t args = {
+		.zone_keys = zone_keys,
+		.policy = policy,
+		.changeset = changeset,
+		.refresh_before = policy->refresh_before,
+		.refresh_ties = SIZE_MAX,
+		.expires_at = UINT32_MAX
+	};
+
+	// collect signatures due for refresh, bound the slice
+	int result = knot_zone_tree_apply(zone->nodes, collect_due_rrsigs, &args);
+	if (result == KNOT_EOK) {
+		result = knot_zone_tree_apply(zone->nsec3_nodes,
+		                              collect_due_rrsigs, &args);
+	}
+	if (result == KNOT_EOK) {
+		args.refresh_before = refresh_slice_horizon(&args);
+	}
+	free(args.due);
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	result = knot_zone_tree_apply(zone->nodes, refresh_node, &args);
+	if (result != KNOT_EOK) {
+		dbg_dnssec_detail("refresh_node() on normal nodes failed\n");
+		return result;
+	}
+
+	result = knot_zone_tree_apply(zone->nsec3_nodes, refresh_node, &args);
+	if (result != KNOT_EOK) {
+		dbg_dnssec_detail("refresh_node() on nsec3 nodes failed\n");
+		return result;
+	}
+
+	// next slice when kept or new signatures need refresh
+	uint32_t new_expiration = policy->now + policy->sign_lifetime -
+	                          policy->sign_jitter;
+	uint32_t expiration = MIN(args.expires_at, new_expiration);
+	uint32_t next = knot_dnssec_policy_refresh_time(policy, expiration);
+	*refresh_at = MAX(next, policy->now + policy->resign_tick);
+
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Check if zone SOA signatures are expired.
  */
@@ -1406,12 +2114,17 @@ int knot_zone_sign_changeset(const knot_zone_contents_t *zone,
 		return KNOT_EINVAL;
 	}
 
+	// Changed RR sets are signed in batches
+	sign_batch_t batch;
+	sign_batch_init(&batch, NULL, zone_keys, policy, out_ch);
+
 	// Create args for wrapper function - hattrie for duplicate sigs
 	changeset_signing_data_t args = { .zone = zone,
 	                                  .zone_keys = zone_keys,
 	                                  .policy = policy,
 	                                  .changeset = out_ch,
-	                                  .signed_tree = hattrie_create()};
+	                                  .signed_tree = hattrie_create(),
+	                                  .batch = &batch };
 	if (args.signed_tree == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -1428,6 +2141,10 @@ int knot_zone_sign_changeset(const knot_zone_contents_t *zone,
 		                           sign_changeset_wrap, &args);
 	}
 
+	if (ret == KNOT_EOK) {
+		ret = sign_batch_flush(&batch);
+	}
+
 	knot_zone_clear_sorted_changes(args.signed_tree);
 	hattrie_free(args.signed_tree);
 
@@ -1506,3 +2223,39 @@ int knot_zone_sign_rr_should_be_signed(const zone_node_t *node,
 	*should_sign = true;
 	return KNOT_EOK;
 }
+
+/*!
+ * \brief Copy signatures of unchanged RR sets from the previous zone version.
+ */
+int knot_zone_sign_reuse(const knot_zone_contents_t *old_zone,
+                         knot_zone_contents_t *new_zone, hattrie_t *trusted,
+                         size_t *reused)
+{
+	if (!old_zone || !new_zone || !reused) {
+		return KNOT_EINVAL;
+	}
+
+	*reused = 0;
+
+	bool nsec3_enabled = knot_is_nsec3_enabled(new_zone);
+	bool with_nsec = !nsec3_enabled &&
+	                 !node_rrtype_exists(new_zone->apex, KNOT_RRTYPE_NSEC);
+
+	int result = KNOT_EOK;
+	if (nsec3_enabled) {
+		result = reuse_nsec3_chain(old_zone, new_zone, trusted);
+	}
+
+	if (result == KNOT_EOK) {
+		result = reuse_tree_rrsigs(old_zone->nodes, new_zone->nodes,
+		                           with_nsec, trusted, reused);
+	}
+
+	if (result == KNOT_EOK && nsec3_enabled) {
+		result = reuse_tree_rrsigs(old_zone->nsec3_nodes,
+		                           new_zone->nsec3_nodes, false, trusted,
+		                           reused);
+	}
+
+	return result;
+}
@@ -29,6 +29,7 @@
 #ifndef _KNOT_DNSSEC_ZONE_SIGN_H_
 #define _KNOT_DNSSEC_ZONE_SIGN_H_
 
+#include "common/hattrie/hat-trie.h"
 #include "knot/updates/changesets.h"
 #include "knot/zone/zone.h"
 #include "knot/zone/zone-contents.h"
@@ -51,9 +52,14 @@ typedef struct signed_info {
  *
  * Updates RRSIGs, NSEC(3)s, and DNSKEYs.
  *
+ * Signatures of the RR sets in the trusted set are not verified, only their
+ * expiration and key algorithm are checked.
+ *
  * \param zone        Zone to be signed.
  * \param zone_keys   Zone keys.
  * \param policy      DNSSEC policy.
+ * \param trusted     RR sets with reused signatures (may be NULL), see
+ *                    knot_zone_sign_reuse().
  * \param changeset   Changeset to be updated.
  * \param refresh_at  Pointer to refresh time when the zone should be resigned.
  *
@@ -62,8 +68,30 @@ typedef struct signed_info {
 int knot_zone_sign(const knot_zone_contents_t *zone,
                    const knot_zone_keys_t *zone_keys,
                    const knot_dnssec_policy_t *policy,
+                   hattrie_t *trusted,
                    knot_changeset_t *out_ch, uint32_t *refresh_at);
 
+/*!
+ * \brief Refresh a bounded slice of the oldest zone signatures.
+ *
+ * Only RR sets with signatures expiring before the policy refresh time are
+ * re-signed, the oldest first. Their number is bounded, so that periodic
+ * refreshes produce small changesets of even size. SOA is not refreshed,
+ * missing and invalid signatures are left to the complete signing.
+ *
+ * \param zone        Zone to be refreshed.
+ * \param zone_keys   Zone keys.
+ * \param policy      DNSSEC policy.
+ * \param out_ch      Changeset to be updated.
+ * \param refresh_at  Pointer to time of the next refresh.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_zone_sign_refresh(const knot_zone_contents_t *zone,
+                           const knot_zone_keys_t *zone_keys,
+                           const knot_dnssec_policy_t *policy,
+                           knot_changeset_t *out_ch, uint32_t *refresh_at);
+
 /*!
  * \brief Update and sign SOA and store performed changes in changeset.
  *
@@ -139,6 +167,30 @@ int knot_zone_sign_rr_should_be_signed(const zone_node_t *node,
                                        const knot_rrset_t *rrset,
                                        bool *should_sign);
 
+/*!
+ * \brief Copy signatures of unchanged RR sets from the previous zone version.
+ *
+ * Signatures are copied for RR sets with records (including TTLs) identical
+ * in both versions, unless the RR set is already signed in the new version.
+ * If the new version has no NSEC or NSEC3 chain, the previous chain is
+ * copied as well, so that the chain creation replaces only changed records.
+ *
+ * The signatures were validated in the previous version, the RR sets with
+ * copied signatures are stored in the trusted set, keyed by owner and type.
+ * The subsequent signing checks only expiration and keys of the trusted
+ * signatures and replaces those that are expired or made by retired keys.
+ *
+ * \param old_zone  Previous zone contents.
+ * \param new_zone  New zone contents, not yet published.
+ * \param trusted   Set of RR sets with copied signatures (may be NULL).
+ * \param reused    Number of RR sets with copied signatures.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_zone_sign_reuse(const knot_zone_contents_t *old_zone,
+                         knot_zone_contents_t *new_zone, hattrie_t *trusted,
+                         size_t *reused);
+
 #endif // _KNOT_DNSSEC_ZONE_SIGN_H_
 
 /*! @} */
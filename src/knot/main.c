@@ -36,6 +36,7 @@
 #include "knot/ctl/process.h"
 #include "knot/ctl/remote.h"
 #include "knot/conf/conf.h"
+#include "knot/dnssec/zone-keys.h"
 #include "knot/conf/logconf.h"
 #include "knot/server/zones.h"
 #include "knot/server/tcp-handler.h"
@@ -56,6 +57,7 @@ static void init_signal_started(void)
 /*! \brief atexit() handler for server code. */
 static void knot_crypto_deinit(void)
 {
+	knot_zone_keys_cache_clear();
 	knot_crypto_cleanup();
 	knot_crypto_cleanup_threads();
 }
@@ -0,0 +1,867 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "knot/modules/online_sign.h"
+#include "knot/nameserver/query_module.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/nameserver/internet.h"
+#include "knot/dnssec/nsec-chain.h"
+#include "knot/zone/zone-contents.h"
+#include "common/hattrie/murmurhash3.h"
+#include "common/hhash.h"
+#include "common/descriptor.h"
+#include "libknot/dnssec/bitmap.h"
+#include "libknot/dnssec/key.h"
+#include "libknot/dnssec/policy.h"
+#include "libknot/dnssec/rrset-sign.h"
+#include "libknot/dnssec/sign.h"
+#include "libknot/rdata/rrsig.h"
+#include "libknot/rdata/soa.h"
+
+/* Defines. */
+#define MODULE_ERR(msg...) log_zone_error("Module 'online_sign': " msg)
+#define LABEL_MAXLEN 63
+#define CACHE_SIZE 4096               /* Signatures cached per worker. */
+#define SIGN_LIFETIME (7 * 24 * 3600) /* Signature life time. */
+#define SIGN_SKEW 3600                /* Inception backdated for clock skew. */
+#define CACHE_KEY_MAXLEN (2 * sizeof(uint32_t) + sizeof(uint16_t) + KNOT_DNAME_MAXLEN)
+
+/*!
+ * \brief Module instance, signs responses from a single zone.
+ */
+typedef struct online_sign {
+	uint32_t id;            /*!< Instance identifier in the caches. */
+	knot_dnssec_key_t key;  /*!< Zone signing key. */
+} online_sign_t;
+
+/*!
+ * \brief Cached signature of an RR set.
+ */
+typedef struct sig_entry {
+	node_t node;             /*!< Node in the LRU list. */
+	char *key;               /*!< Lookup key. */
+	uint16_t key_len;
+	knot_rdataset_t covered; /*!< Signed records, to rule out collisions. */
+	knot_rdataset_t rrsig;   /*!< Signature. */
+} sig_entry_t;
+
+/*!
+ * \brief Signature cache of a worker, shared by the module instances.
+ */
+typedef struct sig_cache {
+	hhash_t *table;  /*!< Entries by owner, type, and hash of the records. */
+	list_t lru;      /*!< Entries, the most recently used first. */
+	unsigned count;  /*!< Number of entries. */
+} sig_cache_t;
+
+/*!
+ * \brief Signing state of a single processing step.
+ */
+typedef struct sign_state {
+	const online_sign_t *osign;
+	sig_cache_t *cache;               /*!< Worker cache (may be NULL). */
+	knot_dnssec_sign_context_t *ctx;  /*!< Created with the first signature. */
+	knot_dnssec_policy_t policy;
+	uint16_t uncached_from;           /*!< First RR with unique signature. */
+} sign_state_t;
+
+static uint32_t instance_count = 0;
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+/*- Signature cache ----------------------------------------------------------*/
+
+static void entry_free(sig_entry_t *entry)
+{
+	knot_rdataset_clear(&entry->covered, NULL);
+	knot_rdataset_clear(&entry->rrsig, NULL);
+	free(entry->key);
+	free(entry);
+}
+
+static void cache_free(void *data)
+{
+	sig_cache_t *cache = data;
+	sig_entry_t *entry = NULL, *next = NULL;
+	WALK_LIST_DELSAFE(entry, next, cache->lru) {
+		entry_free(entry);
+	}
+	hhash_free(cache->table);
+	free(cache);
+}
+
+static void cache_init(void)
+{
+	pthread_key_create(&cache_key, cache_free);
+}
+
+/*! \brief Get signature cache of the calling thread. */
+static sig_cache_t *cache_get(void)
+{
+	pthread_once(&cache_once, cache_init);
+	sig_cache_t *cache = pthread_getspecific(cache_key);
+	if (cache != NULL) {
+		return cache;
+	}
+
+	cache = malloc(sizeof(sig_cache_t));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	memset(cache, 0, sizeof(sig_cache_t));
+	init_list(&cache->lru);
+
+	/* Spare buckets keep the hopscotch neighbourhoods from filling up. */
+	cache->table = hhash_create(2 * CACHE_SIZE);
+	if (cache->table == NULL) {
+		free(cache);
+		return NULL;
+	}
+
+	pthread_setspecific(cache_key, cache);
+	return cache;
+}
+
+static void cache_evict(sig_cache_t *cache, sig_entry_t *entry)
+{
+	hhash_del(cache->table, entry->key, entry->key_len);
+	rem_node(&entry->node);
+	entry_free(entry);
+	cache->count -= 1;
+}
+
+/*! \brief Compose lookup key, the records are represented by their hash. */
+static uint16_t cache_key_write(char *dst, uint32_t id, const knot_rrset_t *rr)
+{
+	uint32_t rr_hash = hash((const char *)rr->rrs.data,
+	                        knot_rdataset_size(&rr->rrs));
+	uint16_t owner_size = knot_dname_size(rr->owner);
+
+	char *w = dst;
+	memcpy(w, &id, sizeof(id));
+	w += sizeof(id);
+	memcpy(w, &rr->type, sizeof(rr->type));
+	w += sizeof(rr->type);
+	memcpy(w, &rr_hash, sizeof(rr_hash));
+	w += sizeof(rr_hash);
+	memcpy(w, rr->owner, owner_size);
+	w += owner_size;
+
+	return w - dst;
+}
+
+/*! \brief Check if the entry holds a fresh signature of the records. */
+static bool entry_valid(const sig_entry_t *entry, const knot_rrset_t *covered,
+                        const knot_dnssec_policy_t *policy)
+{
+	size_t size = knot_rdataset_size(&entry->covered);
+	return entry->covered.rr_count == covered->rrs.rr_count &&
+	       size == knot_rdataset_size(&covered->rrs) &&
+	       memcmp(entry->covered.data, covered->rrs.data, size) == 0 &&
+	       knot_rrsig_sig_expiration(&entry->rrsig, 0) > policy->refresh_before;
+}
+
+/*! \brief Store signature in the cache, the cache takes its ownership. */
+static void cache_insert(sig_cache_t *cache, const char *key, uint16_t key_len,
+                         const knot_rrset_t *covered, knot_rdataset_t *rrsig)
+{
+	if (cache->count >= CACHE_SIZE) {
+		cache_evict(cache, TAIL(cache->lru));
+	}
+
+	sig_entry_t *entry = malloc(sizeof(sig_entry_t));
+	if (entry == NULL) {
+		knot_rdataset_clear(rrsig, NULL);
+		return;
+	}
+
+	memset(entry, 0, sizeof(sig_entry_t));
+	entry->rrsig = *rrsig;
+	knot_rdataset_init(rrsig);
+
+	entry->key = malloc(key_len);
+	if (entry->key == NULL ||
+	    knot_rdataset_copy(&entry->covered, &covered->rrs, NULL) != KNOT_EOK) {
+		entry_free(entry);
+		return;
+	}
+	memcpy(entry->key, key, key_len);
+	entry->key_len = key_len;
+
+	/* Entries not fitting into the table are not cached. */
+	if (hhash_insert(cache->table, key, key_len, entry) != KNOT_EOK) {
+		entry_free(entry);
+		return;
+	}
+
+	add_head(&cache->lru, &entry->node);
+	cache->count += 1;
+}
+
+/*- Signing ------------------------------------------------------------------*/
+
+static void sign_state_init(sign_state_t *state, const online_sign_t *osign)
+{
+	memset(state, 0, sizeof(sign_state_t));
+	state->osign = osign;
+	state->cache = cache_get();
+	state->uncached_from = KNOT_PKT_MAX_RRS;
+
+	/* Backdated inception, signatures are refreshed before expiration. */
+	knot_dnssec_init_default_policy(&state->policy);
+	state->policy.now -= SIGN_SKEW;
+	knot_dnssec_policy_set_sign_lifetime(&state->policy, SIGN_LIFETIME);
+}
+
+static void sign_state_clear(sign_state_t *state)
+{
+	knot_dnssec_sign_free(state->ctx);
+	state->ctx = NULL;
+}
+
+/*!
+ * \brief Get signature of the RR set, from the cache if possible.
+ *
+ * \param state     Signing state.
+ * \param covered   RR set to be signed.
+ * \param use_cache Look up and store the signature in the cache.
+ * \param out       Output signature.
+ * \param mm        Memory context of the output.
+ */
+static int sign_rrset(sign_state_t *state, const knot_rrset_t *covered,
+                      bool use_cache, knot_rdataset_t *out, mm_ctx_t *mm)
+{
+	sig_cache_t *cache = use_cache ? state->cache : NULL;
+	char key[CACHE_KEY_MAXLEN];
+	uint16_t key_len = 0;
+
+	if (cache != NULL) {
+		key_len = cache_key_write(key, state->osign->id, covered);
+		value_t *val = hhash_find(cache->table, key, key_len);
+		sig_entry_t *entry = (val != NULL) ? *val : NULL;
+		if (entry != NULL && entry_valid(entry, covered, &state->policy)) {
+			rem_node(&entry->node);
+			add_head(&cache->lru, &entry->node);
+			return knot_rdataset_copy(out, &entry->rrsig, mm);
+		}
+
+		/* Expired signature or different records. */
+		if (entry != NULL) {
+			cache_evict(cache, entry);
+		}
+	}
+
+	if (state->ctx == NULL) {
+		state->ctx = knot_dnssec_sign_init(&state->osign->key);
+		if (state->ctx == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	knot_rrset_t rrsig;
+	knot_rrset_init(&rrsig, covered->owner, KNOT_RRTYPE_RRSIG, covered->rclass);
+	int ret = knot_sign_rrset(&rrsig, covered, &state->osign->key, state->ctx,
+	                          &state->policy);
+	if (ret == KNOT_EOK) {
+		ret = knot_rdataset_copy(out, &rrsig.rrs, mm);
+	}
+
+	if (ret == KNOT_EOK && cache != NULL) {
+		cache_insert(cache, key, key_len, covered, &rrsig.rrs);
+	} else {
+		knot_rdataset_clear(&rrsig.rrs, NULL);
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Check if the RR set is authoritative data of the zone.
+ *
+ * \param zone         Zone contents.
+ * \param rr           RR set in the response.
+ * \param synthesized  Set if the owner is not in the zone (expanded wildcard,
+ *                     synthesized record or white lie).
+ */
+static bool need_signature(const knot_zone_contents_t *zone,
+                           const knot_rrset_t *rr, bool *synthesized)
+{
+	*synthesized = false;
+
+	if (rr->type == KNOT_RRTYPE_RRSIG) {
+		return false;
+	}
+
+	const knot_dname_t *apex = zone->apex->owner;
+	if (!knot_dname_is_equal(rr->owner, apex) &&
+	    !knot_dname_is_sub(rr->owner, apex)) {
+		return false;
+	}
+
+	const zone_node_t *node = knot_zone_contents_find_node(zone, rr->owner);
+	if (node == NULL) {
+		/* Expanded wildcards, synthesized records and white lies. */
+		*synthesized = true;
+		return true;
+	}
+
+	if (node->flags & NODE_FLAGS_NONAUTH) {
+		return false;
+	}
+
+	/* Only DS and NSEC are authoritative at a delegation point. */
+	if (node->flags & NODE_FLAGS_DELEG) {
+		return rr->type == KNOT_RRTYPE_DS || rr->type == KNOT_RRTYPE_NSEC;
+	}
+
+	return true;
+}
+
+/*! \brief Sign RR sets in the current packet section. */
+static int sign_section(knot_pkt_t *pkt, struct query_data *qdata,
+                        sign_state_t *state, bool optional)
+{
+	const knot_pktsection_t *section = knot_pkt_section(pkt, pkt->current);
+	uint16_t from = section->rr - pkt->rr;
+	uint16_t to = from + section->count;
+	uint32_t flags = KNOT_PF_FREE;
+	if (optional) {
+		flags |= KNOT_PF_NOTRUNC;
+	}
+
+	const knot_zone_contents_t *zone = qdata->zone->contents;
+	for (uint16_t i = from; i < to; ++i) {
+		const knot_rrset_t *rr = &pkt->rr[i];
+		bool synthesized = false;
+		if (!need_signature(zone, rr, &synthesized)) {
+			continue;
+		}
+
+		/* Expanded wildcards and synthesized answers are unique to
+		 * the query like the name covers, don't push out others. */
+		bool use_cache = i < state->uncached_from &&
+		                 !(synthesized && pkt->current == KNOT_ANSWER);
+
+		knot_rrset_t rrsig;
+		knot_rrset_init(&rrsig, NULL, KNOT_RRTYPE_RRSIG, rr->rclass);
+		int ret = sign_rrset(state, rr, use_cache, &rrsig.rrs, &pkt->mm);
+		if (ret == KNOT_EOK) {
+			rrsig.owner = knot_dname_copy(rr->owner, &pkt->mm);
+			if (rrsig.owner == NULL) {
+				ret = KNOT_ENOMEM;
+			}
+		}
+
+		/* Expanded wildcards share the owner with the signed records. */
+		if (ret == KNOT_EOK) {
+			uint16_t compr_hint = pkt->rr_info[i].compress_ptr[COMPR_HINT_OWNER];
+			ret = knot_pkt_put(pkt, compr_hint, &rrsig, flags);
+		}
+
+		if (ret != KNOT_EOK) {
+			knot_rrset_clear(&rrsig, &pkt->mm);
+			/* Signatures in ADDITIONAL are optional. */
+			return (optional && ret == KNOT_ESPACE) ? KNOT_EOK : ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*- White lies ---------------------------------------------------------------*/
+
+/*! \brief Decrement label octet, uppercase letters sort as lowercase. */
+static uint8_t octet_prev(uint8_t octet)
+{
+	octet -= 1;
+	if (octet >= 'A' && octet <= 'Z') {
+		octet = 'A' - 1;
+	}
+	return octet;
+}
+
+/*!
+ * \brief Compare names in canonical order (RFC 4034, section 6.1).
+ *
+ * Unlike knot_dname_cmp(), labels containing zero octets are ordered
+ * correctly, the names are expected in lowercase.
+ */
+static int dname_cmp_canonical(const knot_dname_t *d1, const knot_dname_t *d2)
+{
+	const uint8_t *labels1[KNOT_DNAME_MAXLABELS];
+	const uint8_t *labels2[KNOT_DNAME_MAXLABELS];
+	int count1 = 0, count2 = 0;
+	for (; *d1 != 0; d1 = knot_wire_next_label(d1, NULL)) {
+		labels1[count1++] = d1;
+	}
+	for (; *d2 != 0; d2 = knot_wire_next_label(d2, NULL)) {
+		labels2[count2++] = d2;
+	}
+
+	/* Compare labels from the root. */
+	while (count1 > 0 && count2 > 0) {
+		const uint8_t *l1 = labels1[--count1];
+		const uint8_t *l2 = labels2[--count2];
+		int ret = memcmp(l1 + 1, l2 + 1, MIN(l1[0], l2[0]));
+		if (ret == 0) {
+			ret = (int)l1[0] - (int)l2[0];
+		}
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
+	return count1 - count2;
+}
+
+/*!
+ * \brief Write the closest predecessor of a nonexistent name, which follows
+ *        the previous existing name in the zone.
+ *
+ * A short name is used if it follows the previous name, the immediate
+ * predecessor (RFC 4470, section 3.1.2) is used otherwise.
+ */
+static void name_predecessor(const knot_dname_t *name, const knot_dname_t *prev,
+                             uint8_t *out)
+{
+	const knot_dname_t *parent = knot_wire_next_label(name, NULL);
+	size_t parent_size = knot_dname_size(parent);
+
+	/* The smallest child immediately follows its parent. */
+	if (name[0] == 1 && name[1] == 0) {
+		memcpy(out, parent, parent_size);
+		return;
+	}
+
+	/* Drop the trailing zero or decrement the last octet of the label. */
+	uint8_t label[LABEL_MAXLEN];
+	uint8_t label_len = name[0];
+	memcpy(label, name + 1, label_len);
+	bool shortened = (label[label_len - 1] == 0);
+	if (shortened) {
+		label_len -= 1;
+	} else {
+		label[label_len - 1] = octet_prev(label[label_len - 1]);
+	}
+
+	out[0] = label_len;
+	memcpy(out + 1, label, label_len);
+	memcpy(out + 1 + label_len, parent, parent_size);
+	if (dname_cmp_canonical(out, prev) > 0) {
+		return;
+	}
+
+	/* Longest label with the decremented prefix. */
+	if (!shortened) {
+		size_t room = KNOT_DNAME_MAXLEN - parent_size - 1;
+		while (label_len < MIN(LABEL_MAXLEN, room)) {
+			label[label_len++] = 0xff;
+		}
+	}
+
+	/* Its last descendant, labels of 0xff up to the name length limit. */
+	size_t room = KNOT_DNAME_MAXLEN - parent_size - 1 - label_len;
+	uint8_t *w = out;
+	while (room >= 2) {
+		uint8_t len = MIN(LABEL_MAXLEN, room - 1);
+		*w++ = len;
+		memset(w, 0xff, len);
+		w += len;
+		room -= len + 1;
+	}
+
+	*w++ = label_len;
+	memcpy(w, label, label_len);
+	w += label_len;
+	memcpy(w, parent, parent_size);
+}
+
+/*! \brief Write the immediate successor of a name, its smallest child. */
+static int name_successor(const knot_dname_t *name, uint8_t *out)
+{
+	size_t size = knot_dname_size(name);
+	if (size + 2 > KNOT_DNAME_MAXLEN) {
+		return KNOT_ESPACE;
+	}
+
+	out[0] = 1;
+	out[1] = 0;
+	memcpy(out + 2, name, size);
+	return KNOT_EOK;
+}
+
+/*! \brief Put NSEC into the packet, with types of the node if given. */
+static int put_nsec(knot_pkt_t *pkt, struct query_data *qdata,
+                    const knot_dname_t *owner, const knot_dname_t *next,
+                    const zone_node_t *node)
+{
+	const knot_zone_contents_t *zone = qdata->zone->contents;
+
+	bitmap_t types = { 0 };
+	if (node != NULL && (node->flags & NODE_FLAGS_DELEG)) {
+		bitmap_add_type(&types, KNOT_RRTYPE_NS);
+		if (node_rrtype_exists(node, KNOT_RRTYPE_DS)) {
+			bitmap_add_type(&types, KNOT_RRTYPE_DS);
+		}
+	} else if (node != NULL) {
+		bitmap_add_node_rrsets(&types, node);
+		/* DNSKEY is synthesized when missing. */
+		if (node == zone->apex) {
+			bitmap_add_type(&types, KNOT_RRTYPE_DNSKEY);
+		}
+	}
+	bitmap_add_type(&types, KNOT_RRTYPE_NSEC);
+	bitmap_add_type(&types, KNOT_RRTYPE_RRSIG);
+
+	size_t next_size = knot_dname_size(next);
+	size_t rdata_size = next_size + bitmap_size(&types);
+	uint8_t rdata[rdata_size];
+	memcpy(rdata, next, next_size);
+	bitmap_write(&types, rdata + next_size);
+
+	knot_rrset_t nsec;
+	knot_rrset_init(&nsec, knot_dname_copy(owner, &pkt->mm), KNOT_RRTYPE_NSEC,
+	                KNOT_CLASS_IN);
+	if (nsec.owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	const knot_rdataset_t *soa = node_rdataset(zone->apex, KNOT_RRTYPE_SOA);
+	int ret = knot_rrset_add_rdata(&nsec, rdata, rdata_size,
+	                               knot_soa_minimum(soa), &pkt->mm);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_put(pkt, COMPR_HINT_NONE, &nsec, KNOT_PF_FREE);
+	}
+
+	if (ret != KNOT_EOK) {
+		knot_rrset_clear(&nsec, &pkt->mm);
+	}
+
+	return ret;
+}
+
+/*! \brief Put NSEC covering a nonexistent name. */
+static int put_nsec_cover(knot_pkt_t *pkt, struct query_data *qdata,
+                          const knot_dname_t *name)
+{
+	/* Names without room for a child are left unproven. */
+	uint8_t next[KNOT_DNAME_MAXLEN];
+	if (name_successor(name, next) != KNOT_EOK) {
+		return KNOT_EOK;
+	}
+
+	const zone_node_t *prev =
+		knot_zone_contents_find_previous(qdata->zone->contents, name);
+	if (prev == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Immediate predecessor may be the previous name itself. */
+	uint8_t owner[KNOT_DNAME_MAXLEN];
+	name_predecessor(name, prev->owner, owner);
+	if (!knot_dname_is_equal(owner, prev->owner)) {
+		prev = NULL;
+	}
+
+	return put_nsec(pkt, qdata, owner, next, prev);
+}
+
+/*! \brief Put NSEC listing types of an existing node. */
+static int put_nsec_node(knot_pkt_t *pkt, struct query_data *qdata,
+                         const zone_node_t *node)
+{
+	uint8_t next[KNOT_DNAME_MAXLEN];
+	if (name_successor(node->owner, next) != KNOT_EOK) {
+		return KNOT_EOK;
+	}
+
+	return put_nsec(pkt, qdata, node->owner, next, node);
+}
+
+/*! \brief Prove nonexistence of the name and of the source of synthesis. */
+static int prove_nxdomain(knot_pkt_t *pkt, struct query_data *qdata,
+                          sign_state_t *state)
+{
+	uint8_t wildcard[KNOT_DNAME_MAXLEN];
+	size_t encloser_size = knot_dname_size(qdata->encloser->owner);
+	bool have_wildcard = (encloser_size + 2 <= KNOT_DNAME_MAXLEN);
+	if (have_wildcard) {
+		wildcard[0] = 1;
+		wildcard[1] = '*';
+		memcpy(wildcard + 2, qdata->encloser->owner, encloser_size);
+	}
+
+	int ret = KNOT_EOK;
+	if (have_wildcard) {
+		ret = put_nsec_cover(pkt, qdata, wildcard);
+	}
+
+	/* Signatures of the name cover are unique to the query. */
+	state->uncached_from = pkt->rrset_count;
+	if (ret == KNOT_EOK &&
+	    !(have_wildcard && knot_dname_is_equal(wildcard, qdata->name))) {
+		ret = put_nsec_cover(pkt, qdata, qdata->name);
+	}
+
+	return ret;
+}
+
+/*! \brief Prove absence of the type, or of the DS at a delegation. */
+static int prove_nodata(knot_pkt_t *pkt, struct query_data *qdata,
+                        sign_state_t *state)
+{
+	int ret = KNOT_EOK;
+
+	/* Names synthesized by other modules have no node. */
+	if (qdata->node != NULL) {
+		ret = put_nsec_node(pkt, qdata, qdata->node);
+	}
+
+	state->uncached_from = pkt->rrset_count;
+	return ret;
+}
+
+static int prove_delegation(knot_pkt_t *pkt, struct query_data *qdata,
+                            sign_state_t *state)
+{
+	knot_rrset_t ds = node_rrset(qdata->node, KNOT_RRTYPE_DS);
+	if (!knot_rrset_empty(&ds)) {
+		return knot_pkt_put(pkt, COMPR_HINT_NONE, &ds, 0);
+	}
+
+	return prove_nodata(pkt, qdata, state);
+}
+
+/*! \brief Prove that the names expanded from wildcards do not exist. */
+static int prove_wildcards(knot_pkt_t *pkt, struct query_data *qdata,
+                           sign_state_t *state)
+{
+	if (state->uncached_from == KNOT_PKT_MAX_RRS) {
+		state->uncached_from = pkt->rrset_count;
+	}
+
+	struct wildcard_hit *item = NULL;
+	WALK_LIST(item, qdata->wildcards) {
+		int ret = put_nsec_cover(pkt, qdata, item->sname);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Put DNSKEY of the zone key. */
+static int put_dnskey(knot_pkt_t *pkt, struct query_data *qdata,
+                      const online_sign_t *osign)
+{
+	const zone_node_t *apex = qdata->zone->contents->apex;
+
+	knot_rrset_t dnskey;
+	knot_rrset_init(&dnskey, knot_dname_copy(apex->owner, &pkt->mm),
+	                KNOT_RRTYPE_DNSKEY, KNOT_CLASS_IN);
+	if (dnskey.owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t soa = node_rrset(apex, KNOT_RRTYPE_SOA);
+	const knot_binary_t *rdata = &osign->key.dnskey_rdata;
+	int ret = knot_rrset_add_rdata(&dnskey, rdata->data, rdata->size,
+	                               knot_rrset_rr_ttl(&soa, 0), &pkt->mm);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_put(pkt, COMPR_HINT_NONE, &dnskey, KNOT_PF_FREE);
+	}
+
+	if (ret != KNOT_EOK) {
+		knot_rrset_clear(&dnskey, &pkt->mm);
+	}
+
+	return ret;
+}
+
+/*- Query processing ---------------------------------------------------------*/
+
+/*! \brief Check if the response should be signed by the module. */
+static bool online_sign_enabled(int state, struct query_data *qdata,
+                                const online_sign_t *osign)
+{
+	/* Zones signed in advance are answered from their contents. */
+	return state != TRUNC && state != ERROR &&
+	       knot_pkt_have_dnssec(qdata->query) &&
+	       !knot_zone_contents_is_signed(qdata->zone->contents) &&
+	       knot_dname_is_equal(qdata->zone->name, osign->key.name);
+}
+
+/*! \brief Evaluate the step state from the result. */
+static int step_state(int state, int ret)
+{
+	switch (ret) {
+	case KNOT_EOK:    return state; /* Keep current state. */
+	case KNOT_ESPACE: return TRUNC; /* Truncated. */
+	default:          return ERROR; /* Error. */
+	}
+}
+
+static int online_sign_answer(int state, knot_pkt_t *pkt,
+                              struct query_data *qdata, void *ctx)
+{
+	const online_sign_t *osign = ctx;
+	if (pkt == NULL || qdata == NULL || osign == NULL ||
+	    !online_sign_enabled(state, qdata, osign)) {
+		return state;
+	}
+
+	int ret = KNOT_EOK;
+	const zone_node_t *apex = qdata->zone->contents->apex;
+	if (state == NODATA && qdata->node == apex &&
+	    knot_pkt_qtype(qdata->query) == KNOT_RRTYPE_DNSKEY &&
+	    !node_rrtype_exists(apex, KNOT_RRTYPE_DNSKEY)) {
+		ret = put_dnskey(pkt, qdata, osign);
+		state = HIT;
+	}
+
+	sign_state_t sign;
+	sign_state_init(&sign, osign);
+	if (ret == KNOT_EOK) {
+		ret = sign_section(pkt, qdata, &sign, false);
+	}
+	sign_state_clear(&sign);
+
+	return step_state(state, ret);
+}
+
+static int online_sign_authority(int state, knot_pkt_t *pkt,
+                                 struct query_data *qdata, void *ctx)
+{
+	const online_sign_t *osign = ctx;
+	if (pkt == NULL || qdata == NULL || osign == NULL ||
+	    !online_sign_enabled(state, qdata, osign)) {
+		return state;
+	}
+
+	sign_state_t sign;
+	sign_state_init(&sign, osign);
+
+	/* Authenticated denial of existence. */
+	int ret = KNOT_EOK;
+	switch (state) {
+	case MISS:   ret = prove_nxdomain(pkt, qdata, &sign); break;
+	case NODATA: ret = prove_nodata(pkt, qdata, &sign); break;
+	case DELEG:  ret = prove_delegation(pkt, qdata, &sign); break;
+	default:     break;
+	}
+
+	/* Visited wildcards, not applicable to referrals. */
+	if (ret == KNOT_EOK && state != DELEG) {
+		ret = prove_wildcards(pkt, qdata, &sign);
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = sign_section(pkt, qdata, &sign, false);
+	}
+	sign_state_clear(&sign);
+
+	return step_state(state, ret);
+}
+
+static int online_sign_additional(int state, knot_pkt_t *pkt,
+                                  struct query_data *qdata, void *ctx)
+{
+	const online_sign_t *osign = ctx;
+	if (pkt == NULL || qdata == NULL || osign == NULL ||
+	    !online_sign_enabled(state, qdata, osign)) {
+		return state;
+	}
+
+	sign_state_t sign;
+	sign_state_init(&sign, osign);
+	int ret = sign_section(pkt, qdata, &sign, true);
+	sign_state_clear(&sign);
+
+	return step_state(state, ret);
+}
+
+int online_sign_load(struct query_plan *plan, struct query_module *self)
+{
+	if (self->param[0] == '\0') {
+		MODULE_ERR("missing key file.\n");
+		return KNOT_EFEWDATA;
+	}
+
+	online_sign_t *osign = mm_alloc(self->mm, sizeof(online_sign_t));
+	if (osign == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	/* Save in query module, it takes ownership from now on. */
+	memset(osign, 0, sizeof(online_sign_t));
+	self->ctx = osign;
+
+	knot_key_params_t params;
+	memset(&params, 0, sizeof(params));
+	int ret = knot_load_key_params(self->param, &params);
+	if (ret != KNOT_EOK) {
+		MODULE_ERR("failed to load key '%s' (%s).\n", self->param,
+		           knot_strerror(ret));
+		return ret;
+	}
+
+	/* Fast signing and short signatures are essential. */
+	if (params.algorithm != KNOT_DNSSEC_ALG_ECDSAP256SHA256 &&
+	    params.algorithm != KNOT_DNSSEC_ALG_ECDSAP384SHA384) {
+		MODULE_ERR("key '%s' is not an ECDSA key.\n", self->param);
+		knot_free_key_params(&params);
+		return KNOT_ENOTSUP;
+	}
+
+	ret = knot_dnssec_key_from_params(&params, &osign->key);
+	knot_free_key_params(&params);
+	if (ret != KNOT_EOK) {
+		MODULE_ERR("failed to create key '%s' (%s).\n", self->param,
+		           knot_strerror(ret));
+		return ret;
+	}
+
+	osign->id = __sync_add_and_fetch(&instance_count, 1);
+
+	/* Sign each section once it is complete. */
+	ret = query_plan_step(plan, QPLAN_ANSWER, online_sign_answer, osign);
+	if (ret == KNOT_EOK) {
+		ret = query_plan_step(plan, QPLAN_AUTHORITY,
+		                      online_sign_authority, osign);
+	}
+	if (ret == KNOT_EOK) {
+		ret = query_plan_step(plan, QPLAN_ADDITIONAL,
+		                      online_sign_additional, osign);
+	}
+
+	return ret;
+}
+
+int online_sign_unload(struct query_module *self)
+{
+	online_sign_t *osign = self->ctx;
+	if (osign != NULL) {
+		knot_dnssec_key_free(&osign->key);
+	}
+
+	mm_free(self->mm, self->ctx);
+	return KNOT_EOK;
+}
@@ -0,0 +1,50 @@
+/*!
+ * \file online_sign.h
+ *
+ * \brief Online DNSSEC signing module
+ *
+ * Accepted configuration:
+ *  * "<private key file>"
+ *
+ * Module signs responses to DNSSEC-enabled queries for unsigned zones at
+ * the time of answering, using an ECDSA key of the zone. Nonexistence of
+ * names and types is proven with minimally covering NSEC records ("white
+ * lies", RFC 4470), so that no NSEC chain has to be maintained. Signatures
+ * are cached by each worker, the signing cost is proportional to the
+ * distinct RR sets queried and not to the zone size.
+ *
+ * \note The module should be configured as the last one in the zone, so that
+ *       records synthesized by other modules are signed as well.
+ *
+ * \addtogroup query_processing
+ * @{
+ */
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ONLINE_SIGN_H
+
+#include "knot/nameserver/query_module.h"
+
+/*! \brief Module interface. */
+int online_sign_load(struct query_plan *plan, struct query_module *self);
+int online_sign_unload(struct query_module *self);
+
+#define _ONLINE_SIGN_H
+
+#endif /* _ONLINE_SIGN_H */
+
+/*! @} */
@@ -14,14 +14,21 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <arpa/inet.h>
+#include <strings.h>
+
 #include "knot/modules/synth_record.h"
 #include "knot/nameserver/query_module.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/nameserver/internet.h"
+#include "knot/updates/acl.h"
 #include "common/descriptor.h"
 
 /* Defines. */
 #define ARPA_ZONE_LABELS 2
+#define IPV4_ARPA_LABELS 4  /* Label per octet. */
+#define IPV6_ARPA_LABELS 32 /* Label per nibble. */
+#define IPV6_GROUPS 8
 #define MODULE_ERR(msg...) log_zone_error("Module 'synth_record': " msg)
 
 /*! \brief Supported answer synthesis template types. */
@@ -31,6 +38,8 @@ enum synth_template_type {
 	SYNTH_REVERSE
 };
 
+struct synth_index;
+
 /*!
  * \brief Synthetic response template.
  */
@@ -41,8 +50,35 @@ typedef struct synth_template {
 	const char *zone;
 	uint32_t ttl;
 	netblock_t subnet;
+	unsigned order;            /*!< Configuration order in the zone. */
+	struct synth_index *index; /*!< Zone template index. */
 } synth_template_t;
 
+/*!
+ * \brief Templates sharing the address format in the query name.
+ *
+ * The address is parsed from the query name once per group and looked up
+ * in a radix tree of the template subnets.
+ */
+typedef struct synth_group {
+	node_t node;
+	enum synth_template_type type;
+	int family;
+	const char *prefix;      /*!< Forward name prefix. */
+	size_t prefix_len;
+	acl_t *subnets;          /*!< Subnets, rule order is the group order. */
+	synth_template_t **tpls; /*!< Templates in the group order. */
+} synth_group_t;
+
+/*!
+ * \brief Template index, a single plan step for all templates in the zone.
+ */
+typedef struct synth_index {
+	list_t groups;  /*!< Template groups. */
+	unsigned count; /*!< Number of templates. */
+	unsigned refs;  /*!< Number of module instances using the index. */
+} synth_index_t;
+
 /*! \brief Substitute all occurences of given character. */
 static void str_subst(char *str, size_t len, char from, char to)
 {
@@ -73,94 +109,160 @@ static bool query_satisfied_by_family(uint16_t qtype, int family)
 	}
 }
 
-/*! \brief Parse address from reverse query QNAME and return address family. */
-static int reverse_addr_parse(struct query_data *qdata, synth_template_t *tpl, char *addr_str)
+/*! \brief Address bytes in the socket address. */
+static uint8_t *addr_bytes(struct sockaddr_storage *ss)
+{
+	if (ss->ss_family == AF_INET6) {
+		return ((struct sockaddr_in6 *)ss)->sin6_addr.s6_addr;
+	}
+	return (uint8_t *)&((struct sockaddr_in *)ss)->sin_addr;
+}
+
+/*! \brief Value of single hexadecimal digit label, -1 if invalid. */
+static int label_nibble(const uint8_t *label)
 {
-	/* QNAME required format is [address].[subnet/zone]
+	if (label[0] != 1) {
+		return -1;
+	}
+
+	uint8_t c = label[1];
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	c |= 0x20; /* Lowercase. */
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+
+	return -1;
+}
+
+/*! \brief Value of decimal octet label, -1 if invalid. */
+static int label_octet(const uint8_t *label)
+{
+	/* Leading zeros are not allowed. */
+	if (label[0] < 1 || label[0] > 3 || (label[0] > 1 && label[1] == '0')) {
+		return -1;
+	}
+
+	int val = 0;
+	for (int i = 1; i <= label[0]; ++i) {
+		if (label[i] < '0' || label[i] > '9') {
+			return -1;
+		}
+		val = val * 10 + label[i] - '0';
+	}
+
+	return val <= 255 ? val : -1;
+}
+
+/*! \brief Parse address from reverse query QNAME. */
+static int reverse_addr_parse(struct query_data *qdata, int family,
+                              struct sockaddr_storage *addr)
+{
+	/* QNAME required format is [address].[subnet/zone], a label per
+	 * octet (IPv4) or nibble (IPv6) in the reverse order,
 	 * f.e.  [1.0...0].[h.g.f.e.0.0.0.0.d.c.b.a.ip6.arpa] represents
 	 *       [abcd:0:efgh::1] */
-	const knot_dname_t* label = qdata->name;
+	const knot_dname_t *label = qdata->name;
 	const uint8_t *query_wire = qdata->query->wire;
+	int label_count = knot_dname_labels(label, query_wire) - ARPA_ZONE_LABELS;
 
-	/* Push labels on stack for reverse walkthrough. */
-	const uint8_t* label_stack[KNOT_DNAME_MAXLABELS];
-	const uint8_t** sp = label_stack;
-	int label_count = knot_dname_labels(label, query_wire);
-	while(label_count > ARPA_ZONE_LABELS) {
-		*sp++ = label;
-		label = knot_wire_next_label(label, query_wire);
-		--label_count;
-	}
-
-	/* Write formatted address string. */
-	char sep = str_separator(tpl->subnet.ss.ss_family);
-	int sep_frequency = 1;
-	if (sep == ':') {
-		sep_frequency = 4; /* Separator per 4 hexdigits. */
-	}
-
-	char *dst = addr_str;
-	label_count = 0;
-	while(sp != label_stack) {
-		label = *--sp;
-		/* Write separator for each Nth label. */
-		if (label_count == sep_frequency) {
-			*dst = sep;
-			dst += 1;
-			label_count = 0;
+	uint8_t *dst = addr_bytes(addr);
+	if (family == AF_INET6) {
+		if (label_count != IPV6_ARPA_LABELS) {
+			return KNOT_EINVAL;
+		}
+		/* First label is the lowest nibble. */
+		for (int i = IPV6_ARPA_LABELS - 1; i >= 0; --i) {
+			int nibble = label_nibble(label);
+			if (nibble < 0) {
+				return KNOT_EMALF;
+			}
+			dst[i / 2] |= (i % 2 == 0) ? nibble << 4 : nibble;
+			label = knot_wire_next_label(label, query_wire);
+		}
+	} else {
+		if (label_count != IPV4_ARPA_LABELS) {
+			return KNOT_EINVAL;
+		}
+		for (int i = IPV4_ARPA_LABELS - 1; i >= 0; --i) {
+			int octet = label_octet(label);
+			if (octet < 0) {
+				return KNOT_EMALF;
+			}
+			dst[i] = octet;
+			label = knot_wire_next_label(label, query_wire);
 		}
-		/* Write label */
-		memcpy(dst, label + 1, label[0]);
-		dst += label[0];
-		label_count += 1;
 	}
 
 	return KNOT_EOK;
 }
 
-static int forward_addr_parse(struct query_data *qdata, synth_template_t *tpl, char *addr_str)
+/*! \brief Parse address from forward query QNAME. */
+static int forward_addr_parse(struct query_data *qdata, const synth_group_t *group,
+                              struct sockaddr_storage *addr)
 {
-	/* Find prefix label count (additive to prefix length). */
-	const knot_dname_t *addr_label = qdata->name;
-
-	/* Mismatch if label shorter/equal than prefix. */
-	int prefix_len = strlen(tpl->prefix);
-	if (addr_label == NULL || addr_label[0] <= prefix_len) {
+	/* First label is [prefix][address with dashes]. */
+	const knot_dname_t *label = qdata->name;
+	if (label[0] <= group->prefix_len ||
+	    strncasecmp((const char *)label + 1, group->prefix, group->prefix_len) != 0) {
 		return KNOT_EINVAL;
 	}
 
-	int addr_len = *addr_label - prefix_len;
-	memcpy(addr_str, addr_label + 1 + prefix_len, addr_len);
+	char addr_str[KNOT_DNAME_MAXLEN] = { '\0' };
+	int addr_len = label[0] - group->prefix_len;
+	memcpy(addr_str, label + 1 + group->prefix_len, addr_len);
+	if (memchr(addr_str, '\0', addr_len) != NULL) {
+		return KNOT_EMALF;
+	}
 
 	/* Restore correct address format. */
-	char sep = str_separator(tpl->subnet.ss.ss_family);
-	str_subst(addr_str, addr_len, '-', sep);
+	str_subst(addr_str, addr_len, '-', str_separator(group->family));
+	if (inet_pton(group->family, addr_str, addr_bytes(addr)) != 1) {
+		return KNOT_EMALF;
+	}
 
 	return KNOT_EOK;
 }
 
-static int addr_parse(struct query_data *qdata, synth_template_t *tpl, char *addr_str)
+static int addr_parse(struct query_data *qdata, const synth_group_t *group,
+                      struct sockaddr_storage *addr)
 {
-	/* Check if we have at least 1 label below zone. */
-	int zone_labels = knot_dname_labels(qdata->zone->name, NULL);
-	int query_labels = knot_dname_labels(qdata->name, qdata->query->wire);
-	if (query_labels < zone_labels + 1) {
-		return KNOT_EINVAL;
-	}
+	memset(addr, 0, sizeof(struct sockaddr_storage));
+	addr->ss_family = group->family;
 
-	switch (tpl->type) {
-	case SYNTH_REVERSE: return reverse_addr_parse(qdata, tpl, addr_str);
-	case SYNTH_FORWARD: return forward_addr_parse(qdata, tpl, addr_str);
+	switch (group->type) {
+	case SYNTH_REVERSE: return reverse_addr_parse(qdata, group->family, addr);
+	case SYNTH_FORWARD: return forward_addr_parse(qdata, group, addr);
 	default:            return KNOT_EINVAL;
 	}
 }
 
-static knot_dname_t *synth_ptrname(const char *addr_str, synth_template_t *tpl)
+/*! \brief Write address with parts separated by dashes. */
+static int addr_format(const struct sockaddr_storage *addr, char *dst, size_t maxlen)
+{
+	const uint8_t *bytes = addr_bytes((struct sockaddr_storage *)addr);
+	if (addr->ss_family == AF_INET6) {
+		/* Full form, 4 hexdigits per group. */
+		int written = 0;
+		for (int i = 0; i < IPV6_GROUPS; ++i) {
+			written += snprintf(dst + written, maxlen - written, "%s%02x%02x",
+			                    i > 0 ? "-" : "", bytes[2 * i], bytes[2 * i + 1]);
+		}
+		return written;
+	}
+
+	return snprintf(dst, maxlen, "%u-%u-%u-%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+}
+
+static knot_dname_t *synth_ptrname(const struct sockaddr_storage *addr, synth_template_t *tpl)
 {
 	/* PTR right-hand value is [prefix][address][zone] */
 	char ptrname[KNOT_DNAME_MAXLEN] = {'\0'};
+	char addr_str[SOCKADDR_STRLEN] = {'\0'};
 	int prefix_len = strlen(tpl->prefix);
-	int addr_len = strlen(addr_str);
+	int addr_len = addr_format(addr, addr_str, sizeof(addr_str));
 	int zone_len = strlen(tpl->zone);
 
 	/* Check required space (zone requires extra leading dot). */
@@ -172,10 +274,8 @@ static knot_dname_t *synth_ptrname(const char *addr_str, synth_template_t *tpl)
 	memcpy(ptrname, tpl->prefix, prefix_len);
 	int written = prefix_len;
 
-	/* Write address with substituted separator to '-'. */
-	char sep = str_separator(tpl->subnet.ss.ss_family);
+	/* Write address. */
 	memcpy(ptrname + written, addr_str, addr_len);
-	str_subst(ptrname + written, addr_len, sep, '-');
 	written += addr_len;
 
 	/* Write zone name. */
@@ -187,10 +287,11 @@ static knot_dname_t *synth_ptrname(const char *addr_str, synth_template_t *tpl)
 	return knot_dname_from_str(ptrname);
 }
 
-static int reverse_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, knot_rrset_t *rr)
+static int reverse_rr(const struct sockaddr_storage *addr, synth_template_t *tpl,
+                      knot_pkt_t *pkt, knot_rrset_t *rr)
 {
 	/* Synthetize PTR record data. */
-	knot_dname_t *ptrname = synth_ptrname(addr_str, tpl);
+	knot_dname_t *ptrname = synth_ptrname(addr, tpl);
 	if (ptrname == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -202,22 +303,19 @@ static int reverse_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, kn
 	return KNOT_EOK;
 }
 
-static int forward_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, knot_rrset_t *rr)
+static int forward_rr(const struct sockaddr_storage *addr, synth_template_t *tpl,
+                      knot_pkt_t *pkt, knot_rrset_t *rr)
 {
-	struct sockaddr_storage query_addr = {'\0'};
-	sockaddr_set(&query_addr, tpl->subnet.ss.ss_family, addr_str, 0);
-
 	/* Specify address type and data. */
-	if (tpl->subnet.ss.ss_family == AF_INET6) {
+	const uint8_t *bytes = addr_bytes((struct sockaddr_storage *)addr);
+	if (addr->ss_family == AF_INET6) {
 		rr->type = KNOT_RRTYPE_AAAA;
-		const struct sockaddr_in6* ip = (const struct sockaddr_in6*)&query_addr;
-		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin6_addr, sizeof(struct in6_addr),
-		                  tpl->ttl, &pkt->mm);
-	} else if (tpl->subnet.ss.ss_family == AF_INET) {
+		knot_rrset_add_rdata(rr, bytes, sizeof(struct in6_addr),
+		                     tpl->ttl, &pkt->mm);
+	} else if (addr->ss_family == AF_INET) {
 		rr->type = KNOT_RRTYPE_A;
-		const struct sockaddr_in* ip = (const struct sockaddr_in*)&query_addr;
-		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin_addr, sizeof(struct in_addr),
-		                  tpl->ttl, &pkt->mm);
+		knot_rrset_add_rdata(rr, bytes, sizeof(struct in_addr),
+		                     tpl->ttl, &pkt->mm);
 	} else {
 		return KNOT_EINVAL;
 	}
@@ -225,7 +323,8 @@ static int forward_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, kn
 	return KNOT_EOK;
 }
 
-static knot_rrset_t *synth_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, struct query_data *qdata)
+static knot_rrset_t *synth_rr(const struct sockaddr_storage *addr, synth_template_t *tpl,
+                              knot_pkt_t *pkt, struct query_data *qdata)
 {
 	knot_rrset_t *rr = knot_rrset_new(qdata->name, 0, KNOT_CLASS_IN,
 	                                  &pkt->mm);
@@ -236,8 +335,8 @@ static knot_rrset_t *synth_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t
 	/* Fill in the specific data. */
 	int ret = KNOT_ERROR;
 	switch (tpl->type) {
-	case SYNTH_REVERSE: ret = reverse_rr(addr_str, tpl, pkt, rr); break;
-	case SYNTH_FORWARD: ret = forward_rr(addr_str, tpl, pkt, rr); break;
+	case SYNTH_REVERSE: ret = reverse_rr(addr, tpl, pkt, rr); break;
+	case SYNTH_FORWARD: ret = forward_rr(addr, tpl, pkt, rr); break;
 	default: break;
 	}
 
@@ -249,32 +348,52 @@ static knot_rrset_t *synth_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t
 	return rr;
 }
 
-/*! \brief Check if query fits the template requirements. */
-static int template_match(int state, synth_template_t *tpl, knot_pkt_t *pkt, struct query_data *qdata)
+/*! \brief Find the first configured template matching the query. */
+static synth_template_t *index_match(synth_index_t *index, struct query_data *qdata,
+                                     struct sockaddr_storage *addr)
 {
-	/* Parse address from query name. */
-	char addr_str[SOCKADDR_STRLEN] = { '\0' };
-	int ret = addr_parse(qdata, tpl, addr_str);
-	if (ret != KNOT_EOK) {
-		return state; /* Can't identify addr in QNAME, not applicable. */
+	/* Check if we have at least 1 label below zone. */
+	int zone_labels = knot_dname_labels(qdata->zone->name, NULL);
+	int query_labels = knot_dname_labels(qdata->name, qdata->query->wire);
+	if (query_labels < zone_labels + 1) {
+		return NULL;
 	}
 
-	/* Match against template netblock. */
-	struct sockaddr_storage query_addr = { '\0' };
-	int provided_af = tpl->subnet.ss.ss_family;
-	ret = sockaddr_set(&query_addr, provided_af, addr_str, 0);
-	if (ret == KNOT_EOK) {
-		ret = netblock_match(&tpl->subnet, &query_addr);
-	}
-	if (ret != 0) {
-		return state; /* Out of our netblock, not applicable. */
+	synth_template_t *found = NULL;
+	synth_group_t *group = NULL;
+	WALK_LIST(group, index->groups) {
+		/* Parse address from query name. */
+		struct sockaddr_storage query_addr;
+		if (addr_parse(qdata, group, &query_addr) != KNOT_EOK) {
+			continue; /* Can't identify addr in QNAME, not applicable. */
+		}
+
+		/* Match against template netblocks. */
+		acl_match_t *match = acl_find(group->subnets, &query_addr, NULL);
+		if (match == NULL) {
+			continue; /* Out of our netblocks, not applicable. */
+		}
+
+		synth_template_t *tpl = group->tpls[match->order];
+		if (found == NULL || tpl->order < found->order) {
+			memcpy(addr, &query_addr, sizeof(struct sockaddr_storage));
+			found = tpl;
+		}
 	}
 
+	return found;
+}
+
+/*! \brief Answer the query from the template. */
+static int template_answer(int state, synth_template_t *tpl,
+                           const struct sockaddr_storage *addr,
+                           knot_pkt_t *pkt, struct query_data *qdata)
+{
 	/* Check if the request is for an available query type. */
 	uint16_t qtype = knot_pkt_qtype(qdata->query);
 	switch (tpl->type) {
 	case SYNTH_FORWARD:
-		if (!query_satisfied_by_family(qtype, provided_af)) {
+		if (!query_satisfied_by_family(qtype, addr->ss_family)) {
 			qdata->rcode = KNOT_RCODE_NOERROR;
 			return NODATA;
 		}
@@ -290,7 +409,7 @@ static int template_match(int state, synth_template_t *tpl, knot_pkt_t *pkt, str
 	}
 
 	/* Synthetise record from template. */
-	knot_rrset_t *rr = synth_rr(addr_str, tpl, pkt, qdata);
+	knot_rrset_t *rr = synth_rr(addr, tpl, pkt, qdata);
 	if (rr == NULL) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		return ERROR;
@@ -319,7 +438,118 @@ int solve_synth_record(int state, knot_pkt_t *pkt, struct query_data *qdata, voi
 	}
 
 	/* Check if template fits. */
-	return template_match(state, (synth_template_t *)ctx, pkt, qdata);
+	struct sockaddr_storage addr;
+	synth_template_t *tpl = index_match(ctx, qdata, &addr);
+	if (tpl == NULL) {
+		return state;
+	}
+
+	return template_answer(state, tpl, &addr, pkt, qdata);
+}
+
+static void group_free(synth_group_t *group)
+{
+	acl_delete(&group->subnets);
+	free(group->tpls);
+	free(group);
+}
+
+/*! \brief Find group for the template, create it if it doesn't exist. */
+static synth_group_t *group_get(synth_index_t *index, synth_template_t *tpl)
+{
+	int family = tpl->subnet.ss.ss_family;
+	synth_group_t *group = NULL;
+	WALK_LIST(group, index->groups) {
+		if (group->type == tpl->type && group->family == family &&
+		    (tpl->type != SYNTH_FORWARD ||
+		     strcasecmp(group->prefix, tpl->prefix) == 0)) {
+			return group;
+		}
+	}
+
+	group = malloc(sizeof(synth_group_t));
+	if (group == NULL) {
+		return NULL;
+	}
+
+	memset(group, 0, sizeof(synth_group_t));
+	group->subnets = acl_new();
+	if (group->subnets == NULL) {
+		free(group);
+		return NULL;
+	}
+
+	group->type = tpl->type;
+	group->family = family;
+	group->prefix = tpl->prefix;
+	group->prefix_len = strlen(tpl->prefix);
+	add_tail(&index->groups, &group->node);
+	return group;
+}
+
+/*! \brief Add template to the index. */
+static int index_insert(synth_index_t *index, synth_template_t *tpl)
+{
+	synth_group_t *group = group_get(index, tpl);
+	if (group == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	unsigned count = group->subnets->count;
+	synth_template_t **tpls = realloc(group->tpls, (count + 1) * sizeof(*tpls));
+	if (tpls == NULL) {
+		return KNOT_ENOMEM;
+	}
+	group->tpls = tpls;
+
+	int ret = acl_insert(group->subnets, &tpl->subnet.ss, tpl->subnet.prefix, NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	tpls[count] = tpl;
+	tpl->order = index->count;
+	index->count += 1;
+	return KNOT_EOK;
+}
+
+/*! \brief Get index planned for the zone, plan it if it doesn't exist. */
+static synth_index_t *index_get(struct query_plan *plan)
+{
+	struct query_step *step = NULL;
+	WALK_LIST(step, plan->stage[QPLAN_ANSWER]) {
+		if (step->process == solve_synth_record) {
+			return step->ctx;
+		}
+	}
+
+	synth_index_t *index = malloc(sizeof(synth_index_t));
+	if (index == NULL) {
+		return NULL;
+	}
+
+	memset(index, 0, sizeof(synth_index_t));
+	init_list(&index->groups);
+	if (query_plan_step(plan, QPLAN_ANSWER, solve_synth_record, index) != KNOT_EOK) {
+		free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+/*! \brief Release index, free it with the last module. */
+static void index_release(synth_index_t *index)
+{
+	if (--index->refs > 0) {
+		return;
+	}
+
+	synth_group_t *group = NULL, *next = NULL;
+	WALK_LIST_DELSAFE(group, next, index->groups) {
+		group_free(group);
+	}
+	free(index);
 }
 
 int synth_record_load(struct query_plan *plan, struct query_module *self)
@@ -338,6 +568,7 @@ int synth_record_load(struct query_plan *plan, struct query_module *self)
 	}
 
 	/* Save in query module, it takes ownership from now on. */
+	memset(tpl, 0, sizeof(struct synth_template));
 	self->ctx = tpl;
 
 	/* Supported types: reverse, forward */
@@ -399,11 +630,23 @@ int synth_record_load(struct query_plan *plan, struct query_module *self)
 		return KNOT_EMALF;
 	}
 
-	return query_plan_step(plan, QPLAN_ANSWER, solve_synth_record, tpl);
+	/* All templates in the zone share a single plan step. */
+	tpl->index = index_get(plan);
+	if (tpl->index == NULL) {
+		return KNOT_ENOMEM;
+	}
+	tpl->index->refs += 1;
+
+	return index_insert(tpl->index, tpl);
 }
 
 int synth_record_unload(struct query_module *self)
 {
+	synth_template_t *tpl = self->ctx;
+	if (tpl != NULL && tpl->index != NULL) {
+		index_release(tpl->index);
+	}
+
 	mm_free(self->mm, self->ctx);
 	return KNOT_EOK;
 }
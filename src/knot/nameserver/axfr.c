@@ -25,7 +25,7 @@
 /* AXFR context. @note aliasing the generic xfr_proc */
 struct axfr_proc {
 	struct xfr_proc proc;
-	hattrie_iter_t *i;
+	knot_zone_tree_it_t *i;
 	unsigned cur_rrset;
 };
 
@@ -60,24 +60,24 @@ static int axfr_process_node_tree(knot_pkt_t *pkt, const void *item, struct xfr_
 	struct axfr_proc *axfr = (struct axfr_proc*)state;
 
 	if (axfr->i == NULL) {
-		axfr->i = hattrie_iter_begin(item, true);
+		axfr->i = knot_zone_tree_it_begin(item, true);
 	}
 
 	/* Put responses. */
 	int ret = KNOT_EOK;
 	zone_node_t *node = NULL;
-	while(!hattrie_iter_finished(axfr->i)) {
-		node = (zone_node_t *)*hattrie_iter_val(axfr->i);
+	while(!knot_zone_tree_it_finished(axfr->i)) {
+		node = knot_zone_tree_it_val(axfr->i);
 		ret = put_rrsets(pkt, node, axfr);
 		if (ret != KNOT_EOK) {
 			break;
 		}
-		hattrie_iter_next(axfr->i);
+		knot_zone_tree_it_next(axfr->i);
 	}
 
 	/* Finished all nodes. */
 	if (ret == KNOT_EOK) {
-		hattrie_iter_free(axfr->i);
+		knot_zone_tree_it_free(axfr->i);
 		axfr->i = NULL;
 	}
 	return ret;
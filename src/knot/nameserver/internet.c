@@ -49,8 +49,11 @@ static int wildcard_visit(struct query_data *qdata, const zone_node_t *node, con
 		return KNOT_EOK;
 	}
 
-	mm_ctx_t *mm = qdata->mm;
-	struct wildcard_hit *item = mm->alloc(mm->ctx, sizeof(struct wildcard_hit));
+	struct wildcard_hit *item = query_wildcard_alloc(qdata);
+	if (item == NULL) {
+		return KNOT_ENOMEM;
+	}
+
 	item->node = node;
 	item->sname = sname;
 	add_tail(&qdata->wildcards, (node_t *)item);
@@ -140,20 +143,21 @@ static int put_rrsig(const knot_dname_t *sig_owner, uint16_t type,
 		return ret;
 	}
 
-	/* Create rrsig info structure. */
-	struct rrsig_info *info = mm_alloc(qdata->mm, sizeof(struct rrsig_info));
-	if (info == NULL) {
+	knot_dname_t *owner_copy = knot_dname_copy(sig_owner, qdata->mm);
+	if (owner_copy == NULL) {
 		knot_rdataset_clear(&synth_rrs, qdata->mm);
 		return KNOT_ENOMEM;
 	}
 
-	/* Store RRSIG into info structure. */
-	knot_dname_t *owner_copy = knot_dname_copy(sig_owner, qdata->mm);
-	if (owner_copy == NULL) {
-		mm_free(qdata->mm, info);
+	/* Create rrsig info structure. */
+	struct rrsig_info *info = query_rrsig_alloc(qdata);
+	if (info == NULL) {
+		knot_dname_free(&owner_copy, qdata->mm);
 		knot_rdataset_clear(&synth_rrs, qdata->mm);
 		return KNOT_ENOMEM;
 	}
+
+	/* Store RRSIG into info structure. */
 	knot_rrset_init(&info->synth_rrsig, owner_copy, rrsigs->type, rrsigs->rclass);
 	/* Store filtered signature. */
 	info->synth_rrsig.rrs = synth_rrs;
@@ -744,9 +748,35 @@ int ns_put_rr(knot_pkt_t *pkt, const knot_rrset_t *rr,
 	return ret;
 }
 
+/*! \brief Map query plan step to the timed processing stage. */
+static enum stats_stage step_stage(const struct query_step *step)
+{
+	if (step->process == solve_answer) {
+		return STATS_STAGE_ANSWER;
+	} else if (step->process == solve_authority) {
+		return STATS_STAGE_AUTHORITY;
+	} else if (step->process == solve_additional) {
+		return STATS_STAGE_ADDITIONAL;
+	} else if (step->process == solve_answer_dnssec ||
+	           step->process == solve_authority_dnssec ||
+	           step->process == solve_additional_dnssec) {
+		return STATS_STAGE_DNSSEC;
+	} else if (step->module < QUERY_MODULE_COUNT) {
+		return STATS_STAGE_MODULE + step->module;
+	}
+
+	return STATS_STAGE_OTHER;
+}
+
 /*! \brief Helper for internet_answer repetitive code. */
-#define SOLVE_STEP(solver, state, context) \
-	state = (solver)(state, response, qdata, context); \
+#define SOLVE_STEP(solver, state, context, stage) \
+	if (qdata->param->latency != NULL) { \
+		uint64_t t_step = stats_clock(); \
+		state = (solver)(state, response, qdata, context); \
+		stats_timer_end(qdata->param->latency, (stage), t_step); \
+	} else { \
+		state = (solver)(state, response, qdata, context); \
+	} \
 	if (state == TRUNC) { \
 		return NS_PROC_DONE; \
 	} else if (state == ERROR) { \
@@ -760,20 +790,20 @@ static int default_answer(knot_pkt_t *response, struct query_data *qdata)
 	/* Resolve ANSWER. */
 	dbg_ns("%s: writing %p ANSWER\n", __func__, response);
 	knot_pkt_begin(response, KNOT_ANSWER);
-	SOLVE_STEP(solve_answer, state, NULL);
-	SOLVE_STEP(solve_answer_dnssec, state, NULL);
+	SOLVE_STEP(solve_answer, state, NULL, STATS_STAGE_ANSWER);
+	SOLVE_STEP(solve_answer_dnssec, state, NULL, STATS_STAGE_DNSSEC);
 
 	/* Resolve AUTHORITY. */
 	dbg_ns("%s: writing %p AUTHORITY\n", __func__, response);
 	knot_pkt_begin(response, KNOT_AUTHORITY);
-	SOLVE_STEP(solve_authority, state, NULL);
-	SOLVE_STEP(solve_authority_dnssec, state, NULL);
+	SOLVE_STEP(solve_authority, state, NULL, STATS_STAGE_AUTHORITY);
+	SOLVE_STEP(solve_authority_dnssec, state, NULL, STATS_STAGE_DNSSEC);
 
 	/* Resolve ADDITIONAL. */
 	dbg_ns("%s: writing %p ADDITIONAL\n", __func__, response);
 	knot_pkt_begin(response, KNOT_ADDITIONAL);
-	SOLVE_STEP(solve_additional, state, NULL);
-	SOLVE_STEP(solve_additional_dnssec, state, NULL);
+	SOLVE_STEP(solve_additional, state, NULL, STATS_STAGE_ADDITIONAL);
+	SOLVE_STEP(solve_additional_dnssec, state, NULL, STATS_STAGE_DNSSEC);
 
 	/* Write resulting RCODE. */
 	knot_wire_set_rcode(response->wire, qdata->rcode);
@@ -787,7 +817,7 @@ static int planned_answer(struct query_plan *plan, knot_pkt_t *response, struct
 	int state = BEGIN;
 	struct query_step *step = NULL;
 	WALK_LIST(step, plan->stage[QPLAN_BEGIN]) {
-		SOLVE_STEP(step->process, state, step->ctx);
+		SOLVE_STEP(step->process, state, step->ctx, step_stage(step));
 	}
 
 	/* Begin processing. */
@@ -795,7 +825,7 @@ static int planned_answer(struct query_plan *plan, knot_pkt_t *response, struct
 		dbg_ns("%s: writing section %u\n", __func__, section);
 		knot_pkt_begin(response, section);
 		WALK_LIST(step, plan->stage[QPLAN_STAGE + section]) {
-			SOLVE_STEP(step->process, state, step->ctx);
+			SOLVE_STEP(step->process, state, step->ctx, step_stage(step));
 		}
 	}
 
@@ -804,7 +834,7 @@ static int planned_answer(struct query_plan *plan, knot_pkt_t *response, struct
 
 	/* After query processing code. */
 	WALK_LIST(step, plan->stage[QPLAN_END]) {
-		SOLVE_STEP(step->process, state, step->ctx);
+		SOLVE_STEP(step->process, state, step->ctx, step_stage(step));
 	}
 
 	return NS_PROC_DONE;
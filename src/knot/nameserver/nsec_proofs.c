@@ -796,6 +796,7 @@ void nsec_clear_rrsigs(struct query_data *qdata)
 		knot_rrset_clear(rrsig, qdata->mm);
 	};
 
-	ptrlist_free(&qdata->rrsigs, qdata->mm);
-	init_list(&qdata->rrsigs);
+	/* All taken RRSIG nodes were in the list. */
+	query_list_free(qdata, &qdata->rrsigs);
+	qdata->rrsig_used = 0;
 }
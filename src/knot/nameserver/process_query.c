@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <stdio.h>
 #include <urcu.h>
 
@@ -40,9 +41,9 @@ const knot_process_module_t _process_query = {
 /*! \brief Reinitialize query data structure. */
 static void query_data_init(knot_process_t *ctx, void *module_param)
 {
-	/* Initialize persistent data. */
+	/* Initialize persistent data, preallocated nodes are reused. */
 	struct query_data *data = QUERY_DATA(ctx);
-	memset(data, 0, sizeof(struct query_data));
+	memset(data, 0, offsetof(struct query_data, param));
 	data->mm = &ctx->mm;
 	data->param = (struct process_query_param*)module_param;
 
@@ -56,7 +57,12 @@ int process_query_begin(knot_process_t *ctx, void *module_param)
 	/* Initialize context. */
 	assert(ctx);
 	ctx->type = NS_PROC_QUERY_ID;
-	ctx->data = ctx->mm.alloc(ctx->mm.ctx, sizeof(struct query_data));
+	struct process_query_param *param = module_param;
+	if (param != NULL && param->qdata != NULL) {
+		ctx->data = param->qdata;
+	} else {
+		ctx->data = ctx->mm.alloc(ctx->mm.ctx, sizeof(struct query_data));
+	}
 
 	/* Initialize persistent data. */
 	query_data_init(ctx, module_param);
@@ -75,7 +81,7 @@ int process_query_reset(knot_process_t *ctx)
 
 	/* Free allocated data. */
 	knot_pkt_free(&qdata->query);
-	ptrlist_free(&qdata->wildcards, qdata->mm);
+	query_list_free(qdata, &qdata->wildcards);
 	nsec_clear_rrsigs(qdata);
 	if (qdata->ext_cleanup != NULL) {
 		qdata->ext_cleanup(qdata);
@@ -90,7 +96,12 @@ int process_query_reset(knot_process_t *ctx)
 int process_query_finish(knot_process_t *ctx)
 {
 	process_query_reset(ctx);
-	ctx->mm.free(ctx->data);
+
+	/* Preallocated query data is owned by the caller. */
+	struct process_query_param *param = QUERY_DATA(ctx)->param;
+	if (param == NULL || ctx->data != param->qdata) {
+		ctx->mm.free(ctx->data);
+	}
 	ctx->data = NULL;
 
 	return NS_PROC_NOOP;
@@ -148,6 +159,13 @@ int process_query_out(knot_pkt_t *pkt, knot_process_t *ctx)
 		goto finish;
 	}
 
+	/* Account query. */
+	stats_query(qdata->param->stats, query);
+	if (qdata->zone != NULL) {
+		stats_zone_query(qdata->zone->queries.table,
+		                 qdata->zone->queries.index, qdata->param->stats);
+	}
+
 	/* Answer based on qclass. */
 	switch (knot_pkt_qclass(pkt)) {
 	case KNOT_CLASS_CH:
@@ -218,6 +236,46 @@ int process_query_err(knot_pkt_t *pkt, knot_process_t *ctx)
 	return NS_PROC_DONE;
 }
 
+struct wildcard_hit *query_wildcard_alloc(struct query_data *qdata)
+{
+	if (qdata->wildcard_used < QUERY_PREALLOC_NODES) {
+		return &qdata->wildcard_pool[qdata->wildcard_used++];
+	}
+
+	return mm_alloc(qdata->mm, sizeof(struct wildcard_hit));
+}
+
+struct rrsig_info *query_rrsig_alloc(struct query_data *qdata)
+{
+	if (qdata->rrsig_used < QUERY_PREALLOC_NODES) {
+		return &qdata->rrsig_pool[qdata->rrsig_used++];
+	}
+
+	return mm_alloc(qdata->mm, sizeof(struct rrsig_info));
+}
+
+/*! \brief Check if the node is one of the preallocated ones. */
+static bool query_node_prealloc(const struct query_data *qdata, const void *n)
+{
+	const struct wildcard_hit *wildcard = n;
+	const struct rrsig_info *rrsig = n;
+	return (wildcard >= qdata->wildcard_pool &&
+	        wildcard < qdata->wildcard_pool + QUERY_PREALLOC_NODES) ||
+	       (rrsig >= qdata->rrsig_pool &&
+	        rrsig < qdata->rrsig_pool + QUERY_PREALLOC_NODES);
+}
+
+void query_list_free(struct query_data *qdata, list_t *list)
+{
+	node_t *n = NULL, *nxt = NULL;
+	WALK_LIST_DELSAFE(n, nxt, *list) {
+		if (!query_node_prealloc(qdata, n)) {
+			mm_free(qdata->mm, n);
+		}
+	}
+	init_list(list);
+}
+
 bool process_query_acl_check(acl_t *acl, struct query_data *qdata)
 {
 	knot_pkt_t *query = qdata->query;
@@ -311,6 +369,7 @@ int process_query_sign_response(knot_pkt_t *pkt, struct query_data *qdata)
 
 		/* Sign query response. */
 		dbg_ns("%s: signing response using key %p\n", __func__, ctx->tsig_key);
+		uint64_t t_sign = stats_timer(qdata->param->latency);
 		size_t new_digest_len = knot_tsig_digest_length(ctx->tsig_key->algorithm);
 		if (ctx->pkt_count == 0) {
 			ret = knot_tsig_sign(pkt->wire, &pkt->size, pkt->max_size,
@@ -325,6 +384,7 @@ int process_query_sign_response(knot_pkt_t *pkt, struct query_data *qdata)
 			                          ctx->tsig_key,
 			                          pkt->wire, pkt->size);
 		}
+		stats_timer_end(qdata->param->latency, STATS_STAGE_TSIG, t_sign);
 		if (ret != KNOT_EOK) {
 			goto fail; /* Failed to sign. */
 		} else {
@@ -418,9 +478,11 @@ static int ratelimit_apply(int state, knot_pkt_t *pkt, knot_process_t *ctx)
 			return NS_PROC_FAIL;
 		}
 		knot_wire_set_tc(pkt->wire);
+		stats_inc(qdata->param->stats, STATS_RRL_SLIPPED);
 	} else {
 		/* Drop answer. */
 		pkt->size = 0;
+		stats_inc(qdata->param->stats, STATS_RRL_DROPPED);
 	}
 
 	return NS_PROC_DONE;
@@ -515,7 +577,14 @@ static int prepare_answer(const knot_pkt_t *query, knot_pkt_t *resp, knot_proces
 	}
 
 	/* Find zone for QNAME. */
+	uint64_t t_zone = stats_timer(qdata->param->latency);
 	qdata->zone = answer_zone_find(query, server->zone_db);
+	stats_timer_end(qdata->param->latency, STATS_STAGE_ZONE, t_zone);
+
+	/* Load lazy zone on first use, it's SERVFAIL until loaded. */
+	if (qdata->zone != NULL && qdata->zone->contents == NULL) {
+		zone_load_request((zone_t *)qdata->zone);
+	}
 
 	/* Update maximal answer size. */
 	if (qdata->param->proc_flags & NS_QUERY_LIMIT_SIZE) {
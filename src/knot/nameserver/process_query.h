@@ -69,8 +69,28 @@ struct process_query_param {
 	int        query_socket;
 	struct sockaddr_storage *query_source;
 	server_t   *server;
+	stats_worker_t *stats; /*!< Worker query counters (may be NULL). */
+	stats_hist_t *latency; /*!< Stage latency histograms (NULL if disabled). */
+	struct query_data *qdata; /*!< Preallocated query data (may be NULL). */
 };
 
+/*! \brief Visited wildcard node list. */
+struct wildcard_hit {
+	node_t n;
+	const zone_node_t *node;   /* Visited node. */
+	const knot_dname_t *sname; /* Name leading to this node. */
+};
+
+/*! \brief RRSIG info node list. */
+struct rrsig_info {
+	node_t n;
+	knot_rrset_t synth_rrsig;  /* Synthesized RRSIG. */
+	knot_rrinfo_t *rrinfo;      /* RR info. */
+};
+
+/*! \brief Number of wildcard and RRSIG nodes preallocated in query data. */
+#define QUERY_PREALLOC_NODES 32
+
 /*! \brief Query processing intermediate data. */
 struct query_data {
 	uint16_t rcode;       /*!< Resulting RCODE. */
@@ -80,6 +100,8 @@ struct query_data {
 	const zone_t *zone;   /*!< Zone from which is answered. */
 	list_t wildcards;     /*!< Visited wildcards. */
 	list_t rrsigs;        /*!< Section RRSIGs. */
+	unsigned wildcard_used; /*!< Taken preallocated wildcard nodes. */
+	unsigned rrsig_used;    /*!< Taken preallocated RRSIG nodes. */
 
 	/* Current processed name and nodes. */
 	const zone_node_t *node, *encloser, *previous;
@@ -96,20 +118,10 @@ struct query_data {
 	/* Everything below should be kept on reset. */
 	struct process_query_param *param; /*!< Module parameters. */
 	mm_ctx_t *mm;                      /*!< Memory context. */
-};
-
-/*! \brief Visited wildcard node list. */
-struct wildcard_hit {
-	node_t n;
-	const zone_node_t *node;   /* Visited node. */
-	const knot_dname_t *sname; /* Name leading to this node. */
-};
 
-/*! \brief RRSIG info node list. */
-struct rrsig_info {
-	node_t n;
-	knot_rrset_t synth_rrsig;  /* Synthesized RRSIG. */
-	knot_rrinfo_t *rrinfo;      /* RR info. */
+	/* Preallocated list nodes, reused for each query. */
+	struct wildcard_hit wildcard_pool[QUERY_PREALLOC_NODES];
+	struct rrsig_info rrsig_pool[QUERY_PREALLOC_NODES];
 };
 
 /*!
@@ -168,6 +180,33 @@ int process_query_out(knot_pkt_t *pkt, knot_process_t *ctx);
  */
 int process_query_err(knot_pkt_t *pkt, knot_process_t *ctx);
 
+/*!
+ * \brief Get visited wildcard node, preallocated one if available.
+ *
+ * \param qdata
+ * \return node or NULL
+ */
+struct wildcard_hit *query_wildcard_alloc(struct query_data *qdata);
+
+/*!
+ * \brief Get RRSIG info node, preallocated one if available.
+ *
+ * \param qdata
+ * \return node or NULL
+ */
+struct rrsig_info *query_rrsig_alloc(struct query_data *qdata);
+
+/*!
+ * \brief Free list of wildcard or RRSIG nodes.
+ *
+ * \note Preallocated nodes are not freed, they are reused when the taken
+ *       count is reset.
+ *
+ * \param qdata
+ * \param list
+ */
+void query_list_free(struct query_data *qdata, list_t *list);
+
 /*!
  * \brief Check current query against ACL.
  *
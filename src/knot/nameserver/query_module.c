@@ -4,6 +4,7 @@
 
 /* Compiled-in module headers. */
 #include "knot/modules/synth_record.h"
+#include "knot/modules/online_sign.h"
 
 /* Compiled-in module table. */
 struct compiled_module {
@@ -12,9 +13,9 @@ struct compiled_module {
 	qmodule_unload_t unload;
 };
 /*! \note All modules should be dynamically loaded later on. */
-#define MODULE_COUNT 1
-struct compiled_module MODULES[MODULE_COUNT] = {
-        { "synth_record", &synth_record_load, &synth_record_unload }
+struct compiled_module MODULES[QUERY_MODULE_COUNT] = {
+        { "synth_record", &synth_record_load, &synth_record_unload },
+        { "online_sign", &online_sign_load, &online_sign_unload }
 };
 
 struct query_plan *query_plan_create(mm_ctx_t *mm)
@@ -25,6 +26,7 @@ struct query_plan *query_plan_create(mm_ctx_t *mm)
 	}
 
 	plan->mm = mm;
+	plan->module = QUERY_MODULE_NONE;
 	for (unsigned i = 0; i < QUERY_PLAN_STAGES; ++i) {
 		init_list(&plan->stage[i]);
 	}
@@ -48,7 +50,8 @@ void query_plan_free(struct query_plan *plan)
 	mm_free(plan->mm, plan);
 }
 
-static struct query_step *make_step(mm_ctx_t *mm, qmodule_process_t process, void *ctx)
+static struct query_step *make_step(mm_ctx_t *mm, qmodule_process_t process,
+                                     void *ctx, unsigned module)
 {
 	struct query_step *step = mm_alloc(mm, sizeof(struct query_step));
 	if (step == NULL) {
@@ -58,12 +61,13 @@ static struct query_step *make_step(mm_ctx_t *mm, qmodule_process_t process, voi
 	memset(step, 0, sizeof(struct query_step));
 	step->process = process;
 	step->ctx = ctx;
+	step->module = module;
 	return step;
 }
 
 int query_plan_step(struct query_plan *plan, int stage, qmodule_process_t process, void *ctx)
 {
-	struct query_step *step = make_step(plan->mm, process, ctx);
+	struct query_step *step = make_step(plan->mm, process, ctx, plan->module);
 	if (step == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -76,9 +80,10 @@ struct query_module *query_module_open(const char *name, const char *param, mm_c
 {
 	/* Locate compiled-in modules. */
 	struct compiled_module *found = NULL;
-	for (unsigned i = 0; i < MODULE_COUNT; ++i) {
-		if (strcmp(MODULES[i].name, name) == 0) {
-			found = &MODULES[i];
+	unsigned id = 0;
+	for (; id < QUERY_MODULE_COUNT; ++id) {
+		if (strcmp(MODULES[id].name, name) == 0) {
+			found = &MODULES[id];
 			break;
 		}
 	}
@@ -95,6 +100,7 @@ struct query_module *query_module_open(const char *name, const char *param, mm_c
 
 	memset(module, 0, sizeof(struct query_module));
 	module->mm = mm;
+	module->id = id;
 	module->load = found->load;
 	module->unload = found->unload;
 	module->param = mm_alloc(mm, strlen(param) + 1);
@@ -107,6 +113,28 @@ struct query_module *query_module_open(const char *name, const char *param, mm_c
 	return module;
 }
 
+int query_module_load(struct query_plan *plan, struct query_module *module)
+{
+	if (plan == NULL || module == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	plan->module = module->id;
+	int ret = module->load(plan, module);
+	plan->module = QUERY_MODULE_NONE;
+
+	return ret;
+}
+
+const char *query_module_name(unsigned id)
+{
+	if (id >= QUERY_MODULE_COUNT) {
+		return NULL;
+	}
+
+	return MODULES[id].name;
+}
+
 void query_module_close(struct query_module *module)
 {
 	if (module == NULL) {
@@ -60,6 +60,12 @@ enum query_stage {
 
 /* Forward declarations. */
 struct query_data;
+/*! \brief Number of compiled-in modules. */
+#define QUERY_MODULE_COUNT 2
+
+/*! \brief Module index of the steps not planned by a module. */
+#define QUERY_MODULE_NONE QUERY_MODULE_COUNT
+
 struct query_module;
 struct query_plan;
 
@@ -78,6 +84,7 @@ struct query_module {
 	void *ctx;
 	char *param;
 	mm_ctx_t *mm;
+	unsigned id; /*!< Index of the compiled-in module. */
 	qmodule_load_t load;
 	qmodule_unload_t unload;
 };
@@ -87,6 +94,7 @@ struct query_step {
 	node_t node;
 	void *ctx;
 	qmodule_process_t process;
+	unsigned module; /*!< Module which planned the step. */
 };
 
 /*! Query plan represents a sequence of steps needed for query processing
@@ -96,6 +104,7 @@ struct query_step {
 struct query_plan {
 	mm_ctx_t *mm;
 	list_t stage[QUERY_PLAN_STAGES];
+	unsigned module; /*!< Module being loaded (owns planned steps). */
 };
 
 /*! \brief Create an empty query plan. */
@@ -113,6 +122,15 @@ int query_plan_step(struct query_plan *plan, int stage, qmodule_process_t proces
  */
 struct query_module *query_module_open(const char *name, const char *param, mm_ctx_t *mm);
 
+/*!
+ * \brief Load query module into the plan.
+ * \note Steps planned by the module are attributed to it.
+ */
+int query_module_load(struct query_plan *plan, struct query_module *module);
+
+/*! \brief Return name of the compiled-in module with given index (or NULL). */
+const char *query_module_name(unsigned id);
+
 /*!
  * \brief Close query module.
  * \note Module 'unload' hook is called before closing.
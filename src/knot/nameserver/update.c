@@ -10,7 +10,19 @@
 #include "libknot/tsig-op.h"
 
 /* Forward decls. */
-static int zones_process_update_auth(struct query_data *qdata);
+static int zones_process_update_auth(zone_t *zone, list_t *batch);
+
+/*! \brief Maximum number of UPDATE messages committed in one batch. */
+#define UPDATE_BATCH_MAX 256
+
+/*! \brief Queued UPDATE request, lives on the stack of the waiting worker. */
+struct update_req {
+	node_t n;
+	struct query_data *qdata;
+	int ret;
+	bool done;
+	bool applied; /*!< Changes merged into the batch changeset. */
+};
 
 /* AXFR-specific logging (internal, expects 'qdata' variable set). */
 #define UPDATE_LOG(severity, msg...) \
@@ -79,24 +91,104 @@ static int update_forward(knot_pkt_t *pkt, struct query_data *qdata)
 	return NS_PROC_DONE;
 }
 
-static int update_prereq_check(struct query_data *qdata)
+static bool update_has_prereqs(const struct update_req *req)
 {
-	knot_pkt_t *query = qdata->query;
-	const knot_zone_contents_t *contents = qdata->zone->contents;
-	// DDNS Prerequisities Section processing (RFC2136, Section 3.2).
-	return knot_ddns_process_prereqs(query, contents, &qdata->rcode);
+	return knot_pkt_section(req->qdata->query, KNOT_ANSWER)->count > 0;
 }
 
-static int update_process(knot_pkt_t *resp, struct query_data *qdata)
+/*!
+ * \brief Move a batch of pending requests from the zone queue.
+ *
+ * Prerequisites are evaluated against the current zone contents, therefore
+ * an UPDATE with prerequisites may only open a new batch.
+ *
+ * \note Expects zone->ddns.lock to be held.
+ */
+static size_t update_take_batch(zone_t *zone, list_t *batch)
 {
-	/* Check prerequisites. */
-	int ret = update_prereq_check(qdata);
-	if (ret != KNOT_EOK) {
-		return ret;
+	size_t count = 0;
+	struct update_req *req = NULL, *nxt = NULL;
+	WALK_LIST_DELSAFE(req, nxt, zone->ddns.queue) {
+		if (count > 0 && update_has_prereqs(req)) {
+			break;
+		}
+		rem_node(&req->n);
+		add_tail(batch, &req->n);
+		if (++count == UPDATE_BATCH_MAX) {
+			break;
+		}
+	}
+
+	return count;
+}
+
+/*! \brief Apply and commit one batch of UPDATE requests. */
+static void update_process_batch(zone_t *zone, list_t *batch)
+{
+	pthread_mutex_lock(&zone->ddns_lock);
+
+	/* Check if the zone is not discarded. */
+	int ret = KNOT_EOK;
+	if (zone->flags & ZONE_DISCARDED) {
+		ret = KNOT_ENOZONE;
+	} else {
+		ret = zones_process_update_auth(zone, batch);
+	}
+
+	pthread_mutex_unlock(&zone->ddns_lock);
+
+	/* Failed commit fails every request whose changes were merged. */
+	struct update_req *req = NULL;
+	WALK_LIST(req, *batch) {
+		if (ret != KNOT_EOK && req->ret == KNOT_EOK) {
+			req->qdata->rcode = KNOT_RCODE_SERVFAIL;
+			req->ret = ret;
+		}
+	}
+}
+
+/*!
+ * \brief Queue UPDATE for the zone and wait until it is committed.
+ *
+ * The first worker to find no commit in progress becomes the leader, takes
+ * a batch of pending requests and commits them as a single zone change,
+ * other workers wait for the result.
+ *
+ * \note Must be called without RCU read lock held, as the commit waits for
+ *       the readers to finish.
+ */
+static int update_enqueue(zone_t *zone, struct query_data *qdata)
+{
+	struct update_req req = { .qdata = qdata, .ret = KNOT_EOK };
+
+	pthread_mutex_lock(&zone->ddns.lock);
+	add_tail(&zone->ddns.queue, &req.n);
+	while (!req.done) {
+		if (zone->ddns.leader) {
+			pthread_cond_wait(&zone->ddns.done, &zone->ddns.lock);
+			continue;
+		}
+
+		/* Lead the next batch. */
+		list_t batch;
+		init_list(&batch);
+		zone->ddns.leader = true;
+		update_take_batch(zone, &batch);
+		pthread_mutex_unlock(&zone->ddns.lock);
+
+		update_process_batch(zone, &batch);
+
+		pthread_mutex_lock(&zone->ddns.lock);
+		struct update_req *done = NULL;
+		WALK_LIST(done, batch) {
+			done->done = true;
+		}
+		zone->ddns.leader = false;
+		pthread_cond_broadcast(&zone->ddns.done);
 	}
+	pthread_mutex_unlock(&zone->ddns.lock);
 
-	/*! \todo Reusing the API for compatibility reasons. */
-	return zones_process_update_auth(qdata);
+	return req.ret;
 }
 
 int update_answer(knot_pkt_t *pkt, struct query_data *qdata)
@@ -117,23 +209,6 @@ int update_answer(knot_pkt_t *pkt, struct query_data *qdata)
 	NS_NEED_AUTH(zone->update_in, qdata);
 	NS_NEED_ZONE_CONTENTS(qdata, KNOT_RCODE_SERVFAIL); /* Check expiration. */
 
-	/*
-	 * Check if UPDATE not running already.
-	 */
-	if (pthread_mutex_trylock(&zone->ddns_lock) != 0) {
-		qdata->rcode = KNOT_RCODE_SERVFAIL;
-		log_zone_error("Failed to process UPDATE for "
-		               "zone %s: Another UPDATE in progress.\n",
-		               zone->conf->name);
-		return NS_PROC_FAIL;
-	}
-
-	/* Check if the zone is not discarded. */
-	if (zone->flags & ZONE_DISCARDED) {
-		pthread_mutex_unlock(&zone->ddns_lock);
-		return NS_PROC_FAIL;
-	}
-
 	struct timeval t_start = {0}, t_end = {0};
 	gettimeofday(&t_start, NULL);
 	UPDATE_LOG(LOG_INFO, "Started (serial %u).", knot_zone_serial(qdata->zone->contents));
@@ -146,15 +221,14 @@ int update_answer(knot_pkt_t *pkt, struct query_data *qdata)
 	 * @note This is going to be fixed when this is made a zone event. */
 	zone_retain(zone);
 
-	/* Process UPDATE. */
+	/* Process UPDATE, possibly together with concurrent ones. */
 	rcu_read_unlock();
-	int ret = update_process(pkt, qdata);
+	int ret = update_enqueue(zone, qdata);
 	rcu_read_lock();
 
 	/* Since we unlocked RCU read lock, it is possible that the
 	 * zone was modified/removed in the background. Therefore,
 	 * we must NOT touch the zone after we release it here. */
-	pthread_mutex_unlock(&zone->ddns_lock);
 	zone_release(zone);
 	qdata->zone = NULL;
 
@@ -172,24 +246,96 @@ int update_answer(knot_pkt_t *pkt, struct query_data *qdata)
 	}
 }
 
-static int knot_ns_process_update(const knot_pkt_t *query,
-                                  zone_t *old_zone,
-                                  knot_changesets_t *chgs, uint16_t *rcode,
-                                  uint32_t new_serial)
+/*! \brief Merge single UPDATE into the batch changeset. */
+static int update_merge(zone_t *zone, struct update_req *req,
+                        knot_changeset_t *chgset, uint32_t new_serial)
 {
-	if (query == NULL || old_zone == NULL || chgs == NULL ||
-	    EMPTY_LIST(chgs->sets) || rcode == NULL) {
-		return KNOT_EINVAL;
+	struct query_data *qdata = req->qdata;
+	const knot_zone_contents_t *contents = zone->contents;
+
+	/* SERVFAIL unless it applies correctly. */
+	qdata->rcode = KNOT_RCODE_SERVFAIL;
+
+	/* DDNS Prerequisities Section processing (RFC2136, Section 3.2). */
+	int ret = knot_ddns_process_prereqs(qdata->query, contents, &qdata->rcode);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
 	dbg_ns("Applying UPDATE to zone...\n");
+	return knot_ddns_process_update(contents, qdata->query, chgset,
+	                                &qdata->rcode, new_serial);
+}
 
-	// Create changesets from UPDATE
-	dbg_ns_verb("Applying the UPDATE and creating changeset...\n");
-	int ret = knot_ddns_process_update(old_zone->contents, query,
-	                                   knot_changesets_get_last(chgs),
-	                                   rcode, new_serial);
-	return ret;
+/*! \brief Set RCODE of all successfully merged UPDATEs in the batch. */
+static void update_set_rcode(list_t *batch, uint16_t rcode)
+{
+	struct update_req *req = NULL;
+	WALK_LIST(req, *batch) {
+		if (req->ret == KNOT_EOK) {
+			req->qdata->rcode = rcode;
+		}
+	}
+}
+
+/*! \brief Create changesets structure with a single empty changeset. */
+static knot_changesets_t *update_changesets_create(void)
+{
+	knot_changesets_t *chgsets = knot_changesets_create();
+	if (chgsets == NULL) {
+		return NULL;
+	}
+
+	if (knot_changesets_create_changeset(chgsets) == NULL) {
+		knot_changesets_free(&chgsets);
+		return NULL;
+	}
+
+	return chgsets;
+}
+
+/*!
+ * \brief Merge batch of UPDATEs into single changeset.
+ *
+ * UPDATE which fails in the middle of processing may leave its changes
+ * in the changeset, so the changeset is rebuilt from the applied ones.
+ */
+static int update_merge_batch(zone_t *zone, list_t *batch,
+                              knot_changesets_t **chgsets, uint32_t new_serial)
+{
+	struct update_req *req = NULL;
+	WALK_LIST(req, *batch) {
+		knot_changeset_t *chgset = knot_changesets_get_last(*chgsets);
+		req->ret = update_merge(zone, req, chgset, new_serial);
+		if (req->ret == KNOT_EOK) {
+			req->applied = true;
+			continue;
+		}
+
+		/* Rebuild the changeset from the applied UPDATEs. */
+		knot_changesets_free(chgsets);
+		*chgsets = update_changesets_create();
+		if (*chgsets == NULL) {
+			return KNOT_ENOMEM;
+		}
+
+		struct update_req *prev = NULL;
+		WALK_LIST(prev, *batch) {
+			if (prev == req) {
+				break;
+			}
+			if (!prev->applied) {
+				continue;
+			}
+			chgset = knot_changesets_get_last(*chgsets);
+			int ret = update_merge(zone, prev, chgset, new_serial);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	return KNOT_EOK;
 }
 
 static int replan_zone_sign_after_ddns(zone_t *zone, uint32_t refresh_at)
@@ -204,64 +350,71 @@ static int replan_zone_sign_after_ddns(zone_t *zone, uint32_t refresh_at)
 	return zones_schedule_dnssec(zone, refresh_at);
 }
 
-/*! \brief Process UPDATE query.
- *
- * Functions expects that the query is already authenticated
- * and TSIG signature is verified.
- *
- * \note Set parameter 'rcode' according to answering procedure.
- * \note Function expects RCU to be locked.
- *
- * \retval KNOT_EOK if successful.
- * \retval error if not.
- */
-static int zones_process_update_auth(struct query_data *qdata)
+/*! \brief Create log message prefix for the batch. */
+static char *update_log_prefix(const zone_t *zone, list_t *batch)
 {
-	assert(qdata);
-	assert(qdata->zone);
+	size_t count = list_size(batch);
+	if (count > 1) {
+		return sprintf_alloc("UPDATE of '%s' (batch of %zu)",
+		                     zone->conf->name, count);
+	}
 
-	zone_t *zone = (zone_t *)qdata->zone;
-	conf_zone_t *zone_config = zone->conf;
+	struct query_data *qdata = ((struct update_req *)HEAD(*batch))->qdata;
 	knot_tsig_key_t *tsig_key = qdata->sign.tsig_key;
 	const struct sockaddr_storage *addr = qdata->param->query_source;
 
-	int ret = KNOT_EOK;
-
-	/* Create log message prefix. */
 	char *keytag = NULL;
 	if (tsig_key) {
 		keytag = knot_dname_to_str(tsig_key->name);
 	}
 	char *r_str = xfr_remote_str(addr, keytag);
 	char *msg  = sprintf_alloc("UPDATE of '%s' from %s",
-	                           zone_config->name, r_str ? r_str : "'unknown'");
+	                           zone->conf->name, r_str ? r_str : "'unknown'");
 	free(r_str);
 	free(keytag);
 
+	return msg;
+}
+
+/*! \brief Process batch of UPDATE queries as a single zone change.
+ *
+ * Functions expects that the queries are already authenticated
+ * and TSIG signatures are verified.
+ *
+ * \note Sets 'rcode' and 'ret' of each request that fails on its own,
+ *       the result of the whole change is returned.
+ * \note Function expects zone DDNS lock to be held.
+ *
+ * \retval KNOT_EOK if successful.
+ * \retval error if not.
+ */
+static int zones_process_update_auth(zone_t *zone, list_t *batch)
+{
+	assert(zone);
+	assert(batch);
+
+	conf_zone_t *zone_config = zone->conf;
+	int ret = KNOT_EOK;
+
+	/* Create log message prefix. */
+	char *msg = update_log_prefix(zone, batch);
+
 	/*!
 	 * We must prepare a changesets_t structure even though there will
 	 * be only one changeset - because of the API.
 	 */
-	knot_changesets_t *chgsets = knot_changesets_create();
+	knot_changesets_t *chgsets = update_changesets_create();
 	if (chgsets == NULL) {
-		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		log_zone_error("%s Cannot create changesets structure.\n", msg);
 		free(msg);
-		return ret;
-	}
-
-	// Process the UPDATE packet, create changesets.
-	if (knot_changesets_create_changeset(chgsets) == NULL) {
-		knot_changesets_free(&chgsets);
-		free(msg);
 		return KNOT_ENOMEM;
 	}
-	qdata->rcode = KNOT_RCODE_SERVFAIL; /* SERVFAIL unless it applies correctly. */
 
 	uint32_t new_serial = zones_next_serial(zone);
 
+	// Process the UPDATE packets, merge them into single changeset.
 	knot_zone_contents_t *old_contents = zone->contents;
-	ret = knot_ns_process_update(qdata->query, zone, chgsets, &qdata->rcode, new_serial);
+	ret = update_merge_batch(zone, batch, &chgsets, new_serial);
 	if (ret != KNOT_EOK) {
 		knot_changesets_free(&chgsets);
 		free(msg);
@@ -273,7 +426,7 @@ static int zones_process_update_auth(struct query_data *qdata)
 		!knot_changeset_is_empty(knot_changesets_get_last(chgsets));
 	if (!change_made) {
 		log_zone_notice("%s: No change to zone made.\n", msg);
-		qdata->rcode = KNOT_RCODE_NOERROR;
+		update_set_rcode(batch, KNOT_RCODE_NOERROR);
 		knot_changesets_free(&chgsets);
 		free(msg);
 		return KNOT_EOK;
@@ -281,7 +434,6 @@ static int zones_process_update_auth(struct query_data *qdata)
 		ret = xfrin_apply_changesets(zone, chgsets, &new_contents);
 		if (ret != KNOT_EOK) {
 			log_zone_notice("%s: Failed to process: %s.\n", msg, knot_strerror(ret));
-			qdata->rcode = KNOT_RCODE_SERVFAIL;
 			knot_changesets_free(&chgsets);
 			free(msg);
 			return ret;
@@ -316,7 +468,7 @@ static int zones_process_update_auth(struct query_data *qdata)
 		if (zones_dnskey_changed(old_contents, new_contents) ||
 		    zones_nsec3param_changed(old_contents, new_contents)) {
 			ret = knot_dnssec_zone_sign(new_contents, zone_config,
-			                            sec_ch,
+			                            NULL, sec_ch,
 			                            KNOT_SOA_SERIAL_KEEP,
 			                            &refresh_at, new_serial);
 		} else {
@@ -370,7 +522,7 @@ static int zones_process_update_auth(struct query_data *qdata)
 		}
 
 		// Plan zone resign if needed
-		assert(qdata->zone->dnssec.timer);
+		assert(zone->dnssec.timer);
 		ret = replan_zone_sign_after_ddns(zone, refresh_at);
 		if (ret != KNOT_EOK) {
 			log_zone_error("%s: Failed to replan zone sign (%s)\n",
@@ -429,7 +581,7 @@ static int zones_process_update_auth(struct query_data *qdata)
 	// Free changesets, but not the data.
 	zones_free_merged_changesets(chgsets, sec_chs);
 	assert(ret == KNOT_EOK);
-	qdata->rcode = KNOT_RCODE_NOERROR; /* Mark as successful. */
+	update_set_rcode(batch, KNOT_RCODE_NOERROR); /* Mark as successful. */
 	if (new_signatures) {
 		log_zone_info("%s: Successfuly signed.\n", msg);
 	}
@@ -445,6 +597,10 @@ static int zones_process_update_auth(struct query_data *qdata)
 		zones_schedule_zonefile_sync(zone, 0);
 	}
 
+	/* Notify slaves, once for the whole batch. */
+	struct query_data *qdata = ((struct update_req *)HEAD(*batch))->qdata;
+	zones_schedule_notify(zone, qdata->param->server);
+
 	return ret;
 }
 
@@ -20,6 +20,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <assert.h>
+#include <inttypes.h>
 
 #include "knot/knot.h"
 #include "knot/server/server.h"
@@ -28,6 +29,7 @@
 #include "knot/server/xfr-handler.h"
 #include "knot/server/zones.h"
 #include "knot/server/zone-load.h"
+#include "common/mempattern.h"
 #include "knot/conf/conf.h"
 #include "knot/zone/zonedb.h"
 #include "libknot/dname.h"
@@ -113,6 +115,7 @@ static int server_init_iface(iface_t *new_if, conf_iface_t *cfg_if)
 	int ret = 0;
 	memset(new_if, 0, sizeof(iface_t));
 	memcpy(&new_if->addr, &cfg_if->addr, sizeof(struct sockaddr_storage));
+	new_if->numa_node = cfg_if->numa_node;
 
 	/* Convert to string address format. */
 	char addr_str[SOCKADDR_STRLEN] = {0};
@@ -219,6 +222,7 @@ static int reconfigure_sockets(const struct conf_t *conf, server_t *s)
 		/* Found already bound interface. */
 		if (found_match) {
 			rem_node((node_t *)m);
+			m->numa_node = cfg_if->numa_node;
 		} else {
 			sockaddr_tostr(&cfg_if->addr, addr_str, sizeof(addr_str));
 			log_server_info("Binding to interface %s.\n", addr_str);
@@ -231,6 +235,15 @@ static int reconfigure_sockets(const struct conf_t *conf, server_t *s)
 			}
 		}
 
+		/* Node preference is void without such node. */
+		if (m && m->numa_node >= 0 &&
+		    numa_topo_node(&s->numa, m->numa_node) == NULL) {
+			sockaddr_tostr(&cfg_if->addr, addr_str, sizeof(addr_str));
+			log_server_warning("NUMA node %d of interface %s does not "
+			                   "exist, serving from all nodes.\n",
+			                   m->numa_node, addr_str);
+		}
+
 		/* Move to new list. */
 		if (m) {
 			add_tail(&newlist->l, (node_t *)m);
@@ -268,14 +281,23 @@ int server_init(server_t *server)
 	}
 
 	memset(server, 0, sizeof(server_t));
+	pthread_mutex_init(&server->stats.lock, NULL);
+	stats_clock_init();
+
+	/* Discover NUMA topology. */
+	if (numa_topo_load(&server->numa, NULL) != KNOT_EOK) {
+		return KNOT_ENOMEM;
+	}
 
 	/* Initialize event scheduler. */
 	if (evsched_init(&server->sched, server) != KNOT_EOK) {
+		numa_topo_free(&server->numa);
 		return KNOT_ENOMEM;
 	}
 	server->iosched = dt_create(1, evsched_run, evsched_destruct, &server->sched);
 	if (server->iosched == NULL) {
 		evsched_deinit(&server->sched);
+		numa_topo_free(&server->numa);
 		return KNOT_ENOMEM;
 	}
 
@@ -284,6 +306,7 @@ int server_init(server_t *server)
 	if (server->xfr == NULL) {
 		dt_delete(&server->iosched);
 		evsched_deinit(&server->sched);
+		numa_topo_free(&server->numa);
 		return KNOT_ENOMEM;
 	}
 
@@ -313,10 +336,19 @@ void server_deinit(server_t *server)
 	/* Free rate limits. */
 	rrl_destroy(server->rrl);
 
+	/* Free NUMA topology. */
+	numa_topo_free(&server->numa);
+
 	/* Free zone database. */
 	knot_edns_free(&server->opt_rr);
 	knot_zonedb_deep_free(&server->zone_db);
 
+	/* Free statistics dump event. */
+	if (server->stats.dump && evsched_cancel(server->stats.dump) == KNOT_EOK) {
+		evsched_event_free(server->stats.dump);
+	}
+	pthread_mutex_destroy(&server->stats.lock);
+
 	/* Free remaining events. */
 	evsched_deinit(&server->sched);
 
@@ -342,6 +374,22 @@ static int server_init_handler(server_t *server, int index, int thread_count,
 		return KNOT_ENOMEM;
 	}
 
+	stats_worker_t *stats = stats_new(thread_count);
+	if (stats == NULL) {
+		free(h->thread_state);
+		dt_delete(&h->unit);
+		return KNOT_ENOMEM;
+	}
+
+	for (unsigned i = 0; i < thread_count; ++i) {
+		stats[i].zone_row = i * IO_COUNT + index;
+	}
+
+	/* Publish counters for readers. */
+	pthread_mutex_lock(&server->stats.lock);
+	h->stats = stats;
+	pthread_mutex_unlock(&server->stats.lock);
+
 	return KNOT_EOK;
 }
 
@@ -357,6 +405,16 @@ static void server_free_handler(iohandler_t *h)
 		dt_join(h->unit);
 	}
 
+	/* Keep counters of retired workers. */
+	server_t *server = h->server;
+	pthread_mutex_lock(&server->stats.lock);
+	if (h->unit) {
+		stats_sum(&server->stats.base, h->stats, h->unit->size);
+	}
+	stats_free(h->stats);
+	h->stats = NULL;
+	pthread_mutex_unlock(&server->stats.lock);
+
 	/* Destroy worker context. */
 	dt_delete(&h->unit);
 	free(h->thread_state);
@@ -484,6 +542,40 @@ static int opt_rr_reconfigure(const struct conf_t *conf, server_t *server)
 	return KNOT_EOK;
 }
 
+const numa_node_t *server_worker_node(const server_t *s, unsigned id)
+{
+	return &s->numa.nodes[id % s->numa.count];
+}
+
+bool server_worker_serves(const server_t *s, unsigned id, const iface_t *iface)
+{
+	if (iface->numa_node < 0 ||
+	    server_worker_node(s, id)->id == (unsigned)iface->numa_node) {
+		return true;
+	}
+
+	/* Workers on the node are the first ones in each round. */
+	unsigned workers = s->handler[IO_UDP].unit->size;
+	for (unsigned i = 0; i < s->numa.count && i < workers; ++i) {
+		if (s->numa.nodes[i].id == (unsigned)iface->numa_node) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*! \brief Log placement of UDP workers on NUMA nodes. */
+static void log_worker_layout(const server_t *s, unsigned workers)
+{
+	for (unsigned i = 0; i < s->numa.count && i < workers; ++i) {
+		const numa_node_t *node = &s->numa.nodes[i];
+		unsigned count = (workers - i + s->numa.count - 1) / s->numa.count;
+		log_server_info("NUMA node %u: %u CPUs, %u UDP workers.\n",
+		                node->id, node->ncpus, count);
+	}
+}
+
 /*! \brief Reconfigure UDP and TCP query processing threads. */
 static int reconfigure_threads(const struct conf_t *conf, server_t *server)
 {
@@ -510,6 +602,10 @@ static int reconfigure_threads(const struct conf_t *conf, server_t *server)
 			return ret;
 		}
 
+		if (server->numa.count > 1) {
+			log_worker_layout(server, tu_size);
+		}
+
 		/* Create at least CONFIG_XFERS threads for TCP for faster
 		 * processing of massive bootstrap queries. */
 		ret = server_init_handler(server, IO_TCP, MAX(tu_size * 2, CONFIG_XFERS),
@@ -532,6 +628,93 @@ static int reconfigure_threads(const struct conf_t *conf, server_t *server)
 	return ret;
 }
 
+/*! \brief Initial statistics buffer size, grows as needed. */
+#define STATS_BUFLEN (64 * 1024)
+
+/*! \brief Periodic statistics dump event. */
+static int server_stats_dump(event_t *event)
+{
+	server_t *server = (server_t *)event->data;
+
+	rcu_read_lock();
+	char *path = conf()->stats_file ? strdup(conf()->stats_file) : NULL;
+	int interval = conf()->stats_interval;
+	rcu_read_unlock();
+
+	/* Dumping was disabled in the meantime. */
+	if (path == NULL) {
+		return KNOT_EOK;
+	}
+
+	/* Format statistics. */
+	size_t buflen = STATS_BUFLEN;
+	char *buf = NULL;
+	int ret = KNOT_ESPACE;
+	while (ret == KNOT_ESPACE) {
+		free(buf);
+		buf = malloc(buflen);
+		if (buf == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		ret = server_stats(server, buf, buflen, false);
+		buflen *= 2;
+	}
+
+	/* Replace the file atomically, so readers never see partial dump. */
+	if (ret >= 0) {
+		char *tmp = strcdup(path, ".tmp");
+		FILE *fp = tmp ? fopen(tmp, "w") : NULL;
+		if (fp != NULL) {
+			size_t len = ret;
+			bool written = (fwrite(buf, 1, len, fp) == len);
+			written = (fclose(fp) == 0) && written;
+			if (!written || rename(tmp, path) != 0) {
+				unlink(tmp);
+				ret = KNOT_ERROR;
+			}
+		} else {
+			ret = KNOT_EACCES;
+		}
+		free(tmp);
+	}
+
+	if (ret < 0) {
+		log_server_warning("Failed to dump statistics to '%s' (%s).\n",
+		                   path, knot_strerror(ret));
+	}
+
+	free(buf);
+	free(path);
+
+	/* Reschedule. */
+	return evsched_schedule(event, interval * 1000);
+}
+
+static int reconfigure_stats(const struct conf_t *conf, server_t *server)
+{
+	server->stats.latency = conf->stats_latency;
+
+	/* Stop dumping. */
+	if (conf->stats_file == NULL) {
+		if (server->stats.dump) {
+			evsched_cancel(server->stats.dump);
+		}
+		return KNOT_EOK;
+	}
+
+	if (server->stats.dump == NULL) {
+		server->stats.dump = evsched_event_create(&server->sched,
+		                                          server_stats_dump,
+		                                          server);
+		if (server->stats.dump == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	return evsched_schedule(server->stats.dump, conf->stats_interval * 1000);
+}
+
 static int reconfigure_rate_limits(const struct conf_t *conf, server_t *server)
 {
 	/* Rate limiting. */
@@ -599,6 +782,12 @@ int server_reconfigure(const struct conf_t *conf, void *data)
 		return ret;
 	}
 
+	/* Reconfigure statistics dump. */
+	if ((ret = reconfigure_stats(conf, server)) < 0) {
+		log_server_error("Failed to reconfigure statistics.\n");
+		return ret;
+	}
+
 	return ret;
 }
 
@@ -632,3 +821,91 @@ ref_t *server_set_ifaces(server_t *s, fdset_t *fds, int type)
 	rcu_read_unlock();
 	return (ref_t *)s->ifaces;
 }
+
+/*! \brief Space reserved for the omitted zones line. */
+#define STATS_OMITTED_LEN 64
+
+int server_stats(server_t *s, char *dst, size_t len, bool truncate)
+{
+	if (s == NULL || dst == NULL || len == 0) {
+		return KNOT_EINVAL;
+	}
+
+	/* Sum up current and retired workers. */
+	stats_worker_t *total = stats_new(1);
+	if (total == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	pthread_mutex_lock(&s->stats.lock);
+	stats_sum(total, &s->stats.base, 1);
+	for (unsigned i = 0; i < IO_COUNT; ++i) {
+		iohandler_t *h = &s->handler[i];
+		if (h->stats != NULL) {
+			stats_sum(total, h->stats, h->unit->size);
+		}
+	}
+	pthread_mutex_unlock(&s->stats.lock);
+
+	int ret = stats_print(total, dst, len);
+	stats_free(total);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* Per-zone query counts. */
+	size_t wb = ret;
+	size_t limit = len;
+	if (truncate) {
+		if (len - wb <= STATS_OMITTED_LEN) {
+			return KNOT_ESPACE;
+		}
+		limit -= STATS_OMITTED_LEN;
+	}
+
+	size_t omitted = 0;
+	rcu_read_lock();
+	knot_zonedb_t *zone_db = s->zone_db;
+	if (zone_db != NULL) {
+		knot_zonedb_iter_t it;
+		knot_zonedb_iter_begin(zone_db, &it);
+		while (!knot_zonedb_iter_finished(&it)) {
+			const zone_t *zone = knot_zonedb_iter_val(&it);
+			knot_zonedb_iter_next(&it);
+			if (omitted > 0) {
+				++omitted;
+				continue;
+			}
+
+			uint64_t queries = stats_zone_sum(zone->queries.table,
+			                                  zone->queries.index);
+			int n = snprintf(dst + wb, limit - wb, "zone.%s: %" PRIu64 "\n",
+			                 zone->conf->name, queries);
+			if (n < 0 || (size_t)n >= limit - wb) {
+				if (!truncate) {
+					ret = KNOT_ESPACE;
+					break;
+				}
+				dst[wb] = '\0';
+				omitted = 1;
+				continue;
+			}
+			wb += n;
+		}
+	}
+	rcu_read_unlock();
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (omitted > 0) {
+		int n = snprintf(dst + wb, len - wb, "zones-omitted: %zu\n", omitted);
+		if (n < 0 || (size_t)n >= len - wb) {
+			return KNOT_ESPACE;
+		}
+		wb += n;
+	}
+
+	return wb;
+}
@@ -38,10 +38,12 @@
 
 #include "common/evsched.h"
 #include "common/lists.h"
+#include "common/numa.h"
 #include "knot/server/xfr-handler.h"
 #include "knot/server/dthreads.h"
 #include "knot/server/net.h"
 #include "knot/server/rrl.h"
+#include "knot/server/stats.h"
 #include "knot/zone/zonedb.h"
 
 /* Forwad declarations. */
@@ -56,6 +58,7 @@ typedef struct iohandler {
 	struct server_t    *server; /*!< Reference to server */
 	dt_unit_t          *unit;   /*!< Threading unit */
 	unsigned           *thread_state; /*< Thread state */
+	stats_worker_t     *stats;  /*!< Per-thread query counters */
 } iohandler_t;
 
 /*! \brief Round-robin mechanism of switching.
@@ -78,6 +81,7 @@ typedef struct iface_t {
 	struct node n;
 	int fd[2];
 	struct sockaddr_storage addr;
+	int numa_node; /*!< Preferred NUMA node (-1 for any). */
 } iface_t;
 
 /* Handler types. */
@@ -121,6 +125,17 @@ typedef struct server_t {
 	/*! \brief Rate limiting. */
 	rrl_table_t *rrl;
 
+	/*! \brief NUMA topology for worker placement. */
+	numa_topo_t numa;
+
+	/*! \brief Query statistics. */
+	struct {
+		pthread_mutex_t lock; /*!< Serializes readers with handler changes. */
+		stats_worker_t base;  /*!< Counters of retired workers. */
+		event_t *dump;        /*!< Periodic dump to file. */
+		volatile bool latency; /*!< Collect latency histograms. */
+	} stats;
+
 } server_t;
 
 /*!
@@ -203,6 +218,48 @@ int server_update_zones(const struct conf_t *conf, void *data);
  */
 ref_t *server_set_ifaces(server_t *s, fdset_t *fds, int type);
 
+/*!
+ * \brief Format aggregated query statistics.
+ *
+ * Counters of all I/O workers are summed up with the counters of
+ * already retired workers, followed by per-zone query counts.
+ *
+ * \param s Server.
+ * \param dst Output buffer.
+ * \param len Output buffer size.
+ * \param truncate Omit per-zone counts not fitting into the buffer and
+ *                 print the number of omitted zones instead of failing.
+ *
+ * \retval Number of bytes written (excluding terminating zero).
+ * \retval KNOT_ESPACE if the buffer is too small.
+ * \retval KNOT_EINVAL on invalid parameters.
+ */
+int server_stats(server_t *s, char *dst, size_t len, bool truncate);
+
+/*!
+ * \brief NUMA node of the UDP worker.
+ *
+ * Workers are spread over nodes in round-robin order.
+ *
+ * \param s Server.
+ * \param id Worker ID.
+ *
+ * \return Node of the worker.
+ */
+const numa_node_t *server_worker_node(const server_t *s, unsigned id);
+
+/*!
+ * \brief Check if the UDP worker should serve the interface.
+ *
+ * Interfaces bound to a NUMA node are served by the workers on that
+ * node, or by all workers if no worker runs on the node.
+ *
+ * \param s Server.
+ * \param id Worker ID.
+ * \param iface Interface.
+ */
+bool server_worker_serves(const server_t *s, unsigned id, const iface_t *iface);
+
 #endif // _KNOTD_SERVER_H_
 
 /*! @} */
@@ -0,0 +1,392 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "knot/server/stats.h"
+#include "common/descriptor.h"
+#include "libknot/common.h"
+#include "libknot/consts.h"
+#include "libknot/packet/wire.h"
+#include "libknot/util/utils.h"
+
+/*! \brief Scalar counter names. */
+static const char *stats_ctr_names[STATS_COUNTERS] = {
+	"udp-queries",
+	"tcp-queries",
+	"udp-responses",
+	"tcp-responses",
+	"dropped",
+	"edns",
+	"dnssec-ok",
+	"truncated",
+	"rrl-slipped",
+	"rrl-dropped",
+	"qtype-other"
+};
+
+/*! \brief Latency stage names. */
+static const char *stats_stage_names[STATS_STAGE_MODULE] = {
+	"total",
+	"parse",
+	"zone-lookup",
+	"answer",
+	"authority",
+	"additional",
+	"dnssec",
+	"tsig",
+	"other"
+};
+
+/*! \brief Printed latency percentiles (in 1/10 of percent). */
+static const struct {
+	unsigned permille;
+	const char *name;
+} stats_percentiles[] = {
+	{ 500, "p50" },
+	{ 900, "p90" },
+	{ 990, "p99" },
+	{ 999, "p999" }
+};
+
+/*! \brief Clock reference point. */
+static struct {
+	uint64_t ticks;
+	uint64_t nsec;
+} stats_clock_ref;
+
+/*! \brief Clock reference initialization. */
+static pthread_once_t stats_clock_once = PTHREAD_ONCE_INIT;
+
+/*! \brief Monotonic time in nanoseconds. */
+static uint64_t stats_nsec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*! \brief Set the clock reference point. */
+static void stats_clock_ref_init(void)
+{
+	stats_clock_ref.nsec = stats_nsec();
+	stats_clock_ref.ticks = stats_clock();
+}
+
+void stats_clock_init(void)
+{
+	pthread_once(&stats_clock_once, stats_clock_ref_init);
+}
+
+/*! \brief Clock ticks per nanosecond measured since stats_clock_init(). */
+static double stats_clock_rate(void)
+{
+	stats_clock_init();
+
+	/* Too short interval since the reference, wait for usable ratio. */
+	uint64_t elapsed = stats_nsec() - stats_clock_ref.nsec;
+	if (elapsed < 1000000) {
+		struct timespec ts = { 0, 1000000 - elapsed };
+		nanosleep(&ts, NULL);
+	}
+
+	uint64_t ticks = stats_clock() - stats_clock_ref.ticks;
+	uint64_t nsec = stats_nsec() - stats_clock_ref.nsec;
+	return (double)ticks / nsec;
+}
+
+/*! \brief Upper bound of values in histogram bucket. */
+static uint64_t stats_hist_upper(unsigned idx)
+{
+	if (idx < STATS_HIST_SUBS) {
+		return idx;
+	}
+
+	unsigned shift = idx / STATS_HIST_SUBS - 1;
+	uint64_t lower = (uint64_t)(STATS_HIST_SUBS + idx % STATS_HIST_SUBS) << shift;
+	return lower + ((1ULL << shift) - 1);
+}
+
+/*! \brief Find value below which given fraction of samples fall. */
+static uint64_t stats_hist_percentile(const stats_hist_t *hist, unsigned permille)
+{
+	uint64_t rank = (hist->count * permille + 999) / 1000;
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < STATS_HIST_BUCKETS; ++i) {
+		seen += hist->bucket[i];
+		if (seen >= rank && seen > 0) {
+			return stats_hist_upper(i);
+		}
+	}
+
+	return 0;
+}
+
+void stats_response(stats_worker_t *st, const uint8_t *wire, size_t len,
+                    enum stats_ctr ctr)
+{
+	if (st == NULL) {
+		return;
+	}
+
+	if (len < KNOT_WIRE_HEADER_SIZE) {
+		++st->ctr[STATS_DROPPED];
+		return;
+	}
+
+	++st->ctr[ctr];
+	++st->rcode[knot_wire_get_rcode(wire)];
+	if (knot_wire_get_tc(wire)) {
+		++st->ctr[STATS_TRUNCATED];
+	}
+}
+
+void stats_query(stats_worker_t *st, const knot_pkt_t *query)
+{
+	if (st == NULL || query == NULL) {
+		return;
+	}
+
+	uint16_t qtype = knot_pkt_qtype(query);
+	if (qtype < STATS_QTYPE_COUNT) {
+		++st->qtype[qtype];
+	} else {
+		++st->ctr[STATS_QTYPE_OTHER];
+	}
+
+	if (knot_pkt_have_edns(query)) {
+		++st->ctr[STATS_EDNS];
+		if (knot_pkt_have_dnssec(query)) {
+			++st->ctr[STATS_DNSSEC_OK];
+		}
+	}
+}
+
+stats_worker_t *stats_new(unsigned count)
+{
+	if (count == 0) {
+		return NULL;
+	}
+
+	void *mem = NULL;
+	if (posix_memalign(&mem, STATS_CACHELINE,
+	                   count * sizeof(stats_worker_t)) != 0) {
+		return NULL;
+	}
+
+	memset(mem, 0, count * sizeof(stats_worker_t));
+	return mem;
+}
+
+void stats_free(stats_worker_t *st)
+{
+	free(st);
+}
+
+stats_zones_t *stats_zones_new(size_t zones)
+{
+	stats_zones_t *table = calloc(1, sizeof(stats_zones_t));
+	if (table == NULL) {
+		return NULL;
+	}
+
+	table->zones = zones;
+	return table;
+}
+
+void stats_zones_free(stats_zones_t *table)
+{
+	if (table == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i <= STATS_ZONE_ROWS; ++i) {
+		free(table->row[i]);
+	}
+	free(table);
+}
+
+/*! \brief Get the row, allocate it if not used yet. */
+static uint64_t *stats_zone_row(stats_zones_t *table, unsigned row)
+{
+	uint64_t *ctr = table->row[row];
+	if (ctr != NULL) {
+		return ctr;
+	}
+
+	ctr = calloc(table->zones, sizeof(uint64_t));
+	if (ctr == NULL) {
+		return NULL;
+	}
+
+	/* Shared row may be allocated concurrently. */
+	if (!__sync_bool_compare_and_swap(&table->row[row], NULL, ctr)) {
+		free(ctr);
+	}
+
+	return table->row[row];
+}
+
+void stats_zone_query(stats_zones_t *table, size_t zone,
+                      const stats_worker_t *st)
+{
+	if (table == NULL || zone >= table->zones) {
+		return;
+	}
+
+	bool shared = (st == NULL || st->zone_row >= STATS_ZONE_ROWS);
+	unsigned row = shared ? STATS_ZONE_ROWS : st->zone_row;
+	uint64_t *ctr = stats_zone_row(table, row);
+	if (ctr == NULL) {
+		return;
+	}
+
+	if (shared) {
+		__sync_fetch_and_add(&ctr[zone], 1);
+	} else {
+		++ctr[zone];
+	}
+}
+
+uint64_t stats_zone_sum(const stats_zones_t *table, size_t zone)
+{
+	if (table == NULL || zone >= table->zones) {
+		return 0;
+	}
+
+	uint64_t sum = 0;
+	for (unsigned i = 0; i <= STATS_ZONE_ROWS; ++i) {
+		const uint64_t *ctr = table->row[i];
+		if (ctr != NULL) {
+			sum += ctr[zone];
+		}
+	}
+
+	return sum;
+}
+
+void stats_sum(stats_worker_t *dst, const stats_worker_t *src, unsigned count)
+{
+	if (dst == NULL || src == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < count; ++i) {
+		for (unsigned j = 0; j < STATS_COUNTERS; ++j) {
+			dst->ctr[j] += src[i].ctr[j];
+		}
+		for (unsigned j = 0; j < STATS_RCODE_COUNT; ++j) {
+			dst->rcode[j] += src[i].rcode[j];
+		}
+		for (unsigned j = 0; j < STATS_QTYPE_COUNT; ++j) {
+			dst->qtype[j] += src[i].qtype[j];
+		}
+		for (unsigned j = 0; j < STATS_STAGES; ++j) {
+			const stats_hist_t *hist = &src[i].latency[j];
+			if (hist->count == 0) {
+				continue;
+			}
+			dst->latency[j].count += hist->count;
+			dst->latency[j].sum += hist->sum;
+			for (unsigned k = 0; k < STATS_HIST_BUCKETS; ++k) {
+				dst->latency[j].bucket[k] += hist->bucket[k];
+			}
+		}
+	}
+}
+
+/*! \brief Append formatted line to the buffer. */
+#define STATS_PRINT(fmt, ...) do { \
+	int n = snprintf(dst + wb, len - wb, fmt, ##__VA_ARGS__); \
+	if (n < 0 || (size_t)n >= len - wb) { \
+		return KNOT_ESPACE; \
+	} \
+	wb += n; \
+	} while (0)
+
+int stats_print(const stats_worker_t *st, char *dst, size_t len)
+{
+	if (st == NULL || dst == NULL || len == 0) {
+		return KNOT_EINVAL;
+	}
+
+	size_t wb = 0;
+	for (unsigned i = 0; i < STATS_COUNTERS; ++i) {
+		STATS_PRINT("%s: %" PRIu64 "\n", stats_ctr_names[i], st->ctr[i]);
+	}
+
+	for (unsigned i = 0; i < STATS_RCODE_COUNT; ++i) {
+		if (st->rcode[i] == 0) {
+			continue;
+		}
+		knot_lookup_table_t *rcode = knot_lookup_by_id(knot_rcode_names, i);
+		if (rcode != NULL) {
+			STATS_PRINT("rcode.%s: %" PRIu64 "\n", rcode->name, st->rcode[i]);
+		} else {
+			STATS_PRINT("rcode.RCODE%u: %" PRIu64 "\n", i, st->rcode[i]);
+		}
+	}
+
+	char type_str[64] = { '\0' };
+	for (unsigned i = 0; i < STATS_QTYPE_COUNT; ++i) {
+		if (st->qtype[i] == 0) {
+			continue;
+		}
+		if (knot_rrtype_to_string(i, type_str, sizeof(type_str)) < 0) {
+			continue;
+		}
+		STATS_PRINT("qtype.%s: %" PRIu64 "\n", type_str, st->qtype[i]);
+	}
+
+	double rate = 0.0;
+	for (unsigned i = 0; i < STATS_STAGES; ++i) {
+		const stats_hist_t *hist = &st->latency[i];
+		if (hist->count == 0) {
+			continue;
+		}
+		if (rate == 0.0) {
+			rate = stats_clock_rate();
+		}
+		char module_stage[64];
+		const char *stage = NULL;
+		if (i < STATS_STAGE_MODULE) {
+			stage = stats_stage_names[i];
+		} else {
+			snprintf(module_stage, sizeof(module_stage), "module.%s",
+			         query_module_name(i - STATS_STAGE_MODULE));
+			stage = module_stage;
+		}
+		STATS_PRINT("latency.%s.count: %" PRIu64 "\n", stage, hist->count);
+		STATS_PRINT("latency.%s.mean-ns: %" PRIu64 "\n", stage,
+		            (uint64_t)(hist->sum / rate / hist->count));
+		for (unsigned j = 0; j < sizeof(stats_percentiles) /
+		                         sizeof(stats_percentiles[0]); ++j) {
+			uint64_t val = stats_hist_percentile(hist,
+			                                     stats_percentiles[j].permille);
+			STATS_PRINT("latency.%s.%s-ns: %" PRIu64 "\n", stage,
+			            stats_percentiles[j].name, (uint64_t)(val / rate));
+		}
+	}
+
+	return wb;
+}
+
+#undef STATS_PRINT
@@ -0,0 +1,278 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file stats.h
+ *
+ * \brief Query statistics counters.
+ *
+ * Each I/O worker owns a cache line aligned block of counters, which is
+ * written only by that worker, so there is no locking nor atomic operation
+ * involved on the query path. Readers sum up the blocks of all workers,
+ * the values may be slightly stale, but never lost.
+ *
+ * Per-zone query counts are kept in a table owned by the zone database,
+ * with one row of counters per worker, so that queries to a single hot zone
+ * don't contend on a shared cache line.
+ *
+ * Optionally, the block carries log-linear latency histograms of the query
+ * processing stages. Each query module is timed as a separate stage.
+ * Samples are taken in raw clock ticks (TSC on x86) and converted to
+ * nanoseconds only when printed.
+ *
+ * \addtogroup server
+ * @{
+ */
+
+#ifndef _KNOTD_STATS_H_
+#define _KNOTD_STATS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "libknot/packet/pkt.h"
+#include "knot/nameserver/query_module.h"
+
+#define STATS_CACHELINE   64  /*!< Counter block alignment. */
+#define STATS_RCODE_COUNT 16  /*!< Number of RCODEs in the header. */
+#define STATS_QTYPE_COUNT 256 /*!< QTYPEs counted individually. */
+#define STATS_ZONE_ROWS   1024 /*!< Per-worker rows in zone counter table. */
+
+/*! \brief Linear sub-buckets per power of two (2^bits). */
+#define STATS_HIST_SUB_BITS 2
+#define STATS_HIST_SUBS (1 << STATS_HIST_SUB_BITS)
+#define STATS_HIST_BUCKETS ((64 - STATS_HIST_SUB_BITS + 1) * STATS_HIST_SUBS)
+
+/*! \brief Scalar counters. */
+enum stats_ctr {
+	STATS_UDP_QUERIES = 0, /*!< Queries received over UDP. */
+	STATS_TCP_QUERIES,     /*!< Queries received over TCP. */
+	STATS_UDP_RESPONSES,   /*!< Responses sent over UDP. */
+	STATS_TCP_RESPONSES,   /*!< Responses sent over TCP. */
+	STATS_DROPPED,         /*!< Queries without response. */
+	STATS_EDNS,            /*!< Queries with EDNS. */
+	STATS_DNSSEC_OK,       /*!< Queries with DO bit set. */
+	STATS_TRUNCATED,       /*!< Responses with TC bit set. */
+	STATS_RRL_SLIPPED,     /*!< Responses truncated by RRL. */
+	STATS_RRL_DROPPED,     /*!< Responses dropped by RRL. */
+	STATS_QTYPE_OTHER,     /*!< Queries with QTYPE >= STATS_QTYPE_COUNT. */
+	STATS_COUNTERS
+};
+
+/*! \brief Timed query processing stages. */
+enum stats_stage {
+	STATS_STAGE_TOTAL = 0,  /*!< UDP receive to send. */
+	STATS_STAGE_PARSE,      /*!< Query parsing. */
+	STATS_STAGE_ZONE,       /*!< Zone lookup. */
+	STATS_STAGE_ANSWER,     /*!< ANSWER section. */
+	STATS_STAGE_AUTHORITY,  /*!< AUTHORITY section. */
+	STATS_STAGE_ADDITIONAL, /*!< ADDITIONAL section. */
+	STATS_STAGE_DNSSEC,     /*!< RRSIGs and NSEC/NSEC3 proofs. */
+	STATS_STAGE_TSIG,       /*!< Response signing. */
+	STATS_STAGE_OTHER,      /*!< Planned steps not owned by a module. */
+	STATS_STAGE_MODULE,     /*!< Steps of the first compiled-in module. */
+	STATS_STAGES = STATS_STAGE_MODULE + QUERY_MODULE_COUNT
+};
+
+/*! \brief Log-linear latency histogram. */
+typedef struct stats_hist {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t bucket[STATS_HIST_BUCKETS];
+} stats_hist_t;
+
+/*! \brief Per-worker counter block. */
+typedef struct stats_worker {
+	uint64_t ctr[STATS_COUNTERS];
+	uint64_t rcode[STATS_RCODE_COUNT];
+	uint64_t qtype[STATS_QTYPE_COUNT];
+	stats_hist_t latency[STATS_STAGES];
+	unsigned zone_row; /*!< Row in zone counter tables (not summed). */
+} __attribute__((aligned(STATS_CACHELINE))) stats_worker_t;
+
+/*!
+ * \brief Per-zone query counters.
+ *
+ * Rows are allocated on first use by the worker owning them. Workers with
+ * row number out of range share the last row, which is updated atomically.
+ */
+typedef struct stats_zones {
+	size_t zones;                       /*!< Number of zones (row length). */
+	uint64_t *row[STATS_ZONE_ROWS + 1]; /*!< Worker rows. */
+} stats_zones_t;
+
+/*!
+ * \brief Read cheap monotonic timestamp in clock ticks.
+ *
+ * Uses TSC where available, monotonic clock in nanoseconds otherwise.
+ */
+static inline uint64_t stats_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	uint32_t lo, hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t)hi << 32) | lo;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*! \brief Histogram bucket for given value. */
+static inline unsigned stats_hist_bucket(uint64_t val)
+{
+	if (val < STATS_HIST_SUBS) {
+		return val;
+	}
+
+	unsigned exp = 63 - __builtin_clzll(val);
+	unsigned sub = (val >> (exp - STATS_HIST_SUB_BITS)) & (STATS_HIST_SUBS - 1);
+	return (exp - STATS_HIST_SUB_BITS + 1) * STATS_HIST_SUBS + sub;
+}
+
+/*!
+ * \brief Start timing a stage.
+ *
+ * \param latency Histograms (NULL if timing is disabled).
+ * \return Timestamp or 0 if timing is disabled.
+ */
+static inline uint64_t stats_timer(const stats_hist_t *latency)
+{
+	return latency ? stats_clock() : 0;
+}
+
+/*!
+ * \brief Record stage duration since the timestamp from stats_timer().
+ *
+ * \param latency Histograms (NULL if timing is disabled).
+ * \param stage Processing stage.
+ * \param begin Stage start timestamp.
+ */
+static inline void stats_timer_end(stats_hist_t *latency, enum stats_stage stage,
+                                   uint64_t begin)
+{
+	if (latency == NULL) {
+		return;
+	}
+
+	uint64_t now = stats_clock();
+	uint64_t val = (now > begin) ? now - begin : 0;
+	stats_hist_t *hist = &latency[stage];
+	++hist->count;
+	hist->sum += val;
+	++hist->bucket[stats_hist_bucket(val)];
+}
+
+/*! \brief Increment scalar counter (NULL-safe). */
+static inline void stats_inc(stats_worker_t *st, enum stats_ctr ctr)
+{
+	if (st != NULL) {
+		++st->ctr[ctr];
+	}
+}
+
+/*!
+ * \brief Account response sent to the client (or lack of it).
+ *
+ * \param st Worker counters.
+ * \param wire Response wire (RCODE and TC bit are read from the header).
+ * \param len Response length, 0 if no response was sent.
+ * \param ctr STATS_UDP_RESPONSES or STATS_TCP_RESPONSES.
+ */
+void stats_response(stats_worker_t *st, const uint8_t *wire, size_t len,
+                    enum stats_ctr ctr);
+
+/*!
+ * \brief Account parsed query (QTYPE, EDNS, DO bit).
+ */
+void stats_query(stats_worker_t *st, const knot_pkt_t *query);
+
+/*!
+ * \brief Create per-zone counter table.
+ *
+ * \param zones Number of zones.
+ *
+ * \retval Counter table without rows on success.
+ * \retval NULL on error.
+ */
+stats_zones_t *stats_zones_new(size_t zones);
+
+/*!
+ * \brief Free per-zone counter table.
+ */
+void stats_zones_free(stats_zones_t *table);
+
+/*!
+ * \brief Account query to a zone.
+ *
+ * \param table Zone counter table (may be NULL).
+ * \param zone Zone index in the table.
+ * \param st Counters of the calling worker (NULL to use the shared row).
+ */
+void stats_zone_query(stats_zones_t *table, size_t zone,
+                      const stats_worker_t *st);
+
+/*!
+ * \brief Sum query counters of the zone from all rows.
+ */
+uint64_t stats_zone_sum(const stats_zones_t *table, size_t zone);
+
+/*!
+ * \brief Remember reference point for clock tick to time conversion.
+ *
+ * \note Only the first call sets the reference (it's also set on the first
+ *       conversion), the conversion ratio is measured over the whole uptime.
+ */
+void stats_clock_init(void);
+
+/*!
+ * \brief Create counter blocks for given number of workers.
+ *
+ * \retval Zeroed counter array on success.
+ * \retval NULL on error.
+ */
+stats_worker_t *stats_new(unsigned count);
+
+/*!
+ * \brief Free counter blocks.
+ */
+void stats_free(stats_worker_t *st);
+
+/*!
+ * \brief Add counters from an array of worker blocks to the destination.
+ *
+ * \param dst Destination block.
+ * \param src Source blocks.
+ * \param count Number of source blocks.
+ */
+void stats_sum(stats_worker_t *dst, const stats_worker_t *src, unsigned count);
+
+/*!
+ * \brief Format counters as a text in 'name: value' lines.
+ *
+ * \note Zero QTYPE and RCODE counters and empty histograms are omitted.
+ *       Latency is printed as count, mean and percentiles in nanoseconds,
+ *       percentiles are upper bounds of the matching histogram bucket.
+ *
+ * \retval Number of bytes written (excluding terminating zero).
+ * \retval KNOT_ESPACE if the buffer is too small.
+ */
+int stats_print(const stats_worker_t *st, char *dst, size_t len);
+
+#endif /* _KNOTD_STATS_H_ */
+
+/*! @} */
@@ -23,6 +23,7 @@
 #include <netinet/tcp.h>
 #include <netinet/in.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #ifdef HAVE_SYS_UIO_H			// struct iovec (OpenBSD)
 #include <sys/uio.h>
@@ -34,6 +35,7 @@
 #include "common/sockaddr.h"
 #include "common/fdset.h"
 #include "common/mempool.h"
+#include "common/uring.h"
 #include "knot/knot.h"
 #include "knot/server/tcp-handler.h"
 #include "knot/server/xfr-handler.h"
@@ -47,6 +49,7 @@
 typedef struct tcp_context {
 	knot_process_t query_ctx;   /*!< Query processing context. */
 	server_t *server;           /*!< Name server structure. */
+	stats_worker_t *stats;      /*!< Worker query counters. */
 	struct iovec iov[2];        /*!< TX/RX buffers. */
 	unsigned client_threshold;  /*!< Index of first TCP client. */
 	timev_t last_poll_time;     /*!< Time of the last socket poll. */
@@ -91,21 +94,77 @@ static enum fdset_sweep_state tcp_sweep(fdset_t *set, int i, void *data)
 	return FDSET_SWEEP;
 }
 
+/*!
+ * \brief Answer a received query.
+ *
+ * \param tcp TCP context.
+ * \param fd Client socket.
+ * \param ss Client address.
+ * \param rx Received query.
+ * \param tx Response buffer of KNOT_WIRE_MAX_PKTSIZE bytes.
+ * \param keep_last Leave the last response message in \a tx for the caller
+ *                  to send, tx->iov_len is set to its length (0 if none).
+ *                  Preceding messages are sent right away.
+ */
+static int tcp_answer(tcp_context_t *tcp, int fd, struct sockaddr_storage *ss,
+                      struct iovec *rx, struct iovec *tx, bool keep_last)
+{
+	/* Create query processing parameter. */
+	struct process_query_param param = {0};
+	param.query_socket = fd;
+	param.query_source = ss;
+	param.server = tcp->server;
+	param.stats = tcp->stats;
+	if (tcp->server->stats.latency) {
+		param.latency = tcp->stats->latency;
+	}
+
+	stats_inc(tcp->stats, STATS_TCP_QUERIES);
+
+	/* Create query processing context. */
+	knot_process_begin(&tcp->query_ctx, &param, NS_PROC_QUERY);
+
+	/* Input packet. */
+	uint64_t t_parse = stats_timer(param.latency);
+	int state = knot_process_in(rx->iov_base, rx->iov_len, &tcp->query_ctx);
+	stats_timer_end(param.latency, STATS_STAGE_PARSE, t_parse);
+
+	/* Resolve until NOOP or finished. */
+	int ret = KNOT_EOK;
+	tx->iov_len = 0;
+	while (state & (NS_PROC_FULL|NS_PROC_FAIL)) {
+		uint16_t tx_len = KNOT_WIRE_MAX_PKTSIZE;
+		state = knot_process_out(tx->iov_base, &tx_len, &tcp->query_ctx);
+		if (tx_len == 0) {
+			continue;
+		}
+
+		/* Last response is left for the caller if requested. */
+		if (keep_last && !(state & (NS_PROC_FULL|NS_PROC_FAIL))) {
+			tx->iov_len = tx_len;
+		} else if (tcp_send(fd, tx->iov_base, tx_len) != tx_len) {
+			ret = KNOT_ECONNREFUSED;
+			break;
+		}
+		stats_response(tcp->stats, tx->iov_base, tx_len,
+		               STATS_TCP_RESPONSES);
+	}
+
+	/* Reset after processing. */
+	knot_process_finish(&tcp->query_ctx);
+
+	return ret;
+}
+
 /*!
  * \brief TCP event handler function.
  */
 static int tcp_handle(tcp_context_t *tcp, int fd,
                       struct iovec *rx, struct iovec *tx)
 {
-	/* Create query processing parameter. */
 	struct sockaddr_storage ss;
 	memset(&ss, 0, sizeof(struct sockaddr_storage));
-	struct process_query_param param = {0};
-	param.query_socket = fd;
-	param.query_source = &ss;
-	param.server = tcp->server;
 	rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
-	tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
 
 	/* Receive data. */
 	int ret = tcp_recv(fd, rx->iov_base, rx->iov_len, (struct sockaddr *)&ss);
@@ -125,31 +184,27 @@ static int tcp_handle(tcp_context_t *tcp, int fd,
 		rx->iov_len = ret;
 	}
 
-	/* Create query processing context. */
-	knot_process_begin(&tcp->query_ctx, &param, NS_PROC_QUERY);
-
-	/* Input packet. */
-	int state = knot_process_in(rx->iov_base, rx->iov_len, &tcp->query_ctx);
-
-	/* Resolve until NOOP or finished. */
-	ret = KNOT_EOK;
-	while (state & (NS_PROC_FULL|NS_PROC_FAIL)) {
-		uint16_t tx_len = tx->iov_len;
-		state = knot_process_out(tx->iov_base, &tx_len, &tcp->query_ctx);
+	return tcp_answer(tcp, fd, &ss, rx, tx, false);
+}
 
-		/* If it has response, send it. */
-		if (tx_len > 0) {
-			if (tcp_send(fd, tx->iov_base, tx_len) != tx_len) {
-				ret = KNOT_ECONNREFUSED;
-				break;
-			}
+/*! \brief Log accept() failure, throttle if out of resources. */
+static void tcp_accept_error(int en)
+{
+	if (en != EINTR && en != EAGAIN) {
+		log_server_error("Cannot accept connection "
+				 "(%d).\n", en);
+		if (en == EMFILE || en == ENFILE ||
+		    en == ENOBUFS || en == ENOMEM) {
+			int throttle = tcp_throttle();
+			log_server_error("Throttling TCP connection pool"
+			                 " for %d seconds because of "
+			                 "too many open descriptors "
+			                 "or lack of memory.\n",
+			                 throttle);
+			sleep(throttle);
 		}
-	}
 
-	/* Reset after processing. */
-	knot_process_finish(&tcp->query_ctx);
-
-	return ret;
+	}
 }
 
 int tcp_accept(int fd)
@@ -159,22 +214,7 @@ int tcp_accept(int fd)
 
 	/* Evaluate connection. */
 	if (incoming < 0) {
-		int en = errno;
-		if (en != EINTR && en != EAGAIN) {
-			log_server_error("Cannot accept connection "
-					 "(%d).\n", errno);
-			if (en == EMFILE || en == ENFILE ||
-			    en == ENOBUFS || en == ENOMEM) {
-				int throttle = tcp_throttle();
-				log_server_error("Throttling TCP connection pool"
-				                 " for %d seconds because of "
-				                 "too many open descriptors "
-				                 "or lack of memory.\n",
-				                 throttle);
-				sleep(throttle);
-			}
-
-		}
+		tcp_accept_error(errno);
 	} else {
 		dbg_net("tcp: accepted connection fd=%d\n", incoming);
 		/* Set recv() timeout. */
@@ -355,6 +395,442 @@ static int tcp_wait_for_events(tcp_context_t *tcp)
 	return nfds;
 }
 
+#ifdef HAVE_IO_URING
+
+/*! \brief Use io_uring for client connections, set at startup. */
+static bool _tcp_uring = false;
+
+/* Request kind and accept generation in the upper half of user_data,
+ * listener index or connection slot in the lower half. */
+enum {
+	TCP_URING_ACCEPT = 1,
+	TCP_URING_RECV = 2,
+	TCP_URING_SEND = 3,
+	TCP_URING_SWEEP = 4,
+	TCP_URING_CANCEL = 5
+};
+#define TCP_URING_GEN_MASK 0xffffff
+#define TCP_URING_DATA(kind, gen, val) (((uint64_t)(kind) << 56) | \
+                                        ((uint64_t)((gen) & TCP_URING_GEN_MASK) << 32) | \
+                                        (uint32_t)(val))
+#define TCP_URING_KIND(data) ((unsigned)((data) >> 56))
+#define TCP_URING_GEN(data) ((uint32_t)((data) >> 32) & TCP_URING_GEN_MASK)
+#define TCP_URING_VAL(data) ((uint32_t)(data))
+
+#define TCP_URING_SQ_LEN 256 /*!< Submission ring size. */
+
+/*! \brief Client connection, at most one receive or send in flight. */
+struct tcp_uring_conn {
+	int fd;
+	bool sending;                  /*!< Response is being sent. */
+	bool closing;                  /*!< Shut down, close on completion. */
+	size_t have;                   /*!< Bytes received or sent so far. */
+	size_t want;                   /*!< Bytes to receive or send. */
+	time_t deadline;               /*!< Shut down if idle past this time. */
+	struct sockaddr_storage addr;  /*!< Peer address. */
+	uint8_t buf[sizeof(uint16_t) + KNOT_WIRE_MAX_PKTSIZE]; /*!< Length
+	                                 * prefix and query or response. */
+};
+
+/*! \brief TCP io_uring worker state. */
+struct tcp_uring {
+	uring_t ring;
+	uint32_t gen;                    /*!< Generation of armed accepts. */
+	struct __kernel_timespec sweep;  /*!< Sweep timer interval. */
+	struct tcp_uring_conn **conn;    /*!< Connections by slot. */
+	unsigned *free;                  /*!< Stack of free slots. */
+	unsigned nfree;
+	unsigned size;                   /*!< Number of slots. */
+};
+
+/*! \brief Get submission entry, flush the ring if it is full. */
+static struct io_uring_sqe *tcp_uring_sqe(struct tcp_uring *rq)
+{
+	struct io_uring_sqe *sqe = uring_sqe(&rq->ring);
+	if (sqe == NULL && uring_enter(&rq->ring, 0) >= 0) {
+		sqe = uring_sqe(&rq->ring);
+	}
+	return sqe;
+}
+
+/*! \brief Arm multishot accept on the listening socket. */
+static void tcp_uring_accept(struct tcp_uring *rq, int fd, unsigned i)
+{
+	struct io_uring_sqe *sqe = tcp_uring_sqe(rq);
+	if (sqe == NULL) {
+		return;
+	}
+
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = fd;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->user_data = TCP_URING_DATA(TCP_URING_ACCEPT, rq->gen, i);
+}
+
+/*! \brief Cancel accept on the listener, matched by user_data not fd. */
+static void tcp_uring_unaccept(struct tcp_uring *rq, unsigned i)
+{
+	struct io_uring_sqe *sqe = tcp_uring_sqe(rq);
+	if (sqe == NULL) {
+		return;
+	}
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->addr = TCP_URING_DATA(TCP_URING_ACCEPT, rq->gen, i);
+	sqe->user_data = TCP_URING_DATA(TCP_URING_CANCEL, rq->gen, i);
+}
+
+/*! \brief Arm the sweep timer. */
+static void tcp_uring_timer(struct tcp_uring *rq)
+{
+	struct io_uring_sqe *sqe = tcp_uring_sqe(rq);
+	if (sqe == NULL) {
+		return;
+	}
+
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->addr = (uintptr_t)&rq->sweep;
+	sqe->len = 1;
+	sqe->user_data = TCP_URING_DATA(TCP_URING_SWEEP, 0, 0);
+}
+
+/*! \brief Submit receive or send of the rest of the connection buffer. */
+static int tcp_uring_io(struct tcp_uring *rq, unsigned slot)
+{
+	struct tcp_uring_conn *conn = rq->conn[slot];
+	struct io_uring_sqe *sqe = tcp_uring_sqe(rq);
+	if (sqe == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	sqe->fd = conn->fd;
+	sqe->addr = (uintptr_t)(conn->buf + conn->have);
+	sqe->len = conn->want - conn->have;
+	if (conn->sending) {
+		sqe->opcode = IORING_OP_SEND;
+		sqe->msg_flags = MSG_NOSIGNAL;
+		sqe->user_data = TCP_URING_DATA(TCP_URING_SEND, 0, slot);
+	} else {
+		sqe->opcode = IORING_OP_RECV;
+		sqe->user_data = TCP_URING_DATA(TCP_URING_RECV, 0, slot);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Wait for the next query with the given idle limit. */
+static int tcp_uring_wait_query(struct tcp_uring *rq, unsigned slot, int idle)
+{
+	struct tcp_uring_conn *conn = rq->conn[slot];
+	timev_t now;
+	time_now(&now);
+	conn->deadline = now.tv_sec + idle;
+	conn->sending = false;
+	conn->have = 0;
+	conn->want = sizeof(uint16_t);
+	return tcp_uring_io(rq, slot);
+}
+
+/*! \brief Close the connection and free its slot. */
+static void tcp_uring_close(struct tcp_uring *rq, unsigned slot)
+{
+	struct tcp_uring_conn *conn = rq->conn[slot];
+	dbg_net("tcp: client on fd=%d disconnected\n", conn->fd);
+	close(conn->fd);
+	free(conn);
+	rq->conn[slot] = NULL;
+	rq->free[rq->nfree++] = slot;
+}
+
+/*! \brief Shut the connection down, the pending request then completes. */
+static void tcp_uring_shutdown(struct tcp_uring *rq, unsigned slot)
+{
+	struct tcp_uring_conn *conn = rq->conn[slot];
+	if (!conn->closing) {
+		conn->closing = true;
+		shutdown(conn->fd, SHUT_RDWR);
+	}
+}
+
+/*! \brief Add accepted connection. */
+static void tcp_uring_add(struct tcp_uring *rq, int fd)
+{
+	/* Grow the slot table. */
+	if (rq->nfree == 0) {
+		unsigned size = rq->size > 0 ? 2 * rq->size : 16;
+		void *conn = realloc(rq->conn, size * sizeof(*rq->conn));
+		if (conn != NULL) {
+			rq->conn = conn;
+		}
+		void *free_slots = realloc(rq->free, size * sizeof(*rq->free));
+		if (free_slots != NULL) {
+			rq->free = free_slots;
+		}
+		if (conn == NULL || free_slots == NULL) {
+			close(fd);
+			return;
+		}
+		for (unsigned i = size; i > rq->size; --i) {
+			rq->conn[i - 1] = NULL;
+			rq->free[rq->nfree++] = i - 1;
+		}
+		rq->size = size;
+	}
+
+	struct tcp_uring_conn *conn = malloc(sizeof(struct tcp_uring_conn));
+	if (conn == NULL) {
+		close(fd);
+		return;
+	}
+
+	memset(conn, 0, offsetof(struct tcp_uring_conn, buf));
+	conn->fd = fd;
+	socklen_t addrlen = sizeof(struct sockaddr_storage);
+	if (getpeername(fd, (struct sockaddr *)&conn->addr, &addrlen) < 0) {
+		close(fd);
+		free(conn);
+		return;
+	}
+
+	dbg_net("tcp: accepted connection fd=%d\n", fd);
+	unsigned slot = rq->free[--rq->nfree];
+	rq->conn[slot] = conn;
+
+	rcu_read_lock();
+	int idle = conf()->max_conn_hs;
+	rcu_read_unlock();
+	if (tcp_uring_wait_query(rq, slot, idle) != KNOT_EOK) {
+		tcp_uring_close(rq, slot);
+	}
+}
+
+/*! \brief Answer a complete query, send the last response message. */
+static int tcp_uring_answer(tcp_context_t *tcp, struct tcp_uring *rq,
+                            unsigned slot)
+{
+	struct tcp_uring_conn *conn = rq->conn[slot];
+	struct iovec rx = {
+		.iov_base = conn->buf + sizeof(uint16_t),
+		.iov_len = conn->want - sizeof(uint16_t)
+	};
+	struct iovec *tx = &tcp->iov[1];
+
+	int ret = tcp_answer(tcp, conn->fd, &conn->addr, &rx, tx, true);
+
+	/* Flush per-query memory. */
+	mp_flush(tcp->query_ctx.mm.ctx);
+
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	rcu_read_lock();
+	int idle = conf()->max_conn_idle;
+	rcu_read_unlock();
+	if (tx->iov_len == 0) {
+		return tcp_uring_wait_query(rq, slot, idle);
+	}
+
+	/* Query is no longer needed, reuse the buffer for the response. */
+	uint16_t pktsize = htons(tx->iov_len);
+	memcpy(conn->buf, &pktsize, sizeof(uint16_t));
+	memcpy(conn->buf + sizeof(uint16_t), tx->iov_base, tx->iov_len);
+	timev_t now;
+	time_now(&now);
+	conn->deadline = now.tv_sec + idle;
+	conn->sending = true;
+	conn->have = 0;
+	conn->want = sizeof(uint16_t) + tx->iov_len;
+	return tcp_uring_io(rq, slot);
+}
+
+/*! \brief Handle receive or send completion on a connection. */
+static void tcp_uring_conn_event(tcp_context_t *tcp, struct tcp_uring *rq,
+                                 unsigned slot, int res)
+{
+	struct tcp_uring_conn *conn = rq->conn[slot];
+	if (res <= 0 || conn->closing) {
+		tcp_uring_close(rq, slot);
+		return;
+	}
+
+	int ret = KNOT_EOK;
+	conn->have += res;
+	if (conn->have < conn->want) {
+		ret = tcp_uring_io(rq, slot);
+	} else if (conn->sending) {
+		rcu_read_lock();
+		int idle = conf()->max_conn_idle;
+		rcu_read_unlock();
+		ret = tcp_uring_wait_query(rq, slot, idle);
+	} else if (conn->want == sizeof(uint16_t)) {
+		/* Length prefix received, continue with the message. */
+		uint16_t pktsize = 0;
+		memcpy(&pktsize, conn->buf, sizeof(uint16_t));
+		pktsize = ntohs(pktsize);
+		dbg_net("tcp: incoming packet size=%hu on fd=%d\n",
+		        pktsize, conn->fd);
+		if (pktsize == 0) {
+			ret = KNOT_EMALF;
+		} else {
+			conn->want += pktsize;
+			ret = tcp_uring_io(rq, slot);
+		}
+	} else {
+		ret = tcp_uring_answer(tcp, rq, slot);
+	}
+
+	if (ret != KNOT_EOK) {
+		tcp_uring_close(rq, slot);
+	}
+}
+
+/*! \brief Shut down connections idle past their deadline. */
+static void tcp_uring_sweep(struct tcp_uring *rq)
+{
+	timev_t now;
+	time_now(&now);
+	for (unsigned i = 0; i < rq->size; ++i) {
+		struct tcp_uring_conn *conn = rq->conn[i];
+		if (conn == NULL || conn->closing || conn->deadline > now.tv_sec) {
+			continue;
+		}
+
+		char addr_str[SOCKADDR_STRLEN] = {0};
+		sockaddr_tostr(&conn->addr, addr_str, sizeof(addr_str));
+		log_server_notice("Connection '%s' was terminated due to "
+		                  "inactivity.\n", addr_str);
+		tcp_uring_shutdown(rq, i);
+	}
+}
+
+/*!
+ * \brief Serve clients through io_uring.
+ *
+ * Listening sockets are in tcp->set. Connections are accepted with
+ * multishot accept; queries and responses are read and written with
+ * receive and send submissions. Only multi-message responses (zone
+ * transfers) are written synchronously, all but their last message.
+ */
+static int tcp_uring_serve(dthread_t *thread, tcp_context_t *tcp, ref_t **ref)
+{
+	iohandler_t *handler = (iohandler_t *)thread->data;
+	unsigned *iostate = &handler->thread_state[dt_get_id(thread)];
+
+	struct tcp_uring rq;
+	memset(&rq, 0, sizeof(rq));
+	rq.sweep.tv_sec = TCP_SWEEP_INTERVAL;
+	unsigned flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+	int ret = uring_init(&rq.ring, TCP_URING_SQ_LEN, flags);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	tcp_uring_timer(&rq);
+
+	for (;;) {
+
+		/* Check handler state. */
+		if (knot_unlikely(*iostate & ServerReload)) {
+			*iostate &= ~ServerReload;
+
+			/* Cancel client connections. */
+			for (unsigned i = 0; i < rq.size; ++i) {
+				if (rq.conn[i] != NULL) {
+					tcp_uring_shutdown(&rq, i);
+				}
+			}
+
+			/* Listening sockets may be replaced, fds reused. */
+			for (unsigned i = 0; i < tcp->set.n; ++i) {
+				tcp_uring_unaccept(&rq, i);
+			}
+			rq.gen += 1;
+
+			ref_release(*ref);
+			*ref = server_set_ifaces(handler->server, &tcp->set, IO_TCP);
+			if (tcp->set.n == 0) {
+				break; /* Terminate on zero interfaces. */
+			}
+
+			for (unsigned i = 0; i < tcp->set.n; ++i) {
+				tcp_uring_accept(&rq, tcp->set.pfd[i].fd, i);
+			}
+		}
+
+		/* Check for cancellation. */
+		if (dt_is_cancelled(thread)) {
+			break;
+		}
+
+		/* Submit queued requests and wait for completions. */
+		bool pending = uring_cqe(&rq.ring) != NULL;
+		if (uring_enter(&rq.ring, pending ? 0 : 1) < 0) {
+			if (errno == EINTR) continue;
+			log_server_error("TCP worker %u stopped, can't wait "
+			                 "for connections (%s).\n",
+			                 dt_get_id(thread), strerror(errno));
+			ret = knot_map_errno(errno);
+			break;
+		}
+
+		struct io_uring_cqe *cqe = NULL;
+		while ((cqe = uring_cqe(&rq.ring)) != NULL) {
+			uint64_t data = cqe->user_data;
+			int res = cqe->res;
+			bool more = cqe->flags & IORING_CQE_F_MORE;
+			uring_cqe_seen(&rq.ring);
+
+			unsigned val = TCP_URING_VAL(data);
+			switch (TCP_URING_KIND(data)) {
+			case TCP_URING_ACCEPT:
+				if (res >= 0) {
+					tcp_uring_add(&rq, res);
+				} else if (res != -ECANCELED) {
+					tcp_accept_error(-res);
+				}
+				/* Multishot accept ends on errors, rearm. */
+				if (!more && res != -ECANCELED &&
+				    TCP_URING_GEN(data) == (rq.gen & TCP_URING_GEN_MASK) &&
+				    val < tcp->set.n) {
+					tcp_uring_accept(&rq, tcp->set.pfd[val].fd, val);
+				}
+				break;
+			case TCP_URING_RECV:
+			case TCP_URING_SEND:
+				tcp_uring_conn_event(tcp, &rq, val, res);
+				break;
+			case TCP_URING_SWEEP:
+				tcp_uring_sweep(&rq);
+				tcp_uring_timer(&rq);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	/* Pending requests are cancelled with the ring. */
+	uring_deinit(&rq.ring);
+	for (unsigned i = 0; i < rq.size; ++i) {
+		if (rq.conn[i] != NULL) {
+			tcp_uring_close(&rq, i);
+		}
+	}
+	free(rq.conn);
+	free(rq.free);
+
+	return ret;
+}
+
+/*! \brief Initialize TCP master routine on run-time. */
+void __attribute__ ((constructor)) tcp_master_init()
+{
+	/* Check for io_uring support. */
+	_tcp_uring = (uring_probe() == KNOT_EOK);
+}
+#endif /* HAVE_IO_URING */
+
 int tcp_master(dthread_t *thread)
 {
 	if (!thread || !thread->data) {
@@ -371,6 +847,7 @@ int tcp_master(dthread_t *thread)
 
 	/* Create TCP answering context. */
 	tcp.server = handler->server;
+	tcp.stats = &handler->stats[dt_get_id(thread)];
 
 	/* Create big enough memory cushion. */
 	mm_ctx_mempool(&tcp.query_ctx.mm, 4 * sizeof(knot_pkt_t));
@@ -388,6 +865,14 @@ int tcp_master(dthread_t *thread)
 		}
 	}
 
+#ifdef HAVE_IO_URING
+	/* Completion based backend has its own loop. */
+	if (_tcp_uring) {
+		ret = tcp_uring_serve(thread, &tcp, &ref);
+		goto finish;
+	}
+#endif /* HAVE_IO_URING */
+
 	/* Initialize sweep interval. */
 	timev_t next_sweep = {0};
 	time_now(&next_sweep);
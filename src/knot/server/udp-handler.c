@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 #ifdef HAVE_SYS_UIO_H /* 'struct iovec' for OpenBSD */
 #include <sys/uio.h>
 #endif /* HAVE_SYS_UIO_H */
@@ -39,6 +40,7 @@
 #include "common/sockaddr.h"
 #include "common/mempattern.h"
 #include "common/mempool.h"
+#include "common/uring.h"
 #include "knot/knot.h"
 #include "knot/server/udp-handler.h"
 #include "knot/server/server.h"
@@ -49,6 +51,7 @@
 #include "knot/server/notify.h"
 #include "libknot/dnssec/crypto.h"
 #include "libknot/processing/process.h"
+#include "knot/nameserver/process_query.h"
 
 /* Buffer identifiers. */
 enum {
@@ -57,12 +60,46 @@ enum {
 	NBUFS = 2
 };
 
+/*! \brief Worker memory pool size, flushed when exceeded. */
+#define UDP_POOL_SIZE (4 * sizeof(knot_pkt_t))
+
+/*! \brief Worker memory pool, flushed only after it was used up. */
+typedef struct udp_pool {
+	struct mempool *mp;
+	size_t used; /*!< Bytes allocated since the last flush. */
+} udp_pool_t;
+
 /*! \brief UDP context data. */
 typedef struct udp_context {
 	knot_process_t query_ctx; /*!< Query processing context. */
 	server_t *server;         /*!< Name server structure. */
+	stats_worker_t *stats;    /*!< Worker query counters. */
+	struct query_data qdata;  /*!< Reused query data. */
+	udp_pool_t pool;          /*!< Query processing memory. */
 } udp_context_t;
 
+static void *udp_pool_alloc(void *ctx, size_t len)
+{
+	udp_pool_t *pool = ctx;
+	pool->used += len;
+	return mp_alloc(pool->mp, len);
+}
+
+/*!
+ * \brief Flush the worker memory pool if it was used up.
+ *
+ * Query data, packets and answer list nodes are preallocated, so a query
+ * takes only a few bytes of the pool (parsed RRs, synthesized RRSIGs) and
+ * the pool is flushed once per chunk instead of after each datagram.
+ */
+static void udp_pool_flush(udp_pool_t *pool)
+{
+	if (pool->used >= UDP_POOL_SIZE) {
+		mp_flush(pool->mp);
+		pool->used = 0;
+	}
+}
+
 /* FD_COPY macro compat. */
 #ifndef FD_COPY
 #define FD_COPY(src, dest) memcpy((dest), (src), sizeof(fd_set))
@@ -71,44 +108,12 @@ typedef struct udp_context {
 /* Mirror mode (no answering). */
 /* #define MIRROR_MODE 1 */
 
-/* PPS measurement. */
-/* #define MEASURE_PPS 1 */
-
 /* Next-gen packet processing API. */
 #define PACKET_NG
 #ifdef PACKET_NG
 #include "knot/nameserver/process_query.h"
 #endif
 
-/* PPS measurement */
-#ifdef MEASURE_PPS
-
-/* Not thread-safe, used only for RX thread. */
-static struct timeval __pps_t0, __pps_t1;
-volatile static unsigned __pps_rx = 0;
-static inline void udp_pps_begin()
-{
-	gettimeofday(&__pps_t0, NULL);
-}
-
-static inline void udp_pps_sample(unsigned n, unsigned thr_id)
-{
-	__pps_rx += n;
-	if (thr_id == 0) {
-		gettimeofday(&__pps_t1, NULL);
-		if (time_diff(&__pps_t0, &__pps_t1) >= 1000.0) {
-			unsigned pps = __pps_rx;
-			memcpy(&__pps_t0, &__pps_t1, sizeof(struct timeval));
-			__pps_rx = 0;
-			log_server_info("RX rate %u p/s.\n", pps);
-		}
-	}
-}
-#else
-static inline void udp_pps_begin() {}
-static inline void udp_pps_sample(unsigned n, unsigned thr_id) {}
-#endif
-
 int udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
                struct iovec *rx, struct iovec *tx)
 {
@@ -120,12 +125,19 @@ int udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 
 	/* Create query processing parameter. */
 	struct process_query_param param = {0};
+	if (udp->server->stats.latency) {
+		param.latency = udp->stats->latency;
+	}
+	uint64_t t_total = stats_timer(param.latency);
 	param.query_source = ss;
 	param.proc_flags  = NS_QUERY_NO_AXFR|NS_QUERY_NO_IXFR; /* No transfers. */
 	param.proc_flags |= NS_QUERY_LIMIT_SIZE; /* Enforce UDP packet size limit. */
 	param.proc_flags |= NS_QUERY_LIMIT_ANY;  /* Limit ANY over UDP (depends on zone as well). */
 	param.query_socket = fd;
 	param.server = udp->server;
+	param.stats = udp->stats;
+	param.qdata = &udp->qdata;
+	stats_inc(udp->stats, STATS_UDP_QUERIES);
 
 	/* Rate limit is applied? */
 	if (knot_unlikely(udp->server->rrl != NULL) && udp->server->rrl->rate > 0) {
@@ -136,7 +148,9 @@ int udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 	knot_process_begin(&udp->query_ctx, &param, NS_PROC_QUERY);
 
 	/* Input packet. */
+	uint64_t t_parse = stats_timer(param.latency);
 	int state = knot_process_in(rx->iov_base, rx->iov_len, &udp->query_ctx);
+	stats_timer_end(param.latency, STATS_STAGE_PARSE, t_parse);
 
 	/* Process answer. */
 	uint16_t tx_len = tx->iov_len;
@@ -156,6 +170,8 @@ int udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 	} else {
 		tx->iov_len = 0;
 	}
+	stats_response(udp->stats, tx->iov_base, tx->iov_len, STATS_UDP_RESPONSES);
+	stats_timer_end(param.latency, STATS_STAGE_TOTAL, t_total);
 
 	/* Reset context. */
 	knot_process_finish(&udp->query_ctx);
@@ -177,6 +193,7 @@ static int (*_udp_deinit)(void *) = 0;
 static int (*_udp_recv)(int, void *) = 0;
 static int (*_udp_handle)(udp_context_t *, void *) = 0;
 static int (*_udp_send)(void *) = 0;
+static int (*_udp_watch)(void *, fd_set *, int, int) = 0;
 
 /* UDP recvfrom() request struct. */
 struct udp_recvfrom {
@@ -335,6 +352,8 @@ static void *udp_recvmmsg_init(void)
 	/* Initialize buffers. */
 	for (unsigned i = 0; i < NBUFS; ++i) {
 		rq->iobuf[i] = mm.alloc(mm.ctx, KNOT_WIRE_MAX_PKTSIZE * RECVMMSG_BATCHLEN);
+		/* Touch the buffers in the worker to allocate them node-locally. */
+		memset(rq->iobuf[i], 0, KNOT_WIRE_MAX_PKTSIZE * RECVMMSG_BATCHLEN);
 		rq->iov[i] = mm.alloc(mm.ctx, sizeof(struct iovec) * RECVMMSG_BATCHLEN);
 		rq->msgs[i] = mm.alloc(mm.ctx, sizeof(struct mmsghdr) * RECVMMSG_BATCHLEN);
 		memset(rq->msgs[i], 0, sizeof(struct mmsghdr) * RECVMMSG_BATCHLEN);
@@ -414,6 +433,316 @@ static int udp_recvmmsg_send(void *d)
 }
 #endif /* HAVE_RECVMMSG */
 
+#ifdef HAVE_IO_URING
+
+/* Request kind and socket generation in the upper half of user_data,
+ * fd or slot in the lower half. */
+enum {
+	URING_RECV = 1,
+	URING_SEND = 2,
+	URING_CANCEL = 3
+};
+#define URING_GEN_MASK 0xffffff
+#define URING_DATA(kind, gen, val) (((uint64_t)(kind) << 56) | \
+                                    ((uint64_t)((gen) & URING_GEN_MASK) << 32) | \
+                                    (uint32_t)(val))
+#define URING_KIND(data) ((unsigned)((data) >> 56))
+#define URING_GEN(data) ((uint32_t)((data) >> 32) & URING_GEN_MASK)
+#define URING_VAL(data) ((uint32_t)(data))
+
+#define URING_SQ_LEN (4 * RECVMMSG_BATCHLEN)   /*!< Submission ring size. */
+#define URING_RX_BUFS (2 * RECVMMSG_BATCHLEN)  /*!< Provided receive buffers. */
+#define URING_TX_SLOTS (2 * RECVMMSG_BATCHLEN) /*!< Responses in flight. */
+#define URING_RX_GROUP 0                       /*!< Buffer group ID. */
+
+/*! \brief Received datagram waiting for processing. */
+struct udp_uring_rx {
+	int fd;
+	uint16_t bid;  /*!< Provided buffer ID. */
+	unsigned slot; /*!< Response slot. */
+	struct iovec iov;
+};
+
+/*! \brief Response buffer, kept until the send completes. */
+struct udp_uring_tx {
+	struct msghdr msg;
+	struct iovec iov;
+	struct sockaddr_storage addr;
+};
+
+/* UDP io_uring request struct. */
+struct udp_uring {
+	uring_t ring;
+	uring_bufs_t bufs;
+	struct msghdr rx_msg;             /*!< Receive layout for multishot. */
+	fd_set watched;                   /*!< Sockets with armed receive. */
+	ino_t ino[FD_SETSIZE];            /*!< Identity of the watched socket. */
+	uint32_t gen[FD_SETSIZE];         /*!< Generation of the armed receive. */
+	int maxfd;
+	unsigned rcvd;
+	struct udp_uring_rx rx[RECVMMSG_BATCHLEN];
+	struct udp_uring_tx tx[URING_TX_SLOTS];
+	unsigned tx_free[URING_TX_SLOTS]; /*!< Stack of free response slots. */
+	unsigned tx_nfree;
+	uint8_t *txbuf;
+};
+
+/*! \brief Get submission entry, flush the ring if it is full. */
+static struct io_uring_sqe *udp_uring_sqe(struct udp_uring *rq)
+{
+	struct io_uring_sqe *sqe = uring_sqe(&rq->ring);
+	if (sqe == NULL && uring_enter(&rq->ring, 0) >= 0) {
+		sqe = uring_sqe(&rq->ring);
+	}
+	return sqe;
+}
+
+/*! \brief Arm multishot receive on the socket, current generation. */
+static void udp_uring_arm(struct udp_uring *rq, int fd)
+{
+	struct io_uring_sqe *sqe = udp_uring_sqe(rq);
+	if (sqe == NULL) {
+		return;
+	}
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t)&rq->rx_msg;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_RX_GROUP;
+	sqe->user_data = URING_DATA(URING_RECV, rq->gen[fd], fd);
+}
+
+/*!
+ * \brief Cancel the receive armed on the socket.
+ *
+ * Matched by user_data, not by fd, as the fd may already refer to
+ * a different socket.
+ */
+static void udp_uring_cancel(struct udp_uring *rq, int fd)
+{
+	struct io_uring_sqe *sqe = udp_uring_sqe(rq);
+	if (sqe == NULL) {
+		return;
+	}
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->addr = URING_DATA(URING_RECV, rq->gen[fd], fd);
+	sqe->user_data = URING_DATA(URING_CANCEL, rq->gen[fd], fd);
+}
+
+static void udp_uring_deinit_rq(struct udp_uring *rq)
+{
+	uring_bufs_deinit(&rq->ring, &rq->bufs);
+	uring_deinit(&rq->ring);
+	free(rq->txbuf);
+	free(rq);
+}
+
+static void *udp_uring_init(void)
+{
+	struct udp_uring *rq = malloc(sizeof(struct udp_uring));
+	if (rq == NULL) {
+		return NULL;
+	}
+
+	memset(rq, 0, sizeof(struct udp_uring));
+	FD_ZERO(&rq->watched);
+	rq->txbuf = malloc(URING_TX_SLOTS * KNOT_WIRE_MAX_PKTSIZE);
+	if (rq->txbuf == NULL) {
+		free(rq);
+		return NULL;
+	}
+
+	/* Ring is driven by the owning worker only. */
+	unsigned flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+	if (uring_init(&rq->ring, URING_SQ_LEN, flags) != KNOT_EOK) {
+		free(rq->txbuf);
+		free(rq);
+		return NULL;
+	}
+
+	/* Buffer holds recvmsg header, source address and the datagram. */
+	size_t buf_len = sizeof(struct io_uring_recvmsg_out) +
+	                 sizeof(struct sockaddr_storage) + KNOT_WIRE_MAX_PKTSIZE;
+	if (uring_bufs_init(&rq->ring, &rq->bufs, URING_RX_GROUP,
+	                    URING_RX_BUFS, buf_len) != KNOT_EOK) {
+		udp_uring_deinit_rq(rq);
+		return NULL;
+	}
+	rq->rx_msg.msg_namelen = sizeof(struct sockaddr_storage);
+
+	for (unsigned i = 0; i < URING_TX_SLOTS; ++i) {
+		struct udp_uring_tx *tx = &rq->tx[i];
+		tx->iov.iov_base = rq->txbuf + i * KNOT_WIRE_MAX_PKTSIZE;
+		tx->msg.msg_name = &tx->addr;
+		tx->msg.msg_iov = &tx->iov;
+		tx->msg.msg_iovlen = 1;
+		rq->tx_free[i] = i;
+	}
+	rq->tx_nfree = URING_TX_SLOTS;
+
+	return rq;
+}
+
+static int udp_uring_deinit(void *d)
+{
+	struct udp_uring *rq = (struct udp_uring *)d;
+	if (rq) {
+		udp_uring_deinit_rq(rq);
+	}
+
+	return 0;
+}
+
+static int udp_uring_watch(void *d, fd_set *fds, int minfd, int maxfd)
+{
+	struct udp_uring *rq = (struct udp_uring *)d;
+
+	/* Interfaces kept over reload keep their socket and receive.
+	 * A closed socket's fd may be reused by a new one, so sockets are
+	 * told apart by inode, not by fd number. */
+	int top = MAX(maxfd, rq->maxfd);
+	for (int fd = 0; fd <= top; ++fd) {
+		bool old = FD_ISSET(fd, &rq->watched);
+		bool new = fd >= minfd && fd <= maxfd && FD_ISSET(fd, fds);
+		struct stat st;
+		if (new && fstat(fd, &st) < 0) {
+			new = false;
+		}
+		if (old && new && rq->ino[fd] == st.st_ino) {
+			continue;
+		}
+		if (old) {
+			udp_uring_cancel(rq, fd);
+			FD_CLR(fd, &rq->watched);
+		}
+		if (new) {
+			rq->gen[fd] += 1;
+			rq->ino[fd] = st.st_ino;
+			udp_uring_arm(rq, fd);
+			FD_SET(fd, &rq->watched);
+		}
+	}
+	rq->maxfd = maxfd;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Take received datagram from the completion, 0 if there is none. */
+static int udp_uring_rx(struct udp_uring *rq, struct io_uring_cqe *cqe)
+{
+	int fd = URING_VAL(cqe->user_data);
+	bool current = fd < FD_SETSIZE && FD_ISSET(fd, &rq->watched) &&
+	               URING_GEN(cqe->user_data) == (rq->gen[fd] & URING_GEN_MASK);
+
+	/* Multishot receive ends on errors or buffer shortage, rearm. */
+	if (!(cqe->flags & IORING_CQE_F_MORE) && cqe->res != -ECANCELED &&
+	    current) {
+		udp_uring_arm(rq, fd);
+	}
+
+	if (cqe->res < 0 || !(cqe->flags & IORING_CQE_F_BUFFER)) {
+		return 0;
+	}
+
+	/* Drop truncated datagrams, those not fitting a response slot and
+	 * those from a socket no longer watched under this fd. */
+	uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+	uint8_t *buf = uring_buf(&rq->bufs, bid);
+	struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buf;
+	if (!current || (out->flags & MSG_TRUNC) || rq->tx_nfree == 0) {
+		uring_bufs_put(&rq->bufs, bid);
+		return 0;
+	}
+
+	struct udp_uring_rx *rx = &rq->rx[rq->rcvd];
+	rx->slot = rq->tx_free[--rq->tx_nfree];
+	struct udp_uring_tx *tx = &rq->tx[rx->slot];
+	memcpy(&tx->addr, buf + sizeof(*out), MIN(out->namelen, sizeof(tx->addr)));
+	tx->msg.msg_namelen = out->namelen;
+	rx->fd = fd;
+	rx->bid = bid;
+	rx->iov.iov_base = buf + sizeof(*out) + rq->rx_msg.msg_namelen;
+	rx->iov.iov_len = out->payloadlen;
+	return 1;
+}
+
+static int udp_uring_recv(int fd, void *d)
+{
+	UNUSED(fd);
+	struct udp_uring *rq = (struct udp_uring *)d;
+
+	/* Submit responses from the last batch, wait for work only if no
+	 * completion is pending. */
+	rq->rcvd = 0;
+	bool pending = uring_cqe(&rq->ring) != NULL;
+	if (uring_enter(&rq->ring, pending ? 0 : 1) < 0) {
+		return -1;
+	}
+
+	struct io_uring_cqe *cqe = NULL;
+	while (rq->rcvd < RECVMMSG_BATCHLEN &&
+	       (cqe = uring_cqe(&rq->ring)) != NULL) {
+		switch (URING_KIND(cqe->user_data)) {
+		case URING_RECV:
+			rq->rcvd += udp_uring_rx(rq, cqe);
+			break;
+		case URING_SEND:
+			rq->tx_free[rq->tx_nfree++] = URING_VAL(cqe->user_data);
+			break;
+		default:
+			break;
+		}
+		uring_cqe_seen(&rq->ring);
+	}
+
+	return rq->rcvd;
+}
+
+static int udp_uring_handle(udp_context_t *ctx, void *d)
+{
+	struct udp_uring *rq = (struct udp_uring *)d;
+
+	for (unsigned i = 0; i < rq->rcvd; ++i) {
+		struct udp_uring_rx *rx = &rq->rx[i];
+		struct udp_uring_tx *tx = &rq->tx[rx->slot];
+		tx->iov.iov_len = KNOT_WIRE_MAX_PKTSIZE;
+
+		int ret = udp_handle(ctx, rx->fd, &tx->addr, &rx->iov, &tx->iov);
+
+		/* Query is no longer needed, response has its own buffer. */
+		uring_bufs_put(&rq->bufs, rx->bid);
+
+		struct io_uring_sqe *sqe = NULL;
+		if (ret == KNOT_EOK && tx->iov.iov_len > 0) {
+			sqe = udp_uring_sqe(rq);
+		}
+		if (sqe == NULL) {
+			rq->tx_free[rq->tx_nfree++] = rx->slot;
+			continue;
+		}
+
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = rx->fd;
+		sqe->addr = (uintptr_t)&tx->msg;
+		sqe->user_data = URING_DATA(URING_SEND, 0, rx->slot);
+	}
+
+	return KNOT_EOK;
+}
+
+static int udp_uring_send(void *d)
+{
+	/* Responses are submitted together with the next wait. */
+	struct udp_uring *rq = (struct udp_uring *)d;
+	uring_bufs_commit(&rq->bufs);
+	return rq->rcvd;
+}
+
+#endif /* HAVE_IO_URING */
+
 /*! \brief Initialize UDP master routine on run-time. */
 void __attribute__ ((constructor)) udp_master_init()
 {
@@ -447,15 +776,32 @@ void __attribute__ ((constructor)) udp_master_init()
 	}
 #endif /* ENABLE_SENDMMSG */
 #endif /* HAVE_RECVMMSG */
+
+#ifdef HAVE_IO_URING
+	/* Check for io_uring support, preferred over recvmmsg(). */
+	if (uring_probe() == KNOT_EOK) {
+		_udp_init = udp_uring_init;
+		_udp_deinit = udp_uring_deinit;
+		_udp_recv = udp_uring_recv;
+		_udp_send = udp_uring_send;
+		_udp_handle = udp_uring_handle;
+		_udp_watch = udp_uring_watch;
+	}
+#endif /* HAVE_IO_URING */
 }
 
 int udp_master(dthread_t *thread)
 {
-	unsigned cpu = dt_online_cpus();
-	if (cpu > 1) {
+	/* Pin to CPUs of the worker's NUMA node, buffers allocated and
+	 * touched by the worker below are then node-local. */
+	unsigned thr_id = dt_get_id(thread);
+	iohandler_t *handler = (iohandler_t *)thread->data;
+	const numa_node_t *node = server_worker_node(handler->server, thr_id);
+	if (node->ncpus > 1) {
+		unsigned round = thr_id / handler->server->numa.count;
 		unsigned cpu_mask[2];
-		cpu_mask[0] = dt_get_id(thread) % cpu;
-		cpu_mask[1] = (cpu_mask[0] + 2) % cpu;
+		cpu_mask[0] = node->cpus[round % node->ncpus];
+		cpu_mask[1] = node->cpus[(round + 2) % node->ncpus];
 		dt_setaffinity(thread, cpu_mask, 2);
 	}
 
@@ -468,19 +814,35 @@ int udp_master(dthread_t *thread)
 #endif /* HAVE_CAP_NG_H */
 
 	/* Prepare structures for bound sockets. */
-	unsigned thr_id = dt_get_id(thread);
-	iohandler_t *handler = (iohandler_t *)thread->data;
 	unsigned *iostate = &handler->thread_state[thr_id];
 	void *rq = _udp_init();
 	ifacelist_t *ref = NULL;
+	if (rq == NULL) {
+		return KNOT_ENOMEM;
+	}
 
 	/* Create UDP answering context. */
 	udp_context_t udp;
 	memset(&udp, 0, sizeof(udp_context_t));
 	udp.server = handler->server;
+	udp.stats = &handler->stats[thr_id];
 
 	/* Create big enough memory cushion. */
-	mm_ctx_mempool(&udp.query_ctx.mm, 4 * sizeof(knot_pkt_t));
+	udp.pool.mp = mp_new(UDP_POOL_SIZE);
+	udp.query_ctx.mm.ctx = &udp.pool;
+	udp.query_ctx.mm.alloc = udp_pool_alloc;
+	udp.query_ctx.mm.free = mm_nofree;
+
+	/* Query and response packets are reused for each datagram. */
+	udp.query_ctx.pkt_in = malloc(sizeof(knot_pkt_t));
+	udp.query_ctx.pkt_out = malloc(sizeof(knot_pkt_t));
+	if (udp.query_ctx.pkt_in == NULL || udp.query_ctx.pkt_out == NULL) {
+		free(udp.query_ctx.pkt_in);
+		free(udp.query_ctx.pkt_out);
+		mp_delete(udp.pool.mp);
+		_udp_deinit(rq);
+		return KNOT_ENOMEM;
+	}
 
 	/* Chose select as epoll/kqueue has larger overhead for a
 	 * single or handful of sockets. */
@@ -489,8 +851,6 @@ int udp_master(dthread_t *thread)
 	int minfd = 0, maxfd = 0;
 	int rcvd = 0;
 
-	udp_pps_begin();
-
 	/* Loop until all data is read. */
 	for (;;) {
 
@@ -507,6 +867,10 @@ int udp_master(dthread_t *thread)
 			if (ref) {
 				iface_t *i = NULL;
 				WALK_LIST(i, ref->l) {
+					/* Interface served from other node. */
+					if (!server_worker_serves(handler->server, thr_id, i)) {
+						continue;
+					}
 					int fd = i->fd[IO_UDP];
 					FD_SET(fd, &fds);
 					maxfd = MAX(fd, maxfd);
@@ -514,6 +878,11 @@ int udp_master(dthread_t *thread)
 				}
 			}
 			rcu_read_unlock();
+
+			/* Completion based backend watches the sockets itself. */
+			if (_udp_watch) {
+				_udp_watch(rq, &fds, minfd, maxfd);
+			}
 		}
 
 		/* Cancellation point. */
@@ -521,12 +890,31 @@ int udp_master(dthread_t *thread)
 			break;
 		}
 
+		/* Wait for completions and handle them in batches. */
+		if (_udp_watch) {
+			rcvd = _udp_recv(-1, rq);
+			if (rcvd < 0) {
+				if (errno == EINTR) continue;
+				log_server_error("UDP worker %u stopped, can't wait "
+				                 "for queries (%s).\n", thr_id,
+				                 strerror(errno));
+				break;
+			}
+			_udp_handle(&udp, rq);
+			udp_pool_flush(&udp.pool);
+			_udp_send(rq);
+			continue;
+		}
+
 		/* Wait for events. */
 		fd_set rfds;
 		FD_COPY(&fds, &rfds);
 		int nfds = select(maxfd + 1, &rfds, NULL, NULL, NULL);
 		if (nfds <= 0) {
 			if (errno == EINTR) continue;
+			log_server_error("UDP worker %u stopped, can't wait "
+			                 "for queries (%s).\n", thr_id,
+			                 strerror(errno));
 			break;
 		}
 		/* Bound sockets will be usually closely coupled. */
@@ -535,9 +923,8 @@ int udp_master(dthread_t *thread)
 				while ((rcvd = _udp_recv(fd, rq)) > 0) {
 					_udp_handle(&udp, rq);
 					/* Flush allocated memory. */
-					mp_flush(udp.query_ctx.mm.ctx);
+					udp_pool_flush(&udp.pool);
 					_udp_send(rq);
-					udp_pps_sample(rcvd, thr_id);
 				}
 			}
 		}
@@ -545,7 +932,9 @@ int udp_master(dthread_t *thread)
 
 	_udp_deinit(rq);
 	ref_release((ref_t *)ref);
-	mp_delete(udp.query_ctx.mm.ctx);
+	free(udp.query_ctx.pkt_in);
+	free(udp.query_ctx.pkt_out);
+	mp_delete(udp.pool.mp);
 	return KNOT_EOK;
 }
 
@@ -994,6 +994,8 @@ int xfr_worker(dthread_t *thread)
 		}
 
 		/* Poll fdset. */
+		/*! \todo Outgoing transfers are not driven by io_uring yet,
+		 *        unlike the UDP and TCP workers. */
 		int nfds = poll(set.pfd, set.n, XFR_SWEEP_INTERVAL * 1000);
 		if (nfds < 0) {
 			if (errno == EINTR)
@@ -216,11 +216,10 @@ static void log_zone_load_info(const zone_t *zone, const char *zone_name,
  *
  * \param old_zone  Already loaded zone (can be NULL).
  * \param conf      Zone configuration.
- * \param server    Name server.
  *
- * \return Error code, KNOT_EOK if successful.
+ * \return New zone (without timers), NULL in case of error.
  */
-static zone_t *create_zone(zone_t *old_zone, conf_zone_t *conf, server_t *server)
+static zone_t *create_zone(zone_t *old_zone, conf_zone_t *conf)
 {
 	assert(conf);
 
@@ -247,9 +246,6 @@ static zone_t *create_zone(zone_t *old_zone, conf_zone_t *conf, server_t *server
 		return NULL;
 	}
 
-	/* Initialize zone timers. */
-	zone_timers_create(new_zone, &server->sched);
-
 	log_zone_load_info(new_zone, conf->name, zstatus);
 
 	return new_zone;
@@ -260,18 +256,17 @@ static zone_t *create_zone(zone_t *old_zone, conf_zone_t *conf, server_t *server
  *
  * \param[in]  old_zone  Old zone (if loaded).
  * \param[in]  conf      Zone configuration.
- * \param[in]  server    Name server structure.
  *
  * \return Updated zone on success, NULL otherwise.
  */
-static zone_t* update_zone(zone_t *old_zone, conf_zone_t *conf, server_t *server)
+static zone_t* update_zone(zone_t *old_zone, conf_zone_t *conf)
 {
 	assert(conf);
 
 	int result = KNOT_ERROR;
 
 	// Load zone.
-	zone_t *new_zone = create_zone(old_zone, conf, server);
+	zone_t *new_zone = create_zone(old_zone, conf);
 	if (!new_zone) {
 		return NULL;
 	}
@@ -347,6 +342,20 @@ static int update_zone_postcond(zone_t *new_zone, const conf_t *config)
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Check if the zone should be registered as a stub loaded on first use.
+ *
+ * Zones already loaded in the previous database are kept loaded.
+ */
+static bool is_lazy(const zone_t *old_zone, const conf_zone_t *conf)
+{
+	if (!conf->lazy_load) {
+		return false;
+	}
+
+	return old_zone == NULL || (old_zone->flags & ZONE_LAZY);
+}
+
 /*! \brief Context for threaded zone loader. */
 typedef struct {
 	const struct conf_t *config;
@@ -388,13 +397,20 @@ static int zone_loader_thread(dthread_t *thread)
 		zone_t *old_zone = knot_zonedb_find(ctx->db_old, apex);
 		knot_dname_free(&apex, NULL);
 
-		/* Update the zone. */
-		zone = update_zone(old_zone, zone_config, ctx->server);
+		/* Update the zone, lazy zones are loaded on first use. */
+		if (is_lazy(old_zone, zone_config)) {
+			zone = zone_new_lazy(zone_config);
+		} else {
+			zone = update_zone(old_zone, zone_config);
+		}
 		if (zone == NULL) {
 			conf_free_zone(zone_config);
 			continue;
 		}
 
+		/* Initialize zone timers. */
+		zone_timers_create(zone, &ctx->server->sched);
+
 		/* Check updated zone post-conditions. */
 		int ret = update_zone_postcond(zone, ctx->config);
 
@@ -525,8 +541,126 @@ static int remove_old_zonedb(const knot_zonedb_t *db_new, knot_zonedb_t *db_old)
 	return KNOT_EOK;
 }
 
+/*! \brief Count zones waiting to be loaded on first use. */
+static size_t lazy_zone_count(knot_zonedb_t *db)
+{
+	size_t count = 0;
+
+	knot_zonedb_iter_t it;
+	knot_zonedb_iter_begin(db, &it);
+	while (!knot_zonedb_iter_finished(&it)) {
+		zone_t *zone = knot_zonedb_iter_val(&it);
+		if (zone->flags & ZONE_LAZY) {
+			++count;
+		}
+		knot_zonedb_iter_next(&it);
+	}
+
+	return count;
+}
+
+/*! \brief Attach per-zone query counters to the zones in the database. */
+static void attach_query_counters(knot_zonedb_t *db)
+{
+	db->queries = stats_zones_new(knot_zonedb_size(db));
+	if (db->queries == NULL) {
+		log_server_warning("Failed to create zone query counters.\n");
+		return;
+	}
+
+	size_t index = 0;
+	knot_zonedb_iter_t it;
+	knot_zonedb_iter_begin(db, &it);
+	while (!knot_zonedb_iter_finished(&it)) {
+		zone_t *zone = knot_zonedb_iter_val(&it);
+		zone->queries.table = db->queries;
+		zone->queries.index = index++;
+		knot_zonedb_iter_next(&it);
+	}
+}
+
 /*- public API functions ----------------------------------------------------*/
 
+int zone_load_ev(event_t *event)
+{
+	assert(event);
+
+	zone_t *zone = (zone_t *)event->data;
+	if (zone == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zone->flags & ZONE_DISCARDED) {
+		return KNOT_EOK;
+	}
+
+	/* Load, apply journal and sign into a private zone structure,
+	 * the stub is still visible to the queries. */
+	zone_t *loaded = update_zone(NULL, zone->conf);
+	if (loaded != NULL) {
+		rcu_read_lock();
+		int ret = update_zone_postcond(loaded, conf());
+		rcu_read_unlock();
+		if (ret != KNOT_EOK) {
+			loaded->conf = NULL;
+			zone_free(&loaded);
+		}
+	}
+
+	/* Failed zone is not loaded again until the server reload. */
+	if (loaded == NULL) {
+		pthread_mutex_lock(&zone->lock);
+		zone->flags &= ~(ZONE_LAZY | ZONE_LOADING);
+		pthread_mutex_unlock(&zone->lock);
+		return KNOT_ERROR;
+	}
+
+	/* Move the loaded state to the published zone. */
+	zone->ixfr_db = loaded->ixfr_db;
+	zone->zonefile_mtime = loaded->zonefile_mtime;
+	zone->zonefile_serial = loaded->zonefile_serial;
+	zone->dnssec.refresh_at = loaded->dnssec.refresh_at;
+	zone->xfr_in.bootstrap_retry = loaded->xfr_in.bootstrap_retry;
+	zone_switch_contents(zone, loaded->contents);
+
+	loaded->ixfr_db = NULL;
+	loaded->contents = NULL;
+	loaded->conf = NULL;
+	zone_free(&loaded);
+
+	pthread_mutex_lock(&zone->lock);
+	zone->flags &= ~(ZONE_LAZY | ZONE_LOADING);
+	pthread_mutex_unlock(&zone->lock);
+
+	/* Keep the zone while starting its timers, the event must be finished
+	 * first to prevent lockup during their cancellation. */
+	zone_retain(zone);
+	server_t *server = (server_t *)event->sched->ctx;
+	evsched_end_process(event->sched);
+
+	/* Reload freezing the timers waits only for the end of the event,
+	 * don't start them then, the reloaded zone starts its own. */
+	pthread_mutex_lock(&zone->lock);
+	bool frozen = zone->flags & (ZONE_FROZEN | ZONE_DISCARDED);
+	if (!frozen) {
+		zone->flags |= ZONE_THAWING;
+	}
+	pthread_mutex_unlock(&zone->lock);
+
+	if (!frozen) {
+		zone_timers_thaw(zone);
+		zones_schedule_notify(zone, server);
+
+		pthread_mutex_lock(&zone->lock);
+		zone->flags &= ~ZONE_THAWING;
+		pthread_cond_broadcast(&zone->thawed);
+		pthread_mutex_unlock(&zone->lock);
+	}
+
+	zone_release(zone);
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Update zone database according to configuration.
  */
@@ -560,6 +694,12 @@ int load_zones_from_config(const conf_t *conf, struct server_t *server)
 
 	/* Rebuild zone database search stack. */
 	knot_zonedb_build_index(db_new);
+	attach_query_counters(db_new);
+
+	size_t lazy = lazy_zone_count(db_new);
+	if (lazy > 0) {
+		log_server_info("%zu zones will be loaded on first use.\n", lazy);
+	}
 
 	/* Switch the databases. */
 	knot_zonedb_t *db_old = rcu_xchg_pointer(&server->zone_db, db_new);
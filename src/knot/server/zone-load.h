@@ -61,6 +61,25 @@ zone_t *load_zone_file(conf_zone_t *conf);
  */
 int load_zones_from_config(const conf_t *conf, struct server_t *server);
 
+/*!
+ * \brief Event loading the lazy zone on first use.
+ *
+ * Zone file is loaded, journal applied and the zone signed the same way as
+ * when loading the zone on startup. The zone timers are started afterwards,
+ * unless they were frozen by a server reload in the meantime. If the load
+ * fails, zone stays without contents until the server reload.
+ *
+ * \note The load runs in the only event scheduler thread, so the lazy zones
+ *       are loaded one at a time and the other zone events wait for the load.
+ *
+ * \param event Event with the zone as data.
+ *
+ * \retval KNOT_EOK if the zone was loaded.
+ * \retval KNOT_ERROR if the zone could not be loaded.
+ * \retval KNOT_EINVAL on invalid parameters.
+ */
+int zone_load_ev(event_t *event);
+
 #endif // _KNOTD_ZONE_LOAD_H_
 
 /*! @} */
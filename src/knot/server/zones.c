@@ -1505,6 +1505,11 @@ int zones_schedule_refresh(zone_t *zone, int64_t timeout)
 		return KNOT_EINVAL;
 	}
 
+	/* Load lazy zone first, REFRESH is scheduled after the load. */
+	if (zone->flags & ZONE_LAZY) {
+		return zone_load_request(zone);
+	}
+
 	/* Cancel REFRESH/EXPIRE timer. */
 	evsched_cancel(zone->xfr_in.expire);
 	evsched_cancel(zone->xfr_in.timer);
@@ -1546,11 +1551,61 @@ int zones_schedule_refresh(zone_t *zone, int64_t timeout)
 	return KNOT_EOK;
 }
 
-int zones_dnssec_sign(zone_t *zone, bool force, uint32_t *refresh_at)
+/*!
+ * \brief Schedule DNSSEC event, log the planned time at given level.
+ */
+static int dnssec_schedule(zone_t *zone, time_t unixtime, int level)
+{
+	if (!zone) {
+		return KNOT_EINVAL;
+	}
+
+	char *zname = knot_dname_to_str(zone->name);
+
+	// absolute time -> relative time
+
+	time_t now = time(NULL);
+	int32_t relative = 0;
+	if (unixtime <= now) {
+		log_zone_warning("DNSSEC: Zone %s: Signature life time too low, "
+		                 "set higher value in configuration!\n", zname);
+	} else {
+		relative = unixtime - now;
+	}
+
+	// log the message
+
+	char time_str[64] = {'\0'};
+	struct tm time_gm = {0};
+
+	gmtime_r(&unixtime, &time_gm);
+
+	strftime(time_str, sizeof(time_str), KNOT_LOG_TIME_FORMAT, &time_gm);
+
+	log_msg(LOG_ZONE, level, "DNSSEC: Zone %s: Next signing planned on %s.\n",
+	        zname, time_str);
+
+	free(zname);
+
+	// schedule
+
+	evsched_schedule(zone->dnssec.timer, relative * 1000);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Sign the zone or refresh its signatures, report if it changed.
+ *
+ * Routine refresh leaving the zone unchanged is logged at debug level only.
+ */
+static int dnssec_sign(zone_t *zone, bool force, uint32_t *refresh_at,
+                       bool *changed)
 {
 	int ret = KNOT_EOK;
 	char *msgpref = NULL;
 	*refresh_at = 0;
+	*changed = false;
 
 	knot_changesets_t *chs = knot_changesets_create();
 	if (chs == NULL) {
@@ -1575,7 +1630,7 @@ int zones_dnssec_sign(zone_t *zone, bool force, uint32_t *refresh_at)
 		log_zone_info("%s Complete resign started (dropping all "
 			      "previous signatures)...\n", msgpref);
 	} else {
-		log_zone_info("%s Signing zone...\n", msgpref);
+		log_zone_debug("%s Refreshing signatures...\n", msgpref);
 	}
 
 	uint32_t new_serial = zones_next_serial(zone);
@@ -1584,15 +1639,15 @@ int zones_dnssec_sign(zone_t *zone, bool force, uint32_t *refresh_at)
 		ret = knot_dnssec_zone_sign_force(zone->contents, zone->conf,
 		                                  ch, refresh_at, new_serial);
 	} else {
-		ret = knot_dnssec_zone_sign(zone->contents, zone->conf,
-		                            ch, KNOT_SOA_SERIAL_UPDATE,
-		                            refresh_at, new_serial);
+		ret = knot_dnssec_zone_refresh(zone->contents, zone->conf,
+		                               ch, refresh_at, new_serial);
 	}
 	if (ret != KNOT_EOK) {
 		goto done;
 	}
 
-	if (!zones_changesets_empty(chs)) {
+	*changed = !zones_changesets_empty(chs);
+	if (*changed) {
 		knot_zone_contents_t *new_c = NULL;
 		ret = zones_store_and_apply_chgsets(chs, zone, &new_c, "DNSSEC",
 						    XFR_TYPE_UPDATE);
@@ -1604,7 +1659,11 @@ int zones_dnssec_sign(zone_t *zone, bool force, uint32_t *refresh_at)
 		}
 	}
 
-	log_zone_info("%s Successfully signed.\n", msgpref);
+	if (force || *changed) {
+		log_zone_info("%s Successfully signed.\n", msgpref);
+	} else {
+		log_zone_debug("%s Signatures are up-to-date.\n", msgpref);
+	}
 
 done:
 	knot_changesets_free(&chs);
@@ -1616,16 +1675,24 @@ done:
 	return ret;
 }
 
+int zones_dnssec_sign(zone_t *zone, bool force, uint32_t *refresh_at)
+{
+	bool changed = false;
+	return dnssec_sign(zone, force, refresh_at, &changed);
+}
+
 int zones_dnssec_ev(event_t *event)
 {
 	// We will be working with zone, don't want it to change in the meantime
 	rcu_read_lock();
 	zone_t *zone = (zone_t *)event->data;
 	uint32_t refresh_at = 0;
+	bool changed = false;
 
-	int ret = zones_dnssec_sign(zone, false, &refresh_at);
+	int ret = dnssec_sign(zone, false, &refresh_at, &changed);
 	if (refresh_at != 0) {
-		ret = zones_schedule_dnssec(zone, refresh_at);
+		ret = dnssec_schedule(zone, refresh_at,
+		                      changed ? LOG_INFO : LOG_DEBUG);
 	}
 
 	rcu_read_unlock();
@@ -1646,42 +1713,7 @@ int zones_cancel_dnssec(zone_t *zone)
 
 int zones_schedule_dnssec(zone_t *zone, time_t unixtime)
 {
-	if (!zone) {
-		return KNOT_EINVAL;
-	}
-
-	char *zname = knot_dname_to_str(zone->name);
-
-	// absolute time -> relative time
-
-	time_t now = time(NULL);
-	int32_t relative = 0;
-	if (unixtime <= now) {
-		log_zone_warning("DNSSEC: Zone %s: Signature life time too low, "
-		                 "set higher value in configuration!\n", zname);
-	} else {
-		relative = unixtime - now;
-	}
-
-	// log the message
-
-	char time_str[64] = {'\0'};
-	struct tm time_gm = {0};
-
-	gmtime_r(&unixtime, &time_gm);
-
-	strftime(time_str, sizeof(time_str), KNOT_LOG_TIME_FORMAT, &time_gm);
-
-	log_zone_info("DNSSEC: Zone %s: Next signing planned on %s.\n",
-	              zname, time_str);
-
-	free(zname);
-
-	// schedule
-
-	evsched_schedule(zone->dnssec.timer, relative * 1000);
-
-	return KNOT_EOK;
+	return dnssec_schedule(zone, unixtime, LOG_INFO);
 }
 
 void zones_schedule_zonefile_sync(zone_t *zone, uint32_t timeout)
@@ -1900,7 +1932,8 @@ int zones_journal_apply(zone_t *zone)
 	return ret;
 }
 
-static int sign_after_load(zone_t *zone, knot_changesets_t **diff_chs)
+static int sign_after_load(zone_t *zone, zone_t *old_zone,
+                           knot_changesets_t **diff_chs)
 {
 	assert(zone != NULL);
 	assert(diff_chs != NULL);
@@ -1908,8 +1941,34 @@ static int sign_after_load(zone_t *zone, knot_changesets_t **diff_chs)
 	if (zone->conf->dnssec_enable) {
 		zone->dnssec.refresh_at = 0;
 
+		/* Keep signatures of the records that were not changed. */
+		hattrie_t *trusted = NULL;
+		if (old_zone != NULL) {
+			trusted = hattrie_create();
+			if (trusted == NULL) {
+				return KNOT_ENOMEM;
+			}
+			size_t reused = 0;
+			int ret = knot_zone_sign_reuse(old_zone->contents,
+			                               zone->contents, trusted,
+			                               &reused);
+			if (ret != KNOT_EOK) {
+				log_zone_error("DNSSEC: Zone %s - Failed to reuse "
+				               "signatures (%s).\n",
+				               zone->conf->name, knot_strerror(ret));
+				hattrie_free(trusted);
+				return ret;
+			}
+			if (reused > 0) {
+				log_zone_info("DNSSEC: Zone %s - Reused signatures "
+				              "of %zu RR sets.\n",
+				              zone->conf->name, reused);
+			}
+		}
+
 		*diff_chs = knot_changesets_create();
 		if (*diff_chs == NULL) {
+			hattrie_free(trusted);
 			return KNOT_ENOMEM;
 		}
 		/* Extra changeset is needed. */
@@ -1917,6 +1976,7 @@ static int sign_after_load(zone_t *zone, knot_changesets_t **diff_chs)
 		                knot_changesets_create_changeset(*diff_chs);
 		if (chgset == NULL) {
 			knot_changesets_free(diff_chs);
+			hattrie_free(trusted);
 			return KNOT_ENOMEM;
 		}
 
@@ -1929,9 +1989,11 @@ static int sign_after_load(zone_t *zone, knot_changesets_t **diff_chs)
 		 * possible to flush the changes to zonefile.
 		 */
 		int ret = knot_dnssec_zone_sign(zone->contents, zone->conf,
-		                                chgset, KNOT_SOA_SERIAL_UPDATE,
+		                                trusted, chgset,
+		                                KNOT_SOA_SERIAL_UPDATE,
 		                                &zone->dnssec.refresh_at,
 		                                new_serial);
+		hattrie_free(trusted);
 		if (ret != KNOT_EOK) {
 			knot_changesets_free(diff_chs);
 			log_zone_error("DNSSEC: Zone %s - Signing failed while "
@@ -2140,7 +2202,8 @@ int zones_do_diff_and_sign(zone_t *zone, zone_t *old_zone, bool zone_changed)
 	                     && old_zone != NULL && old_zone->contents != NULL;
 	bool zone_signed = false;
 
-	int ret = sign_after_load(zone, &diff_chs);
+	int ret = sign_after_load(zone, zone_reloaded ? old_zone : NULL,
+	                          &diff_chs);
 	if (ret != KNOT_EOK) {
 		rcu_read_unlock();
 		return ret;
@@ -261,7 +261,7 @@ int zones_journal_apply(zone_t *zone);
  */
 int zones_do_diff_and_sign(zone_t *zone, zone_t *old_zone, bool zone_changed);
 
-/*! \brief Just sign current zone. */
+/*! \brief Sign current zone completely or refresh a slice of its signatures. */
 int zones_dnssec_sign(zone_t *zone, bool force, uint32_t *expires_at);
 
 /*
@@ -26,6 +26,7 @@
 #include "knot/updates/acl.h"
 #include "libknot/util/endian.h"
 #include "libknot/rdata/tsig.h"
+#include "libknot/common.h"
 
 static inline uint32_t ipv4_chunk(const struct sockaddr_in *ipv4)
 {
@@ -75,7 +76,7 @@ static uint32_t acl_fill_mask32(short nbits)
 	assert(nbits >= 0 && nbits <= 32);
 	uint32_t r = 0;
 	for (char i = 0; i < nbits; ++i) {
-		r |= 1 << (31 - i);
+		r |= 1U << (31 - i);
 	}
 
 	/* Make sure the mask is in network byte order. */
@@ -119,6 +120,134 @@ int netblock_match(const netblock_t *a1, const struct sockaddr_storage *a2)
 	return ret;
 }
 
+/*! \brief Address bytes and length in bits, NULL if not IPv4/IPv6. */
+static const uint8_t *addr_bits(const struct sockaddr_storage *ss,
+                                uint8_t *bits)
+{
+	if (ss->ss_family == AF_INET) {
+		*bits = IPV4_PREFIXLEN;
+		return (const uint8_t *)&((const struct sockaddr_in *)ss)->sin_addr;
+	} else if (ss->ss_family == AF_INET6) {
+		*bits = IPV6_PREFIXLEN;
+		return (const uint8_t *)&((const struct sockaddr_in6 *)ss)->sin6_addr;
+	}
+
+	return NULL;
+}
+
+static inline unsigned addr_bit(const uint8_t *addr, uint8_t i)
+{
+	return (addr[i / 8] >> (7 - i % 8)) & 1;
+}
+
+/*! \brief Number of leading bits equal in both addresses (at most max). */
+static uint8_t common_bits(const uint8_t *a1, const uint8_t *a2, uint8_t max)
+{
+	uint8_t bits = 0;
+	for (unsigned i = 0; bits < max; ++i, bits += 8) {
+		uint8_t diff = a1[i] ^ a2[i];
+		if (diff != 0) {
+			bits += __builtin_clz(diff) - (sizeof(unsigned) - 1) * CHAR_BIT;
+			break;
+		}
+	}
+
+	return MIN(bits, max);
+}
+
+/*! \brief Check if the address is in the node prefix. */
+static bool node_match(const acl_node_t *node, const uint8_t *addr)
+{
+	return common_bits(node->addr, addr, node->prefix) == node->prefix;
+}
+
+static acl_node_t *node_create(const uint8_t *addr, uint8_t prefix)
+{
+	acl_node_t *node = malloc(sizeof(acl_node_t));
+	if (node == NULL) {
+		return NULL;
+	}
+
+	memset(node, 0, sizeof(acl_node_t));
+	node->prefix = prefix;
+	memcpy(node->addr, addr, (prefix + CHAR_BIT - 1) / CHAR_BIT);
+	if (prefix % CHAR_BIT != 0) {
+		node->addr[prefix / CHAR_BIT] &= 0xff << (CHAR_BIT - prefix % CHAR_BIT);
+	}
+
+	return node;
+}
+
+static void node_free(acl_node_t *node)
+{
+	if (node == NULL) {
+		return;
+	}
+
+	node_free(node->child[0]);
+	node_free(node->child[1]);
+	free(node);
+}
+
+/*! \brief Find or create node for the prefix in the tree. */
+static acl_node_t *tree_get(acl_node_t **pos, const uint8_t *addr, uint8_t prefix)
+{
+	while (*pos != NULL) {
+		acl_node_t *node = *pos;
+		uint8_t common = common_bits(node->addr, addr, MIN(node->prefix, prefix));
+		if (common == node->prefix) {
+			if (node->prefix == prefix) {
+				return node;
+			}
+			/* Longer prefix, descend. */
+			pos = &node->child[addr_bit(addr, node->prefix)];
+			continue;
+		}
+
+		/* Prefix diverges from the node, insert above it. */
+		acl_node_t *parent = node_create(addr, common);
+		if (parent == NULL) {
+			return NULL;
+		}
+		parent->child[addr_bit(node->addr, common)] = node;
+		*pos = parent;
+		if (common == prefix) {
+			return parent;
+		}
+		pos = &parent->child[addr_bit(addr, common)];
+	}
+
+	*pos = node_create(addr, prefix);
+	return *pos;
+}
+
+/*! \brief Check if the rule accepts given key name. */
+static bool rule_match_key(const acl_match_t *rule, const knot_dname_t *key_name)
+{
+	/* NOKEY entry requires no key, keyed entry requires the same key. */
+	if (rule->key == NULL || key_name == NULL) {
+		return rule->key == NULL && key_name == NULL;
+	}
+
+	return knot_dname_is_equal(rule->key->name, key_name);
+}
+
+/*! \brief Select first rule accepting the key. */
+static acl_match_t *rule_first(acl_match_t *rule, const knot_dname_t *key_name,
+                               acl_match_t *found)
+{
+	for (; rule != NULL; rule = rule->next) {
+		if (found != NULL && found->order < rule->order) {
+			break;
+		}
+		if (rule_match_key(rule, key_name)) {
+			return rule;
+		}
+	}
+
+	return found;
+}
+
 acl_t *acl_new()
 {
 	acl_t *acl = malloc(sizeof(acl_t));
@@ -127,7 +256,7 @@ acl_t *acl_new()
 	}
 
 	memset(acl, 0, sizeof(acl_t));
-	init_list(acl);
+	init_list(&acl->rules);
 	return acl;
 }
 
@@ -159,8 +288,29 @@ int acl_insert(acl_t *acl, const struct sockaddr_storage *addr, uint8_t prefix,
 	match->netblock.prefix = prefix;
 	memcpy(&match->netblock.ss, addr, sizeof(struct sockaddr_storage));
 	match->key = key;
+	match->order = acl->count;
+	match->next = NULL;
+
+	/* Link to the radix tree node. */
+	uint8_t bits = 0;
+	const uint8_t *addr_data = addr_bits(addr, &bits);
+	if (addr_data != NULL) {
+		unsigned family = (addr->ss_family == AF_INET6);
+		acl_node_t *node = tree_get(&acl->tree[family], addr_data,
+		                            MIN(prefix, bits));
+		if (node == NULL) {
+			free(match);
+			return KNOT_ENOMEM;
+		}
+		acl_match_t **last = &node->rules;
+		while (*last != NULL) {
+			last = &(*last)->next;
+		}
+		*last = match;
+	}
 
-	add_tail(acl, &match->n);
+	add_tail(&acl->rules, &match->n);
+	++acl->count;
 
 	return KNOT_EOK;
 }
@@ -171,31 +321,32 @@ acl_match_t* acl_find(acl_t *acl, const struct sockaddr_storage *addr, const kno
 		return NULL;
 	}
 
-	acl_match_t *cur = NULL;
-	WALK_LIST(cur, *acl) {
-		if (netblock_match(&cur->netblock, addr) == 0) {
-			/* NOKEY entry. */
-			if (cur->key == NULL) {
-				if (key_name == NULL) {
-					return cur;
-				}
-				/* NOKEY entry, but key provided. */
-				continue;
-			}
-
-			/* NOKEY provided, but key required. */
-			if (key_name == NULL) {
-				continue;
-			}
-
-			/* Key name match. */
-			if (knot_dname_is_equal(cur->key->name, key_name)) {
+	/* Other address families are matched linearly. */
+	uint8_t bits = 0;
+	const uint8_t *addr_data = addr_bits(addr, &bits);
+	if (addr_data == NULL) {
+		acl_match_t *cur = NULL;
+		WALK_LIST(cur, acl->rules) {
+			if (netblock_match(&cur->netblock, addr) == 0 &&
+			    rule_match_key(cur, key_name)) {
 				return cur;
 			}
 		}
+		return NULL;
 	}
 
-	return NULL;
+	/* Visit all prefixes of the address, keep the first inserted rule. */
+	acl_match_t *found = NULL;
+	acl_node_t *node = acl->tree[addr->ss_family == AF_INET6];
+	while (node != NULL && node_match(node, addr_data)) {
+		found = rule_first(node->rules, key_name, found);
+		if (node->prefix >= bits) {
+			break;
+		}
+		node = node->child[addr_bit(addr_data, node->prefix)];
+	}
+
+	return found;
 }
 
 void acl_truncate(acl_t *acl)
@@ -204,5 +355,10 @@ void acl_truncate(acl_t *acl)
 		return;
 	}
 
-	WALK_LIST_FREE(*acl);
+	node_free(acl->tree[0]);
+	node_free(acl->tree[1]);
+	acl->tree[0] = acl->tree[1] = NULL;
+	acl->count = 0;
+
+	WALK_LIST_FREE(acl->rules);
 }
@@ -20,8 +20,10 @@
  *
  * \brief Access control lists.
  *
- * Simple access control list is implemented as a linked list, sorted by
- * prefix length. This way, longest prefix match is always found first.
+ * Rules are kept in a list in the order of insertion and compiled into
+ * a path-compressed binary radix tree per address family, so the lookup
+ * only visits the rules on the address path (at most one node per prefix
+ * bit). The first inserted matching rule wins.
  *
  * \addtogroup common_lib
  * @{
@@ -37,9 +39,6 @@
 
 struct knot_tsig_key;
 
-/*! \brief ACL structure. */
-typedef list_t acl_t;
-
 /*! \brief Netblock (address and prefix). */
 typedef struct netblock {
 	struct sockaddr_storage ss; /*!< Address storage. */
@@ -51,8 +50,25 @@ typedef struct acl_match {
 	node_t n;
 	netblock_t netblock;
 	struct knot_tsig_key *key; /*!< \brief TSIG key. */
+	unsigned order;            /*!< Insertion order. */
+	struct acl_match *next;    /*!< Next rule with the same netblock. */
 } acl_match_t;
 
+/*! \brief Radix tree node, rules for the prefix. */
+typedef struct acl_node {
+	uint8_t addr[16];          /*!< Prefix address, masked. */
+	uint8_t prefix;            /*!< Prefix length. */
+	acl_match_t *rules;        /*!< Rules in the insertion order. */
+	struct acl_node *child[2]; /*!< Subtrees by the next address bit. */
+} acl_node_t;
+
+/*! \brief ACL structure. */
+typedef struct acl {
+	list_t rules;              /*!< All rules in the insertion order. */
+	unsigned count;            /*!< Number of inserted rules. */
+	acl_node_t *tree[2];       /*!< IPv4 and IPv6 radix trees. */
+} acl_t;
+
 /*! \brief Match address against netblock. */
 int netblock_match(const netblock_t *a1, const struct sockaddr_storage *a2);
 
@@ -922,6 +922,30 @@ static int process_rr(const knot_rrset_t *rr, const knot_zone_contents_t *zone,
 	}
 }
 
+/*!< \brief Counts apex NS RRs removed by changeset, minus the added ones. */
+static int apex_ns_removals(const knot_zone_contents_t *zone,
+                           const knot_changeset_t *changeset)
+{
+	int count = 0;
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, changeset->remove) {
+		const knot_rrset_t *rr = rr_node->rr;
+		if (rr->type == KNOT_RRTYPE_NS &&
+		    knot_dname_is_equal(rr->owner, zone->apex->owner)) {
+			++count;
+		}
+	}
+	WALK_LIST(rr_node, changeset->add) {
+		const knot_rrset_t *rr = rr_node->rr;
+		if (rr->type == KNOT_RRTYPE_NS &&
+		    knot_dname_is_equal(rr->owner, zone->apex->owner)) {
+			--count;
+		}
+	}
+
+	return count;
+}
+
 /*!< \brief Maps Knot return code to RCODE. */
 static uint16_t ret_to_rcode(int ret)
 {
@@ -973,34 +997,39 @@ int knot_ddns_process_update(const knot_zone_contents_t *zone,
 		return KNOT_EINVAL;
 	}
 
-	/* Copy base SOA RR. */
-	knot_rrset_t *soa_begin = node_create_rrset(zone->apex, KNOT_RRTYPE_SOA);
-	if (soa_begin == NULL) {
-		return KNOT_ENOMEM;
+	/* Copy base SOA RR, unless continuing a batch of updates. */
+	if (changeset->soa_from == NULL) {
+		knot_rrset_t *soa_begin = node_create_rrset(zone->apex,
+		                                            KNOT_RRTYPE_SOA);
+		if (soa_begin == NULL) {
+			return KNOT_ENOMEM;
+		}
+		knot_changeset_add_soa(changeset, soa_begin, KNOT_CHANGESET_REMOVE);
 	}
-	knot_changeset_add_soa(changeset, soa_begin, KNOT_CHANGESET_REMOVE);
 
 	int64_t sn_old = knot_zone_serial(zone);
 
-	/* Process all RRs the Authority (Update) section. */
-
-	dbg_ddns("Processing UPDATE section.\n");
-	int apex_ns_rem = 0;
+	/* Check all RRs first, so that invalid update leaves changeset intact. */
 	const knot_pktsection_t *authority = knot_pkt_section(query, KNOT_AUTHORITY);
 	for (uint16_t i = 0; i < authority->count; ++i) {
-		const knot_rrset_t *rr = &authority->rr[i];
-
-		/* Check if the entry is correct. */
-		int ret = check_update(rr, query, rcode);
+		int ret = check_update(&authority->rr[i], query, rcode);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
+	}
+
+	/* Process all RRs the Authority (Update) section. */
+
+	dbg_ddns("Processing UPDATE section.\n");
+	int apex_ns_rem = apex_ns_removals(zone, changeset);
+	for (uint16_t i = 0; i < authority->count; ++i) {
+		const knot_rrset_t *rr = &authority->rr[i];
 
 		if (skip_soa(rr, sn_old)) {
 			continue;
 		}
 
-		ret = process_rr(rr, zone, changeset, &apex_ns_rem);
+		int ret = process_rr(rr, zone, changeset, &apex_ns_rem);
 		if (ret != KNOT_EOK) {
 			*rcode = ret_to_rcode(ret);
 			return ret;
@@ -1014,7 +1043,7 @@ int knot_ddns_process_update(const knot_zone_contents_t *zone,
 			return KNOT_EOK;
 		}
 
-		knot_rrset_t *soa_cpy = knot_rrset_copy(soa_begin, NULL);
+		knot_rrset_t *soa_cpy = knot_rrset_copy(changeset->soa_from, NULL);
 		if (soa_cpy == NULL) {
 			*rcode = KNOT_RCODE_SERVFAIL;
 			return KNOT_ENOMEM;
@@ -50,6 +50,11 @@ int knot_ddns_process_prereqs(const knot_pkt_t *query,
  * \brief Processes DNS update and creates a changeset out of it. Zone is left
  *        intact.
  *
+ * \note If the changeset already contains changes from previous updates
+ *       (i.e. has its starting SOA set), the update is merged into it as if
+ *       its RRs followed the previous ones in a single UPDATE message.
+ *       Changeset is not modified if the update fails the RR checks.
+ *
  * \param zone        Zone to be updated.
  * \param query       DNS message containing the update.
  * \param changeset   Output changeset.
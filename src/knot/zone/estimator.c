@@ -137,16 +137,20 @@ static int get_htable_size(void *t, void *d)
 	hhash_t *table = (hhash_t *)t;
 	size_t *size = (size_t *)d;
 
-	/* Size of the empty table. */
-	*size += add_overhead(sizeof(hhash_t) + table->size * sizeof(hhelem_t));
+	/* Size of the empty table, including fingerprints. */
+	*size += add_overhead(sizeof(hhash_t) +
+	                      table->size * (sizeof(hhelem_t) + 1) +
+	                      sizeof(hhbitvec_t) * 8);
 
-	/* Allocated keys. */
+	/* Keys not fitting inline. */
 	uint16_t key_len = 0;
 	hhash_iter_t it;
 	hhash_iter_begin(table, &it, false);
 	while (!hhash_iter_finished(&it)) {
 		(void)hhash_iter_key(&it, &key_len);
-		*size += add_overhead(sizeof(value_t) + sizeof(uint16_t) + key_len);
+		if (key_len > HHKEY_INLINE) {
+			*size += add_overhead(sizeof(uint16_t) + key_len);
+		}
 		hhash_iter_next(&it);
 	}
 
@@ -23,9 +23,12 @@
 
 #include "knot/knot.h"
 #include "knot/other/debug.h"
+#include "libknot/common.h"
 #include "libknot/libknot.h"
 #include "libknot/dnssec/key.h"
+#include "libknot/dnssec/crypto.h"
 #include "libknot/dnssec/rrset-sign.h"
+#include "libknot/dnssec/sign.h"
 #include "libknot/rdata/rrsig.h"
 #include "libknot/rdata/soa.h"
 #include "libknot/rdata/nsec.h"
@@ -35,6 +38,7 @@
 #include "common/descriptor.h"
 #include "common/mempattern.h"
 #include "knot/dnssec/zone-nsec.h"
+#include "knot/server/dthreads.h"
 
 #include "knot/zone/semantic-check.h"
 
@@ -68,6 +72,8 @@ static char *error_messages[(-ZC_ERR_UNKNOWN) + 1] = {
 	"RRSIG: Class is wrong!",
 	[-ZC_ERR_RRSIG_TTL] =
 	"RRSIG: TTL is wrong!",
+	[-ZC_ERR_RRSIG_INVALID] =
+	"RRSIG: Signature does not validate!",
 
 	[-ZC_ERR_NO_NSEC] =
 	"NSEC: Missing NSEC record",
@@ -189,6 +195,67 @@ static void log_error_from_node(err_handler_t *handler,
 	free(name);
 }
 
+/*!
+ * \brief Semantic error recorded for later handling.
+ */
+typedef struct {
+	const zone_node_t *node;
+	int error;
+	char *data;
+} sem_error_t;
+
+struct sem_errors {
+	sem_error_t *errors;
+	size_t count;
+	size_t max;
+};
+
+static int sem_errors_add(struct sem_errors *list, const zone_node_t *node,
+                          int error, const char *data)
+{
+	if (list->count == list->max) {
+		size_t max = list->max > 0 ? 2 * list->max : 8;
+		sem_error_t *errors = realloc(list->errors,
+		                              max * sizeof(sem_error_t));
+		if (errors == NULL) {
+			return KNOT_ENOMEM;
+		}
+		list->errors = errors;
+		list->max = max;
+	}
+
+	char *copy = NULL;
+	if (data != NULL) {
+		copy = strdup(data);
+		if (copy == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	sem_error_t *err = &list->errors[list->count++];
+	err->node = node;
+	err->error = error;
+	err->data = copy;
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Handle recorded errors in the order they were found, free them.
+ */
+static void sem_errors_flush(struct sem_errors *list, err_handler_t *handler)
+{
+	for (size_t i = 0; i < list->count; ++i) {
+		sem_error_t *err = &list->errors[i];
+		err_handler_handle_error(handler, err->node, err->error,
+		                         err->data);
+		free(err->data);
+	}
+
+	free(list->errors);
+	memset(list, 0, sizeof(*list));
+}
+
 int err_handler_handle_error(err_handler_t *handler, const zone_node_t *node,
                              int error, const char *data)
 {
@@ -198,6 +265,10 @@ int err_handler_handle_error(err_handler_t *handler, const zone_node_t *node,
 		return KNOT_EINVAL;
 	}
 
+	if (handler->deferred != NULL) {
+		return sem_errors_add(handler->deferred, node, error, data);
+	}
+
 	/*
 	 * A missing SOA can only occur once, so there needn't be
 	 * an option for it.
@@ -407,21 +478,77 @@ static int check_rrsig_rdata(err_handler_t *handler,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Zone keys for signature verification.
+ *
+ * Keys are shared by all checking threads, each thread has its own signing
+ * contexts, created on first use and reused for all signatures of the key.
+ */
+typedef struct {
+	knot_dnssec_key_t *keys;
+	knot_dnssec_sign_context_t **contexts; /*!< Same index as keys. */
+	size_t count;
+} sem_verify_t;
+
+/*!
+ * \brief Verify signature using a zone key matching the RRSIG.
+ *
+ * \retval KNOT_EOK if the signature is valid.
+ * \retval KNOT_ENOENT if there is no usable key.
+ * \return Other error code if the signature is not valid.
+ */
+static int verify_rrsig(sem_verify_t *verify, const knot_rrset_t *covered,
+                        const knot_rrset_t *rrsigs, size_t pos)
+{
+	uint8_t algorithm = knot_rrsig_algorithm(&rrsigs->rrs, pos);
+	uint16_t keytag = knot_rrsig_key_tag(&rrsigs->rrs, pos);
+	const knot_dname_t *signer = knot_rrsig_signer_name(&rrsigs->rrs, pos);
+
+	/* Expiration is checked separately. */
+	knot_dnssec_policy_t policy = { 0 };
+
+	int result = KNOT_ENOENT;
+	for (size_t i = 0; i < verify->count; ++i) {
+		const knot_dnssec_key_t *key = &verify->keys[i];
+		if (key->keytag != keytag || key->algorithm != algorithm ||
+		    !knot_dname_is_equal(key->name, signer)) {
+			continue;
+		}
+
+		if (verify->contexts[i] == NULL) {
+			verify->contexts[i] = knot_dnssec_sign_init(key);
+			if (verify->contexts[i] == NULL) {
+				return KNOT_ENOMEM;
+			}
+		}
+
+		result = knot_is_valid_signature(covered, rrsigs, pos, key,
+		                                 verify->contexts[i], &policy);
+		if (result == KNOT_EOK) {
+			break;
+		}
+	}
+
+	return result;
+}
+
 /*!
  * \brief Semantic check - RRSet's RRSIG.
  *
  * \param rrset RRSet containing RRSIG.
  * \param dnskey_rrset
- * \param nsec3 NSEC3 active.
+ * \param verify Keys for signature verification, may be NULL.
  *
  * \retval KNOT_EOK on success.
+ * \retval KNOT_ENOMEM if the signatures could not be verified.
  *
  * \return Appropriate error code if error was found.
  */
 static int check_rrsig_in_rrset(err_handler_t *handler,
                                 const zone_node_t *node,
                                 const knot_rrset_t *rrset,
-                                const knot_rrset_t *dnskey_rrset)
+                                const knot_rrset_t *dnskey_rrset,
+                                sem_verify_t *verify)
 {
 	if (handler == NULL || node == NULL || rrset == NULL) {
 		return KNOT_EINVAL;
@@ -468,14 +595,34 @@ static int check_rrsig_in_rrset(err_handler_t *handler,
 		                         info_str);
 	}
 
+	knot_rrset_t rrsig_rrset;
+	knot_rrset_init(&rrsig_rrset, node->owner, KNOT_RRTYPE_RRSIG,
+	                KNOT_CLASS_IN);
+	rrsig_rrset.rrs = rrsigs;
+
+	ret = KNOT_EOK;
 	for (uint16_t i = 0; i < (&rrsigs)->rr_count; ++i) {
-		int ret = check_rrsig_rdata(handler, node, &rrsigs, i, rrset,
-		                            dnskey_rrset);
-		if (ret != KNOT_EOK) {
+		int check = check_rrsig_rdata(handler, node, &rrsigs, i, rrset,
+		                              dnskey_rrset);
+		if (check != KNOT_EOK) {
 			dbg_semcheck("Could not check RRSIG properly (%s).\n",
-			             knot_strerror(ret));
+			             knot_strerror(check));
 			break;
 		}
+
+		if (verify == NULL) {
+			continue;
+		}
+
+		check = verify_rrsig(verify, rrset, &rrsig_rrset, i);
+		if (check == KNOT_ENOMEM) {
+			ret = KNOT_ENOMEM;
+			break;
+		} else if (check != KNOT_EOK && check != KNOT_ENOENT) {
+			err_handler_handle_error(handler, node,
+			                         ZC_ERR_RRSIG_INVALID,
+			                         info_str);
+		}
 	}
 
 	knot_rdataset_clear(&rrsigs, NULL);
@@ -863,6 +1010,7 @@ int sem_check_node_plain(const knot_zone_contents_t *zone,
  * \param last_node Last node in canonical order.
  * \param handler Error handler.
  * \param nsec3 NSEC3 used.
+ * \param verify Keys for signature verification, may be NULL.
  *
  * \retval KNOT_EOK if no error was found.
  *
@@ -872,7 +1020,7 @@ static int semantic_checks_dnssec(knot_zone_contents_t *zone,
                                   zone_node_t *node,
                                   zone_node_t **last_node,
                                   err_handler_t *handler,
-                                  char nsec3)
+                                  char nsec3, sem_verify_t *verify)
 {
 	assert(handler);
 	assert(node);
@@ -885,10 +1033,15 @@ static int semantic_checks_dnssec(knot_zone_contents_t *zone,
 
 	for (int i = 0; i < rrset_count; i++) {
 		knot_rrset_t rrset = node_rrset_at(node, i);
-		if (auth && !deleg && rrset.type != KNOT_RRTYPE_RRSIG &&
-		    (ret = check_rrsig_in_rrset(handler, node,
-		                                &rrset, &dnskey_rrset)) != 0) {
-			err_handler_handle_error(handler, node, ret, NULL);
+		if (auth && !deleg && rrset.type != KNOT_RRTYPE_RRSIG) {
+			ret = check_rrsig_in_rrset(handler, node, &rrset,
+			                           &dnskey_rrset, verify);
+			if (ret == KNOT_ENOMEM) {
+				return ret;
+			} else if (ret != KNOT_EOK) {
+				err_handler_handle_error(handler, node, ret,
+				                         NULL);
+			}
 		}
 
 		if (!nsec3 && auth) {
@@ -979,65 +1132,296 @@ static int semantic_checks_dnssec(knot_zone_contents_t *zone,
 	return KNOT_EOK;
 }
 
+/*! \brief Minimal number of nodes to run the checks in parallel. */
+#define SEM_CHECK_PARALLEL_MIN 4096
+/*! \brief Number of nodes checked by a thread at once. */
+#define SEM_CHECK_CHUNK 256
+
+/*!
+ * \brief Results of checks of a contiguous range of nodes.
+ */
+typedef struct {
+	struct sem_errors errors;
+	zone_node_t *last_node; /*!< Last node of NSEC chain in the range. */
+	bool fatal_error;
+	int ret;                /*!< Failure of the checks (not a zone error). */
+} sem_chunk_t;
+
+/*!
+ * \brief Context of zone checks shared by the checking threads.
+ */
+typedef struct {
+	knot_zone_contents_t *zone;
+	int do_checks;
+	zone_node_t **nodes;    /*!< Nodes in canonical order. */
+	size_t count;
+	sem_chunk_t *chunks;
+	size_t chunk_count;
+	size_t next;            /*!< Next unclaimed chunk. */
+	knot_dnssec_key_t *keys; /*!< Zone keys for signature verification. */
+	size_t key_count;
+} sem_check_ctx_t;
+
 /*!
- * \brief Function called by zone traversal function. Used to call
- *        knot_zone_save_enclosers.
+ * \brief Run semantic checks for a single node.
  *
- * \param node Node to be searched.
- * \param data Arguments.
+ * \retval KNOT_EOK if the node was checked (errors go to the handler).
+ * \retval KNOT_ENOMEM if the checks could not be completed.
  */
-static int do_checks_in_tree(zone_node_t *node, void *data)
+static int sem_check_node(sem_check_ctx_t *ctx, zone_node_t *node,
+                          err_handler_t *handler, sem_verify_t *verify,
+                          zone_node_t **last_node, bool *fatal_error)
 {
-	arg_t *args = (arg_t *)data;
+	bool fatal = false;
+	if (!ctx->do_checks) {
+		/* All CNAME/DNAME checks are mandatory. */
+		sem_check_node_plain(ctx->zone, node, handler, true, &fatal);
+		*fatal_error = *fatal_error || fatal;
+		return KNOT_EOK;
+	}
 
-	knot_zone_contents_t *zone = (knot_zone_contents_t *)args->arg1;
+	sem_check_node_plain(ctx->zone, node, handler, false, &fatal);
+	*fatal_error = *fatal_error || fatal;
 
-	zone_node_t **last_node = (zone_node_t **)args->arg5;
+	if (ctx->do_checks == SEM_CHECK_NSEC ||
+	    ctx->do_checks == SEM_CHECK_NSEC3) {
+		int ret = semantic_checks_dnssec(ctx->zone, node, last_node,
+		                                 handler,
+		                                 ctx->do_checks == SEM_CHECK_NSEC3,
+		                                 verify);
+		if (ret == KNOT_ENOMEM) {
+			return ret;
+		}
+	}
 
-	err_handler_t *handler = (err_handler_t *)args->arg6;
+	return KNOT_EOK;
+}
 
-	char do_checks = *((char *)(args->arg3));
+/*!
+ * \brief Check range of nodes, record errors into the chunk.
+ */
+static void sem_check_chunk(sem_check_ctx_t *ctx, size_t index,
+                            sem_verify_t *verify)
+{
+	sem_chunk_t *chunk = &ctx->chunks[index];
+
+	err_handler_t handler;
+	err_handler_init(&handler);
+	handler.deferred = &chunk->errors;
+
+	size_t from = index * SEM_CHECK_CHUNK;
+	size_t to = MIN(from + SEM_CHECK_CHUNK, ctx->count);
+	for (size_t i = from; i < to && chunk->ret == KNOT_EOK; ++i) {
+		chunk->ret = sem_check_node(ctx, ctx->nodes[i], &handler, verify,
+		                            &chunk->last_node,
+		                            &chunk->fatal_error);
+	}
+}
 
-	if (do_checks) {
-		sem_check_node_plain(zone, node, handler, false,
-		                      (bool *)args->arg7);
-	} else {
-		assert(handler);
-		/* All CNAME/DNAME checks are mandatory. */
-		handler->options.log_cname = 1;
-		sem_check_node_plain(zone, node, handler, true,
-		                      (bool *)args->arg7);
+static int sem_verify_init(sem_verify_t *verify, sem_check_ctx_t *ctx)
+{
+	memset(verify, 0, sizeof(*verify));
+	if (ctx->key_count == 0) {
+		return KNOT_EOK;
+	}
+
+	verify->contexts = calloc(ctx->key_count,
+	                          sizeof(knot_dnssec_sign_context_t *));
+	if (verify->contexts == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	verify->keys = ctx->keys;
+	verify->count = ctx->key_count;
+
+	return KNOT_EOK;
+}
+
+static void sem_verify_clear(sem_verify_t *verify)
+{
+	for (size_t i = 0; i < verify->count; ++i) {
+		knot_dnssec_sign_free(verify->contexts[i]);
+	}
+	free(verify->contexts);
+	memset(verify, 0, sizeof(*verify));
+}
+
+/*!
+ * \brief Check chunks of nodes until there are none left.
+ */
+static int sem_check_claimed(sem_check_ctx_t *ctx)
+{
+	sem_verify_t verify;
+	int ret = sem_verify_init(&verify, ctx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	for (;;) {
+		size_t index = __sync_fetch_and_add(&ctx->next, 1);
+		if (index >= ctx->chunk_count) {
+			break;
+		}
+		sem_check_chunk(ctx, index, verify.count > 0 ? &verify : NULL);
+	}
+
+	sem_verify_clear(&verify);
+
+	return KNOT_EOK;
+}
+
+static int sem_check_thread(dthread_t *thread)
+{
+	return sem_check_claimed(thread->data);
+}
+
+static int sem_check_destruct(dthread_t *thread)
+{
+	knot_crypto_cleanup_thread();
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Check all collected nodes.
+ *
+ * Large zones are checked by a pool of threads, each one claiming chunks of
+ * nodes. Chunks left unchecked (no threads available) are checked here.
+ */
+static int sem_check_nodes(sem_check_ctx_t *ctx)
+{
+	if (ctx->count >= SEM_CHECK_PARALLEL_MIN) {
+		size_t thread_count = MIN(ctx->chunk_count, dt_optimal_size());
+		dt_unit_t *unit = dt_create(thread_count, &sem_check_thread,
+		                            &sem_check_destruct, ctx);
+		if (unit != NULL) {
+			dt_start(unit);
+			dt_join(unit);
+			dt_delete(&unit);
+		}
+	}
+
+	return sem_check_claimed(ctx);
+}
+
+/*!
+ * \brief Load apex DNSKEYs usable for signature verification.
+ */
+static int sem_load_keys(const knot_zone_contents_t *zone,
+                         knot_dnssec_key_t **keys_p, size_t *count_p)
+{
+	*keys_p = NULL;
+	*count_p = 0;
+
+	knot_rrset_t dnskeys = node_rrset(zone->apex, KNOT_RRTYPE_DNSKEY);
+	if (knot_rrset_empty(&dnskeys)) {
 		return KNOT_EOK;
 	}
 
-	if (do_checks == SEM_CHECK_NSEC || do_checks == SEM_CHECK_NSEC3) {
-		semantic_checks_dnssec(zone, node, last_node,
-				       handler, do_checks == SEM_CHECK_NSEC3);
+	knot_dnssec_key_t *keys = calloc(dnskeys.rrs.rr_count,
+	                                 sizeof(knot_dnssec_key_t));
+	if (keys == NULL) {
+		return KNOT_ENOMEM;
 	}
 
+	size_t count = 0;
+	for (uint16_t i = 0; i < dnskeys.rrs.rr_count; ++i) {
+		const uint8_t *rdata = knot_rrset_rr_rdata(&dnskeys, i);
+		uint16_t size = knot_rrset_rr_size(&dnskeys, i);
+		/* Unsupported and malformed keys are skipped. */
+		if (knot_dnssec_key_from_dnskey(dnskeys.owner, rdata, size,
+		                                &keys[count]) == KNOT_EOK) {
+			count += 1;
+		}
+	}
+
+	*keys_p = keys;
+	*count_p = count;
+
+	return KNOT_EOK;
+}
+
+static void sem_free_keys(knot_dnssec_key_t *keys, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		knot_dnssec_key_free(&keys[i]);
+	}
+	free(keys);
+}
+
+static int collect_node(zone_node_t *node, void *data)
+{
+	sem_check_ctx_t *ctx = data;
+	ctx->nodes[ctx->count++] = node;
 	return KNOT_EOK;
 }
 
 int zone_do_sem_checks(knot_zone_contents_t *zone, int do_checks,
-                       err_handler_t *handler, zone_node_t *first_nsec3_node,
+                       bool verify_rrsig, err_handler_t *handler,
+                       zone_node_t *first_nsec3_node,
                        zone_node_t *last_nsec3_node)
 {
 	if (!zone || !handler) {
 		return KNOT_EINVAL;
 	}
+
+	if (!do_checks) {
+		/* All CNAME/DNAME checks are mandatory. */
+		handler->options.log_cname = 1;
+	}
+
+	sem_check_ctx_t ctx = {
+		.zone = zone,
+		.do_checks = do_checks
+	};
+
+	size_t weight = knot_zone_tree_weight(zone->nodes);
+	ctx.nodes = malloc(MAX(weight, 1) * sizeof(zone_node_t *));
+	if (ctx.nodes == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = knot_zone_contents_tree_apply_inorder(zone, collect_node,
+	                                                &ctx);
+	if (ret != KNOT_EOK) {
+		free(ctx.nodes);
+		return ret;
+	}
+
+	ctx.chunk_count = (ctx.count + SEM_CHECK_CHUNK - 1) / SEM_CHECK_CHUNK;
+	ctx.chunks = calloc(MAX(ctx.chunk_count, 1), sizeof(sem_chunk_t));
+	if (ctx.chunks == NULL) {
+		free(ctx.nodes);
+		return KNOT_ENOMEM;
+	}
+
+	if (verify_rrsig &&
+	    (do_checks == SEM_CHECK_NSEC || do_checks == SEM_CHECK_NSEC3)) {
+		ret = sem_load_keys(zone, &ctx.keys, &ctx.key_count);
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = sem_check_nodes(&ctx);
+	}
+
+	/* Handle errors in the order of nodes. */
 	zone_node_t *last_node = NULL;
-	arg_t arguments;
-	arguments.arg1 = zone;
-	arguments.arg3 = &do_checks;
-	arguments.arg4 = NULL; // UNUSED
-	arguments.arg5 = &last_node;
-	arguments.arg6 = handler;
-	int fatal_error = 0;
-	arguments.arg7 = (void *)&fatal_error;
-
-	int ret = knot_zone_contents_tree_apply_inorder(zone,
-	                                                do_checks_in_tree,
-	                                                &arguments);
+	bool fatal_error = false;
+	for (size_t i = 0; i < ctx.chunk_count; ++i) {
+		sem_chunk_t *chunk = &ctx.chunks[i];
+		sem_errors_flush(&chunk->errors, handler);
+		if (chunk->last_node != NULL) {
+			last_node = chunk->last_node;
+		}
+		fatal_error = fatal_error || chunk->fatal_error;
+		if (ret == KNOT_EOK) {
+			ret = chunk->ret;
+		}
+	}
+
+	sem_free_keys(ctx.keys, ctx.key_count);
+	free(ctx.chunks);
+	free(ctx.nodes);
+
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -61,6 +61,7 @@ enum zonechecks_errors {
 	ZC_ERR_RRSIG_OWNER,
 	ZC_ERR_RRSIG_CLASS,
 	ZC_ERR_RRSIG_TTL,
+	ZC_ERR_RRSIG_INVALID,
 
 	ZC_ERR_RRSIG_GENERAL_ERROR, /* RRSIG error delimiter. */
 
@@ -128,6 +129,11 @@ struct handler_options {
 	char log_nsec3; /*!< Log all NSEC3 related semantic errors. */
 };
 
+/*!
+ * \brief Errors recorded for later handling (internal).
+ */
+struct sem_errors;
+
 /*!
  * \brief Structure for handling semantic errors.
  */
@@ -136,6 +142,7 @@ struct err_handler {
 	struct handler_options options; /*!< Handler options. */
 	uint errors[(-ZC_ERR_UNKNOWN) + 1]; /*!< Array with error messages */
 	uint error_count; /*!< Total error count */
+	struct sem_errors *deferred; /*!< Record errors instead of logging. */
 };
 
 typedef struct err_handler err_handler_t;
@@ -195,16 +202,23 @@ void log_cyclic_errors_in_zone(err_handler_t *handler,
 void err_handler_log_all(err_handler_t *handler);
 
 /*!
- * \brief Helper function - wraps its arguments into arg_t structure and
- *        calls function that does the actual work.
+ * \brief Runs semantic checks of the whole zone.
+ *
+ * Nodes of large zones are checked by multiple threads, all per-node checks
+ * including the CNAME/DNAME checks run in the worker threads. Errors are
+ * handled in the canonical order of nodes. Only the NSEC(3) chain cycle
+ * check (log_cyclic_errors_in_zone()) runs serially after the nodes.
  *
  * \param zone Zone to be searched / checked
  * \param check_level Level of semantic checks.
+ * \param verify_rrsig Verify RRSIGs of signed zones using the apex DNSKEYs.
  * \param handler Semantic error handler.
- * \param last_node Last checked node, that is a part of NSEC(3) chain.
+ * \param first_nsec3_node First node in NSEC3 chain.
+ * \param last_nsec3_node Last node in NSEC3 chain.
  */
 int zone_do_sem_checks(knot_zone_contents_t *zone, int check_level,
-                       err_handler_t *handler, zone_node_t *first_nsec3_node,
+                       bool verify_rrsig, err_handler_t *handler,
+                       zone_node_t *first_nsec3_node,
                        zone_node_t *last_nsec3_node);
 
 /*!
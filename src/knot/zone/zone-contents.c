@@ -21,7 +21,6 @@
 #include "libknot/rrset.h"
 #include "common/base32hex.h"
 #include "common/descriptor.h"
-#include "common/hattrie/hat-trie.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/zone/zone-tree.h"
@@ -680,7 +679,7 @@ static int insert_rr(knot_zone_contents_t *z,
 static int recreate_normal_tree(const knot_zone_contents_t *z,
                                 knot_zone_contents_t *out)
 {
-	out->nodes = hattrie_dup(z->nodes, NULL);
+	out->nodes = knot_zone_tree_create();
 	if (out->nodes == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -700,33 +699,33 @@ static int recreate_normal_tree(const knot_zone_contents_t *z,
 
 	out->apex = apex_cpy;
 
-	hattrie_iter_t *itt = hattrie_iter_begin(z->nodes, true);
+	knot_zone_tree_it_t *itt = knot_zone_tree_it_begin(z->nodes, true);
 	if (itt == NULL) {
 		return KNOT_ENOMEM;
 	}
-	while (!hattrie_iter_finished(itt)) {
-		const zone_node_t *to_cpy = (zone_node_t *)*hattrie_iter_val(itt);
+	while (!knot_zone_tree_it_finished(itt)) {
+		const zone_node_t *to_cpy = knot_zone_tree_it_val(itt);
 		if (to_cpy == z->apex) {
 			// Inserted already.
-			hattrie_iter_next(itt);
+			knot_zone_tree_it_next(itt);
 			continue;
 		}
 		zone_node_t *to_add = node_shallow_copy(to_cpy);
 		if (to_add == NULL) {
-			hattrie_iter_free(itt);
+			knot_zone_tree_it_free(itt);
 			return KNOT_ENOMEM;
 		}
 		int ret = knot_zone_contents_add_node(out, to_add, true);
 		if (ret != KNOT_EOK) {
 			node_free(&to_add);
-			hattrie_iter_free(itt);
+			knot_zone_tree_it_free(itt);
 			return ret;
 		}
-		hattrie_iter_next(itt);
+		knot_zone_tree_it_next(itt);
 	}
 
-	hattrie_iter_free(itt);
-	hattrie_build_index(out->nodes);
+	knot_zone_tree_it_free(itt);
+	knot_zone_tree_build_index(out->nodes);
 
 	return KNOT_EOK;
 }
@@ -734,33 +733,33 @@ static int recreate_normal_tree(const knot_zone_contents_t *z,
 static int recreate_nsec3_tree(const knot_zone_contents_t *z,
                                knot_zone_contents_t *out)
 {
-	out->nsec3_nodes = hattrie_dup(z->nsec3_nodes, NULL);
+	out->nsec3_nodes = knot_zone_tree_create();
 	if (out->nsec3_nodes == NULL) {
 		return KNOT_ENOMEM;
 	}
 
-	hattrie_iter_t *itt = hattrie_iter_begin(z->nsec3_nodes, false);
+	knot_zone_tree_it_t *itt = knot_zone_tree_it_begin(z->nsec3_nodes, false);
 	if (itt == NULL) {
 		return KNOT_ENOMEM;
 	}
-	while (!hattrie_iter_finished(itt)) {
-		const zone_node_t *to_cpy = (zone_node_t *)*hattrie_iter_val(itt);
+	while (!knot_zone_tree_it_finished(itt)) {
+		const zone_node_t *to_cpy = knot_zone_tree_it_val(itt);
 		zone_node_t *to_add = node_shallow_copy(to_cpy);
 		if (to_add == NULL) {
-			hattrie_iter_free(itt);
+			knot_zone_tree_it_free(itt);
 			return KNOT_ENOMEM;
 		}
 		int ret = knot_zone_contents_add_nsec3_node(out, to_add);
 		if (ret != KNOT_EOK) {
-			hattrie_iter_free(itt);
+			knot_zone_tree_it_free(itt);
 			node_free(&to_add);
 			return ret;
 		}
-		hattrie_iter_next(itt);
+		knot_zone_tree_it_next(itt);
 	}
 
-	hattrie_iter_free(itt);
-	hattrie_build_index(out->nsec3_nodes);
+	knot_zone_tree_it_free(itt);
+	knot_zone_tree_build_index(out->nsec3_nodes);
 
 	return KNOT_EOK;
 }
@@ -1103,7 +1102,7 @@ static int knot_zone_contents_adjust_nodes(knot_zone_tree_t *nodes,
 	adjust_arg->first_node = NULL;
 	adjust_arg->previous_node = NULL;
 
-	hattrie_build_index(nodes);
+	knot_zone_tree_build_index(nodes);
 	int result = knot_zone_tree_apply_inorder(nodes, callback, adjust_arg);
 
 	if (adjust_arg->first_node) {
@@ -242,6 +242,7 @@ int zonefile_open(zloader_t *loader, const conf_zone_t *conf)
 	loader->origin = strdup(conf->name);
 	loader->creator = zc;
 	loader->semantic_checks = conf->enable_checks;
+	loader->verify_rrsig = conf->verify_rrsig;
 
 	return KNOT_EOK;
 }
@@ -308,7 +309,7 @@ knot_zone_contents_t *zonefile_load(zloader_t *loader)
 		}
 		err_handler_t err_handler;
 		err_handler_init(&err_handler);
-		zone_do_sem_checks(zc->z, check_level,
+		zone_do_sem_checks(zc->z, check_level, loader->verify_rrsig,
 		                   &err_handler, first_nsec3_node,
 		                   last_nsec3_node);
 		char *zname = knot_dname_to_str(soa_rr.owner);
@@ -49,6 +49,7 @@ typedef struct zloader_t {
 	char *source;                /*!< Zone source file. */
 	char *origin;                /*!< Zone's origin string. */
 	bool semantic_checks;        /*!< Do semantic checks. */
+	bool verify_rrsig;           /*!< Verify RRSIGs in semantic checks. */
 	err_handler_t *err_handler;  /*!< Semantic checks error handler. */
 	zs_loader_t *file_loader;    /*!< Scanner's file loader. */
 	zcreator_t *creator;         /*!< Loader context. */
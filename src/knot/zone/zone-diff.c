@@ -21,20 +21,12 @@
 #include "common/debug.h"
 #include "common/errcode.h"
 #include "knot/zone/zone-diff.h"
+#include "knot/server/dthreads.h"
 #include "common/descriptor.h"
+#include "libknot/common.h"
 #include "libknot/util/utils.h"
 #include "libknot/rdata/soa.h"
 
-struct zone_diff_param {
-	knot_zone_tree_t *nodes;
-	knot_changeset_t *changeset;
-};
-
-// forward declaration
-static int knot_zone_diff_rdata(const knot_rrset_t *rrset1,
-                                const knot_rrset_t *rrset2,
-                                knot_changeset_t *changeset);
-
 static int knot_zone_diff_load_soas(const knot_zone_contents_t *zone1,
                                     const knot_zone_contents_t *zone2,
                                     knot_changeset_t *changeset)
@@ -92,90 +84,93 @@ static int knot_zone_diff_load_soas(const knot_zone_contents_t *zone1,
 	return KNOT_EOK;
 }
 
-/*!< \todo Only use add or remove function, not both as they are the same. */
-/*!< \todo Also, this might be all handled by function in changesets.h!!! */
-static int knot_zone_diff_changeset_add_rrset(knot_changeset_t *changeset,
-                                              const knot_rrset_t *rrset)
-{
-	/* Remove all RRs of the RRSet. */
-	if (changeset == NULL || rrset == NULL) {
-		dbg_zonediff("zone_diff: add_rrset: NULL parameters.\n");
-		return KNOT_EINVAL;
-	}
+/*! \brief Minimal number of nodes to diff zone trees in parallel. */
+#define ZONE_DIFF_PARALLEL_MIN 65536
 
-	if (rrset->rrs.rr_count == 0) {
-		dbg_zonediff_detail("zone_diff: Nothing to add.\n");
-		return KNOT_EOK;
-	}
+/*! \brief Number of key ranges per diffing thread, for even load. */
+#define ZONE_DIFF_RANGES_PER_THREAD 4
 
-	knot_rrset_t *rrset_copy = knot_rrset_copy(rrset, NULL);
-	if (rrset_copy == NULL) {
-		dbg_zonediff("zone_diff: add_rrset: Cannot copy RRSet.\n");
-		return KNOT_ENOMEM;
-	}
+/*! \brief Change found by the diff, added to the changeset afterwards. */
+typedef struct {
+	knot_rrset_t *rrset;
+	knot_changeset_part_t part;
+} zone_diff_change_t;
 
-	int ret = knot_changeset_add_rrset(changeset, rrset_copy,
-	                                   KNOT_CHANGESET_ADD);
-	if (ret != KNOT_EOK) {
-		/* We have to free the copy now! */
-		knot_rrset_free(&rrset_copy, NULL);
-		dbg_zonediff("zone_diff: add_rrset: Could not add RRSet. "
-		             "Reason: %s.\n", knot_strerror(ret));
-		return ret;
-	}
-
-	return KNOT_EOK;
-}
-
-static int knot_zone_diff_changeset_remove_rrset(knot_changeset_t *changeset,
-                                                 const knot_rrset_t *rrset)
+/*!
+ * \brief Range of both trees diffed at once.
+ *
+ * Nodes of the second tree in the range are those not preceding the first
+ * node of the range in the first tree, and preceding the first node of the
+ * next range.
+ */
+typedef struct {
+	size_t from1, to1;
+	size_t from2, to2;
+	zone_diff_change_t *changes;
+	size_t count;
+	size_t size;
+	int result;
+} zone_diff_range_t;
+
+/*! \brief Context of the tree diff shared by the diffing threads. */
+typedef struct {
+	zone_node_t **nodes1;   /*!< First tree in canonical order. */
+	zone_node_t **nodes2;   /*!< Second tree in canonical order. */
+	zone_diff_range_t *ranges;
+	size_t range_count;
+	size_t next;            /*!< Next unclaimed range. */
+} zone_diff_ctx_t;
+
+/*!
+ * \brief Store a copy of the RR set as a change of the range.
+ */
+static int knot_zone_diff_store(zone_diff_range_t *range,
+                                const knot_rrset_t *rrset,
+                                knot_changeset_part_t part)
 {
-	/* Remove all RRs of the RRSet. */
-	if (changeset == NULL) {
-		dbg_zonediff("zone_diff: remove_rrset: NULL parameters.\n");
-		return KNOT_EINVAL;
-	}
+	assert(range);
+	assert(rrset);
 
-	if (rrset == NULL) {
+	if (rrset->rrs.rr_count == 0) {
+		dbg_zonediff_detail("zone_diff: Nothing to store.\n");
 		return KNOT_EOK;
 	}
 
-	if (rrset->rrs.rr_count == 0) {
-		/* RDATA are the same, however*/
-		dbg_zonediff_detail("zone_diff: Nothing to remove.\n");
-		return KNOT_EOK;
+	if (range->count == range->size) {
+		size_t size = range->size > 0 ? 2 * range->size : 64;
+		zone_diff_change_t *changes = realloc(range->changes,
+		                                      size * sizeof(*changes));
+		if (changes == NULL) {
+			return KNOT_ENOMEM;
+		}
+		range->changes = changes;
+		range->size = size;
 	}
 
 	knot_rrset_t *rrset_copy = knot_rrset_copy(rrset, NULL);
 	if (rrset_copy == NULL) {
-		dbg_zonediff("zone_diff: remove_rrset: Cannot copy RRSet.\n");
+		dbg_zonediff("zone_diff: store: Cannot copy RRSet.\n");
 		return KNOT_ENOMEM;
 	}
 
-	int ret = knot_changeset_add_rrset(changeset, rrset_copy,
-	                                   KNOT_CHANGESET_REMOVE);
-	if (ret != KNOT_EOK) {
-		/* We have to free the copy now. */
-		knot_rrset_free(&rrset_copy, NULL);
-		dbg_zonediff("zone_diff: remove_rrset: Could not remove RRSet. "
-		             "Reason: %s.\n", knot_strerror(ret));
-		return ret;
-	}
+	range->changes[range->count].rrset = rrset_copy;
+	range->changes[range->count].part = part;
+	range->count += 1;
 
 	return KNOT_EOK;
 }
 
-static int knot_zone_diff_add_node(const zone_node_t *node,
-                                   knot_changeset_t *changeset)
+static int knot_zone_diff_store_node(zone_diff_range_t *range,
+                                     const zone_node_t *node,
+                                     knot_changeset_part_t part)
 {
-	/* Add all rrsets from node. */
+	/* Add or remove all RRSets of the node. */
 	for (uint i = 0; i < node->rrset_count; i++) {
 		knot_rrset_t rrset = node_rrset_at(node, i);
-		int ret = knot_zone_diff_changeset_add_rrset(changeset,
-		                                             &rrset);
+		int ret = knot_zone_diff_store(range, &rrset, part);
 		if (ret != KNOT_EOK) {
-			dbg_zonediff("zone_diff: add_node: Cannot add RRSet (%s).\n",
-			       knot_strerror(ret));
+			dbg_zonediff("zone_diff: store_node: Cannot store RRSet "
+			             "(%s).\n", knot_strerror(ret));
 			return ret;
 		}
 	}
@@ -183,343 +178,373 @@ static int knot_zone_diff_add_node(const zone_node_t *node,
 	return KNOT_EOK;
 }
 
-static int knot_zone_diff_remove_node(knot_changeset_t *changeset,
-                                                const zone_node_t *node)
-{
-	/* Remove all the RRSets of the node. */
-	for (uint i = 0; i < node->rrset_count; i++) {
-		knot_rrset_t rrset = node_rrset_at(node, i);
-		int ret = knot_zone_diff_changeset_remove_rrset(changeset,
-		                                                &rrset);
-		if (ret != KNOT_EOK) {
-			dbg_zonediff("zone_diff: remove_node: Failed to "
-			             "remove rrset. Error: %s\n",
-			             knot_strerror(ret));
-			return ret;
-		}
-	}
-
-	return KNOT_EOK;
-}
-
-static bool rr_exists(const knot_rrset_t *in, const knot_rrset_t *ref,
-                      size_t ref_pos)
-{
-	knot_rdata_t *to_check = knot_rdataset_at(&ref->rrs, ref_pos);
-	const bool compare_ttls = true;
-	return knot_rdataset_member(&in->rrs, to_check, compare_ttls);
-}
-
-static int knot_zone_diff_rdata_return_changes(const knot_rrset_t *rrset1,
-                                               const knot_rrset_t *rrset2,
-                                               knot_rrset_t **changes)
+/*!
+ * \brief Add RR into the RR set with changes, create the RR set if needed.
+ */
+static int knot_zone_diff_rr(knot_rrset_t **changes, const knot_rrset_t *rrset,
+                             const knot_rdata_t *rr)
 {
-	if (rrset1 == NULL || rrset2 == NULL) {
-		dbg_zonediff("zone_diff: diff_rdata: NULL arguments. (%p) (%p).\n",
-		       rrset1, rrset2);
-		return KNOT_EINVAL;
-	}
-
-	/*
-	* Take one rdata from first list and search through the second list
-	* looking for an exact match. If no match occurs, it means that this
-	* particular RR has changed.
-	* After the list has been traversed, we have a list of
-	* changed/removed rdatas. This has awful computation time.
-	*/
-	/* Create fake RRSet, it will be easier to handle. */
-
-	*changes = knot_rrset_new(rrset1->owner, rrset1->type,
-	                          rrset1->rclass, NULL);
 	if (*changes == NULL) {
-		dbg_zonediff("zone_diff: diff_rdata: "
-		             "Could not create RRSet with changes.\n");
-		return KNOT_ENOMEM;
-	}
-
-	const rdata_descriptor_t *desc =
-		get_rdata_descriptor(rrset1->type);
-	assert(desc);
-
-	uint16_t rr1_count = rrset1->rrs.rr_count;
-	for (uint16_t i = 0; i < rr1_count; ++i) {
-		if (!rr_exists(rrset2, rrset1, i)) {
-			/*
-			 * No such RR is present in 'rrset2'. We'll copy
-			 * index 'i' into 'changes' RRSet.
-			 */
-			knot_rdata_t *add_rr = knot_rdataset_at(&rrset1->rrs, i);
-			int ret = knot_rdataset_add(&(*changes)->rrs, add_rr, NULL);
-			if (ret != KNOT_EOK) {
-				knot_rrset_free(changes, NULL);
-				return ret;
-			}
+		*changes = knot_rrset_new(rrset->owner, rrset->type,
+		                          rrset->rclass, NULL);
+		if (*changes == NULL) {
+			return KNOT_ENOMEM;
 		}
 	}
 
-	return KNOT_EOK;
+	/* RRs come in canonical order, each one is appended. */
+	return knot_rdataset_add(&(*changes)->rrs, rr, NULL);
 }
 
+/*!
+ * \brief Diff records of two RR sets of the same type.
+ *
+ * Both RR sets are sorted by RDATA, so a single merge pass finds the RRs
+ * that were removed and those that were added. An RR with changed TTL is
+ * both removed and added.
+ */
 static int knot_zone_diff_rdata(const knot_rrset_t *rrset1,
                                 const knot_rrset_t *rrset2,
-                                knot_changeset_t *changeset)
+                                zone_diff_range_t *range)
 {
-	if ((changeset == NULL) || (rrset1 == NULL && rrset2 == NULL)) {
-		dbg_zonediff("zone_diff: diff_rdata: NULL arguments.\n");
-		return KNOT_EINVAL;
-	}
-	/*
-	 * The easiest solution is to remove all the RRs that had no match and
-	 * to add all RRs that had no match, but those from second RRSet. */
+	assert(rrset1);
+	assert(rrset2);
+	assert(range);
 
-	/* Get RRs to remove from zone. */
 	knot_rrset_t *to_remove = NULL;
-	if (rrset1 != NULL && rrset2 != NULL) {
-		int ret = knot_zone_diff_rdata_return_changes(rrset1, rrset2,
-		                                              &to_remove);
-		if (ret != KNOT_EOK) {
-			dbg_zonediff("zone_diff: diff_rdata: Could not get changes. "
-			             "Error: %s.\n", knot_strerror(ret));
-			return ret;
+	knot_rrset_t *to_add = NULL;
+	const knot_rdataset_t *rrs1 = &rrset1->rrs;
+	const knot_rdataset_t *rrs2 = &rrset2->rrs;
+
+	int ret = KNOT_EOK;
+	uint16_t i = 0, j = 0;
+	while (ret == KNOT_EOK && (i < rrs1->rr_count || j < rrs2->rr_count)) {
+		const knot_rdata_t *rr1 = i < rrs1->rr_count ?
+		                          knot_rdataset_at(rrs1, i) : NULL;
+		const knot_rdata_t *rr2 = j < rrs2->rr_count ?
+		                          knot_rdataset_at(rrs2, j) : NULL;
+
+		int cmp = 0;
+		if (rr1 == NULL) {
+			cmp = 1;
+		} else if (rr2 == NULL) {
+			cmp = -1;
+		} else {
+			cmp = knot_rdata_cmp(rr1, rr2);
+		}
+
+		if (cmp < 0) {
+			ret = knot_zone_diff_rr(&to_remove, rrset1, rr1);
+			i++;
+		} else if (cmp > 0) {
+			ret = knot_zone_diff_rr(&to_add, rrset2, rr2);
+			j++;
+		} else {
+			if (knot_rdata_ttl(rr1) != knot_rdata_ttl(rr2)) {
+				ret = knot_zone_diff_rr(&to_remove, rrset1, rr1);
+				if (ret == KNOT_EOK) {
+					ret = knot_zone_diff_rr(&to_add, rrset2, rr2);
+				}
+			}
+			i++;
+			j++;
 		}
 	}
 
-	int ret = knot_zone_diff_changeset_remove_rrset(changeset,
-	                                            to_remove);
-	if (ret != KNOT_EOK) {
-		knot_rrset_free(&to_remove, NULL);
-		dbg_zonediff("zone_diff: diff_rdata: Could not remove RRs. "
-		             "Error: %s.\n", knot_strerror(ret));
-		return ret;
+	if (ret == KNOT_EOK && to_remove != NULL) {
+		ret = knot_zone_diff_store(range, to_remove,
+		                           KNOT_CHANGESET_REMOVE);
+	}
+	if (ret == KNOT_EOK && to_add != NULL) {
+		ret = knot_zone_diff_store(range, to_add, KNOT_CHANGESET_ADD);
 	}
 
-	/* Copy was made in add_rrset function, we can free now. */
+	/* Copies were stored, we can free now. */
 	knot_rrset_free(&to_remove, NULL);
+	knot_rrset_free(&to_add, NULL);
 
-	/* Get RRs to add to zone. */ // TODO move to extra function, same for remove
-	knot_rrset_t *to_add = NULL;
-	if (rrset1 != NULL && rrset2 != NULL) {
-		ret = knot_zone_diff_rdata_return_changes(rrset2, rrset1,
-		                                          &to_add);
-		if (ret != KNOT_EOK) {
-			dbg_zonediff("zone_diff: diff_rdata: Could not get changes. "
-			             "Error: %s.\n", knot_strerror(ret));
-			return ret;
-		}
-	}
-
-	ret = knot_zone_diff_changeset_add_rrset(changeset,
-	                                         to_add);
 	if (ret != KNOT_EOK) {
-		knot_rrset_free(&to_add, NULL);
-		dbg_zonediff("zone_diff: diff_rdata: Could not remove RRs. "
+		dbg_zonediff("zone_diff: diff_rdata: Could not store changes. "
 		             "Error: %s.\n", knot_strerror(ret));
-		return ret;
 	}
 
-	/* Copy was made in add_rrset function, we can free now. */
-	knot_rrset_free(&to_add, NULL);
-
-	return KNOT_EOK;
-}
-
-static int knot_zone_diff_rrsets(const knot_rrset_t *rrset1,
-                                 const knot_rrset_t *rrset2,
-                                 knot_changeset_t *changeset)
-{
-	/* RRs (=rdata) have to be cross-compared, unfortunalely. */
-	return knot_zone_diff_rdata(rrset1, rrset2, changeset);
+	return ret;
 }
 
-/*!< \todo this could be generic function for adding / removing. */
-static int knot_zone_diff_node(zone_node_t **node_ptr, void *data)
+/*!
+ * \brief Diff two nodes with the same owner.
+ */
+static int knot_zone_diff_node(const zone_node_t *node1,
+                               const zone_node_t *node2,
+                               zone_diff_range_t *range)
 {
-	if (node_ptr == NULL || *node_ptr == NULL || data == NULL) {
-		dbg_zonediff("zone_diff: diff_node: NULL arguments.\n");
-		return KNOT_EINVAL;
-	}
+	for (uint i = 0; i < node1->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node1, i);
 
-	zone_node_t *node = *node_ptr;
+		/* SOAs are handled explicitely. */
+		if (rrset.type == KNOT_RRTYPE_SOA) {
+			continue;
+		}
 
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		dbg_zonediff("zone_diff: diff_node: NULL arguments.\n");
-		return KNOT_EINVAL;
+		int ret = KNOT_EOK;
+		knot_rrset_t rrset2 = node_rrset(node2, rrset.type);
+		if (knot_rrset_empty(&rrset2)) {
+			/* RRSet has been removed. */
+			ret = knot_zone_diff_store(range, &rrset,
+			                           KNOT_CHANGESET_REMOVE);
+		} else {
+			ret = knot_zone_diff_rdata(&rrset, &rrset2, range);
+		}
+		if (ret != KNOT_EOK) {
+			dbg_zonediff("zone_diff: diff_node: "
+			             "Failed to diff RRSet.\n");
+			return ret;
+		}
 	}
 
-	/*
-	 * First, we have to search the second tree to see if there's according
-	 * node, if not, the whole node has been removed.
-	 */
-	const zone_node_t *node_in_second_tree = NULL;
-	const knot_dname_t *node_owner = node->owner;
-	assert(node_owner);
+	for (uint i = 0; i < node2->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node2, i);
 
-	knot_zone_tree_find(param->nodes, node_owner, &node_in_second_tree);
+		/* SOAs are handled explicitely, others already diffed. */
+		if (rrset.type == KNOT_RRTYPE_SOA ||
+		    node_rrtype_exists(node1, rrset.type)) {
+			continue;
+		}
 
-	if (node_in_second_tree == NULL) {
-		dbg_zonediff_detail("zone_diff: diff_node: Node %p is not "
-		              "in the second tree.\n",
-		              node_owner);
-		int ret = knot_zone_diff_remove_node(param->changeset,
-		                                               node);
+		/* RRSet has been added. */
+		int ret = knot_zone_diff_store(range, &rrset,
+		                               KNOT_CHANGESET_ADD);
 		if (ret != KNOT_EOK) {
-			dbg_zonediff("zone_diff: failed to remove node.\n");
+			dbg_zonediff("zone_diff: diff_node: "
+			             "Failed to add RRSet.\n");
+			return ret;
 		}
-		return ret;
 	}
 
-	assert(node_in_second_tree != node);
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Diff a range of both trees by a merge of the sorted node sequences.
+ */
+static int knot_zone_diff_range(zone_node_t **nodes1, zone_node_t **nodes2,
+                                zone_diff_range_t *range)
+{
+	size_t i = range->from1, j = range->from2;
+	while (i < range->to1 || j < range->to2) {
+		int cmp = 0;
+		if (i == range->to1) {
+			cmp = 1;
+		} else if (j == range->to2) {
+			cmp = -1;
+		} else {
+			cmp = knot_dname_cmp(nodes1[i]->owner, nodes2[j]->owner);
+		}
 
-	dbg_zonediff_detail("zone_diff: diff_node: Node %p is present in "
-	              "both trees.\n", node_owner);
-	/* The nodes are in both trees, we have to diff each RRSet. */
-	if (node->rrset_count == 0) {
-		dbg_zonediff("zone_diff: Node in first tree has no RRSets.\n");
-		/*
-		 * If there are no RRs in the first tree, all of the RRs
-		 * in the second tree will have to be inserted to ADD section.
-		 */
-		int ret = knot_zone_diff_add_node(node_in_second_tree,
-		                                  param->changeset);
+		int ret = KNOT_EOK;
+		if (cmp < 0) {
+			/* The whole node has been removed. */
+			ret = knot_zone_diff_store_node(range, nodes1[i++],
+			                                KNOT_CHANGESET_REMOVE);
+		} else if (cmp > 0) {
+			/* The whole node has been added. */
+			ret = knot_zone_diff_store_node(range, nodes2[j++],
+			                                KNOT_CHANGESET_ADD);
+		} else {
+			ret = knot_zone_diff_node(nodes1[i++], nodes2[j++], range);
+		}
 		if (ret != KNOT_EOK) {
-			dbg_zonediff("zone_diff: diff_node: "
-			             "Could not add node from second tree. "
-			             "Reason: %s.\n", knot_strerror(ret));
+			return ret;
 		}
-		return ret;
 	}
 
-	for (uint i = 0; i < node->rrset_count; i++) {
-		/* Search for the RRSet in the node from the second tree. */
-		knot_rrset_t rrset = node_rrset_at(node, i);
+	return KNOT_EOK;
+}
 
-		/* SOAs are handled explicitely. */
-		if (rrset.type == KNOT_RRTYPE_SOA) {
-			continue;
+static int knot_zone_diff_thread(dthread_t *thread)
+{
+	zone_diff_ctx_t *ctx = thread->data;
+
+	for (;;) {
+		size_t i = __sync_fetch_and_add(&ctx->next, 1);
+		if (i >= ctx->range_count) {
+			break;
 		}
+		zone_diff_range_t *range = &ctx->ranges[i];
+		range->result = knot_zone_diff_range(ctx->nodes1, ctx->nodes2,
+		                                     range);
+	}
 
-		knot_rrset_t rrset_from_second_node = node_rrset(node_in_second_tree, rrset.type);
-		if (knot_rrset_empty(&rrset_from_second_node)) {
-			/* RRSet has been removed. Make a copy and remove. */
-			int ret = knot_zone_diff_changeset_remove_rrset(
-				param->changeset,
-				&rrset);
-			if (ret != KNOT_EOK) {
-				dbg_zonediff("zone_diff: diff_node: "
-				             "Failed to remove RRSet.\n");
-				return ret;
-			}
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Find first node not preceding the owner (nodes are sorted).
+ */
+static size_t knot_zone_diff_lower_bound(zone_node_t **nodes, size_t count,
+                                         const knot_dname_t *owner)
+{
+	size_t from = 0, to = count;
+	while (from < to) {
+		size_t mid = from + (to - from) / 2;
+		if (knot_dname_cmp(nodes[mid]->owner, owner) < 0) {
+			from = mid + 1;
 		} else {
-			/* Diff RRSets. */
-			int ret = knot_zone_diff_rrsets(&rrset,
-			                                &rrset_from_second_node,
-			                                param->changeset);
-			if (ret != KNOT_EOK) {
-				dbg_zonediff("zone_diff: "
-				             "Failed to diff RRSets.\n");
-				return ret;
-			}
+			to = mid;
 		}
 	}
 
-	for (uint i = 0; i < node_in_second_tree->rrset_count; i++) {
-		/* Search for the RRSet in the node from the second tree. */
-		knot_rrset_t rrset = node_rrset_at(node_in_second_tree, i);
+	return from;
+}
 
-		/* SOAs are handled explicitely. */
-		if (rrset.type == KNOT_RRTYPE_SOA) {
-			continue;
-		}
+/*!
+ * \brief Split the trees into key ranges, one per thread-claimed chunk.
+ */
+static int knot_zone_diff_split(zone_diff_ctx_t *ctx, size_t count1,
+                                size_t count2, size_t range_count)
+{
+	ctx->ranges = calloc(range_count, sizeof(zone_diff_range_t));
+	if (ctx->ranges == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ctx->range_count = range_count;
 
-		knot_rrset_t rrset_from_first_node = node_rrset(node, rrset.type);
-		if (knot_rrset_empty(&rrset_from_first_node)) {
-			/* RRSet has been added. Make a copy and add. */
-			int ret = knot_zone_diff_changeset_add_rrset(
-				param->changeset,
-				&rrset);
-			if (ret != KNOT_EOK) {
-				dbg_zonediff("zone_diff: diff_node: "
-				             "Failed to add RRSet.\n");
-				return ret;
-			}
+	for (size_t i = 0; i < range_count; ++i) {
+		zone_diff_range_t *range = &ctx->ranges[i];
+		range->from1 = count1 * i / range_count;
+		range->to1 = count1 * (i + 1) / range_count;
+		if (i == 0) {
+			range->from2 = 0;
+		} else {
+			range->from2 = ctx->ranges[i - 1].to2;
+		}
+		if (i + 1 == range_count) {
+			range->to2 = count2;
 		} else {
-			/* Already handled. */
-			;
+			range->to2 = knot_zone_diff_lower_bound(ctx->nodes2, count2,
+			                                        ctx->nodes1[range->to1]->owner);
 		}
 	}
 
 	return KNOT_EOK;
 }
 
-/*!< \todo possibly not needed! */
-static int knot_zone_diff_add_new_nodes(zone_node_t **node_ptr, void *data)
+/*!
+ * \brief Collect tree nodes in canonical order.
+ */
+static int knot_zone_diff_collect(const knot_zone_tree_t *tree,
+                                  zone_node_t ***nodes, size_t *count)
 {
-	if (node_ptr == NULL || *node_ptr == NULL || data == NULL) {
-		dbg_zonediff("zone_diff: add_new_nodes: NULL arguments.\n");
-		return KNOT_EINVAL;
-	}
+	*nodes = NULL;
+	*count = 0;
 
-	zone_node_t *node = *node_ptr;
-
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		dbg_zonediff("zone_diff: add_new_nodes: NULL arguments.\n");
-		return KNOT_EINVAL;
+	if (knot_zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
 	}
 
-	/*
-	* If a node is not present in the second zone, it is a new node
-	* and has to be added to changeset. Differencies on the RRSet level are
-	* already handled.
-	*/
+	size_t weight = knot_zone_tree_weight(tree);
+	*nodes = malloc(weight * sizeof(zone_node_t *));
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(tree, true);
+	if (*nodes == NULL || it == NULL) {
+		free(*nodes);
+		*nodes = NULL;
+		knot_zone_tree_it_free(it);
+		return KNOT_ENOMEM;
+	}
 
-	const knot_dname_t *node_owner = node->owner;
-	/*
-	 * Node should definitely have an owner, otherwise it would not be in
-	 * the tree.
-	 */
-	assert(node_owner);
+	while (!knot_zone_tree_it_finished(it)) {
+		assert(*count < weight);
+		(*nodes)[(*count)++] = knot_zone_tree_it_val(it);
+		knot_zone_tree_it_next(it);
+	}
 
-	zone_node_t *new_node = NULL;
-	knot_zone_tree_get(param->nodes, node_owner, &new_node);
+	knot_zone_tree_it_free(it);
 
-	int ret = KNOT_EOK;
+	return KNOT_EOK;
+}
 
-	if (!new_node) {
-		assert(node);
-		ret = knot_zone_diff_add_node(node, param->changeset);
-		if (ret != KNOT_EOK) {
-			dbg_zonediff("zone_diff: add_new_nodes: Cannot add "
-			             "node: %p to changeset. Reason: %s.\n",
-			             node->owner,
-			             knot_strerror(ret));
+/*!
+ * \brief Diff the ranges, in parallel for large trees.
+ */
+static void knot_zone_diff_ranges(zone_diff_ctx_t *ctx)
+{
+	if (ctx->range_count > 1) {
+		size_t thread_count = MIN(ctx->range_count, dt_optimal_size());
+		dt_unit_t *unit = dt_create(thread_count, &knot_zone_diff_thread,
+		                            NULL, ctx);
+		if (unit != NULL) {
+			dt_start(unit);
+			dt_join(unit);
+			dt_delete(&unit);
+			return;
 		}
 	}
 
-	return ret;
+	/* Small trees or no threads available. */
+	for (size_t i = 0; i < ctx->range_count; ++i) {
+		zone_diff_range_t *range = &ctx->ranges[i];
+		range->result = knot_zone_diff_range(ctx->nodes1, ctx->nodes2,
+		                                     range);
+	}
 }
 
-static int knot_zone_diff_load_trees(knot_zone_tree_t *nodes1,
-				     knot_zone_tree_t *nodes2,
-				     knot_changeset_t *changeset)
+/*!
+ * \brief Diff two zone trees into the changeset.
+ *
+ * Both trees are merged as sorted node sequences. Large trees are split into
+ * key ranges diffed by a pool of threads, the changes are then added to the
+ * changeset in canonical order.
+ *
+ * \param parallel  Allow diffing of large trees in parallel.
+ */
+static int knot_zone_diff_trees(knot_zone_tree_t *nodes1,
+                                knot_zone_tree_t *nodes2,
+                                knot_changeset_t *changeset, bool parallel)
 {
 	assert(changeset);
 
-	struct zone_diff_param param = { 0 };
-	param.changeset = changeset;
+	zone_diff_ctx_t ctx = { 0 };
+	size_t count1 = 0, count2 = 0;
+	int result = knot_zone_diff_collect(nodes1, &ctx.nodes1, &count1);
+	if (result == KNOT_EOK) {
+		result = knot_zone_diff_collect(nodes2, &ctx.nodes2, &count2);
+	}
+
+	if (result == KNOT_EOK) {
+		size_t range_count = 1;
+		if (parallel && count1 >= ZONE_DIFF_PARALLEL_MIN) {
+			range_count = dt_optimal_size() * ZONE_DIFF_RANGES_PER_THREAD;
+		}
+		result = knot_zone_diff_split(&ctx, count1, count2, range_count);
+	}
 
-	// Traverse one tree, compare every node, each RRSet with its rdata.
-	param.nodes = nodes2;
-	int result = knot_zone_tree_apply(nodes1, knot_zone_diff_node, &param);
-	if (result != KNOT_EOK) {
-		return result;
+	if (result == KNOT_EOK) {
+		knot_zone_diff_ranges(&ctx);
+	}
+
+	/* Add changes in order, release what was not added. */
+	for (size_t i = 0; i < ctx.range_count; ++i) {
+		zone_diff_range_t *range = &ctx.ranges[i];
+		if (result == KNOT_EOK) {
+			result = range->result;
+		}
+		for (size_t j = 0; j < range->count; ++j) {
+			zone_diff_change_t *change = &range->changes[j];
+			if (result == KNOT_EOK) {
+				result = knot_changeset_add_rrset(changeset,
+				                                  change->rrset,
+				                                  change->part);
+			}
+			if (result != KNOT_EOK) {
+				knot_rrset_free(&change->rrset, NULL);
+			}
+		}
+		free(range->changes);
 	}
 
-	// Some nodes may have been added. Add missing nodes to changeset.
-	param.nodes = nodes1;
-	result = knot_zone_tree_apply(nodes2, knot_zone_diff_add_new_nodes,
-	                              &param);
+	free(ctx.ranges);
+	free(ctx.nodes1);
+	free(ctx.nodes2);
 
 	return result;
 }
@@ -530,12 +555,13 @@ static int knot_zone_diff_load_content(const knot_zone_contents_t *zone1,
 {
 	int result;
 
-	result = knot_zone_diff_load_trees(zone1->nodes, zone2->nodes, changeset);
+	result = knot_zone_diff_trees(zone1->nodes, zone2->nodes, changeset,
+	                              true);
 	if (result != KNOT_EOK)
 		return result;
 
-	result = knot_zone_diff_load_trees(zone1->nsec3_nodes, zone2->nsec3_nodes,
-					   changeset);
+	result = knot_zone_diff_trees(zone1->nsec3_nodes, zone2->nsec3_nodes,
+	                              changeset, true);
 
 	return result;
 }
@@ -583,5 +609,5 @@ int knot_zone_tree_add_diff(knot_zone_tree_t *t1, knot_zone_tree_t *t2,
 		return KNOT_EINVAL;
 	}
 
-	return knot_zone_diff_load_trees(t1, t2, changeset);
+	return knot_zone_diff_trees(t1, t2, changeset, true);
 }
@@ -17,11 +17,52 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "knot/zone/zone-tree.h"
 #include "knot/zone/node.h"
 #include "common/debug.h"
-#include "common/hattrie/hat-trie.h"
+#include "libknot/common.h"
+
+/*----------------------------------------------------------------------------*/
+/* Tree backend, keys are in the lookup format from knot_dname_lf()           */
+/*----------------------------------------------------------------------------*/
+
+#ifdef USE_QP_TRIE
+
+#define tree_create()            trie_create(NULL)
+#define tree_free(t)             trie_free(t)
+#define tree_weight(t)           trie_weight(t)
+#define tree_get_ins(t, lf)      trie_get_ins((t), (lf) + 1, *(lf))
+#define tree_get_try(t, lf)      trie_get_try((t), (lf) + 1, *(lf))
+#define tree_get_leq(t, lf, val) trie_get_leq((t), (lf) + 1, *(lf), (val))
+#define tree_del(t, lf)          trie_del((t), (lf) + 1, *(lf), NULL)
+#define tree_apply(t, f, d)      trie_apply((t), (trie_cb_t)(f), (d))
+#define tree_build_index(t)      /* Always ordered. */
+#define tree_it_begin(t, sorted) trie_it_begin(t)
+#define tree_it_finished(it)     trie_it_finished(it)
+#define tree_it_next(it)         trie_it_next(it)
+#define tree_it_val(it)          trie_it_val(it)
+#define tree_it_free(it)         trie_it_free(it)
+
+#else
+
+#define tree_create()            hattrie_create()
+#define tree_free(t)             hattrie_free(t)
+#define tree_weight(t)           hattrie_weight(t)
+#define tree_get_ins(t, lf)      hattrie_get((t), (char *)(lf) + 1, *(lf))
+#define tree_get_try(t, lf)      hattrie_tryget((t), (char *)(lf) + 1, *(lf))
+#define tree_get_leq(t, lf, val) hattrie_find_leq((t), (char *)(lf) + 1, *(lf), (val))
+#define tree_del(t, lf)          hattrie_del((t), (char *)(lf) + 1, *(lf))
+#define tree_apply(t, f, d)      hattrie_apply_rev((t), (int (*)(value_t*,void*))(f), (d))
+#define tree_build_index(t)      hattrie_build_index(t)
+#define tree_it_begin(t, sorted) hattrie_iter_begin((t), (sorted))
+#define tree_it_finished(it)     hattrie_iter_finished(it)
+#define tree_it_next(it)         hattrie_iter_next(it)
+#define tree_it_val(it)          hattrie_iter_val(it)
+#define tree_it_free(it)         hattrie_iter_free(it)
+
+#endif
 
 /*----------------------------------------------------------------------------*/
 /* API functions                                                              */
@@ -29,14 +70,14 @@
 
 knot_zone_tree_t* knot_zone_tree_create()
 {
-	return hattrie_create();
+	return tree_create();
 }
 
 /*----------------------------------------------------------------------------*/
 
 size_t knot_zone_tree_weight(const knot_zone_tree_t* tree)
 {
-	return hattrie_weight(tree);
+	return tree_weight(tree);
 }
 
 int knot_zone_tree_is_empty(const knot_zone_tree_t *tree)
@@ -56,7 +97,12 @@ int knot_zone_tree_insert(knot_zone_tree_t *tree, zone_node_t *node)
 	uint8_t lf[KNOT_DNAME_MAXLEN];
 	knot_dname_lf(lf, node->owner, NULL);
 
-	*hattrie_get(tree, (char*)lf+1, *lf) = node;
+	void **val = tree_get_ins(tree, lf);
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	*val = node;
 	return KNOT_EOK;
 }
 
@@ -88,7 +134,7 @@ int knot_zone_tree_get(knot_zone_tree_t *tree, const knot_dname_t *owner,
 	uint8_t lf[KNOT_DNAME_MAXLEN];
 	knot_dname_lf(lf, owner, NULL);
 
-	value_t *val = hattrie_tryget(tree, (char*)lf+1, *lf);
+	void **val = tree_get_try(tree, lf);
 	if (val == NULL) {
 		*found = NULL;
 	} else {
@@ -136,8 +182,8 @@ int knot_zone_tree_get_less_or_equal(knot_zone_tree_t *tree,
 	uint8_t lf[KNOT_DNAME_MAXLEN];
 	knot_dname_lf(lf, owner, NULL);
 
-	value_t *fval = NULL;
-	int ret = hattrie_find_leq(tree, (char*)lf+1, *lf, &fval);
+	void **fval = NULL;
+	int ret = tree_get_leq(tree, lf, &fval);
 	if (fval) {
 		*found = (zone_node_t *)(*fval);
 	}
@@ -156,11 +202,11 @@ int knot_zone_tree_get_less_or_equal(knot_zone_tree_t *tree,
 		 * cases like NSEC3, there is no such sort of thing (name wise).
 		 */
 		/*! \todo We could store rightmost node in zonetree probably. */
-		hattrie_iter_t *i = hattrie_iter_begin(tree, 1);
-		*previous = *(zone_node_t **)hattrie_iter_val(i); /* leftmost */
+		knot_zone_tree_it_t *i = knot_zone_tree_it_begin(tree, true);
+		*previous = knot_zone_tree_it_val(i); /* leftmost */
 		*previous = (*previous)->prev; /* rightmost */
 		*found = NULL;
-		hattrie_iter_free(i);
+		knot_zone_tree_it_free(i);
 	}
 
 	/* Previous node for proof must be non-empty and authoritative. */
@@ -192,6 +238,46 @@ dbg_zone_exec_detail(
 
 /*----------------------------------------------------------------------------*/
 
+int knot_zone_tree_get_subtree_last(knot_zone_tree_t *tree,
+                                    const knot_dname_t *owner,
+                                    zone_node_t **found)
+{
+	if (owner == NULL || found == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	*found = NULL;
+	if (knot_zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+
+	/* Keys of descendants are prefixed by the key of the owner,
+	 * the largest possible key in the subtree is padded with 0xff. */
+	uint8_t lf[KNOT_DNAME_MAXLEN + 1];
+	knot_dname_lf(lf, owner, NULL);
+	if (*owner == '\0') {
+		lf[0] = 0; /* Everything is under the root. */
+	}
+	memset(lf + 1 + lf[0], 0xff, KNOT_DNAME_MAXLEN - lf[0]);
+	lf[0] = KNOT_DNAME_MAXLEN;
+
+	void **fval = NULL;
+	tree_get_leq(tree, lf, &fval);
+	if (fval == NULL) {
+		return KNOT_EOK;
+	}
+
+	zone_node_t *node = (zone_node_t *)(*fval);
+	if (knot_dname_is_sub(node->owner, owner) ||
+	    knot_dname_is_equal(node->owner, owner)) {
+		*found = node;
+	}
+
+	return KNOT_EOK;
+}
+
+/*----------------------------------------------------------------------------*/
+
 int knot_zone_tree_remove(knot_zone_tree_t *tree,
                             const knot_dname_t *owner,
                           zone_node_t **removed)
@@ -207,7 +293,7 @@ int knot_zone_tree_remove(knot_zone_tree_t *tree,
 	uint8_t lf[KNOT_DNAME_MAXLEN];
 	knot_dname_lf(lf, owner, NULL);
 
-	value_t *rval = hattrie_tryget(tree, (char*)lf+1, *lf);
+	void **rval = tree_get_try(tree, lf);
 	if (rval == NULL) {
 		return KNOT_ENOENT;
 	} else {
@@ -215,7 +301,7 @@ int knot_zone_tree_remove(knot_zone_tree_t *tree,
 	}
 
 
-	hattrie_del(tree, (char*)lf+1, *lf);
+	tree_del(tree, lf);
 	return KNOT_EOK;
 }
 
@@ -235,15 +321,15 @@ int knot_zone_tree_apply_inorder(knot_zone_tree_t *tree,
 
 	int result = KNOT_EOK;
 
-	hattrie_iter_t *i = hattrie_iter_begin(tree, 1);
-	while(!hattrie_iter_finished(i)) {
-		result = function((zone_node_t **)hattrie_iter_val(i), data);
+	knot_zone_tree_it_t *i = tree_it_begin(tree, true);
+	while(!tree_it_finished(i)) {
+		result = function((zone_node_t **)tree_it_val(i), data);
 		if (result != KNOT_EOK) {
 			break;
 		}
-		hattrie_iter_next(i);
+		tree_it_next(i);
 	}
-	hattrie_iter_free(i);
+	tree_it_free(i);
 
 	return result;
 }
@@ -262,7 +348,7 @@ int knot_zone_tree_apply(knot_zone_tree_t *tree,
 		return KNOT_EOK;
 	}
 
-	return hattrie_apply_rev(tree, (int (*)(value_t*,void*))function, data);
+	return tree_apply(tree, function, data);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -272,7 +358,7 @@ void knot_zone_tree_free(knot_zone_tree_t **tree)
 	if (tree == NULL || *tree == NULL) {
 		return;
 	}
-	hattrie_free(*tree);
+	tree_free(*tree);
 	*tree = NULL;
 }
 
@@ -296,3 +382,50 @@ void knot_zone_tree_deep_free(knot_zone_tree_t **tree)
 	knot_zone_tree_apply(*tree, knot_zone_tree_free_node, NULL);
 	knot_zone_tree_free(tree);
 }
+
+/*----------------------------------------------------------------------------*/
+
+void knot_zone_tree_build_index(knot_zone_tree_t *tree)
+{
+	if (tree == NULL) {
+		return;
+	}
+
+	tree_build_index(tree);
+}
+
+/*----------------------------------------------------------------------------*/
+
+knot_zone_tree_it_t *knot_zone_tree_it_begin(const knot_zone_tree_t *tree,
+                                             bool sorted)
+{
+	if (tree == NULL) {
+		return NULL;
+	}
+
+	return tree_it_begin(tree, sorted);
+}
+
+bool knot_zone_tree_it_finished(knot_zone_tree_it_t *it)
+{
+	return it == NULL || tree_it_finished(it);
+}
+
+void knot_zone_tree_it_next(knot_zone_tree_it_t *it)
+{
+	tree_it_next(it);
+}
+
+zone_node_t *knot_zone_tree_it_val(knot_zone_tree_it_t *it)
+{
+	return (zone_node_t *)*tree_it_val(it);
+}
+
+void knot_zone_tree_it_free(knot_zone_tree_it_t *it)
+{
+	if (it == NULL) {
+		return;
+	}
+
+	tree_it_free(it);
+}
@@ -29,12 +29,22 @@
 #ifndef _KNOT_ZONE_TREE_H_
 #define _KNOT_ZONE_TREE_H_
 
-#include "common/hattrie/hat-trie.h"
+#include <stdbool.h>
+
+#include "common/errcode.h"
 #include "knot/zone/node.h"
 
 /*----------------------------------------------------------------------------*/
 
+#ifdef USE_QP_TRIE
+#include "common/qp-trie/trie.h"
+typedef trie_t knot_zone_tree_t;
+typedef trie_it_t knot_zone_tree_it_t;
+#else
+#include "common/hattrie/hat-trie.h"
 typedef hattrie_t knot_zone_tree_t;
+typedef hattrie_iter_t knot_zone_tree_it_t;
+#endif
 
 /*!
  * \brief Signature of callback for zone apply functions.
@@ -159,6 +169,21 @@ int knot_zone_tree_get_less_or_equal(knot_zone_tree_t *tree,
                                        zone_node_t **found,
                                        zone_node_t **previous);
 
+/*!
+ * \brief Finds the last node in canonical order in the subtree of the given
+ *        name, i.e. the last descendant or the node itself.
+ *
+ * \param tree Zone tree to search in.
+ * \param owner Owner of the subtree root.
+ * \param found Found node, NULL if there is no node in the subtree.
+ *
+ * \retval KNOT_EOK
+ * \retval KNOT_EINVAL
+ */
+int knot_zone_tree_get_subtree_last(knot_zone_tree_t *tree,
+                                    const knot_dname_t *owner,
+                                    zone_node_t **found);
+
 /*!
  * \brief Removes node with the given owner from the zone tree and returns it.
  *
@@ -223,6 +248,49 @@ void knot_zone_tree_free(knot_zone_tree_t **tree);
  */
 void knot_zone_tree_deep_free(knot_zone_tree_t **tree);
 
+/*!
+ * \brief Rebuilds the order index needed by ordered lookups.
+ *
+ * Must be called after insertions and before the less-or-equal lookups.
+ * The qp-trie is always ordered, so this is a no-op there.
+ *
+ * \param tree Zone tree.
+ */
+void knot_zone_tree_build_index(knot_zone_tree_t *tree);
+
+/*!
+ * \brief Creates iterator over the zone tree nodes.
+ *
+ * \note The tree must not be modified while the iterator is in use.
+ *
+ * \param tree Zone tree.
+ * \param sorted Iterate in canonical order.
+ *
+ * \return New iterator or NULL.
+ */
+knot_zone_tree_it_t *knot_zone_tree_it_begin(const knot_zone_tree_t *tree,
+                                             bool sorted);
+
+/*!
+ * \brief Checks if the iterator has passed the last node.
+ */
+bool knot_zone_tree_it_finished(knot_zone_tree_it_t *it);
+
+/*!
+ * \brief Moves the iterator to the next node.
+ */
+void knot_zone_tree_it_next(knot_zone_tree_it_t *it);
+
+/*!
+ * \brief Returns node at the iterator position.
+ */
+zone_node_t *knot_zone_tree_it_val(knot_zone_tree_it_t *it);
+
+/*!
+ * \brief Frees the iterator.
+ */
+void knot_zone_tree_it_free(knot_zone_tree_it_t *it);
+
 /*----------------------------------------------------------------------------*/
 
 #endif // _KNOT_ZONE_TREE_H_
@@ -20,6 +20,7 @@
 
 #include "common/descriptor.h"
 #include "common/evsched.h"
+#include "knot/server/zone-load.h"
 #include "knot/server/zones.h"
 #include "knot/zone/node.h"
 #include "knot/zone/zone.h"
@@ -75,6 +76,7 @@ int zone_timers_create(zone_t *zone, evsched_t *scheduler)
 	zone->xfr_in.timer  = zone_timer_create(scheduler, zones_refresh_ev, zone);
 	zone->xfr_in.expire = zone_timer_create(scheduler, zones_expire_ev,  zone);
 	zone->dnssec.timer  = zone_timer_create(scheduler, zones_dnssec_ev,  zone);
+	zone->load          = zone_timer_create(scheduler, zone_load_ev,     zone);
 
 	return KNOT_EOK;
 }
@@ -87,13 +89,22 @@ int zone_timers_freeze(zone_t *zone)
 
 	/*! \todo NOTIFY, xfers and updates now MUST NOT trigger reschedule. */
 	/*! \todo No new xfers or updates should be processed. */
-	/*! \todo Raise some kind of flag. */
+
+	/* Keep the loaded lazy zone from starting its timers, wait if it
+	 * is starting them already, they are cancelled below. */
+	pthread_mutex_lock(&zone->lock);
+	while (zone->flags & ZONE_THAWING) {
+		pthread_cond_wait(&zone->thawed, &zone->lock);
+	}
+	zone->flags |= ZONE_FROZEN;
+	pthread_mutex_unlock(&zone->lock);
 
 	/* Cancel all pending timers. */
 	zone_timer_cancel(zone->ixfr_dbsync);
 	zone_timer_cancel(zone->xfr_in.timer);
 	zone_timer_cancel(zone->xfr_in.expire);
 	zone_timer_cancel(zone->dnssec.timer);
+	zone_timer_cancel(zone->load);
 
 	/* Wait for readers to notice the change. */
 	synchronize_rcu();
@@ -117,6 +128,15 @@ int zone_timers_thaw(zone_t *zone)
 		return KNOT_EINVAL;
 	}
 
+	pthread_mutex_lock(&zone->lock);
+	zone->flags &= ~ZONE_FROZEN;
+	pthread_mutex_unlock(&zone->lock);
+
+	/* Lazy zone is not loaded yet, timers start after the load. */
+	if (zone->flags & ZONE_LAZY) {
+		return KNOT_EOK;
+	}
+
 	/* Schedule DNSSEC signing timer. */
 	if(zone->conf->dnssec_enable) {
 		zones_schedule_dnssec(zone, zone->dnssec.refresh_at);
@@ -164,7 +184,8 @@ static int set_acl(acl_t **acl, list_t* acl_list)
 	return KNOT_EOK;
 }
 
-zone_t* zone_new(conf_zone_t *conf)
+/*! \brief Create zone structure without contents and journal. */
+static zone_t *zone_create(conf_zone_t *conf)
 {
 	if (!conf) {
 		return NULL;
@@ -193,13 +214,29 @@ zone_t* zone_new(conf_zone_t *conf)
 
 	// Mutexes
 	pthread_mutex_init(&zone->lock, 0);
+	pthread_cond_init(&zone->thawed, 0);
 	pthread_mutex_init(&zone->ddns_lock, 0);
 
+	// DDNS queue
+	pthread_mutex_init(&zone->ddns.lock, 0);
+	pthread_cond_init(&zone->ddns.done, 0);
+	init_list(&zone->ddns.queue);
+
 	// ACLs
 	set_acl(&zone->xfr_out,    &conf->acl.xfr_out);
 	set_acl(&zone->notify_in,  &conf->acl.notify_in);
 	set_acl(&zone->update_in,  &conf->acl.update_in);
 
+	return zone;
+}
+
+zone_t* zone_new(conf_zone_t *conf)
+{
+	zone_t *zone = zone_create(conf);
+	if (zone == NULL) {
+		return NULL;
+	}
+
 	/* Initialize IXFR database. */
 	zone->ixfr_db = journal_open(conf->ixfr_db, conf->ixfr_fslimit, JOURNAL_DIRTY);
 	if (zone->ixfr_db == NULL) {
@@ -214,6 +251,18 @@ zone_t* zone_new(conf_zone_t *conf)
 	return zone;
 }
 
+zone_t *zone_new_lazy(conf_zone_t *conf)
+{
+	zone_t *zone = zone_create(conf);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	zone->flags |= ZONE_LAZY;
+
+	return zone;
+}
+
 void zone_free(zone_t **zone_ptr)
 {
 	if (zone_ptr == NULL || *zone_ptr == NULL) {
@@ -229,12 +278,16 @@ void zone_free(zone_t **zone_ptr)
 	zone_timer_free(zone->xfr_in.expire);
 	zone_timer_free(zone->ixfr_dbsync);
 	zone_timer_free(zone->dnssec.timer);
+	zone_timer_free(zone->load);
 
 	acl_delete(&zone->xfr_out);
 	acl_delete(&zone->notify_in);
 	acl_delete(&zone->update_in);
 	pthread_mutex_destroy(&zone->lock);
+	pthread_cond_destroy(&zone->thawed);
 	pthread_mutex_destroy(&zone->ddns_lock);
+	pthread_mutex_destroy(&zone->ddns.lock);
+	pthread_cond_destroy(&zone->ddns.done);
 
 	/* Close IXFR db. */
 	journal_close(zone->ixfr_db);
@@ -262,6 +315,30 @@ knot_zone_contents_t *zone_switch_contents(zone_t *zone,
 	return old_contents;
 }
 
+int zone_load_request(zone_t *zone)
+{
+	if (zone == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (!(zone->flags & ZONE_LAZY)) {
+		return KNOT_EOK;
+	}
+
+	/* Schedule the load only once. */
+	pthread_mutex_lock(&zone->lock);
+	int ret = KNOT_EOK;
+	if ((zone->flags & (ZONE_LAZY | ZONE_LOADING)) == ZONE_LAZY) {
+		ret = evsched_schedule(zone->load, 0);
+		if (ret == KNOT_EOK) {
+			zone->flags |= ZONE_LOADING;
+		}
+	}
+	pthread_mutex_unlock(&zone->lock);
+
+	return ret;
+}
+
 const conf_iface_t *zone_master(const zone_t *zone)
 {
 	if (zone == NULL) {
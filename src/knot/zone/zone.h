@@ -29,6 +29,7 @@
 #include <stdint.h>
 
 #include "common/evsched.h"
+#include "common/lists.h"
 #include "common/ref.h"
 #include "libknot/dname.h"
 #include "knot/conf/conf.h"
@@ -40,10 +41,15 @@
  * \brief Zone flags.
  */
 typedef enum zone_flag_t {
-	ZONE_DISCARDED = 1 << 1  /*! Zone waiting to be discarded. */
+	ZONE_DISCARDED = 1 << 1, /*! Zone waiting to be discarded. */
+	ZONE_LAZY      = 1 << 2, /*! Zone contents are loaded on first use. */
+	ZONE_LOADING   = 1 << 3, /*! Loading of lazy zone is scheduled. */
+	ZONE_FROZEN    = 1 << 4, /*! Zone timers are frozen for reload. */
+	ZONE_THAWING   = 1 << 5  /*! Loaded lazy zone is starting its timers. */
 } zone_flag_t;
 
 struct server_t;
+struct stats_zones;
 
 /*!
  * \brief Structure for holding DNS zone.
@@ -71,9 +77,25 @@ typedef struct zone_t {
 
 	/*! \brief Zone data lock for exclusive access. */
 	pthread_mutex_t lock;
+	/*! \brief Signalled when the loaded lazy zone has started its timers. */
+	pthread_cond_t thawed;
 	/*! \brief Zone lock for DDNS. */
 	pthread_mutex_t ddns_lock;
 
+	/*! \brief DDNS group commit queue. */
+	struct {
+		pthread_mutex_t lock;  /*!< Queue lock. */
+		pthread_cond_t done;   /*!< Signalled after each committed batch. */
+		list_t queue;          /*!< Pending UPDATE requests. */
+		bool leader;           /*!< Batch is being committed. */
+	} ddns;
+
+	/*! \brief Query counters in the zone database table. */
+	struct {
+		struct stats_zones *table; /*!< Table (NULL if not counted). */
+		size_t index;              /*!< Zone index in the table. */
+	} queries;
+
 	/*! \brief Access control lists. */
 	acl_t *xfr_out;    /*!< ACL for outgoing transfers.*/
 	acl_t *notify_in;  /*!< ACL for incoming notifications.*/
@@ -95,6 +117,9 @@ typedef struct zone_t {
 	/*! \brief Zone IXFR history. */
 	journal_t *ixfr_db;
 	event_t *ixfr_dbsync;   /*!< Syncing IXFR db to zonefile. */
+
+	/*! \brief On-demand loading of lazy zone. */
+	event_t *load;
 } zone_t;
 
 /*----------------------------------------------------------------------------*/
@@ -108,6 +133,18 @@ typedef struct zone_t {
  */
 zone_t *zone_new(conf_zone_t *conf);
 
+/*!
+ * \brief Creates a stub of zone which is loaded on first use.
+ *
+ * The stub has no contents and no journal, both are set up by the load
+ * event requested with zone_load_request().
+ *
+ * \param conf  Zone configuration.
+ *
+ * \return The initialized zone structure or NULL if an error occured.
+ */
+zone_t *zone_new_lazy(conf_zone_t *conf);
+
 /*!
  * \brief Deallocates the zone structure.
  *
@@ -152,6 +189,14 @@ int zone_timers_freeze(zone_t *zone);
  */
 int zone_timers_thaw(zone_t *zone);
 
+/*!
+ * \brief Schedule loading of the lazy zone (if not already scheduled).
+ *
+ * \retval KNOT_EOK if the zone is loaded or the loading is scheduled.
+ * \retval KNOT_EINVAL on invalid parameters.
+ */
+int zone_load_request(zone_t *zone);
+
 /*!
  * \brief Return zone master interface.
  */
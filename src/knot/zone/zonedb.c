@@ -49,6 +49,31 @@ static void discard_zone(zone_t *zone)
 	zone_release(zone);
 }
 
+/*!
+ * \brief Convert name to the suffix trie key.
+ *
+ * Labels are stored from the rightmost with the length bytes, so the key of
+ * the zone is a prefix of the key of any name in the zone. Root is empty.
+ */
+static int suffix_key(uint8_t *dst, const knot_dname_t *name)
+{
+	const uint8_t *labels[KNOT_DNAME_MAXLABELS];
+	int count = 0;
+	while (*name != 0) {
+		labels[count++] = name;
+		name = knot_wire_next_label(name, NULL);
+	}
+
+	int len = 0;
+	while (count > 0) {
+		const uint8_t *label = labels[--count];
+		memcpy(dst + len, label, *label + 1);
+		len += *label + 1;
+	}
+
+	return len;
+}
+
 /*----------------------------------------------------------------------------*/
 /* API functions                                                              */
 /*----------------------------------------------------------------------------*/
@@ -63,10 +88,11 @@ knot_zonedb_t *knot_zonedb_new(uint32_t size)
 		return NULL;
 	}
 
-	db->maxlabels = 0;
+	db->queries = NULL;
 	db->hash = hhash_create_mm((size + 1) * 2, &mm);
-	if (db->hash == NULL) {
-		mm.free(db);
+	db->suffix = trie_create(&mm);
+	if (db->hash == NULL || db->suffix == NULL) {
+		mp_delete(mm.ctx);
 		return NULL;
 	}
 
@@ -87,7 +113,23 @@ int knot_zonedb_insert(knot_zonedb_t *db, zone_t *zone)
 		return KNOT_EINVAL;
 	}
 
-	return hhash_insert(db->hash, (const char*)zone->name, name_size, zone);
+	uint8_t key[KNOT_DNAME_MAXLEN];
+	int key_len = suffix_key(key, zone->name);
+	trie_val_t *val = trie_get_ins(db->suffix, key, key_len);
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = hhash_insert(db->hash, (const char*)zone->name, name_size, zone);
+	if (ret != KNOT_EOK) {
+		if (*val == NULL) {
+			trie_del(db->suffix, key, key_len, NULL);
+		}
+		return ret;
+	}
+
+	*val = zone;
+	return KNOT_EOK;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -98,11 +140,16 @@ int knot_zonedb_del(knot_zonedb_t *db, const knot_dname_t *zone_name)
 		return KNOT_EINVAL;
 	}
 
-	/* Can't guess maximum label count now. */
-	db->maxlabels = KNOT_DNAME_MAXLABELS;
 	/* Attempt to remove zone. */
 	int name_size = knot_dname_size(zone_name);
-	return hhash_del(db->hash, (const char*)zone_name, name_size);
+	int ret = hhash_del(db->hash, (const char*)zone_name, name_size);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	uint8_t key[KNOT_DNAME_MAXLEN];
+	int key_len = suffix_key(key, zone_name);
+	return trie_del(db->suffix, key, key_len, NULL);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -116,16 +163,6 @@ int knot_zonedb_build_index(knot_zonedb_t *db)
 	/* Rebuild order index. */
 	hhash_build_index(db->hash);
 
-	/* Calculate maxlabels. */
-	db->maxlabels = 0;
-	knot_zonedb_iter_t it;
-	knot_zonedb_iter_begin(db, &it);
-	while (!knot_zonedb_iter_finished(&it)) {
-		zone_t *zone = knot_zonedb_iter_val(&it);
-		db->maxlabels = MAX(db->maxlabels, knot_dname_labels(zone->name, NULL));
-		knot_zonedb_iter_next(&it);
-	}
-
 	return KNOT_EOK;
 }
 
@@ -164,29 +201,15 @@ zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *dname)
 		return NULL;
 	}
 
-	/* We know we have at most N label zones, so let's compare only those
-	 * N last labels. */
-	int zone_labels = knot_dname_labels(dname, NULL);
-	while (zone_labels > db->maxlabels) {
-		dname = knot_wire_next_label(dname, NULL);
-		--zone_labels;
-	}
-
-	/* Compare possible suffixes. */
-	value_t *val = NULL;
-	int name_size = knot_dname_size(dname);
-	while (name_size > 0) { /* Include root label. */
-		val = find_name(db, dname, name_size);
-		if (val != NULL) {
-			return *val;
-		}
-
-		/* Next label */
-		name_size -= (dname[0] + 1);
-		dname = knot_wire_next_label(dname, NULL);
+	/* Closest zone is the longest zone key prefix. */
+	uint8_t key[KNOT_DNAME_MAXLEN];
+	int key_len = suffix_key(key, dname);
+	trie_val_t *val = trie_get_prefix(db->suffix, key, key_len);
+	if (val == NULL) {
+		return NULL;
 	}
 
-	return NULL;
+	return *val;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -208,6 +231,7 @@ void knot_zonedb_free(knot_zonedb_t **db)
 		return;
 	}
 
+	stats_zones_free((*db)->queries);
 	mp_delete((*db)->mm.ctx);
 	*db = NULL;
 }
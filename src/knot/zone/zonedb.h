@@ -35,20 +35,20 @@
 #include "knot/zone/zone-contents.h"
 #include "libknot/dname.h"
 #include "common/hhash.h"
+#include "common/qp-trie/trie.h"
 
 /*
  * Zone DB represents a list of managed zones.
- * Hashing should be avoided as it is expensive when only a small number of
- * zones is present (TLD case). Fortunately hhash is able to do linear scan if
- * it has only a handful of names present. Furthermore, we track the name with
- * the most labels in the database. So if we have for example a 'a.b.' in the
- * database and search for 'c.d.a.b.' we can trim the 'c.d.' and search for
- * the suffix as we now there can't be a closer match.
+ * Zones are hashed by name for exact lookup and iteration. For the closest
+ * zone lookup, a trie keyed by the names with reversed labels is kept, so
+ * all zones which are suffixes of a name are found in one descent instead
+ * of hashing each of the name suffixes.
  */
 typedef struct {
-	uint16_t maxlabels;
 	hhash_t *hash;
+	trie_t *suffix;
 	mm_ctx_t mm;
+	struct stats_zones *queries; /*!< Per-zone query counters. */
 } knot_zonedb_t;
 
 /*
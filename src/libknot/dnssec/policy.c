@@ -18,7 +18,17 @@
 #include <string.h>
 #include <time.h>
 
+#include "libknot/common.h"
 #include "libknot/dnssec/policy.h"
+#include "libknot/dnssec/random.h"
+
+/*!
+ * \brief Get time before signature expiration when it should be refreshed.
+ */
+static uint32_t signature_safety(const knot_dnssec_policy_t *policy)
+{
+	return policy->sign_lifetime / 10;
+}
 
 uint32_t knot_dnssec_policy_refresh_time(const knot_dnssec_policy_t *policy,
                                          uint32_t earliest_expiration)
@@ -27,12 +37,26 @@ uint32_t knot_dnssec_policy_refresh_time(const knot_dnssec_policy_t *policy,
 		return 0;
 	}
 
-	uint32_t signature_safety = policy->sign_lifetime / 10;
-	if (earliest_expiration <= signature_safety) {
+	uint32_t safety = signature_safety(policy);
+	if (earliest_expiration <= safety) {
 		return 0;
 	}
 
-	return earliest_expiration - signature_safety;
+	return earliest_expiration - safety;
+}
+
+uint32_t knot_dnssec_policy_jitter_lifetime(const knot_dnssec_policy_t *policy)
+{
+	if (policy == NULL) {
+		return 0;
+	}
+
+	if (policy->sign_jitter == 0) {
+		return policy->sign_lifetime;
+	}
+
+	uint32_t jitter = knot_random_uint32_t() % (policy->sign_jitter + 1);
+	return policy->sign_lifetime - jitter;
 }
 
 void knot_dnssec_policy_set_sign_lifetime(knot_dnssec_policy_t *policy,
@@ -42,11 +66,15 @@ void knot_dnssec_policy_set_sign_lifetime(knot_dnssec_policy_t *policy,
 		return;
 	}
 
-	uint32_t max_expiration = policy->now + sign_lifetime;
-
 	policy->sign_lifetime = sign_lifetime;
-	policy->refresh_before = knot_dnssec_policy_refresh_time(policy,
-	                                                         max_expiration);
+
+	/* Refresh signatures within the safety margin before expiration.
+	 * Random shortening of the life time keeps the expirations spread,
+	 * new signatures must still stay clear of the next refresh. */
+	uint32_t safety = signature_safety(policy);
+	policy->refresh_before = policy->now + safety;
+	policy->sign_jitter = sign_lifetime / 4;
+	policy->resign_tick = MIN(KNOT_DNSSEC_RESIGN_TICK, safety / 4);
 }
 
 void knot_dnssec_init_default_policy(knot_dnssec_policy_t *policy)
@@ -39,12 +39,17 @@ typedef struct {
 	uint32_t now;               //! Current time.
 	uint32_t refresh_before;    //! Refresh signatures expiring before to this time.
 	uint32_t sign_lifetime;     //! Signature life time.
+	uint32_t sign_jitter;       //! Maximal random shortening of signature life time.
+	uint32_t resign_tick;       //! Interval of incremental signature refresh.
 	bool forced_sign;           //! Drop valid signatures as well.
 	knot_update_serial_t soa_up;//! Policy for serial updating.
 } knot_dnssec_policy_t;
 
 #define KNOT_DNSSEC_DEFAULT_LIFETIME 2592000
 
+/*! \brief Longest interval of incremental signature refresh. */
+#define KNOT_DNSSEC_RESIGN_TICK 3600
+
 /*!
  * \brief Initialize default signing policy.
  */
@@ -62,6 +67,14 @@ void knot_dnssec_policy_set_sign_lifetime(knot_dnssec_policy_t *policy,
 uint32_t knot_dnssec_policy_refresh_time(const knot_dnssec_policy_t *policy,
                                          uint32_t earliest_expiration);
 
+/*!
+ * \brief Get randomly shortened signature life time.
+ *
+ * Signatures of a single RR set should share the life time, so that the
+ * expirations stay spread evenly over the zone.
+ */
+uint32_t knot_dnssec_policy_jitter_lifetime(const knot_dnssec_policy_t *policy);
+
 
 #endif // _KNOT_DNSSEC_POLICY_H_
 
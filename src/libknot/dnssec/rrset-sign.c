@@ -28,6 +28,7 @@
 #include "libknot/rdata/rrsig.h"
 
 #define MAX_RR_WIREFORMAT_SIZE (64 * 1024)
+#define RR_WIREFORMAT_STACK_SIZE 2048
 #define RRSIG_RDATA_SIGNER_OFFSET 18
 
 /*- Creating of RRSIGs -------------------------------------------------------*/
@@ -124,40 +125,48 @@ static int sign_ctx_add_self(knot_dnssec_sign_context_t *ctx,
 	return knot_dnssec_sign_add(ctx, rdata, data_size);
 }
 
+/*!
+ * \brief Get upper bound of the wire format size of covered RRs.
+ */
+static size_t records_wire_size(const knot_rrset_t *covered)
+{
+	// owner, type, class, TTL, RDATA length, RDATA
+	size_t rr_header = knot_dname_size(covered->owner) + 3 * sizeof(uint16_t)
+	                 + sizeof(uint32_t);
+
+	size_t size = 0;
+	for (uint16_t i = 0; i < covered->rrs.rr_count; i++) {
+		size += rr_header + knot_rrset_rr_size(covered, i);
+	}
+
+	return MIN(size, MAX_RR_WIREFORMAT_SIZE);
+}
+
 /*!
  * \brief Add covered RRs to signing context.
  *
  * Requires all DNAMEs in canonical form and all RRs ordered canonically.
  *
- * \param ctx      Signing context.
- * \param covered  Covered RRs.
+ * \param ctx          Signing context.
+ * \param covered      Covered RRs.
+ * \param buffer       Buffer for the RRs in wire format.
+ * \param buffer_size  Size of the buffer.
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static int sign_ctx_add_records(knot_dnssec_sign_context_t *ctx,
-                                const knot_rrset_t *covered)
+                                const knot_rrset_t *covered,
+                                uint8_t *buffer, size_t buffer_size)
 {
-	// huge block of rrsets can be optionally created
-	uint8_t *rrwf = malloc(MAX_RR_WIREFORMAT_SIZE);
-	if (!rrwf) {
-		return KNOT_ENOMEM;
-	}
-
-	int result = KNOT_EOK;
-
 	size_t rr_wire_size = 0;
 	uint16_t rr_count = 0;
-	result = knot_rrset_to_wire(covered, rrwf, &rr_wire_size,
-	                            MAX_RR_WIREFORMAT_SIZE, &rr_count, NULL);
+	int result = knot_rrset_to_wire(covered, buffer, &rr_wire_size,
+	                                buffer_size, &rr_count, NULL);
 	if (result != KNOT_EOK || rr_count != covered->rrs.rr_count) {
-		free(rrwf);
 		return result;
 	}
 
-	result = knot_dnssec_sign_add(ctx, rrwf, rr_wire_size);
-	free(rrwf);
-
-	return result;
+	return knot_dnssec_sign_add(ctx, buffer, rr_wire_size);
 }
 
 /*!
@@ -171,101 +180,157 @@ static int sign_ctx_add_records(knot_dnssec_sign_context_t *ctx,
  * \param ctx          Signing context.
  * \param rrsig_rdata  RRSIG RDATA with populated fields except signature.
  * \param covered      Covered RRs.
+ * \param buffer       Buffer for the covered RRs in wire format.
+ * \param buffer_size  Size of the buffer.
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static int sign_ctx_add_data(knot_dnssec_sign_context_t *ctx,
                              const uint8_t *rrsig_rdata,
-                             const knot_rrset_t *covered)
+                             const knot_rrset_t *covered,
+                             uint8_t *buffer, size_t buffer_size)
 {
 	int result = sign_ctx_add_self(ctx, rrsig_rdata);
 	if (result != KNOT_EOK) {
 		return result;
 	}
 
-	return sign_ctx_add_records(ctx, covered);
+	return sign_ctx_add_records(ctx, covered, buffer, buffer_size);
 }
 
 /*!
- * \brief Create RRSIG RDATA (all fields except signature are filled).
+ * \brief Create RRSIG RDATA and add it into the RRSIG RR set.
  *
- * \param[in]  rrsigs        RR set with RRSIGS.
- * \param[in]  rrsigs        DNSSEC signing context.
- * \param[in]  covered       RR covered by the signature.
- * \param[in]  key           Key used for signing.
- * \param[in]  sig_incepted  Timestamp of signature inception.
- * \param[in]  sig_expires   Timestamp of signature expiration.
+ * \param[in]  rrsigs       RR set with RRSIGS.
+ * \param[in]  context      DNSSEC signing context.
+ * \param[in]  covered      RR covered by the signature.
+ * \param[in]  rdata        RRSIG RDATA with key and validity fields filled.
+ * \param[in]  rdata_size   Size of the RRSIG RDATA.
+ * \param[in]  buffer       Buffer for the covered RRs in wire format.
+ * \param[in]  buffer_size  Size of the buffer.
  *
  * \return Error code, KNOT_EOK if succesful.
  */
 static int rrsigs_create_rdata(knot_rrset_t *rrsigs,
                                knot_dnssec_sign_context_t *context,
                                const knot_rrset_t *covered,
-                               const knot_dnssec_key_t *key,
-                               uint32_t sig_incepted, uint32_t sig_expires)
+                               uint8_t *rdata, size_t rdata_size,
+                               uint8_t *buffer, size_t buffer_size)
 {
 	assert(rrsigs);
 	assert(rrsigs->type == KNOT_RRTYPE_RRSIG);
 	assert(!knot_rrset_empty(covered));
-	assert(key);
-
-	size_t size = knot_rrsig_rdata_size(key);
-	assert(size != 0);
 
 	uint8_t owner_labels = knot_dname_labels(covered->owner, NULL);
 	if (knot_dname_is_wildcard(covered->owner)) {
 		owner_labels -= 1;
 	}
 
-	uint8_t result[size];
-	int res = knot_rrsig_write_rdata(result, key, covered->type, owner_labels,
-	                                 knot_rrset_rr_ttl(covered, 0),
-	                                 sig_incepted, sig_expires);
-	assert(res == KNOT_EOK);
+	// fields specific to the covered RR set
+	uint32_t owner_ttl = knot_rrset_rr_ttl(covered, 0);
+	knot_wire_write_u16(rdata, covered->type);
+	rdata[3] = owner_labels;
+	knot_wire_write_u32(rdata + 4, owner_ttl);
 
-	res = knot_dnssec_sign_new(context);
+	int res = knot_dnssec_sign_new(context);
 	if (res != KNOT_EOK) {
 		return res;
 	}
 
-	res = sign_ctx_add_data(context, result, covered);
+	res = sign_ctx_add_data(context, rdata, covered, buffer, buffer_size);
 	if (res != KNOT_EOK) {
 		return res;
 	}
 
-	const size_t signature_offset = RRSIG_RDATA_SIGNER_OFFSET + knot_dname_size(key->name);
-	uint8_t *signature = result + signature_offset;
-	const size_t signature_size = size - signature_offset;
+	const uint8_t *signer = rdata + RRSIG_RDATA_SIGNER_OFFSET;
+	const size_t signature_offset = RRSIG_RDATA_SIGNER_OFFSET + knot_dname_size(signer);
+	uint8_t *signature = rdata + signature_offset;
+	const size_t signature_size = rdata_size - signature_offset;
 
 	res = knot_dnssec_sign_write(context, signature, signature_size);
 	if (res != KNOT_EOK) {
 		return res;
 	}
 
-	return knot_rrset_add_rdata(rrsigs, result, size,
-	                         knot_rrset_rr_ttl(covered, 0), NULL);
+	return knot_rrset_add_rdata(rrsigs, rdata, rdata_size, owner_ttl, NULL);
 }
 
 /*!
- * \brief Create RRSIG RR for given RR set.
+ * \brief Check if the RRSIG RR set may hold signatures of the covered RR set.
  */
-int knot_sign_rrset(knot_rrset_t *rrsigs, const knot_rrset_t *covered,
-                    const knot_dnssec_key_t *key,
-                    knot_dnssec_sign_context_t *sign_ctx,
-                    const knot_dnssec_policy_t *policy)
+static bool rrsigs_match_covered(const knot_rrset_t *rrsigs,
+                                 const knot_rrset_t *covered)
 {
-	if (knot_rrset_empty(covered) || !key || !sign_ctx || !policy ||
-	    rrsigs->type != KNOT_RRTYPE_RRSIG ||
-	    (knot_dname_cmp(rrsigs->owner, covered->owner) != 0)
-	) {
+	return !knot_rrset_empty(covered) && rrsigs &&
+	       rrsigs->type == KNOT_RRTYPE_RRSIG &&
+	       knot_dname_cmp(rrsigs->owner, covered->owner) == 0;
+}
+
+/*!
+ * \brief Create RRSIG RRs for given RR sets.
+ */
+int knot_sign_rrsets(knot_rrset_t *const rrsigs[],
+                     const knot_rrset_t *const covered[], size_t count,
+                     const knot_dnssec_key_t *key,
+                     knot_dnssec_sign_context_t *sign_ctx,
+                     const knot_dnssec_policy_t *policy)
+{
+	if (!rrsigs || !covered || !key || !sign_ctx || !policy) {
 		return KNOT_EINVAL;
 	}
 
+	size_t buffer_size = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (!rrsigs_match_covered(rrsigs[i], covered[i])) {
+			return KNOT_EINVAL;
+		}
+		buffer_size = MAX(buffer_size, records_wire_size(covered[i]));
+	}
+
+	// covered RRs of small RR sets fit on the stack
+
+	uint8_t stack_buffer[RR_WIREFORMAT_STACK_SIZE];
+	uint8_t *buffer = stack_buffer;
+	if (buffer_size > sizeof(stack_buffer)) {
+		buffer = malloc(buffer_size);
+		if (!buffer) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	// RRSIG RDATA fields shared by all signatures are written once
+
+	size_t rdata_size = knot_rrsig_rdata_size(key);
+	assert(rdata_size != 0);
+	uint8_t rdata[rdata_size];
+
 	uint32_t sig_incept = policy->now;
 	uint32_t sig_expire = sig_incept + policy->sign_lifetime;
+	int result = knot_rrsig_write_rdata(rdata, key, 0, 0, 0, sig_incept,
+	                                    sig_expire);
+
+	for (size_t i = 0; result == KNOT_EOK && i < count; i++) {
+		result = rrsigs_create_rdata(rrsigs[i], sign_ctx, covered[i],
+		                             rdata, rdata_size,
+		                             buffer, buffer_size);
+	}
 
-	return rrsigs_create_rdata(rrsigs, sign_ctx, covered, key, sig_incept,
-	                           sig_expire);
+	if (buffer != stack_buffer) {
+		free(buffer);
+	}
+
+	return result;
+}
+
+/*!
+ * \brief Create RRSIG RR for given RR set.
+ */
+int knot_sign_rrset(knot_rrset_t *rrsigs, const knot_rrset_t *covered,
+                    const knot_dnssec_key_t *key,
+                    knot_dnssec_sign_context_t *sign_ctx,
+                    const knot_dnssec_policy_t *policy)
+{
+	return knot_sign_rrsets(&rrsigs, &covered, 1, key, sign_ctx, policy);
 }
 
 int knot_synth_rrsig(uint16_t type, const knot_rdataset_t *rrsig_rrs,
@@ -355,11 +420,25 @@ int knot_is_valid_signature(const knot_rrset_t *covered,
 		return result;
 	}
 
-	result = sign_ctx_add_data(ctx, rdata, covered);
-	if (result != KNOT_EOK) {
-		return result;
+	size_t buffer_size = records_wire_size(covered);
+	uint8_t stack_buffer[RR_WIREFORMAT_STACK_SIZE];
+	uint8_t *buffer = stack_buffer;
+	if (buffer_size > sizeof(stack_buffer)) {
+		buffer = malloc(buffer_size);
+		if (!buffer) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	result = sign_ctx_add_data(ctx, rdata, covered, buffer, buffer_size);
+	if (result == KNOT_EOK) {
+		result = knot_dnssec_sign_verify(ctx, signature, signature_size);
 	}
 
-	return knot_dnssec_sign_verify(ctx, signature, signature_size);
+	if (buffer != stack_buffer) {
+		free(buffer);
+	}
+
+	return result;
 }
 
@@ -77,6 +77,30 @@ int knot_sign_rrset(knot_rrset_t *rrsigs,
                     knot_dnssec_sign_context_t *sign_ctx,
                     const knot_dnssec_policy_t *policy);
 
+/*!
+ * \brief Create RRSIG RRs for several RR sets with a single key.
+ *
+ * The signing context, the buffer for covered records, and the RRSIG RDATA
+ * fields independent of the covered RR set are shared by the whole batch,
+ * which makes it cheaper than signing the RR sets one by one. All the
+ * signatures share inception and expiration given by the policy.
+ *
+ * \param rrsigs    RR sets with RRSIGs, one for each covered RR set.
+ * \param covered   RR sets to create new signatures for.
+ * \param count     Number of RR sets.
+ * \param key       Signing key.
+ * \param sign_ctx  Signing context.
+ * \param policy    DNSSEC policy.
+ *
+ * \return Error code, KNOT_EOK if successful. RRSIGs created before the
+ *         failure are kept in their RR sets.
+ */
+int knot_sign_rrsets(knot_rrset_t *const rrsigs[],
+                     const knot_rrset_t *const covered[], size_t count,
+                     const knot_dnssec_key_t *key,
+                     knot_dnssec_sign_context_t *sign_ctx,
+                     const knot_dnssec_policy_t *policy);
+
 /*!
  * \brief Creates new RRS using \a rrsig_rrs as a source. Only those RRs that
  *        cover given \a type are copied into \a out_sig
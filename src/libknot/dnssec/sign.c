@@ -28,6 +28,7 @@
 #include "libknot/dnssec/crypto.h"
 #include "libknot/dnssec/key.h"
 #include "libknot/dnssec/sign.h"
+#include "libknot/packet/wire.h"
 
 #ifdef KNOT_ENABLE_ECDSA
 #include <openssl/ecdsa.h>
@@ -51,6 +52,8 @@ struct knot_dnssec_key_data {
 struct knot_dnssec_sign_context {
 	const knot_dnssec_key_t *key; //!< Associated key.
 	EVP_MD_CTX *digest_context;   //!< Digest computation context.
+	uint8_t *raw_signature;       //!< Buffer for signature in OpenSSL format.
+	size_t raw_size;              //!< Size of the buffer.
 };
 
 /*!
@@ -145,14 +148,9 @@ static int sign_safe_write(const knot_dnssec_sign_context_t *context,
 	EVP_MD_CTX *digest_ctx = context->digest_context;
 	EVP_PKEY *private_key = context->key->data->private_key;
 
-	// check target size
-
-	unsigned int max_write = 0;
-	int result = EVP_SignFinal(digest_ctx, NULL, &max_write, private_key);
-	if (!result) {
-		return KNOT_DNSSEC_ESIGN;
-	}
+	// check target size, the key size is the upper bound
 
+	unsigned int max_write = EVP_PKEY_size(private_key);
 	if (max_write > max_size) {
 		return KNOT_DNSSEC_EUNEXPECTED_SIGNATURE_SIZE;
 	}
@@ -160,7 +158,7 @@ static int sign_safe_write(const knot_dnssec_sign_context_t *context,
 	// write signature
 
 	unsigned int written = 0;
-	result = EVP_SignFinal(digest_ctx, signature, &written, private_key);
+	int result = EVP_SignFinal(digest_ctx, signature, &written, private_key);
 	if (!result) {
 		return KNOT_DNSSEC_ESIGN;
 	}
@@ -172,37 +170,31 @@ static int sign_safe_write(const knot_dnssec_sign_context_t *context,
 }
 
 /*!
- * \brief Allocate space for signature, finish signature, and write it.
+ * \brief Finish signature and write it into the context buffer.
  *
  * \param context    DNSSEC signing context.
- * \param signature  Pointer to allocated signature.
+ * \param signature  Pointer to the signature in the context buffer.
  * \param size       Size of the written signature.
  *
  * \return Error code, KNOT_EOK if successful.
  */
-static int sign_alloc_and_write(const knot_dnssec_sign_context_t *context,
-                                uint8_t **signature, size_t *size)
+static int sign_raw_write(const knot_dnssec_sign_context_t *context,
+                          const uint8_t **signature, size_t *size)
 {
 	assert(context);
 	assert(signature);
 	assert(size);
 
-	size_t buffer_size = EVP_PKEY_size(context->key->data->private_key);
-	uint8_t *buffer = malloc(buffer_size);
-	if (!buffer) {
-		return KNOT_ENOMEM;
-	}
-
 	size_t written = 0;
-	int result = sign_safe_write(context, buffer, buffer_size, &written);
+	int result = sign_safe_write(context, context->raw_signature,
+	                             context->raw_size, &written);
 	if (result != KNOT_EOK) {
-		free(buffer);
 		return result;
 	}
 
-	assert(written <= buffer_size);
+	assert(written <= context->raw_size);
 
-	*signature = buffer;
+	*signature = context->raw_signature;
 	*size = written;
 
 	return KNOT_EOK;
@@ -294,9 +286,49 @@ static bool any_dnskey_get_pubkey(const knot_binary_t *rdata,
 
 /*- RSA specific -------------------------------------------------------------*/
 
+/*!
+ * \brief Decode RSA public key from DNSKEY RDATA into key parameters.
+ * \note DNSKEY format for RSA is described in RFC 3110 section 2.
+ */
+static int rsa_dnskey_params(const knot_binary_t *rdata,
+                             knot_key_params_t *params)
+{
+	assert(rdata);
+	assert(params);
+
+	const uint8_t *pubkey = NULL;
+	size_t size = 0;
+	if (!any_dnskey_get_pubkey(rdata, &pubkey, &size)) {
+		return KNOT_EINVAL;
+	}
+
+	size_t exp_size = pubkey[0];
+	size_t skip = 1;
+	if (exp_size == 0) {
+		if (size < 3) {
+			return KNOT_DNSSEC_EINVALID_KEY;
+		}
+		exp_size = knot_wire_read_u16(pubkey + 1);
+		skip = 3;
+	}
+
+	if (exp_size == 0 || skip + exp_size >= size) {
+		return KNOT_DNSSEC_EINVALID_KEY;
+	}
+
+	params->public_exponent.data = (uint8_t *)pubkey + skip;
+	params->public_exponent.size = exp_size;
+	params->modulus.data = (uint8_t *)pubkey + skip + exp_size;
+	params->modulus.size = size - skip - exp_size;
+
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Create RSA private key from key parameters.
  *
+ * Only the public key is set if the private exponent is missing.
+ *
  * \param params  Key parameters.
  * \param key     Output private key.
  *
@@ -314,6 +346,16 @@ static int rsa_create_pkey(const knot_key_params_t *params, EVP_PKEY *key)
 
 	rsa->n    = binary_to_bn(&params->modulus);
 	rsa->e    = binary_to_bn(&params->public_exponent);
+
+	// public key only
+	if (params->private_exponent.size == 0) {
+		if (!EVP_PKEY_assign_RSA(key, rsa)) {
+			RSA_free(rsa);
+			return KNOT_DNSSEC_EASSIGN_KEY;
+		}
+		return KNOT_EOK;
+	}
+
 	rsa->d    = binary_to_bn(&params->private_exponent);
 	rsa->p    = binary_to_bn(&params->prime_one);
 	rsa->q    = binary_to_bn(&params->prime_two);
@@ -336,6 +378,45 @@ static int rsa_create_pkey(const knot_key_params_t *params, EVP_PKEY *key)
 
 /*- DSA specific -------------------------------------------------------------*/
 
+/*!
+ * \brief Decode DSA public key from DNSKEY RDATA into key parameters.
+ * \note DNSKEY format for DSA is described in RFC 2536 section 2.
+ */
+static int dsa_dnskey_params(const knot_binary_t *rdata,
+                             knot_key_params_t *params)
+{
+	assert(rdata);
+	assert(params);
+
+	const uint8_t *pubkey = NULL;
+	size_t size = 0;
+	if (!any_dnskey_get_pubkey(rdata, &pubkey, &size)) {
+		return KNOT_EINVAL;
+	}
+
+	// T, Q (20 octets), P, G, Y (64 + T * 8 octets each)
+	size_t t = pubkey[0];
+	size_t param_size = 64 + t * 8;
+	if (t > 8 || size != 1 + 20 + 3 * param_size) {
+		return KNOT_DNSSEC_EINVALID_KEY;
+	}
+
+	const uint8_t *pos = pubkey + 1;
+	params->subprime.data = (uint8_t *)pos;
+	params->subprime.size = 20;
+	pos += 20;
+	params->prime.data = (uint8_t *)pos;
+	params->prime.size = param_size;
+	pos += param_size;
+	params->base.data = (uint8_t *)pos;
+	params->base.size = param_size;
+	pos += param_size;
+	params->public_value.data = (uint8_t *)pos;
+	params->public_value.size = param_size;
+
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Create DSA private key from key parameters.
  * \see rsa_create_pkey
@@ -353,8 +434,10 @@ static int dsa_create_pkey(const knot_key_params_t *params, EVP_PKEY *key)
 	dsa->p        = binary_to_bn(&params->prime);
 	dsa->q        = binary_to_bn(&params->subprime);
 	dsa->g        = binary_to_bn(&params->base);
-	dsa->priv_key = binary_to_bn(&params->private_value);
 	dsa->pub_key  = binary_to_bn(&params->public_value);
+	if (params->private_value.size > 0) {
+		dsa->priv_key = binary_to_bn(&params->private_value);
+	}
 
 	if (!EVP_PKEY_assign_DSA(key, dsa)) {
 		DSA_free(dsa);
@@ -392,9 +475,9 @@ static int dsa_sign_write(const knot_dnssec_sign_context_t *context,
 
 	// create raw signature
 
-	uint8_t *raw_signature = NULL;
+	const uint8_t *raw_signature = NULL;
 	size_t raw_size = 0;
-	int result = sign_alloc_and_write(context, &raw_signature, &raw_size);
+	int result = sign_raw_write(context, &raw_signature, &raw_size);
 	if (result != KNOT_EOK) {
 		return result;
 	}
@@ -403,19 +486,15 @@ static int dsa_sign_write(const knot_dnssec_sign_context_t *context,
 
 	DSA_SIG *decoded = DSA_SIG_new();
 	if (!decoded) {
-		free(raw_signature);
 		return KNOT_ENOMEM;
 	}
 
 	const uint8_t *decode_scan = raw_signature;
 	if (!d2i_DSA_SIG(&decoded, &decode_scan, (long)raw_size)) {
 		DSA_SIG_free(decoded);
-		free(raw_signature);
 		return KNOT_DNSSEC_EDECODE_RAW_SIGNATURE;
 	}
 
-	free(raw_signature);
-
 	// convert to format defined by RFC 2536 (DSA keys and SIGs in DNS)
 
 	// T (1 byte), R (20 bytes), S (20 bytes)
@@ -461,17 +540,16 @@ static int dsa_sign_verify(const knot_dnssec_sign_context_t *context,
 	decoded->r = BN_bin2bn(signature_r, 20, decoded->r);
 	decoded->s = BN_bin2bn(signature_s, 20, decoded->s);
 
-	size_t max_size = EVP_PKEY_size(context->key->data->private_key);
-	uint8_t *raw_signature = malloc(max_size);
-	if (!raw_signature) {
+	// encoded signature is not larger than the context buffer
+	if (i2d_DSA_SIG(decoded, NULL) > (int)context->raw_size) {
 		DSA_SIG_free(decoded);
-		return KNOT_ENOMEM;
+		return KNOT_DNSSEC_EDECODE_RAW_SIGNATURE;
 	}
 
+	uint8_t *raw_signature = context->raw_signature;
 	uint8_t *raw_write = raw_signature;
 	int raw_size = i2d_DSA_SIG(decoded, &raw_write);
 	if (raw_size < 0) {
-		free(raw_signature);
 		DSA_SIG_free(decoded);
 		return KNOT_DNSSEC_EDECODE_RAW_SIGNATURE;
 	}
@@ -480,7 +558,6 @@ static int dsa_sign_verify(const knot_dnssec_sign_context_t *context,
 	int result = any_sign_verify(context, raw_signature, raw_size);
 
 	DSA_SIG_free(decoded);
-	free(raw_signature);
 
 	return result;
 }
@@ -564,10 +641,12 @@ static int ecdsa_create_pkey(const knot_key_params_t *params, EVP_PKEY *key)
 		return result;
 	}
 
-	result = ecdsa_set_private_key(&params->private_key, ec_key);
-	if (result != KNOT_EOK) {
-		EC_KEY_free(ec_key);
-		return result;
+	if (params->private_key.size > 0) {
+		result = ecdsa_set_private_key(&params->private_key, ec_key);
+		if (result != KNOT_EOK) {
+			EC_KEY_free(ec_key);
+			return result;
+		}
 	}
 
 	if (EC_KEY_check_key(ec_key) != 1) {
@@ -621,9 +700,9 @@ static int ecdsa_sign_write(const knot_dnssec_sign_context_t *context,
 
 	// create raw signature
 
-	uint8_t *raw_signature = NULL;
+	const uint8_t *raw_signature = NULL;
 	size_t raw_size = 0;
-	int result = sign_alloc_and_write(context, &raw_signature, &raw_size);
+	int result = sign_raw_write(context, &raw_signature, &raw_size);
 	if (result != KNOT_EOK) {
 		return result;
 	}
@@ -632,19 +711,15 @@ static int ecdsa_sign_write(const knot_dnssec_sign_context_t *context,
 
 	ECDSA_SIG *decoded = ECDSA_SIG_new();
 	if (!decoded) {
-		free(raw_signature);
 		return KNOT_ENOMEM;
 	}
 
 	const uint8_t *decode_scan = raw_signature;
 	if (!d2i_ECDSA_SIG(&decoded, &decode_scan, (long)raw_size)) {
 		ECDSA_SIG_free(decoded);
-		free(raw_signature);
 		return KNOT_DNSSEC_EDECODE_RAW_SIGNATURE;
 	}
 
-	free(raw_signature);
-
 	// convert to format defined by RFC 6605 (EC DSA for DNSSEC)
 	// R and S parameters are encoded in halves of the output signature
 
@@ -692,17 +767,16 @@ static int ecdsa_sign_verify(const knot_dnssec_sign_context_t *context,
 	decoded->r = BN_bin2bn(signature_r, parameter_size, decoded->r);
 	decoded->s = BN_bin2bn(signature_s, parameter_size, decoded->s);
 
-	size_t max_size = EVP_PKEY_size(context->key->data->private_key);
-	uint8_t *raw_signature = malloc(max_size);
-	if (!raw_signature) {
+	// encoded signature is not larger than the context buffer
+	if (i2d_ECDSA_SIG(decoded, NULL) > (int)context->raw_size) {
 		ECDSA_SIG_free(decoded);
-		return KNOT_ENOMEM;
+		return KNOT_DNSSEC_EDECODE_RAW_SIGNATURE;
 	}
 
+	uint8_t *raw_signature = context->raw_signature;
 	uint8_t *raw_write = raw_signature;
 	int raw_size = i2d_ECDSA_SIG(decoded, &raw_write);
 	if (raw_size < 0) {
-		free(raw_signature);
 		ECDSA_SIG_free(decoded);
 		return KNOT_DNSSEC_EDECODE_RAW_SIGNATURE;
 	}
@@ -712,8 +786,6 @@ static int ecdsa_sign_verify(const knot_dnssec_sign_context_t *context,
 
 	ECDSA_SIG_free(decoded);
 
-	free(raw_signature);
-
 	return result;
 }
 
@@ -1153,6 +1225,52 @@ int knot_dnssec_key_from_params(const knot_key_params_t *params,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Fill DNSSEC key structure with a public key from DNSKEY RDATA.
+ */
+int knot_dnssec_key_from_dnskey(const knot_dname_t *owner,
+                                const uint8_t *rdata, size_t rdata_size,
+                                knot_dnssec_key_t *key)
+{
+	if (!owner || !rdata || !key) {
+		return KNOT_EINVAL;
+	}
+
+	if (rdata_size <= DNSKEY_RDATA_PUBKEY_OFFSET) {
+		return KNOT_DNSSEC_EINVALID_KEY;
+	}
+
+	knot_key_params_t params = { 0 };
+	params.name = (knot_dname_t *)owner;
+	params.rdata.data = (uint8_t *)rdata;
+	params.rdata.size = rdata_size;
+	params.algorithm = rdata[3];
+	params.keytag = knot_keytag(rdata, rdata_size);
+	params.flags = knot_wire_read_u16(rdata);
+
+	const algorithm_functions_t *functions =
+		get_implementation(params.algorithm);
+
+	int result = KNOT_EOK;
+	if (functions == &rsa_functions) {
+		result = rsa_dnskey_params(&params.rdata, &params);
+	} else if (functions == &dsa_functions) {
+		result = dsa_dnskey_params(&params.rdata, &params);
+#ifdef KNOT_ENABLE_ECDSA
+	} else if (functions == &ecdsa_functions) {
+		// public key is taken from the RDATA directly
+#endif
+	} else {
+		result = KNOT_DNSSEC_ENOTSUP;
+	}
+
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	return knot_dnssec_key_from_params(&params, key);
+}
+
 /*!
  * \brief Free DNSSEC key structure content.
  */
@@ -1194,7 +1312,16 @@ knot_dnssec_sign_context_t *knot_dnssec_sign_init(const knot_dnssec_key_t *key)
 
 	context->key = key;
 
+	// signatures in OpenSSL format are never larger than the key size
+	context->raw_size = EVP_PKEY_size(key->data->private_key);
+	context->raw_signature = malloc(context->raw_size);
+	if (!context->raw_signature) {
+		free(context);
+		return NULL;
+	}
+
 	if (create_digest_context(key, &context->digest_context) != KNOT_EOK) {
+		free(context->raw_signature);
 		free(context);
 		return NULL;
 	}
@@ -1213,6 +1340,7 @@ void knot_dnssec_sign_free(knot_dnssec_sign_context_t *context)
 
 	context->key = NULL;
 	destroy_digest_context(&context->digest_context);
+	free(context->raw_signature);
 	free(context);
 }
 
@@ -1237,8 +1365,13 @@ int knot_dnssec_sign_new(knot_dnssec_sign_context_t *context)
 		return KNOT_EINVAL;
 	}
 
-	destroy_digest_context(&context->digest_context);
-	return create_digest_context(context->key, &context->digest_context);
+	// reinitialize the digest, the context memory is reused
+	EVP_MD_CTX *digest_ctx = context->digest_context;
+	if (!EVP_DigestInit_ex(digest_ctx, EVP_MD_CTX_md(digest_ctx), NULL)) {
+		return KNOT_DNSSEC_ECREATE_DIGEST_CONTEXT;
+	}
+
+	return KNOT_EOK;
 }
 
 /*!
@@ -68,6 +68,23 @@ typedef struct {
 int knot_dnssec_key_from_params(const knot_key_params_t *params,
                                 knot_dnssec_key_t *key);
 
+/*!
+ * \brief Fill DNSSEC key structure with a public key from DNSKEY RDATA.
+ *
+ * The key can be used only to verify signatures. RSA, DSA, and ECDSA
+ * algorithms are supported.
+ *
+ * \param owner       DNSKEY owner (signer name).
+ * \param rdata       DNSKEY RDATA.
+ * \param rdata_size  DNSKEY RDATA size.
+ * \param key         Output structure.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_dnssec_key_from_dnskey(const knot_dname_t *owner,
+                                const uint8_t *rdata, size_t rdata_size,
+                                knot_dnssec_key_t *key);
+
 /*!
  * \brief Free DNSSEC key structure content.
  *
@@ -59,8 +59,23 @@ int knot_edns_new_from_rr(knot_opt_rr_t *opt_rr, const knot_rrset_t *rrset)
 		return KNOT_EINVAL;
 	}
 
+	return knot_edns_new_from_wire(opt_rr, rrset->rclass,
+	                               knot_rrset_rr_ttl(rrset, 0),
+	                               knot_rrset_rr_rdata(rrset, 0),
+	                               knot_rrset_rr_size(rrset, 0));
+}
+
+/*----------------------------------------------------------------------------*/
+
+int knot_edns_new_from_wire(knot_opt_rr_t *opt_rr, uint16_t rclass,
+                            uint32_t rr_ttl, const uint8_t *raw, uint16_t size)
+{
+	if (opt_rr == NULL || (raw == NULL && size > 0)) {
+		return KNOT_EINVAL;
+	}
+
 	dbg_edns_verb("Parsing payload.\n");
-	opt_rr->payload = rrset->rclass;
+	opt_rr->payload = rclass;
 
 	/* RFC6891, 6.2.5 Value < 512B should be treated as 512. */
 	if (opt_rr->payload < EDNS_MIN_UDP_PAYLOAD) {
@@ -69,8 +84,8 @@ int knot_edns_new_from_rr(knot_opt_rr_t *opt_rr, const knot_rrset_t *rrset)
 
 	// TTL has switched bytes
 	uint32_t ttl;
-	dbg_edns_detail("TTL: %u\n", knot_rrset_rr_ttl(rrset, 0));
-	knot_wire_write_u32((uint8_t *)&ttl, knot_rrset_rr_ttl(rrset, 0));
+	dbg_edns_detail("TTL: %u\n", rr_ttl);
+	knot_wire_write_u32((uint8_t *)&ttl, rr_ttl);
 	// first byte of TTL is extended RCODE
 	dbg_edns_detail("TTL: %u\n", ttl);
 	memcpy(&opt_rr->ext_rcode, &ttl, 1);
@@ -86,14 +101,12 @@ int knot_edns_new_from_rr(knot_opt_rr_t *opt_rr, const knot_rrset_t *rrset)
 
 	int rc = 0;
 	dbg_edns_verb("Parsing options.\n");
-	uint16_t size = knot_rrset_rr_size(rrset, 0);
 	if (size > 0) {
-		uint8_t *raw = knot_rrset_rr_rdata(rrset, 0);
 		size_t pos = 0;
 		while (pos < size) {
 			// ensure there is enough data to parse the OPTION CODE
 			// and OPTION LENGTH
-			if (size - pos + 2 < 4) {
+			if (size - pos < 4) {
 				dbg_edns("Not enough data to parse.\n");
 				return KNOT_EMALF;
 			}
@@ -102,7 +115,7 @@ int knot_edns_new_from_rr(knot_opt_rr_t *opt_rr, const knot_rrset_t *rrset)
 
 			// there should be enough data for parsing the OPTION
 			// data
-			if (size - pos < opt_size) {
+			if (size - pos - 4 < opt_size) {
 				dbg_edns("Not enough data to parse options: "
 				         "size - pos=%zu, opt_size=%d\n",
 				         size - pos, opt_size);
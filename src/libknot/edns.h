@@ -112,6 +112,22 @@ knot_opt_rr_t *knot_edns_new();
  */
 int knot_edns_new_from_rr(knot_opt_rr_t *opt_rr, const knot_rrset_t *rrset);
 
+/*!
+ * \brief Initializes OPT RR structure from OPT RR fields in wire format.
+ *
+ * \param opt_rr OPT RR structure to initialize.
+ * \param rclass RR CLASS (UDP payload size).
+ * \param rr_ttl RR TTL (extended RCODE, version and flags).
+ * \param raw RDATA.
+ * \param size RDATA length.
+ *
+ * \retval KNOT_EOK
+ * \retval KNOT_EINVAL
+ * \retval KNOT_EMALF
+ */
+int knot_edns_new_from_wire(knot_opt_rr_t *opt_rr, uint16_t rclass,
+                            uint32_t rr_ttl, const uint8_t *raw, uint16_t size);
+
 /*!
  * \brief Returns the UDP payload stored in the OPT RR.
  *
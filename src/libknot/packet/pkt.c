@@ -202,6 +202,27 @@ knot_pkt_t *knot_pkt_new(void *wire, uint16_t len, mm_ctx_t *mm)
 	return pkt_new_mm(wire, len, mm);
 }
 
+int knot_pkt_init(knot_pkt_t *pkt, void *wire, uint16_t len, mm_ctx_t *mm)
+{
+	dbg_packet("%s(%p, %p, %hu, %p)\n", __func__, pkt, wire, len, mm);
+	if (pkt == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Default memory allocator if NULL. */
+	if (mm == NULL) {
+		mm_ctx_init(&pkt->mm);
+	} else {
+		memcpy(&pkt->mm, mm, sizeof(mm_ctx_t));
+	}
+
+	/* No data to free, the packet is either new or freed. */
+	pkt->rrset_count = 0;
+	int ret = pkt_reset(pkt, wire, len);
+	pkt->flags |= KNOT_PF_STATIC;
+	return ret;
+}
+
 int knot_pkt_init_response(knot_pkt_t *pkt, const knot_pkt_t *query)
 {
 	dbg_packet("%s(%p, %p)\n", __func__, pkt, query);
@@ -265,8 +286,11 @@ void knot_pkt_free(knot_pkt_t **pkt)
 	// free EDNS options
 	knot_edns_free_options(&(*pkt)->opt_rr);
 
-	dbg_packet("Freeing packet structure\n");
-	(*pkt)->mm.free(*pkt);
+	/* Preallocated structure is kept for reuse. */
+	if (!((*pkt)->flags & KNOT_PF_STATIC)) {
+		dbg_packet("Freeing packet structure\n");
+		(*pkt)->mm.free(*pkt);
+	}
 	*pkt = NULL;
 }
 
@@ -577,6 +601,78 @@ int knot_pkt_parse(knot_pkt_t *pkt, unsigned flags)
 	return ret;
 }
 
+/*! \brief Parse OPT RR in place, false if the RR is not a plain OPT. */
+static bool pkt_parse_opt_inplace(knot_pkt_t *pkt)
+{
+	/* OPT owner is root, compressed owner goes the generic way. */
+	const uint8_t *rr = pkt->wire + pkt->parsed;
+	size_t left = pkt->size - pkt->parsed;
+	if (left < 1 + KNOT_RR_HEADER_SIZE || rr[0] != '\0') {
+		return false;
+	}
+
+	rr += 1;
+	if (knot_wire_read_u16(rr) != KNOT_RRTYPE_OPT) {
+		return false;
+	}
+	uint16_t rclass = knot_wire_read_u16(rr + sizeof(uint16_t));
+	uint32_t ttl = knot_wire_read_u32(rr + 2 * sizeof(uint16_t));
+	uint16_t rdlength = knot_wire_read_u16(rr + 4 * sizeof(uint16_t));
+	if (left - 1 - KNOT_RR_HEADER_SIZE != rdlength) {
+		return false; /* Truncated or trailing data. */
+	}
+
+	int ret = knot_edns_new_from_wire(&pkt->opt_rr, rclass, ttl,
+	                                  rr + KNOT_RR_HEADER_SIZE, rdlength);
+	if (ret != KNOT_EOK) {
+		/* Leave error handling to the generic parser. */
+		knot_edns_free_options(&pkt->opt_rr);
+		memset(&pkt->opt_rr, 0, sizeof(knot_opt_rr_t));
+		pkt->opt_rr.version = EDNS_NOT_SUPPORTED;
+		pkt->opt_rr.size = EDNS_MIN_SIZE;
+		return false;
+	}
+
+	pkt->parsed = pkt->size;
+	return true;
+}
+
+int knot_pkt_parse_query(knot_pkt_t *pkt, unsigned flags)
+{
+	dbg_packet("%s(%p, %u)\n", __func__, pkt, flags);
+	if (pkt == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Standard query with a single question and optional OPT. */
+	const uint8_t *wire = pkt->wire;
+	if (pkt->size < KNOT_WIRE_HEADER_SIZE ||
+	    knot_wire_get_qr(wire) ||
+	    knot_wire_get_opcode(wire) != KNOT_OPCODE_QUERY ||
+	    knot_wire_get_qdcount(wire) != 1 ||
+	    knot_wire_get_ancount(wire) != 0 ||
+	    knot_wire_get_nscount(wire) != 0 ||
+	    knot_wire_get_arcount(wire) > 1) {
+		return knot_pkt_parse(pkt, flags);
+	}
+
+	int ret = knot_pkt_parse_question(pkt);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (knot_wire_get_arcount(wire) == 0) {
+		if (pkt->parsed == pkt->size) {
+			return KNOT_EOK;
+		}
+	} else if (pkt_parse_opt_inplace(pkt)) {
+		return KNOT_EOK;
+	}
+
+	/* Anything else (TSIG, trailing data) needs the full parser. */
+	return knot_pkt_parse_payload(pkt, flags);
+}
+
 int knot_pkt_parse_question(knot_pkt_t *pkt)
 {
 	dbg_packet("%s(%p)\n", __func__, pkt);
@@ -72,7 +72,8 @@ enum {
 	KNOT_PF_FREE      = 1 << 1, /*!< Free with packet. */
 	KNOT_PF_NOTRUNC   = 1 << 2, /*!< Don't truncate. */
 	KNOT_PF_CHECKDUP  = 1 << 3, /*!< Check for duplicates. */
-	KNOT_PF_KEEPWIRE  = 1 << 4  /*!< Keep wireformat untouched when parsing. */
+	KNOT_PF_KEEPWIRE  = 1 << 4, /*!< Keep wireformat untouched when parsing. */
+	KNOT_PF_STATIC    = 1 << 5  /*!< Packet structure is not owned by the packet. */
 };
 
 /*!
@@ -130,6 +131,22 @@ typedef struct knot_pkt {
  */
 knot_pkt_t *knot_pkt_new(void *wire, uint16_t len, mm_ctx_t *mm);
 
+/*!
+ * \brief Initialize preallocated packet structure for reuse.
+ *
+ * \note Packet is marked with KNOT_PF_STATIC, so knot_pkt_free() releases
+ *       only the packet data and the structure may be initialized again
+ *       for the next packet.
+ *
+ * \param pkt Packet structure (unused or freed by knot_pkt_free()).
+ * \param wire If NULL, memory of 'len' size shall be allocated.
+ *        Otherwise pointer is used for the wire format of the packet.
+ * \param len Wire format length.
+ * \param mm Memory context (NULL for default).
+ * \return KNOT_EOK, KNOT_EINVAL, KNOT_ENOMEM
+ */
+int knot_pkt_init(knot_pkt_t *pkt, void *wire, uint16_t len, mm_ctx_t *mm);
+
 /*!
  * \brief Initialized response from query packet.
  *
@@ -251,6 +268,20 @@ const knot_pktsection_t *knot_pkt_section(const knot_pkt_t *pkt, knot_section_t
  */
 int knot_pkt_parse(knot_pkt_t *pkt, unsigned flags);
 
+/*!
+ * \brief Parse incoming query.
+ *
+ * Standard queries with a single question and at most an OPT RR in the
+ * additional section are validated in place, OPT is parsed directly from
+ * the wire and no RRSets are created. Other packets (TSIG, UPDATE, NOTIFY,
+ * transfers with records) are parsed by \fn knot_pkt_parse.
+ *
+ * \param pkt Given packet.
+ * \param flags Parsing flags (allowed KNOT_PF_KEEPWIRE)
+ * \return KNOT_EOK, KNOT_EMALF and other errors
+ */
+int knot_pkt_parse_query(knot_pkt_t *pkt, unsigned flags);
+
 /*!
  * \brief Parse packet header and a QUESTION section.
  */
@@ -18,6 +18,7 @@
 
 #include "libknot/processing/process.h"
 #include "common/debug.h"
+#include "common/errcode.h"
 
 /* State -> string translation table. */
 #ifdef KNOT_NS_DEBUG
@@ -74,6 +75,21 @@ int knot_process_finish(knot_process_t *ctx)
 	return ctx->state;
 }
 
+/*! \brief Use preallocated packet if available or create a new one. */
+static knot_pkt_t *process_pkt(knot_pkt_t *prealloc, uint8_t *wire,
+                               uint16_t wire_len, mm_ctx_t *mm)
+{
+	if (prealloc == NULL) {
+		return knot_pkt_new(wire, wire_len, mm);
+	}
+
+	if (knot_pkt_init(prealloc, wire, wire_len, mm) != KNOT_EOK) {
+		return NULL;
+	}
+
+	return prealloc;
+}
+
 int knot_process_in(const uint8_t *wire, uint16_t wire_len, knot_process_t *ctx)
 {
 	/* Only if expecting data. */
@@ -81,8 +97,9 @@ int knot_process_in(const uint8_t *wire, uint16_t wire_len, knot_process_t *ctx)
 		return NS_PROC_NOOP;
 	}
 
-	knot_pkt_t *pkt = knot_pkt_new((uint8_t *)wire, wire_len, &ctx->mm);
-	knot_pkt_parse(pkt, 0);
+	knot_pkt_t *pkt = process_pkt(ctx->pkt_in, (uint8_t *)wire, wire_len,
+	                              &ctx->mm);
+	knot_pkt_parse_query(pkt, 0);
 
 	ctx->state = ctx->module->in(pkt, ctx);
 	dbg_ns("%s -> %s\n", __func__, PROCESSING_STATE_STR(ctx->state));
@@ -91,7 +108,7 @@ int knot_process_in(const uint8_t *wire, uint16_t wire_len, knot_process_t *ctx)
 
 int knot_process_out(uint8_t *wire, uint16_t *wire_len, knot_process_t *ctx)
 {
-	knot_pkt_t *pkt = knot_pkt_new(wire, *wire_len, &ctx->mm);
+	knot_pkt_t *pkt = process_pkt(ctx->pkt_out, wire, *wire_len, &ctx->mm);
 
 	switch(ctx->state) {
 	case NS_PROC_FULL: ctx->state = ctx->module->out(pkt, ctx); break;
@@ -55,6 +55,10 @@ typedef struct knot_process_context
 	uint16_t type;   /* Module identifier. */
 	mm_ctx_t mm;     /* Processing memory context. */
 
+	/* Preallocated packets reused for input and output (optional). */
+	knot_pkt_t *pkt_in;
+	knot_pkt_t *pkt_out;
+
 	/* Module specific. */
 	void *data;
 	const struct knot_process_module *module;
@@ -16,6 +16,8 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <pthread.h>
+#include <sys/uio.h>
 #include <openssl/hmac.h>
 #include <openssl/evp.h>
 #include <time.h>
@@ -66,27 +68,147 @@ static int knot_tsig_check_key(const knot_rrset_t *tsig_rr,
 		return KNOT_EMALF;
 	}
 
-	char *name = knot_dname_to_str(tsig_name);
-	if (!name) {
-		return KNOT_EMALF;
-	}
-
 	if (knot_dname_cmp(tsig_name, tsig_key->name) != 0) {
 		/*!< \todo which error. */
-		dbg_tsig("TSIG: unknown key: %s\n", name);
-		free(name);
+		dbg_tsig("TSIG: unknown key.\n");
 		return KNOT_TSIG_EBADKEY;
 	}
 
-	free(name);
 	return KNOT_EOK;
 }
 
-static int knot_tsig_compute_digest(const uint8_t *wire, size_t wire_len,
+/*! \brief Number of HMAC contexts cached by each thread. */
+#define TSIG_HMAC_CACHE 4
+
+/*!
+ * \brief Per-thread cache of keyed HMAC contexts.
+ *
+ * HMAC context initialized with the key holds the inner and outer digest
+ * states after hashing of the padded key. Reinitialization without the key
+ * only copies these states, so the key setup is done once per key and thread,
+ * not once per message.
+ */
+struct tsig_hmac_cache {
+	struct {
+		knot_tsig_algorithm_t algorithm;
+		knot_binary_t secret; /* Copy of the secret for cache lookup. */
+		HMAC_CTX *ctx;
+	} entry[TSIG_HMAC_CACHE];
+	unsigned next; /* Next entry to be replaced. */
+};
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static HMAC_CTX *HMAC_CTX_new(void)
+{
+	HMAC_CTX *ctx = malloc(sizeof(HMAC_CTX));
+	if (ctx != NULL) {
+		HMAC_CTX_init(ctx);
+	}
+	return ctx;
+}
+
+static void HMAC_CTX_free(HMAC_CTX *ctx)
+{
+	if (ctx != NULL) {
+		HMAC_CTX_cleanup(ctx);
+		free(ctx);
+	}
+}
+#endif
+
+static pthread_key_t tsig_hmac_key;
+static pthread_once_t tsig_hmac_once = PTHREAD_ONCE_INIT;
+
+static void tsig_hmac_cache_free(void *data)
+{
+	struct tsig_hmac_cache *cache = data;
+	for (unsigned i = 0; i < TSIG_HMAC_CACHE; ++i) {
+		HMAC_CTX_free(cache->entry[i].ctx);
+		knot_binary_free(&cache->entry[i].secret);
+	}
+	free(cache);
+}
+
+static void tsig_hmac_cache_init(void)
+{
+	pthread_key_create(&tsig_hmac_key, tsig_hmac_cache_free);
+}
+
+static const EVP_MD *tsig_hmac_md(knot_tsig_algorithm_t tsig_alg)
+{
+	switch (tsig_alg) {
+	case KNOT_TSIG_ALG_HMAC_MD5:    return EVP_md5();
+	case KNOT_TSIG_ALG_HMAC_SHA1:   return EVP_sha1();
+	case KNOT_TSIG_ALG_HMAC_SHA224: return EVP_sha224();
+	case KNOT_TSIG_ALG_HMAC_SHA256: return EVP_sha256();
+	case KNOT_TSIG_ALG_HMAC_SHA384: return EVP_sha384();
+	case KNOT_TSIG_ALG_HMAC_SHA512: return EVP_sha512();
+	default:                        return NULL;
+	}
+}
+
+/*!
+ * \brief Get HMAC context of the calling thread initialized with the key.
+ *
+ * \note The context is valid until the next call from the same thread.
+ */
+static HMAC_CTX *tsig_hmac_begin(const knot_tsig_key_t *key, const EVP_MD *md)
+{
+	pthread_once(&tsig_hmac_once, tsig_hmac_cache_init);
+	struct tsig_hmac_cache *cache = pthread_getspecific(tsig_hmac_key);
+	if (cache == NULL) {
+		cache = calloc(1, sizeof(struct tsig_hmac_cache));
+		if (cache == NULL) {
+			return NULL;
+		}
+		pthread_setspecific(tsig_hmac_key, cache);
+	}
+
+	/* Reuse the precomputed key states. */
+	for (unsigned i = 0; i < TSIG_HMAC_CACHE; ++i) {
+		if (cache->entry[i].algorithm == key->algorithm &&
+		    cache->entry[i].secret.size == key->secret.size &&
+		    memcmp(cache->entry[i].secret.data, key->secret.data,
+		           key->secret.size) == 0) {
+			HMAC_Init_ex(cache->entry[i].ctx, NULL, 0, NULL, NULL);
+			return cache->entry[i].ctx;
+		}
+	}
+
+	/* Replace the oldest entry. */
+	unsigned i = cache->next;
+	cache->entry[i].algorithm = 0;
+	knot_binary_free(&cache->entry[i].secret);
+	if (cache->entry[i].ctx == NULL) {
+		cache->entry[i].ctx = HMAC_CTX_new();
+		if (cache->entry[i].ctx == NULL) {
+			return NULL;
+		}
+	}
+	if (knot_binary_dup(&key->secret, &cache->entry[i].secret) != KNOT_EOK) {
+		return NULL;
+	}
+
+	/* Empty key must not be NULL, that would mean 'reuse the key'. */
+	const uint8_t *secret = key->secret.data ? key->secret.data
+	                                         : (const uint8_t *)"";
+	HMAC_Init_ex(cache->entry[i].ctx, secret, key->secret.size, md, NULL);
+	cache->entry[i].algorithm = key->algorithm;
+	cache->next = (i + 1) % TSIG_HMAC_CACHE;
+	return cache->entry[i].ctx;
+}
+
+/*!
+ * \brief Compute HMAC of the concatenated data segments.
+ *
+ * Segments are hashed in place, the signed data doesn't need to be
+ * assembled in a contiguous buffer.
+ */
+static int knot_tsig_compute_digest(const struct iovec *data, int count,
                                     uint8_t *digest, size_t *digest_len,
                                     const knot_tsig_key_t *key)
 {
-	if (!wire || !digest || !digest_len || !key) {
+	if (!data || !digest || !digest_len || !key) {
 		dbg_tsig("TSIG: digest: bad args.\n");
 		return KNOT_EINVAL;
 	}
@@ -102,50 +224,32 @@ static int knot_tsig_compute_digest(const uint8_t *wire, size_t wire_len,
 		return KNOT_TSIG_EBADSIG;
 	}
 
+	const EVP_MD *md = tsig_hmac_md(tsig_alg);
+	if (md == NULL) {
+		return KNOT_ENOTSUP;
+	}
+
 	dbg_tsig_detail("TSIG: key size: %zu\n", key->secret.size);
 	dbg_tsig_detail("TSIG: key:\n");
 	dbg_tsig_hex_detail((char *)key->secret.data, key->secret.size);
-	dbg_tsig_detail("Wire for signing is %zu bytes long.\n", wire_len);
 
 	/* Compute digest. */
-	HMAC_CTX ctx;
+	HMAC_CTX *ctx = tsig_hmac_begin(key, md);
+	if (ctx == NULL) {
+		return KNOT_ENOMEM;
+	}
 
-	switch (tsig_alg) {
-		case KNOT_TSIG_ALG_HMAC_MD5:
-			HMAC_Init(&ctx, key->secret.data,
-			          key->secret.size, EVP_md5());
-			break;
-		case KNOT_TSIG_ALG_HMAC_SHA1:
-			HMAC_Init(&ctx, key->secret.data,
-			          key->secret.size, EVP_sha1());
-			break;
-		case KNOT_TSIG_ALG_HMAC_SHA224:
-			HMAC_Init(&ctx, key->secret.data,
-			          key->secret.size, EVP_sha224());
-			break;
-		case KNOT_TSIG_ALG_HMAC_SHA256:
-			HMAC_Init(&ctx, key->secret.data,
-			          key->secret.size, EVP_sha256());
-			break;
-		case KNOT_TSIG_ALG_HMAC_SHA384:
-			HMAC_Init(&ctx, key->secret.data,
-			          key->secret.size, EVP_sha384());
-			break;
-		case KNOT_TSIG_ALG_HMAC_SHA512:
-			HMAC_Init(&ctx, key->secret.data,
-			          key->secret.size, EVP_sha512());
-			break;
-		default:
-			return KNOT_ENOTSUP;
-	} /* switch */
+	for (int i = 0; i < count; ++i) {
+		dbg_tsig_detail("Signing segment of %zu bytes.\n", data[i].iov_len);
+		if (data[i].iov_len > 0) {
+			HMAC_Update(ctx, data[i].iov_base, data[i].iov_len);
+		}
+	}
 
 	unsigned tmp_dig_len = *digest_len;
-	HMAC_Update(&ctx, (const unsigned char *)wire, wire_len);
-	HMAC_Final(&ctx, digest, &tmp_dig_len);
+	HMAC_Final(ctx, digest, &tmp_dig_len);
 	*digest_len = tmp_dig_len;
 
-	HMAC_CTX_cleanup(&ctx);
-
 	return KNOT_EOK;
 }
 
@@ -186,6 +290,11 @@ static int knot_tsig_check_time_signed(const knot_rrset_t *tsig_rr,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Write TSIG variables except Other Data.
+ *
+ * \return Number of bytes written or an error.
+ */
 static int knot_tsig_write_tsig_variables(uint8_t *wire,
                                           const knot_rrset_t *tsig_rr)
 {
@@ -252,27 +361,15 @@ static int knot_tsig_write_tsig_variables(uint8_t *wire,
 	/* TSIG error. */
 	knot_wire_write_u16(wire + offset, tsig_rdata_error(tsig_rr));
 	offset += sizeof(uint16_t);
-	/* Get other data length. */
-	uint16_t other_data_length = tsig_rdata_other_data_length(tsig_rr);
-	/* Get other data. */
-	const uint8_t *other_data = tsig_rdata_other_data(tsig_rr);
-	if (!other_data) {
-		dbg_tsig("TSIG: write variables: no other data.\n");
-		return KNOT_EINVAL;
-	}
 
 	/*
 	 * We cannot write the whole other_data, as it contains its length in
 	 * machine order.
 	 */
-	knot_wire_write_u16(wire + offset, other_data_length);
+	knot_wire_write_u16(wire + offset, tsig_rdata_other_data_length(tsig_rr));
 	offset += sizeof(uint16_t);
 
-	/* Skip the length. */
-	dbg_tsig_verb("Copying other data.\n");
-	memcpy(wire + offset, other_data, other_data_length);
-
-	return KNOT_EOK;
+	return offset;
 }
 
 static int knot_tsig_wire_write_timers(uint8_t *wire,
@@ -303,67 +400,48 @@ static int knot_tsig_create_sign_wire(const uint8_t *msg, size_t msg_len,
 		return KNOT_EINVAL;
 	}
 
-	/* Create tmp TSIG. */
-	int ret = KNOT_EOK;
-
 	/*
-	 * Create tmp wire, it should contain message
-	 * plus request mac plus tsig varibles.
+	 * Signed data is request MAC, the message and TSIG variables,
+	 * only the request MAC length and TSIG variables are written out.
 	 */
-	dbg_tsig_verb("Counting wire size: %zu, %zu, %zu.\n",
-	              msg_len, request_mac_len,
-	              tsig_rdata_tsig_variables_length(tmp_tsig));
-	size_t wire_len = sizeof(uint8_t) *
-			(msg_len + request_mac_len + ((request_mac_len > 0)
-			 ? 2 : 0) +
-			tsig_rdata_tsig_variables_length(tmp_tsig));
-	uint8_t *wire = malloc(wire_len);
-	if (!wire) {
-		ERR_ALLOC_FAILED;
-		return KNOT_ENOMEM;
-	}
-
-	memset(wire, 0, wire_len);
+	uint8_t mac_len_wire[sizeof(uint16_t)];
+	knot_wire_write_u16(mac_len_wire, request_mac_len);
 
-	uint8_t *pos = wire;
+	uint8_t vars[2 * KNOT_DNAME_MAXLEN + KNOT_TSIG_VARIABLES_LENGTH];
+	int vars_len = knot_tsig_write_tsig_variables(vars, tmp_tsig);
+	if (vars_len < 0) {
+		dbg_tsig("TSIG: create wire: failed to write TSIG "
+		         "variables: %s\n", knot_strerror(vars_len));
+		return vars_len;
+	}
 
-	/* Copy the request MAC - should work even if NULL. */
-	if (request_mac_len > 0) {
-		dbg_tsig_verb("Copying request MAC size\n");
-		knot_wire_write_u16(pos, request_mac_len);
-		pos += 2;
-		dbg_tsig_verb("Copying request mac.\n");
-		memcpy(pos, request_mac, sizeof(uint8_t) * request_mac_len);
+	const uint8_t *other_data = tsig_rdata_other_data(tmp_tsig);
+	if (!other_data) {
+		dbg_tsig("TSIG: create wire: no other data.\n");
+		return KNOT_EINVAL;
 	}
+
 	dbg_tsig_detail("TSIG: create wire: request mac:\n");
-	dbg_tsig_hex_detail((char *)pos, request_mac_len);
-	pos += request_mac_len;
-	/* Copy the original message. */
-	dbg_tsig_verb("Copying original message.\n");
-	memcpy(pos, msg, msg_len);
-	pos += msg_len;
-	/* Copy TSIG variables. */
-	dbg_tsig_verb("Writing TSIG variables.\n");
-	ret = knot_tsig_write_tsig_variables(pos, tmp_tsig);
-	if (ret != KNOT_EOK) {
-		dbg_tsig("TSIG: create wire: failed to write TSIG "
-		         "variables: %s\n", knot_strerror(ret));
-		free(wire);
-		return ret;
-	}
+	dbg_tsig_hex_detail((char *)request_mac, request_mac_len);
+
+	struct iovec data[] = {
+		{ mac_len_wire, (request_mac_len > 0) ? sizeof(mac_len_wire) : 0 },
+		{ (void *)request_mac, request_mac_len },
+		{ (void *)msg, msg_len },
+		{ vars, vars_len },
+		{ (void *)other_data, tsig_rdata_other_data_length(tmp_tsig) }
+	};
 
 	/* Compute digest. */
-	ret = knot_tsig_compute_digest(wire, wire_len, digest, digest_len, key);
+	int ret = knot_tsig_compute_digest(data, sizeof(data) / sizeof(*data),
+	                                   digest, digest_len, key);
 	if (ret != KNOT_EOK) {
 		dbg_tsig("TSIG: create wire: failed to compute digest: %s\n",
 		         knot_strerror(ret));
 		*digest_len = 0;
-		free(wire);
 		return ret;
 	}
 
-	free(wire);
-
 	return KNOT_EOK;
 }
 
@@ -379,62 +457,38 @@ static int knot_tsig_create_sign_wire_next(const uint8_t *msg, size_t msg_len,
 		return KNOT_EINVAL;
 	}
 
-	/* Create tmp TSIG. */
-	int ret = KNOT_EOK;
+	/* Signed data is previous MAC, the message and TSIG timers. */
+	uint8_t mac_len_wire[sizeof(uint16_t)];
+	knot_wire_write_u16(mac_len_wire, prev_mac_len);
 
-	/*
-	 * Create tmp wire, it should contain message
-	 * plus request mac plus tsig varibles.
-	 */
-	dbg_tsig_verb("Counting wire size: %zu, %zu, %zu.\n",
-	              msg_len, prev_mac_len,
-	              tsig_rdata_tsig_timers_length());
-	size_t wire_len = sizeof(uint8_t) *
-	                (msg_len + prev_mac_len +
-			tsig_rdata_tsig_timers_length() + 2);
-	uint8_t *wire = malloc(wire_len);
-	if (!wire) {
-		ERR_ALLOC_FAILED;
-		return KNOT_ENOMEM;
-	}
-
-	memset(wire, 0, wire_len);
-
-	/* Copy the request MAC - should work even if NULL. */
-	dbg_tsig_verb("Copying request mac size.\n");
-	knot_wire_write_u16(wire, prev_mac_len);
-	dbg_tsig_verb("Copying request mac.\n");
-	memcpy(wire + 2, prev_mac, sizeof(uint8_t) * prev_mac_len);
-	dbg_tsig_detail("TSIG: create wire: request mac:\n");
-	dbg_tsig_hex_detail((char *)(wire + 2), prev_mac_len);
-	/* Copy the original message. */
-	dbg_tsig_verb("Copying original message.\n");
-	memcpy(wire + prev_mac_len + 2, msg, msg_len);
-	/* Copy TSIG variables. */
-
-	dbg_tsig_verb("Writing TSIG timers.\n");
-	ret = knot_tsig_wire_write_timers(wire + prev_mac_len + msg_len + 2,
-	                                  tmp_tsig);
+	uint8_t timers[KNOT_TSIG_TIMERS_LENGTH];
+	int ret = knot_tsig_wire_write_timers(timers, tmp_tsig);
 	if (ret != KNOT_EOK) {
 		dbg_tsig("TSIG: create wire: failed to write TSIG "
 		         "timers: %s\n", knot_strerror(ret));
-		free(wire);
 		return ret;
 	}
 
+	dbg_tsig_detail("TSIG: create wire: request mac:\n");
+	dbg_tsig_hex_detail((char *)prev_mac, prev_mac_len);
+
+	struct iovec data[] = {
+		{ mac_len_wire, sizeof(mac_len_wire) },
+		{ (void *)prev_mac, prev_mac_len },
+		{ (void *)msg, msg_len },
+		{ timers, sizeof(timers) }
+	};
+
 	/* Compute digest. */
-	ret = knot_tsig_compute_digest(wire, wire_len,
+	ret = knot_tsig_compute_digest(data, sizeof(data) / sizeof(*data),
 	                               digest, digest_len, key);
 	if (ret != KNOT_EOK) {
 		dbg_tsig("TSIG: create wire: failed to compute digest: %s\n",
 		         knot_strerror(ret));
 		*digest_len = 0;
-		free(wire);
 		return ret;
 	}
 
-	free(wire);
-
 	return KNOT_EOK;
 }
 
@@ -561,40 +615,10 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	tsig_rdata_store_current_time(tmp_tsig);
 	tsig_rdata_set_fudge(tmp_tsig, KNOT_TSIG_FUDGE_DEFAULT);
 
-	/* Create wire to be signed. */
-	size_t wire_len = prev_digest_len + to_sign_len
-	                  + KNOT_TSIG_TIMERS_LENGTH + 2;
-	uint8_t *wire = malloc(wire_len);
-	if (!wire) {
-		ERR_ALLOC_FAILED;
-		knot_rrset_free(&tmp_tsig, NULL);
-		return KNOT_ENOMEM;
-	}
-	memset(wire, 0, wire_len);
-
-	/* Write previous digest length. */
-	knot_wire_write_u16(wire, prev_digest_len);
-	/* Write previous digest. */
-	memcpy(wire + 2, prev_digest, sizeof(uint8_t) * prev_digest_len);
-	/* Write original message. */
-	memcpy(wire + prev_digest_len + 2, to_sign, to_sign_len);
-	/* Write timers. */
-	knot_tsig_wire_write_timers(wire + prev_digest_len + to_sign_len + 2,
-	                            tmp_tsig);
-
-	dbg_tsig_detail("Previous digest: \n");
-	dbg_tsig_hex_detail((char *)prev_digest, prev_digest_len);
-
-	dbg_tsig_detail("Timers: \n");
-	dbg_tsig_hex_detail((char *)(wire + prev_digest_len + *msg_len),
-			    KNOT_TSIG_TIMERS_LENGTH);
-
-	int ret = KNOT_ERROR;
-	ret = knot_tsig_compute_digest(wire, wire_len,
-	                               digest_tmp, &digest_tmp_len, key);
-
-	/* No matter how the function did, this data is no longer needed. */
-	free(wire);
+	int ret = knot_tsig_create_sign_wire_next(to_sign, to_sign_len,
+	                                          prev_digest, prev_digest_len,
+	                                          digest_tmp, &digest_tmp_len,
+	                                          tmp_tsig, key);
 	if (ret != KNOT_EOK) {
 		knot_rrset_free(&tmp_tsig, NULL);
 		*digest_len = 0;
@@ -689,34 +713,24 @@ static int knot_tsig_check_digest(const knot_rrset_t *tsig_rr,
 
 	dbg_tsig_verb("TSIG: key validity checked.\n");
 
-	uint8_t *wire_to_sign = malloc(sizeof(uint8_t) * size);
-	if (!wire_to_sign) {
-		ERR_ALLOC_FAILED;
-		return KNOT_ENOMEM;
-	}
-
-	memset(wire_to_sign, 0, sizeof(uint8_t) * size);
-	memcpy(wire_to_sign, wire, size);
-
 	uint8_t digest_tmp[KNOT_TSIG_MAX_DIGEST_SIZE];
 	size_t digest_tmp_len = 0;
 	assert(tsig_rr->rrs.rr_count > 0);
 
 	if (use_times) {
 		/* Wire is not a single packet, TSIG RRs must be stripped already. */
-		ret = knot_tsig_create_sign_wire_next(wire_to_sign, size,
+		ret = knot_tsig_create_sign_wire_next(wire, size,
 		                                 request_mac, request_mac_len,
 		                                 digest_tmp, &digest_tmp_len,
 		                                 tsig_rr, tsig_key);
 	} else {
-		ret = knot_tsig_create_sign_wire(wire_to_sign, size,
+		ret = knot_tsig_create_sign_wire(wire, size,
 		                                 request_mac, request_mac_len,
 		                                 digest_tmp, &digest_tmp_len,
 		                                 tsig_rr, tsig_key);
 	}
 
 	assert(tsig_rr->rrs.rr_count > 0);
-	free(wire_to_sign);
 
 	if (ret != KNOT_EOK) {
 		dbg_tsig("Failed to create wire format for checking: %s.\n",
@@ -22,10 +22,11 @@
 #include "common/errcode.h"
 #include "common/sockaddr.h"
 #include "knot/updates/acl.h"
+#include "libknot/dname.h"
 
 int main(int argc, char *argv[])
 {
-	plan(14);
+	plan(19);
 
 	// 1. Create an ACL
 	acl_match_t *match = NULL;
@@ -107,6 +108,40 @@ int main(int argc, char *argv[])
 	sockaddr_set(&match_pf4, AF_INET, "82.87.48.136", 12345);
 	match = acl_find(acl, &match_pf4, NULL);
 	ok(match != NULL, "acl: scenario after truncating");
+
+	// 19. Nested prefixes with keys, first inserted rule wins
+	acl_truncate(acl);
+	knot_tsig_key_t key_a = { .name = knot_dname_from_str("a.") };
+	knot_dname_t *key_b = knot_dname_from_str("b.");
+	struct sockaddr_storage net8, net16, net24, any;
+	sockaddr_set(&net8, AF_INET, "10.0.0.0", 0);
+	sockaddr_set(&net16, AF_INET, "10.1.0.0", 0);
+	sockaddr_set(&net24, AF_INET, "10.1.2.0", 0);
+	sockaddr_set(&any, AF_INET, "0.0.0.0", 0);
+	acl_insert(acl, &net8, 8, &key_a);
+	acl_insert(acl, &net16, 16, NULL);
+	acl_insert(acl, &net24, 24, NULL);
+	acl_insert(acl, &net24, 24, &key_a);
+	sockaddr_set(&test_pf4, AF_INET, "10.1.2.3", 0);
+	match = acl_find(acl, &test_pf4, NULL);
+	ok(match != NULL && match->netblock.prefix == 16,
+	   "acl: first inserted of nested prefixes");
+	match = acl_find(acl, &test_pf4, key_a.name);
+	ok(match != NULL && match->netblock.prefix == 8,
+	   "acl: first inserted of nested prefixes with key");
+	match = acl_find(acl, &test_pf4, key_b);
+	ok(match == NULL, "acl: nested prefixes with unknown key");
+
+	// 20. Catch-all rule
+	acl_insert(acl, &any, 0, NULL);
+	sockaddr_set(&test_pf4, AF_INET, "192.0.2.1", 0);
+	match = acl_find(acl, &test_pf4, NULL);
+	ok(match != NULL && match->netblock.prefix == 0, "acl: catch-all prefix");
+	match = acl_find(acl, &test_pf6, NULL);
+	ok(match == NULL, "acl: catch-all prefix in other family");
+
+	knot_dname_free(&key_a.name, NULL);
+	knot_dname_free(&key_b, NULL);
 	acl_delete(&acl);
 
 	// Return
@@ -0,0 +1,1069 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file micro.c
+ *
+ * \brief Microbenchmarks of the core data structures (knot-microbench).
+ *
+ * Each benchmark runs over a data set generated from a fixed seed, so the
+ * results are comparable between builds on the same machine. Every benchmark
+ * is repeated several times, the best and the median time per operation
+ * is reported in 'name: value' lines. Insertion benchmarks also report
+ * the heap memory per inserted key (where the libc can tell).
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
+#include <netinet/in.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <sys/socket.h>
+#include <openssl/bn.h>
+#include <openssl/rsa.h>
+
+#include "common/errcode.h"
+#include "common/evsched.h"
+#include "common/hhash.h"
+#include "common/mempattern.h"
+#include "common/mempool.h"
+#include "common/descriptor.h"
+#include "common/hattrie/hat-trie.h"
+#include "common/qp-trie/trie.h"
+#include "common/slab/slab.h"
+#include "libknot/binary.h"
+#include "libknot/dname.h"
+#include "libknot/rdata.h"
+#include "libknot/rdataset.h"
+#include "libknot/rrset.h"
+#include "libknot/packet/compr.h"
+#include "libknot/packet/pkt.h"
+#include "libknot/packet/wire.h"
+#include "libknot/dnssec/config.h"
+#include "libknot/dnssec/crypto.h"
+#include "libknot/dnssec/policy.h"
+#include "libknot/dnssec/rrset-sign.h"
+#include "libknot/dnssec/sign.h"
+#include "knot/server/rrl.h"
+
+/*! \brief Default number of names in the data set. */
+#define BENCH_NAMES 65536
+/*! \brief Default number of runs of each benchmark. */
+#define BENCH_REPEAT 5
+/*! \brief Maximum number of runs of each benchmark. */
+#define BENCH_REPEAT_MAX 64
+/*! \brief Number of distinct query wires. */
+#define BENCH_QUERIES 1024
+/*! \brief Compressed names are written below this offset. */
+#define BENCH_COMPR_LIMIT (KNOT_WIRE_PTR_MAX - KNOT_DNAME_MAXLEN)
+/*! \brief Number of RRs added to a single RR set. */
+#define BENCH_RDATASET 32
+/*! \brief Number of scheduled events. */
+#define BENCH_EVENTS 1024
+/*! \brief Number of simultaneously allocated blocks. */
+#define BENCH_BLOCKS 256
+/*! \brief Number of RRL buckets. */
+#define BENCH_RRL_SIZE 393241
+/*! \brief Number of distinct RRL source addresses. */
+#define BENCH_RRL_ADDRS 4096
+/*! \brief Number of RR sets signed in each run. */
+#define BENCH_SIGNATURES 1024
+/*! \brief Number of RR sets signed at once by the batch benchmarks. */
+#define BENCH_SIGN_BATCH 64
+
+/*! \brief Data set shared by the benchmarks. */
+struct bench_data {
+	uint64_t rand;
+	size_t count;                 /* Present names (misses follow). */
+	knot_dname_t **names;         /* 2 * count names. */
+	uint8_t (*lf)[KNOT_DNAME_MAXLEN];
+	size_t *order;                /* Random permutation of 0..count-1. */
+	uint8_t *queries[BENCH_QUERIES];
+	uint16_t query_len[BENCH_QUERIES];
+	volatile uintptr_t sink;      /* Keeps results alive. */
+	struct timespec begin;
+	uint64_t nsec;
+	size_t mem;                   /* Memory held by the structure. */
+};
+
+/*! \brief Benchmark, returns number of performed operations. */
+typedef size_t (*bench_cb_t)(struct bench_data *);
+
+/*! \brief Deterministic xorshift generator (libc independent). */
+static uint64_t bench_rand(struct bench_data *d)
+{
+	d->rand ^= d->rand << 13;
+	d->rand ^= d->rand >> 7;
+	d->rand ^= d->rand << 17;
+	return d->rand;
+}
+
+static uint64_t bench_nsec(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+/*! \brief Start measured part of the benchmark. */
+static void bench_start(struct bench_data *d)
+{
+	clock_gettime(CLOCK_MONOTONIC, &d->begin);
+}
+
+/*! \brief Stop measured part of the benchmark. */
+static void bench_stop(struct bench_data *d)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	d->nsec += bench_nsec(&end) - bench_nsec(&d->begin);
+}
+
+/*! \brief Name at i-th position of the random permutation. */
+static inline size_t bench_pick(const struct bench_data *d, size_t i)
+{
+	return d->order[i % d->count];
+}
+
+/*! \brief Heap memory in use, including the allocator overhead. */
+static size_t bench_heap_used(void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 mi = mallinfo2();
+	return mi.uordblks + mi.hblkhd;
+#elif defined(__GLIBC__)
+	struct mallinfo mi = mallinfo();
+	return (unsigned)mi.uordblks + (unsigned)mi.hblkhd;
+#else
+	return 0; /* Not available. */
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+static size_t bench_hattrie_get(struct bench_data *d)
+{
+	size_t used = bench_heap_used();
+	hattrie_t *trie = hattrie_create();
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[bench_pick(d, i)];
+		*hattrie_get(trie, (const char *)lf + 1, *lf) = (value_t)lf;
+	}
+	bench_stop(d);
+	d->mem = bench_heap_used() - used;
+	hattrie_free(trie);
+	return d->count;
+}
+
+/*! \brief Create trie with present names. */
+static hattrie_t *bench_trie(struct bench_data *d)
+{
+	hattrie_t *trie = hattrie_create();
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[i];
+		*hattrie_get(trie, (const char *)lf + 1, *lf) = (value_t)lf;
+	}
+	hattrie_build_index(trie);
+	return trie;
+}
+
+static size_t bench_hattrie_tryget(struct bench_data *d)
+{
+	hattrie_t *trie = bench_trie(d);
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[bench_pick(d, i)];
+		d->sink += (uintptr_t)hattrie_tryget(trie, (const char *)lf + 1, *lf);
+	}
+	bench_stop(d);
+	hattrie_free(trie);
+	return d->count;
+}
+
+static size_t bench_hattrie_find_leq(struct bench_data *d)
+{
+	/* Half of the lookups are for names not in the trie. */
+	hattrie_t *trie = bench_trie(d);
+	value_t *val = NULL;
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		size_t idx = bench_pick(d, i) + (i % 2) * d->count;
+		const uint8_t *lf = d->lf[idx];
+		d->sink += hattrie_find_leq(trie, (const char *)lf + 1, *lf, &val);
+	}
+	bench_stop(d);
+	hattrie_free(trie);
+	return d->count;
+}
+
+static size_t bench_hattrie_iter(struct bench_data *d)
+{
+	/* Sorted iteration needs the order index. */
+	hattrie_t *trie = bench_trie(d);
+	bench_start(d);
+	hattrie_build_index(trie);
+	hattrie_iter_t *it = hattrie_iter_begin(trie, true);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		d->sink += (uintptr_t)*hattrie_iter_val(it);
+	}
+	hattrie_iter_free(it);
+	bench_stop(d);
+	hattrie_free(trie);
+	return d->count;
+}
+
+static size_t bench_qp_trie_get(struct bench_data *d)
+{
+	size_t used = bench_heap_used();
+	trie_t *trie = trie_create(NULL);
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[bench_pick(d, i)];
+		*trie_get_ins(trie, lf + 1, *lf) = (trie_val_t)lf;
+	}
+	bench_stop(d);
+	d->mem = bench_heap_used() - used;
+	trie_free(trie);
+	return d->count;
+}
+
+/*! \brief Create qp-trie with present names. */
+static trie_t *bench_qp_trie(struct bench_data *d)
+{
+	trie_t *trie = trie_create(NULL);
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[i];
+		*trie_get_ins(trie, lf + 1, *lf) = (trie_val_t)lf;
+	}
+	return trie;
+}
+
+static size_t bench_qp_trie_tryget(struct bench_data *d)
+{
+	trie_t *trie = bench_qp_trie(d);
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[bench_pick(d, i)];
+		d->sink += (uintptr_t)trie_get_try(trie, lf + 1, *lf);
+	}
+	bench_stop(d);
+	trie_free(trie);
+	return d->count;
+}
+
+static size_t bench_qp_trie_find_leq(struct bench_data *d)
+{
+	/* Half of the lookups are for names not in the trie. */
+	trie_t *trie = bench_qp_trie(d);
+	trie_val_t *val = NULL;
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		size_t idx = bench_pick(d, i) + (i % 2) * d->count;
+		const uint8_t *lf = d->lf[idx];
+		d->sink += trie_get_leq(trie, lf + 1, *lf, &val);
+	}
+	bench_stop(d);
+	trie_free(trie);
+	return d->count;
+}
+
+static size_t bench_qp_trie_iter(struct bench_data *d)
+{
+	trie_t *trie = bench_qp_trie(d);
+	bench_start(d);
+	trie_it_t *it = trie_it_begin(trie);
+	for (; !trie_it_finished(it); trie_it_next(it)) {
+		d->sink += (uintptr_t)*trie_it_val(it);
+	}
+	trie_it_free(it);
+	bench_stop(d);
+	trie_free(trie);
+	return d->count;
+}
+
+static size_t bench_hhash_find(struct bench_data *d)
+{
+	hhash_t *tbl = hhash_create(d->count * 2);
+	if (tbl == NULL) {
+		return 0;
+	}
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[i];
+		hhash_insert(tbl, (const char *)lf + 1, *lf, (value_t)lf);
+	}
+
+	/* Half of the lookups are misses. */
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		size_t idx = bench_pick(d, i) + (i % 2) * d->count;
+		const uint8_t *lf = d->lf[idx];
+		d->sink += (uintptr_t)hhash_find(tbl, (const char *)lf + 1, *lf);
+	}
+	bench_stop(d);
+	hhash_free(tbl);
+	return d->count;
+}
+
+/*! \brief Lookups in a table filled to given load (percent). */
+static size_t bench_hhash_load(struct bench_data *d, unsigned load, bool hit)
+{
+	hhash_t *tbl = hhash_create(d->count * 100 / load);
+	if (tbl == NULL) {
+		return 0;
+	}
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[i];
+		hhash_insert(tbl, (const char *)lf + 1, *lf, (value_t)lf);
+	}
+
+	size_t offset = hit ? 0 : d->count;
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		const uint8_t *lf = d->lf[offset + bench_pick(d, i)];
+		d->sink += (uintptr_t)hhash_find(tbl, (const char *)lf + 1, *lf);
+	}
+	bench_stop(d);
+	hhash_free(tbl);
+	return d->count;
+}
+
+static size_t bench_hhash_hit_50(struct bench_data *d)
+{
+	return bench_hhash_load(d, 50, true);
+}
+
+static size_t bench_hhash_miss_50(struct bench_data *d)
+{
+	return bench_hhash_load(d, 50, false);
+}
+
+static size_t bench_hhash_hit_75(struct bench_data *d)
+{
+	return bench_hhash_load(d, 75, true);
+}
+
+static size_t bench_hhash_miss_75(struct bench_data *d)
+{
+	return bench_hhash_load(d, 75, false);
+}
+
+static size_t bench_hhash_hit_90(struct bench_data *d)
+{
+	return bench_hhash_load(d, 90, true);
+}
+
+static size_t bench_hhash_miss_90(struct bench_data *d)
+{
+	return bench_hhash_load(d, 90, false);
+}
+
+static size_t bench_dname_lf(struct bench_data *d)
+{
+	uint8_t lf[KNOT_DNAME_MAXLEN];
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		knot_dname_lf(lf, d->names[bench_pick(d, i)], NULL);
+		d->sink += lf[0];
+	}
+	bench_stop(d);
+	return d->count;
+}
+
+static size_t bench_dname_cmp(struct bench_data *d)
+{
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		d->sink += knot_dname_cmp(d->names[bench_pick(d, i)],
+		                          d->names[bench_pick(d, i + 1)]);
+	}
+	bench_stop(d);
+	return d->count;
+}
+
+/*! \brief Reset compression context to an empty response with QNAME. */
+static void bench_compr_reset(knot_compr_t *compr, const knot_dname_t *qname)
+{
+	int qname_size = knot_dname_to_wire(compr->wire + KNOT_WIRE_HEADER_SIZE,
+	                                    qname, KNOT_DNAME_MAXLEN);
+	compr->wire_pos = KNOT_WIRE_HEADER_SIZE + qname_size + 2 * sizeof(uint16_t);
+	compr->suffix.pos = KNOT_WIRE_HEADER_SIZE;
+	compr->suffix.labels = knot_dname_labels(compr->wire + compr->suffix.pos,
+	                                         compr->wire);
+}
+
+static size_t bench_compr_put_dname(struct bench_data *d)
+{
+	uint8_t *wire = malloc(KNOT_WIRE_MAX_PKTSIZE);
+	if (wire == NULL) {
+		return 0;
+	}
+
+	knot_rrinfo_t rrinfo;
+	memset(&rrinfo, 0, sizeof(rrinfo));
+	knot_compr_t compr = { wire, 0, &rrinfo, { 0, 0 } };
+	bench_compr_reset(&compr, d->names[bench_pick(d, 0)]);
+
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		if (compr.wire_pos > BENCH_COMPR_LIMIT) {
+			bench_compr_reset(&compr, d->names[bench_pick(d, i)]);
+		}
+		int ret = knot_compr_put_dname(d->names[bench_pick(d, i)],
+		                               wire + compr.wire_pos,
+		                               KNOT_DNAME_MAXLEN, &compr);
+		if (ret > 0) {
+			compr.wire_pos += ret;
+		}
+	}
+	bench_stop(d);
+
+	free(wire);
+	return d->count;
+}
+
+/*! \brief Parse the query set with given parser. */
+static size_t bench_parse(struct bench_data *d, int (*parse)(knot_pkt_t *, unsigned))
+{
+	/* Same memory context as the query processing uses. */
+	mm_ctx_t mm;
+	mm_ctx_mempool(&mm, 4 * sizeof(knot_pkt_t));
+
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		unsigned q = i % BENCH_QUERIES;
+		knot_pkt_t *pkt = knot_pkt_new(d->queries[q], d->query_len[q], &mm);
+		d->sink += parse(pkt, 0);
+		knot_pkt_free(&pkt);
+		mp_flush(mm.ctx);
+	}
+	bench_stop(d);
+
+	mp_delete(mm.ctx);
+	return d->count;
+}
+
+static size_t bench_pkt_parse(struct bench_data *d)
+{
+	return bench_parse(d, knot_pkt_parse);
+}
+
+static size_t bench_pkt_parse_query(struct bench_data *d)
+{
+	return bench_parse(d, knot_pkt_parse_query);
+}
+
+static size_t bench_rrset_to_wire(struct bench_data *d)
+{
+	uint8_t *wire = malloc(KNOT_WIRE_MAX_PKTSIZE);
+	knot_rrset_t **rrsets = malloc(BENCH_QUERIES * sizeof(knot_rrset_t *));
+	if (wire == NULL || rrsets == NULL) {
+		free(wire);
+		free(rrsets);
+		return 0;
+	}
+
+	/* Typical answer, A RR set with two addresses. */
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		rrsets[i] = knot_rrset_new(d->names[bench_pick(d, i)],
+		                           KNOT_RRTYPE_A, KNOT_CLASS_IN, NULL);
+		for (unsigned j = 0; j < 2 && rrsets[i]; ++j) {
+			uint32_t addr = bench_rand(d);
+			knot_rrset_add_rdata(rrsets[i], (uint8_t *)&addr,
+			                     sizeof(addr), 3600, NULL);
+		}
+	}
+
+	knot_rrinfo_t rrinfo;
+	knot_compr_t compr = { wire, 0, &rrinfo, { 0, 0 } };
+	bench_compr_reset(&compr, rrsets[0]->owner);
+
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		if (compr.wire_pos > BENCH_COMPR_LIMIT) {
+			bench_compr_reset(&compr, rrsets[i % BENCH_QUERIES]->owner);
+		}
+		memset(&rrinfo, 0, sizeof(rrinfo));
+		size_t size = 0;
+		uint16_t rr_count = 0;
+		knot_rrset_to_wire(rrsets[i % BENCH_QUERIES], wire + compr.wire_pos,
+		                   &size, KNOT_WIRE_MAX_PKTSIZE - compr.wire_pos,
+		                   &rr_count, &compr);
+		d->sink += rr_count;
+	}
+	bench_stop(d);
+
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		knot_rrset_free(&rrsets[i], NULL);
+	}
+	free(rrsets);
+	free(wire);
+	return d->count;
+}
+
+static size_t bench_rrl_query(struct bench_data *d)
+{
+	rrl_table_t *rrl = rrl_create(BENCH_RRL_SIZE);
+	if (rrl == NULL) {
+		return 0;
+	}
+	rrl_setlocks(rrl, RRL_LOCK_GRANULARITY);
+	rrl_setrate(rrl, 10000);
+
+	struct sockaddr_storage *addr = calloc(BENCH_RRL_ADDRS, sizeof(*addr));
+	if (addr == NULL) {
+		rrl_destroy(rrl);
+		return 0;
+	}
+	for (unsigned i = 0; i < BENCH_RRL_ADDRS; ++i) {
+		struct sockaddr_in *in = (struct sockaddr_in *)&addr[i];
+		in->sin_family = AF_INET;
+		in->sin_addr.s_addr = htonl(bench_rand(d));
+	}
+
+	/* Responses to parsed queries. */
+	mm_ctx_t mm;
+	mm_ctx_mempool(&mm, 4 * sizeof(knot_pkt_t));
+	knot_pkt_t *query[BENCH_QUERIES];
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		query[i] = knot_pkt_new(d->queries[i], d->query_len[i], &mm);
+		knot_pkt_parse(query[i], 0);
+	}
+	uint8_t resp[KNOT_WIRE_HEADER_SIZE] = { 0 };
+	knot_wire_set_qr(resp);
+	knot_wire_set_ancount(resp, 1);
+
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		rrl_req_t req = { resp, 512, 0, query[i % BENCH_QUERIES] };
+		d->sink += rrl_query(rrl, &addr[i % BENCH_RRL_ADDRS], &req, NULL);
+	}
+	bench_stop(d);
+
+	mp_delete(mm.ctx);
+	free(addr);
+	rrl_destroy(rrl);
+	return d->count;
+}
+
+static size_t bench_rdataset_add(struct bench_data *d)
+{
+	knot_rdata_t rr[knot_rdata_array_size(sizeof(uint32_t))];
+	knot_rdata_set_rdlen(rr, sizeof(uint32_t));
+	knot_rdata_set_ttl(rr, 3600);
+
+	size_t ops = d->count - d->count % BENCH_RDATASET;
+	knot_rdataset_t rrs;
+	knot_rdataset_init(&rrs);
+
+	bench_start(d);
+	for (size_t i = 0; i < ops; ++i) {
+		uint32_t addr = bench_rand(d);
+		memcpy(knot_rdata_data(rr), &addr, sizeof(addr));
+		knot_rdataset_add(&rrs, rr, NULL);
+		if (rrs.rr_count == BENCH_RDATASET) {
+			knot_rdataset_clear(&rrs, NULL);
+		}
+	}
+	bench_stop(d);
+
+	knot_rdataset_clear(&rrs, NULL);
+	return ops;
+}
+
+static int bench_event_cb(event_t *ev)
+{
+	return KNOT_EOK;
+}
+
+static size_t bench_evsched_schedule(struct bench_data *d)
+{
+	evsched_t sched;
+	if (evsched_init(&sched, NULL) != KNOT_EOK) {
+		return 0;
+	}
+
+	event_t *ev[BENCH_EVENTS];
+	for (unsigned i = 0; i < BENCH_EVENTS; ++i) {
+		ev[i] = evsched_event_create(&sched, bench_event_cb, NULL);
+	}
+
+	/* Timers are rescheduled, as zone events are. */
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		evsched_schedule(ev[i % BENCH_EVENTS], 1000 + bench_rand(d) % 3600000);
+	}
+	bench_stop(d);
+
+	evsched_deinit(&sched);
+	return d->count;
+}
+
+static size_t bench_mempool(struct bench_data *d)
+{
+	struct mempool *pool = mp_new(4096);
+	if (pool == NULL) {
+		return 0;
+	}
+
+	bench_start(d);
+	for (size_t i = 0; i < d->count; ++i) {
+		d->sink += (uintptr_t)mp_alloc(pool, 16 + (i % 8) * 16);
+		if (i % BENCH_BLOCKS == BENCH_BLOCKS - 1) {
+			mp_flush(pool);
+		}
+	}
+	bench_stop(d);
+
+	mp_delete(pool);
+	return d->count;
+}
+
+static size_t bench_slab(struct bench_data *d)
+{
+	slab_cache_t cache;
+	if (slab_cache_init(&cache, 64) != 0) {
+		return 0;
+	}
+
+	void *blocks[BENCH_BLOCKS];
+	size_t ops = d->count - d->count % BENCH_BLOCKS;
+	bench_start(d);
+	for (size_t i = 0; i < ops; i += BENCH_BLOCKS) {
+		for (unsigned j = 0; j < BENCH_BLOCKS; ++j) {
+			blocks[j] = slab_cache_alloc(&cache);
+		}
+		for (unsigned j = 0; j < BENCH_BLOCKS; ++j) {
+			slab_free(blocks[j]);
+		}
+	}
+	bench_stop(d);
+
+	slab_cache_destroy(&cache);
+	return ops;
+}
+
+/*! \brief Convert OpenSSL big number to binary. */
+static int bench_bn_to_binary(const BIGNUM *bn, knot_binary_t *to)
+{
+	uint8_t buffer[BN_num_bytes(bn)];
+	BN_bn2bin(bn, buffer);
+	return knot_binary_from_string(buffer, sizeof(buffer), to);
+}
+
+/*! \brief Generate RSA-2048 key, as used by the signed zones. */
+static int bench_key_rsa(knot_key_params_t *kp)
+{
+	RSA *rsa = RSA_new();
+	BIGNUM *e = BN_new();
+	if (rsa == NULL || e == NULL || !BN_set_word(e, RSA_F4) ||
+	    !RSA_generate_key_ex(rsa, 2048, e, NULL)) {
+		BN_free(e);
+		RSA_free(rsa);
+		return KNOT_ERROR;
+	}
+
+	kp->algorithm = 8;
+	bench_bn_to_binary(rsa->n, &kp->modulus);
+	bench_bn_to_binary(rsa->e, &kp->public_exponent);
+	bench_bn_to_binary(rsa->d, &kp->private_exponent);
+	bench_bn_to_binary(rsa->p, &kp->prime_one);
+	bench_bn_to_binary(rsa->q, &kp->prime_two);
+	bench_bn_to_binary(rsa->dmp1, &kp->exponent_one);
+	bench_bn_to_binary(rsa->dmq1, &kp->exponent_two);
+	bench_bn_to_binary(rsa->iqmp, &kp->coefficient);
+
+	BN_free(e);
+	RSA_free(rsa);
+	return KNOT_EOK;
+}
+
+/*! \brief ECDSA P-256 key from the signing tests. */
+static int bench_key_ecdsa(knot_key_params_t *kp)
+{
+#ifdef KNOT_ENABLE_ECDSA
+	kp->algorithm = 13;
+	knot_binary_from_base64("1N/PvpB8jZcvv+zr3Q987RKK1cBxDKULzEc5F/nnpSg=", &kp->private_key);
+	knot_binary_from_base64("AAAAAH3t6EfkvHK5fQMGslhWcCfMF6Q3oNbol2f19DGAb8r49ZX7iQ12sFIyrs2CiwDxFR9Y7fF2zOZ005VV1LA3m1Q=", &kp->rdata);
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+/*! \brief Sign A RR sets of distinct names, one by one or in batches. */
+static size_t bench_sign(struct bench_data *d,
+                         int (*key_cb)(knot_key_params_t *), size_t batch)
+{
+	knot_key_params_t kp = { 0 };
+	kp.name = knot_dname_from_str("example.com.");
+	knot_dnssec_key_t key = { 0 };
+	knot_dnssec_sign_context_t *ctx = NULL;
+	if (key_cb(&kp) != KNOT_EOK ||
+	    knot_dnssec_key_from_params(&kp, &key) != KNOT_EOK ||
+	    (ctx = knot_dnssec_sign_init(&key)) == NULL) {
+		knot_dnssec_key_free(&key);
+		knot_free_key_params(&kp);
+		return 0;
+	}
+
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+
+	knot_rrset_t *covered[BENCH_SIGNATURES] = { NULL };
+	knot_rrset_t *rrsigs[BENCH_SIGNATURES] = { NULL };
+	size_t ops = 0;
+	for (unsigned i = 0; i < BENCH_SIGNATURES; ++i) {
+		const knot_dname_t *owner = d->names[bench_pick(d, i)];
+		covered[i] = knot_rrset_new(owner, KNOT_RRTYPE_A, KNOT_CLASS_IN, NULL);
+		rrsigs[i] = knot_rrset_new(owner, KNOT_RRTYPE_RRSIG, KNOT_CLASS_IN, NULL);
+		if (covered[i] == NULL || rrsigs[i] == NULL) {
+			goto cleanup;
+		}
+		uint32_t addr = bench_rand(d);
+		knot_rrset_add_rdata(covered[i], (uint8_t *)&addr, sizeof(addr),
+		                     3600, NULL);
+	}
+
+	bench_start(d);
+	for (size_t i = 0; i < BENCH_SIGNATURES; i += batch) {
+		int ret = knot_sign_rrsets(rrsigs + i,
+		                           (const knot_rrset_t **)covered + i,
+		                           batch, &key, ctx, &policy);
+		if (ret != KNOT_EOK) {
+			bench_stop(d);
+			goto cleanup;
+		}
+	}
+	bench_stop(d);
+	ops = BENCH_SIGNATURES;
+
+cleanup:
+	for (unsigned i = 0; i < BENCH_SIGNATURES; ++i) {
+		knot_rrset_free(&covered[i], NULL);
+		knot_rrset_free(&rrsigs[i], NULL);
+	}
+	knot_dnssec_sign_free(ctx);
+	knot_dnssec_key_free(&key);
+	knot_free_key_params(&kp);
+	return ops;
+}
+
+static size_t bench_sign_rsa(struct bench_data *d)
+{
+	return bench_sign(d, bench_key_rsa, 1);
+}
+
+static size_t bench_sign_rsa_batch(struct bench_data *d)
+{
+	return bench_sign(d, bench_key_rsa, BENCH_SIGN_BATCH);
+}
+
+static size_t bench_sign_ecdsa(struct bench_data *d)
+{
+	return bench_sign(d, bench_key_ecdsa, 1);
+}
+
+static size_t bench_sign_ecdsa_batch(struct bench_data *d)
+{
+	return bench_sign(d, bench_key_ecdsa, BENCH_SIGN_BATCH);
+}
+
+/*! \brief Benchmark table. */
+static const struct {
+	const char *name;
+	bench_cb_t cb;
+} bench_tbl[] = {
+	{ "hattrie-get",      bench_hattrie_get },
+	{ "hattrie-tryget",   bench_hattrie_tryget },
+	{ "hattrie-find-leq", bench_hattrie_find_leq },
+	{ "hattrie-iter",     bench_hattrie_iter },
+	{ "qp-trie-get",      bench_qp_trie_get },
+	{ "qp-trie-tryget",   bench_qp_trie_tryget },
+	{ "qp-trie-find-leq", bench_qp_trie_find_leq },
+	{ "qp-trie-iter",     bench_qp_trie_iter },
+	{ "hhash-find",       bench_hhash_find },
+	{ "hhash-hit-50",     bench_hhash_hit_50 },
+	{ "hhash-miss-50",    bench_hhash_miss_50 },
+	{ "hhash-hit-75",     bench_hhash_hit_75 },
+	{ "hhash-miss-75",    bench_hhash_miss_75 },
+	{ "hhash-hit-90",     bench_hhash_hit_90 },
+	{ "hhash-miss-90",    bench_hhash_miss_90 },
+	{ "dname-lf",         bench_dname_lf },
+	{ "dname-cmp",        bench_dname_cmp },
+	{ "compr-put-dname",  bench_compr_put_dname },
+	{ "pkt-parse",        bench_pkt_parse },
+	{ "pkt-parse-query",  bench_pkt_parse_query },
+	{ "rrset-to-wire",    bench_rrset_to_wire },
+	{ "rrl-query",        bench_rrl_query },
+	{ "rdataset-add",     bench_rdataset_add },
+	{ "evsched-schedule", bench_evsched_schedule },
+	{ "mempool-alloc",    bench_mempool },
+	{ "slab-alloc-free",  bench_slab },
+	{ "sign-rsa",         bench_sign_rsa },
+	{ "sign-rsa-batch",   bench_sign_rsa_batch },
+	{ "sign-ecdsa",       bench_sign_ecdsa },
+	{ "sign-ecdsa-batch", bench_sign_ecdsa_batch },
+	{ NULL, NULL }
+};
+
+/*----------------------------------------------------------------------------*/
+
+/*! \brief Generate random name with 1-3 labels below one of the apexes. */
+static knot_dname_t *bench_name(struct bench_data *d)
+{
+	static const char *apex[] = { "example.com.", "example.net.", "test." };
+	static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789-";
+
+	char str[KNOT_DNAME_MAXLEN] = { '\0' };
+	size_t len = 0;
+	unsigned labels = 1 + bench_rand(d) % 3;
+	for (unsigned i = 0; i < labels; ++i) {
+		unsigned label_len = 1 + bench_rand(d) % 12;
+		for (unsigned j = 0; j < label_len; ++j) {
+			str[len++] = alphabet[bench_rand(d) % (sizeof(alphabet) - 2)];
+		}
+		str[len++] = '.';
+	}
+	strcpy(str + len, apex[bench_rand(d) % 3]);
+	return knot_dname_from_str(str);
+}
+
+/*! \brief Create query wire for given name. */
+static int bench_query(struct bench_data *d, unsigned i)
+{
+	static const uint16_t qtypes[] = {
+		KNOT_RRTYPE_A, KNOT_RRTYPE_AAAA, KNOT_RRTYPE_MX, KNOT_RRTYPE_NS
+	};
+	/* OPT RR, 4096B payload, DO bit. */
+	static const uint8_t opt[] = {
+		0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00
+	};
+
+	uint8_t *wire = malloc(KNOT_WIRE_HEADER_SIZE + KNOT_DNAME_MAXLEN +
+	                       2 * sizeof(uint16_t) + sizeof(opt));
+	if (wire == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	memset(wire, 0, KNOT_WIRE_HEADER_SIZE);
+	knot_wire_set_id(wire, bench_rand(d));
+	knot_wire_set_rd(wire);
+	knot_wire_set_qdcount(wire, 1);
+
+	size_t len = KNOT_WIRE_HEADER_SIZE;
+	len += knot_dname_to_wire(wire + len, d->names[bench_pick(d, i)],
+	                          KNOT_DNAME_MAXLEN);
+	knot_wire_write_u16(wire + len, qtypes[i % 4]);
+	knot_wire_write_u16(wire + len + sizeof(uint16_t), KNOT_CLASS_IN);
+	len += 2 * sizeof(uint16_t);
+
+	/* Every other query with EDNS. */
+	if (i % 2 == 0) {
+		knot_wire_set_arcount(wire, 1);
+		memcpy(wire + len, opt, sizeof(opt));
+		len += sizeof(opt);
+	}
+
+	d->queries[i] = wire;
+	d->query_len[i] = len;
+	return KNOT_EOK;
+}
+
+static void bench_data_free(struct bench_data *d)
+{
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		free(d->queries[i]);
+	}
+	for (size_t i = 0; d->names && i < 2 * d->count; ++i) {
+		knot_dname_free(&d->names[i], NULL);
+	}
+	free(d->names);
+	free(d->lf);
+	free(d->order);
+}
+
+static int bench_data_init(struct bench_data *d, size_t count, uint64_t seed)
+{
+	memset(d, 0, sizeof(*d));
+	d->rand = seed ? seed : 1;
+	d->count = count;
+	d->names = calloc(2 * count, sizeof(knot_dname_t *));
+	d->lf = malloc(2 * count * sizeof(*d->lf));
+	d->order = malloc(count * sizeof(size_t));
+	if (d->names == NULL || d->lf == NULL || d->order == NULL) {
+		bench_data_free(d);
+		return KNOT_ENOMEM;
+	}
+
+	for (size_t i = 0; i < 2 * count; ++i) {
+		d->names[i] = bench_name(d);
+		if (d->names[i] == NULL) {
+			bench_data_free(d);
+			return KNOT_ENOMEM;
+		}
+		knot_dname_lf(d->lf[i], d->names[i], NULL);
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		d->order[i] = i;
+	}
+	for (size_t i = count - 1; i > 0; --i) {
+		size_t j = bench_rand(d) % (i + 1);
+		size_t tmp = d->order[i];
+		d->order[i] = d->order[j];
+		d->order[j] = tmp;
+	}
+
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		if (bench_query(d, i) != KNOT_EOK) {
+			bench_data_free(d);
+			return KNOT_ENOMEM;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/*! \brief Check if benchmark is selected by the command line. */
+static bool bench_selected(const char *name, int argc, char **argv)
+{
+	if (argc == 0) {
+		return true;
+	}
+
+	for (int i = 0; i < argc; ++i) {
+		if (strncmp(name, argv[i], strlen(argv[i])) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void help(void)
+{
+	printf("Usage: knot-microbench [parameters] [benchmark-prefix...]\n"
+	       "\nParameters:\n"
+	       " -n, --names <num>      Number of names in the data set (default %u).\n"
+	       " -r, --repeat <num>     Runs of each benchmark (default %u).\n"
+	       " -s, --seed <num>       Seed for the data set (default 1).\n"
+	       " -l, --list             List benchmarks.\n"
+	       " -h, --help             Print help.\n",
+	       BENCH_NAMES, BENCH_REPEAT);
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = BENCH_NAMES;
+	unsigned repeat = BENCH_REPEAT;
+	uint64_t seed = 1;
+
+	struct option opts[] = {
+		{ "names",  required_argument, 0, 'n' },
+		{ "repeat", required_argument, 0, 'r' },
+		{ "seed",   required_argument, 0, 's' },
+		{ "list",   no_argument,       0, 'l' },
+		{ "help",   no_argument,       0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	int c = 0, li = 0;
+	while ((c = getopt_long(argc, argv, "n:r:s:lh", opts, &li)) != -1) {
+		switch (c) {
+		case 'n': count = strtoull(optarg, NULL, 10); break;
+		case 'r': repeat = strtoul(optarg, NULL, 10); break;
+		case 's': seed = strtoull(optarg, NULL, 10); break;
+		case 'l':
+			for (unsigned i = 0; bench_tbl[i].name; ++i) {
+				printf("%s\n", bench_tbl[i].name);
+			}
+			return EXIT_SUCCESS;
+		case 'h':
+			help();
+			return EXIT_SUCCESS;
+		default:
+			help();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (count < BENCH_BLOCKS || repeat == 0 || repeat > BENCH_REPEAT_MAX) {
+		help();
+		return EXIT_FAILURE;
+	}
+
+	struct bench_data data;
+	if (bench_data_init(&data, count, seed) != KNOT_EOK) {
+		fprintf(stderr, "failed to generate data set\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("names: %zu\n", count);
+	printf("repeat: %u\n", repeat);
+	printf("seed: %" PRIu64 "\n", seed);
+
+	int ret = EXIT_SUCCESS;
+	for (unsigned i = 0; bench_tbl[i].name; ++i) {
+		const char *name = bench_tbl[i].name;
+		if (!bench_selected(name, argc - optind, argv + optind)) {
+			continue;
+		}
+
+		/* Each run starts from the same generator state. */
+		double ns_op[BENCH_REPEAT_MAX];
+		size_t ops = 0;
+		data.mem = 0;
+		for (unsigned r = 0; r < repeat; ++r) {
+			data.rand = seed ? seed : 1;
+			data.nsec = 0;
+			ops = bench_tbl[i].cb(&data);
+			if (ops == 0) {
+				break;
+			}
+			ns_op[r] = (double)data.nsec / ops;
+		}
+
+		if (ops == 0) {
+			fprintf(stderr, "%s: failed\n", name);
+			ret = EXIT_FAILURE;
+			continue;
+		}
+
+		qsort(ns_op, repeat, sizeof(double), cmp_double);
+		printf("%s.ops: %zu\n", name, ops);
+		printf("%s.ns-per-op: %.2f\n", name, ns_op[0]);
+		printf("%s.ns-per-op-median: %.2f\n", name, ns_op[repeat / 2]);
+		printf("%s.ops-per-sec: %.0f\n", name, 1e9 / ns_op[0]);
+		if (data.mem > 0) {
+			printf("%s.bytes-per-op: %.2f\n", name, (double)data.mem / ops);
+		}
+		fflush(stdout);
+	}
+
+	bench_data_free(&data);
+	knot_crypto_cleanup();
+	return ret;
+}
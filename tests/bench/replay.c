@@ -0,0 +1,725 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file replay.c
+ *
+ * \brief In-process query replay benchmark (knot-bench).
+ *
+ * Zones from the configuration are loaded by the regular zone loader and
+ * a query corpus is replayed directly through the query processing API
+ * on a number of threads, without any sockets involved. The corpus is read
+ * from a pcap file, a dnstap file or generated from the loaded zones.
+ *
+ * Results are printed as 'name: value' lines, the same format as the
+ * 'knotc stats' output.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "common/errcode.h"
+#include "common/log.h"
+#include "common/mempool.h"
+#include "common/descriptor.h"
+#include "common/hattrie/hat-trie.h"
+#include "libknot/packet/wire.h"
+#include "libknot/util/utils.h"
+#include "knot/conf/conf.h"
+#include "knot/server/dthreads.h"
+#include "knot/server/server.h"
+#include "knot/server/stats.h"
+#include "knot/server/zone-load.h"
+#include "knot/nameserver/process_query.h"
+#ifdef USE_DNSTAP
+#include "dnstap/reader.h"
+#endif
+
+/*! \brief Default number of replayed queries per thread. */
+#define BENCH_QUERIES 1000000
+/*! \brief Default number of generated queries. */
+#define BENCH_GENERATED 100000
+/*! \brief Probability of generated name being existent (in percent). */
+#define BENCH_HIT_RATIO 80
+
+/*! \brief Query corpus. */
+struct corpus {
+	uint8_t **wire;
+	uint16_t *len;
+	size_t count;
+	size_t max;
+};
+
+/*! \brief Benchmark context shared by all threads. */
+struct bench {
+	server_t server;
+	struct corpus corpus;
+	size_t queries;          /*!< Queries per thread. */
+	bool latency;            /*!< Collect stage latency. */
+	stats_worker_t *stats;   /*!< Per-thread counters. */
+	uint64_t *allocs;        /*!< Per-thread allocation count. */
+	uint64_t *alloc_bytes;   /*!< Per-thread allocated bytes. */
+};
+
+/*! \brief Memory context counting allocations from the query mempool. */
+struct counting_mm {
+	mm_ctx_t pool;
+	uint64_t allocs;
+	uint64_t bytes;
+};
+
+static void *counting_alloc(void *ctx, size_t len)
+{
+	struct counting_mm *mm = ctx;
+	mm->allocs += 1;
+	mm->bytes += len;
+	return mm->pool.alloc(mm->pool.ctx, len);
+}
+
+static int corpus_add(struct corpus *c, const uint8_t *wire, size_t len)
+{
+	/* Accept only queries. */
+	if (len < KNOT_WIRE_HEADER_SIZE || len > KNOT_WIRE_MAX_PKTSIZE ||
+	    knot_wire_get_qr(wire)) {
+		return KNOT_EOK;
+	}
+
+	if (c->count == c->max) {
+		size_t max = c->max ? c->max * 2 : 1024;
+		uint8_t **wires = realloc(c->wire, max * sizeof(uint8_t *));
+		if (wires == NULL) {
+			return KNOT_ENOMEM;
+		}
+		c->wire = wires;
+		uint16_t *lens = realloc(c->len, max * sizeof(uint16_t));
+		if (lens == NULL) {
+			return KNOT_ENOMEM;
+		}
+		c->len = lens;
+		c->max = max;
+	}
+
+	c->wire[c->count] = malloc(len);
+	if (c->wire[c->count] == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(c->wire[c->count], wire, len);
+	c->len[c->count] = len;
+	c->count += 1;
+
+	return KNOT_EOK;
+}
+
+static void corpus_free(struct corpus *c)
+{
+	for (size_t i = 0; i < c->count; ++i) {
+		free(c->wire[i]);
+	}
+	free(c->wire);
+	free(c->len);
+	memset(c, 0, sizeof(*c));
+}
+
+/*
+ * pcap input (classic format, no libpcap needed).
+ */
+
+#define PCAP_MAGIC    0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
+#define LINKTYPE_NULL      0
+#define LINKTYPE_ETHERNET  1
+#define LINKTYPE_RAW       101
+#define LINKTYPE_LINUX_SLL 113
+#define ETHERTYPE_VLAN  0x8100
+#define IPPROTO_UDP_NUM 17
+#define DNS_PORT 53
+
+static uint32_t pcap_u32(const uint8_t *p, bool swap)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return swap ? __builtin_bswap32(v) : v;
+}
+
+/*! \brief Extract DNS payload from UDP/IP packet, return length or 0. */
+static size_t pcap_udp_payload(const uint8_t *ip, size_t len, const uint8_t **dns)
+{
+	if (len < 1) {
+		return 0;
+	}
+
+	const uint8_t *udp = NULL;
+	const uint8_t *end = ip + len;
+	switch (ip[0] >> 4) {
+	case 4: {
+		size_t ihl = (ip[0] & 0x0f) * 4;
+		if (len < 20 || len < ihl || ip[9] != IPPROTO_UDP_NUM) {
+			return 0;
+		}
+		/* Skip fragments. */
+		if (knot_wire_read_u16(ip + 6) & 0x3fff) {
+			return 0;
+		}
+		udp = ip + ihl;
+		break;
+	}
+	case 6:
+		/* Extension headers are not supported. */
+		if (len < 40 || ip[6] != IPPROTO_UDP_NUM) {
+			return 0;
+		}
+		udp = ip + 40;
+		break;
+	default:
+		return 0;
+	}
+
+	if (end - udp < 8 || knot_wire_read_u16(udp + 2) != DNS_PORT) {
+		return 0;
+	}
+
+	*dns = udp + 8;
+	return end - *dns;
+}
+
+static int load_pcap(struct corpus *c, const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	uint8_t hdr[24];
+	if (fread(hdr, sizeof(hdr), 1, fp) != 1) {
+		fclose(fp);
+		return KNOT_EMALF;
+	}
+
+	bool swap = false;
+	uint32_t magic = pcap_u32(hdr, false);
+	if (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS) {
+		swap = true;
+		magic = pcap_u32(hdr, true);
+		if (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS) {
+			fclose(fp);
+			return KNOT_EMALF;
+		}
+	}
+	uint32_t linktype = pcap_u32(hdr + 20, swap);
+
+	uint8_t *frame = malloc(UINT16_MAX);
+	if (frame == NULL) {
+		fclose(fp);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	uint8_t rec[16];
+	while (ret == KNOT_EOK && fread(rec, sizeof(rec), 1, fp) == 1) {
+		uint32_t caplen = pcap_u32(rec + 8, swap);
+		if (caplen > UINT16_MAX) {
+			ret = KNOT_EMALF;
+			break;
+		}
+		if (fread(frame, caplen, 1, fp) != 1) {
+			break;
+		}
+
+		/* Strip link layer. */
+		size_t off = 0;
+		switch (linktype) {
+		case LINKTYPE_NULL:
+			off = 4;
+			break;
+		case LINKTYPE_ETHERNET:
+			off = 14;
+			if (caplen >= off &&
+			    knot_wire_read_u16(frame + 12) == ETHERTYPE_VLAN) {
+				off += 4;
+			}
+			break;
+		case LINKTYPE_RAW:
+			off = 0;
+			break;
+		case LINKTYPE_LINUX_SLL:
+			off = 16;
+			break;
+		default:
+			ret = KNOT_ENOTSUP;
+			continue;
+		}
+		if (caplen <= off) {
+			continue;
+		}
+
+		const uint8_t *dns = NULL;
+		size_t dns_len = pcap_udp_payload(frame + off, caplen - off, &dns);
+		if (dns_len > 0) {
+			ret = corpus_add(c, dns, dns_len);
+		}
+	}
+
+	free(frame);
+	fclose(fp);
+	return ret;
+}
+
+#ifdef USE_DNSTAP
+static int load_dnstap(struct corpus *c, const char *path)
+{
+	dt_reader_t *reader = dt_reader_create(path);
+	if (reader == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	int ret = KNOT_EOK;
+	Dnstap__Dnstap *d = NULL;
+	while (ret == KNOT_EOK && dt_reader_read(reader, &d) == KNOT_EOK) {
+		if (d->type == DNSTAP__DNSTAP__TYPE__MESSAGE &&
+		    d->message != NULL && d->message->has_query_message) {
+			ret = corpus_add(c, d->message->query_message.data,
+			                 d->message->query_message.len);
+		}
+		dnstap__dnstap__free_unpacked(d, NULL);
+	}
+
+	dt_reader_free(reader);
+	return ret;
+}
+#endif /* USE_DNSTAP */
+
+/*
+ * Generated corpus.
+ */
+
+/*! \brief Owner names found in loaded zones. */
+struct name_list {
+	const knot_dname_t **name;
+	size_t count;
+	size_t max;
+};
+
+static int name_list_add(zone_node_t *node, void *data)
+{
+	struct name_list *names = data;
+	if (names->count == names->max) {
+		size_t max = names->max ? names->max * 2 : 1024;
+		const knot_dname_t **name = realloc(names->name, max * sizeof(*name));
+		if (name == NULL) {
+			return KNOT_ENOMEM;
+		}
+		names->name = name;
+		names->max = max;
+	}
+
+	names->name[names->count++] = node->owner;
+	return KNOT_EOK;
+}
+
+/*! \brief QTYPE distribution of generated queries (weights in percent). */
+static const struct {
+	uint16_t type;
+	unsigned weight;
+} bench_qtypes[] = {
+	{ KNOT_RRTYPE_A,      55 },
+	{ KNOT_RRTYPE_AAAA,   25 },
+	{ KNOT_RRTYPE_MX,      5 },
+	{ KNOT_RRTYPE_NS,      5 },
+	{ KNOT_RRTYPE_TXT,     5 },
+	{ KNOT_RRTYPE_SOA,     3 },
+	{ KNOT_RRTYPE_DNSKEY,  2 }
+};
+
+static uint16_t random_qtype(unsigned *seed)
+{
+	unsigned roll = rand_r(seed) % 100;
+	for (unsigned i = 0; i < sizeof(bench_qtypes) / sizeof(bench_qtypes[0]); ++i) {
+		if (roll < bench_qtypes[i].weight) {
+			return bench_qtypes[i].type;
+		}
+		roll -= bench_qtypes[i].weight;
+	}
+
+	return KNOT_RRTYPE_A;
+}
+
+static int generate(struct corpus *c, knot_zonedb_t *db, size_t count,
+                    unsigned seed)
+{
+	/* Collect existing names and zone apexes. */
+	struct name_list names = { NULL };
+	struct name_list apexes = { NULL };
+	knot_zonedb_iter_t it;
+	knot_zonedb_iter_begin(db, &it);
+	while (!knot_zonedb_iter_finished(&it)) {
+		zone_t *zone = knot_zonedb_iter_val(&it);
+		knot_zone_contents_tree_apply_inorder(zone->contents,
+		                                      name_list_add, &names);
+		name_list_add(zone->contents->apex, &apexes);
+		knot_zonedb_iter_next(&it);
+	}
+
+	if (names.count == 0) {
+		free(names.name);
+		free(apexes.name);
+		return KNOT_ENOENT;
+	}
+
+	int ret = KNOT_EOK;
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	uint8_t qname[KNOT_DNAME_MAXLEN];
+	for (size_t i = 0; pkt != NULL && ret == KNOT_EOK && i < count; ++i) {
+		const knot_dname_t *name = NULL;
+		if (rand_r(&seed) % 100 < BENCH_HIT_RATIO) {
+			name = names.name[rand_r(&seed) % names.count];
+		} else {
+			/* Random label under random apex (NXDOMAIN). */
+			const knot_dname_t *apex = apexes.name[rand_r(&seed) % apexes.count];
+			size_t apex_len = knot_dname_size(apex);
+			if (apex_len + 10 > KNOT_DNAME_MAXLEN) {
+				continue;
+			}
+			qname[0] = 8;
+			for (unsigned j = 1; j <= 8; ++j) {
+				qname[j] = 'a' + rand_r(&seed) % 26;
+			}
+			memcpy(qname + 9, apex, apex_len);
+			name = qname;
+		}
+
+		knot_pkt_clear(pkt);
+		knot_wire_set_id(pkt->wire, rand_r(&seed));
+		ret = knot_pkt_put_question(pkt, name, KNOT_CLASS_IN,
+		                            random_qtype(&seed));
+		if (ret == KNOT_EOK) {
+			ret = corpus_add(c, pkt->wire, pkt->size);
+		}
+	}
+
+	knot_pkt_free(&pkt);
+	free(names.name);
+	free(apexes.name);
+	return ret;
+}
+
+/*
+ * Zone loading.
+ */
+
+static int load_zones(server_t *server)
+{
+	hattrie_t *zones = conf()->zones;
+	knot_zonedb_t *db = knot_zonedb_new(hattrie_weight(zones));
+	if (db == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	hattrie_iter_t *it = hattrie_iter_begin(zones, false);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		conf_zone_t *zone_conf = (conf_zone_t *)*hattrie_iter_val(it);
+		zone_t *zone = load_zone_file(zone_conf);
+		if (zone == NULL) {
+			ret = KNOT_EZONEINVAL;
+			break;
+		}
+		ret = knot_zonedb_insert(db, zone);
+		if (ret != KNOT_EOK) {
+			zone_free(&zone);
+			break;
+		}
+	}
+	hattrie_iter_free(it);
+
+	if (ret == KNOT_EOK) {
+		ret = knot_zonedb_build_index(db);
+	}
+	if (ret != KNOT_EOK) {
+		knot_zonedb_deep_free(&db);
+		return ret;
+	}
+
+	server->zone_db = db;
+	server->opt_rr = knot_edns_new();
+	knot_edns_set_version(server->opt_rr, EDNS_VERSION);
+	knot_edns_set_payload(server->opt_rr, conf()->max_udp_payload);
+
+	return KNOT_EOK;
+}
+
+/*
+ * Replay.
+ */
+
+static int bench_thread(dthread_t *thread)
+{
+	struct bench *bench = thread->data;
+	unsigned id = dt_get_id(thread);
+	stats_worker_t *stats = &bench->stats[id];
+
+	/* Query memory context, same as in UDP handler. */
+	struct counting_mm mm = { { NULL } };
+	mm_ctx_mempool(&mm.pool, 4 * sizeof(knot_pkt_t));
+	knot_process_t query_ctx;
+	memset(&query_ctx, 0, sizeof(query_ctx));
+	query_ctx.mm.ctx = &mm;
+	query_ctx.mm.alloc = counting_alloc;
+	query_ctx.mm.free = mm.pool.free;
+	query_ctx.pkt_in = malloc(sizeof(knot_pkt_t));
+	query_ctx.pkt_out = malloc(sizeof(knot_pkt_t));
+	struct query_data qdata;
+	if (query_ctx.pkt_in == NULL || query_ctx.pkt_out == NULL) {
+		free(query_ctx.pkt_in);
+		free(query_ctx.pkt_out);
+		mp_delete(mm.pool.ctx);
+		return KNOT_ENOMEM;
+	}
+
+	struct sockaddr_storage ss;
+	sockaddr_set(&ss, AF_INET, "127.0.0.1", 53);
+	struct process_query_param param = { 0 };
+	param.query_source = &ss;
+	param.proc_flags = NS_QUERY_NO_AXFR|NS_QUERY_NO_IXFR|
+	                   NS_QUERY_LIMIT_SIZE|NS_QUERY_LIMIT_ANY;
+	param.server = &bench->server;
+	param.stats = stats;
+	param.qdata = &qdata;
+	if (bench->latency) {
+		param.latency = stats->latency;
+	}
+
+	uint8_t answer[KNOT_WIRE_MAX_PKTSIZE];
+	const struct corpus *c = &bench->corpus;
+	size_t pos = (c->count * id / thread->unit->size) % c->count;
+	for (size_t i = 0; i < bench->queries; ++i) {
+		uint64_t t_total = stats_clock();
+		stats_inc(stats, STATS_UDP_QUERIES);
+
+		knot_process_begin(&query_ctx, &param, NS_PROC_QUERY);
+		int state = knot_process_in(c->wire[pos], c->len[pos], &query_ctx);
+		uint16_t answer_len = sizeof(answer);
+		if (state == NS_PROC_FULL) {
+			state = knot_process_out(answer, &answer_len, &query_ctx);
+		}
+		if (state == NS_PROC_FAIL) {
+			answer_len = sizeof(answer);
+			state = knot_process_out(answer, &answer_len, &query_ctx);
+		}
+		if (state != NS_PROC_DONE) {
+			answer_len = 0;
+		}
+		knot_process_finish(&query_ctx);
+		mp_flush(mm.pool.ctx);
+
+		stats_response(stats, answer, answer_len, STATS_UDP_RESPONSES);
+		stats_timer_end(stats->latency, STATS_STAGE_TOTAL, t_total);
+
+		if (++pos == c->count) {
+			pos = 0;
+		}
+	}
+
+	bench->allocs[id] = mm.allocs;
+	bench->alloc_bytes[id] = mm.bytes;
+	free(query_ctx.pkt_in);
+	free(query_ctx.pkt_out);
+	mp_delete(mm.pool.ctx);
+	return KNOT_EOK;
+}
+
+static int bench_run(struct bench *bench, unsigned threads)
+{
+	bench->stats = stats_new(threads);
+	bench->allocs = calloc(threads, sizeof(uint64_t));
+	bench->alloc_bytes = calloc(threads, sizeof(uint64_t));
+	dt_unit_t *unit = dt_create(threads, bench_thread, NULL, bench);
+	if (bench->stats == NULL || bench->allocs == NULL ||
+	    bench->alloc_bytes == NULL || unit == NULL) {
+		dt_delete(&unit);
+		return KNOT_ENOMEM;
+	}
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	dt_start(unit);
+	dt_join(unit);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	dt_delete(&unit);
+
+	/* Aggregate results. */
+	stats_worker_t *total = stats_new(1);
+	if (total == NULL) {
+		return KNOT_ENOMEM;
+	}
+	stats_sum(total, bench->stats, threads);
+	uint64_t allocs = 0, alloc_bytes = 0;
+	for (unsigned i = 0; i < threads; ++i) {
+		allocs += bench->allocs[i];
+		alloc_bytes += bench->alloc_bytes[i];
+	}
+
+	double elapsed = (t1.tv_sec - t0.tv_sec) +
+	                 (t1.tv_nsec - t0.tv_nsec) / 1000000000.0;
+	uint64_t queries = bench->queries * threads;
+	printf("corpus: %zu\n", bench->corpus.count);
+	printf("threads: %u\n", threads);
+	printf("queries: %" PRIu64 "\n", queries);
+	printf("time-ms: %.0f\n", elapsed * 1000.0);
+	printf("qps: %.0f\n", queries / elapsed);
+	printf("allocs-per-query: %.2f\n", (double)allocs / queries);
+	printf("alloc-bytes-per-query: %.1f\n", (double)alloc_bytes / queries);
+
+	/* Counters and latency percentiles. */
+	size_t buflen = 64 * 1024;
+	char *buf = malloc(buflen);
+	int ret = buf ? stats_print(total, buf, buflen) : KNOT_ENOMEM;
+	if (ret >= 0) {
+		fwrite(buf, 1, ret, stdout);
+		ret = KNOT_EOK;
+	}
+
+	free(buf);
+	stats_free(total);
+	return ret;
+}
+
+static void help(void)
+{
+	printf("Usage: knot-bench [parameters] -c <config> <input>\n"
+	       "\nParameters:\n"
+	       " -c, --config <file>    Server configuration with zones to load.\n"
+	       " -t, --threads <num>    Number of replaying threads (default 1).\n"
+	       " -n, --queries <num>    Queries per thread (default %u).\n"
+	       " -l, --latency          Collect per-stage latency histograms.\n"
+	       " -s, --seed <num>       Seed for the generated corpus.\n"
+	       "\nInput:\n"
+	       " -p, --pcap <file>      Replay UDP queries from a pcap file.\n"
+#ifdef USE_DNSTAP
+	       " -d, --dnstap <file>    Replay queries from a dnstap file.\n"
+#endif
+	       " -g, --generate <num>   Generate queries for names in loaded zones\n"
+	       "                        (default %u).\n"
+	       " -h, --help             Print help.\n",
+	       BENCH_QUERIES, BENCH_GENERATED);
+}
+
+int main(int argc, char **argv)
+{
+	const char *config = NULL, *pcap = NULL, *dnstap = NULL;
+	unsigned threads = 1, seed = 1;
+	size_t generated = 0;
+	struct bench bench;
+	memset(&bench, 0, sizeof(bench));
+	bench.queries = BENCH_QUERIES;
+
+	struct option opts[] = {
+		{ "config",   required_argument, 0, 'c' },
+		{ "threads",  required_argument, 0, 't' },
+		{ "queries",  required_argument, 0, 'n' },
+		{ "latency",  no_argument,       0, 'l' },
+		{ "seed",     required_argument, 0, 's' },
+		{ "pcap",     required_argument, 0, 'p' },
+		{ "dnstap",   required_argument, 0, 'd' },
+		{ "generate", optional_argument, 0, 'g' },
+		{ "help",     no_argument,       0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	int c = 0, li = 0;
+	while ((c = getopt_long(argc, argv, "c:t:n:ls:p:d:g::h", opts, &li)) != -1) {
+		switch (c) {
+		case 'c': config = optarg; break;
+		case 't': threads = strtoul(optarg, NULL, 10); break;
+		case 'n': bench.queries = strtoull(optarg, NULL, 10); break;
+		case 'l': bench.latency = true; break;
+		case 's': seed = strtoul(optarg, NULL, 10); break;
+		case 'p': pcap = optarg; break;
+		case 'd': dnstap = optarg; break;
+		case 'g':
+			generated = optarg ? strtoull(optarg, NULL, 10)
+			                   : BENCH_GENERATED;
+			break;
+		case 'h':
+			help();
+			return EXIT_SUCCESS;
+		default:
+			help();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (config == NULL || threads < 1 ||
+	    (pcap == NULL && dnstap == NULL && generated == 0)) {
+		help();
+		return EXIT_FAILURE;
+	}
+
+	/* Load configuration and zones. */
+	log_init();
+	stats_clock_init();
+	rcu_register_thread();
+	int ret = conf_open(config);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "Failed to load configuration '%s': %s\n",
+		        config, knot_strerror(ret));
+		return EXIT_FAILURE;
+	}
+
+	server_init(&bench.server);
+	ret = load_zones(&bench.server);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "Failed to load zones: %s\n", knot_strerror(ret));
+		server_deinit(&bench.server);
+		return EXIT_FAILURE;
+	}
+
+	/* Build corpus. */
+	if (pcap != NULL) {
+		ret = load_pcap(&bench.corpus, pcap);
+	} else if (dnstap != NULL) {
+#ifdef USE_DNSTAP
+		ret = load_dnstap(&bench.corpus, dnstap);
+#else
+		ret = KNOT_ENOTSUP;
+#endif
+	} else {
+		ret = generate(&bench.corpus, bench.server.zone_db, generated, seed);
+	}
+	if (ret == KNOT_EOK && bench.corpus.count == 0) {
+		ret = KNOT_ENOENT;
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = bench_run(&bench, threads);
+	} else {
+		fprintf(stderr, "Failed to build query corpus: %s\n",
+		        knot_strerror(ret));
+	}
+
+	corpus_free(&bench.corpus);
+	stats_free(bench.stats);
+	free(bench.allocs);
+	free(bench.alloc_bytes);
+	server_deinit(&bench.server);
+	rcu_unregister_thread();
+	log_close();
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
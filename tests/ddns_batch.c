@@ -0,0 +1,385 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <tap/basic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "libknot/packet/wire.h"
+#include "knot/server/zone-load.h"
+#include "knot/nameserver/update.c" // testing the UPDATE queue
+
+#define TEST_COUNT 10
+
+/*! \brief Number of concurrent UPDATEs in the leader hand-off test. */
+#define WORKER_COUNT 4
+
+static const char *ZONE_FILE =
+	"@  3600 IN SOA ns mail 1 3600 900 86400 300\n"
+	"@  3600 IN NS  ns\n"
+	"ns 3600 IN A   192.0.2.1\n";
+
+static const uint8_t TXT_RDATA[] = { 0x03, 'f', 'o', 'o' };
+static const uint8_t A_RDATA[] = { 192, 0, 2, 2 };
+
+/*! \brief UPDATE message RR, RRs must be sorted by section. */
+struct update_rr {
+	knot_section_t section;
+	const char *owner;
+	uint16_t rclass;
+	uint16_t type;
+	uint32_t ttl;
+	const uint8_t *rdata;
+	uint16_t size;
+};
+
+/*! \brief Prerequisite "name is in use" (RFC2136, Section 2.4.4). */
+#define PREREQ_IN_USE(owner) \
+	{ KNOT_ANSWER, owner, KNOT_CLASS_ANY, KNOT_RRTYPE_ANY, 0, NULL, 0 }
+
+/*! \brief Add TXT record. */
+#define ADD_TXT(owner) \
+	{ KNOT_AUTHORITY, owner, KNOT_CLASS_IN, KNOT_RRTYPE_TXT, 3600, \
+	  TXT_RDATA, sizeof(TXT_RDATA) }
+
+/*! \brief Add A record to ns.example.com with TTL different from the zone. */
+#define ADD_A_BAD_TTL \
+	{ KNOT_AUTHORITY, "ns.example.com.", KNOT_CLASS_IN, KNOT_RRTYPE_A, 60, \
+	  A_RDATA, sizeof(A_RDATA) }
+
+/*! \brief UPDATE request with its processing context. */
+struct update_test {
+	struct update_req req;
+	struct query_data qdata;
+	struct process_query_param param;
+	struct sockaddr_storage source;
+	zone_t *zone;
+};
+
+static void write_file(const char *path, const char *data)
+{
+	FILE *f = fopen(path, "w");
+	if (f != NULL) {
+		fputs(data, f);
+		fclose(f);
+	}
+}
+
+static conf_zone_t *zone_conf(const char *dir)
+{
+	conf_zone_t *conf = malloc(sizeof(conf_zone_t));
+	conf_init_zone(conf);
+	conf->name = strdup("example.com.");
+	conf->enable_checks = false;
+	conf->dnssec_enable = false;
+	conf->build_diffs = false;
+	conf->dbsync_timeout = 60;
+	conf->serial_policy = CONF_SERIAL_INCREMENT;
+
+	char path[256];
+	snprintf(path, sizeof(path), "%s/zone.db", dir);
+	conf->file = strdup(path);
+	snprintf(path, sizeof(path), "%s/example.com.diff.db", dir);
+	conf->ixfr_db = strdup(path);
+
+	return conf;
+}
+
+/*!
+ * \brief Create parsed UPDATE message for example.com.
+ */
+static knot_pkt_t *update_create(const struct update_rr *rrs, size_t count)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_dname_t *apex = knot_dname_from_str("example.com.");
+	knot_pkt_put_question(pkt, apex, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+	knot_dname_free(&apex, NULL);
+	knot_wire_set_opcode(pkt->wire, KNOT_OPCODE_UPDATE);
+
+	for (size_t i = 0; i < count; ++i) {
+		knot_pkt_begin(pkt, rrs[i].section);
+		knot_dname_t *owner = knot_dname_from_str(rrs[i].owner);
+		knot_rrset_t rr;
+		knot_rrset_init(&rr, owner, rrs[i].type, rrs[i].rclass);
+		knot_rrset_add_rdata(&rr, rrs[i].rdata, rrs[i].size,
+		                     rrs[i].ttl, NULL);
+		knot_pkt_put(pkt, 0, &rr, KNOT_PF_NOTRUNC);
+		knot_rrset_clear(&rr, NULL);
+	}
+
+	/* Parse the message as received. */
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	memcpy(query->wire, pkt->wire, pkt->size);
+	query->size = pkt->size;
+	knot_pkt_free(&pkt);
+	if (knot_pkt_parse(query, 0) != KNOT_EOK) {
+		knot_pkt_free(&query);
+	}
+
+	return query;
+}
+
+static void update_init(struct update_test *test, zone_t *zone,
+                        const struct update_rr *rrs, size_t count)
+{
+	memset(test, 0, sizeof(struct update_test));
+	sockaddr_set(&test->source, AF_INET, "127.0.0.1", 53);
+	test->param.query_source = &test->source;
+	test->qdata.param = &test->param;
+	test->qdata.query = update_create(rrs, count);
+	test->qdata.zone = zone;
+	test->req.qdata = &test->qdata;
+	test->zone = zone;
+}
+
+static void update_clear(struct update_test *test)
+{
+	knot_pkt_free(&test->qdata.query);
+}
+
+/*! \brief Queue UPDATE as update_enqueue() would, without waiting. */
+static void update_queue(zone_t *zone, struct update_test *test)
+{
+	pthread_mutex_lock(&zone->ddns.lock);
+	add_tail(&zone->ddns.queue, &test->req.n);
+	pthread_mutex_unlock(&zone->ddns.lock);
+}
+
+/*! \brief Take and commit the next batch, return its size. */
+static size_t update_commit_next(zone_t *zone)
+{
+	list_t batch;
+	init_list(&batch);
+
+	pthread_mutex_lock(&zone->ddns.lock);
+	size_t count = update_take_batch(zone, &batch);
+	pthread_mutex_unlock(&zone->ddns.lock);
+
+	update_process_batch(zone, &batch);
+
+	return count;
+}
+
+static bool zone_has_rr(const zone_t *zone, const char *owner_str,
+                        uint16_t type)
+{
+	knot_dname_t *owner = knot_dname_from_str(owner_str);
+	const zone_node_t *node =
+		knot_zone_contents_find_node(zone->contents, owner);
+	knot_dname_free(&owner, NULL);
+
+	return node != NULL && node_rrtype_exists(node, type);
+}
+
+static uint16_t ns_a_ttl(const zone_t *zone)
+{
+	knot_dname_t *owner = knot_dname_from_str("ns.example.com.");
+	const zone_node_t *node =
+		knot_zone_contents_find_node(zone->contents, owner);
+	knot_dname_free(&owner, NULL);
+
+	knot_rrset_t rrset = node_rrset(node, KNOT_RRTYPE_A);
+	return knot_rrset_rr_ttl(&rrset, 0);
+}
+
+static void test_batch(zone_t *zone)
+{
+	const struct update_rr add_a1[] = { ADD_TXT("a1.example.com.") };
+	const struct update_rr add_b2[] = { ADD_TXT("b2.example.com."),
+	                                    ADD_A_BAD_TTL };
+	const struct update_rr add_a3[] = { ADD_TXT("a3.example.com.") };
+	const struct update_rr add_a4[] = { PREREQ_IN_USE("a1.example.com."),
+	                                    ADD_TXT("a4.example.com.") };
+	const struct update_rr add_a5[] = { PREREQ_IN_USE("b2.example.com."),
+	                                    ADD_TXT("a5.example.com.") };
+
+	struct update_test u[5];
+	update_init(&u[0], zone, add_a1, 1);
+	update_init(&u[1], zone, add_b2, 2);
+	update_init(&u[2], zone, add_a3, 1);
+	update_init(&u[3], zone, add_a4, 2);
+	update_init(&u[4], zone, add_a5, 2);
+	for (int i = 0; i < 5; ++i) {
+		update_queue(zone, &u[i]);
+	}
+
+	uint32_t serial = knot_zone_serial(zone->contents);
+
+	// 1. - UPDATE with prerequisites opens a new batch
+	size_t count = update_commit_next(zone);
+	ok(count == 3 && HEAD(zone->ddns.queue) == &u[3].req.n,
+	   "ddns batch: stop the batch at UPDATE with prerequisites");
+
+	// 2.-4. - failed UPDATE is dropped from the batch, others are applied
+	ok(u[0].qdata.rcode == KNOT_RCODE_NOERROR &&
+	   u[1].qdata.rcode == KNOT_RCODE_SERVFAIL &&
+	   u[2].qdata.rcode == KNOT_RCODE_NOERROR &&
+	   u[0].req.ret == KNOT_EOK && u[1].req.ret != KNOT_EOK &&
+	   u[2].req.ret == KNOT_EOK,
+	   "ddns batch: answer each UPDATE in the batch with its own RCODE");
+	ok(zone_has_rr(zone, "a1.example.com.", KNOT_RRTYPE_TXT) &&
+	   zone_has_rr(zone, "a3.example.com.", KNOT_RRTYPE_TXT) &&
+	   !zone_has_rr(zone, "b2.example.com.", KNOT_RRTYPE_TXT) &&
+	   ns_a_ttl(zone) == 3600,
+	   "ddns batch: rebuild the changeset without the failed UPDATE");
+	ok(knot_zone_serial(zone->contents) == serial + 1,
+	   "ddns batch: commit the batch as a single zone change");
+
+	// 5.-6. - prerequisites are checked against the committed batch
+	count = update_commit_next(zone);
+	ok(count == 1 && HEAD(zone->ddns.queue) == &u[4].req.n,
+	   "ddns batch: commit UPDATE with prerequisites alone");
+	ok(u[3].qdata.rcode == KNOT_RCODE_NOERROR &&
+	   zone_has_rr(zone, "a4.example.com.", KNOT_RRTYPE_TXT) &&
+	   knot_zone_serial(zone->contents) == serial + 2,
+	   "ddns batch: check prerequisites against the committed batch");
+
+	// 7. - failed prerequisite leaves the zone intact
+	count = update_commit_next(zone);
+	ok(count == 1 && EMPTY_LIST(zone->ddns.queue) &&
+	   u[4].qdata.rcode == KNOT_RCODE_NXDOMAIN &&
+	   !zone_has_rr(zone, "a5.example.com.", KNOT_RRTYPE_TXT) &&
+	   knot_zone_serial(zone->contents) == serial + 2,
+	   "ddns batch: refuse UPDATE with failed prerequisite");
+
+	for (int i = 0; i < 5; ++i) {
+		update_clear(&u[i]);
+	}
+}
+
+static void *update_thread(void *data)
+{
+	struct update_test *test = data;
+	test->req.ret = update_enqueue(test->zone, &test->qdata);
+	return NULL;
+}
+
+static size_t queue_length(zone_t *zone)
+{
+	pthread_mutex_lock(&zone->ddns.lock);
+	size_t len = list_size(&zone->ddns.queue);
+	pthread_mutex_unlock(&zone->ddns.lock);
+	return len;
+}
+
+static bool has_leader(zone_t *zone)
+{
+	pthread_mutex_lock(&zone->ddns.lock);
+	bool leader = zone->ddns.leader;
+	pthread_mutex_unlock(&zone->ddns.lock);
+	return leader;
+}
+
+static void test_handoff(zone_t *zone)
+{
+	char owners[WORKER_COUNT][32];
+	struct update_rr rrs[WORKER_COUNT][1];
+	struct update_test u[WORKER_COUNT];
+	for (int i = 0; i < WORKER_COUNT; ++i) {
+		snprintf(owners[i], sizeof(owners[i]), "w%d.example.com.", i);
+		struct update_rr rr = ADD_TXT(owners[i]);
+		rrs[i][0] = rr;
+		update_init(&u[i], zone, rrs[i], 1);
+	}
+
+	uint32_t serial = knot_zone_serial(zone->contents);
+
+	/* Block the first leader in the commit. */
+	pthread_mutex_lock(&zone->ddns_lock);
+	pthread_t threads[WORKER_COUNT];
+	pthread_create(&threads[0], NULL, update_thread, &u[0]);
+	while (!has_leader(zone) || queue_length(zone) > 0) {
+		usleep(1000);
+	}
+
+	/* Queue the rest while the leader is busy. */
+	for (int i = 1; i < WORKER_COUNT; ++i) {
+		pthread_create(&threads[i], NULL, update_thread, &u[i]);
+	}
+	while (queue_length(zone) < WORKER_COUNT - 1) {
+		usleep(1000);
+	}
+	pthread_mutex_unlock(&zone->ddns_lock);
+
+	for (int i = 0; i < WORKER_COUNT; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	// 8.-10. - waiting UPDATEs are committed by the next leader at once
+	bool answered = true;
+	bool applied = true;
+	for (int i = 0; i < WORKER_COUNT; ++i) {
+		answered = answered && u[i].req.ret == KNOT_EOK &&
+		           u[i].qdata.rcode == KNOT_RCODE_NOERROR;
+		applied = applied &&
+		          zone_has_rr(zone, owners[i], KNOT_RRTYPE_TXT);
+	}
+	ok(answered, "ddns batch: answer all concurrent UPDATEs");
+	ok(applied, "ddns batch: apply all concurrent UPDATEs");
+	ok(knot_zone_serial(zone->contents) == serial + 2 && !has_leader(zone),
+	   "ddns batch: hand the waiting UPDATEs over to the next leader");
+
+	for (int i = 0; i < WORKER_COUNT; ++i) {
+		update_clear(&u[i]);
+	}
+}
+
+// Signal handler
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan(TEST_COUNT);
+
+	/* Worker threads are interrupted when stopped. */
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL);
+
+	char dir[] = "/tmp/knot-ddns_batch.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		skip_block(TEST_COUNT, "ddns batch: cannot create zone directory");
+		return 0;
+	}
+
+	char path[256];
+	snprintf(path, sizeof(path), "%s/zone.db", dir);
+	write_file(path, ZONE_FILE);
+
+	zone_t *zone = load_zone_file(zone_conf(dir));
+	if (zone == NULL) {
+		skip_block(TEST_COUNT, "ddns batch: cannot load zone");
+	} else {
+		test_batch(zone);
+		test_handoff(zone);
+		zone_free(&zone);
+	}
+
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/example.com.diff.db", dir);
+	unlink(path);
+	rmdir(dir);
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdbool.h>
+#include <tap/basic.h>
+
+#include "libknot/dnssec/policy.h"
+
+int main(int argc, char *argv[])
+{
+	plan(6);
+
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+	policy.now = 1000000;
+	knot_dnssec_policy_set_sign_lifetime(&policy, 864000);
+
+	/* Refresh within a tenth of life time before expiration. */
+	ok(policy.refresh_before == 1000000 + 86400,
+	   "policy: refresh window");
+	ok(knot_dnssec_policy_refresh_time(&policy, 2000000) == 2000000 - 86400 &&
+	   knot_dnssec_policy_refresh_time(&policy, 86400) == 0,
+	   "policy: refresh time");
+
+	/* Shortened signatures must stay out of the refresh window. */
+	ok(policy.sign_jitter == 216000 &&
+	   policy.now + policy.sign_lifetime - policy.sign_jitter >
+	   policy.refresh_before, "policy: jitter bounds");
+
+	bool in_range = true, spread = false;
+	uint32_t first = knot_dnssec_policy_jitter_lifetime(&policy);
+	for (int i = 0; i < 1000; i++) {
+		uint32_t lifetime = knot_dnssec_policy_jitter_lifetime(&policy);
+		in_range = in_range && lifetime <= policy.sign_lifetime &&
+		           lifetime >= policy.sign_lifetime - policy.sign_jitter;
+		spread = spread || lifetime != first;
+	}
+	ok(in_range && spread, "policy: jittered life time");
+
+	policy.sign_jitter = 0;
+	ok(knot_dnssec_policy_jitter_lifetime(&policy) == policy.sign_lifetime,
+	   "policy: life time without jitter");
+
+	/* Refresh tick is bounded by the safety margin. */
+	knot_dnssec_policy_set_sign_lifetime(&policy, 10800);
+	uint32_t short_tick = policy.resign_tick;
+	knot_dnssec_policy_set_sign_lifetime(&policy, 864000);
+	ok(short_tick == 10800 / 10 / 4 &&
+	   policy.resign_tick == KNOT_DNSSEC_RESIGN_TICK,
+	   "policy: refresh tick");
+
+	return 0;
+}
@@ -16,13 +16,124 @@
 
 #include <config.h>
 #include <assert.h>
+#include <string.h>
 #include <openssl/opensslconf.h>
 #include <tap/basic.h>
 
 #include "common/errcode.h"
 #include "libknot/dnssec/config.h"
 #include "libknot/dnssec/crypto.h"
+#include "libknot/dnssec/policy.h"
+#include "libknot/dnssec/rrset-sign.h"
 #include "libknot/dnssec/sign.h"
+#include "libknot/rrset.h"
+
+/*!
+ * \brief Compose DNSKEY RDATA of the key.
+ */
+static void dnskey_rdata(const knot_key_params_t *kp, knot_binary_t *rdata)
+{
+	uint8_t wire[512] = { 0x01, 0x00, 0x03, kp->algorithm };
+	size_t size = 4;
+
+	knot_binary_t pubkey = { 0 };
+	const knot_binary_t *parts[4] = { NULL };
+	if (kp->algorithm == 5) {
+		wire[size++] = kp->public_exponent.size;
+		parts[0] = &kp->public_exponent;
+		parts[1] = &kp->modulus;
+	} else if (kp->algorithm == 6) {
+		wire[size++] = (kp->prime.size - 64) / 8;
+		parts[0] = &kp->subprime;
+		parts[1] = &kp->prime;
+		parts[2] = &kp->base;
+		parts[3] = &kp->public_value;
+	} else {
+		pubkey.data = kp->rdata.data + 4;
+		pubkey.size = kp->rdata.size - 4;
+		parts[0] = &pubkey;
+	}
+
+	for (int i = 0; i < 4 && parts[i] != NULL; i++) {
+		memcpy(wire + size, parts[i]->data, parts[i]->size);
+		size += parts[i]->size;
+	}
+
+	knot_binary_from_string(wire, size, rdata);
+}
+
+static void test_public_key(const char *alg, const knot_key_params_t *kp,
+                            const uint8_t *sig, size_t sig_size)
+{
+	knot_binary_t rdata = { 0 };
+	dnskey_rdata(kp, &rdata);
+
+	knot_dnssec_key_t key = { 0 };
+	int result = knot_dnssec_key_from_dnskey(kp->name, rdata.data,
+	                                         rdata.size, &key);
+	is_int(KNOT_EOK, result, "%s: create key from DNSKEY", alg);
+
+	knot_dnssec_sign_context_t *ctx = knot_dnssec_sign_init(&key);
+	result = KNOT_ERROR;
+	if (ctx != NULL) {
+		knot_dnssec_sign_add(ctx, (uint8_t *)"hellodns", 8);
+		result = knot_dnssec_sign_verify(ctx, sig, sig_size);
+	}
+	is_int(KNOT_EOK, result, "%s: verify with public key", alg);
+
+	knot_dnssec_sign_free(ctx);
+	knot_dnssec_key_free(&key);
+	knot_binary_free(&rdata);
+}
+
+#define BATCH_SIZE 3
+
+static void test_batch(const char *alg, const knot_dnssec_key_t *key,
+                       knot_dnssec_sign_context_t *ctx)
+{
+	const char *owners[BATCH_SIZE] = {
+		"example.com.", "www.example.com.", "*.example.com."
+	};
+	knot_rrset_t *covered[BATCH_SIZE] = { NULL };
+	knot_rrset_t *rrsigs[BATCH_SIZE] = { NULL };
+	for (int i = 0; i < BATCH_SIZE; i++) {
+		knot_dname_t *owner = knot_dname_from_str(owners[i]);
+		covered[i] = knot_rrset_new(owner, KNOT_RRTYPE_A, KNOT_CLASS_IN, NULL);
+		rrsigs[i] = knot_rrset_new(owner, KNOT_RRTYPE_RRSIG, KNOT_CLASS_IN, NULL);
+		knot_dname_free(&owner, NULL);
+		for (uint8_t j = 0; j <= i; j++) {
+			uint8_t address[4] = { 192, 0, 2, j };
+			knot_rrset_add_rdata(covered[i], address, sizeof(address),
+			                     3600, NULL);
+		}
+	}
+
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+
+	int result = knot_sign_rrsets(rrsigs, (const knot_rrset_t **)covered,
+	                              BATCH_SIZE, key, ctx, &policy);
+	for (int i = 0; result == KNOT_EOK && i < BATCH_SIZE; i++) {
+		if (rrsigs[i]->rrs.rr_count != 1) {
+			result = KNOT_ERROR;
+			break;
+		}
+		result = knot_is_valid_signature(covered[i], rrsigs[i], 0, key,
+		                                 ctx, &policy);
+	}
+	is_int(KNOT_EOK, result, "%s: sign batch", alg);
+
+	// signatures must be stored with their covered records
+	result = knot_sign_rrsets(rrsigs, (const knot_rrset_t **)covered + 1,
+	                          BATCH_SIZE - 1, key, ctx, &policy);
+	ok(result == KNOT_EINVAL && rrsigs[0]->rrs.rr_count == 1,
+	   "%s: sign batch with mismatched owners", alg);
+
+	for (int i = 0; i < BATCH_SIZE; i++) {
+		knot_rrset_free(&covered[i], NULL);
+		knot_rrset_free(&rrsigs[i], NULL);
+	}
+}
 
 static void test_algorithm(const char *alg, const knot_key_params_t *kp)
 {
@@ -37,7 +148,7 @@ static void test_algorithm(const char *alg, const knot_key_params_t *kp)
 	ok(ctx != NULL, "%s: create signing context", alg);
 
 	if (ctx == NULL) {
-		skip_block(12, "%s: required test failed", alg);
+		skip_block(16, "%s: required test failed", alg);
 	} else {
 
 		size_t sig_size = knot_dnssec_sign_size(&key);
@@ -79,6 +190,14 @@ static void test_algorithm(const char *alg, const knot_key_params_t *kp)
 		result = knot_dnssec_sign_verify(ctx, sig, sig_size);
 		is_int(KNOT_EOK, result, "%s: verify valid signature", alg);
 
+		if (kp->algorithm == 12) {
+			skip_block(2, "%s: public key not supported", alg);
+		} else {
+			test_public_key(alg, kp, sig, sig_size);
+		}
+
+		test_batch(alg, &key, ctx);
+
 		free(sig);
 	}
 
@@ -88,7 +207,7 @@ static void test_algorithm(const char *alg, const knot_key_params_t *kp)
 
 int main(int argc, char *argv[])
 {
-	plan(4 * 14);
+	plan(4 * 18);
 
 	knot_key_params_t kp = { 0 };
 
@@ -132,7 +251,7 @@ int main(int argc, char *argv[])
 	test_algorithm("ECDSA", &kp);
 	knot_free_key_params(&kp);
 #else
-	skip_block(14, "ECDSA: not supported on this system");
+	skip_block(18, "ECDSA: not supported on this system");
 #endif
 
 #if KNOT_ENABLE_GOST
@@ -144,7 +263,7 @@ int main(int argc, char *argv[])
 	test_algorithm("GOST", &kp);
 	knot_free_key_params(&kp);
 #else
-	skip_block(14, "GOST: not supported on this system");
+	skip_block(18, "GOST: not supported on this system");
 #endif
 
 	knot_crypto_cleanup();
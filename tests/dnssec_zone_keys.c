@@ -0,0 +1,171 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <tap/basic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "libknot/dnssec/config.h"
+#include "knot/dnssec/zone-keys.c" // testing the key cache internals
+
+#define TEST_COUNT 8
+
+/* ECDSA P-256 key of example.com. */
+static const char *KEY_PUBLIC =
+	"example.com. IN DNSKEY 257 3 13 blXaCLukAMcr+TklzAePyEnCOzjsuEfEcd8B/D9e"
+	"2iFix/z7tk1p5+wF2eZWYm5NxS0uxWWHbdgx78v2Zv1YGA==\n";
+static const char *KEY_PRIVATE =
+	"Private-key-format: v1.2\n"
+	"Algorithm: 13 (ECDSAP256SHA256)\n"
+	"PrivateKey: sk+7o3OxW6pZRT4eAiXACQ3FPkpuMqiH6DGt8bKGt88=\n";
+
+static void write_file(const char *path, const char *data)
+{
+	FILE *f = fopen(path, "w");
+	if (f != NULL) {
+		fputs(data, f);
+		fclose(f);
+	}
+}
+
+/*!
+ * \brief Set modification time of a file, changes within the current
+ *        second are not trusted by the cache.
+ */
+static void set_mtime(const char *path, time_t mtime)
+{
+	struct utimbuf times = { .actime = mtime, .modtime = mtime };
+	utime(path, &times);
+}
+
+/*!
+ * \brief Get the cache entry of a zone.
+ */
+static key_cache_zone_t *cached_zone(const char *keydir, const knot_dname_t *name)
+{
+	for (key_cache_dir_t *dir = key_cache; dir != NULL; dir = dir->next) {
+		if (strcmp(dir->path, keydir) != 0 || dir->zones == NULL) {
+			continue;
+		}
+		value_t *val = hattrie_tryget(dir->zones, (char *)name,
+		                              knot_dname_size(name));
+		return val ? *val : NULL;
+	}
+
+	return NULL;
+}
+
+static void test_key_cache(const char *keydir, const char *private,
+                           time_t past)
+{
+	knot_dname_t *name = knot_dname_from_str("example.com.");
+
+	// 1. - keys are lent from the cache
+	knot_zone_keys_t keys = { 0 };
+	int result = knot_load_zone_keys(keydir, name, false, &keys);
+	key_cache_zone_t *zone = cached_zone(keydir, name);
+	ok(result == KNOT_EOK && keys.count == 1 && zone != NULL &&
+	   keys.cached == zone && zone->busy,
+	   "zone keys: borrow keys from the cache");
+
+	// 2. - unchanged keys are not loaded again
+	const knot_dnssec_sign_context_t *context = keys.keys[0].context;
+	knot_free_zone_keys(&keys);
+	result = knot_load_zone_keys(keydir, name, false, &keys);
+	ok(result == KNOT_EOK && zone == cached_zone(keydir, name) &&
+	   zone->busy && keys.keys[0].context == context &&
+	   zone->mtimes[0] == past,
+	   "zone keys: reuse cached keys");
+
+	// 3.-4. - busy keys are copied
+	knot_zone_keys_t copy = { 0 };
+	result = knot_load_zone_keys(keydir, name, false, &copy);
+	ok(result == KNOT_EOK && copy.cached == NULL && copy.count == 1 &&
+	   copy.keys[0].context != NULL && copy.keys[0].context != context &&
+	   copy.keys[0].dnssec_key.keytag == keys.keys[0].dnssec_key.keytag,
+	   "zone keys: load a private copy of busy keys");
+	knot_free_zone_keys(&copy);
+	ok(zone->busy && zone->loaded && zone->keys.keys[0].context == context &&
+	   keys.keys[0].context == context,
+	   "zone keys: free a copy, borrowed keys stay intact");
+	knot_free_zone_keys(&keys);
+
+	// 5. - keys are reloaded when a key file changes
+	set_mtime(private, past + 50);
+	result = knot_load_zone_keys(keydir, name, false, &keys);
+	ok(result == KNOT_EOK && keys.cached == zone &&
+	   zone->mtimes[0] == past + 50,
+	   "zone keys: reload keys on key file change");
+	knot_free_zone_keys(&keys);
+
+	// 6. - keys are reloaded when the key file changes just now
+	set_mtime(private, time(NULL));
+	knot_load_zone_keys(keydir, name, false, &keys);
+	knot_free_zone_keys(&keys);
+	ok(zone->valid_until == 0, "zone keys: don't trust recent key file change");
+
+	// 7. - cache is cleared at exit
+	knot_zone_keys_cache_clear();
+	ok(key_cache == NULL, "zone keys: clear the cache");
+
+	// 8. - keys borrowed during clearing are freed on return
+	knot_load_zone_keys(keydir, name, false, &keys);
+	zone = keys.cached;
+	knot_zone_keys_cache_clear();
+	bool stale = zone != NULL && zone->stale && key_cache == NULL;
+	knot_free_zone_keys(&keys);
+	ok(stale && keys.cached == NULL && keys.count == 0,
+	   "zone keys: free keys borrowed when clearing the cache");
+
+	knot_dname_free(&name, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	plan(TEST_COUNT);
+
+#ifdef KNOT_ENABLE_ECDSA
+	char keydir[] = "/tmp/knot-zone_keys.XXXXXX";
+	if (mkdtemp(keydir) == NULL) {
+		skip_block(TEST_COUNT, "zone keys: cannot create key directory");
+		return 0;
+	}
+
+	char public[256], private[256];
+	snprintf(public, sizeof(public), "%s/Kexample.com.+013+40829.key", keydir);
+	snprintf(private, sizeof(private), "%s/Kexample.com.+013+40829.private", keydir);
+	write_file(public, KEY_PUBLIC);
+	write_file(private, KEY_PRIVATE);
+
+	time_t past = time(NULL) - 100;
+	set_mtime(public, past);
+	set_mtime(private, past);
+	set_mtime(keydir, past);
+
+	test_key_cache(keydir, private, past);
+
+	unlink(public);
+	unlink(private);
+	rmdir(keydir);
+#else
+	skip_block(TEST_COUNT, "zone keys: ECDSA not supported");
+#endif
+
+	return 0;
+}
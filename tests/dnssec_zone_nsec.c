@@ -15,14 +15,755 @@
 */
 
 #include <config.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
 #include <tap/basic.h>
 
+#include "common/descriptor.h"
 #include "libknot/dname.h"
+#include "libknot/rrset.h"
+#include "libknot/packet/wire.h"
+#include "knot/dnssec/nsec-chain.h"
+#include "knot/dnssec/nsec3-chain.c" // testing the parallel hashing
 #include "knot/dnssec/zone-nsec.h"
+#include "knot/dnssec/zone-sign.h"
+#include "knot/updates/changesets.h"
+#include "knot/zone/zone-contents.h"
+#include "knot/zone/zone-diff.h"
+#include "zone_helpers.h"
+
+#define CHAIN_SIZE 4
+
+/*! \brief Current chain for the incremental fix, in canonical order. */
+typedef struct {
+	knot_dname_t *names[CHAIN_SIZE];
+	bool present[CHAIN_SIZE];
+} test_chain_t;
+
+static int chain_prev(const knot_dname_t *name, knot_dname_t **prev, void *data)
+{
+	test_chain_t *chain = data;
+	for (int i = CHAIN_SIZE - 1; i >= 0; --i) {
+		if (chain->present[i] && knot_dname_cmp(chain->names[i], name) < 0) {
+			*prev = knot_dname_copy(chain->names[i], NULL);
+			return KNOT_EOK;
+		}
+	}
+	for (int i = CHAIN_SIZE - 1; i >= 0; --i) {
+		if (chain->present[i]) {
+			*prev = knot_dname_copy(chain->names[i], NULL);
+			return KNOT_EOK;
+		}
+	}
+
+	return KNOT_ENOENT;
+}
+
+static int chain_next(const knot_dname_t *owner, knot_dname_t **next, void *data)
+{
+	test_chain_t *chain = data;
+	for (int i = 0; i < CHAIN_SIZE; ++i) {
+		if (chain->present[i] && knot_dname_cmp(chain->names[i], owner) > 0) {
+			*next = knot_dname_copy(chain->names[i], NULL);
+			return KNOT_EOK;
+		}
+	}
+	for (int i = 0; i < CHAIN_SIZE; ++i) {
+		if (chain->present[i]) {
+			*next = knot_dname_copy(chain->names[i], NULL);
+			return KNOT_EOK;
+		}
+	}
+
+	return KNOT_ENOENT;
+}
+
+static bool name_is(const knot_dname_t *name, const char *str)
+{
+	knot_dname_t *expect = knot_dname_from_str(str);
+	bool equal = name && knot_dname_is_equal(name, expect);
+	knot_dname_free(&expect, NULL);
+	return equal;
+}
+
+static void test_chain_fix(void)
+{
+	test_chain_t chain = {
+		.names = {
+			knot_dname_from_str("a.example.com"),
+			knot_dname_from_str("c.example.com"),
+			knot_dname_from_str("e.example.com"),
+			knot_dname_from_str("g.example.com")
+		},
+		.present = { true, true, true, true }
+	};
+	nsec_chain_ops_t ops = { chain_prev, chain_next, &chain };
+
+	// Add 'd', remove 'e'
+	nsec_chain_fix_t fix;
+	knot_nsec_chain_fix_init(&fix, &ops);
+	knot_nsec_chain_fix_add(&fix, knot_dname_from_str("e.example.com"),
+	                        NULL, true, false);
+	knot_nsec_chain_fix_add(&fix, knot_dname_from_str("d.example.com"),
+	                        NULL, false, true);
+	int ret = knot_nsec_chain_fix(&fix);
+	ok(ret == KNOT_EOK && fix.count == 2 &&
+	   name_is(fix.changes[0].owner, "d.example.com") &&
+	   name_is(fix.changes[0].next, "g.example.com") &&
+	   fix.extra_count == 1 &&
+	   name_is(fix.extra[0].owner, "c.example.com") &&
+	   name_is(fix.extra[0].next, "d.example.com"),
+	   "chain fix: add and remove element");
+	knot_nsec_chain_fix_free(&fix);
+
+	// Remove last element, the chain wraps
+	knot_nsec_chain_fix_init(&fix, &ops);
+	knot_nsec_chain_fix_add(&fix, knot_dname_from_str("g.example.com"),
+	                        NULL, true, false);
+	ret = knot_nsec_chain_fix(&fix);
+	ok(ret == KNOT_EOK && fix.extra_count == 1 &&
+	   name_is(fix.extra[0].owner, "e.example.com") &&
+	   name_is(fix.extra[0].next, "a.example.com"),
+	   "chain fix: remove last element");
+	knot_nsec_chain_fix_free(&fix);
+
+	// Unchanged element, nothing to fix
+	knot_nsec_chain_fix_init(&fix, &ops);
+	knot_nsec_chain_fix_add(&fix, knot_dname_from_str("c.example.com"),
+	                        NULL, true, true);
+	ret = knot_nsec_chain_fix(&fix);
+	ok(ret == KNOT_EOK && fix.extra_count == 0 &&
+	   name_is(fix.changes[0].next, "e.example.com"),
+	   "chain fix: unchanged element");
+	knot_nsec_chain_fix_free(&fix);
+
+	for (int i = 0; i < CHAIN_SIZE; ++i) {
+		knot_dname_free(&chain.names[i], NULL);
+	}
+}
+
+/*! \brief Add a record, or a fake signature of the type if signed. */
+static void zone_add(knot_zone_contents_t *zone, const char *owner_str,
+                     uint16_t type, const char *rdata, bool signed_type)
+{
+	uint8_t wire[64] = { 0 };
+	size_t size = strlen(rdata);
+	if (signed_type) {
+		// type covered, algorithm, signer name, fake signature
+		knot_wire_write_u16(wire, type);
+		wire[2] = 13;
+		memcpy(wire + 18, "\x07""example\x03""com", 13);
+		memcpy(wire + 18 + 13, rdata, size);
+		size += 18 + 13;
+		type = KNOT_RRTYPE_RRSIG;
+	} else {
+		memcpy(wire, rdata, size);
+	}
+
+	zone_add_rr(zone, owner_str, type, wire, size, 3600);
+}
+
+static void test_reuse(void)
+{
+	knot_dname_t *apex = knot_dname_from_str("example.com");
+	knot_zone_contents_t *old_zone = knot_zone_contents_new(apex);
+	knot_zone_contents_t *new_zone = knot_zone_contents_new(apex);
+	knot_dname_free(&apex, NULL);
+
+	// a: unchanged, b: changed, c: added
+	knot_zone_contents_t *zones[] = { old_zone, new_zone };
+	for (int i = 0; i < 2; ++i) {
+		zone_add(zones[i], "a.example.com", KNOT_RRTYPE_TXT, "\x01""a", false);
+		zone_add(zones[i], "b.example.com", KNOT_RRTYPE_TXT,
+		         i == 0 ? "\x01""b" : "\x01""B", false);
+	}
+	zone_add(old_zone, "a.example.com", KNOT_RRTYPE_TXT, "sigA", true);
+	zone_add(old_zone, "a.example.com", KNOT_RRTYPE_NSEC, "\x01""b\x07""example\x03""com", false);
+	zone_add(old_zone, "a.example.com", KNOT_RRTYPE_NSEC, "sigN", true);
+	zone_add(old_zone, "b.example.com", KNOT_RRTYPE_TXT, "sigB", true);
+	zone_add(new_zone, "c.example.com", KNOT_RRTYPE_TXT, "\x01""c", false);
+	knot_zone_contents_adjust_full(old_zone, NULL, NULL);
+	knot_zone_contents_adjust_full(new_zone, NULL, NULL);
+
+	size_t reused = 0;
+	int ret = knot_zone_sign_reuse(old_zone, new_zone, NULL, &reused);
+	const zone_node_t *a = knot_zone_contents_find_node(new_zone,
+	                         (const knot_dname_t *)"\x01""a\x07""example\x03""com");
+	const zone_node_t *b = knot_zone_contents_find_node(new_zone,
+	                         (const knot_dname_t *)"\x01""b\x07""example\x03""com");
+	ok(ret == KNOT_EOK && reused == 2 &&
+	   node_rrtype_is_signed(a, KNOT_RRTYPE_TXT),
+	   "reuse: signature of unchanged RR set");
+	ok(!node_rrtype_is_signed(b, KNOT_RRTYPE_TXT),
+	   "reuse: no signature of changed RR set");
+	ok(node_rrtype_exists(a, KNOT_RRTYPE_NSEC) &&
+	   node_rrtype_is_signed(a, KNOT_RRTYPE_NSEC) &&
+	   !node_rrtype_exists(b, KNOT_RRTYPE_NSEC),
+	   "reuse: NSEC of the previous chain");
+
+	knot_zone_contents_deep_free(&old_zone);
+	knot_zone_contents_deep_free(&new_zone);
+}
+
+#define TEST_TTL 3600
+
+/*! \brief Record of a test zone. */
+typedef struct {
+	const char *owner;
+	uint16_t type;
+	const char *rdata;
+	uint16_t size;
+} test_rr_t;
+
+#define TEST_RR(owner, type, rdata) { owner, type, rdata, sizeof(rdata) - 1 }
+#define TEST_RR_END { NULL, 0, NULL, 0 }
+
+/*! \brief Zone used for chain fixes, 'sub' and 'w' are empty non-terminals. */
+static const test_rr_t BASE_ZONE[] = {
+	TEST_RR("example.com", KNOT_RRTYPE_NS, "\x02""ns\x07""example\x03""com\x00"),
+	TEST_RR("ns.example.com", KNOT_RRTYPE_A, "\xc0\x00\x02\x01"),
+	TEST_RR("a.example.com", KNOT_RRTYPE_TXT, "\x01""a"),
+	TEST_RR("c.example.com", KNOT_RRTYPE_TXT, "\x01""c"),
+	TEST_RR("del.example.com", KNOT_RRTYPE_NS, "\x02""ns\x05""other\x00"),
+	TEST_RR("e.sub.example.com", KNOT_RRTYPE_TXT, "\x01""e"),
+	TEST_RR("m.example.com", KNOT_RRTYPE_TXT, "\x01""m"),
+	TEST_RR("*.w.example.com", KNOT_RRTYPE_TXT, "\x01""w"),
+	TEST_RR("z.example.com", KNOT_RRTYPE_TXT, "\x01""z"),
+	TEST_RR_END
+};
+
+/*! \brief Change of the base zone, records removed and added. */
+typedef struct {
+	const char *name;
+	test_rr_t remove[8];
+	test_rr_t add[8];
+} test_change_t;
+
+static const test_change_t CHANGES[] = {
+	{ "add names", {
+		TEST_RR_END
+	  }, {
+		TEST_RR("b.example.com", KNOT_RRTYPE_TXT, "\x01""b"),
+		TEST_RR("y.example.com", KNOT_RRTYPE_TXT, "\x01""y"),
+		TEST_RR("zz.example.com", KNOT_RRTYPE_TXT, "\x01""z"),
+		TEST_RR("x.new.example.com", KNOT_RRTYPE_TXT, "\x01""x"),
+		TEST_RR_END
+	} },
+	{ "remove names", {
+		TEST_RR("a.example.com", KNOT_RRTYPE_TXT, "\x01""a"),
+		TEST_RR("e.sub.example.com", KNOT_RRTYPE_TXT, "\x01""e"),
+		TEST_RR("*.w.example.com", KNOT_RRTYPE_TXT, "\x01""w"),
+		TEST_RR("z.example.com", KNOT_RRTYPE_TXT, "\x01""z"),
+		TEST_RR_END
+	  }, {
+		TEST_RR_END
+	} },
+	{ "delegations", {
+		TEST_RR("del.example.com", KNOT_RRTYPE_NS, "\x02""ns\x05""other\x00"),
+		TEST_RR_END
+	  }, {
+		TEST_RR("d2.example.com", KNOT_RRTYPE_NS, "\x02""ns\x05""other\x00"),
+		TEST_RR("q.example.com", KNOT_RRTYPE_NS, "\x02""ns\x05""other\x00"),
+		TEST_RR_END
+	} },
+	{ "mixed changes", {
+		TEST_RR("c.example.com", KNOT_RRTYPE_TXT, "\x01""c"),
+		TEST_RR("e.sub.example.com", KNOT_RRTYPE_TXT, "\x01""e"),
+		TEST_RR_END
+	  }, {
+		TEST_RR("a.example.com", KNOT_RRTYPE_MX, "\x00\x0a\x00"),
+		TEST_RR("c.c.example.com", KNOT_RRTYPE_TXT, "\x01""c"),
+		TEST_RR("f.sub.example.com", KNOT_RRTYPE_TXT, "\x01""f"),
+		TEST_RR("n.example.com", KNOT_RRTYPE_TXT, "\x01""n"),
+		TEST_RR_END
+	} }
+};
+
+static bool test_rr_in(const test_rr_t *rr, const test_rr_t *list)
+{
+	for (; list->owner != NULL; ++list) {
+		if (strcmp(rr->owner, list->owner) == 0 && rr->type == list->type) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*! \brief Create the base zone with the change applied. */
+static knot_zone_contents_t *change_zone(const test_change_t *change,
+                                         bool nsec3)
+{
+	knot_dname_t *apex = knot_dname_from_str("example.com");
+	knot_zone_contents_t *zone = knot_zone_contents_new(apex);
+	knot_dname_free(&apex, NULL);
+
+	// Serial differs so that the zones can be diffed
+	uint8_t soa[22] = { 0 };
+	soa[5] = change ? 2 : 1;
+	knot_wire_write_u32(soa + 18, TEST_TTL);
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_SOA, soa, sizeof(soa),
+	            TEST_TTL);
+	if (nsec3) {
+		const uint8_t param[] = { 1, 0, 0, 10, 2, 0xc0, 0x01 };
+		zone_add_rr(zone, "example.com", KNOT_RRTYPE_NSEC3PARAM, param,
+		            sizeof(param), 0);
+	}
+
+	for (const test_rr_t *rr = BASE_ZONE; rr->owner != NULL; ++rr) {
+		if (change == NULL || !test_rr_in(rr, change->remove)) {
+			zone_add_rr(zone, rr->owner, rr->type,
+			            (const uint8_t *)rr->rdata, rr->size, TEST_TTL);
+		}
+	}
+	for (const test_rr_t *rr = change ? change->add : NULL;
+	     rr != NULL && rr->owner != NULL; ++rr) {
+		zone_add_rr(zone, rr->owner, rr->type,
+		            (const uint8_t *)rr->rdata, rr->size, TEST_TTL);
+	}
+
+	return zone;
+}
+
+/*! \brief Chain records as sorted "owner type rdata" strings. */
+typedef struct {
+	char *items[128];
+	size_t count;
+	bool valid;
+} chain_t;
+
+static bool is_chain_type(uint16_t type)
+{
+	return type == KNOT_RRTYPE_NSEC || type == KNOT_RRTYPE_NSEC3;
+}
+
+static char *chain_item(const knot_rrset_t *rrset, size_t pos)
+{
+	const knot_rdata_t *rr = knot_rdataset_at(&rrset->rrs, pos);
+	uint16_t size = knot_rdata_rdlen(rr);
+	const uint8_t *data = knot_rdata_data(rr);
+
+	knot_dname_t *owner = knot_dname_copy(rrset->owner, NULL);
+	knot_dname_to_lower(owner);
+	char *owner_str = knot_dname_to_str(owner);
+	knot_dname_free(&owner, NULL);
+
+	char *item = malloc(strlen(owner_str) + 8 + 2 * size + 1);
+	int len = sprintf(item, "%s %u ", owner_str, rrset->type);
+	for (uint16_t i = 0; i < size; ++i) {
+		len += sprintf(item + len, "%02x", data[i]);
+	}
+	free(owner_str);
+
+	return item;
+}
+
+static void chain_add(chain_t *chain, const knot_rrset_t *rrset)
+{
+	if (!is_chain_type(rrset->type)) {
+		return;
+	}
+
+	for (uint16_t i = 0; i < rrset->rrs.rr_count; ++i) {
+		if (chain->count == sizeof(chain->items) / sizeof(char *)) {
+			chain->valid = false;
+			return;
+		}
+		chain->items[chain->count++] = chain_item(rrset, i);
+	}
+}
+
+static void chain_remove(chain_t *chain, const knot_rrset_t *rrset)
+{
+	if (!is_chain_type(rrset->type)) {
+		return;
+	}
+
+	for (uint16_t i = 0; i < rrset->rrs.rr_count; ++i) {
+		char *item = chain_item(rrset, i);
+		size_t pos = 0;
+		while (pos < chain->count && strcmp(chain->items[pos], item) != 0) {
+			++pos;
+		}
+		if (pos == chain->count) {
+			// Removal of a record not in the chain
+			chain->valid = false;
+		} else {
+			free(chain->items[pos]);
+			chain->items[pos] = chain->items[--chain->count];
+		}
+		free(item);
+	}
+}
+
+static void chain_add_list(chain_t *chain, const list_t *part, bool add)
+{
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, *part) {
+		if (add) {
+			chain_add(chain, rr_node->rr);
+		} else {
+			chain_remove(chain, rr_node->rr);
+		}
+	}
+}
+
+static void chain_add_tree(chain_t *chain, knot_zone_tree_t *tree)
+{
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(tree, false);
+	while (!knot_zone_tree_it_finished(it)) {
+		const zone_node_t *node = knot_zone_tree_it_val(it);
+		for (uint16_t i = 0; i < node->rrset_count; ++i) {
+			knot_rrset_t rrset = node_rrset_at(node, i);
+			chain_add(chain, &rrset);
+		}
+		knot_zone_tree_it_next(it);
+	}
+	knot_zone_tree_it_free(it);
+}
+
+static int item_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static bool chain_equal(chain_t *a, chain_t *b)
+{
+	if (!a->valid || !b->valid || a->count != b->count || a->count == 0) {
+		return false;
+	}
+
+	qsort(a->items, a->count, sizeof(char *), item_cmp);
+	qsort(b->items, b->count, sizeof(char *), item_cmp);
+	for (size_t i = 0; i < a->count; ++i) {
+		if (strcmp(a->items[i], b->items[i]) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void chain_clear(chain_t *chain)
+{
+	for (size_t i = 0; i < chain->count; ++i) {
+		free(chain->items[i]);
+	}
+}
+
+/*!
+ * \brief Check that fixing the chain after the change gives the same chain
+ *        as building it from scratch.
+ */
+static void test_fix_change(const test_change_t *change, bool nsec3)
+{
+	int (*create_chain)(const knot_zone_contents_t *, uint32_t,
+	                    knot_changeset_t *) =
+		nsec3 ? knot_nsec3_create_chain : knot_nsec_create_chain;
+	int (*fix_chain)(const knot_zone_contents_t *, const knot_changeset_t *,
+	                 uint32_t, knot_changeset_t *) =
+		nsec3 ? knot_nsec3_fix_chain : knot_nsec_fix_chain;
+
+	knot_changesets_t *chgsets = knot_changesets_create();
+	knot_changeset_t *old_chain = knot_changesets_create_changeset(chgsets);
+	knot_changeset_t *full_chain = knot_changesets_create_changeset(chgsets);
+	knot_changeset_t *in_ch = knot_changesets_create_changeset(chgsets);
+	knot_changeset_t *fix_ch = knot_changesets_create_changeset(chgsets);
+
+	// Current zone, new zone and the change between them
+	knot_zone_contents_t *old_zone = change_zone(NULL, nsec3);
+	knot_zone_contents_t *new_zone = change_zone(change, nsec3);
+	knot_zone_contents_adjust_full(old_zone, NULL, NULL);
+	knot_zone_contents_adjust_full(new_zone, NULL, NULL);
+	int ret = create_chain(old_zone, TEST_TTL, old_chain);
+	if (ret == KNOT_EOK) {
+		ret = create_chain(new_zone, TEST_TTL, full_chain);
+	}
+	if (ret == KNOT_EOK) {
+		ret = knot_zone_contents_create_diff(old_zone, new_zone, in_ch);
+	}
+
+	// Updated zone keeps the current chain until it is fixed
+	knot_zone_contents_t *updated = change_zone(change, nsec3);
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, old_chain->add) {
+		if (is_chain_type(rr_node->rr->type)) {
+			zone_node_t *node = NULL;
+			knot_zone_contents_add_rr(updated, rr_node->rr, &node, NULL);
+		}
+	}
+	knot_zone_contents_adjust_full(updated, NULL, NULL);
+
+	chain_t fixed = { .valid = true };
+	chain_add_tree(&fixed, updated->nodes);
+	chain_add_tree(&fixed, updated->nsec3_nodes);
+	if (ret == KNOT_EOK) {
+		ret = fix_chain(updated, in_ch, TEST_TTL, fix_ch);
+	}
+	chain_add_list(&fixed, &fix_ch->remove, false);
+	chain_add_list(&fixed, &fix_ch->add, true);
+
+	chain_t rebuilt = { .valid = true };
+	chain_add_list(&rebuilt, &full_chain->add, true);
+
+	ok(ret == KNOT_EOK && chain_equal(&fixed, &rebuilt),
+	   "chain fix: %s %s same as rebuilt chain", nsec3 ? "NSEC3" : "NSEC",
+	   change->name);
+
+	chain_clear(&fixed);
+	chain_clear(&rebuilt);
+	knot_changesets_free(&chgsets);
+	knot_zone_contents_deep_free(&old_zone);
+	knot_zone_contents_deep_free(&new_zone);
+	knot_zone_contents_deep_free(&updated);
+}
+
+/*!
+ * \brief Check that broken chain is rebuilt when it can't be fixed, without
+ *        leftovers of the failed fix.
+ */
+static void test_fix_fallback(void)
+{
+	const test_change_t *change = &CHANGES[0];
+	knot_changesets_t *chgsets = knot_changesets_create();
+	knot_changeset_t *old_chain = knot_changesets_create_changeset(chgsets);
+	knot_changeset_t *full_chain = knot_changesets_create_changeset(chgsets);
+	knot_changeset_t *in_ch = knot_changesets_create_changeset(chgsets);
+	knot_changeset_t *out_ch = knot_changesets_create_changeset(chgsets);
+
+	knot_zone_contents_t *old_zone = change_zone(NULL, false);
+	knot_zone_contents_t *new_zone = change_zone(change, false);
+	knot_zone_contents_adjust_full(old_zone, NULL, NULL);
+	knot_zone_contents_adjust_full(new_zone, NULL, NULL);
+	int ret = knot_nsec_create_chain(old_zone, TEST_TTL, old_chain);
+	if (ret == KNOT_EOK) {
+		ret = knot_nsec_create_chain(new_zone, TEST_TTL, full_chain);
+	}
+	if (ret == KNOT_EOK) {
+		ret = knot_zone_contents_create_diff(old_zone, new_zone, in_ch);
+	}
+
+	// Current chain misses the element after the first added name
+	knot_dname_t *broken = knot_dname_from_str("c.example.com");
+	knot_zone_contents_t *updated = change_zone(change, false);
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, old_chain->add) {
+		if (is_chain_type(rr_node->rr->type) &&
+		    !knot_dname_is_equal(rr_node->rr->owner, broken)) {
+			zone_node_t *node = NULL;
+			knot_zone_contents_add_rr(updated, rr_node->rr, &node, NULL);
+		}
+	}
+	knot_zone_contents_adjust_full(updated, NULL, NULL);
+	knot_dname_free(&broken, NULL);
+
+	chain_t fixed = { .valid = true };
+	chain_add_tree(&fixed, updated->nodes);
+	knot_zone_keys_t keys = { 0 };
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+	if (ret == KNOT_EOK) {
+		ret = knot_zone_fix_nsec_chain(updated, in_ch, out_ch, &keys,
+		                               &policy);
+	}
+	chain_add_list(&fixed, &out_ch->remove, false);
+	chain_add_list(&fixed, &out_ch->add, true);
+
+	chain_t rebuilt = { .valid = true };
+	chain_add_list(&rebuilt, &full_chain->add, true);
+
+	ok(ret == KNOT_EOK && chain_equal(&fixed, &rebuilt),
+	   "chain fix: rebuild broken chain without partial fix");
+
+	chain_clear(&fixed);
+	chain_clear(&rebuilt);
+	knot_changesets_free(&chgsets);
+	knot_zone_contents_deep_free(&old_zone);
+	knot_zone_contents_deep_free(&new_zone);
+	knot_zone_contents_deep_free(&updated);
+}
+
+static void test_fix_zone(void)
+{
+	size_t count = sizeof(CHANGES) / sizeof(CHANGES[0]);
+	for (size_t i = 0; i < count; ++i) {
+		test_fix_change(&CHANGES[i], false);
+		test_fix_change(&CHANGES[i], true);
+	}
+}
+
+/*! \brief Number of names in the zone hashed in parallel. */
+#define LARGE_COUNT (NSEC3_PARALLEL_MIN + 1000)
+
+static knot_zone_contents_t *large_zone_create(void)
+{
+	knot_zone_contents_t *zone = change_zone(NULL, true);
+	for (unsigned i = 0; i < LARGE_COUNT; ++i) {
+		char owner[32];
+		snprintf(owner, sizeof(owner), "h%05u.example.com", i);
+		zone_add_rr(zone, owner, KNOT_RRTYPE_TXT, (const uint8_t *)"\x01""h",
+		            2, TEST_TTL);
+	}
+	knot_zone_contents_adjust_full(zone, NULL, NULL);
+
+	return zone;
+}
+
+/*!
+ * \brief Compare type bitmaps of NSEC3 nodes, next hashes are not set yet.
+ */
+static bool nsec3_bitmaps_equal(const zone_node_t *a, const zone_node_t *b)
+{
+	uint8_t *a_bitmap = NULL, *b_bitmap = NULL;
+	uint16_t a_size = 0, b_size = 0;
+	knot_nsec3_bitmap(node_rdataset(a, KNOT_RRTYPE_NSEC3), 0, &a_bitmap, &a_size);
+	knot_nsec3_bitmap(node_rdataset(b, KNOT_RRTYPE_NSEC3), 0, &b_bitmap, &b_size);
+	return a_size == b_size && memcmp(a_bitmap, b_bitmap, a_size) == 0;
+}
+
+/*!
+ * \brief Check the NSEC3 nodes hashed in parallel match the serial hashing.
+ */
+static bool hash_slots_equal(const knot_zone_contents_t *zone)
+{
+	size_t weight = knot_zone_tree_weight(zone->nodes);
+	nsec3_hash_ctx_t parallel = { .zone = zone, .ttl = TEST_TTL };
+	nsec3_hash_ctx_t serial = { .zone = zone, .ttl = TEST_TTL };
+	parallel.nodes = malloc(weight * sizeof(zone_node_t *));
+	parallel.nsec3 = calloc(weight, sizeof(zone_node_t *));
+	serial.nsec3 = calloc(weight, sizeof(zone_node_t *));
+
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(zone->nodes, false);
+	while (!knot_zone_tree_it_finished(it)) {
+		parallel.nodes[parallel.count++] = knot_zone_tree_it_val(it);
+		knot_zone_tree_it_next(it);
+	}
+	knot_zone_tree_it_free(it);
+	serial.nodes = parallel.nodes;
+	serial.count = parallel.count;
+
+	nsec3_hash_nodes(&parallel);
+	nsec3_hash_range(&serial, 0, serial.count);
+
+	bool equal = parallel.count >= NSEC3_PARALLEL_MIN;
+	for (size_t i = 0; i < parallel.count; ++i) {
+		zone_node_t *a = parallel.nsec3[i];
+		zone_node_t *b = serial.nsec3[i];
+		equal = equal && a != NULL && b != NULL &&
+		        knot_dname_is_equal(a->owner, b->owner) &&
+		        nsec3_bitmaps_equal(a, b);
+		if (a != NULL) {
+			free_nsec3_node(a);
+		}
+		if (b != NULL) {
+			free_nsec3_node(b);
+		}
+	}
+
+	free(parallel.nodes);
+	free(parallel.nsec3);
+	free(serial.nsec3);
+
+	return equal;
+}
+
+static int dname_ptr_cmp(const void *a, const void *b)
+{
+	return knot_dname_cmp(*(knot_dname_t * const *)a,
+	                      *(knot_dname_t * const *)b);
+}
+
+/*!
+ * \brief Check owners and next hashes of the chain against the hashed names.
+ */
+static bool chain_matches_names(const knot_zone_contents_t *zone,
+                                const knot_changeset_t *chain)
+{
+	size_t count = 0;
+	size_t weight = knot_zone_tree_weight(zone->nodes);
+	knot_dname_t **owners = malloc(weight * sizeof(knot_dname_t *));
+
+	knot_zone_tree_it_t *it = knot_zone_tree_it_begin(zone->nodes, true);
+	while (!knot_zone_tree_it_finished(it)) {
+		const zone_node_t *node = knot_zone_tree_it_val(it);
+		owners[count++] = knot_create_nsec3_owner(node->owner,
+		                                          zone->apex->owner,
+		                                          &zone->nsec3_params);
+		knot_zone_tree_it_next(it);
+	}
+	knot_zone_tree_it_free(it);
+	qsort(owners, count, sizeof(knot_dname_t *), dname_ptr_cmp);
+
+	// the chain is created in canonical order
+	size_t pos = 0;
+	bool equal = true;
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, chain->add) {
+		const knot_rrset_t *rrset = rr_node->rr;
+		if (rrset->type != KNOT_RRTYPE_NSEC3) {
+			continue;
+		}
+		if (pos == count || !knot_dname_is_equal(rrset->owner, owners[pos])) {
+			equal = false;
+			break;
+		}
+
+		uint8_t *hash = NULL;
+		uint8_t hash_size = 0;
+		knot_nsec3_next_hashed(&rrset->rrs, 0, &hash, &hash_size);
+		knot_dname_t *next = knot_nsec3_hash_to_dname(hash, hash_size,
+		                                              zone->apex->owner);
+		equal = knot_dname_is_equal(next, owners[(pos + 1) % count]);
+		knot_dname_free(&next, NULL);
+		if (!equal) {
+			break;
+		}
+		pos += 1;
+	}
+	equal = equal && pos == count;
+
+	for (size_t i = 0; i < count; ++i) {
+		knot_dname_free(&owners[i], NULL);
+	}
+	free(owners);
+
+	return equal;
+}
+
+static void test_parallel(void)
+{
+	knot_zone_contents_t *zone = large_zone_create();
+	knot_zone_contents_load_nsec3param(zone);
+
+	ok(hash_slots_equal(zone),
+	   "NSEC3 chain: parallel hashing same as serial hashing");
+
+	knot_changesets_t *chgsets = knot_changesets_create();
+	knot_changeset_t *chain = knot_changesets_create_changeset(chgsets);
+	int ret = knot_nsec3_create_chain(zone, TEST_TTL, chain);
+	ok(ret == KNOT_EOK && chain_matches_names(zone, chain),
+	   "NSEC3 chain: large chain has owners and next hashes of all names");
+
+	knot_changesets_free(&chgsets);
+	knot_zone_contents_deep_free(&zone);
+}
+
+// Signal handler
+static void interrupt_handle(int s)
+{
+}
 
 int main(int argc, char *argv[])
 {
-	plan(1);
+	plan(18);
+
+	/* Worker threads are interrupted when stopped. */
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL);
 
 	knot_dname_t *owner  = knot_dname_from_str("name.example.com");
 	knot_dname_t *apex   = knot_dname_from_str("example.com");
@@ -41,5 +782,11 @@ int main(int argc, char *argv[])
 	knot_dname_free(&apex, NULL);
 	knot_dname_free(&expect, NULL);
 
+	test_chain_fix();
+	test_reuse();
+	test_fix_zone();
+	test_fix_fallback();
+	test_parallel();
+
 	return 0;
 }
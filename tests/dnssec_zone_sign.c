@@ -0,0 +1,411 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <tap/basic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "libknot/dnssec/config.h"
+#include "libknot/dnssec/crypto.h"
+#include "libknot/dnssec/rrset-sign.h"
+
+/*! \brief Number of signing and verification operations of the signer. */
+static size_t sign_count = 0;
+static size_t verify_count = 0;
+
+static int count_sign_rrset(knot_rrset_t *rrsigs, const knot_rrset_t *covered,
+                            const knot_dnssec_key_t *key,
+                            knot_dnssec_sign_context_t *sign_ctx,
+                            const knot_dnssec_policy_t *policy)
+{
+	sign_count += 1;
+	return knot_sign_rrset(rrsigs, covered, key, sign_ctx, policy);
+}
+
+static int count_sign_rrsets(knot_rrset_t *const rrsigs[],
+                             const knot_rrset_t *const covered[], size_t count,
+                             const knot_dnssec_key_t *key,
+                             knot_dnssec_sign_context_t *sign_ctx,
+                             const knot_dnssec_policy_t *policy)
+{
+	sign_count += count;
+	return knot_sign_rrsets(rrsigs, covered, count, key, sign_ctx, policy);
+}
+
+static int count_is_valid_signature(const knot_rrset_t *covered,
+                                    const knot_rrset_t *rrsigs, size_t pos,
+                                    const knot_dnssec_key_t *key,
+                                    knot_dnssec_sign_context_t *ctx,
+                                    const knot_dnssec_policy_t *policy)
+{
+	verify_count += 1;
+	return knot_is_valid_signature(covered, rrsigs, pos, key, ctx, policy);
+}
+
+// counting the signer operations
+#define knot_sign_rrset count_sign_rrset
+#define knot_sign_rrsets count_sign_rrsets
+#define knot_is_valid_signature count_is_valid_signature
+#include "knot/dnssec/zone-sign.c"
+#undef knot_sign_rrset
+#undef knot_sign_rrsets
+#undef knot_is_valid_signature
+
+#include "zone_helpers.h"
+
+#define TEST_COUNT 10
+
+/*! \brief Number of hosts in the test zone. */
+#define HOST_COUNT 10
+
+/*! \brief RR sets signed in the zone tree, DNSKEY and the hosts. */
+#define RRSET_COUNT (HOST_COUNT + 1)
+
+/*! \brief Number of hosts in the zone with staggered signature expirations. */
+#define REFRESH_HOSTS 1000
+
+/*! \brief Hosts with signatures due for refresh, more than one slice. */
+#define REFRESH_DUE 300
+
+/*! \brief Hosts with signatures expiring within half of the safety margin. */
+#define REFRESH_URGENT 150
+
+/* ECDSA P-256 zone signing key of example.com. */
+static const char *KEY_PUBLIC =
+	"example.com. IN DNSKEY 256 3 13 blXaCLukAMcr+TklzAePyEnCOzjsuEfEcd8B/D9e"
+	"2iFix/z7tk1p5+wF2eZWYm5NxS0uxWWHbdgx78v2Zv1YGA==\n";
+static const char *KEY_PRIVATE =
+	"Private-key-format: v1.2\n"
+	"Algorithm: 13 (ECDSAP256SHA256)\n"
+	"PrivateKey: sk+7o3OxW6pZRT4eAiXACQ3FPkpuMqiH6DGt8bKGt88=\n";
+
+static void write_file(const char *path, const char *data)
+{
+	FILE *f = fopen(path, "w");
+	if (f != NULL) {
+		fputs(data, f);
+		fclose(f);
+	}
+}
+
+/*!
+ * \brief Create the test zone, one host differs between the versions.
+ */
+static knot_zone_contents_t *zone_create(const knot_rrset_t *dnskey,
+                                         uint8_t version)
+{
+	knot_dname_t *apex = knot_dname_from_str("example.com");
+	knot_zone_contents_t *zone = knot_zone_contents_new(apex);
+	knot_dname_free(&apex, NULL);
+
+	uint8_t soa[22] = { 0 };
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_SOA, soa, sizeof(soa), 3600);
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_DNSKEY,
+	            knot_rrset_rr_rdata(dnskey, 0),
+	            knot_rrset_rr_size(dnskey, 0), 3600);
+
+	for (uint8_t i = 0; i < HOST_COUNT; ++i) {
+		char owner[32];
+		snprintf(owner, sizeof(owner), "host%u.example.com", i);
+		uint8_t a[4] = { 192, 0, 2, i };
+		if (i == HOST_COUNT / 2) {
+			a[3] += version;
+		}
+		zone_add_rr(zone, owner, KNOT_RRTYPE_A, a, sizeof(a), 3600);
+	}
+
+	knot_zone_contents_adjust_full(zone, NULL, NULL);
+
+	return zone;
+}
+
+/*!
+ * \brief Add new records from the changeset into the zone.
+ */
+static void zone_apply_add(knot_zone_contents_t *zone,
+                           const knot_changeset_t *changeset)
+{
+	knot_rr_ln_t *n = NULL;
+	WALK_LIST(n, changeset->add) {
+		zone_node_t *node = NULL;
+		knot_zone_contents_add_rr(zone, n->rr, &node, NULL);
+	}
+}
+
+/*!
+ * \brief Sign the zone and count the operations.
+ */
+static int zone_sign(const knot_zone_contents_t *zone,
+                     const knot_zone_keys_t *keys,
+                     const knot_dnssec_policy_t *policy, hattrie_t *trusted,
+                     knot_changesets_t **changesets)
+{
+	sign_count = 0;
+	verify_count = 0;
+
+	*changesets = knot_changesets_create();
+	knot_changeset_t *changeset = knot_changesets_create_changeset(*changesets);
+	uint32_t refresh_at = 0;
+
+	return knot_zone_sign(zone, keys, policy, trusted, changeset, &refresh_at);
+}
+
+static void test_reload(const knot_zone_keys_t *keys,
+                        const knot_rrset_t *dnskey)
+{
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+
+	// 1. - the first version is signed completely
+	knot_zone_contents_t *old_zone = zone_create(dnskey, 0);
+	knot_changesets_t *changesets = NULL;
+	int ret = zone_sign(old_zone, keys, &policy, NULL, &changesets);
+	ok(ret == KNOT_EOK && sign_count == RRSET_COUNT,
+	   "zone sign: sign all RR sets of a new zone");
+	zone_apply_add(old_zone, knot_changesets_get_last(changesets));
+
+	// 2. - reload with one changed RR set
+	knot_zone_contents_t *new_zone = zone_create(dnskey, 1);
+	hattrie_t *trusted = hattrie_create();
+	size_t reused = 0;
+	ret = knot_zone_sign_reuse(old_zone, new_zone, trusted, &reused);
+	ok(ret == KNOT_EOK && reused == RRSET_COUNT - 1,
+	   "zone sign: reuse signatures of unchanged RR sets");
+
+	// 3.-4. - only the changed RR set is signed, only DNSKEY is verified
+	knot_changesets_free(&changesets);
+	ret = zone_sign(new_zone, keys, &policy, trusted, &changesets);
+	ok(ret == KNOT_EOK && sign_count == 1,
+	   "zone sign: sign only the changed RR set");
+	ok(verify_count == 1,
+	   "zone sign: don't verify reused signatures");
+
+	// 5. - signatures not known to be reused are verified
+	knot_changesets_free(&changesets);
+	ret = zone_sign(new_zone, keys, &policy, NULL, &changesets);
+	ok(ret == KNOT_EOK && sign_count == 1 && verify_count >= RRSET_COUNT - 1,
+	   "zone sign: verify signatures which are not trusted");
+
+	// 6. - expiring reused signatures are replaced
+	knot_changesets_free(&changesets);
+	policy.refresh_before = UINT32_MAX;
+	ret = zone_sign(new_zone, keys, &policy, trusted, &changesets);
+	ok(ret == KNOT_EOK && sign_count == RRSET_COUNT,
+	   "zone sign: replace expiring reused signatures");
+
+	knot_changesets_free(&changesets);
+	hattrie_free(trusted);
+	knot_zone_contents_deep_free(&old_zone);
+	knot_zone_contents_deep_free(&new_zone);
+}
+
+/*!
+ * \brief Create the signed zone for the refresh tests.
+ */
+static knot_zone_contents_t *refresh_zone_create(const knot_zone_keys_t *keys,
+                                                 const knot_dnssec_policy_t *policy,
+                                                 const knot_rrset_t *dnskey)
+{
+	knot_dname_t *apex = knot_dname_from_str("example.com");
+	knot_zone_contents_t *zone = knot_zone_contents_new(apex);
+	knot_dname_free(&apex, NULL);
+
+	uint8_t soa[22] = { 0 };
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_SOA, soa, sizeof(soa), 3600);
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_DNSKEY,
+	            knot_rrset_rr_rdata(dnskey, 0),
+	            knot_rrset_rr_size(dnskey, 0), 3600);
+
+	for (unsigned i = 0; i < REFRESH_HOSTS; ++i) {
+		char owner[32];
+		snprintf(owner, sizeof(owner), "r%04u.example.com", i);
+		uint8_t a[4] = { 192, 0, 2 + i / 256, i % 256 };
+		zone_add_rr(zone, owner, KNOT_RRTYPE_A, a, sizeof(a), 3600);
+	}
+
+	knot_zone_contents_adjust_full(zone, NULL, NULL);
+
+	knot_changesets_t *changesets = NULL;
+	zone_sign(zone, keys, policy, NULL, &changesets);
+	zone_apply_add(zone, knot_changesets_get_last(changesets));
+	knot_changesets_free(&changesets);
+
+	return zone;
+}
+
+/*!
+ * \brief Set expiration of the host signature.
+ */
+static void host_set_expiration(knot_zone_contents_t *zone, unsigned host,
+                                uint32_t expiration)
+{
+	char owner_str[32];
+	snprintf(owner_str, sizeof(owner_str), "r%04u.example.com", host);
+	knot_dname_t *owner = knot_dname_from_str(owner_str);
+	zone_node_t *node = (zone_node_t *)knot_zone_contents_find_node(zone, owner);
+	knot_dname_free(&owner, NULL);
+
+	knot_rdataset_t *rrsigs = node_rdataset(node, KNOT_RRTYPE_RRSIG);
+	for (uint16_t i = 0; i < rrsigs->rr_count; ++i) {
+		uint8_t *rdata = knot_rdata_data(knot_rdataset_at(rrsigs, i));
+		knot_wire_write_u32(rdata + 8, expiration);
+	}
+}
+
+/*!
+ * \brief Count removed signatures, check they all expire before the horizon.
+ */
+static size_t removed_rrsigs(const knot_changeset_t *changeset,
+                             uint32_t horizon)
+{
+	size_t count = 0;
+	knot_rr_ln_t *n = NULL;
+	WALK_LIST(n, changeset->remove) {
+		const knot_rrset_t *rrsigs = n->rr;
+		if (rrsigs->type != KNOT_RRTYPE_RRSIG) {
+			continue;
+		}
+		for (uint16_t i = 0; i < rrsigs->rrs.rr_count; ++i) {
+			if (knot_rrsig_sig_expiration(&rrsigs->rrs, i) > horizon) {
+				return SIZE_MAX;
+			}
+			count += 1;
+		}
+	}
+
+	return count;
+}
+
+static int zone_refresh(const knot_zone_contents_t *zone,
+                        const knot_zone_keys_t *keys,
+                        const knot_dnssec_policy_t *policy,
+                        knot_changesets_t **changesets, uint32_t *refresh_at)
+{
+	sign_count = 0;
+
+	*changesets = knot_changesets_create();
+	knot_changeset_t *changeset = knot_changesets_create_changeset(*changesets);
+
+	return knot_zone_sign_refresh(zone, keys, policy, changeset, refresh_at);
+}
+
+static void test_refresh(const knot_zone_keys_t *keys,
+                         const knot_rrset_t *dnskey)
+{
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+	knot_zone_contents_t *zone = refresh_zone_create(keys, &policy, dnskey);
+
+	// oldest signatures due first, the rest expires after the refresh time
+	uint32_t half_margin = (policy.refresh_before - policy.now) / 2;
+	uint32_t due_from = policy.now + half_margin + 1000;
+	for (unsigned i = 0; i < REFRESH_HOSTS; ++i) {
+		if (i < REFRESH_DUE) {
+			host_set_expiration(zone, i, due_from + 60 * i);
+		} else {
+			host_set_expiration(zone, i, policy.refresh_before + 86400);
+		}
+	}
+
+	// 1.-3. - bounded slice of the oldest signatures, next slice at next tick
+	knot_changesets_t *changesets = NULL;
+	uint32_t refresh_at = 0;
+	int ret = zone_refresh(zone, keys, &policy, &changesets, &refresh_at);
+	knot_changeset_t *changeset = knot_changesets_get_last(changesets);
+	ok(ret == KNOT_EOK && sign_count == REFRESH_SLICE_MIN,
+	   "zone sign: refresh a bounded slice of signatures");
+	size_t slice = REFRESH_SLICE_MIN;
+	ok(removed_rrsigs(changeset, due_from + 60 * (slice - 1)) == slice,
+	   "zone sign: refresh only the oldest due signatures");
+	ok(refresh_at == policy.now + policy.resign_tick,
+	   "zone sign: schedule next slice at the next tick");
+	knot_changesets_free(&changesets);
+
+	// 4. - signatures expiring within half of the margin exceed the bound
+	for (unsigned i = 0; i < REFRESH_URGENT; ++i) {
+		host_set_expiration(zone, i, policy.now + 1000 + i);
+	}
+	ret = zone_refresh(zone, keys, &policy, &changesets, &refresh_at);
+	changeset = knot_changesets_get_last(changesets);
+	ok(ret == KNOT_EOK && sign_count == REFRESH_URGENT &&
+	   removed_rrsigs(changeset, policy.now + half_margin) == sign_count,
+	   "zone sign: refresh all signatures expiring before the horizon");
+	knot_changesets_free(&changesets);
+
+	knot_zone_contents_deep_free(&zone);
+}
+
+int main(int argc, char *argv[])
+{
+	plan(TEST_COUNT);
+
+#ifdef KNOT_ENABLE_ECDSA
+	char keydir[] = "/tmp/knot-zone_sign.XXXXXX";
+	if (mkdtemp(keydir) == NULL) {
+		skip_block(TEST_COUNT, "zone sign: cannot create key directory");
+		return 0;
+	}
+
+	char public[256], private[256];
+	snprintf(public, sizeof(public), "%s/Kexample.com.+013+40828.key", keydir);
+	snprintf(private, sizeof(private), "%s/Kexample.com.+013+40828.private", keydir);
+	write_file(public, KEY_PUBLIC);
+	write_file(private, KEY_PRIVATE);
+
+	knot_key_params_t params = { 0 };
+	knot_zone_keys_t keys = { 0 };
+	knot_zone_key_t *key = &keys.keys[0];
+	int ret = knot_load_key_params(private, &params);
+	if (ret == KNOT_EOK) {
+		ret = knot_dnssec_key_from_params(&params, &key->dnssec_key);
+	}
+	key->context = knot_dnssec_sign_init(&key->dnssec_key);
+	key->is_public = true;
+	key->is_active = true;
+	keys.count = 1;
+
+	knot_dname_t *owner = knot_dname_from_str("example.com");
+	knot_rrset_t dnskey;
+	knot_rrset_init(&dnskey, owner, KNOT_RRTYPE_DNSKEY, KNOT_CLASS_IN);
+	knot_rrset_add_rdata(&dnskey, params.rdata.data, params.rdata.size,
+	                     3600, NULL);
+
+	if (ret == KNOT_EOK && key->context != NULL) {
+		test_reload(&keys, &dnskey);
+		test_refresh(&keys, &dnskey);
+	} else {
+		skip_block(TEST_COUNT, "zone sign: cannot load signing key");
+	}
+
+	knot_rdataset_clear(&dnskey.rrs, NULL);
+	knot_dname_free(&owner, NULL);
+	knot_dnssec_sign_free(key->context);
+	knot_dnssec_key_free(&key->dnssec_key);
+	knot_free_key_params(&params);
+
+	unlink(public);
+	unlink(private);
+	rmdir(keydir);
+#else
+	skip_block(TEST_COUNT, "zone sign: ECDSA not supported");
+#endif
+
+	knot_crypto_cleanup();
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <tap/basic.h>
+
+#include "common/errcode.h"
+#include "common/numa.h"
+
+/*! \brief Create fake node description. */
+static void make_node(const char *root, const char *node, const char *cpulist)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", root, node);
+	mkdir(path, 0700);
+	if (cpulist == NULL) {
+		return;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s/cpulist", root, node);
+	FILE *fp = fopen(path, "w");
+	fputs(cpulist, fp);
+	fclose(fp);
+}
+
+static void remove_node(const char *root, const char *node)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s/cpulist", root, node);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/%s", root, node);
+	rmdir(path);
+}
+
+int main(int argc, char *argv[])
+{
+	plan(9);
+
+	/* CPU lists. */
+	unsigned cpus[8] = { 0 };
+	int ret = numa_cpulist_parse("0-3,8,10-11\n", cpus, 8);
+	ok(ret == 7 && cpus[3] == 3 && cpus[4] == 8 && cpus[6] == 11,
+	   "numa: parse CPU list");
+	ok(numa_cpulist_parse("0-1023", NULL, 0) == 1024,
+	   "numa: count CPU list");
+	ok(numa_cpulist_parse("0-", cpus, 8) == KNOT_EMALF &&
+	   numa_cpulist_parse("3-1", cpus, 8) == KNOT_EMALF &&
+	   numa_cpulist_parse("1;2", cpus, 8) == KNOT_EMALF,
+	   "numa: malformed CPU list");
+
+	/* Fake sysfs with sparse nodes and a memory-only node. */
+	char root[] = "/tmp/knot-numa.XXXXXX";
+	if (mkdtemp(root) == NULL) {
+		skip_block(5, "can't create temporary directory");
+	} else {
+		make_node(root, "node2", "4-7\n");
+		make_node(root, "node0", "0-3\n");
+		make_node(root, "node1", "\n");
+		make_node(root, "node3", NULL);
+		make_node(root, "nodex", "8\n");
+
+		numa_topo_t topo;
+		ret = numa_topo_load(&topo, root);
+		ok(ret == KNOT_EOK && topo.count == 2, "numa: load nodes");
+		ok(topo.nodes[0].id == 0 && topo.nodes[1].id == 2,
+		   "numa: nodes ordered by number");
+		const numa_node_t *node = numa_topo_node(&topo, 2);
+		ok(node != NULL && node->ncpus == 4 && node->cpus[0] == 4,
+		   "numa: find node");
+		ok(numa_topo_node(&topo, 1) == NULL &&
+		   numa_topo_node(&topo, -1) == NULL,
+		   "numa: find node without CPUs");
+		numa_topo_free(&topo);
+		ok(topo.count == 0 && topo.nodes == NULL, "numa: free");
+
+		remove_node(root, "node0");
+		remove_node(root, "node1");
+		remove_node(root, "node2");
+		remove_node(root, "node3");
+		remove_node(root, "nodex");
+		rmdir(root);
+	}
+
+	/* Missing topology. */
+	numa_topo_t topo;
+	ret = numa_topo_load(&topo, "/nonexistent");
+	ok(ret == KNOT_EOK && topo.count == 1 && topo.nodes[0].id == 0 &&
+	   topo.nodes[0].ncpus == sysconf(_SC_NPROCESSORS_ONLN),
+	   "numa: single node fallback");
+	numa_topo_free(&topo);
+
+	return 0;
+}
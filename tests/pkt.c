@@ -43,7 +43,7 @@ const char *g_rdata[DATACOUNT] = {
 
 int main(int argc, char *argv[])
 {
-	plan(25);
+	plan(32);
 
 	/* Create memory pool context. */
 	int ret = 0;
@@ -169,6 +169,64 @@ int main(int argc, char *argv[])
 	}
 	is_int(NAMECOUNT, rr_matched, "pkt: RR content match");
 
+	/* Query parser falls back to the full parser for responses. */
+	knot_pkt_t *resp = knot_pkt_new(out->wire, out->size, &out->mm);
+	ret = knot_pkt_parse_query(resp, 0);
+	ok(ret == KNOT_EOK && resp->rrset_count == in->rrset_count,
+	   "pkt: parse response as query");
+	knot_pkt_free(&resp);
+
+	/* Standard query with OPT RR. */
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MIN_PKTSIZE, &mm);
+	knot_pkt_opt_set(query, KNOT_PKT_EDNS_PAYLOAD, &data, sizeof(data));
+	knot_pkt_opt_set(query, KNOT_PKT_EDNS_VERSION, &version, sizeof(version));
+	knot_pkt_opt_set(query, KNOT_PKT_EDNS_FLAG_DO, NULL, 0);
+	knot_pkt_opt_set(query, KNOT_PKT_EDNS_NSID, NULL, 0);
+	knot_pkt_put_question(query, knot_pkt_qname(out), KNOT_CLASS_IN,
+	                      KNOT_RRTYPE_A);
+	knot_pkt_begin(query, KNOT_ADDITIONAL);
+	knot_pkt_put_opt(query);
+
+	knot_pkt_t *parsed = knot_pkt_new(query->wire, query->size, &mm);
+	ret = knot_pkt_parse_query(parsed, 0);
+	ok(ret == KNOT_EOK && parsed->parsed == parsed->size &&
+	   parsed->rrset_count == 0, "pkt: parse query in place");
+	ok(knot_pkt_have_dnssec(parsed) && knot_pkt_have_nsid(parsed) &&
+	   knot_edns_get_payload(&parsed->opt_rr) == data,
+	   "pkt: parse query OPT RR");
+	ok(knot_dname_is_equal(knot_pkt_qname(parsed), knot_pkt_qname(out)) &&
+	   knot_pkt_qtype(parsed) == KNOT_RRTYPE_A, "pkt: parse query question");
+	knot_pkt_free(&parsed);
+
+	/* Trailing data is left for the full parser. */
+	query->wire[query->size] = 0;
+	parsed = knot_pkt_new(query->wire, query->size + 1, &mm);
+	ret = knot_pkt_parse_query(parsed, 0);
+	ok(ret != KNOT_EOK, "pkt: parse query with trailing data");
+	knot_pkt_free(&parsed);
+	knot_pkt_free(&query);
+
+	/* Preallocated packet is reused after free. */
+	knot_pkt_t *prealloc = malloc(sizeof(knot_pkt_t));
+	bool reused = true;
+	for (unsigned i = 0; i < 2; ++i) {
+		parsed = prealloc;
+		ret = knot_pkt_init(parsed, NULL, KNOT_WIRE_MAX_PKTSIZE, &mm);
+		ret |= knot_pkt_put_question(parsed, rrsets[0]->owner,
+		                             KNOT_CLASS_IN, KNOT_RRTYPE_A);
+		reused = reused && ret == KNOT_EOK &&
+		         knot_wire_get_qdcount(parsed->wire) == 1;
+		knot_pkt_free(&parsed);
+	}
+	ok(reused && parsed == NULL, "pkt: reuse preallocated packet");
+	parsed = prealloc;
+	ret = knot_pkt_init(parsed, out->wire, out->size, &mm);
+	ret |= knot_pkt_parse_query(parsed, 0);
+	ok(ret == KNOT_EOK && parsed->wire == out->wire,
+	   "pkt: parse into preallocated packet");
+	knot_pkt_free(&parsed);
+	free(prealloc);
+
 	/* Free packets. */
 	knot_pkt_free(&out);
 	knot_pkt_free(&in);
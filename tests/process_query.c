@@ -117,7 +117,7 @@ static void exec_query(knot_process_t *query_ctx, const char *name,
 
 int main(int argc, char *argv[])
 {
-	plan(8*6 + 3); /* exec_query = 6 TAP tests */
+	plan(8*6 + 6); /* exec_query = 6 TAP tests */
 
 	/* Create processing context. */
 	knot_process_t query_ctx;
@@ -220,6 +220,43 @@ int main(int argc, char *argv[])
 	state = knot_process_finish(&query_ctx);
 	ok(state == NS_PROC_NOOP, "ns: processing end" );
 
+	/* Preallocated query data (system allocator catches bad frees). */
+	knot_process_t prealloc_ctx;
+	memset(&prealloc_ctx, 0, sizeof(knot_process_t));
+	mm_ctx_init(&prealloc_ctx.mm);
+	struct query_data *qdata = malloc(sizeof(struct query_data));
+	param.qdata = qdata;
+	knot_process_begin(&prealloc_ctx, &param, NS_PROC_QUERY);
+
+	/* Take all preallocated list nodes and one more. */
+	bool from_pool = true;
+	struct wildcard_hit *wildcard = NULL;
+	struct rrsig_info *rrsig = NULL;
+	for (unsigned i = 0; i <= QUERY_PREALLOC_NODES; ++i) {
+		wildcard = query_wildcard_alloc(qdata);
+		rrsig = query_rrsig_alloc(qdata);
+		knot_rrset_init_empty(&rrsig->synth_rrsig);
+		add_tail(&qdata->wildcards, &wildcard->n);
+		add_tail(&qdata->rrsigs, &rrsig->n);
+		if (i < QUERY_PREALLOC_NODES) {
+			from_pool = from_pool && wildcard == &qdata->wildcard_pool[i] &&
+			            rrsig == &qdata->rrsig_pool[i];
+		}
+	}
+	ok(from_pool, "ns: list nodes taken from preallocated query data");
+	ok(wildcard != &qdata->wildcard_pool[QUERY_PREALLOC_NODES - 1] &&
+	   rrsig != &qdata->rrsig_pool[QUERY_PREALLOC_NODES - 1],
+	   "ns: list nodes allocated when preallocated are used up");
+
+	/* Reset reuses the preallocated nodes. */
+	knot_process_reset(&prealloc_ctx);
+	ok(EMPTY_LIST(qdata->wildcards) && EMPTY_LIST(qdata->rrsigs) &&
+	   query_wildcard_alloc(qdata) == &qdata->wildcard_pool[0] &&
+	   query_rrsig_alloc(qdata) == &qdata->rrsig_pool[0],
+	   "ns: list nodes reused after reset");
+	knot_process_finish(&prealloc_ctx);
+	free(qdata);
+
 	/* Cleanup. */
 	mp_delete((struct mempool *)query_ctx.mm.ctx);
 	server_deinit(&server);
@@ -0,0 +1,263 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <time.h>
+#include <tap/basic.h>
+
+#include "common/errcode.h"
+#include "libknot/common.h"
+#include "common/mempattern.h"
+#include "common/qp-trie/trie.h"
+
+/* Constants. */
+#define KEY_MAXLEN 16
+#define KEY_COUNT 50000
+
+/*! \brief Binary key, may contain zero bytes and prefixes of other keys. */
+typedef struct {
+	uint32_t len;
+	uint8_t data[KEY_MAXLEN];
+} bin_key_t;
+
+static void key_rand(bin_key_t *key)
+{
+	/* Short alphabet with zero byte to get shared prefixes. */
+	static const uint8_t alphabet[] = { 0x00, 0x01, 0x0f, 0x10, 'a', 0xff };
+	key->len = rand() % KEY_MAXLEN;
+	for (unsigned i = 0; i < key->len; ++i) {
+		key->data[i] = alphabet[rand() % sizeof(alphabet)];
+	}
+}
+
+static int key_cmp(const uint8_t *k1, uint32_t l1,
+                   const uint8_t *k2, uint32_t l2)
+{
+	int ret = memcmp(k1, k2, l1 < l2 ? l1 : l2);
+	if (ret == 0) {
+		ret = (l1 > l2) - (l1 < l2);
+	}
+	return ret;
+}
+
+/* UCW array sorting defines. */
+#define ASORT_PREFIX(X) key_##X
+#define ASORT_KEY_TYPE bin_key_t*
+#define ASORT_LT(x, y) (key_cmp((x)->data, (x)->len, (y)->data, (y)->len) < 0)
+#include "common/array-sort.h"
+
+/*! \brief Reference greatest key lesser or equal (sorted unique keys). */
+static bin_key_t *ref_leq(bin_key_t **keys, size_t count, const uint8_t *key,
+                          uint32_t len)
+{
+	size_t lo = 0, hi = count;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (key_cmp(keys[mid]->data, keys[mid]->len, key, len) <= 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo > 0 ? keys[lo - 1] : NULL;
+}
+
+/*! \brief Check lesser or equal lookup against the reference. */
+static bool check_leq(trie_t *trie, bin_key_t **keys, size_t count,
+                      const uint8_t *key, uint32_t len)
+{
+	trie_val_t *val = NULL;
+	int ret = trie_get_leq(trie, key, len, &val);
+	bin_key_t *expect = ref_leq(keys, count, key, len);
+	if (expect == NULL) {
+		return ret == 1 && val == NULL;
+	}
+	if (val == NULL || *val != expect) {
+		return false;
+	}
+	bool exact = key_cmp(expect->data, expect->len, key, len) == 0;
+	return ret == (exact ? 0 : -1);
+}
+
+/*! \brief Check longest prefix lookup against exact lookups of prefixes. */
+static bool check_prefix(trie_t *trie, const uint8_t *key, uint32_t len)
+{
+	trie_val_t *expect = NULL;
+	for (int i = len; i >= 0 && expect == NULL; --i) {
+		expect = trie_get_try(trie, key, i);
+	}
+	return trie_get_prefix(trie, key, len) == expect;
+}
+
+static int count_cb(trie_val_t *val, void *data)
+{
+	size_t *count = data;
+	*count += 1;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	plan(10);
+
+	/* Random keys. */
+	srand(time(NULL));
+	bin_key_t *keys = xmalloc(sizeof(bin_key_t) * KEY_COUNT);
+	bin_key_t **sorted = xmalloc(sizeof(bin_key_t *) * KEY_COUNT);
+	for (unsigned i = 0; i < KEY_COUNT; ++i) {
+		key_rand(&keys[i]);
+	}
+
+	/* Create trie. */
+	trie_t *trie = trie_create(NULL);
+	ok(trie != NULL, "qp-trie: create");
+
+	/* Insert keys, first inserted duplicate is kept. */
+	bool passed = true;
+	size_t inserted = 0;
+	for (unsigned i = 0; i < KEY_COUNT; ++i) {
+		trie_val_t *val = trie_get_ins(trie, keys[i].data, keys[i].len);
+		if (val == NULL) {
+			passed = false;
+			break;
+		}
+		if (*val == NULL) {
+			*val = &keys[i];
+			sorted[inserted++] = &keys[i];
+		}
+	}
+	ok(passed && trie_weight(trie) == inserted, "qp-trie: insert");
+	key_sort(sorted, inserted);
+
+	/* Lookup all keys. */
+	passed = true;
+	for (unsigned i = 0; i < KEY_COUNT; ++i) {
+		trie_val_t *val = trie_get_try(trie, keys[i].data, keys[i].len);
+		const bin_key_t *found = val ? *val : NULL;
+		if (found == NULL || key_cmp(found->data, found->len,
+		                             keys[i].data, keys[i].len) != 0) {
+			diag("qp-trie: mismatch on element '%u'", i);
+			passed = false;
+			break;
+		}
+	}
+	ok(passed, "qp-trie: lookup all keys");
+
+	/* Lesser or equal lookup, exact and around each key. */
+	passed = true;
+	for (unsigned i = 0; i < inserted && passed; ++i) {
+		bin_key_t k = *sorted[i];
+		passed = check_leq(trie, sorted, inserted, k.data, k.len) &&
+		         check_leq(trie, sorted, inserted, k.data, k.len / 2);
+		if (k.len > 0) {
+			k.data[k.len - 1] -= 1;
+			passed = passed && check_leq(trie, sorted, inserted, k.data, k.len);
+			k.data[k.len - 1] += 2;
+			passed = passed && check_leq(trie, sorted, inserted, k.data, k.len);
+			k.data[k.len - 1] -= 1;
+		}
+		if (k.len < KEY_MAXLEN) {
+			k.data[k.len] = 0x08;
+			passed = passed &&
+			         check_leq(trie, sorted, inserted, k.data, k.len + 1);
+		}
+		if (!passed) {
+			diag("qp-trie: leq failed around element '%u'", i);
+		}
+	}
+	ok(passed, "qp-trie: find lesser or equal for all keys");
+
+	/* Longest prefix of the keys and their extensions. */
+	passed = true;
+	for (unsigned i = 0; i < KEY_COUNT && passed; ++i) {
+		bin_key_t k = keys[i];
+		passed = check_prefix(trie, k.data, k.len) &&
+		         check_prefix(trie, k.data, k.len / 2);
+		if (k.len < KEY_MAXLEN) {
+			k.data[k.len] = 0x08;
+			passed = passed && check_prefix(trie, k.data, k.len + 1);
+		}
+		if (!passed) {
+			diag("qp-trie: prefix failed around element '%u'", i);
+		}
+	}
+	ok(passed, "qp-trie: find longest prefix for all keys");
+
+	/* Sorted iteration. */
+	size_t iterated = 0;
+	trie_it_t *it = trie_it_begin(trie);
+	for (; !trie_it_finished(it); trie_it_next(it)) {
+		uint32_t len = 0;
+		const uint8_t *key = trie_it_key(it, &len);
+		if (iterated >= inserted) {
+			break;
+		}
+		const bin_key_t *expect = sorted[iterated];
+		if (*trie_it_val(it) != expect ||
+		    key_cmp(key, len, expect->data, expect->len) != 0) {
+			break;
+		}
+		++iterated;
+	}
+	trie_it_free(it);
+	is_int(inserted, iterated, "qp-trie: sorted iteration");
+
+	/* Apply. */
+	size_t applied = 0;
+	trie_apply(trie, count_cb, &applied);
+	is_int(inserted, applied, "qp-trie: apply");
+
+	/* Delete every other key. */
+	passed = true;
+	for (unsigned i = 0; i < inserted; i += 2) {
+		trie_val_t val = NULL;
+		int ret = trie_del(trie, sorted[i]->data, sorted[i]->len, &val);
+		if (ret != KNOT_EOK || val != sorted[i]) {
+			passed = false;
+			break;
+		}
+	}
+	ok(passed && trie_weight(trie) == inserted / 2, "qp-trie: delete");
+
+	passed = true;
+	for (unsigned i = 0; i < inserted; ++i) {
+		trie_val_t *val = trie_get_try(trie, sorted[i]->data, sorted[i]->len);
+		if ((i % 2 == 0) != (val == NULL)) {
+			passed = false;
+			break;
+		}
+		if (i % 2 == 0 && trie_del(trie, sorted[i]->data, sorted[i]->len,
+		                           NULL) != KNOT_ENOENT) {
+			passed = false;
+			break;
+		}
+	}
+	ok(passed, "qp-trie: lookup after delete");
+
+	/* Delete the rest. */
+	for (unsigned i = 1; i < inserted; i += 2) {
+		trie_del(trie, sorted[i]->data, sorted[i]->len, NULL);
+	}
+	it = trie_it_begin(trie);
+	ok(trie_weight(trie) == 0 && trie_it_finished(it), "qp-trie: empty");
+	trie_it_free(it);
+
+	trie_free(trie);
+	free(sorted);
+	free(keys);
+	return 0;
+}
@@ -18,12 +18,24 @@
 #include <tap/basic.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
 
 #include "common/mempattern.h"
 #include "common/mempool.h"
 #include "common/errcode.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/nameserver/internet.h"
+#include "knot/zone/zone.h"
+#include "knot/zone/zone-contents.h"
+#include "libknot/dnssec/config.h"
+#include "libknot/dnssec/crypto.h"
+#include "libknot/dnssec/policy.h"
+#include "libknot/dnssec/rrset-sign.h"
+#include "libknot/dnssec/sign.h"
 #include "libknot/packet/pkt.h"
+#include "libknot/rdata/nsec.h"
 
 /* Universal processing stage. */
 int state_visit(int state, knot_pkt_t *pkt, struct query_data *qdata, void *ctx)
@@ -35,9 +47,432 @@ int state_visit(int state, knot_pkt_t *pkt, struct query_data *qdata, void *ctx)
 	return state + 1;
 }
 
+/* Resolve query with planned answer steps, return first answer type. */
+static uint16_t planned_qtype(struct query_plan *plan, const char *zone_name,
+                              const char *qname, uint16_t qtype, mm_ctx_t *mm)
+{
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_pkt_t *resp = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_dname_t *name = knot_dname_from_str(qname);
+	knot_pkt_put_question(query, name, KNOT_CLASS_IN, qtype);
+	knot_pkt_init_response(resp, query);
+	knot_dname_free(&name, NULL);
+
+	zone_t zone;
+	memset(&zone, 0, sizeof(zone_t));
+	zone.name = knot_dname_from_str(zone_name);
+	struct query_data qdata;
+	memset(&qdata, 0, sizeof(struct query_data));
+	qdata.query = query;
+	qdata.zone = &zone;
+	qdata.name = knot_pkt_qname(query);
+
+	int state = MISS;
+	struct query_step *step = NULL;
+	WALK_LIST(step, plan->stage[QPLAN_ANSWER]) {
+		state = step->process(state, resp, &qdata, step->ctx);
+	}
+
+	uint16_t type = 0;
+	if (state == HIT && resp->rrset_count > 0) {
+		type = resp->rr[0].type;
+	}
+
+	knot_dname_free(&zone.name, NULL);
+	knot_pkt_free(&query);
+	knot_pkt_free(&resp);
+	return type;
+}
+
+#ifdef KNOT_ENABLE_ECDSA
+/* ECDSA P-256 key of example.com. */
+static const char *KEY_PUBLIC =
+	"example.com. IN DNSKEY 257 3 13 blXaCLukAMcr+TklzAePyEnCOzjsuEfEcd8B/D9e"
+	"2iFix/z7tk1p5+wF2eZWYm5NxS0uxWWHbdgx78v2Zv1YGA==\n";
+static const char *KEY_PRIVATE =
+	"Private-key-format: v1.2\n"
+	"Algorithm: 13 (ECDSAP256SHA256)\n"
+	"PrivateKey: sk+7o3OxW6pZRT4eAiXACQ3FPkpuMqiH6DGt8bKGt88=\n";
+
+static void write_file(const char *dir, const char *name, const char *data)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE *f = fopen(path, "w");
+	if (f != NULL) {
+		fputs(data, f);
+		fclose(f);
+	}
+}
+
+/* Run planned steps of a stage over a response, return resulting state. */
+static int planned_stage(struct query_plan *plan, int stage, int state,
+                         knot_pkt_t *resp, struct query_data *qdata)
+{
+	knot_section_t section = (stage == QPLAN_ANSWER) ? KNOT_ANSWER :
+	                         (stage == QPLAN_AUTHORITY) ? KNOT_AUTHORITY :
+	                         KNOT_ADDITIONAL;
+	if (resp->current < section) {
+		knot_pkt_begin(resp, section);
+	}
+
+	struct query_step *step = NULL;
+	WALK_LIST(step, plan->stage[stage]) {
+		state = step->process(state, resp, qdata, step->ctx);
+	}
+	return state;
+}
+
+/* Check if the RRSIG at given position is a valid signature of the RR set. */
+static bool valid_signature(const knot_pkt_t *resp, uint16_t covered,
+                            uint16_t rrsig, const knot_dnssec_key_t *key)
+{
+	if (rrsig >= resp->rrset_count ||
+	    resp->rr[rrsig].type != KNOT_RRTYPE_RRSIG) {
+		return false;
+	}
+
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+	knot_dnssec_sign_context_t *ctx = knot_dnssec_sign_init(key);
+	int ret = knot_is_valid_signature(&resp->rr[covered], &resp->rr[rrsig],
+	                                  0, key, ctx, &policy);
+	knot_dnssec_sign_free(ctx);
+	return ret == KNOT_EOK;
+}
+
+/* Create DNSSEC-enabled query. */
+static knot_pkt_t *dnssec_query(const char *qname, uint16_t qtype, mm_ctx_t *mm)
+{
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_dname_t *name = knot_dname_from_str(qname);
+	knot_pkt_put_question(query, name, KNOT_CLASS_IN, qtype);
+	knot_dname_free(&name, NULL);
+	knot_edns_set_version(&query->opt_rr, 0);
+	knot_edns_set_do(&query->opt_rr);
+	return query;
+}
+
+/* Add A record to the zone. */
+static void add_host(knot_zone_contents_t *zone, const knot_dname_t *owner)
+{
+	knot_rrset_t *a = knot_rrset_new(owner, KNOT_RRTYPE_A, KNOT_CLASS_IN, NULL);
+	uint8_t a_rdata[] = { 192, 0, 2, 2 };
+	knot_rrset_add_rdata(a, a_rdata, sizeof(a_rdata), 3600, NULL);
+	zone_node_t *node = NULL;
+	knot_zone_contents_add_rr(zone, a, &node, NULL);
+	knot_rrset_free(&a, NULL);
+}
+
+/* Compare names in canonical order. */
+static int canonical_cmp(const knot_dname_t *d1, const knot_dname_t *d2)
+{
+	knot_dname_t *lower1 = knot_dname_copy(d1, NULL);
+	knot_dname_t *lower2 = knot_dname_copy(d2, NULL);
+	knot_dname_to_lower(lower1);
+	knot_dname_to_lower(lower2);
+
+	/* Compare labels from the root, lookup format misorders zero octets. */
+	const uint8_t *labels1[KNOT_DNAME_MAXLABELS];
+	const uint8_t *labels2[KNOT_DNAME_MAXLABELS];
+	int count1 = 0, count2 = 0;
+	for (const uint8_t *l = lower1; *l != 0; l = knot_wire_next_label(l, NULL)) {
+		labels1[count1++] = l;
+	}
+	for (const uint8_t *l = lower2; *l != 0; l = knot_wire_next_label(l, NULL)) {
+		labels2[count2++] = l;
+	}
+	int ret = 0;
+	while (ret == 0 && count1 > 0 && count2 > 0) {
+		const uint8_t *l1 = labels1[--count1];
+		const uint8_t *l2 = labels2[--count2];
+		ret = memcmp(l1 + 1, l2 + 1, MIN(l1[0], l2[0]));
+		if (ret == 0) {
+			ret = (int)l1[0] - (int)l2[0];
+		}
+	}
+	if (ret == 0) {
+		ret = count1 - count2;
+	}
+
+	knot_dname_free(&lower1, NULL);
+	knot_dname_free(&lower2, NULL);
+	return ret;
+}
+
+/*
+ * Check that NSEC records in the response don't cover any existing name and
+ * one of them covers the name (owner < name < next), return its owner.
+ */
+static const knot_dname_t *nsec_cover(const knot_pkt_t *resp,
+                                      const knot_zone_contents_t *zone,
+                                      const knot_dname_t *name)
+{
+	const knot_dname_t *owner = NULL;
+	for (uint16_t i = 0; i < resp->rrset_count; ++i) {
+		const knot_rrset_t *rr = &resp->rr[i];
+		if (rr->type != KNOT_RRTYPE_NSEC) {
+			continue;
+		}
+
+		const knot_dname_t *next = knot_nsec_next(&rr->rrs);
+		const zone_node_t *prev = knot_zone_contents_find_previous(zone, next);
+		if (canonical_cmp(rr->owner, next) >= 0 || prev == NULL ||
+		    canonical_cmp(prev->owner, rr->owner) > 0) {
+			return NULL;
+		}
+
+		if (canonical_cmp(rr->owner, name) < 0 &&
+		    canonical_cmp(name, next) < 0) {
+			owner = rr->owner;
+		}
+	}
+
+	return owner;
+}
+
+/*
+ * Query nonexistent name, check the NSEC records cover the name and the
+ * wildcard at its closest encloser, return owner of the name cover.
+ */
+static const knot_dname_t *nxdomain_cover(struct query_plan *plan, zone_t *zone,
+                                          const knot_dname_t *qname,
+                                          knot_pkt_t **resp, mm_ctx_t *mm)
+{
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_pkt_put_question(query, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	knot_edns_set_version(&query->opt_rr, 0);
+	knot_edns_set_do(&query->opt_rr);
+
+	struct query_data qdata;
+	memset(&qdata, 0, sizeof(struct query_data));
+	qdata.query = query;
+	qdata.zone = zone;
+	qdata.name = knot_pkt_qname(query);
+	init_list(&qdata.wildcards);
+
+	/* Closest encloser is the longest existing ancestor. */
+	const knot_dname_t *encloser = qname;
+	while (qdata.encloser == NULL) {
+		encloser = knot_wire_next_label(encloser, NULL);
+		qdata.encloser = knot_zone_contents_find_node(zone->contents,
+		                                              encloser);
+	}
+
+	*resp = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_pkt_init_response(*resp, query);
+	int state = planned_stage(plan, QPLAN_AUTHORITY, MISS, *resp, &qdata);
+
+	uint8_t wildcard[KNOT_DNAME_MAXLEN] = { 1, '*' };
+	memcpy(wildcard + 2, encloser, knot_dname_size(encloser));
+
+	const knot_dname_t *owner = NULL;
+	if (state == MISS && nsec_cover(*resp, zone->contents, wildcard) != NULL) {
+		owner = nsec_cover(*resp, zone->contents, qname);
+	}
+
+	knot_pkt_free(&query);
+	return owner;
+}
+
+static void test_online_sign(mm_ctx_t *mm)
+{
+	char dir[] = "/tmp/knot-online_sign.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		skip_block(9, "online_sign: cannot create key directory");
+		return;
+	}
+	write_file(dir, "Kexample.com.+013+40829.key", KEY_PUBLIC);
+	write_file(dir, "Kexample.com.+013+40829.private", KEY_PRIVATE);
+	char key_file[256];
+	snprintf(key_file, sizeof(key_file), "%s/Kexample.com.+013+40829.private", dir);
+
+	struct query_plan *plan = query_plan_create(mm);
+	struct query_module *module = query_module_open("online_sign", key_file, NULL);
+	ok(module != NULL && module->load(plan, module) == KNOT_EOK,
+	   "online_sign: load ECDSA key");
+
+	knot_key_params_t params = { 0 };
+	knot_dnssec_key_t key = { 0 };
+	knot_load_key_params(key_file, &params);
+	knot_dnssec_key_from_params(&params, &key);
+	knot_free_key_params(&params);
+
+	/* Unsigned zone with a single host. */
+	zone_t zone;
+	memset(&zone, 0, sizeof(zone_t));
+	zone.name = knot_dname_from_str("example.com.");
+	zone.contents = knot_zone_contents_new(zone.name);
+	knot_rrset_t *soa = knot_rrset_new(zone.name, KNOT_RRTYPE_SOA,
+	                                   KNOT_CLASS_IN, NULL);
+	uint8_t soa_rdata[] = { 0, 0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3,
+	                        0, 0, 0, 4, 0, 0, 0, 5 };
+	knot_rrset_add_rdata(soa, soa_rdata, sizeof(soa_rdata), 3600, NULL);
+	node_add_rrset(zone.contents->apex, soa, NULL);
+	knot_rrset_free(&soa, NULL);
+
+	knot_dname_t *host = knot_dname_from_str("www.example.com.");
+	knot_rrset_t *a = knot_rrset_new(host, KNOT_RRTYPE_A, KNOT_CLASS_IN, NULL);
+	uint8_t a_rdata[] = { 192, 0, 2, 1 };
+	knot_rrset_add_rdata(a, a_rdata, sizeof(a_rdata), 3600, NULL);
+	zone_node_t *node = NULL;
+	knot_zone_contents_add_rr(zone.contents, a, &node, NULL);
+	knot_rrset_free(&a, NULL);
+
+	/* Names next to the white lies. */
+	const char *hosts[] = {
+		"b.example.com.", "d.example.com.", "sub.example.com.",
+		"*.wild.example.com.", NULL
+	};
+	for (unsigned i = 0; hosts[i] != NULL; ++i) {
+		knot_dname_t *owner = knot_dname_from_str(hosts[i]);
+		add_host(zone.contents, owner);
+		knot_dname_free(&owner, NULL);
+	}
+
+	/* Immediate predecessor of f.example.com, the last name under e\255... */
+	uint8_t last_e[KNOT_DNAME_MAXLEN];
+	uint8_t *w = last_e;
+	const uint8_t last_e_labels[] = { 63, 63, 49 };
+	for (unsigned i = 0; i < sizeof(last_e_labels); ++i) {
+		*w++ = last_e_labels[i];
+		memset(w, 0xff, last_e_labels[i]);
+		w += last_e_labels[i];
+	}
+	*w++ = 63;
+	*w++ = 'e';
+	memset(w, 0xff, 62);
+	w += 62;
+	memcpy(w, "\x07""example""\x03""com", 13);
+	add_host(zone.contents, last_e);
+
+	zone_node_t *first_nsec3 = NULL, *last_nsec3 = NULL;
+	knot_zone_contents_adjust_full(zone.contents, &first_nsec3, &last_nsec3);
+
+	/* Query for the host. */
+	knot_pkt_t *query = dnssec_query("www.example.com.", KNOT_RRTYPE_A, mm);
+
+	struct query_data qdata;
+	memset(&qdata, 0, sizeof(struct query_data));
+	qdata.query = query;
+	qdata.zone = &zone;
+	qdata.name = knot_pkt_qname(query);
+	init_list(&qdata.wildcards);
+
+	/* Answer is signed, the signature is reused for the next answer. */
+	knot_rrset_t host_a = node_rrset(node, KNOT_RRTYPE_A);
+	knot_pkt_t *resp[2] = { NULL };
+	for (unsigned i = 0; i < 2; ++i) {
+		resp[i] = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+		knot_pkt_init_response(resp[i], query);
+		knot_pkt_begin(resp[i], KNOT_ANSWER);
+		knot_pkt_put(resp[i], COMPR_HINT_QNAME, &host_a, 0);
+		qdata.node = node;
+		planned_stage(plan, QPLAN_ANSWER, HIT, resp[i], &qdata);
+	}
+	ok(valid_signature(resp[0], 0, 1, &key), "online_sign: answer signed");
+	ok(resp[1]->rrset_count == 2 &&
+	   knot_rdataset_eq(&resp[0]->rr[1].rrs, &resp[1]->rr[1].rrs),
+	   "online_sign: cached signature");
+
+	/* Nonexistent name is covered by signed NSEC records. */
+	knot_pkt_free(&resp[1]);
+	knot_pkt_free(&query);
+	query = dnssec_query("nx.example.com.", KNOT_RRTYPE_A, mm);
+	qdata.name = knot_pkt_qname(query);
+	qdata.node = NULL;
+	qdata.encloser = zone.contents->apex;
+	resp[1] = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_pkt_init_response(resp[1], query);
+	int state = planned_stage(plan, QPLAN_AUTHORITY, MISS, resp[1], &qdata);
+	bool proven = (state == MISS && resp[1]->rrset_count == 4);
+	for (uint16_t i = 0; proven && i < 2; ++i) {
+		proven = resp[1]->rr[i].type == KNOT_RRTYPE_NSEC &&
+		         valid_signature(resp[1], i, i + 2, &key);
+	}
+	ok(proven, "online_sign: nonexistence proof");
+
+	for (unsigned i = 0; i < 2; ++i) {
+		knot_pkt_free(&resp[i]);
+	}
+
+	/* Label ending with zero octet follows the descendants of the shorter
+	 * label, which is used if it doesn't exist. */
+	const knot_dname_t *cover = NULL;
+	cover = nxdomain_cover(plan, &zone, (uint8_t *)"\x02""b""\x00""\x07""example""\x03""com",
+	                       &resp[0], mm);
+	bool covered = cover != NULL && knot_dname_is_sub(cover,
+	                   (uint8_t *)"\x01""b""\x07""example""\x03""com");
+	cover = nxdomain_cover(plan, &zone, (uint8_t *)"\x02""c""\x00""\x07""example""\x03""com",
+	                       &resp[1], mm);
+	covered = covered && cover != NULL &&
+	          knot_dname_is_equal(cover, (uint8_t *)"\x01""c""\x07""example""\x03""com");
+	ok(covered, "online_sign: cover label ending with zero octet");
+	knot_pkt_free(&resp[0]);
+	knot_pkt_free(&resp[1]);
+
+	/* Decremented octet must not become an uppercase letter ('[' - 1). */
+	cover = nxdomain_cover(plan, &zone, (uint8_t *)"\x01""[""\x07""example""\x03""com",
+	                       &resp[0], mm);
+	ok(cover != NULL, "online_sign: cover name next to uppercase letters");
+	knot_pkt_free(&resp[0]);
+
+	/* Wildcard at the closest encloser below the apex is covered too. */
+	cover = nxdomain_cover(plan, &zone, (uint8_t *)"\x01""x""\x03""sub""\x07""example""\x03""com",
+	                       &resp[0], mm);
+	ok(cover != NULL, "online_sign: cover wildcard at closest encloser");
+	knot_pkt_free(&resp[0]);
+
+	/* Previous name is the immediate predecessor, NSEC lists its types. */
+	cover = nxdomain_cover(plan, &zone, (uint8_t *)"\x01""f""\x07""example""\x03""com",
+	                       &resp[0], mm);
+	ok(cover != NULL && knot_dname_is_equal(cover, last_e),
+	   "online_sign: immediate predecessor is the previous name");
+	knot_pkt_free(&resp[0]);
+
+	/* Answers expanded from a wildcard are signed but not cached. */
+	knot_dname_t *expanded = knot_dname_from_str("x.wild.example.com.");
+	knot_rrset_t *wild_a = knot_rrset_new(expanded, KNOT_RRTYPE_A,
+	                                      KNOT_CLASS_IN, NULL);
+	knot_rrset_add_rdata(wild_a, a_rdata, sizeof(a_rdata), 3600, NULL);
+	knot_pkt_free(&query);
+	query = dnssec_query("x.wild.example.com.", KNOT_RRTYPE_A, mm);
+	qdata.query = query;
+	qdata.name = knot_pkt_qname(query);
+	for (unsigned i = 0; i < 2; ++i) {
+		resp[i] = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+		knot_pkt_init_response(resp[i], query);
+		knot_pkt_begin(resp[i], KNOT_ANSWER);
+		knot_pkt_put(resp[i], COMPR_HINT_QNAME, wild_a, 0);
+		planned_stage(plan, QPLAN_ANSWER, HIT, resp[i], &qdata);
+	}
+	ok(valid_signature(resp[0], 0, 1, &key) && resp[1]->rrset_count == 2 &&
+	   !knot_rdataset_eq(&resp[0]->rr[1].rrs, &resp[1]->rr[1].rrs),
+	   "online_sign: wildcard answer not cached");
+	for (unsigned i = 0; i < 2; ++i) {
+		knot_pkt_free(&resp[i]);
+	}
+	knot_rrset_free(&wild_a, NULL);
+	knot_dname_free(&expanded, NULL);
+	knot_pkt_free(&query);
+	knot_dname_free(&host, NULL);
+	knot_zone_contents_deep_free(&zone.contents);
+	knot_dname_free(&zone.name, NULL);
+	knot_dnssec_key_free(&key);
+	query_module_close(module);
+	query_plan_free(plan);
+
+	unlink(key_file);
+	key_file[strlen(key_file) - strlen("private")] = '\0';
+	strcat(key_file, "key");
+	unlink(key_file);
+	rmdir(dir);
+}
+#endif
+
 int main(int argc, char *argv[])
 {
-	plan(4);
+	plan(17);
 
 	/* Create processing context. */
 	mm_ctx_t mm;
@@ -85,6 +520,55 @@ int main(int argc, char *argv[])
 	/* Free the query plan. */
 	query_plan_free(plan);
 
+	/* Templates of all synth_record modules share a single step. */
+	const char *synth_params[] = {
+		"forward dynamic- 400 2620:0:b61::/52",
+		"forward dynamic- 400 192.168.1.0/25",
+		"reverse dynamic- example. 400 192.168.1.0/25",
+		NULL
+	};
+	struct query_module *module[3] = { NULL };
+	plan = query_plan_create(&mm);
+	for (unsigned i = 0; synth_params[i] != NULL; ++i) {
+		module[i] = query_module_open("synth_record", synth_params[i], NULL);
+		query_module_load(plan, module[i]);
+	}
+	ok(list_size(&plan->stage[QPLAN_ANSWER]) == 1, "synth_record: single plan step");
+	struct query_step *synth_step = HEAD(plan->stage[QPLAN_ANSWER]);
+	ok(synth_step->module == module[0]->id &&
+	   strcmp(query_module_name(synth_step->module), "synth_record") == 0 &&
+	   plan->module == QUERY_MODULE_NONE,
+	   "synth_record: step attributed to module");
+
+	/* Synthesize forward records of both families. */
+	ok(planned_qtype(plan, "example.", "dynamic-192-168-1-5.example.",
+	                 KNOT_RRTYPE_A, &mm) == KNOT_RRTYPE_A &&
+	   planned_qtype(plan, "example.", "dynamic-2620-0000-0b61-0100-0000-0000-0000-0000.example.",
+	                 KNOT_RRTYPE_AAAA, &mm) == KNOT_RRTYPE_AAAA &&
+	   planned_qtype(plan, "example.", "dynamic-192-168-1-200.example.",
+	                 KNOT_RRTYPE_A, &mm) == 0,
+	   "synth_record: forward records");
+
+	/* Synthesize reverse record. */
+	ok(planned_qtype(plan, "1.168.192.in-addr.arpa.", "5.1.168.192.in-addr.arpa.",
+	                 KNOT_RRTYPE_PTR, &mm) == KNOT_RRTYPE_PTR &&
+	   planned_qtype(plan, "1.168.192.in-addr.arpa.", "200.1.168.192.in-addr.arpa.",
+	                 KNOT_RRTYPE_PTR, &mm) == 0,
+	   "synth_record: reverse records");
+
+	for (unsigned i = 0; synth_params[i] != NULL; ++i) {
+		query_module_close(module[i]);
+	}
+	query_plan_free(plan);
+
+	/* Online signing of unsigned zone. */
+#ifdef KNOT_ENABLE_ECDSA
+	test_online_sign(&mm);
+	knot_crypto_cleanup();
+#else
+	skip_block(9, "online_sign: ECDSA not supported on this system");
+#endif
+
 	/* Cleanup. */
 	mp_delete((struct mempool *)mm.ctx);
 
@@ -0,0 +1,316 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <tap/basic.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "libknot/dnssec/config.h"
+#include "libknot/dnssec/crypto.h"
+#include "libknot/dnssec/policy.h"
+#include "knot/zone/semantic-check.c" // testing the deferred error handling
+#include "zone_helpers.h"
+
+/*! \brief Number of delegations in the large zone. */
+#define DELEG_COUNT 4800
+
+static knot_zone_contents_t *zone_create(void)
+{
+	knot_dname_t *apex = knot_dname_from_str("example.com");
+	knot_zone_contents_t *zone = knot_zone_contents_new(apex);
+	knot_dname_free(&apex, NULL);
+
+	uint8_t soa[22] = { 0 };
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_SOA, soa, sizeof(soa), 3600);
+
+	return zone;
+}
+
+static void zone_add_name(knot_zone_contents_t *zone, const char *owner,
+                          uint16_t type, const char *name)
+{
+	knot_dname_t *dname = knot_dname_from_str(name);
+	zone_add_rr(zone, owner, type, dname, knot_dname_size(dname), 3600);
+	knot_dname_free(&dname, NULL);
+}
+
+/*!
+ * \brief Create zone with delegations, every third one having glue, every
+ *        third one glue without addresses and every third one no glue.
+ */
+static knot_zone_contents_t *large_zone_create(size_t *error_count)
+{
+	knot_zone_contents_t *zone = zone_create();
+	const uint8_t a[4] = { 192, 0, 2, 1 };
+	const uint8_t txt[2] = { 1, 'x' };
+
+	*error_count = 0;
+	for (unsigned i = 0; i < DELEG_COUNT; ++i) {
+		char owner[64], ns[64];
+		snprintf(owner, sizeof(owner), "d%04u.example.com", i);
+		snprintf(ns, sizeof(ns), "ns.d%04u.example.com", i);
+		zone_add_name(zone, owner, KNOT_RRTYPE_NS, ns);
+		if (i % 3 == 0) {
+			zone_add_rr(zone, ns, KNOT_RRTYPE_A, a, sizeof(a), 3600);
+		} else if (i % 3 == 1) {
+			zone_add_rr(zone, ns, KNOT_RRTYPE_TXT, txt, sizeof(txt), 3600);
+			*error_count += 1;
+		} else {
+			*error_count += 1;
+		}
+	}
+
+	zone_add_name(zone, "example.com", KNOT_RRTYPE_NS, "ns.d0000.example.com");
+
+	knot_zone_contents_adjust_full(zone, NULL, NULL);
+
+	return zone;
+}
+
+typedef struct {
+	knot_zone_contents_t *zone;
+	err_handler_t *handler;
+} serial_check_t;
+
+static int serial_check_node(zone_node_t *node, void *data)
+{
+	serial_check_t *check = data;
+	bool fatal = false;
+	return sem_check_node_plain(check->zone, node, check->handler, false,
+	                            &fatal);
+}
+
+static size_t count_errors(const struct sem_errors *list, int error)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < list->count; ++i) {
+		if (list->errors[i].error == error) {
+			count += 1;
+		}
+	}
+
+	return count;
+}
+
+static void free_errors(struct sem_errors *list)
+{
+	for (size_t i = 0; i < list->count; ++i) {
+		free(list->errors[i].data);
+	}
+	free(list->errors);
+	memset(list, 0, sizeof(*list));
+}
+
+static void test_parallel(void)
+{
+	size_t expected = 0;
+	knot_zone_contents_t *zone = large_zone_create(&expected);
+	ok(knot_zone_tree_weight(zone->nodes) >= SEM_CHECK_PARALLEL_MIN,
+	   "semantic checks: zone large enough to be checked in parallel");
+
+	// checks run in parallel, errors are collected in handling order
+	struct sem_errors found = { 0 };
+	err_handler_t handler;
+	err_handler_init(&handler);
+	handler.deferred = &found;
+	int ret = zone_do_sem_checks(zone, SEM_CHECK_UNSIGNED, false, &handler,
+	                             NULL, NULL);
+	ok(ret == KNOT_EOK && found.count == expected &&
+	   count_errors(&found, ZC_ERR_GLUE_NODE) == DELEG_COUNT / 3 &&
+	   count_errors(&found, ZC_ERR_GLUE_RECORD) == DELEG_COUNT / 3,
+	   "semantic checks: all errors found by parallel checks");
+
+	// reference run of the same checks in a single thread
+	struct sem_errors serial = { 0 };
+	err_handler_t serial_handler;
+	err_handler_init(&serial_handler);
+	serial_handler.deferred = &serial;
+	serial_check_t check = { zone, &serial_handler };
+	knot_zone_contents_tree_apply_inorder(zone, serial_check_node, &check);
+
+	bool same_order = found.count == serial.count;
+	for (size_t i = 0; same_order && i < found.count; ++i) {
+		same_order = found.errors[i].node == serial.errors[i].node &&
+		             found.errors[i].error == serial.errors[i].error;
+	}
+	ok(same_order, "semantic checks: errors handled in order of nodes");
+
+	free_errors(&found);
+	free_errors(&serial);
+	knot_zone_contents_deep_free(&zone);
+}
+
+#ifdef KNOT_ENABLE_ECDSA
+/* ECDSA P-256 key of example.com. */
+static const char *KEY_PUBLIC =
+	"example.com. IN DNSKEY 257 3 13 blXaCLukAMcr+TklzAePyEnCOzjsuEfEcd8B/D9e"
+	"2iFix/z7tk1p5+wF2eZWYm5NxS0uxWWHbdgx78v2Zv1YGA==\n";
+static const char *KEY_PRIVATE =
+	"Private-key-format: v1.2\n"
+	"Algorithm: 13 (ECDSAP256SHA256)\n"
+	"PrivateKey: sk+7o3OxW6pZRT4eAiXACQ3FPkpuMqiH6DGt8bKGt88=\n";
+
+static void write_file(const char *dir, const char *name, const char *data)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE *f = fopen(path, "w");
+	if (f != NULL) {
+		fputs(data, f);
+		fclose(f);
+	}
+}
+
+/*!
+ * \brief Add RR with NSEC and signature, the signature may be damaged.
+ */
+static void zone_add_signed(knot_zone_contents_t *zone, const char *owner_str,
+                            uint16_t type, const uint8_t *rdata, uint16_t size,
+                            const char *next, const knot_dnssec_key_t *key,
+                            knot_dnssec_sign_context_t *ctx, bool damaged)
+{
+	zone_add_rr(zone, owner_str, type, rdata, size, 3600);
+	zone_add_name(zone, owner_str, KNOT_RRTYPE_NSEC, next);
+
+	knot_dname_t *owner = knot_dname_from_str(owner_str);
+	knot_rrset_t covered;
+	knot_rrset_init(&covered, owner, type, KNOT_CLASS_IN);
+	knot_rrset_add_rdata(&covered, rdata, size, 3600, NULL);
+
+	knot_dnssec_policy_t policy;
+	knot_dnssec_init_default_policy(&policy);
+	knot_rrset_t rrsigs;
+	knot_rrset_init(&rrsigs, owner, KNOT_RRTYPE_RRSIG, KNOT_CLASS_IN);
+	knot_sign_rrset(&rrsigs, &covered, key, ctx, &policy);
+	if (damaged && rrsigs.rrs.rr_count > 0) {
+		knot_rdata_t *rr = knot_rdataset_at(&rrsigs.rrs, 0);
+		knot_rdata_data(rr)[knot_rdata_rdlen(rr) - 1] ^= 0xff;
+	}
+
+	zone_node_t *node = NULL;
+	knot_zone_contents_add_rr(zone, &rrsigs, &node, NULL);
+
+	knot_rdataset_clear(&rrsigs.rrs, NULL);
+	knot_rdataset_clear(&covered.rrs, NULL);
+	knot_dname_free(&owner, NULL);
+}
+
+static void test_verify(void)
+{
+	char dir[] = "/tmp/knot-semantic_check.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		skip_block(3, "semantic checks: cannot create key directory");
+		return;
+	}
+	write_file(dir, "Kexample.com.+013+40829.key", KEY_PUBLIC);
+	write_file(dir, "Kexample.com.+013+40829.private", KEY_PRIVATE);
+	char key_file[256];
+	snprintf(key_file, sizeof(key_file), "%s/Kexample.com.+013+40829.private", dir);
+
+	knot_key_params_t params = { 0 };
+	knot_dnssec_key_t key = { 0 };
+	int ret = knot_load_key_params(key_file, &params);
+	if (ret == KNOT_EOK) {
+		ret = knot_dnssec_key_from_params(&params, &key);
+	}
+	knot_dnssec_sign_context_t *ctx = knot_dnssec_sign_init(&key);
+	ok(ret == KNOT_EOK && ctx != NULL, "semantic checks: load signing key");
+
+	// signed zone, one signature doesn't validate
+	knot_zone_contents_t *zone = zone_create();
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_DNSKEY, params.rdata.data,
+	            params.rdata.size, 3600);
+	zone_add_name(zone, "example.com", KNOT_RRTYPE_NSEC, "txt.example.com");
+	const uint8_t txt[2] = { 1, 'x' };
+	const uint8_t a[4] = { 192, 0, 2, 1 };
+	zone_add_signed(zone, "txt.example.com", KNOT_RRTYPE_TXT, txt, sizeof(txt),
+	                "www.example.com", &key, ctx, true);
+	zone_add_signed(zone, "www.example.com", KNOT_RRTYPE_A, a, sizeof(a),
+	                "example.com", &key, ctx, false);
+	knot_zone_contents_adjust_full(zone, NULL, NULL);
+
+	knot_dname_t *txt_owner = knot_dname_from_str("txt.example.com");
+	for (int verify = 0; verify <= 1; ++verify) {
+		struct sem_errors found = { 0 };
+		err_handler_t handler;
+		err_handler_init(&handler);
+		handler.deferred = &found;
+		zone_do_sem_checks(zone, SEM_CHECK_NSEC, verify, &handler,
+		                   NULL, NULL);
+
+		size_t invalid = 0;
+		bool txt_invalid = false;
+		for (size_t i = 0; i < found.count; ++i) {
+			if (found.errors[i].error == ZC_ERR_RRSIG_INVALID) {
+				invalid += 1;
+				txt_invalid = knot_dname_is_equal(found.errors[i].node->owner,
+				                                  txt_owner);
+			}
+		}
+		if (verify) {
+			ok(invalid == 1 && txt_invalid,
+			   "semantic checks: report signature which doesn't validate");
+		} else {
+			ok(invalid == 0,
+			   "semantic checks: no signature verification unless enabled");
+		}
+		free_errors(&found);
+	}
+
+	knot_dname_free(&txt_owner, NULL);
+	knot_zone_contents_deep_free(&zone);
+	knot_dnssec_sign_free(ctx);
+	knot_dnssec_key_free(&key);
+	knot_free_key_params(&params);
+
+	unlink(key_file);
+	snprintf(key_file, sizeof(key_file), "%s/Kexample.com.+013+40829.key", dir);
+	unlink(key_file);
+	rmdir(dir);
+}
+#endif
+
+// Signal handler
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan(6);
+
+	/* Worker threads are interrupted when stopped. */
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL);
+
+	test_parallel();
+
+#ifdef KNOT_ENABLE_ECDSA
+	test_verify();
+#else
+	skip_block(3, "semantic checks: ECDSA not supported");
+#endif
+
+	knot_crypto_cleanup();
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/server/stats.h"
+#include "libknot/common.h"
+#include "libknot/consts.h"
+#include "libknot/packet/wire.h"
+
+#define WORKERS 4
+
+int main(int argc, char *argv[])
+{
+	plan(17);
+
+	/* Counter blocks. */
+	stats_worker_t *st = stats_new(WORKERS);
+	ok(st != NULL, "stats: create worker blocks");
+	ok(((uintptr_t)st % STATS_CACHELINE) == 0 &&
+	   sizeof(stats_worker_t) % STATS_CACHELINE == 0,
+	   "stats: blocks are cache line aligned");
+
+	/* Responses from each worker. */
+	uint8_t wire[KNOT_WIRE_HEADER_SIZE] = { 0 };
+	knot_wire_set_rcode(wire, KNOT_RCODE_NXDOMAIN);
+	for (unsigned i = 0; i < WORKERS; ++i) {
+		stats_inc(&st[i], STATS_UDP_QUERIES);
+		stats_response(&st[i], wire, sizeof(wire), STATS_UDP_RESPONSES);
+	}
+	knot_wire_set_tc(wire);
+	stats_response(&st[0], wire, sizeof(wire), STATS_UDP_RESPONSES);
+	stats_response(&st[1], wire, 0, STATS_UDP_RESPONSES);
+	stats_inc(NULL, STATS_UDP_QUERIES);
+
+	/* Aggregate. */
+	stats_worker_t *total = stats_new(1);
+	stats_sum(total, st, WORKERS);
+	ok(total->ctr[STATS_UDP_QUERIES] == WORKERS, "stats: sum queries");
+	ok(total->ctr[STATS_UDP_RESPONSES] == WORKERS + 1, "stats: sum responses");
+	ok(total->rcode[KNOT_RCODE_NXDOMAIN] == WORKERS + 1, "stats: sum rcode");
+	ok(total->ctr[STATS_TRUNCATED] == 1, "stats: truncated response");
+	ok(total->ctr[STATS_DROPPED] == 1, "stats: dropped response");
+
+	/* Print. */
+	char buf[4096];
+	int ret = stats_print(total, buf, sizeof(buf));
+	ok(ret > 0 && strstr(buf, "rcode.NXDOMAIN: 5\n") != NULL,
+	   "stats: print aggregated counters");
+	ret = stats_print(total, buf, 8);
+	ok(ret == KNOT_ESPACE, "stats: print to small buffer");
+
+	/* Histogram buckets. */
+	ok(stats_hist_bucket(0) == 0 && stats_hist_bucket(3) == 3,
+	   "stats: linear histogram buckets");
+	ok(stats_hist_bucket(8) == stats_hist_bucket(9) &&
+	   stats_hist_bucket(9) < stats_hist_bucket(10),
+	   "stats: log-linear histogram buckets");
+	ok(stats_hist_bucket(UINT64_MAX) == STATS_HIST_BUCKETS - 1,
+	   "stats: last histogram bucket");
+
+	/* Latency samples. */
+	for (unsigned i = 0; i < 100; ++i) {
+		stats_timer_end(st[i % WORKERS].latency, STATS_STAGE_PARSE,
+		                stats_timer(st[i % WORKERS].latency));
+	}
+	stats_timer_end(NULL, STATS_STAGE_PARSE, 0);
+	memset(total, 0, sizeof(*total));
+	stats_sum(total, st, WORKERS);
+	ret = stats_print(total, buf, sizeof(buf));
+	ok(total->latency[STATS_STAGE_PARSE].count == 100 &&
+	   strstr(buf, "latency.parse.p99-ns: ") != NULL,
+	   "stats: latency histogram");
+	stats_timer_end(total->latency, STATS_STAGE_MODULE + 1, stats_clock());
+	ret = stats_print(total, buf, sizeof(buf));
+	char module_line[64];
+	snprintf(module_line, sizeof(module_line), "latency.module.%s.count: 1\n",
+	         query_module_name(1));
+	ok(ret > 0 && strstr(buf, module_line) != NULL &&
+	   strstr(buf, "latency.module.synth_record") == NULL,
+	   "stats: latency of each module");
+
+	/* Per-zone counters. */
+	stats_zones_t *zones = stats_zones_new(3);
+	for (unsigned i = 0; i < WORKERS; ++i) {
+		st[i].zone_row = i;
+		stats_zone_query(zones, 1, &st[i]);
+	}
+	ok(stats_zone_sum(zones, 1) == WORKERS && zones->row[0] != NULL &&
+	   zones->row[STATS_ZONE_ROWS] == NULL,
+	   "stats: zone counters in worker rows");
+	st[0].zone_row = STATS_ZONE_ROWS + 1;
+	stats_zone_query(zones, 1, &st[0]);
+	stats_zone_query(zones, 1, NULL);
+	ok(stats_zone_sum(zones, 1) == WORKERS + 2 &&
+	   zones->row[STATS_ZONE_ROWS] != NULL,
+	   "stats: zone counters in shared row");
+	stats_zone_query(zones, 3, &st[1]);
+	stats_zone_query(NULL, 0, &st[1]);
+	ok(stats_zone_sum(zones, 0) == 0 && stats_zone_sum(zones, 2) == 0 &&
+	   stats_zone_sum(zones, 3) == 0,
+	   "stats: zone counters out of range");
+	stats_zones_free(zones);
+
+	stats_free(total);
+	stats_free(st);
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <tap/basic.h>
+
+#include "common/errcode.h"
+#include "common/descriptor.h"
+#include "libknot/dname.h"
+#include "libknot/tsig-op.h"
+#include "libknot/packet/pkt.h"
+#include "libknot/packet/wire.h"
+
+#define KEY_NAME "key.example.com."
+#define KEY_SECRET "Wg0Kmkm7TE2pRTyZS0kWnQ=="
+#define TSIG_DIGEST_MAXLEN 64
+
+/*! \brief Create query, optionally with an answer RR. */
+static knot_pkt_t *create_msg(const knot_dname_t *qname, bool answer)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_wire_set_id(pkt->wire, 0xbeef);
+	knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	if (answer) {
+		knot_pkt_begin(pkt, KNOT_ANSWER);
+		knot_rrset_t *rr = knot_rrset_new(qname, KNOT_RRTYPE_A,
+		                                  KNOT_CLASS_IN, NULL);
+		knot_rrset_add_rdata(rr, (const uint8_t *)"\xc0\x00\x02\x01", 4,
+		                     3600, NULL);
+		knot_pkt_put(pkt, 0, rr, 0);
+		knot_rrset_free(&rr, NULL);
+	}
+
+	return pkt;
+}
+
+/*! \brief Parse signed message, TSIG RR gets stripped from the wire. */
+static knot_pkt_t *parse_msg(const knot_pkt_t *src)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, src->size, NULL);
+	memcpy(pkt->wire, src->wire, src->size);
+	pkt->size = src->size;
+	if (knot_pkt_parse(pkt, 0) != KNOT_EOK) {
+		knot_pkt_free(&pkt);
+	}
+	return pkt;
+}
+
+int main(int argc, char *argv[])
+{
+	plan(8);
+
+	knot_tsig_key_t key, other;
+	int ret = knot_tsig_create_key(KEY_NAME, KNOT_TSIG_ALG_HMAC_SHA256,
+	                               KEY_SECRET, &key);
+	ret |= knot_tsig_create_key(KEY_NAME, KNOT_TSIG_ALG_HMAC_SHA256,
+	                            "AAAAAAAAAAAAAAAAAAAAAA==", &other);
+	ok(ret == KNOT_EOK, "tsig: create keys");
+
+	/* Sign and verify query. */
+	uint8_t query_mac[TSIG_DIGEST_MAXLEN];
+	size_t query_mac_len = sizeof(query_mac);
+	knot_pkt_t *query = create_msg(key.name, false);
+	ret = knot_tsig_sign(query->wire, &query->size, query->max_size, NULL, 0,
+	                     query_mac, &query_mac_len, &key, 0, 0);
+	ok(ret == KNOT_EOK && query_mac_len == 32, "tsig: sign query");
+
+	knot_pkt_t *parsed = parse_msg(query);
+	ret = knot_tsig_server_check(parsed->tsig_rr, parsed->wire, parsed->size,
+	                             &key);
+	ok(ret == KNOT_EOK, "tsig: verify query");
+
+	/* Same key name, different secret. */
+	ret = knot_tsig_server_check(parsed->tsig_rr, parsed->wire, parsed->size,
+	                             &other);
+	ok(ret == KNOT_TSIG_EBADSIG, "tsig: reject query signed by other key");
+
+	/* Modified message. */
+	parsed->wire[parsed->size - 1] ^= 0xff;
+	ret = knot_tsig_server_check(parsed->tsig_rr, parsed->wire, parsed->size,
+	                             &key);
+	ok(ret == KNOT_TSIG_EBADSIG, "tsig: reject modified query");
+	knot_pkt_free(&parsed);
+
+	/* Response signed over the query MAC. */
+	uint8_t mac[TSIG_DIGEST_MAXLEN];
+	size_t mac_len = sizeof(mac);
+	knot_pkt_t *resp = create_msg(key.name, true);
+	ret = knot_tsig_sign(resp->wire, &resp->size, resp->max_size,
+	                     query_mac, query_mac_len, mac, &mac_len, &key, 0, 0);
+	parsed = parse_msg(resp);
+	ret |= knot_tsig_client_check(parsed->tsig_rr, parsed->wire, parsed->size,
+	                              query_mac, query_mac_len, &key, 0);
+	ok(ret == KNOT_EOK, "tsig: verify response");
+	uint64_t time_signed = tsig_rdata_time_signed(parsed->tsig_rr);
+	knot_pkt_free(&parsed);
+
+	/* Subsequent message of a multi-message response. */
+	uint8_t next_mac[TSIG_DIGEST_MAXLEN];
+	size_t next_mac_len = sizeof(next_mac);
+	knot_pkt_t *next = create_msg(key.name, true);
+	ret = knot_tsig_sign_next(next->wire, &next->size, next->max_size,
+	                          mac, mac_len, next_mac, &next_mac_len, &key,
+	                          next->wire, next->size);
+	parsed = parse_msg(next);
+	ret |= knot_tsig_client_check_next(parsed->tsig_rr, parsed->wire,
+	                                   parsed->size, mac, mac_len, &key,
+	                                   time_signed);
+	ok(ret == KNOT_EOK, "tsig: verify next message");
+
+	/* Wrong previous MAC. */
+	mac[0] ^= 0xff;
+	ret = knot_tsig_client_check_next(parsed->tsig_rr, parsed->wire,
+	                                  parsed->size, mac, mac_len, &key,
+	                                  time_signed);
+	ok(ret == KNOT_TSIG_EBADSIG, "tsig: reject next message with wrong MAC");
+	knot_pkt_free(&parsed);
+
+	knot_pkt_free(&next);
+	knot_pkt_free(&resp);
+	knot_pkt_free(&query);
+	knot_tsig_key_free(&other);
+	knot_tsig_key_free(&key);
+
+	return 0;
+}
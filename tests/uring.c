@@ -0,0 +1,156 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <tap/basic.h>
+
+#include "common/errcode.h"
+#include "common/uring.h"
+
+#ifdef HAVE_IO_URING
+
+#define DGRAM_COUNT 32
+#define BUF_COUNT 8
+#define BUF_LEN (sizeof(struct io_uring_recvmsg_out) + \
+                 sizeof(struct sockaddr_storage) + 512)
+
+static void arm_recv(uring_t *ring, int fd, struct msghdr *msg)
+{
+	struct io_uring_sqe *sqe = uring_sqe(ring);
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t)msg;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->user_data = fd;
+}
+
+int main(int argc, char *argv[])
+{
+	uring_t ring;
+	unsigned flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+	if (uring_init(&ring, 16, flags) != KNOT_EOK) {
+		skip_all("io_uring not supported by the kernel");
+	}
+
+	plan(7);
+
+	/* Worker backend probe. */
+	ok(uring_probe() == KNOT_EOK, "uring: probe");
+
+	/* Provided buffers, fewer than datagrams to exercise rearming. */
+	uring_bufs_t bufs;
+	int ret = uring_bufs_init(&ring, &bufs, 0, BUF_COUNT, BUF_LEN);
+	ok(ret == KNOT_EOK && bufs.buf_len >= BUF_LEN, "uring: provided buffers");
+
+	/* Loopback sockets. */
+	int srv = socket(AF_INET, SOCK_DGRAM, 0);
+	int cli = socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addr_len = sizeof(addr);
+	bind(srv, (struct sockaddr *)&addr, addr_len);
+	getsockname(srv, (struct sockaddr *)&addr, &addr_len);
+
+	/* Multishot receive. */
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_namelen = sizeof(struct sockaddr_storage);
+	arm_recv(&ring, srv, &msg);
+	ok(uring_enter(&ring, 0) == 1, "uring: submit");
+
+	/* Receive datagrams in order, rearm when buffers run out. */
+	bool passed = true;
+	unsigned received = 0;
+	for (unsigned i = 0; i < DGRAM_COUNT && passed; ++i) {
+		sendto(cli, &i, sizeof(i), 0, (struct sockaddr *)&addr, addr_len);
+	}
+	while (received < DGRAM_COUNT && passed) {
+		struct io_uring_cqe *cqe = uring_cqe(&ring);
+		if (cqe == NULL) {
+			passed = uring_enter(&ring, 1) >= 0;
+			continue;
+		}
+		if (!(cqe->flags & IORING_CQE_F_MORE)) {
+			arm_recv(&ring, srv, &msg);
+		}
+		if (cqe->res >= 0) {
+			uint16_t id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+			uint8_t *buf = uring_buf(&bufs, id);
+			struct io_uring_recvmsg_out *out = (void *)buf;
+			unsigned val = 0;
+			memcpy(&val, buf + sizeof(*out) + msg.msg_namelen, sizeof(val));
+			passed = out->payloadlen == sizeof(val) && val == received;
+			received += 1;
+			uring_bufs_put(&bufs, id);
+			uring_bufs_commit(&bufs);
+		}
+		uring_cqe_seen(&ring);
+	}
+	ok(passed && received == DGRAM_COUNT, "uring: receive datagrams");
+
+	/* Cancel pending receive on an idle socket. */
+	arm_recv(&ring, cli, &msg);
+	uring_enter(&ring, 0);
+	struct io_uring_sqe *sqe = uring_sqe(&ring);
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = cli;
+	sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+	sqe->user_data = 0;
+	uring_enter(&ring, 2);
+	unsigned cancelled = 0;
+	struct io_uring_cqe *cqe = NULL;
+	while ((cqe = uring_cqe(&ring)) != NULL) {
+		if (cqe->user_data == 0 && cqe->res == 1) {
+			cancelled += 1;
+		}
+		uring_cqe_seen(&ring);
+	}
+	ok(cancelled == 1, "uring: cancel");
+
+	/* Nothing to submit or wait for. */
+	ok(uring_enter(&ring, 0) == 0, "uring: enter without work");
+
+	/* Full submission ring. */
+	unsigned queued = 0;
+	while (uring_sqe(&ring) != NULL) {
+		++queued;
+	}
+	ok(queued == 16, "uring: submission ring limit");
+
+	close(cli);
+	close(srv);
+	uring_bufs_deinit(&ring, &bufs);
+	uring_deinit(&ring);
+	return 0;
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+	skip_all("io_uring not available");
+	return 0;
+}
+
+#endif /* HAVE_IO_URING */
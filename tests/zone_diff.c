@@ -0,0 +1,284 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <tap/basic.h>
+#include <signal.h>
+#include <stdio.h>
+
+#include "common/descriptor.h"
+#include "libknot/dname.h"
+#include "libknot/rrset.h"
+#include "knot/updates/changesets.h"
+#include "knot/zone/zone-contents.h"
+#include "knot/zone/zone-diff.c" // comparing parallel and serial diff
+#include "zone_helpers.h"
+
+/*! \brief Number of names in the first version of the large zone. */
+#define LARGE_COUNT (ZONE_DIFF_PARALLEL_MIN + 4096)
+
+/*! \brief Number of names in each block only in the second version. */
+#define BLOCK_COUNT 1024
+
+static knot_zone_contents_t *zone_create(uint8_t serial)
+{
+	knot_dname_t *apex = knot_dname_from_str("example.com");
+	knot_zone_contents_t *zone = knot_zone_contents_new(apex);
+	knot_dname_free(&apex, NULL);
+
+	uint8_t soa[22] = { 0 };
+	soa[5] = serial;
+	zone_add_rr(zone, "example.com", KNOT_RRTYPE_SOA, soa, sizeof(soa), 3600);
+
+	return zone;
+}
+
+/*! \brief Check if the changeset part contains exactly given RR. */
+static bool has_rr(const list_t *part, const char *owner_str, uint16_t type,
+                   uint8_t last_octet, uint32_t ttl)
+{
+	knot_dname_t *owner = knot_dname_from_str(owner_str);
+	bool found = false;
+
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, *part) {
+		const knot_rrset_t *rrset = rr_node->rr;
+		if (rrset->type != type || !knot_dname_is_equal(rrset->owner, owner)) {
+			continue;
+		}
+		for (uint16_t i = 0; i < rrset->rrs.rr_count; ++i) {
+			const knot_rdata_t *rr = knot_rdataset_at(&rrset->rrs, i);
+			if (knot_rdata_data(rr)[3] == last_octet &&
+			    knot_rdata_ttl(rr) == ttl) {
+				found = true;
+			}
+		}
+	}
+
+	knot_dname_free(&owner, NULL);
+	return found;
+}
+
+static size_t part_size(const list_t *part)
+{
+	size_t count = 0;
+	knot_rr_ln_t *rr_node = NULL;
+	WALK_LIST(rr_node, *part) {
+		count += rr_node->rr->rrs.rr_count;
+	}
+
+	return count;
+}
+
+static void test_small(void)
+{
+	knot_zone_contents_t *zone1 = zone_create(1);
+	knot_zone_contents_t *zone2 = zone_create(2);
+
+	const uint8_t a1[4] = { 192, 0, 2, 1 };
+	const uint8_t a2[4] = { 192, 0, 2, 2 };
+	const uint8_t a3[4] = { 192, 0, 2, 3 };
+
+	// unchanged
+	zone_add_rr(zone1, "a.example.com", KNOT_RRTYPE_A, a1, 4, 3600);
+	zone_add_rr(zone2, "a.example.com", KNOT_RRTYPE_A, a1, 4, 3600);
+	// removed node
+	zone_add_rr(zone1, "b.example.com", KNOT_RRTYPE_A, a1, 4, 3600);
+	// one RR replaced, one kept
+	zone_add_rr(zone1, "c.example.com", KNOT_RRTYPE_A, a1, 4, 3600);
+	zone_add_rr(zone1, "c.example.com", KNOT_RRTYPE_A, a2, 4, 3600);
+	zone_add_rr(zone2, "c.example.com", KNOT_RRTYPE_A, a2, 4, 3600);
+	zone_add_rr(zone2, "c.example.com", KNOT_RRTYPE_A, a3, 4, 3600);
+	// changed TTL
+	zone_add_rr(zone1, "d.example.com", KNOT_RRTYPE_A, a1, 4, 3600);
+	zone_add_rr(zone2, "d.example.com", KNOT_RRTYPE_A, a1, 4, 60);
+	// added node
+	zone_add_rr(zone2, "e.example.com", KNOT_RRTYPE_A, a1, 4, 3600);
+
+	knot_zone_contents_adjust_full(zone1, NULL, NULL);
+	knot_zone_contents_adjust_full(zone2, NULL, NULL);
+
+	knot_changesets_t *chgsets = knot_changesets_create();
+	knot_changeset_t *ch = knot_changesets_create_changeset(chgsets);
+
+	int ret = knot_zone_contents_create_diff(zone1, zone2, ch);
+	ok(ret == KNOT_EOK && ch->serial_from == 1 && ch->serial_to == 2,
+	   "zone diff: SOA serials");
+	ok(has_rr(&ch->remove, "b.example.com", KNOT_RRTYPE_A, 1, 3600),
+	   "zone diff: removed node");
+	ok(has_rr(&ch->add, "e.example.com", KNOT_RRTYPE_A, 1, 3600),
+	   "zone diff: added node");
+	ok(has_rr(&ch->remove, "c.example.com", KNOT_RRTYPE_A, 1, 3600) &&
+	   has_rr(&ch->add, "c.example.com", KNOT_RRTYPE_A, 3, 3600),
+	   "zone diff: replaced RR");
+	ok(has_rr(&ch->remove, "d.example.com", KNOT_RRTYPE_A, 1, 3600) &&
+	   has_rr(&ch->add, "d.example.com", KNOT_RRTYPE_A, 1, 60),
+	   "zone diff: changed TTL");
+	ok(part_size(&ch->remove) == 3 && part_size(&ch->add) == 3,
+	   "zone diff: no other changes");
+
+	knot_changesets_free(&chgsets);
+	knot_zone_contents_deep_free(&zone1);
+	knot_zone_contents_deep_free(&zone2);
+}
+
+static void zone_add_host(knot_zone_contents_t *zone, const char *owner,
+                          uint8_t last_octet, uint32_t ttl)
+{
+	const uint8_t a[4] = { 192, 0, 2, last_octet };
+	zone_add_rr(zone, owner, KNOT_RRTYPE_A, a, sizeof(a), ttl);
+}
+
+/*!
+ * \brief Create a pair of large zones differing in many nodes.
+ *
+ * The second version has removed, changed and added names, and blocks of
+ * names only in it before, in the middle of, and after the first version.
+ */
+static void large_zones_create(knot_zone_contents_t **zone1,
+                               knot_zone_contents_t **zone2)
+{
+	*zone1 = zone_create(1);
+	*zone2 = zone_create(2);
+
+	char owner[64];
+	for (unsigned i = 0; i < LARGE_COUNT; ++i) {
+		snprintf(owner, sizeof(owner), "n%05u.example.com", i);
+		zone_add_host(*zone1, owner, i % 256, 3600);
+		if (i % 11 == 0) {
+			continue; // removed
+		}
+		zone_add_host(*zone2, owner, (i + (i % 7 == 0)) % 256,
+		              i % 13 == 0 ? 60 : 3600);
+		if (i % 97 == 0) {
+			snprintf(owner, sizeof(owner), "n%05ux.example.com", i);
+			zone_add_host(*zone2, owner, 1, 3600);
+		}
+	}
+
+	for (unsigned i = 0; i < BLOCK_COUNT; ++i) {
+		snprintf(owner, sizeof(owner), "m%05u.example.com", i);
+		zone_add_host(*zone2, owner, 1, 3600);
+		snprintf(owner, sizeof(owner), "n%05u-%05u.example.com",
+		         LARGE_COUNT / 2, i);
+		zone_add_host(*zone2, owner, 1, 3600);
+		snprintf(owner, sizeof(owner), "z%05u.example.com", i);
+		zone_add_host(*zone2, owner, 1, 3600);
+	}
+
+	knot_zone_contents_adjust_full(*zone1, NULL, NULL);
+	knot_zone_contents_adjust_full(*zone2, NULL, NULL);
+}
+
+/*! \brief Check if RR sets have identical records, including TTLs. */
+static bool rrset_identical(const knot_rrset_t *rrset1,
+                            const knot_rrset_t *rrset2)
+{
+	if (!knot_rrset_equal(rrset1, rrset2, KNOT_RRSET_COMPARE_WHOLE)) {
+		return false;
+	}
+
+	for (uint16_t i = 0; i < rrset1->rrs.rr_count; ++i) {
+		if (knot_rrset_rr_ttl(rrset1, i) != knot_rrset_rr_ttl(rrset2, i)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*! \brief Check if changeset parts contain the same RR sets in same order. */
+static bool part_equal(const list_t *part1, const list_t *part2)
+{
+	const node_t *n1 = HEAD(*part1);
+	const node_t *n2 = HEAD(*part2);
+	while (n1->next != NULL && n2->next != NULL) {
+		const knot_rr_ln_t *rr1 = (const knot_rr_ln_t *)n1;
+		const knot_rr_ln_t *rr2 = (const knot_rr_ln_t *)n2;
+		if (!rrset_identical(rr1->rr, rr2->rr)) {
+			return false;
+		}
+		n1 = n1->next;
+		n2 = n2->next;
+	}
+
+	return n1->next == NULL && n2->next == NULL;
+}
+
+static void test_parallel(void)
+{
+	knot_zone_contents_t *zone1 = NULL, *zone2 = NULL;
+	large_zones_create(&zone1, &zone2);
+	ok(knot_zone_tree_weight(zone1->nodes) >= ZONE_DIFF_PARALLEL_MIN,
+	   "zone diff: zone large enough to be diffed in parallel");
+
+	knot_changesets_t *chgsets = knot_changesets_create();
+	knot_changeset_t *parallel = knot_changesets_create_changeset(chgsets);
+	knot_changeset_t *serial = knot_changesets_create_changeset(chgsets);
+
+	int ret = knot_zone_contents_create_diff(zone1, zone2, parallel);
+	if (ret == KNOT_EOK) {
+		ret = knot_zone_diff_trees(zone1->nodes, zone2->nodes, serial,
+		                           false);
+	}
+
+	size_t removed = 0, added = 0;
+	for (unsigned i = 0; i < LARGE_COUNT; ++i) {
+		if (i % 11 == 0) {
+			removed += 1;
+		} else if (i % 7 == 0 || i % 13 == 0) {
+			removed += 1;
+			added += 1;
+		}
+		if (i % 11 != 0 && i % 97 == 0) {
+			added += 1;
+		}
+	}
+	added += 3 * BLOCK_COUNT;
+
+	ok(ret == KNOT_EOK && part_size(&parallel->remove) == removed &&
+	   part_size(&parallel->add) == added,
+	   "zone diff: all changes of large zones found");
+	ok(part_equal(&parallel->remove, &serial->remove) &&
+	   part_equal(&parallel->add, &serial->add),
+	   "zone diff: parallel diff equal to serial diff");
+
+	knot_changesets_free(&chgsets);
+	knot_zone_contents_deep_free(&zone1);
+	knot_zone_contents_deep_free(&zone2);
+}
+
+// Signal handler
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan(9);
+
+	/* Worker threads are interrupted when stopped. */
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL);
+
+	test_small();
+	test_parallel();
+
+	return 0;
+}
@@ -0,0 +1,53 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file zone_helpers.h
+ *
+ * \brief Zone construction helpers shared by the tests.
+ */
+
+#ifndef _TESTS_ZONE_HELPERS_H_
+#define _TESTS_ZONE_HELPERS_H_
+
+#include "libknot/dname.h"
+#include "libknot/rrset.h"
+#include "knot/zone/zone-contents.h"
+
+/*!
+ * \brief Add a single RR to the zone.
+ *
+ * \param zone      Zone contents.
+ * \param owner_str Owner name in text form.
+ * \param type      RR type.
+ * \param rdata     RDATA in wire format.
+ * \param size      RDATA size.
+ * \param ttl       RR TTL.
+ */
+static inline void zone_add_rr(knot_zone_contents_t *zone, const char *owner_str,
+                               uint16_t type, const uint8_t *rdata,
+                               uint16_t size, uint32_t ttl)
+{
+	knot_dname_t *owner = knot_dname_from_str(owner_str);
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, owner, type, KNOT_CLASS_IN);
+	knot_rrset_add_rdata(&rrset, rdata, size, ttl, NULL);
+	zone_node_t *node = NULL;
+	knot_zone_contents_add_rr(zone, &rrset, &node, NULL);
+	knot_rdataset_clear(&rrset.rrs, NULL);
+	knot_dname_free(&owner, NULL);
+}
+
+#endif // _TESTS_ZONE_HELPERS_H_
@@ -0,0 +1,255 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <tap/basic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common/mempool.h"
+#include "libknot/packet/wire.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/server/zone-load.c" // testing the stub registration
+
+#define TEST_COUNT 13
+
+/* Zone file shared by the test zones, names are relative to the origin. */
+static const char *ZONE_FILE =
+	"@  3600 IN SOA ns mail 1 3600 900 86400 300\n"
+	"@  3600 IN NS  ns\n"
+	"ns 3600 IN A   192.0.2.1\n";
+
+static void write_file(const char *path, const char *data)
+{
+	FILE *f = fopen(path, "w");
+	if (f != NULL) {
+		fputs(data, f);
+		fclose(f);
+	}
+}
+
+/*!
+ * \brief Create configuration of a lazy loaded zone.
+ */
+static conf_zone_t *zone_conf(const char *dir, const char *name)
+{
+	conf_zone_t *conf = malloc(sizeof(conf_zone_t));
+	conf_init_zone(conf);
+	conf->name = strdup(name);
+	conf->lazy_load = true;
+	conf->enable_checks = false;
+	conf->dnssec_enable = false;
+	conf->build_diffs = false;
+	conf->dbsync_timeout = 60;
+
+	char path[256];
+	snprintf(path, sizeof(path), "%s/zone.db", dir);
+	conf->file = strdup(path);
+	snprintf(path, sizeof(path), "%s/%sdiff.db", dir, name);
+	conf->ixfr_db = strdup(path);
+
+	return conf;
+}
+
+/*!
+ * \brief Resolve SOA query for the zone apex, return the answer RCODE.
+ */
+static int query_rcode(server_t *server, const char *name)
+{
+	knot_process_t query_ctx;
+	memset(&query_ctx, 0, sizeof(knot_process_t));
+	mm_ctx_mempool(&query_ctx.mm, sizeof(knot_pkt_t));
+
+	struct sockaddr_storage ss;
+	sockaddr_set(&ss, AF_INET, "127.0.0.1", 53);
+	struct process_query_param param = {0};
+	param.query_source = &ss;
+	param.server = server;
+
+	knot_dname_t *qname = knot_dname_from_str(name);
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, &query_ctx.mm);
+	knot_pkt_put_question(query, qname, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+	knot_dname_free(&qname, NULL);
+
+	knot_process_begin(&query_ctx, &param, NS_PROC_QUERY);
+	knot_process_in(query->wire, query->size, &query_ctx);
+
+	uint16_t answer_len = KNOT_WIRE_MAX_PKTSIZE;
+	uint8_t answer[KNOT_WIRE_MAX_PKTSIZE];
+	int state = knot_process_out(answer, &answer_len, &query_ctx);
+	if (state & NS_PROC_FAIL) {
+		answer_len = KNOT_WIRE_MAX_PKTSIZE;
+		knot_process_out(answer, &answer_len, &query_ctx);
+	}
+	knot_process_finish(&query_ctx);
+
+	int rcode = -1;
+	if (answer_len >= KNOT_WIRE_HEADER_SIZE) {
+		rcode = knot_wire_get_rcode(answer);
+	}
+
+	mp_delete((struct mempool *)query_ctx.mm.ctx);
+
+	return rcode;
+}
+
+/*!
+ * \brief Run the pending zone load in this thread.
+ */
+static void run_load(server_t *server, zone_t *zone, bool reloading)
+{
+	event_t *ev = evsched_begin_process(&server->sched);
+	if (ev == zone->load) {
+		/* Reload froze the timers while the zone is being loaded. */
+		if (reloading) {
+			zone->flags |= ZONE_FROZEN;
+		}
+		ev->cb(ev);
+	}
+	evsched_end_process(&server->sched);
+}
+
+static void *freeze_thread(void *zone)
+{
+	zone_timers_freeze(zone);
+	return NULL;
+}
+
+static void test_lazy(const char *dir)
+{
+	server_t server;
+	server_init(&server);
+	server.opt_rr = knot_edns_new();
+	knot_edns_set_version(server.opt_rr, EDNS_VERSION);
+	knot_edns_set_payload(server.opt_rr, 4096);
+
+	// 1. - zone is registered as a stub
+	zone_t *frozen = zone_new_lazy(zone_conf(dir, "example.com."));
+	zone_t *thawed = zone_new_lazy(zone_conf(dir, "example.net."));
+	ok(frozen != NULL && (frozen->flags & ZONE_LAZY) &&
+	   frozen->contents == NULL && frozen->ixfr_db == NULL,
+	   "lazy zone: register zone as a stub without contents and journal");
+	zone_timers_create(frozen, &server.sched);
+	zone_timers_create(thawed, &server.sched);
+
+	knot_zonedb_free(&server.zone_db);
+	server.zone_db = knot_zonedb_new(2);
+	knot_zonedb_insert(server.zone_db, frozen);
+	knot_zonedb_insert(server.zone_db, thawed);
+	knot_zonedb_build_index(server.zone_db);
+
+	// 2.-3. - new and not loaded zones are registered as stubs
+	conf_zone_t *conf = frozen->conf;
+	ok(is_lazy(NULL, conf) && is_lazy(frozen, conf),
+	   "lazy zone: register new and not loaded zones as stubs");
+	conf->lazy_load = false;
+	ok(!is_lazy(NULL, conf), "lazy zone: load zone without lazy loading");
+	conf->lazy_load = true;
+
+	// 4.-5. - first query is answered SERVFAIL and requests the load
+	ok(query_rcode(&server, "example.com") == KNOT_RCODE_SERVFAIL,
+	   "lazy zone: SERVFAIL until the zone is loaded");
+	ok((frozen->flags & ZONE_LOADING) && server.sched.heap.num == 1,
+	   "lazy zone: schedule the load on first use");
+
+	// 6. - the load is scheduled only once
+	ok(query_rcode(&server, "example.com") == KNOT_RCODE_SERVFAIL &&
+	   server.sched.heap.num == 1,
+	   "lazy zone: schedule the load only once");
+
+	// 7.-8. - zone loaded during reload doesn't start its timers
+	run_load(&server, frozen, true);
+	ok(frozen->contents != NULL && frozen->ixfr_db != NULL &&
+	   !(frozen->flags & (ZONE_LAZY | ZONE_LOADING)),
+	   "lazy zone: load the zone contents");
+	ok(server.sched.heap.num == 0,
+	   "lazy zone: don't start timers of zone frozen by reload");
+
+	// 9. - loaded zone is answered
+	ok(query_rcode(&server, "example.com") == KNOT_RCODE_NOERROR,
+	   "lazy zone: answer after the zone is loaded");
+
+	// 10. - zone loaded otherwise starts its timers
+	query_rcode(&server, "example.net");
+	run_load(&server, thawed, false);
+	ok(thawed->contents != NULL && server.sched.heap.num > 0 &&
+	   !(thawed->flags & (ZONE_THAWING | ZONE_FROZEN)),
+	   "lazy zone: start timers of the loaded zone");
+
+	// 11. - reload keeps the loaded zone loaded
+	ok(!is_lazy(frozen, conf) && is_lazy(NULL, conf),
+	   "lazy zone: reload keeps loaded zone loaded");
+
+	// 12.-13. - reload waits for the loaded zone starting its timers
+	pthread_mutex_lock(&thawed->lock);
+	thawed->flags |= ZONE_THAWING;
+	pthread_mutex_unlock(&thawed->lock);
+	pthread_t thread;
+	pthread_create(&thread, NULL, freeze_thread, thawed);
+	usleep(10000);
+	pthread_mutex_lock(&thawed->lock);
+	ok(!(thawed->flags & ZONE_FROZEN),
+	   "lazy zone: freeze waits while the zone starts its timers");
+	thawed->flags &= ~ZONE_THAWING;
+	pthread_cond_broadcast(&thawed->thawed);
+	pthread_mutex_unlock(&thawed->lock);
+	pthread_join(thread, NULL);
+	ok((thawed->flags & ZONE_FROZEN) && server.sched.heap.num == 0,
+	   "lazy zone: freeze the zone when its timers are started");
+
+	server_deinit(&server);
+}
+
+// Signal handler
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan(TEST_COUNT);
+
+	/* Worker threads are interrupted when stopped. */
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL);
+
+	char dir[] = "/tmp/knot-zone_lazy.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		skip_block(TEST_COUNT, "lazy zone: cannot create zone directory");
+		return 0;
+	}
+
+	char path[256];
+	snprintf(path, sizeof(path), "%s/zone.db", dir);
+	write_file(path, ZONE_FILE);
+
+	test_lazy(dir);
+
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/example.com.diff.db", dir);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/example.net.diff.db", dir);
+	unlink(path);
+	rmdir(dir);
+
+	return 0;
+}
@@ -36,7 +36,7 @@ static const char *zone_list[ZONE_COUNT] = {
 
 int main(int argc, char *argv[])
 {
-	plan(6);
+	plan(7);
 
 	/* Create database. */
 	char buf[KNOT_DNAME_MAXLEN];
@@ -112,6 +112,11 @@ int main(int argc, char *argv[])
 	}
 	ok(nr_passed == ZONE_COUNT, "zonedb: removed all zones");
 
+	/* Lookup in empty database. */
+	dname = knot_dname_from_str(prefix);
+	ok(knot_zonedb_find_suffix(db, dname) == NULL, "zonedb: find in empty database");
+	knot_dname_free(&dname, NULL);
+
 cleanup:
 	knot_zonedb_deep_free(&db);
 	return 0;
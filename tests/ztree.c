@@ -99,7 +99,7 @@ int main(int argc, char *argv[])
 	ok(passed, "ztree: lookup");
 
 	/* heal index for ordered lookup */
-	hattrie_build_index(t);
+	knot_zone_tree_build_index(t);
 
 	/* 4. ordered lookup */
 	passed = 1;